@@ -4,10 +4,52 @@
 
 #include "LockFreeApiEventProducer.h"
 
+#include <optional>
+#include <utility>
 #include <variant>
 
+#include "ApiUtils/ApiNameInterner.h"
+
 namespace orbit_api {
 
+ApiEncodedString LockFreeApiEventProducer::InternOrEncodeName(const char* name) {
+  if (name == nullptr) return ApiEncodedString{name};
+
+  // Interning per thread guarantees that the ApiInternedString reaches the service before the
+  // events that refer to it, as the lock-free queue only preserves the order of events that were
+  // enqueued by the same thread.
+  struct ThreadLocalNames {
+    uint64_t capture_generation = 0;
+    ApiNameInterner interner;
+  };
+  thread_local ThreadLocalNames thread_local_names;
+
+  const uint64_t capture_generation = capture_generation_.load(std::memory_order_acquire);
+  if (thread_local_names.capture_generation != capture_generation) {
+    thread_local_names.interner.Clear();
+    thread_local_names.capture_generation = capture_generation;
+  }
+
+  bool interned_now = false;
+  std::optional<uint64_t> key = thread_local_names.interner.GetOrInternName(
+      name, [this] { return next_interned_string_key_.fetch_add(1, std::memory_order_relaxed); },
+      &interned_now);
+  if (!key.has_value()) return ApiEncodedString{name};
+  if (interned_now && !EnqueueIntermediateEvent(ApiInternedString{key.value(), name})) {
+    // The buffer of this thread is full. Send the name with the event instead, and intern it again
+    // the next time.
+    thread_local_names.interner.ForgetName(name);
+    return ApiEncodedString{name};
+  }
+  return ApiEncodedString::FromInternedStringKey(key.value());
+}
+
+void LockFreeApiEventProducer::OnCaptureStart(orbit_grpc_protos::CaptureOptions capture_options) {
+  // The service forgets the names of the previous capture.
+  capture_generation_.fetch_add(1, std::memory_order_release);
+  LockFreeBufferCaptureEventProducer::OnCaptureStart(std::move(capture_options));
+}
+
 orbit_grpc_protos::ProducerCaptureEvent* LockFreeApiEventProducer::TranslateIntermediateEvent(
     ApiEventVariant&& raw_api_event, google::protobuf::Arena* arena) {
   auto* capture_event =
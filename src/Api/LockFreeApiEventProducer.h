@@ -7,6 +7,8 @@
 
 #include <google/protobuf/arena.h>
 
+#include <atomic>
+#include <cstdint>
 #include <utility>
 #include <variant>
 
@@ -28,9 +30,24 @@ class LockFreeApiEventProducer
 
   ~LockFreeApiEventProducer() override { ShutdownAndWait(); }
 
+  // Returns the name to put into an event that is enqueued next by the calling thread. The first
+  // time a thread uses a name during a capture, the name is enqueued as an ApiInternedString, and
+  // this and all later events of the thread only refer to it by key. This avoids encoding and
+  // sending the same name over and over for events that are produced at a high rate.
+  [[nodiscard]] ApiEncodedString InternOrEncodeName(const char* name);
+
  protected:
+  void OnCaptureStart(orbit_grpc_protos::CaptureOptions capture_options) override;
+
   [[nodiscard]] orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
       ApiEventVariant&& raw_api_event, google::protobuf::Arena* arena) override;
+
+ private:
+  // Incremented on every capture start, so that threads know to send their names again.
+  std::atomic<uint64_t> capture_generation_ = 0;
+  // Keys are unique across threads, as the interned strings of all threads end up in the same
+  // capture. Zero means that a name is not interned.
+  std::atomic<uint64_t> next_interned_string_key_ = 1;
 };
 
 }  // namespace orbit_api
@@ -38,17 +38,31 @@ void EnqueueApiEvent(Types... args) {
   producer.EnqueueIntermediateEvent(event);
 }
 
+// Like `EnqueueApiEvent`, but for events with a name, which is interned by the producer.
+template <typename Event, typename... Types>
+void EnqueueNamedApiEvent(const char* name, Types... args) {
+  orbit_api::LockFreeApiEventProducer& producer = GetCaptureEventProducer();
+
+  if (!producer.IsCapturing()) return;
+
+  static uint32_t pid = orbit_base::GetCurrentProcessId();
+  thread_local uint32_t tid = orbit_base::GetCurrentThreadId();
+  uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  Event event{pid, tid, timestamp_ns, producer.InternOrEncodeName(name), args...};
+  producer.EnqueueIntermediateEvent(event);
+}
+
 void orbit_api_start_v1(const char* name, orbit_api_color color, uint64_t group_id,
                         uint64_t caller_address) {
   if (caller_address == kOrbitCallerAddressAuto) {
     caller_address = ORBIT_GET_CALLER_PC();
   }
-  EnqueueApiEvent<orbit_api::ApiScopeStart>(name, color, group_id, caller_address);
+  EnqueueNamedApiEvent<orbit_api::ApiScopeStart>(name, color, group_id, caller_address);
 }
 
 [[deprecated]] void orbit_api_start(const char* name, orbit_api_color color) {
   uint64_t return_address = ORBIT_GET_CALLER_PC();
-  EnqueueApiEvent<orbit_api::ApiScopeStart>(
+  EnqueueNamedApiEvent<orbit_api::ApiScopeStart>(
       name, color, static_cast<uint64_t>(kOrbitDefaultGroupId), return_address);
 }
 
@@ -59,38 +73,38 @@ void orbit_api_start_async_v1(const char* name, uint64_t id, orbit_api_color col
   if (caller_address == kOrbitCallerAddressAuto) {
     caller_address = ORBIT_GET_CALLER_PC();
   }
-  EnqueueApiEvent<orbit_api::ApiScopeStartAsync>(name, id, color, caller_address);
+  EnqueueNamedApiEvent<orbit_api::ApiScopeStartAsync>(name, id, color, caller_address);
 }
 
 [[deprecated]] void orbit_api_start_async(const char* name, uint64_t id, orbit_api_color color) {
   uint64_t return_address = ORBIT_GET_CALLER_PC();
-  EnqueueApiEvent<orbit_api::ApiScopeStartAsync>(name, id, color, return_address);
+  EnqueueNamedApiEvent<orbit_api::ApiScopeStartAsync>(name, id, color, return_address);
 }
 
 void orbit_api_stop_async(uint64_t id) { EnqueueApiEvent<orbit_api::ApiScopeStopAsync>(id); }
 
 void orbit_api_track_int(const char* name, int32_t value, orbit_api_color color) {
-  EnqueueApiEvent<orbit_api::ApiTrackInt>(name, value, color);
+  EnqueueNamedApiEvent<orbit_api::ApiTrackInt>(name, value, color);
 }
 
 void orbit_api_track_int64(const char* name, int64_t value, orbit_api_color color) {
-  EnqueueApiEvent<orbit_api::ApiTrackInt64>(name, value, color);
+  EnqueueNamedApiEvent<orbit_api::ApiTrackInt64>(name, value, color);
 }
 
 void orbit_api_track_uint(const char* name, uint32_t value, orbit_api_color color) {
-  EnqueueApiEvent<orbit_api::ApiTrackUint>(name, value, color);
+  EnqueueNamedApiEvent<orbit_api::ApiTrackUint>(name, value, color);
 }
 
 void orbit_api_track_uint64(const char* name, uint64_t value, orbit_api_color color) {
-  EnqueueApiEvent<orbit_api::ApiTrackUint64>(name, value, color);
+  EnqueueNamedApiEvent<orbit_api::ApiTrackUint64>(name, value, color);
 }
 
 void orbit_api_track_float(const char* name, float value, orbit_api_color color) {
-  EnqueueApiEvent<orbit_api::ApiTrackFloat>(name, value, color);
+  EnqueueNamedApiEvent<orbit_api::ApiTrackFloat>(name, value, color);
 }
 
 void orbit_api_track_double(const char* name, double value, orbit_api_color color) {
-  EnqueueApiEvent<orbit_api::ApiTrackDouble>(name, value, color);
+  EnqueueNamedApiEvent<orbit_api::ApiTrackDouble>(name, value, color);
 }
 
 void orbit_api_async_string(const char* str, uint64_t id, orbit_api_color color) {
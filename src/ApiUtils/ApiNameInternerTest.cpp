@@ -0,0 +1,101 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "ApiUtils/ApiNameInterner.h"
+
+namespace orbit_api {
+
+namespace {
+
+class ApiNameInternerTest : public testing::Test {
+ protected:
+  std::optional<uint64_t> GetOrInternName(const char* name, bool* interned_now) {
+    return interner_.GetOrInternName(name, [this] { return next_key_++; }, interned_now);
+  }
+
+  ApiNameInterner interner_;
+  uint64_t next_key_ = 1;
+};
+
+}  // namespace
+
+TEST_F(ApiNameInternerTest, InternsNameOnlyOnce) {
+  bool interned_now = false;
+  EXPECT_EQ(GetOrInternName("name", &interned_now), 1);
+  EXPECT_TRUE(interned_now);
+  EXPECT_EQ(GetOrInternName("name", &interned_now), 1);
+  EXPECT_FALSE(interned_now);
+  EXPECT_EQ(GetOrInternName("other name", &interned_now), 2);
+  EXPECT_TRUE(interned_now);
+  EXPECT_EQ(next_key_, 3);
+}
+
+TEST_F(ApiNameInternerTest, SameContentAtDifferentAddressesHasSameKey) {
+  std::string name1 = "name";
+  std::string name2 = "name";
+  ASSERT_NE(name1.c_str(), name2.c_str());
+
+  bool interned_now = false;
+  EXPECT_EQ(GetOrInternName(name1.c_str(), &interned_now), 1);
+  EXPECT_TRUE(interned_now);
+  EXPECT_EQ(GetOrInternName(name2.c_str(), &interned_now), 1);
+  EXPECT_FALSE(interned_now);
+}
+
+TEST_F(ApiNameInternerTest, DetectsChangedContentAtSameAddress) {
+  char name[] = "name1";
+  bool interned_now = false;
+  EXPECT_EQ(GetOrInternName(name, &interned_now), 1);
+
+  name[4] = '2';
+  EXPECT_EQ(GetOrInternName(name, &interned_now), 2);
+  EXPECT_TRUE(interned_now);
+
+  name[4] = '1';
+  EXPECT_EQ(GetOrInternName(name, &interned_now), 1);
+  EXPECT_FALSE(interned_now);
+}
+
+TEST_F(ApiNameInternerTest, ReturnsNulloptForNewNamesWhenFull) {
+  bool interned_now = false;
+  for (size_t i = 0; i < ApiNameInterner::kMaxInternedNames; ++i) {
+    EXPECT_TRUE(GetOrInternName(std::to_string(i).c_str(), &interned_now).has_value());
+  }
+  EXPECT_EQ(GetOrInternName("new name", &interned_now), std::nullopt);
+  EXPECT_FALSE(interned_now);
+  EXPECT_EQ(GetOrInternName("0", &interned_now), 1);
+}
+
+TEST_F(ApiNameInternerTest, ForgetNameInternsNameAgainWithNewKey) {
+  std::string name1 = "name";
+  std::string name2 = "name";
+  bool interned_now = false;
+  EXPECT_EQ(GetOrInternName(name1.c_str(), &interned_now), 1);
+  EXPECT_EQ(GetOrInternName(name2.c_str(), &interned_now), 1);
+  EXPECT_EQ(GetOrInternName("other name", &interned_now), 2);
+
+  interner_.ForgetName(name1.c_str());
+  EXPECT_EQ(GetOrInternName(name2.c_str(), &interned_now), 3);
+  EXPECT_TRUE(interned_now);
+  EXPECT_EQ(GetOrInternName(name1.c_str(), &interned_now), 3);
+  EXPECT_FALSE(interned_now);
+  EXPECT_EQ(GetOrInternName("other name", &interned_now), 2);
+  EXPECT_FALSE(interned_now);
+}
+
+TEST_F(ApiNameInternerTest, ClearInternsNamesAgainWithNewKeys) {
+  bool interned_now = false;
+  EXPECT_EQ(GetOrInternName("name", &interned_now), 1);
+  interner_.Clear();
+  EXPECT_EQ(GetOrInternName("name", &interned_now), 2);
+  EXPECT_TRUE(interned_now);
+}
+
+}  // namespace orbit_api
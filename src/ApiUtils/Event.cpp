@@ -31,6 +31,7 @@ inline void SetEncodedName(const ApiEncodedString& encoded_name, CaptureEventT*
   out->set_encoded_name_8(encoded_name.encoded_name_8);
   out->mutable_encoded_name_additional()->Add(encoded_name.encoded_name_additional.begin(),
                                               encoded_name.encoded_name_additional.end());
+  out->set_name_key(encoded_name.name_key);
 }
 
 void ApiScopeStart::CopyToGrpcProto(orbit_grpc_protos::ApiScopeStart* grpc_proto) const {
@@ -107,6 +108,11 @@ void ApiTrackFloat::CopyToGrpcProto(orbit_grpc_protos::ApiTrackFloat* grpc_proto
   grpc_proto->set_color_rgba(color_rgba);
 }
 
+void ApiInternedString::CopyToGrpcProto(orbit_grpc_protos::InternedString* grpc_proto) const {
+  grpc_proto->set_key(key);
+  grpc_proto->set_intern(intern);
+}
+
 void FillProducerCaptureEventFromApiEvent(const ApiScopeStart& scope_start,
                                           orbit_grpc_protos::ProducerCaptureEvent* capture_event) {
   auto* api_event = capture_event->mutable_api_scope_start();
@@ -173,6 +179,12 @@ void FillProducerCaptureEventFromApiEvent(const ApiTrackUint64& track_uint64,
   track_uint64.CopyToGrpcProto(api_event);
 }
 
+void FillProducerCaptureEventFromApiEvent(const ApiInternedString& interned_string,
+                                          orbit_grpc_protos::ProducerCaptureEvent* capture_event) {
+  auto* api_event = capture_event->mutable_interned_string();
+  interned_string.CopyToGrpcProto(api_event);
+}
+
 void FillProducerCaptureEventFromApiEvent(
     const std::monostate& /*monostate*/,
     orbit_grpc_protos::ProducerCaptureEvent* /*capture_event*/) {
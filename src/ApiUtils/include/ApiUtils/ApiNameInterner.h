@@ -0,0 +1,89 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_API_UTILS_API_NAME_INTERNER_H_
+#define ORBIT_API_UTILS_API_NAME_INTERNER_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/node_hash_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace orbit_api {
+
+// Remembers the keys under which names have been interned, so that an event only needs to refer
+// to the key of its name instead of containing the whole name. Most names passed to the Orbit API
+// are string literals, so names are first looked up by address, and only by content if the address
+// is unknown or now holds a different string. This class is not thread-safe: the producer uses one
+// instance per thread, so that the interned string is always enqueued before the events of the
+// same thread that refer to it.
+class ApiNameInterner {
+ public:
+  // Names that are generated at runtime would otherwise make the cache grow without bounds.
+  static constexpr size_t kMaxInternedNames = 4096;
+
+  // Returns the key of `name`, or std::nullopt if `name` is not interned and the cache is full, in
+  // which case the name has to be sent with the event. If `name` was not interned yet,
+  // `create_key()` provides the key, and `interned_now` is set to true. The caller then has to
+  // send the name with that key before any event that refers to it.
+  template <typename CreateKey>
+  [[nodiscard]] std::optional<uint64_t> GetOrInternName(const char* name, CreateKey&& create_key,
+                                                        bool* interned_now) {
+    *interned_now = false;
+    auto address_it = entry_by_address_.find(name);
+    if (address_it != entry_by_address_.end() && address_it->second->first == name) {
+      return address_it->second->second;
+    }
+
+    auto name_it = key_by_name_.find(name);
+    if (name_it == key_by_name_.end()) {
+      if (key_by_name_.size() >= kMaxInternedNames) return std::nullopt;
+      name_it = key_by_name_.emplace(name, create_key()).first;
+      *interned_now = true;
+    }
+    if (address_it != entry_by_address_.end()) {
+      address_it->second = &*name_it;
+    } else if (entry_by_address_.size() < kMaxInternedNames) {
+      entry_by_address_.emplace(name, &*name_it);
+    }
+    return name_it->second;
+  }
+
+  // Forgets `name`, for example because sending it failed. The next call to GetOrInternName for the
+  // same name interns it again with a new key.
+  void ForgetName(const char* name) {
+    auto name_it = key_by_name_.find(name);
+    if (name_it == key_by_name_.end()) return;
+    const std::pair<const std::string, uint64_t>* entry = &*name_it;
+    for (auto address_it = entry_by_address_.begin(); address_it != entry_by_address_.end();) {
+      if (address_it->second == entry) {
+        entry_by_address_.erase(address_it++);
+      } else {
+        ++address_it;
+      }
+    }
+    key_by_name_.erase(name_it);
+  }
+
+  // Forgets all names, for example because a new capture started and the names need to be sent
+  // again.
+  void Clear() {
+    entry_by_address_.clear();
+    key_by_name_.clear();
+  }
+
+ private:
+  // The entries of key_by_name_ need stable addresses, as entry_by_address_ points to them.
+  absl::node_hash_map<std::string, uint64_t> key_by_name_;
+  absl::flat_hash_map<const char*, const std::pair<const std::string, uint64_t>*>
+      entry_by_address_;
+};
+
+}  // namespace orbit_api
+
+#endif  // ORBIT_API_UTILS_API_NAME_INTERNER_H_
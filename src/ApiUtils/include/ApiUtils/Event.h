@@ -7,6 +7,8 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -30,7 +32,16 @@ struct ApiEventMetaData {
 };
 
 struct ApiEncodedString {
-  explicit ApiEncodedString(const char* name) { EncodeString(name, this); }
+  // Implicit, so that the events below can be constructed from a plain name.
+  ApiEncodedString(const char* name) { EncodeString(name, this); }  // NOLINT
+  // Refers to a name that was sent before in an `ApiInternedString` event with this key, instead of
+  // encoding the name itself.
+  [[nodiscard]] static ApiEncodedString FromInternedStringKey(uint64_t key) {
+    ApiEncodedString encoded_string;
+    encoded_string.name_key = key;
+    return encoded_string;
+  }
+
   void set_encoded_name_1(uint64_t value) { encoded_name_1 = value; }
   void set_encoded_name_2(uint64_t value) { encoded_name_2 = value; }
   void set_encoded_name_3(uint64_t value) { encoded_name_3 = value; }
@@ -49,14 +60,28 @@ struct ApiEncodedString {
   uint64_t encoded_name_7 = 0;
   uint64_t encoded_name_8 = 0;
   std::vector<uint64_t> encoded_name_additional{};
+  uint64_t name_key = 0;
+
+ private:
+  ApiEncodedString() = default;
+};
+
+// Sends a name once, so that subsequent events can refer to it by `key`.
+struct ApiInternedString {
+  ApiInternedString(uint64_t key, std::string intern) : key(key), intern(std::move(intern)) {}
+
+  void CopyToGrpcProto(orbit_grpc_protos::InternedString* grpc_proto) const;
+
+  uint64_t key = 0;
+  std::string intern;
 };
 
 struct ApiScopeStart {
-  ApiScopeStart(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, const char* name,
+  ApiScopeStart(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, ApiEncodedString encoded_name,
                 orbit_api_color color_rgba = kOrbitColorAuto, uint64_t group_id = 0,
                 uint64_t address_in_function = 0)
       : meta_data(pid, tid, timestamp_ns),
-        encoded_name(name),
+        encoded_name(std::move(encoded_name)),
         group_id(group_id),
         address_in_function(address_in_function),
         color_rgba(color_rgba) {}
@@ -80,11 +105,11 @@ struct ApiScopeStop {
 };
 
 struct ApiScopeStartAsync {
-  ApiScopeStartAsync(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, const char* name,
-                     uint64_t id, orbit_api_color color_rgba = kOrbitColorAuto,
-                     uint64_t address_in_function = 0)
+  ApiScopeStartAsync(uint32_t pid, uint32_t tid, uint64_t timestamp_ns,
+                     ApiEncodedString encoded_name, uint64_t id,
+                     orbit_api_color color_rgba = kOrbitColorAuto, uint64_t address_in_function = 0)
       : meta_data(pid, tid, timestamp_ns),
-        encoded_name(name),
+        encoded_name(std::move(encoded_name)),
         id(id),
         address_in_function(address_in_function),
         color_rgba(color_rgba) {}
@@ -109,9 +134,12 @@ struct ApiScopeStopAsync {
 };
 
 struct ApiStringEvent {
-  ApiStringEvent(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, const char* name, uint64_t id,
-                 orbit_api_color color_rgba = kOrbitColorAuto)
-      : meta_data(pid, tid, timestamp_ns), encoded_name(name), id(id), color_rgba(color_rgba) {}
+  ApiStringEvent(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, ApiEncodedString encoded_name,
+                 uint64_t id, orbit_api_color color_rgba = kOrbitColorAuto)
+      : meta_data(pid, tid, timestamp_ns),
+        encoded_name(std::move(encoded_name)),
+        id(id),
+        color_rgba(color_rgba) {}
 
   void CopyToGrpcProto(orbit_grpc_protos::ApiStringEvent* grpc_proto) const;
 
@@ -122,9 +150,12 @@ struct ApiStringEvent {
 };
 
 struct ApiTrackInt {
-  ApiTrackInt(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, const char* name, int32_t data,
-              orbit_api_color color_rgba = kOrbitColorAuto)
-      : meta_data(pid, tid, timestamp_ns), encoded_name(name), data(data), color_rgba(color_rgba) {}
+  ApiTrackInt(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, ApiEncodedString encoded_name,
+              int32_t data, orbit_api_color color_rgba = kOrbitColorAuto)
+      : meta_data(pid, tid, timestamp_ns),
+        encoded_name(std::move(encoded_name)),
+        data(data),
+        color_rgba(color_rgba) {}
 
   void CopyToGrpcProto(orbit_grpc_protos::ApiTrackInt* grpc_proto) const;
 
@@ -135,9 +166,12 @@ struct ApiTrackInt {
 };
 
 struct ApiTrackInt64 {
-  ApiTrackInt64(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, const char* name, int64_t data,
-                orbit_api_color color_rgba = kOrbitColorAuto)
-      : meta_data(pid, tid, timestamp_ns), encoded_name(name), data(data), color_rgba(color_rgba) {}
+  ApiTrackInt64(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, ApiEncodedString encoded_name,
+                int64_t data, orbit_api_color color_rgba = kOrbitColorAuto)
+      : meta_data(pid, tid, timestamp_ns),
+        encoded_name(std::move(encoded_name)),
+        data(data),
+        color_rgba(color_rgba) {}
 
   void CopyToGrpcProto(orbit_grpc_protos::ApiTrackInt64* grpc_proto) const;
 
@@ -148,9 +182,12 @@ struct ApiTrackInt64 {
 };
 
 struct ApiTrackUint {
-  ApiTrackUint(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, const char* name, uint32_t data,
-               orbit_api_color color_rgba = kOrbitColorAuto)
-      : meta_data(pid, tid, timestamp_ns), encoded_name(name), data(data), color_rgba(color_rgba) {}
+  ApiTrackUint(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, ApiEncodedString encoded_name,
+               uint32_t data, orbit_api_color color_rgba = kOrbitColorAuto)
+      : meta_data(pid, tid, timestamp_ns),
+        encoded_name(std::move(encoded_name)),
+        data(data),
+        color_rgba(color_rgba) {}
 
   void CopyToGrpcProto(orbit_grpc_protos::ApiTrackUint* grpc_proto) const;
 
@@ -161,9 +198,12 @@ struct ApiTrackUint {
 };
 
 struct ApiTrackUint64 {
-  ApiTrackUint64(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, const char* name, uint64_t data,
-                 orbit_api_color color_rgba = kOrbitColorAuto)
-      : meta_data(pid, tid, timestamp_ns), encoded_name(name), data(data), color_rgba(color_rgba) {}
+  ApiTrackUint64(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, ApiEncodedString encoded_name,
+                 uint64_t data, orbit_api_color color_rgba = kOrbitColorAuto)
+      : meta_data(pid, tid, timestamp_ns),
+        encoded_name(std::move(encoded_name)),
+        data(data),
+        color_rgba(color_rgba) {}
 
   void CopyToGrpcProto(orbit_grpc_protos::ApiTrackUint64* grpc_proto) const;
 
@@ -174,9 +214,12 @@ struct ApiTrackUint64 {
 };
 
 struct ApiTrackDouble {
-  ApiTrackDouble(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, const char* name, double data,
-                 orbit_api_color color_rgba = kOrbitColorAuto)
-      : meta_data(pid, tid, timestamp_ns), encoded_name(name), data(data), color_rgba(color_rgba) {}
+  ApiTrackDouble(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, ApiEncodedString encoded_name,
+                 double data, orbit_api_color color_rgba = kOrbitColorAuto)
+      : meta_data(pid, tid, timestamp_ns),
+        encoded_name(std::move(encoded_name)),
+        data(data),
+        color_rgba(color_rgba) {}
 
   void CopyToGrpcProto(orbit_grpc_protos::ApiTrackDouble* grpc_proto) const;
 
@@ -187,9 +230,12 @@ struct ApiTrackDouble {
 };
 
 struct ApiTrackFloat {
-  ApiTrackFloat(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, const char* name, float data,
-                orbit_api_color color_rgba = kOrbitColorAuto)
-      : meta_data(pid, tid, timestamp_ns), encoded_name(name), data(data), color_rgba(color_rgba) {}
+  ApiTrackFloat(uint32_t pid, uint32_t tid, uint64_t timestamp_ns, ApiEncodedString encoded_name,
+                float data, orbit_api_color color_rgba = kOrbitColorAuto)
+      : meta_data(pid, tid, timestamp_ns),
+        encoded_name(std::move(encoded_name)),
+        data(data),
+        color_rgba(color_rgba) {}
 
   void CopyToGrpcProto(orbit_grpc_protos::ApiTrackFloat* grpc_proto) const;
 
@@ -204,7 +250,7 @@ struct ApiTrackFloat {
 using ApiEventVariant =
     std::variant<std::monostate, ApiScopeStart, ApiScopeStop, ApiScopeStartAsync, ApiScopeStopAsync,
                  ApiStringEvent, ApiTrackDouble, ApiTrackFloat, ApiTrackInt, ApiTrackInt64,
-                 ApiTrackUint, ApiTrackUint64>;
+                 ApiTrackUint, ApiTrackUint64, ApiInternedString>;
 
 void FillProducerCaptureEventFromApiEvent(const ApiScopeStart& scope_start,
                                           orbit_grpc_protos::ProducerCaptureEvent* capture_event);
@@ -239,6 +285,9 @@ void FillProducerCaptureEventFromApiEvent(const ApiTrackUint& track_uint,
 void FillProducerCaptureEventFromApiEvent(const ApiTrackUint64& track_uint64,
                                           orbit_grpc_protos::ProducerCaptureEvent* capture_event);
 
+void FillProducerCaptureEventFromApiEvent(const ApiInternedString& interned_string,
+                                          orbit_grpc_protos::ProducerCaptureEvent* capture_event);
+
 // The variant type `ApiEventVariant` requires to contain `std::monostate` in order to be default-
 // constructable. However, that state is never expected to be called in the visitor.
 void FillProducerCaptureEventFromApiEvent(
@@ -5,6 +5,7 @@
 #include "CaptureClient/ApiEventProcessor.h"
 
 #include <absl/hash/hash.h>
+#include <absl/strings/str_format.h>
 
 #include <algorithm>
 #include <string>
@@ -43,10 +44,25 @@ void EncodedColorToColor(uint32_t encoded_color, orbit_client_protos::Color* col
 }
 }  // namespace
 
-ApiEventProcessor::ApiEventProcessor(CaptureListener* listener) : capture_listener_(listener) {
+ApiEventProcessor::ApiEventProcessor(
+    CaptureListener* listener, const absl::flat_hash_map<uint64_t, std::string>* interned_strings)
+    : capture_listener_(listener), interned_strings_(interned_strings) {
   ORBIT_CHECK(listener != nullptr);
 }
 
+template <typename Source>
+std::string ApiEventProcessor::DecodeName(const Source& encoded_source) const {
+  if (encoded_source.name_key() == 0) return DecodeString(encoded_source);
+
+  if (interned_strings_ != nullptr) {
+    auto it = interned_strings_->find(encoded_source.name_key());
+    if (it != interned_strings_->end()) return it->second;
+  }
+  ORBIT_ERROR_ONCE("Unknown key %u of the name of a manual instrumentation event",
+                   encoded_source.name_key());
+  return absl::StrFormat("<unknown name %u>", encoded_source.name_key());
+}
+
 void ApiEventProcessor::ProcessApiScopeStart(
     const orbit_grpc_protos::ApiScopeStart& api_scope_start) {
   synchronous_scopes_stack_by_tid_[api_scope_start.tid()].emplace_back(api_scope_start);
@@ -79,7 +95,7 @@ void ApiEventProcessor::ProcessApiScopeStop(
   timer_info.set_group_id(start_event.group_id());
   timer_info.set_address_in_function(start_event.address_in_function());
 
-  timer_info.set_api_scope_name(DecodeString(start_event));
+  timer_info.set_api_scope_name(DecodeName(start_event));
 
   capture_listener_->OnTimer(timer_info);
   event_stack.pop_back();
@@ -116,7 +132,7 @@ void ApiEventProcessor::ProcessApiScopeStopAsync(
   timer_info.set_api_async_scope_id(event_id);
   timer_info.set_address_in_function(start_event.address_in_function());
 
-  timer_info.set_api_scope_name(DecodeString(start_event));
+  timer_info.set_api_scope_name(DecodeName(start_event));
 
   capture_listener_->OnTimer(timer_info);
   asynchronous_scopes_by_id_.erase(event_id);
@@ -124,7 +140,7 @@ void ApiEventProcessor::ProcessApiScopeStopAsync(
 
 void ApiEventProcessor::ProcessApiStringEvent(
     const orbit_grpc_protos::ApiStringEvent& grpc_api_string_event) {
-  ApiStringEvent api_string_event{grpc_api_string_event.id(), DecodeString(grpc_api_string_event),
+  ApiStringEvent api_string_event{grpc_api_string_event.id(), DecodeName(grpc_api_string_event),
                                   /*should_concatenate=*/false};
   capture_listener_->OnApiStringEvent(api_string_event);
 }
@@ -133,7 +149,7 @@ void ApiEventProcessor::ProcessApiTrackDouble(
     const orbit_grpc_protos::ApiTrackDouble& grpc_api_track_double) {
   ApiTrackValue api_track_value{grpc_api_track_double.pid(), grpc_api_track_double.tid(),
                                 grpc_api_track_double.timestamp_ns(),
-                                DecodeString(grpc_api_track_double), grpc_api_track_double.data()};
+                                DecodeName(grpc_api_track_double), grpc_api_track_double.data()};
 
   capture_listener_->OnApiTrackValue(api_track_value);
 }
@@ -142,7 +158,7 @@ void ApiEventProcessor::ProcessApiTrackFloat(
     const orbit_grpc_protos::ApiTrackFloat& grpc_api_track_float) {
   ApiTrackValue api_track_value{
       grpc_api_track_float.pid(), grpc_api_track_float.tid(), grpc_api_track_float.timestamp_ns(),
-      DecodeString(grpc_api_track_float), static_cast<double>(grpc_api_track_float.data())};
+      DecodeName(grpc_api_track_float), static_cast<double>(grpc_api_track_float.data())};
 
   capture_listener_->OnApiTrackValue(api_track_value);
 }
@@ -150,7 +166,7 @@ void ApiEventProcessor::ProcessApiTrackFloat(
 void ApiEventProcessor::ProcessApiTrackInt(
     const orbit_grpc_protos::ApiTrackInt& grpc_api_track_int) {
   ApiTrackValue api_track_value{grpc_api_track_int.pid(), grpc_api_track_int.tid(),
-                                grpc_api_track_int.timestamp_ns(), DecodeString(grpc_api_track_int),
+                                grpc_api_track_int.timestamp_ns(), DecodeName(grpc_api_track_int),
                                 static_cast<double>(grpc_api_track_int.data())};
 
   capture_listener_->OnApiTrackValue(api_track_value);
@@ -160,7 +176,7 @@ void ApiEventProcessor::ProcessApiTrackInt64(
     const orbit_grpc_protos::ApiTrackInt64& grpc_api_track_int64) {
   ApiTrackValue api_track_value{
       grpc_api_track_int64.pid(), grpc_api_track_int64.tid(), grpc_api_track_int64.timestamp_ns(),
-      DecodeString(grpc_api_track_int64), static_cast<double>(grpc_api_track_int64.data())};
+      DecodeName(grpc_api_track_int64), static_cast<double>(grpc_api_track_int64.data())};
 
   capture_listener_->OnApiTrackValue(api_track_value);
 }
@@ -169,7 +185,7 @@ void ApiEventProcessor::ProcessApiTrackUint(
     const orbit_grpc_protos::ApiTrackUint& grpc_api_track_uint) {
   ApiTrackValue api_track_value{
       grpc_api_track_uint.pid(), grpc_api_track_uint.tid(), grpc_api_track_uint.timestamp_ns(),
-      DecodeString(grpc_api_track_uint), static_cast<double>(grpc_api_track_uint.data())};
+      DecodeName(grpc_api_track_uint), static_cast<double>(grpc_api_track_uint.data())};
 
   capture_listener_->OnApiTrackValue(api_track_value);
 }
@@ -178,7 +194,7 @@ void ApiEventProcessor::ProcessApiTrackUint64(
     const orbit_grpc_protos::ApiTrackUint64& grpc_api_track_uint64) {
   ApiTrackValue api_track_value{grpc_api_track_uint64.pid(), grpc_api_track_uint64.tid(),
                                 grpc_api_track_uint64.timestamp_ns(),
-                                DecodeString(grpc_api_track_uint64),
+                                DecodeName(grpc_api_track_uint64),
                                 static_cast<double>(grpc_api_track_uint64.data())};
 
   capture_listener_->OnApiTrackValue(api_track_value);
@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/container/flat_hash_map.h>
 #include <gmock/gmock.h>
 #include <google/protobuf/util/message_differencer.h>
 #include <gtest/gtest.h>
@@ -44,7 +45,7 @@ namespace {
 
 class ApiEventProcessorTest : public ::testing::Test {
  public:
-  ApiEventProcessorTest() : api_event_processor_{&capture_listener_} {}
+  ApiEventProcessorTest() : api_event_processor_{&capture_listener_, &interned_strings_} {}
 
  protected:
   void SetUp() override {}
@@ -154,6 +155,7 @@ class ApiEventProcessorTest : public ::testing::Test {
   }
 
   MockCaptureListener capture_listener_;
+  absl::flat_hash_map<uint64_t, std::string> interned_strings_;
   ApiEventProcessor api_event_processor_;
 
   static constexpr int32_t kProcessId = 42;
@@ -486,4 +488,70 @@ TEST_F(ApiEventProcessorTest, TrackUint64) {
   EXPECT_THAT(actual_track_value.value(), ApiTrackValueEq(expected_track_value));
 }
 
+TEST_F(ApiEventProcessorTest, ScopeAndTrackWithInternedNames) {
+  constexpr uint64_t kScopeNameKey = 5;
+  constexpr uint64_t kTrackNameKey = 6;
+  interned_strings_.emplace(kScopeNameKey, "Interned scope");
+  interned_strings_.emplace(kTrackNameKey, "Interned track");
+
+  orbit_grpc_protos::ApiScopeStart start;
+  start.set_timestamp_ns(1);
+  start.set_pid(kProcessId);
+  start.set_tid(kThreadId1);
+  start.set_group_id(kGroupId);
+  start.set_address_in_function(kAddressInFunction);
+  start.set_name_key(kScopeNameKey);
+  auto stop = CreateStopScope(2, kProcessId, kThreadId1);
+
+  TimerInfo actual_timer;
+  EXPECT_CALL(capture_listener_, OnTimer).Times(1).WillOnce(SaveArg<0>(&actual_timer));
+  api_event_processor_.ProcessApiScopeStart(start);
+  api_event_processor_.ProcessApiScopeStop(stop);
+
+  auto expected_timer = CreateTimerInfo(1, 2, kProcessId, kThreadId1, "Interned scope", 0,
+                                        kGroupId, 0, kAddressInFunction, TimerInfo::kApiScope);
+  EXPECT_TRUE(MessageDifferencer::Equivalent(expected_timer, actual_timer));
+
+  constexpr int32_t kValue = 3;
+  orbit_grpc_protos::ApiTrackInt track_int;
+  track_int.set_timestamp_ns(3);
+  track_int.set_pid(kProcessId);
+  track_int.set_tid(kThreadId1);
+  track_int.set_data(kValue);
+  track_int.set_name_key(kTrackNameKey);
+
+  ApiTrackValue expected_track_value{kProcessId, kThreadId1, 3, "Interned track",
+                                     static_cast<double>(kValue)};
+  std::optional<ApiTrackValue> actual_track_value;
+  EXPECT_CALL(capture_listener_, OnApiTrackValue)
+      .Times(1)
+      .WillOnce(SaveArg<0>(&actual_track_value));
+  api_event_processor_.ProcessApiTrackInt(track_int);
+
+  ASSERT_TRUE(actual_track_value.has_value());
+  EXPECT_THAT(actual_track_value.value(), ApiTrackValueEq(expected_track_value));
+}
+
+TEST_F(ApiEventProcessorTest, TrackWithUnknownInternedNameGetsPlaceholderName) {
+  constexpr uint64_t kUnknownNameKey = 17;
+  constexpr int32_t kValue = 3;
+  orbit_grpc_protos::ApiTrackInt track_int;
+  track_int.set_timestamp_ns(3);
+  track_int.set_pid(kProcessId);
+  track_int.set_tid(kThreadId1);
+  track_int.set_data(kValue);
+  track_int.set_name_key(kUnknownNameKey);
+
+  ApiTrackValue expected_track_value{kProcessId, kThreadId1, 3, "<unknown name 17>",
+                                     static_cast<double>(kValue)};
+  std::optional<ApiTrackValue> actual_track_value;
+  EXPECT_CALL(capture_listener_, OnApiTrackValue)
+      .Times(1)
+      .WillOnce(SaveArg<0>(&actual_track_value));
+  api_event_processor_.ProcessApiTrackInt(track_int);
+
+  ASSERT_TRUE(actual_track_value.has_value());
+  EXPECT_THAT(actual_track_value.value(), ApiTrackValueEq(expected_track_value));
+}
+
 }  // namespace orbit_capture_client
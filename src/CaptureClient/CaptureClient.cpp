@@ -11,7 +11,10 @@
 
 #include <algorithm>
 #include <map>
+#include <memory>
+#include <optional>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -29,6 +32,8 @@
 #include "OrbitBase/Future.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadUtils.h"
+#include "SpscQueue.h"
 
 namespace orbit_capture_client {
 
@@ -51,6 +56,12 @@ using orbit_base::Future;
 
 namespace {
 
+using CaptureResponseQueue = SpscQueue<std::shared_ptr<const CaptureResponse>>;
+
+// The number of CaptureResponses, each of which usually contains many events, that can be waiting
+// to be processed by each CaptureEventProcessor.
+constexpr size_t kCaptureResponseQueueCapacity = 64;
+
 // Api functions are declared in Orbit.h. They are implemented in user code through the
 // ORBIT_API_INSTANTIATE macro. Those functions are used to query the tracee for Orbit specific
 // information, such as the memory location where Orbit should write function pointers to enable
@@ -138,6 +149,7 @@ std::vector<ApiFunction> FindApiFunctions(const orbit_client_data::ModuleManager
     instrumented_function->set_is_hotpatchable(function.IsHotpatchable());
     instrumented_function->set_record_arguments(options.record_arguments);
     instrumented_function->set_record_return_value(options.record_return_values);
+    instrumented_function->set_aggregate_calls(options.aggregate_instrumented_calls);
   }
 
   for (const auto& [function_id, function] : options.functions_to_record_additional_stack_on) {
@@ -176,6 +188,10 @@ std::vector<ApiFunction> FindApiFunctions(const orbit_client_data::ModuleManager
   capture_options.set_thread_state_change_callstack_collection(
       options.thread_state_change_callstack_collection);
 
+  capture_options.set_ring_buffer_reader_thread_count(options.ring_buffer_reader_thread_count);
+  capture_options.set_ring_buffer_wait_method(options.ring_buffer_wait_method);
+  capture_options.set_unwinding_thread_count(options.unwinding_thread_count);
+
   return capture_options;
 }
 
@@ -187,6 +203,19 @@ orbit_base::Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> CaptureClien
     const orbit_client_data::ModuleManager& module_manager,
     const orbit_client_data::ProcessData& process_data,
     const ClientCaptureOptions& capture_options) {
+  std::vector<std::unique_ptr<CaptureEventProcessor>> capture_event_processors;
+  capture_event_processors.push_back(std::move(capture_event_processor));
+  return Capture(thread_pool, std::move(capture_event_processors), module_manager, process_data,
+                 capture_options);
+}
+
+orbit_base::Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> CaptureClient::Capture(
+    orbit_base::ThreadPool* thread_pool,
+    std::vector<std::unique_ptr<CaptureEventProcessor>> capture_event_processors,
+    const orbit_client_data::ModuleManager& module_manager,
+    const orbit_client_data::ProcessData& process_data,
+    const ClientCaptureOptions& capture_options) {
+  ORBIT_CHECK(!capture_event_processors.empty());
   absl::MutexLock lock(&state_mutex_);
   if (state_ != State::kStopped) {
     return {
@@ -197,16 +226,17 @@ orbit_base::Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> CaptureClien
   state_ = State::kStarting;
   ORBIT_LOG("State is now kStarting");
 
-  return thread_pool->Schedule([this, capture_event_processor = std::move(capture_event_processor),
-                                grpc_capture_options = ToGrpcCaptureOptions(
-                                    capture_options, module_manager, process_data)]() {
-    return CaptureSync(grpc_capture_options, capture_event_processor.get());
-  });
+  return thread_pool->Schedule(
+      [this, capture_event_processors = std::move(capture_event_processors),
+       grpc_capture_options =
+           ToGrpcCaptureOptions(capture_options, module_manager, process_data)]() {
+        return CaptureSync(grpc_capture_options, capture_event_processors);
+      });
 }
 
 ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
     orbit_grpc_protos::CaptureOptions capture_options,
-    CaptureEventProcessor* capture_event_processor) {
+    const std::vector<std::unique_ptr<CaptureEventProcessor>>& capture_event_processors) {
   ORBIT_SCOPE_FUNCTION;
   writes_done_failed_ = false;
   try_abort_ = false;
@@ -239,20 +269,59 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
   }
   ORBIT_LOG("Sent CaptureRequest on Capture's gRPC stream: asking to start capturing");
 
+  // When a processor doesn't keep up, its queue fills up and reading stops, which in turn makes
+  // gRPC flow control slow down the service.
+  std::vector<std::unique_ptr<CaptureResponseQueue>> queues;
+  std::vector<std::thread> processing_threads;
+  for (const std::unique_ptr<CaptureEventProcessor>& capture_event_processor :
+       capture_event_processors) {
+    CaptureResponseQueue* queue =
+        queues.emplace_back(std::make_unique<CaptureResponseQueue>(kCaptureResponseQueueCapacity))
+            .get();
+    processing_threads.emplace_back(
+        [queue, capture_event_processor = capture_event_processor.get()] {
+          orbit_base::SetCurrentThreadName("CaptureProcess");
+          while (std::optional<std::shared_ptr<const CaptureResponse>> response = queue->Pop()) {
+            for (const ClientCaptureEvent& event : (*response)->capture_events()) {
+              capture_event_processor->ProcessEvent(event);
+            }
+          }
+        });
+  }
+
   while (!writes_done_failed_ && !try_abort_) {
-    CaptureResponse response;
+    auto response = std::make_shared<CaptureResponse>();
     bool read_succeeded{};
     {
       absl::ReaderMutexLock lock{&context_and_stream_mutex_};
-      read_succeeded = reader_writer_->Read(&response);
+      read_succeeded = reader_writer_->Read(response.get());
     }
-    if (read_succeeded) {
-      ProcessEvents(capture_event_processor, response.capture_events());
-    } else {
-      break;
+    if (!read_succeeded) break;
+
+    UpdateStateIfCaptureStarted(response->capture_events());
+    for (const std::unique_ptr<CaptureResponseQueue>& queue : queues) {
+      queue->Push(response);
     }
   }
 
+  // Let the processors finish with all the events received.
+  for (const std::unique_ptr<CaptureResponseQueue>& queue : queues) {
+    queue->Close();
+  }
+  for (std::thread& processing_thread : processing_threads) {
+    processing_thread.join();
+  }
+  for (size_t i = 0; i < queues.size(); ++i) {
+    const SpscQueueStatistics statistics = queues[i]->GetStatistics();
+    ORBIT_LOG(
+        "CaptureResponse queue of processor %u: %u responses, up to %u queued; reading waited "
+        "%u times for %.3f s because it was full; processing waited %u times for %.3f s because it "
+        "was empty",
+        i, statistics.push_count, statistics.max_size, statistics.full_count,
+        absl::ToDoubleSeconds(statistics.producer_wait_duration), statistics.empty_count,
+        absl::ToDoubleSeconds(statistics.consumer_wait_duration));
+  }
+
   ErrorMessageOr<void> finish_result = FinishCapture();
   if (try_abort_) {
     ORBIT_LOG(
@@ -366,11 +435,9 @@ ErrorMessageOr<void> CaptureClient::FinishCapture() {
   return outcome::success();
 }
 
-void CaptureClient::ProcessEvents(
-    CaptureEventProcessor* capture_event_processor,
+void CaptureClient::UpdateStateIfCaptureStarted(
     const google::protobuf::RepeatedPtrField<ClientCaptureEvent>& events) {
   for (const auto& event : events) {
-    capture_event_processor->ProcessEvent(event);
     if (event.event_case() == ClientCaptureEvent::kCaptureStarted) {
       absl::MutexLock lock{&state_mutex_};
       state_ = State::kStarted;
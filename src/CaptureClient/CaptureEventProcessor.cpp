@@ -50,6 +50,7 @@ using orbit_grpc_protos::Callstack;
 using orbit_grpc_protos::CallstackSample;
 using orbit_grpc_protos::ClientCaptureEvent;
 using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::FunctionCallSummary;
 using orbit_grpc_protos::GpuJob;
 using orbit_grpc_protos::GpuQueueSubmission;
 using orbit_grpc_protos::InternedCallstack;
@@ -67,7 +68,7 @@ class CaptureEventProcessorForListener : public CaptureEventProcessor {
       : file_path_{std::move(file_path)},
         frame_track_function_ids_(std::move(frame_track_function_ids)),
         capture_listener_(capture_listener),
-        api_event_processor_{capture_listener} {}
+        api_event_processor_{capture_listener, &string_intern_pool_} {}
   ~CaptureEventProcessorForListener() override = default;
 
   void ProcessEvent(const orbit_grpc_protos::ClientCaptureEvent& event) override;
@@ -79,6 +80,8 @@ class CaptureEventProcessorForListener : public CaptureEventProcessor {
   void ProcessInternedCallstack(orbit_grpc_protos::InternedCallstack interned_callstack);
   void ProcessCallstackSample(const orbit_grpc_protos::CallstackSample& callstack_sample);
   void ProcessFunctionCall(const orbit_grpc_protos::FunctionCall& function_call);
+  void ProcessFunctionCallSummary(
+      const orbit_grpc_protos::FunctionCallSummary& function_call_summary);
   void ProcessInternedString(orbit_grpc_protos::InternedString interned_string);
   void ProcessModuleUpdate(orbit_grpc_protos::ModuleUpdateEvent module_update);
   void ProcessModulesSnapshot(const orbit_grpc_protos::ModulesSnapshot& modules_snapshot);
@@ -160,6 +163,9 @@ void CaptureEventProcessorForListener::ProcessEvent(const ClientCaptureEvent& ev
     case ClientCaptureEvent::kFunctionCall:
       ProcessFunctionCall(event.function_call());
       break;
+    case ClientCaptureEvent::kFunctionCallSummary:
+      ProcessFunctionCallSummary(event.function_call_summary());
+      break;
     case ClientCaptureEvent::kInternedString:
       ProcessInternedString(event.interned_string());
       break;
@@ -344,6 +350,13 @@ void CaptureEventProcessorForListener::ProcessFunctionCall(const FunctionCall& f
   capture_listener_->OnTimer(timer_info);
 }
 
+void CaptureEventProcessorForListener::ProcessFunctionCallSummary(
+    const FunctionCallSummary& function_call_summary) {
+  gpu_queue_submission_processor_.UpdateBeginCaptureTime(
+      function_call_summary.start_timestamp_ns());
+  capture_listener_->OnFunctionCallSummary(function_call_summary);
+}
+
 void CaptureEventProcessorForListener::ProcessInternedString(InternedString interned_string) {
   if (string_intern_pool_.contains(interned_string.key())) {
     ORBIT_ERROR("Overwriting InternedString with key %llu", interned_string.key());
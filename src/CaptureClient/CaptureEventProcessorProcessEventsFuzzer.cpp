@@ -70,6 +70,8 @@ class MyCaptureListener : public CaptureListener {
   void OnModulesSnapshot(uint64_t /*timestamp_ns*/,
                          std::vector<orbit_grpc_protos::ModuleInfo> /*module_infos*/) override {}
   void OnPresentEvent(const orbit_grpc_protos::PresentEvent& /*present_event*/) override {}
+  void OnFunctionCallSummary(
+      const orbit_grpc_protos::FunctionCallSummary& /*function_call_summary*/) override {}
   void OnApiStringEvent(const orbit_client_data::ApiStringEvent& /*api_string_event*/) override {}
   void OnApiTrackValue(const orbit_client_data::ApiTrackValue& /*api_track_value*/) override {}
   void OnWarningEvent(orbit_grpc_protos::WarningEvent /*warning_event*/) override {}
@@ -55,6 +55,7 @@ using orbit_grpc_protos::ErrorEnablingOrbitApiEvent;
 using orbit_grpc_protos::ErrorEnablingUserSpaceInstrumentationEvent;
 using orbit_grpc_protos::ErrorsWithPerfEventOpenEvent;
 using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::FunctionCallSummary;
 using orbit_grpc_protos::GpuCommandBuffer;
 using orbit_grpc_protos::GpuDebugMarker;
 using orbit_grpc_protos::GpuDebugMarkerBeginInfo;
@@ -136,6 +137,42 @@ TEST(CaptureEventProcessor, CanHandlePresentEvent) {
   EXPECT_EQ(actual_present_event.source(), present_event->source());
 }
 
+TEST(CaptureEventProcessor, CanHandleFunctionCallSummary) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent event;
+  FunctionCallSummary* function_call_summary = event.mutable_function_call_summary();
+  function_call_summary->set_pid(42);
+  function_call_summary->set_tid(24);
+  function_call_summary->set_function_id(7);
+  function_call_summary->set_start_timestamp_ns(100);
+  function_call_summary->set_end_timestamp_ns(200);
+  function_call_summary->set_call_count(3);
+  function_call_summary->set_total_duration_ns(60);
+  function_call_summary->add_duration_log2_histogram(3);
+
+  FunctionCallSummary actual_function_call_summary;
+  EXPECT_CALL(listener, OnFunctionCallSummary)
+      .Times(1)
+      .WillOnce(SaveArg<0>(&actual_function_call_summary));
+  event_processor->ProcessEvent(event);
+
+  EXPECT_EQ(actual_function_call_summary.pid(), function_call_summary->pid());
+  EXPECT_EQ(actual_function_call_summary.tid(), function_call_summary->tid());
+  EXPECT_EQ(actual_function_call_summary.function_id(), function_call_summary->function_id());
+  EXPECT_EQ(actual_function_call_summary.start_timestamp_ns(),
+            function_call_summary->start_timestamp_ns());
+  EXPECT_EQ(actual_function_call_summary.end_timestamp_ns(),
+            function_call_summary->end_timestamp_ns());
+  EXPECT_EQ(actual_function_call_summary.call_count(), function_call_summary->call_count());
+  EXPECT_EQ(actual_function_call_summary.total_duration_ns(),
+            function_call_summary->total_duration_ns());
+  ASSERT_EQ(actual_function_call_summary.duration_log2_histogram_size(), 1);
+  EXPECT_EQ(actual_function_call_summary.duration_log2_histogram(0), 3);
+}
+
 static InternedCallstack* AddAndInitializeInternedCallstack(ClientCaptureEvent& event) {
   InternedCallstack* interned_callstack = event.mutable_interned_callstack();
   interned_callstack->set_key(1);
@@ -0,0 +1,256 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureSectionParallelReader.h"
+
+#include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
+
+using orbit_capture_file::ProtoSectionInputStream;
+using orbit_client_protos::CaptureChunk;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace orbit_capture_client {
+
+namespace {
+
+// The reading thread hands serialized events over to the parsing threads in batches of about this
+// many bytes.
+constexpr size_t kSerializedEventBatchSize = 256 * 1024;
+// The number of batches that can be waiting to be parsed by each parsing thread, and the number of
+// parsed batches that can be waiting to be received from each parsing thread.
+constexpr size_t kEventBatchQueueCapacity = 4;
+constexpr size_t kMaxParserThreadCount = 8;
+
+[[nodiscard]] std::unique_ptr<google::protobuf::Arena> CreateArenaForBatch() {
+  // Parsed events take a few times the space of serialized ones. Start with large blocks to avoid
+  // many small allocations.
+  google::protobuf::ArenaOptions arena_options;
+  arena_options.start_block_size = kSerializedEventBatchSize;
+  arena_options.max_block_size = 4 * kSerializedEventBatchSize;
+  return std::make_unique<google::protobuf::Arena>(arena_options);
+}
+
+}  // namespace
+
+CaptureSectionParallelReader::CaptureSectionParallelReader(
+    orbit_capture_file::ProtoSectionInputStream* capture_section_input_stream,
+    size_t parser_thread_count)
+    : capture_section_input_stream_{capture_section_input_stream},
+      parse_durations_(parser_thread_count, absl::ZeroDuration()) {
+  ORBIT_CHECK(parser_thread_count > 0);
+  for (size_t i = 0; i < parser_thread_count; ++i) {
+    serialized_batch_queues_.push_back(
+        std::make_unique<SpscQueue<SerializedEventBatch>>(kEventBatchQueueCapacity));
+    parsed_batch_queues_.push_back(
+        std::make_unique<SpscQueue<ParsedEventBatch>>(kEventBatchQueueCapacity));
+  }
+  for (size_t i = 0; i < parser_thread_count; ++i) {
+    parsing_threads_.emplace_back([this, i] { Parse(i); });
+  }
+  reading_thread_ = std::thread{[this] { Read(); }};
+}
+
+CaptureSectionParallelReader::CaptureSectionParallelReader(
+    orbit_capture_file::CaptureFile* capture_file, std::vector<CaptureChunk> chunks,
+    size_t parser_thread_count)
+    : capture_file_{capture_file},
+      chunks_{std::move(chunks)},
+      chunk_bytes_read_(parser_thread_count, 0),
+      chunk_read_durations_(parser_thread_count, absl::ZeroDuration()),
+      parse_durations_(parser_thread_count, absl::ZeroDuration()) {
+  ORBIT_CHECK(capture_file_ != nullptr);
+  ORBIT_CHECK(parser_thread_count > 0);
+  for (size_t i = 0; i < parser_thread_count; ++i) {
+    parsed_batch_queues_.push_back(
+        std::make_unique<SpscQueue<ParsedEventBatch>>(kEventBatchQueueCapacity));
+  }
+  for (size_t i = 0; i < parser_thread_count; ++i) {
+    parsing_threads_.emplace_back([this, i] { ReadAndParseChunks(i); });
+  }
+}
+
+CaptureSectionParallelReader::~CaptureSectionParallelReader() {
+  if (!stopped_) Stop();
+}
+
+void CaptureSectionParallelReader::Read() {
+  orbit_base::SetCurrentThreadName("CaptureRead");
+  for (uint64_t batch_index = 0; !stop_requested_.load(std::memory_order_relaxed); ++batch_index) {
+    SerializedEventBatch batch;
+    batch.bytes.reserve(kSerializedEventBatchSize);
+    const absl::Time read_begin = absl::Now();
+    while (batch.bytes.size() < kSerializedEventBatchSize) {
+      const size_t previous_size = batch.bytes.size();
+      ErrorMessageOr<uint32_t> event_size_or_error =
+          capture_section_input_stream_->ReadMessageBytes(&batch.bytes);
+      if (event_size_or_error.has_error()) {
+        batch.bytes.resize(previous_size);
+        batch.error = event_size_or_error.error();
+        break;
+      }
+      batch.event_sizes.push_back(event_size_or_error.value());
+    }
+    read_duration_ += absl::Now() - read_begin;
+    bytes_read_ += batch.bytes.size();
+
+    const bool is_last_batch = batch.error.has_value();
+    serialized_batch_queues_[batch_index % serialized_batch_queues_.size()]->Push(
+        std::move(batch));
+    if (is_last_batch) break;
+  }
+
+  for (const std::unique_ptr<SpscQueue<SerializedEventBatch>>& queue : serialized_batch_queues_) {
+    queue->Close();
+  }
+}
+
+void CaptureSectionParallelReader::Parse(size_t parser_index) {
+  orbit_base::SetCurrentThreadName(absl::StrFormat("CaptureParse%u", parser_index).c_str());
+  SpscQueue<SerializedEventBatch>& input_queue = *serialized_batch_queues_[parser_index];
+  SpscQueue<ParsedEventBatch>& output_queue = *parsed_batch_queues_[parser_index];
+  while (std::optional<SerializedEventBatch> serialized_batch = input_queue.Pop()) {
+    const absl::Time parse_begin = absl::Now();
+    ParsedEventBatch batch = ParseBatch(std::move(serialized_batch.value()));
+    parse_durations_[parser_index] += absl::Now() - parse_begin;
+    output_queue.Push(std::move(batch));
+  }
+  output_queue.Close();
+}
+
+void CaptureSectionParallelReader::ReadAndParseChunks(size_t parser_index) {
+  orbit_base::SetCurrentThreadName(absl::StrFormat("CaptureParse%u", parser_index).c_str());
+  SpscQueue<ParsedEventBatch>& output_queue = *parsed_batch_queues_[parser_index];
+  for (size_t chunk_index = parser_index;
+       chunk_index < chunks_.size() && !stop_requested_.load(std::memory_order_relaxed);
+       chunk_index += parsed_batch_queues_.size()) {
+    const CaptureChunk& chunk = chunks_[chunk_index];
+    const absl::Time read_begin = absl::Now();
+    std::unique_ptr<ProtoSectionInputStream> chunk_input_stream =
+        capture_file_->CreateCaptureChunkInputStream(chunk.offset(), chunk.size());
+    SerializedEventBatch serialized_batch;
+    for (uint64_t i = 0; i < chunk.event_count(); ++i) {
+      const size_t previous_size = serialized_batch.bytes.size();
+      ErrorMessageOr<uint32_t> event_size_or_error =
+          chunk_input_stream->ReadMessageBytes(&serialized_batch.bytes);
+      if (event_size_or_error.has_error()) {
+        serialized_batch.bytes.resize(previous_size);
+        serialized_batch.error = event_size_or_error.error();
+        break;
+      }
+      serialized_batch.event_sizes.push_back(event_size_or_error.value());
+    }
+    chunk_read_durations_[parser_index] += absl::Now() - read_begin;
+    chunk_bytes_read_[parser_index] += serialized_batch.bytes.size();
+
+    const absl::Time parse_begin = absl::Now();
+    ParsedEventBatch batch = ParseBatch(std::move(serialized_batch));
+    parse_durations_[parser_index] += absl::Now() - parse_begin;
+    const bool is_last_batch = batch.error.has_value();
+    output_queue.Push(std::move(batch));
+    if (is_last_batch) break;
+  }
+  output_queue.Close();
+}
+
+ParsedEventBatch CaptureSectionParallelReader::ParseBatch(SerializedEventBatch serialized_batch) {
+  ParsedEventBatch batch;
+  batch.arena = CreateArenaForBatch();
+  batch.events.reserve(serialized_batch.event_sizes.size());
+  const char* event_bytes = serialized_batch.bytes.data();
+  for (uint32_t event_size : serialized_batch.event_sizes) {
+    auto* event = google::protobuf::Arena::CreateMessage<ClientCaptureEvent>(batch.arena.get());
+    // Same checks as ProtoSectionInputStream::ReadMessage.
+    if (!event->ParseFromArray(event_bytes, static_cast<int>(event_size))) {
+      batch.error =
+          ErrorMessage{absl::StrFormat("Unable to parse the message of size %d", event_size)};
+      break;
+    }
+    if (event->ByteSizeLong() != event_size) {
+      batch.error = ErrorMessage{absl::StrFormat(
+          "The message size %d of the parsed message is different from the parsed size %d",
+          event->ByteSizeLong(), event_size)};
+      break;
+    }
+    batch.events.push_back(event);
+    event_bytes += event_size;
+  }
+  if (!batch.error.has_value()) batch.error = std::move(serialized_batch.error);
+  return batch;
+}
+
+std::optional<ParsedEventBatch> CaptureSectionParallelReader::PopNextBatch() {
+  std::optional<ParsedEventBatch> batch =
+      parsed_batch_queues_[next_batch_index_ % parsed_batch_queues_.size()]->Pop();
+  ++next_batch_index_;
+  return batch;
+}
+
+ParsedEventBatch CaptureSectionParallelReader::NextBatch() {
+  ORBIT_CHECK(!stopped_);
+  std::optional<ParsedEventBatch> batch = PopNextBatch();
+  if (!batch.has_value()) {
+    // When reading the whole capture section, the queues are only closed after the last batch,
+    // which has an error. When reading chunks, this happens after the last chunk.
+    ORBIT_CHECK(capture_file_ != nullptr);
+    ParsedEventBatch end_batch;
+    end_batch.error = ErrorMessage{"Unexpected end of section after the last capture chunk"};
+    return end_batch;
+  }
+  return std::move(batch.value());
+}
+
+void CaptureSectionParallelReader::Stop() {
+  ORBIT_CHECK(!stopped_);
+  stop_requested_.store(true, std::memory_order_relaxed);
+  // The reading thread might be waiting for a parsing thread, which might in turn be waiting for
+  // its parsed batches to be received. Receive them in order until the first queue is closed, which
+  // means that reading has ended, then the rest.
+  while (PopNextBatch().has_value()) {
+  }
+  for (const std::unique_ptr<SpscQueue<ParsedEventBatch>>& queue : parsed_batch_queues_) {
+    while (queue->Pop().has_value()) {
+    }
+  }
+  if (reading_thread_.joinable()) reading_thread_.join();
+  for (std::thread& parsing_thread : parsing_threads_) {
+    parsing_thread.join();
+  }
+  stopped_ = true;
+}
+
+CaptureSectionParallelReaderStatistics CaptureSectionParallelReader::GetStatistics() const {
+  ORBIT_CHECK(stopped_);
+  CaptureSectionParallelReaderStatistics statistics;
+  statistics.bytes_read = bytes_read_;
+  statistics.read_duration = read_duration_;
+  statistics.parser_thread_count = parsing_threads_.size();
+  for (size_t i = 0; i < chunk_bytes_read_.size(); ++i) {
+    statistics.bytes_read += chunk_bytes_read_[i];
+    statistics.read_duration += chunk_read_durations_[i];
+  }
+  for (const std::unique_ptr<SpscQueue<SerializedEventBatch>>& queue : serialized_batch_queues_) {
+    statistics.read_wait_duration += queue->GetStatistics().producer_wait_duration;
+  }
+  for (size_t i = 0; i < parsing_threads_.size(); ++i) {
+    statistics.parse_duration += parse_durations_[i];
+    statistics.next_batch_wait_duration +=
+        parsed_batch_queues_[i]->GetStatistics().consumer_wait_duration;
+  }
+  return statistics;
+}
+
+size_t CaptureSectionParallelReader::GetDefaultParserThreadCount() {
+  const size_t hardware_concurrency = std::thread::hardware_concurrency();
+  return std::clamp<size_t>(hardware_concurrency > 2 ? hardware_concurrency - 2 : 1, 1,
+                            kMaxParserThreadCount);
+}
+
+}  // namespace orbit_capture_client
@@ -0,0 +1,131 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_CLIENT_CAPTURE_SECTION_PARALLEL_READER_H_
+#define CAPTURE_CLIENT_CAPTURE_SECTION_PARALLEL_READER_H_
+
+#include <absl/time/time.h>
+#include <google/protobuf/arena.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/ProtoSectionInputStream.h"
+#include "ClientProtos/capture_chunk_index.pb.h"
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Result.h"
+#include "SpscQueue.h"
+
+namespace orbit_capture_client {
+
+// Consecutive events of the capture section, in the order of the file.
+struct ParsedEventBatch {
+  // The events are allocated on this arena, which makes freeing them cheap.
+  std::unique_ptr<google::protobuf::Arena> arena;
+  std::vector<const orbit_grpc_protos::ClientCaptureEvent*> events;
+  // Reading or parsing the capture section failed after `events`, or there are no more events to
+  // read. This is the last batch.
+  std::optional<ErrorMessage> error;
+};
+
+struct CaptureSectionParallelReaderStatistics {
+  // When reading chunks, these are the sums over all parsing threads.
+  uint64_t bytes_read = 0;
+  absl::Duration read_duration = absl::ZeroDuration();
+  // How long the reading thread waited because all parsing threads were busy.
+  absl::Duration read_wait_duration = absl::ZeroDuration();
+  size_t parser_thread_count = 0;
+  // The sum over all parsing threads.
+  absl::Duration parse_duration = absl::ZeroDuration();
+  // How long the caller of NextBatch waited for the next batch to be parsed.
+  absl::Duration next_batch_wait_duration = absl::ZeroDuration();
+};
+
+// Reads the capture section from a ProtoSectionInputStream as a pipeline: one thread reads the
+// serialized events and splits them into batches, a number of threads parse the batches, and the
+// caller receives the parsed batches, in the order of the file, through NextBatch. Reading starts
+// on construction and stays ahead of the caller by a bounded number of batches.
+// Note that, as the capture section doesn't have a known end, this reads past the CaptureFinished
+// event until it encounters an error. This error is only meaningful if it comes before
+// CaptureFinished.
+// Alternatively, if the capture file has a capture chunk index, this reads a list of chunks of the
+// capture section. Then there is no reading thread: the chunks are distributed round-robin to the
+// parsing threads, each of which reads, decompresses and parses whole chunks on its own, so that
+// reading and decompressing also happen in parallel. Each chunk results in one batch.
+class CaptureSectionParallelReader {
+ public:
+  explicit CaptureSectionParallelReader(
+      orbit_capture_file::ProtoSectionInputStream* capture_section_input_stream,
+      size_t parser_thread_count);
+  // Reads `chunks`, in this order, from the capture section of `capture_file`. After the last
+  // chunk, NextBatch returns an empty batch with an error.
+  explicit CaptureSectionParallelReader(orbit_capture_file::CaptureFile* capture_file,
+                                        std::vector<orbit_client_protos::CaptureChunk> chunks,
+                                        size_t parser_thread_count);
+
+  CaptureSectionParallelReader(const CaptureSectionParallelReader&) = delete;
+  CaptureSectionParallelReader& operator=(const CaptureSectionParallelReader&) = delete;
+  CaptureSectionParallelReader(CaptureSectionParallelReader&&) = delete;
+  CaptureSectionParallelReader& operator=(CaptureSectionParallelReader&&) = delete;
+  ~CaptureSectionParallelReader();
+
+  // Blocks until the next batch is parsed. Must not be called again after a batch with an error.
+  [[nodiscard]] ParsedEventBatch NextBatch();
+
+  // Stops reading, discards the batches that have not been received, and waits for all threads.
+  void Stop();
+
+  // Only to be called after Stop.
+  [[nodiscard]] CaptureSectionParallelReaderStatistics GetStatistics() const;
+
+  // Uses all cores but one for reading and one for processing the events, up to a limit.
+  [[nodiscard]] static size_t GetDefaultParserThreadCount();
+
+ private:
+  struct SerializedEventBatch {
+    std::string bytes;
+    std::vector<uint32_t> event_sizes;
+    std::optional<ErrorMessage> error;
+  };
+
+  void Read();
+  void Parse(size_t parser_index);
+  void ReadAndParseChunks(size_t parser_index);
+  [[nodiscard]] static ParsedEventBatch ParseBatch(SerializedEventBatch serialized_batch);
+  [[nodiscard]] std::optional<ParsedEventBatch> PopNextBatch();
+
+  orbit_capture_file::ProtoSectionInputStream* capture_section_input_stream_ = nullptr;
+  orbit_capture_file::CaptureFile* capture_file_ = nullptr;
+  std::vector<orbit_client_protos::CaptureChunk> chunks_;
+
+  // Batches are distributed round-robin to the parsing threads, each of which has its own pair of
+  // queues. Receiving the parsed batches round-robin restores the order of the file.
+  std::vector<std::unique_ptr<SpscQueue<SerializedEventBatch>>> serialized_batch_queues_;
+  std::vector<std::unique_ptr<SpscQueue<ParsedEventBatch>>> parsed_batch_queues_;
+  uint64_t next_batch_index_ = 0;
+
+  std::atomic<bool> stop_requested_ = false;
+  bool stopped_ = false;
+  std::thread reading_thread_;
+  std::vector<std::thread> parsing_threads_;
+
+  // Each of these is only written by the thread it describes. When reading chunks, each parsing
+  // thread also counts what it read.
+  uint64_t bytes_read_ = 0;
+  absl::Duration read_duration_ = absl::ZeroDuration();
+  std::vector<uint64_t> chunk_bytes_read_;
+  std::vector<absl::Duration> chunk_read_durations_;
+  std::vector<absl::Duration> parse_durations_;
+};
+
+}  // namespace orbit_capture_client
+
+#endif  // CAPTURE_CLIENT_CAPTURE_SECTION_PARALLEL_READER_H_
@@ -0,0 +1,125 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "CaptureFile/ProtoSectionInputStream.h"
+#include "CaptureSectionParallelReader.h"
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_client {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+// Produces `event_count` function calls with increasing function ids, followed by an error, as if
+// the end of the section had been reached. If `invalid_event_index` is set, the event with that
+// index can't be parsed.
+class FakeCaptureSectionInputStream : public orbit_capture_file::ProtoSectionInputStream {
+ public:
+  explicit FakeCaptureSectionInputStream(
+      uint64_t event_count,
+      uint64_t invalid_event_index = std::numeric_limits<uint64_t>::max())
+      : event_count_{event_count}, invalid_event_index_{invalid_event_index} {}
+
+  ErrorMessageOr<void> ReadMessage(google::protobuf::Message* /*message*/) override {
+    ORBIT_UNREACHABLE();
+  }
+
+  ErrorMessageOr<uint32_t> ReadMessageBytes(std::string* message_bytes) override {
+    if (next_event_index_ == event_count_) return ErrorMessage{"End of section"};
+    std::string serialized_event;
+    if (next_event_index_ == invalid_event_index_) {
+      serialized_event = "\xff\xff";
+    } else {
+      ClientCaptureEvent event;
+      event.mutable_function_call()->set_function_id(next_event_index_);
+      event.mutable_function_call()->set_duration_ns(100);
+      serialized_event = event.SerializeAsString();
+    }
+    ++next_event_index_;
+    bytes_read_ += serialized_event.size();
+    message_bytes->append(serialized_event);
+    return serialized_event.size();
+  }
+
+  [[nodiscard]] uint64_t GetBytesRead() const { return bytes_read_; }
+
+ private:
+  const uint64_t event_count_;
+  const uint64_t invalid_event_index_;
+  uint64_t next_event_index_ = 0;
+  uint64_t bytes_read_ = 0;
+};
+
+}  // namespace
+
+TEST(CaptureSectionParallelReader, ReturnsAllEventsInOrderFollowedByError) {
+  constexpr uint64_t kEventCount = 200'000;
+  FakeCaptureSectionInputStream input_stream{kEventCount};
+  CaptureSectionParallelReader reader{&input_stream, /*parser_thread_count=*/3};
+
+  uint64_t next_function_id = 0;
+  while (true) {
+    ParsedEventBatch batch = reader.NextBatch();
+    for (const ClientCaptureEvent* event : batch.events) {
+      ASSERT_TRUE(event->has_function_call());
+      ASSERT_EQ(event->function_call().function_id(), next_function_id);
+      ++next_function_id;
+    }
+    if (batch.error.has_value()) {
+      EXPECT_EQ(batch.error->message(), "End of section");
+      break;
+    }
+  }
+  EXPECT_EQ(next_function_id, kEventCount);
+
+  reader.Stop();
+  CaptureSectionParallelReaderStatistics statistics = reader.GetStatistics();
+  EXPECT_EQ(statistics.bytes_read, input_stream.GetBytesRead());
+  EXPECT_EQ(statistics.parser_thread_count, 3);
+}
+
+TEST(CaptureSectionParallelReader, ReturnsEventsBeforeInvalidEventFollowedByError) {
+  constexpr uint64_t kInvalidEventIndex = 50'000;
+  FakeCaptureSectionInputStream input_stream{/*event_count=*/100'000, kInvalidEventIndex};
+  CaptureSectionParallelReader reader{&input_stream, /*parser_thread_count=*/2};
+
+  uint64_t event_count = 0;
+  while (true) {
+    ParsedEventBatch batch = reader.NextBatch();
+    event_count += batch.events.size();
+    if (batch.error.has_value()) {
+      EXPECT_NE(batch.error->message(), "End of section");
+      break;
+    }
+  }
+  EXPECT_EQ(event_count, kInvalidEventIndex);
+}
+
+TEST(CaptureSectionParallelReader, CanBeStoppedWhileReading) {
+  FakeCaptureSectionInputStream input_stream{std::numeric_limits<uint64_t>::max()};
+  CaptureSectionParallelReader reader{&input_stream, /*parser_thread_count=*/2};
+
+  ParsedEventBatch batch = reader.NextBatch();
+  EXPECT_FALSE(batch.events.empty());
+  EXPECT_FALSE(batch.error.has_value());
+  reader.Stop();
+  EXPECT_GT(reader.GetStatistics().bytes_read, 0);
+}
+
+TEST(CaptureSectionParallelReader, CanBeDestroyedWithoutStopping) {
+  FakeCaptureSectionInputStream input_stream{std::numeric_limits<uint64_t>::max()};
+  CaptureSectionParallelReader reader{&input_stream, /*parser_thread_count=*/4};
+}
+
+}  // namespace orbit_capture_client
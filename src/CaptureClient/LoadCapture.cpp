@@ -6,25 +6,66 @@
 
 #include <absl/container/flat_hash_set.h>
 #include <absl/hash/hash.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
 #include <google/protobuf/stubs/port.h>
 
 #include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <optional>
+#include <utility>
+#include <vector>
 
 #include "CaptureClient/CaptureEventProcessor.h"
+#include "CaptureFile/CaptureChunkIndex.h"
 #include "CaptureFile/CaptureFileSection.h"
 #include "CaptureFile/ProtoSectionInputStream.h"
+#include "CaptureSectionParallelReader.h"
 #include "ClientProtos/user_defined_capture_info.pb.h"
 #include "GrpcProtos/capture.pb.h"
 #include "OrbitBase/Logging.h"
 
 namespace orbit_capture_client {
 
+using orbit_client_protos::CaptureChunk;
+using orbit_client_protos::CaptureChunkIndex;
+
+namespace {
+
+// Returns std::nullopt if the capture section has to be read as a whole, because the file has no
+// capture chunk index or it can't be read.
+[[nodiscard]] std::optional<std::vector<CaptureChunk>> GetCaptureChunksToLoad(
+    orbit_capture_file::CaptureFile* capture_file, std::optional<CaptureTimeRange> time_range) {
+  ErrorMessageOr<std::optional<CaptureChunkIndex>> index_or_error =
+      orbit_capture_file::ReadCaptureChunkIndex(capture_file);
+  if (index_or_error.has_error()) {
+    ORBIT_ERROR("Reading the whole capture section: %s", index_or_error.error().message());
+    return std::nullopt;
+  }
+  std::optional<CaptureChunkIndex>& index = index_or_error.value();
+  if (!index.has_value()) return std::nullopt;
+
+  if (!time_range.has_value()) {
+    return std::vector<CaptureChunk>(std::make_move_iterator(index->mutable_chunks()->begin()),
+                                     std::make_move_iterator(index->mutable_chunks()->end()));
+  }
+  std::vector<CaptureChunk> chunks;
+  for (uint32_t chunk_index : orbit_capture_file::FindCaptureChunksToLoad(
+           index.value(), time_range->min_timestamp_ns, time_range->max_timestamp_ns)) {
+    chunks.push_back(std::move(*index->mutable_chunks(chunk_index)));
+  }
+  ORBIT_LOG("Loading %u of %u capture chunks for the time range [%u, %u]", chunks.size(),
+            index->chunks_size(), time_range->min_timestamp_ns, time_range->max_timestamp_ns);
+  return chunks;
+}
+
+}  // namespace
+
 [[nodiscard]] ErrorMessageOr<CaptureListener::CaptureOutcome> LoadCapture(
     CaptureListener* listener, orbit_capture_file::CaptureFile* capture_file,
-    std::atomic<bool>* capture_loading_cancellation_requested) {
+    std::atomic<bool>* capture_loading_cancellation_requested,
+    std::optional<CaptureTimeRange> time_range) {
   {
     ORBIT_SCOPED_TIMED_LOG("Loading capture from \"%s\"", capture_file->GetFilePath().string());
     absl::flat_hash_set<uint64_t> frame_track_function_ids;
@@ -45,18 +86,63 @@ namespace orbit_capture_client {
         CaptureEventProcessor::CreateForCaptureListener(listener, capture_file->GetFilePath(),
                                                         frame_track_function_ids);
 
-    auto capture_section_input_stream = capture_file->CreateCaptureSectionInputStream();
-    while (true) {
-      if (*capture_loading_cancellation_requested) {
-        return CaptureListener::CaptureOutcome::kCancelled;
-      }
-      orbit_grpc_protos::ClientCaptureEvent event;
-      OUTCOME_TRY(capture_section_input_stream->ReadMessage(&event));
-      capture_event_processor->ProcessEvent(event);
-      if (event.event_case() == orbit_grpc_protos::ClientCaptureEvent::kCaptureFinished) {
-        return CaptureListener::CaptureOutcome::kComplete;
-      }
+    // Reading and parsing happen on other threads, while the events are processed here, one at a
+    // time and in order, as the processor and the listener expect.
+    std::unique_ptr<orbit_capture_file::ProtoSectionInputStream> capture_section_input_stream;
+    std::unique_ptr<CaptureSectionParallelReader> reader;
+    if (std::optional<std::vector<CaptureChunk>> chunks =
+            GetCaptureChunksToLoad(capture_file, time_range);
+        chunks.has_value()) {
+      reader = std::make_unique<CaptureSectionParallelReader>(
+          capture_file, std::move(chunks.value()),
+          CaptureSectionParallelReader::GetDefaultParserThreadCount());
+    } else {
+      capture_section_input_stream = capture_file->CreateCaptureSectionInputStream();
+      reader = std::make_unique<CaptureSectionParallelReader>(
+          capture_section_input_stream.get(),
+          CaptureSectionParallelReader::GetDefaultParserThreadCount());
     }
+    uint64_t event_count = 0;
+    absl::Duration process_duration = absl::ZeroDuration();
+    const absl::Time load_begin = absl::Now();
+    ErrorMessageOr<CaptureListener::CaptureOutcome> outcome =
+        [&]() -> ErrorMessageOr<CaptureListener::CaptureOutcome> {
+      while (true) {
+        if (*capture_loading_cancellation_requested) {
+          return CaptureListener::CaptureOutcome::kCancelled;
+        }
+        ParsedEventBatch batch = reader->NextBatch();
+        const absl::Time process_begin = absl::Now();
+        for (const orbit_grpc_protos::ClientCaptureEvent* event : batch.events) {
+          capture_event_processor->ProcessEvent(*event);
+          ++event_count;
+          if (event->event_case() == orbit_grpc_protos::ClientCaptureEvent::kCaptureFinished) {
+            process_duration += absl::Now() - process_begin;
+            return CaptureListener::CaptureOutcome::kComplete;
+          }
+        }
+        process_duration += absl::Now() - process_begin;
+        if (batch.error.has_value()) return batch.error.value();
+      }
+    }();
+    const absl::Duration load_duration = absl::Now() - load_begin;
+    reader->Stop();
+
+    const CaptureSectionParallelReaderStatistics statistics = reader->GetStatistics();
+    constexpr double kBytesPerMb = 1024.0 * 1024.0;
+    ORBIT_LOG(
+        "Loaded %u events (%.1f MB) in %.3f s (%.1f MB/s). Reading took %.3f s, and waited %.3f s "
+        "for parsing. Parsing took %.3f s in total on %u threads. Processing took %.3f s, and "
+        "waited %.3f s for parsing.",
+        event_count, statistics.bytes_read / kBytesPerMb,
+        absl::ToDoubleSeconds(load_duration),
+        statistics.bytes_read / kBytesPerMb / absl::ToDoubleSeconds(load_duration),
+        absl::ToDoubleSeconds(statistics.read_duration),
+        absl::ToDoubleSeconds(statistics.read_wait_duration),
+        absl::ToDoubleSeconds(statistics.parse_duration), statistics.parser_thread_count,
+        absl::ToDoubleSeconds(process_duration),
+        absl::ToDoubleSeconds(statistics.next_batch_wait_duration));
+    return outcome;
   }
 }
 
@@ -0,0 +1,305 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CaptureClient/CaptureListener.h"
+#include "CaptureClient/LoadCapture.h"
+#include "CaptureFile/BufferOutputStream.h"
+#include "CaptureFile/CaptureChunkIndex.h"
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "GrpcProtos/capture.pb.h"
+#include "MockCaptureListener.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ReadFileToString.h"
+#include "OrbitBase/Result.h"
+#include "OrbitBase/WriteStringToFile.h"
+#include "TestUtils/TemporaryDirectory.h"
+#include "TestUtils/TestUtils.h"
+
+namespace orbit_capture_client {
+
+using orbit_capture_file::BufferOutputStream;
+using orbit_capture_file::CaptureFile;
+using orbit_capture_file::CaptureFileCompression;
+using orbit_capture_file::CaptureFileOutputStream;
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::FunctionCall;
+using orbit_test_utils::HasError;
+using orbit_test_utils::HasNoError;
+using orbit_test_utils::HasValue;
+using testing::InSequence;
+
+namespace {
+
+// Enough interned strings for the capture section to be read in several batches, and to be split
+// into several capture chunks.
+constexpr uint64_t kInternedStringCount = 200'000;
+// Enough function calls for the capture section to be split into several capture chunks.
+constexpr uint64_t kFunctionCallCount = 200'000;
+constexpr uint64_t kFunctionCallIntervalNs = 1000;
+
+class LoadCaptureTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    auto temporary_dir_or_error = orbit_test_utils::TemporaryDirectory::Create();
+    ASSERT_THAT(temporary_dir_or_error, HasNoError());
+    temporary_directory_.emplace(std::move(temporary_dir_or_error.value()));
+    capture_file_path_ = temporary_directory_->GetDirectoryPath() / "capture.orbit";
+  }
+
+  void WriteCaptureFile(bool with_capture_finished,
+                        CaptureFileCompression compression = CaptureFileCompression::kNone) {
+    auto output_stream_or_error = CaptureFileOutputStream::Create(capture_file_path_, compression);
+    ASSERT_THAT(output_stream_or_error, HasNoError());
+    WriteEvents(output_stream_or_error.value().get(), with_capture_finished);
+  }
+
+  // Files written to a buffer don't have a capture chunk index, like files before version 2.
+  void WriteCaptureFileWithoutChunkIndex() {
+    BufferOutputStream buffer_output_stream;
+    WriteEvents(CaptureFileOutputStream::Create(&buffer_output_stream).get(),
+                /*with_capture_finished=*/true);
+    const std::vector<unsigned char> buffer = buffer_output_stream.TakeBuffer();
+    ASSERT_THAT(orbit_base::WriteStringToFile(capture_file_path_,
+                                              std::string(buffer.begin(), buffer.end())),
+                HasNoError());
+  }
+
+  void WriteCaptureFileWithFunctionCalls() {
+    auto output_stream_or_error = CaptureFileOutputStream::Create(capture_file_path_);
+    ASSERT_THAT(output_stream_or_error, HasNoError());
+    std::unique_ptr<CaptureFileOutputStream> output_stream =
+        std::move(output_stream_or_error.value());
+
+    ASSERT_THAT(output_stream->WriteCaptureEvent(CreateCaptureStartedEvent()), HasNoError());
+    for (uint64_t i = 0; i < kFunctionCallCount; ++i) {
+      ClientCaptureEvent event;
+      FunctionCall* function_call = event.mutable_function_call();
+      function_call->set_pid(42);
+      function_call->set_tid(42);
+      function_call->set_function_id(1);
+      function_call->set_duration_ns(kFunctionCallIntervalNs / 2);
+      function_call->set_end_timestamp_ns((i + 1) * kFunctionCallIntervalNs);
+      ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+    }
+    ASSERT_THAT(output_stream->WriteCaptureEvent(CreateCaptureFinishedEvent()), HasNoError());
+    ASSERT_THAT(output_stream->Close(), HasNoError());
+  }
+
+  // Makes the InternedString event with `key` unparsable, without changing its size, by making the
+  // length of its string larger than the event. Only for uncompressed files.
+  void CorruptInternedString(uint64_t key) {
+    ErrorMessageOr<std::string> content_or_error =
+        orbit_base::ReadFileToString(capture_file_path_);
+    ASSERT_THAT(content_or_error, HasNoError());
+    std::string content = std::move(content_or_error.value());
+    // The string is the second field of InternedString, with tag 0x12, preceded by its length.
+    const std::string intern = std::to_string(key);
+    const std::string field = std::string{'\x12', static_cast<char>(intern.size())} + intern;
+    const size_t field_offset = content.find(field);
+    ASSERT_NE(field_offset, std::string::npos);
+    content[field_offset + 1] = '\x7f';
+    ASSERT_THAT(orbit_base::WriteStringToFile(capture_file_path_, content), HasNoError());
+  }
+
+  [[nodiscard]] ErrorMessageOr<CaptureListener::CaptureOutcome> LoadCaptureFile(
+      CaptureListener* listener, bool cancellation_requested = false,
+      std::optional<CaptureTimeRange> time_range = std::nullopt) {
+    OUTCOME_TRY(std::unique_ptr<CaptureFile> capture_file,
+                CaptureFile::OpenForReadWrite(capture_file_path_));
+    std::atomic<bool> capture_loading_cancellation_requested = cancellation_requested;
+    return LoadCapture(listener, capture_file.get(), &capture_loading_cancellation_requested,
+                       time_range);
+  }
+
+  [[nodiscard]] size_t GetCaptureChunkCount() const {
+    auto capture_file_or_error = CaptureFile::OpenForReadWrite(capture_file_path_);
+    ORBIT_CHECK(capture_file_or_error.has_value());
+    auto index_or_error =
+        orbit_capture_file::ReadCaptureChunkIndex(capture_file_or_error.value().get());
+    ORBIT_CHECK(index_or_error.has_value());
+    if (!index_or_error.value().has_value()) return 0;
+    return index_or_error.value()->chunks_size();
+  }
+
+ private:
+  [[nodiscard]] static ClientCaptureEvent CreateCaptureStartedEvent() {
+    ClientCaptureEvent capture_started;
+    capture_started.mutable_capture_started()->set_process_id(42);
+    return capture_started;
+  }
+
+  [[nodiscard]] static ClientCaptureEvent CreateCaptureFinishedEvent() {
+    ClientCaptureEvent capture_finished;
+    capture_finished.mutable_capture_finished()->set_status(
+        orbit_grpc_protos::CaptureFinished::kSuccessful);
+    return capture_finished;
+  }
+
+  static void WriteEvents(CaptureFileOutputStream* output_stream, bool with_capture_finished) {
+    ASSERT_THAT(output_stream->WriteCaptureEvent(CreateCaptureStartedEvent()), HasNoError());
+    for (uint64_t key = 0; key < kInternedStringCount; ++key) {
+      ClientCaptureEvent event;
+      event.mutable_interned_string()->set_key(key);
+      event.mutable_interned_string()->set_intern(std::to_string(key));
+      ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+    }
+    if (with_capture_finished) {
+      ASSERT_THAT(output_stream->WriteCaptureEvent(CreateCaptureFinishedEvent()), HasNoError());
+    }
+    ASSERT_THAT(output_stream->Close(), HasNoError());
+  }
+
+  std::optional<orbit_test_utils::TemporaryDirectory> temporary_directory_;
+  std::filesystem::path capture_file_path_;
+};
+
+}  // namespace
+
+TEST_F(LoadCaptureTest, ProcessesAllEventsInOrder) {
+  WriteCaptureFile(/*with_capture_finished=*/true);
+  ASSERT_GT(GetCaptureChunkCount(), 1);
+
+  MockCaptureListener listener;
+  uint64_t next_key = 0;
+  {
+    InSequence sequence;
+    EXPECT_CALL(listener, OnCaptureStarted).Times(1);
+    EXPECT_CALL(listener, OnKeyAndString)
+        .Times(kInternedStringCount)
+        .WillRepeatedly([&next_key](uint64_t key, const std::string& str) {
+          EXPECT_EQ(key, next_key);
+          EXPECT_EQ(str, std::to_string(key));
+          ++next_key;
+        });
+    EXPECT_CALL(listener, OnCaptureFinished).Times(1);
+  }
+
+  EXPECT_THAT(LoadCaptureFile(&listener), HasValue(CaptureListener::CaptureOutcome::kComplete));
+}
+
+TEST_F(LoadCaptureTest, ProcessesAllEventsOfCompressedCaptureInOrder) {
+  WriteCaptureFile(/*with_capture_finished=*/true, CaptureFileCompression::kFast);
+  ASSERT_GT(GetCaptureChunkCount(), 1);
+
+  MockCaptureListener listener;
+  uint64_t next_key = 0;
+  {
+    InSequence sequence;
+    EXPECT_CALL(listener, OnCaptureStarted).Times(1);
+    EXPECT_CALL(listener, OnKeyAndString)
+        .Times(kInternedStringCount)
+        .WillRepeatedly([&next_key](uint64_t key, const std::string& str) {
+          EXPECT_EQ(key, next_key);
+          EXPECT_EQ(str, std::to_string(key));
+          ++next_key;
+        });
+    EXPECT_CALL(listener, OnCaptureFinished).Times(1);
+  }
+
+  EXPECT_THAT(LoadCaptureFile(&listener), HasValue(CaptureListener::CaptureOutcome::kComplete));
+}
+
+TEST_F(LoadCaptureTest, ProcessesAllEventsOfCaptureWithoutChunkIndexInOrder) {
+  WriteCaptureFileWithoutChunkIndex();
+  ASSERT_EQ(GetCaptureChunkCount(), 0);
+
+  MockCaptureListener listener;
+  uint64_t next_key = 0;
+  {
+    InSequence sequence;
+    EXPECT_CALL(listener, OnCaptureStarted).Times(1);
+    EXPECT_CALL(listener, OnKeyAndString)
+        .Times(kInternedStringCount)
+        .WillRepeatedly([&next_key](uint64_t key, const std::string& str) {
+          EXPECT_EQ(key, next_key);
+          EXPECT_EQ(str, std::to_string(key));
+          ++next_key;
+        });
+    EXPECT_CALL(listener, OnCaptureFinished).Times(1);
+  }
+
+  EXPECT_THAT(LoadCaptureFile(&listener), HasValue(CaptureListener::CaptureOutcome::kComplete));
+}
+
+TEST_F(LoadCaptureTest, OnlyLoadsChunksNeededForTimeRange) {
+  WriteCaptureFileWithFunctionCalls();
+  ASSERT_GT(GetCaptureChunkCount(), 2);
+
+  MockCaptureListener listener;
+  std::vector<uint64_t> timer_ends;
+  {
+    InSequence sequence;
+    EXPECT_CALL(listener, OnCaptureStarted).Times(1);
+    EXPECT_CALL(listener, OnTimer)
+        .WillRepeatedly([&timer_ends](const orbit_client_protos::TimerInfo& timer_info) {
+          timer_ends.push_back(timer_info.end());
+        });
+    EXPECT_CALL(listener, OnCaptureFinished).Times(1);
+  }
+
+  // Only the first chunk has function calls in this range. The last one is loaded as well, as it
+  // contains the CaptureFinished event.
+  constexpr CaptureTimeRange kTimeRange{0, 10 * kFunctionCallIntervalNs};
+  EXPECT_THAT(LoadCaptureFile(&listener, /*cancellation_requested=*/false, kTimeRange),
+              HasValue(CaptureListener::CaptureOutcome::kComplete));
+
+  EXPECT_LT(timer_ends.size(), kFunctionCallCount);
+  ASSERT_GE(timer_ends.size(), 10);
+  for (uint64_t i = 0; i < 10; ++i) {
+    EXPECT_EQ(timer_ends[i], (i + 1) * kFunctionCallIntervalNs);
+  }
+  for (size_t i = 1; i < timer_ends.size(); ++i) {
+    EXPECT_LT(timer_ends[i - 1], timer_ends[i]);
+  }
+}
+
+TEST_F(LoadCaptureTest, ReturnsErrorIfCaptureFinishedIsMissing) {
+  WriteCaptureFile(/*with_capture_finished=*/false);
+
+  MockCaptureListener listener;
+  EXPECT_CALL(listener, OnCaptureStarted).Times(1);
+  EXPECT_CALL(listener, OnKeyAndString).Times(kInternedStringCount);
+  EXPECT_CALL(listener, OnCaptureFinished).Times(0);
+
+  EXPECT_THAT(LoadCaptureFile(&listener), HasError("Unexpected end of section"));
+}
+
+TEST_F(LoadCaptureTest, ReturnsErrorIfAnEventCannotBeParsed) {
+  WriteCaptureFile(/*with_capture_finished=*/true);
+  CorruptInternedString(kInternedStringCount / 2);
+
+  MockCaptureListener listener;
+  EXPECT_CALL(listener, OnCaptureStarted).Times(1);
+  EXPECT_CALL(listener, OnKeyAndString).Times(kInternedStringCount / 2);
+  EXPECT_CALL(listener, OnCaptureFinished).Times(0);
+
+  EXPECT_THAT(LoadCaptureFile(&listener), HasError("Unable to parse the message"));
+}
+
+TEST_F(LoadCaptureTest, CanBeCancelled) {
+  WriteCaptureFile(/*with_capture_finished=*/true);
+
+  MockCaptureListener listener;
+  EXPECT_CALL(listener, OnCaptureStarted).Times(0);
+  EXPECT_CALL(listener, OnKeyAndString).Times(0);
+  EXPECT_CALL(listener, OnCaptureFinished).Times(0);
+
+  EXPECT_THAT(LoadCaptureFile(&listener, /*cancellation_requested=*/true),
+              HasValue(CaptureListener::CaptureOutcome::kCancelled));
+}
+
+}  // namespace orbit_capture_client
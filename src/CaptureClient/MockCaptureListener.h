@@ -36,6 +36,8 @@ class MockCaptureListener : public CaptureListener {
   MOCK_METHOD(void, OnModulesSnapshot, (uint64_t, std::vector<orbit_grpc_protos::ModuleInfo>),
               (override));
   MOCK_METHOD(void, OnPresentEvent, (const orbit_grpc_protos::PresentEvent&), (override));
+  MOCK_METHOD(void, OnFunctionCallSummary, (const orbit_grpc_protos::FunctionCallSummary&),
+              (override));
   MOCK_METHOD(void, OnApiStringEvent, (const orbit_client_data::ApiStringEvent&), (override));
   MOCK_METHOD(void, OnApiTrackValue, (const orbit_client_data::ApiTrackValue&), (override));
   MOCK_METHOD(void, OnWarningEvent, (orbit_grpc_protos::WarningEvent), (override));
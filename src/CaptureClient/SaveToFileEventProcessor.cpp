@@ -16,6 +16,7 @@
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
 
+using orbit_capture_file::CaptureFileCompression;
 using orbit_capture_file::CaptureFileOutputStream;
 using orbit_client_protos::UserDefinedCaptureInfo;
 using orbit_grpc_protos::ClientCaptureEvent;
@@ -27,9 +28,11 @@ namespace {
 class SaveToFileEventProcessor : public CaptureEventProcessor {
  public:
   explicit SaveToFileEventProcessor(std::filesystem::path file_path,
-                                    std::function<void(const ErrorMessage&)> error_handler)
+                                    std::function<void(const ErrorMessage&)> error_handler,
+                                    CaptureFileCompression compression)
       : file_path_{std::move(file_path)},
         error_handler_{std::move(error_handler)},
+        compression_{compression},
         state_{State::kProcessing} {}
   ~SaveToFileEventProcessor() override = default;
 
@@ -47,12 +50,13 @@ class SaveToFileEventProcessor : public CaptureEventProcessor {
 
   std::filesystem::path file_path_;
   std::function<void(const ErrorMessage&)> error_handler_;
+  CaptureFileCompression compression_;
   std::unique_ptr<CaptureFileOutputStream> output_stream_;
   State state_;
 };
 
 ErrorMessageOr<void> SaveToFileEventProcessor::Initialize() {
-  auto stream_or_error = CaptureFileOutputStream::Create(file_path_);
+  auto stream_or_error = CaptureFileOutputStream::Create(file_path_, compression_);
   if (stream_or_error.has_error()) {
     return ErrorMessage{absl::StrFormat("Failed to initialize CaptureSaveToFileProcessor: %s",
                                         stream_or_error.error().message())};
@@ -102,9 +106,10 @@ void SaveToFileEventProcessor::ProcessEvent(const ClientCaptureEvent& event) {
 
 ErrorMessageOr<std::unique_ptr<CaptureEventProcessor>>
 CaptureEventProcessor::CreateSaveToFileProcessor(
-    const std::filesystem::path& file_path,
-    std::function<void(const ErrorMessage&)> error_handler) {
-  auto processor = std::make_unique<SaveToFileEventProcessor>(file_path, std::move(error_handler));
+    const std::filesystem::path& file_path, std::function<void(const ErrorMessage&)> error_handler,
+    CaptureFileCompression compression) {
+  auto processor =
+      std::make_unique<SaveToFileEventProcessor>(file_path, std::move(error_handler), compression);
   auto init_or_error = processor->Initialize();
   if (init_or_error.has_error()) {
     return init_or_error.error();
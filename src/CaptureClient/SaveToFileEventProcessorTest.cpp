@@ -12,11 +12,18 @@
 #include <filesystem>
 #include <memory>
 #include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
+#ifdef __linux
+#include <signal.h>
+#include <sys/resource.h>
+#endif
+
 #include "CaptureClient/CaptureEventProcessor.h"
 #include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
 #include "CaptureFile/CaptureFileSection.h"
 #include "CaptureFile/ProtoSectionInputStream.h"
 #include "GrpcProtos/capture.pb.h"
@@ -108,11 +115,98 @@ TEST(SaveToFileEventProcessor, SaveAndLoadSimpleCapture) {
   }
 
   const auto& sections = capture_file->GetSectionList();
-  EXPECT_EQ(sections.size(), 0);
+  ASSERT_EQ(sections.size(), 1);
+  EXPECT_EQ(sections[0].type, orbit_capture_file::kSectionTypeCaptureChunkIndex);
 
   std::optional<size_t> user_data_section =
       capture_file->FindSectionByType(orbit_capture_file::kSectionTypeUserData);
   EXPECT_FALSE(user_data_section.has_value());
 }
 
+TEST(SaveToFileEventProcessor, SavesCompressedCapture) {
+  auto temporary_dir_or_error = TemporaryDirectory::Create();
+  ASSERT_TRUE(temporary_dir_or_error.has_value()) << temporary_dir_or_error.error().message();
+  TemporaryDirectory temporary_dir = std::move(temporary_dir_or_error.value());
+
+  auto error_handler = [](const ErrorMessage& error) { FAIL() << error.message(); };
+
+  std::filesystem::path capture_file_path = temporary_dir.GetDirectoryPath() / "capture.orbit";
+  auto capture_event_processor_or_error = CaptureEventProcessor::CreateSaveToFileProcessor(
+      capture_file_path, error_handler, orbit_capture_file::CaptureFileCompression::kFast);
+  ASSERT_TRUE(capture_event_processor_or_error.has_value())
+      << capture_event_processor_or_error.error().message();
+
+  std::unique_ptr<CaptureEventProcessor> capture_event_processor =
+      std::move(capture_event_processor_or_error.value());
+  capture_event_processor->ProcessEvent(CreateInternedStringEvent(1, "1"));
+  capture_event_processor->ProcessEvent(CreateCaptureFinishedEvent());
+
+  capture_event_processor.reset();
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(capture_file_path);
+  ASSERT_THAT(capture_file_or_error, HasValue());
+  auto capture_file = std::move(capture_file_or_error.value());
+  EXPECT_EQ(capture_file->GetCaptureSectionCompression(),
+            orbit_capture_file::CaptureSectionCompression::kZlib);
+
+  auto capture_section_input_stream = capture_file->CreateCaptureSectionInputStream();
+
+  {
+    ClientCaptureEvent event;
+    ASSERT_THAT(capture_section_input_stream->ReadMessage(&event), HasNoError());
+    ASSERT_EQ(event.event_case(), ClientCaptureEvent::kInternedString);
+    EXPECT_EQ(event.interned_string().key(), 1);
+    EXPECT_EQ(event.interned_string().intern(), "1");
+  }
+
+  {
+    ClientCaptureEvent event;
+    ASSERT_THAT(capture_section_input_stream->ReadMessage(&event), HasNoError());
+    ASSERT_EQ(event.event_case(), ClientCaptureEvent::kCaptureFinished);
+  }
+}
+
+#ifdef __linux
+TEST(SaveToFileEventProcessor, ReportsErrorOnceWhenWritingFailsEarly) {
+  auto temporary_dir_or_error = TemporaryDirectory::Create();
+  ASSERT_TRUE(temporary_dir_or_error.has_value()) << temporary_dir_or_error.error().message();
+  TemporaryDirectory temporary_dir = std::move(temporary_dir_or_error.value());
+
+  int error_count = 0;
+  auto error_handler = [&error_count](const ErrorMessage& /*error*/) { ++error_count; };
+
+  std::filesystem::path capture_file_path = temporary_dir.GetDirectoryPath() / "capture.orbit";
+  auto capture_event_processor_or_error =
+      CaptureEventProcessor::CreateSaveToFileProcessor(capture_file_path, error_handler);
+  ASSERT_TRUE(capture_event_processor_or_error.has_value())
+      << capture_event_processor_or_error.error().message();
+  std::unique_ptr<CaptureEventProcessor> capture_event_processor =
+      std::move(capture_event_processor_or_error.value());
+
+  // Make every write to the file fail with EFBIG, including the one of the buffered header, so that
+  // the first event large enough to flush the buffer fails.
+  struct rlimit original_file_size_limit {};
+  ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &original_file_size_limit), 0);
+  struct rlimit file_size_limit = original_file_size_limit;
+  file_size_limit.rlim_cur = 0;
+  sighandler_t original_sigxfsz_handler = signal(SIGXFSZ, SIG_IGN);
+  ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &file_size_limit), 0);
+
+  ClientCaptureEvent capture_started;
+  capture_started.mutable_capture_started()->set_process_id(42);
+  capture_event_processor->ProcessEvent(capture_started);
+  const std::string large_string(1024 * 1024, 'a');
+  capture_event_processor->ProcessEvent(CreateInternedStringEvent(1, large_string.c_str()));
+  capture_event_processor->ProcessEvent(CreateInternedStringEvent(2, "2"));
+  capture_event_processor->ProcessEvent(CreateCaptureFinishedEvent());
+  capture_event_processor.reset();
+
+  EXPECT_EQ(setrlimit(RLIMIT_FSIZE, &original_file_size_limit), 0);
+  signal(SIGXFSZ, original_sigxfsz_handler);
+
+  EXPECT_EQ(error_count, 1);
+  EXPECT_FALSE(std::filesystem::exists(capture_file_path));
+}
+#endif
+
 }  // namespace orbit_capture_client
\ No newline at end of file
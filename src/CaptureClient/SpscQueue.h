@@ -0,0 +1,165 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_CLIENT_SPSC_QUEUE_H_
+#define CAPTURE_CLIENT_SPSC_QUEUE_H_
+
+#include <absl/base/optimization.h>
+#include <absl/synchronization/mutex.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_capture_client {
+
+// Statistics about how a SpscQueue was used, to find out which side, if any, is holding the other
+// back. Only meaningful once both the producer and the consumer are done with the queue.
+struct SpscQueueStatistics {
+  uint64_t push_count = 0;
+  // How many times, and for how long in total, the producer had to wait for the consumer because
+  // the queue was full. This is the backpressure the consumer exerts on the producer.
+  uint64_t full_count = 0;
+  absl::Duration producer_wait_duration = absl::ZeroDuration();
+  // How many times, and for how long in total, the consumer had to wait because the queue was
+  // empty.
+  uint64_t empty_count = 0;
+  absl::Duration consumer_wait_duration = absl::ZeroDuration();
+  size_t max_size = 0;
+};
+
+// A bounded queue to hand elements over from one producer thread to one consumer thread.
+// Push and Pop don't take any lock as long as the queue is neither full nor empty. Only then, the
+// producer or the consumer goes to sleep on a mutex until the other side has made progress.
+// The producer calls Close after its last Push. Pop then returns std::nullopt once the consumer has
+// received all the elements.
+template <typename T>
+class SpscQueue {
+ public:
+  explicit SpscQueue(size_t capacity)
+      : capacity_{capacity}, elements_{std::make_unique<std::optional<T>[]>(capacity)} {
+    ORBIT_CHECK(capacity > 0);
+  }
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+  SpscQueue(SpscQueue&&) = delete;
+  SpscQueue& operator=(SpscQueue&&) = delete;
+  ~SpscQueue() = default;
+
+  // Only to be called by the producer. Blocks while the queue is full.
+  void Push(T element) {
+    ORBIT_CHECK(!closed_.load(std::memory_order_relaxed));
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (ABSL_PREDICT_FALSE(tail - head_.load(std::memory_order_acquire) == capacity_)) {
+      ++full_count_;
+      const absl::Time wait_begin = absl::Now();
+      WaitUntil(&producer_waiting_, [this, tail] {
+        return tail - head_.load(std::memory_order_acquire) < capacity_;
+      });
+      producer_wait_duration_ += absl::Now() - wait_begin;
+    }
+
+    elements_[tail % capacity_].emplace(std::move(element));
+    tail_.store(tail + 1, std::memory_order_release);
+    ++push_count_;
+    max_size_ = std::max<size_t>(max_size_, tail + 1 - head_.load(std::memory_order_relaxed));
+    WakeUpIfWaiting(&consumer_waiting_);
+  }
+
+  // Only to be called by the producer, after the last call to Push.
+  void Close() {
+    closed_.store(true, std::memory_order_release);
+    // Always wake up the consumer, which might be waiting for an element that will never come.
+    absl::MutexLock lock{&mutex_};
+  }
+
+  // Only to be called by the consumer. Blocks while the queue is empty, and returns std::nullopt
+  // when the queue is empty and closed.
+  [[nodiscard]] std::optional<T> Pop() {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (ABSL_PREDICT_FALSE(tail_.load(std::memory_order_acquire) == head)) {
+      ++empty_count_;
+      const absl::Time wait_begin = absl::Now();
+      WaitUntil(&consumer_waiting_, [this, head] {
+        return tail_.load(std::memory_order_acquire) != head ||
+               closed_.load(std::memory_order_acquire);
+      });
+      consumer_wait_duration_ += absl::Now() - wait_begin;
+      // The producer could have pushed its last elements just before closing the queue.
+      if (tail_.load(std::memory_order_acquire) == head) return std::nullopt;
+    }
+
+    std::optional<T>& slot = elements_[head % capacity_];
+    std::optional<T> element = std::move(slot);
+    slot.reset();
+    head_.store(head + 1, std::memory_order_release);
+    WakeUpIfWaiting(&producer_waiting_);
+    return element;
+  }
+
+  // Only to be called once the producer and the consumer are done with the queue.
+  [[nodiscard]] SpscQueueStatistics GetStatistics() const {
+    SpscQueueStatistics statistics;
+    statistics.push_count = push_count_;
+    statistics.full_count = full_count_;
+    statistics.producer_wait_duration = producer_wait_duration_;
+    statistics.empty_count = empty_count_;
+    statistics.consumer_wait_duration = consumer_wait_duration_;
+    statistics.max_size = max_size_;
+    return statistics;
+  }
+
+ private:
+  template <typename Predicate>
+  void WaitUntil(std::atomic<bool>* waiting, Predicate predicate) {
+    waiting->store(true, std::memory_order_relaxed);
+    // Pairs with the fence in WakeUpIfWaiting: either the other side sees that we are waiting, or
+    // we see the progress it made when evaluating the predicate.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    absl::MutexLock lock{&mutex_};
+    mutex_.Await(absl::Condition(&predicate));
+    waiting->store(false, std::memory_order_relaxed);
+  }
+
+  void WakeUpIfWaiting(std::atomic<bool>* waiting) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting->load(std::memory_order_relaxed)) {
+      // Releasing the mutex makes the waiting thread evaluate its condition again.
+      absl::MutexLock lock{&mutex_};
+    }
+  }
+
+  const size_t capacity_;
+  std::unique_ptr<std::optional<T>[]> elements_;
+
+  // The state of the consumer and the state of the producer are on separate cache lines, as they
+  // are written at every Pop and Push, respectively.
+  alignas(ABSL_CACHELINE_SIZE) std::atomic<uint64_t> head_{0};
+  std::atomic<bool> consumer_waiting_{false};
+  uint64_t empty_count_ = 0;
+  absl::Duration consumer_wait_duration_ = absl::ZeroDuration();
+
+  alignas(ABSL_CACHELINE_SIZE) std::atomic<uint64_t> tail_{0};
+  std::atomic<bool> producer_waiting_{false};
+  std::atomic<bool> closed_{false};
+  uint64_t push_count_ = 0;
+  uint64_t full_count_ = 0;
+  absl::Duration producer_wait_duration_ = absl::ZeroDuration();
+  size_t max_size_ = 0;
+
+  absl::Mutex mutex_;
+};
+
+}  // namespace orbit_capture_client
+
+#endif  // CAPTURE_CLIENT_SPSC_QUEUE_H_
@@ -0,0 +1,116 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/notification.h>
+#include <absl/time/time.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "SpscQueue.h"
+
+namespace orbit_capture_client {
+
+TEST(SpscQueue, PopReturnsPushedElementsInOrderThenNulloptWhenClosed) {
+  SpscQueue<std::unique_ptr<int>> queue{4};
+  queue.Push(std::make_unique<int>(1));
+  queue.Push(std::make_unique<int>(2));
+  queue.Close();
+
+  std::optional<std::unique_ptr<int>> element = queue.Pop();
+  ASSERT_TRUE(element.has_value());
+  EXPECT_EQ(**element, 1);
+  element = queue.Pop();
+  ASSERT_TRUE(element.has_value());
+  EXPECT_EQ(**element, 2);
+  EXPECT_FALSE(queue.Pop().has_value());
+  EXPECT_FALSE(queue.Pop().has_value());
+
+  SpscQueueStatistics statistics = queue.GetStatistics();
+  EXPECT_EQ(statistics.push_count, 2);
+  EXPECT_EQ(statistics.max_size, 2);
+  EXPECT_EQ(statistics.full_count, 0);
+}
+
+TEST(SpscQueue, PushBlocksWhileFull) {
+  SpscQueue<int> queue{2};
+  queue.Push(0);
+  queue.Push(1);
+
+  std::atomic<bool> third_push_done = false;
+  std::thread producer{[&queue, &third_push_done] {
+    queue.Push(2);
+    third_push_done = true;
+    queue.Close();
+  }};
+
+  absl::SleepFor(absl::Milliseconds(50));
+  EXPECT_FALSE(third_push_done);
+  EXPECT_EQ(queue.Pop(), 0);
+  producer.join();
+  EXPECT_TRUE(third_push_done);
+  EXPECT_EQ(queue.Pop(), 1);
+  EXPECT_EQ(queue.Pop(), 2);
+  EXPECT_EQ(queue.Pop(), std::nullopt);
+
+  SpscQueueStatistics statistics = queue.GetStatistics();
+  EXPECT_EQ(statistics.push_count, 3);
+  EXPECT_EQ(statistics.max_size, 2);
+  EXPECT_EQ(statistics.full_count, 1);
+  EXPECT_GT(statistics.producer_wait_duration, absl::ZeroDuration());
+}
+
+TEST(SpscQueue, PopBlocksWhileEmptyAndNotClosed) {
+  SpscQueue<int> queue{2};
+  absl::Notification pop_done;
+  std::optional<int> popped_element;
+  std::thread consumer{[&queue, &pop_done, &popped_element] {
+    popped_element = queue.Pop();
+    pop_done.Notify();
+  }};
+
+  EXPECT_FALSE(pop_done.WaitForNotificationWithTimeout(absl::Milliseconds(50)));
+  queue.Push(42);
+  consumer.join();
+  EXPECT_EQ(popped_element, 42);
+
+  consumer = std::thread{[&queue, &popped_element] { popped_element = queue.Pop(); }};
+  queue.Close();
+  consumer.join();
+  EXPECT_EQ(popped_element, std::nullopt);
+
+  EXPECT_EQ(queue.GetStatistics().empty_count, 2);
+}
+
+TEST(SpscQueue, HandsOverAllElementsInOrderBetweenThreads) {
+  constexpr int kElementCount = 1'000'000;
+  SpscQueue<int> queue{16};
+
+  std::vector<int> popped_elements;
+  popped_elements.reserve(kElementCount);
+  std::thread consumer{[&queue, &popped_elements] {
+    while (std::optional<int> element = queue.Pop()) {
+      popped_elements.push_back(*element);
+    }
+  }};
+  for (int i = 0; i < kElementCount; ++i) {
+    queue.Push(i);
+  }
+  queue.Close();
+  consumer.join();
+
+  ASSERT_EQ(popped_elements.size(), kElementCount);
+  for (int i = 0; i < kElementCount; ++i) {
+    ASSERT_EQ(popped_elements[i], i);
+  }
+  SpscQueueStatistics statistics = queue.GetStatistics();
+  EXPECT_EQ(statistics.push_count, kElementCount);
+  EXPECT_LE(statistics.max_size, 16);
+}
+
+}  // namespace orbit_capture_client
@@ -27,6 +27,11 @@ class AbstractCaptureListener : public CaptureListener {
 
   ~AbstractCaptureListener() override = default;
 
+  void OnFunctionCallSummary(
+      const orbit_grpc_protos::FunctionCallSummary& function_call_summary) override {
+    GetMutableCaptureDataFromDerived().AddFunctionCallSummary(function_call_summary);
+  }
+
   void OnAddressInfo(orbit_client_data::LinuxAddressInfo address_info) override {
     GetMutableCaptureDataFromDerived().InsertAddressInfo(std::move(address_info));
   }
@@ -8,6 +8,7 @@
 #include <absl/container/flat_hash_map.h>
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "CaptureClient/CaptureListener.h"
@@ -22,7 +23,11 @@ namespace orbit_capture_client {
 // however, they are translated to TimerInfo objects that are directly passed to the listener.
 class ApiEventProcessor {
  public:
-  explicit ApiEventProcessor(CaptureListener* listener);
+  // `interned_strings` resolves the names that the producer interned, see `ApiScopeStart.name_key`.
+  // It is not owned and can be null if names are never interned.
+  explicit ApiEventProcessor(
+      CaptureListener* listener,
+      const absl::flat_hash_map<uint64_t, std::string>* interned_strings = nullptr);
 
   void ProcessApiScopeStart(const orbit_grpc_protos::ApiScopeStart& api_scope_start);
   void ProcessApiScopeStartAsync(
@@ -39,7 +44,11 @@ class ApiEventProcessor {
   void ProcessApiTrackUint64(const orbit_grpc_protos::ApiTrackUint64& grpc_api_track_uint64);
 
  private:
+  template <typename Source>
+  [[nodiscard]] std::string DecodeName(const Source& encoded_source) const;
+
   CaptureListener* capture_listener_ = nullptr;
+  const absl::flat_hash_map<uint64_t, std::string>* interned_strings_ = nullptr;
   absl::flat_hash_map<int32_t, std::vector<orbit_grpc_protos::ApiScopeStart>>
       synchronous_scopes_stack_by_tid_;
   absl::flat_hash_map<uint64_t, orbit_grpc_protos::ApiScopeStartAsync> asynchronous_scopes_by_id_;
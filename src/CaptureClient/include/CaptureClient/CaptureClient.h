@@ -14,6 +14,7 @@
 
 #include <atomic>
 #include <memory>
+#include <vector>
 
 #include "CaptureClient/CaptureEventProcessor.h"
 #include "CaptureClient/CaptureListener.h"
@@ -43,6 +44,17 @@ class CaptureClient {
       const orbit_client_data::ProcessData& process_data,
       const ClientCaptureOptions& capture_options);
 
+  // The responses of the service are read from the gRPC stream on one thread, and handed over to
+  // each of the `capture_event_processors` on a dedicated thread, through a bounded queue. This
+  // way, the processors run in parallel with each other and with reading. Each processor receives
+  // all the events, in order.
+  orbit_base::Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> Capture(
+      orbit_base::ThreadPool* thread_pool,
+      std::vector<std::unique_ptr<CaptureEventProcessor>> capture_event_processors,
+      const orbit_client_data::ModuleManager& module_manager,
+      const orbit_client_data::ProcessData& process_data,
+      const ClientCaptureOptions& capture_options);
+
   // Returns true if stop was initiated and false otherwise.
   // The latter can happen if for example the stop was already
   // initiated.
@@ -66,10 +78,9 @@ class CaptureClient {
  private:
   ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureSync(
       orbit_grpc_protos::CaptureOptions capture_options,
-      CaptureEventProcessor* capture_event_processor);
+      const std::vector<std::unique_ptr<CaptureEventProcessor>>& capture_event_processors);
 
-  void ProcessEvents(
-      CaptureEventProcessor* capture_event_processor,
+  void UpdateStateIfCaptureStarted(
       const google::protobuf::RepeatedPtrField<orbit_grpc_protos::ClientCaptureEvent>& events);
 
   [[nodiscard]] ErrorMessageOr<void> FinishCapture();
@@ -16,6 +16,7 @@
 #include <vector>
 
 #include "CaptureClient/CaptureListener.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
 #include "GrpcProtos/capture.pb.h"
 #include "OrbitBase/Result.h"
 
@@ -34,7 +35,9 @@ class CaptureEventProcessor {
 
   static ErrorMessageOr<std::unique_ptr<CaptureEventProcessor>> CreateSaveToFileProcessor(
       const std::filesystem::path& file_path,
-      std::function<void(const ErrorMessage&)> error_handler);
+      std::function<void(const ErrorMessage&)> error_handler,
+      orbit_capture_file::CaptureFileCompression compression =
+          orbit_capture_file::CaptureFileCompression::kNone);
 
   static std::unique_ptr<CaptureEventProcessor> CreateCompositeProcessor(
       std::vector<std::unique_ptr<CaptureEventProcessor>> event_processors);
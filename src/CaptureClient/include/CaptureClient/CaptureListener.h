@@ -46,6 +46,8 @@ class CaptureListener {
   virtual void OnCaptureFinished(const orbit_grpc_protos::CaptureFinished& capture_finished) = 0;
 
   virtual void OnTimer(const orbit_client_protos::TimerInfo& timer_info) = 0;
+  virtual void OnFunctionCallSummary(
+      const orbit_grpc_protos::FunctionCallSummary& function_call_summary) = 0;
   virtual void OnCgroupAndProcessMemoryInfo(
       const orbit_client_data::CgroupAndProcessMemoryInfo& cgroup_and_process_memory_info) = 0;
   virtual void OnPageFaultsInfo(const orbit_client_data::PageFaultsInfo& page_faults_info) = 0;
@@ -33,10 +33,15 @@ struct ClientCaptureOptions {
       thread_state_change_callstack_collection =
           orbit_grpc_protos::CaptureOptions::kThreadStateChangeCallStackCollectionUnspecified;
 
+  orbit_grpc_protos::CaptureOptions::RingBufferWaitMethod ring_buffer_wait_method =
+      orbit_grpc_protos::CaptureOptions::kRingBufferWaitMethodUnspecified;
+
   uint16_t stack_dump_size = 0;
   uint16_t thread_state_change_callstack_stack_dump_size = 0;
   uint64_t max_local_marker_depth_per_command_buffer = 0;
   uint64_t memory_sampling_period_ms = 0;
+  uint32_t ring_buffer_reader_thread_count = 0;
+  uint32_t unwinding_thread_count = 0;
   double samples_per_second = 0;
 
   bool collect_gpu_jobs = false;
@@ -47,6 +52,9 @@ struct ClientCaptureOptions {
   bool enable_introspection = false;
   bool record_arguments = false;
   bool record_return_values = false;
+  // Only applies to kUserSpaceInstrumentation: don't collect the individual calls of the selected
+  // functions, but only their statistics.
+  bool aggregate_instrumented_calls = false;
   bool enable_auto_frame_track = false;
 };
 
@@ -5,7 +5,10 @@
 #ifndef CAPTURE_CLIENT_LOAD_CAPTURE_H_
 #define CAPTURE_CLIENT_LOAD_CAPTURE_H_
 
+#include <stdint.h>
+
 #include <atomic>
+#include <optional>
 
 #include "CaptureClient/CaptureListener.h"
 #include "CaptureFile/CaptureFile.h"
@@ -13,10 +16,21 @@
 
 namespace orbit_capture_client {
 
-// TODO(b/234110675) Add a smoke test
+struct CaptureTimeRange {
+  uint64_t min_timestamp_ns = 0;
+  uint64_t max_timestamp_ns = 0;
+};
+
+// Reads the capture section of `capture_file` and passes its events to `listener`, in order and on
+// the calling thread. Reading and parsing the events happen in parallel on other threads. If the
+// file has a capture chunk index, its chunks are read and decompressed in parallel as well.
+// With `time_range`, and if the file has a capture chunk index, only the chunks needed for the
+// events in that range are read, see orbit_capture_file::FindCaptureChunksToLoad. The listener can
+// still receive events outside of the range.
 [[nodiscard]] ErrorMessageOr<CaptureListener::CaptureOutcome> LoadCapture(
     CaptureListener* listener, orbit_capture_file::CaptureFile* capture_file,
-    std::atomic<bool>* capture_loading_cancellation_requested);
+    std::atomic<bool>* capture_loading_cancellation_requested,
+    std::optional<CaptureTimeRange> time_range = std::nullopt);
 
 }  // namespace orbit_capture_client
 #endif  // CAPTURE_CLIENT_LOAD_CAPTURE_H_
@@ -0,0 +1,180 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventProducer/PerThreadEventBuffers.h"
+
+namespace orbit_capture_event_producer {
+
+namespace {
+
+struct Event {
+  uint32_t thread_index = 0;
+  uint64_t sequence_number = 0;
+};
+
+}  // namespace
+
+TEST(PerThreadEventBuffers, PopsEventsOfOneThreadInOrder) {
+  PerThreadEventBuffers<Event> buffers{16};
+  for (uint64_t i = 0; i < 10; ++i) {
+    EXPECT_TRUE(buffers.TryPush(Event{0, i}));
+  }
+
+  std::vector<Event> popped(16);
+  ASSERT_EQ(buffers.PopBulk(popped.data(), 4), 4);
+  ASSERT_EQ(buffers.PopBulk(popped.data() + 4, 16), 6);
+  for (uint64_t i = 0; i < 10; ++i) {
+    EXPECT_EQ(popped[i].sequence_number, i);
+  }
+  EXPECT_EQ(buffers.PopBulk(popped.data(), 16), 0);
+}
+
+TEST(PerThreadEventBuffers, RoundsCapacityUpToPowerOfTwo) {
+  EXPECT_EQ(PerThreadEventBuffers<Event>{1}.GetCapacityPerThread(), 1);
+  EXPECT_EQ(PerThreadEventBuffers<Event>{5}.GetCapacityPerThread(), 8);
+  EXPECT_EQ(PerThreadEventBuffers<Event>{1024}.GetCapacityPerThread(), 1024);
+}
+
+TEST(PerThreadEventBuffers, DropsAndCountsEventsWhenFull) {
+  PerThreadEventBuffers<Event> buffers{4};
+  for (uint64_t i = 0; i < 4; ++i) {
+    EXPECT_TRUE(buffers.TryPush(Event{0, i}));
+  }
+  EXPECT_FALSE(buffers.TryPush(Event{0, 4}));
+  EXPECT_FALSE(buffers.TryPush(Event{0, 5}));
+  EXPECT_EQ(buffers.TakeDroppedEventCount(), 2);
+  EXPECT_EQ(buffers.TakeDroppedEventCount(), 0);
+
+  // Popping makes room again, and the events that were not dropped are unchanged.
+  std::vector<Event> popped(4);
+  ASSERT_EQ(buffers.PopBulk(popped.data(), 1), 1);
+  EXPECT_EQ(popped[0].sequence_number, 0);
+  EXPECT_TRUE(buffers.TryPush(Event{0, 6}));
+  ASSERT_EQ(buffers.PopBulk(popped.data(), 4), 4);
+  EXPECT_EQ(popped[0].sequence_number, 1);
+  EXPECT_EQ(popped[3].sequence_number, 6);
+}
+
+TEST(PerThreadEventBuffers, SupportsTypesWithResources) {
+  PerThreadEventBuffers<std::unique_ptr<std::string>> buffers{2};
+  EXPECT_TRUE(buffers.TryPush(std::make_unique<std::string>("event")));
+  std::vector<std::unique_ptr<std::string>> popped(1);
+  ASSERT_EQ(buffers.PopBulk(popped.data(), 1), 1);
+  ASSERT_NE(popped[0], nullptr);
+  EXPECT_EQ(*popped[0], "event");
+}
+
+TEST(PerThreadEventBuffers, DestroysEventsThatWereNotPopped) {
+  auto resource = std::make_shared<int>(42);
+  {
+    PerThreadEventBuffers<std::shared_ptr<int>> buffers{4};
+    std::thread producer{[&buffers, &resource] {
+      // Wraps around the ring buffer once, so that popped and unpopped slots are interleaved.
+      for (int i = 0; i < 6; ++i) {
+        EXPECT_TRUE(buffers.TryPush(std::shared_ptr<int>{resource}));
+        if (i % 2 == 1) {
+          std::vector<std::shared_ptr<int>> popped(1);
+          EXPECT_EQ(buffers.PopBulk(popped.data(), 1), 1);
+        }
+      }
+    }};
+    producer.join();
+    EXPECT_EQ(resource.use_count(), 4);
+  }
+  EXPECT_EQ(resource.use_count(), 1);
+}
+
+TEST(PerThreadEventBuffers, KeepsEventsOfExitedThreadsAndCountsTheirDrops) {
+  PerThreadEventBuffers<Event> buffers{2};
+  std::thread{[&buffers] {
+    for (uint64_t i = 0; i < 3; ++i) {
+      (void)buffers.TryPush(Event{1, i});
+    }
+  }}.join();
+
+  std::vector<Event> popped(4);
+  ASSERT_EQ(buffers.PopBulk(popped.data(), 4), 2);
+  EXPECT_EQ(popped[0].sequence_number, 0);
+  EXPECT_EQ(popped[1].sequence_number, 1);
+  // The ring buffer of the exited thread has been released by now.
+  EXPECT_EQ(buffers.PopBulk(popped.data(), 4), 0);
+  EXPECT_EQ(buffers.TakeDroppedEventCount(), 1);
+}
+
+TEST(PerThreadEventBuffers, SeparatesInstancesOnTheSameThread) {
+  auto buffers1 = std::make_unique<PerThreadEventBuffers<Event>>(4);
+  auto buffers2 = std::make_unique<PerThreadEventBuffers<Event>>(4);
+  EXPECT_TRUE(buffers1->TryPush(Event{0, 1}));
+  EXPECT_TRUE(buffers2->TryPush(Event{0, 2}));
+
+  std::vector<Event> popped(4);
+  ASSERT_EQ(buffers1->PopBulk(popped.data(), 4), 1);
+  EXPECT_EQ(popped[0].sequence_number, 1);
+  ASSERT_EQ(buffers2->PopBulk(popped.data(), 4), 1);
+  EXPECT_EQ(popped[0].sequence_number, 2);
+
+  // A new instance possibly at the same address doesn't reuse the ring buffer of a destroyed one.
+  buffers1.reset();
+  buffers1 = std::make_unique<PerThreadEventBuffers<Event>>(4);
+  EXPECT_EQ(buffers1->PopBulk(popped.data(), 4), 0);
+  EXPECT_TRUE(buffers1->TryPush(Event{0, 3}));
+  ASSERT_EQ(buffers1->PopBulk(popped.data(), 4), 1);
+  EXPECT_EQ(popped[0].sequence_number, 3);
+}
+
+TEST(PerThreadEventBuffers, ConcurrentProducersAndConsumer) {
+  constexpr uint32_t kThreadCount = 8;
+  constexpr uint64_t kEventsPerThread = 100'000;
+  PerThreadEventBuffers<Event> buffers{256};
+
+  std::atomic<uint32_t> running_thread_count = kThreadCount;
+  std::vector<std::thread> threads;
+  std::vector<uint64_t> pushed_event_counts(kThreadCount);
+  for (uint32_t thread_index = 0; thread_index < kThreadCount; ++thread_index) {
+    threads.emplace_back([&, thread_index] {
+      for (uint64_t i = 0; i < kEventsPerThread; ++i) {
+        if (buffers.TryPush(Event{thread_index, i})) ++pushed_event_counts[thread_index];
+      }
+      --running_thread_count;
+    });
+  }
+
+  // Events of each thread need to arrive in order, but some of them may have been dropped.
+  std::vector<int64_t> last_sequence_numbers(kThreadCount, -1);
+  std::vector<uint64_t> popped_event_counts(kThreadCount);
+  std::vector<Event> popped(1024);
+  while (true) {
+    const bool all_threads_finished = running_thread_count == 0;
+    const size_t popped_count = buffers.PopBulk(popped.data(), popped.size());
+    for (size_t i = 0; i < popped_count; ++i) {
+      const Event& event = popped[i];
+      EXPECT_GT(static_cast<int64_t>(event.sequence_number),
+                last_sequence_numbers[event.thread_index]);
+      last_sequence_numbers[event.thread_index] = static_cast<int64_t>(event.sequence_number);
+      ++popped_event_counts[event.thread_index];
+    }
+    if (all_threads_finished && popped_count == 0) break;
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  uint64_t dropped_event_count = 0;
+  for (uint32_t thread_index = 0; thread_index < kThreadCount; ++thread_index) {
+    EXPECT_EQ(popped_event_counts[thread_index], pushed_event_counts[thread_index]);
+    dropped_event_count += kEventsPerThread - pushed_event_counts[thread_index];
+  }
+  EXPECT_EQ(buffers.TakeDroppedEventCount(), dropped_event_count);
+}
+
+}  // namespace orbit_capture_event_producer
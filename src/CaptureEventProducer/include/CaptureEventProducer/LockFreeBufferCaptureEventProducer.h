@@ -8,21 +8,26 @@
 #include <google/protobuf/arena.h>
 
 #include "CaptureEventProducer/CaptureEventProducer.h"
+#include "CaptureEventProducer/PerThreadEventBuffers.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
 #include "OrbitBase/ThreadUtils.h"
-#include "concurrentqueue.h"
 
 namespace orbit_capture_event_producer {
 
-// This still abstract implementation of CaptureEventProducer provides a lock-free queue where to
+// This still abstract implementation of CaptureEventProducer provides lock-free buffers where to
 // write events with low overhead from the fast path where they are produced.
 // Events are enqueued using the methods EnqueueIntermediateEvent(IfCapturing).
 //
-// Internally, a thread reads from the lock-free queue and sends ProducerCaptureEvents to
+// Every thread that enqueues events gets its own fixed-size ring buffer, see
+// PerThreadEventBuffers, so enqueuing an event is wait-free. If a thread produces events faster
+// than they can be forwarded and its buffer fills up, further events of that thread are dropped
+// and counted.
+//
+// Internally, a thread reads from the buffers and sends ProducerCaptureEvents to
 // ProducerSideService using the methods provided by the superclass.
 //
-// The type of the events stored in the lock-free queue is specified by the type parameter
+// The type of the events stored in the buffers is specified by the type parameter
 // IntermediateEventT. These events don't need to be ProducerCaptureEvents, nor protobufs at all.
 // This is to allow enqueuing objects that are faster to produce than protobufs.
 // ProducerCaptureEvents are then built from IntermediateEventT in TranslateIntermediateEvent, which
@@ -34,6 +39,12 @@ namespace orbit_capture_event_producer {
 template <typename IntermediateEventT>
 class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
  public:
+  static constexpr size_t kDefaultPerThreadBufferCapacity = 8 * 1024;
+
+  explicit LockFreeBufferCaptureEventProducer(
+      size_t per_thread_buffer_capacity = kDefaultPerThreadBufferCapacity)
+      : event_buffers_{per_thread_buffer_capacity} {}
+
   void BuildAndStart(const std::shared_ptr<grpc::Channel>& channel) final {
     CaptureEventProducer::BuildAndStart(channel);
 
@@ -49,25 +60,31 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
     CaptureEventProducer::ShutdownAndWait();
   }
 
-  void EnqueueIntermediateEvent(const IntermediateEventT& event) {
-    lock_free_queue_.enqueue(event);
+  // Returns false if the event was dropped because the buffer of the calling thread is full. Events
+  // that others depend on, like interned strings, need to be sent again in that case.
+  bool EnqueueIntermediateEvent(const IntermediateEventT& event) {
+    IntermediateEventT event_copy = event;
+    return event_buffers_.TryPush(std::move(event_copy));
   }
 
-  void EnqueueIntermediateEvent(IntermediateEventT&& event) {
-    lock_free_queue_.enqueue(std::move(event));
+  bool EnqueueIntermediateEvent(IntermediateEventT&& event) {
+    return event_buffers_.TryPush(std::move(event));
   }
 
+  // Returns false if not capturing, or if the event was dropped because the buffer of the calling
+  // thread is full.
   bool EnqueueIntermediateEventIfCapturing(
       const std::function<IntermediateEventT()>& event_builder_if_capturing) {
     if (IsCapturing()) {
-      lock_free_queue_.enqueue(event_builder_if_capturing());
-      return true;
+      return event_buffers_.TryPush(event_builder_if_capturing());
     }
     return false;
   }
 
  protected:
   void OnCaptureStart(orbit_grpc_protos::CaptureOptions /*capture_options*/) override {
+    // Only report the events dropped during this capture.
+    (void)event_buffers_.TakeDroppedEventCount();
     absl::MutexLock lock{&status_mutex_};
     status_ = ProducerStatus::kShouldSendEvents;
   }
@@ -118,7 +135,7 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
     while (!shutdown_requested_) {
       while (true) {
         size_t dequeued_event_count =
-            lock_free_queue_.try_dequeue_bulk(dequeued_events.begin(), kMaxEventsPerRequest);
+            event_buffers_.PopBulk(dequeued_events.data(), kMaxEventsPerRequest);
         bool queue_was_emptied = dequeued_event_count < kMaxEventsPerRequest;
 
         ProducerStatus current_status;
@@ -153,8 +170,15 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
         }
 
         if (current_status == ProducerStatus::kShouldNotifyAllEventsSent && queue_was_emptied) {
-          // lock_free_queue_ is now empty and status_ == kShouldNotifyAllEventsSent,
+          // event_buffers_ are now empty and status_ == kShouldNotifyAllEventsSent,
           // send AllEventsSent. status_ has already been changed to kShouldDropEvents.
+          const uint64_t dropped_event_count = event_buffers_.TakeDroppedEventCount();
+          if (dropped_event_count > 0) {
+            ORBIT_ERROR(
+                "Dropped %u events during the capture because the per-thread buffers of %u "
+                "events were full",
+                dropped_event_count, event_buffers_.GetCapacityPerThread());
+          }
           if (!NotifyAllEventsSent()) {
             ORBIT_ERROR("Notifying that all CaptureEvents have been sent");
           }
@@ -162,7 +186,7 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
         }
 
         // Note that if current_status == ProducerStatus::kShouldDropEvents
-        // the events extracted from the lock_free_queue_ will just be dropped.
+        // the events extracted from the event_buffers_ will just be dropped.
 
         if (queue_was_emptied) {
           break;
@@ -170,12 +194,12 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
       }
 
       constexpr std::chrono::microseconds kSleepOnEmptyQueue{1000};
-      // Wait for lock_free_queue_ to fill up with new CaptureEvents.
+      // Wait for event_buffers_ to fill up with new CaptureEvents.
       std::this_thread::sleep_for(kSleepOnEmptyQueue);
     }
   }
 
-  moodycamel::ConcurrentQueue<IntermediateEventT> lock_free_queue_;
+  PerThreadEventBuffers<IntermediateEventT> event_buffers_;
 
   std::thread forwarder_thread_;
   std::atomic<bool> shutdown_requested_ = false;
@@ -0,0 +1,253 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_EVENT_PRODUCER_PER_THREAD_EVENT_BUFFERS_H_
+#define CAPTURE_EVENT_PRODUCER_PER_THREAD_EVENT_BUFFERS_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_capture_event_producer {
+
+// Buffers events produced by any number of threads until a single consumer thread takes them out.
+// Every producing thread gets its own fixed-size ring buffer the first time it pushes an event, so
+// that pushing is wait-free and never contends with other threads. When the ring buffer of a thread
+// is full, its events are dropped and counted instead of growing the memory use without bounds.
+//
+// The events of each thread are popped in the order they were pushed. There is no order among the
+// events of different threads.
+//
+// `T` needs to be movable. The memory of a ring buffer is reserved for `capacity_per_thread`
+// instances of `T`, but it is only touched, and hence only committed by the operating system, as
+// far as the thread actually fills the ring buffer.
+template <typename T>
+class PerThreadEventBuffers {
+ public:
+  // `capacity_per_thread` is rounded up to the next power of two.
+  explicit PerThreadEventBuffers(size_t capacity_per_thread)
+      : capacity_per_thread_{RoundUpToPowerOfTwo(capacity_per_thread)},
+        id_{next_id_.fetch_add(1, std::memory_order_relaxed)} {}
+
+  PerThreadEventBuffers(const PerThreadEventBuffers&) = delete;
+  PerThreadEventBuffers& operator=(const PerThreadEventBuffers&) = delete;
+
+  ~PerThreadEventBuffers() {
+    // Threads that are still alive release their ring buffers the next time they register one.
+    absl::MutexLock lock{&ring_buffers_mutex_};
+    for (const std::shared_ptr<RingBuffer>& ring_buffer : ring_buffers_) {
+      ring_buffer->MarkOwnerDestroyed();
+    }
+  }
+
+  // Returns false if the event was dropped because the ring buffer of the calling thread is full.
+  // Wait-free, except for the first call on each thread, which allocates its ring buffer.
+  bool TryPush(T&& event) { return GetOrCreateRingBufferOfThisThread().TryPush(std::move(event)); }
+
+  // Moves up to `max_count` events to `out` and returns their number. Must only be called by one
+  // thread at a time.
+  size_t PopBulk(T* out, size_t max_count) {
+    absl::MutexLock lock{&ring_buffers_mutex_};
+    size_t count = 0;
+    // Start from a different ring buffer every time, so that no thread is starved when the
+    // consumer can't keep up.
+    const size_t ring_buffer_count = ring_buffers_.size();
+    for (size_t i = 0; i < ring_buffer_count && count < max_count; ++i) {
+      RingBuffer& ring_buffer = *ring_buffers_[(first_ring_buffer_to_pop_ + i) % ring_buffer_count];
+      count += ring_buffer.PopBulk(out + count, max_count - count);
+    }
+    if (ring_buffer_count > 0) {
+      first_ring_buffer_to_pop_ = (first_ring_buffer_to_pop_ + 1) % ring_buffer_count;
+    }
+
+    // Release the ring buffers of threads that have exited, once they are empty.
+    auto ring_buffer_it = ring_buffers_.begin();
+    while (ring_buffer_it != ring_buffers_.end()) {
+      RingBuffer& ring_buffer = **ring_buffer_it;
+      if (ring_buffer.IsProducerThreadExited() && ring_buffer.IsEmpty()) {
+        dropped_event_count_of_exited_threads_ += ring_buffer.TakeDroppedEventCount();
+        ring_buffer_it = ring_buffers_.erase(ring_buffer_it);
+      } else {
+        ++ring_buffer_it;
+      }
+    }
+    return count;
+  }
+
+  // Returns the number of events dropped since the last call, over all threads.
+  [[nodiscard]] uint64_t TakeDroppedEventCount() {
+    absl::MutexLock lock{&ring_buffers_mutex_};
+    uint64_t dropped_event_count = dropped_event_count_of_exited_threads_;
+    dropped_event_count_of_exited_threads_ = 0;
+    for (const std::shared_ptr<RingBuffer>& ring_buffer : ring_buffers_) {
+      dropped_event_count += ring_buffer->TakeDroppedEventCount();
+    }
+    return dropped_event_count;
+  }
+
+  [[nodiscard]] size_t GetCapacityPerThread() const { return capacity_per_thread_; }
+
+ private:
+  // A ring buffer with a single producer and a single consumer thread.
+  class RingBuffer {
+   public:
+    // The slots are left uninitialized: value-initializing them would touch the memory of the
+    // entire ring buffer for every thread that pushes a single event.
+    explicit RingBuffer(size_t capacity) : capacity_{capacity}, slots_{new Slot[capacity]} {}
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    ~RingBuffer() {
+      const uint64_t write_index = write_index_.load(std::memory_order_acquire);
+      for (uint64_t index = read_index_.load(std::memory_order_relaxed); index < write_index;
+           ++index) {
+        GetSlot(index).~T();
+      }
+    }
+
+    bool TryPush(T&& event) {
+      const uint64_t write_index = write_index_.load(std::memory_order_relaxed);
+      if (write_index - cached_read_index_ >= capacity_) {
+        cached_read_index_ = read_index_.load(std::memory_order_acquire);
+        if (write_index - cached_read_index_ >= capacity_) {
+          // Only this thread writes the counter, so there is no need for a read-modify-write.
+          dropped_event_count_.store(dropped_event_count_.load(std::memory_order_relaxed) + 1,
+                                     std::memory_order_relaxed);
+          return false;
+        }
+      }
+      new (&slots_[write_index & (capacity_ - 1)]) T(std::move(event));
+      write_index_.store(write_index + 1, std::memory_order_release);
+      return true;
+    }
+
+    size_t PopBulk(T* out, size_t max_count) {
+      const uint64_t read_index = read_index_.load(std::memory_order_relaxed);
+      const uint64_t write_index = write_index_.load(std::memory_order_acquire);
+      const size_t count = std::min<uint64_t>(write_index - read_index, max_count);
+      for (size_t i = 0; i < count; ++i) {
+        T& event = GetSlot(read_index + i);
+        out[i] = std::move(event);
+        event.~T();
+      }
+      read_index_.store(read_index + count, std::memory_order_release);
+      return count;
+    }
+
+    [[nodiscard]] bool IsEmpty() const {
+      return read_index_.load(std::memory_order_relaxed) ==
+             write_index_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] uint64_t TakeDroppedEventCount() {
+      const uint64_t dropped_event_count = dropped_event_count_.load(std::memory_order_relaxed);
+      const uint64_t new_dropped_event_count = dropped_event_count - taken_dropped_event_count_;
+      taken_dropped_event_count_ = dropped_event_count;
+      return new_dropped_event_count;
+    }
+
+    void MarkProducerThreadExited() {
+      producer_thread_exited_.store(true, std::memory_order_release);
+    }
+    [[nodiscard]] bool IsProducerThreadExited() const {
+      return producer_thread_exited_.load(std::memory_order_acquire);
+    }
+
+    void MarkOwnerDestroyed() { owner_destroyed_.store(true, std::memory_order_release); }
+    [[nodiscard]] bool IsOwnerDestroyed() const {
+      return owner_destroyed_.load(std::memory_order_acquire);
+    }
+
+   private:
+    using Slot = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+    [[nodiscard]] T& GetSlot(uint64_t index) {
+      return *std::launder(reinterpret_cast<T*>(&slots_[index & (capacity_ - 1)]));
+    }
+
+    const size_t capacity_;
+    const std::unique_ptr<Slot[]> slots_;
+
+    // Written by the producer thread only. Kept on a different cache line than read_index_, so
+    // that the two threads don't keep invalidating each other's cache line.
+    alignas(64) std::atomic<uint64_t> write_index_ = 0;
+    uint64_t cached_read_index_ = 0;
+    std::atomic<uint64_t> dropped_event_count_ = 0;
+
+    // Written by the consumer thread only.
+    alignas(64) std::atomic<uint64_t> read_index_ = 0;
+    uint64_t taken_dropped_event_count_ = 0;
+
+    std::atomic<bool> producer_thread_exited_ = false;
+    std::atomic<bool> owner_destroyed_ = false;
+  };
+
+  // The ring buffers of the calling thread, one for each PerThreadEventBuffers it pushed to.
+  struct RingBuffersOfThisThread {
+    ~RingBuffersOfThisThread() {
+      for (const auto& [unused_id, ring_buffer] : ring_buffers) {
+        ring_buffer->MarkProducerThreadExited();
+      }
+    }
+
+    // Usually there is only one entry, and instances are identified by an id rather than by
+    // their address, which could be reused.
+    std::vector<std::pair<uint64_t, std::shared_ptr<RingBuffer>>> ring_buffers;
+  };
+
+  RingBuffer& GetOrCreateRingBufferOfThisThread() {
+    thread_local RingBuffersOfThisThread ring_buffers_of_this_thread;
+    std::vector<std::pair<uint64_t, std::shared_ptr<RingBuffer>>>& ring_buffers =
+        ring_buffers_of_this_thread.ring_buffers;
+    for (const auto& [id, ring_buffer] : ring_buffers) {
+      if (id == id_) return *ring_buffer;
+    }
+
+    ring_buffers.erase(std::remove_if(ring_buffers.begin(), ring_buffers.end(),
+                                      [](const auto& id_and_ring_buffer) {
+                                        return id_and_ring_buffer.second->IsOwnerDestroyed();
+                                      }),
+                       ring_buffers.end());
+    auto ring_buffer = std::make_shared<RingBuffer>(capacity_per_thread_);
+    {
+      absl::MutexLock lock{&ring_buffers_mutex_};
+      ring_buffers_.push_back(ring_buffer);
+    }
+    ring_buffers.emplace_back(id_, ring_buffer);
+    return *ring_buffer;
+  }
+
+  [[nodiscard]] static size_t RoundUpToPowerOfTwo(size_t value) {
+    ORBIT_CHECK(value > 0);
+    size_t power_of_two = 1;
+    while (power_of_two < value) power_of_two *= 2;
+    return power_of_two;
+  }
+
+  static inline std::atomic<uint64_t> next_id_ = 0;
+
+  const size_t capacity_per_thread_;
+  const uint64_t id_;
+
+  absl::Mutex ring_buffers_mutex_;
+  std::vector<std::shared_ptr<RingBuffer>> ring_buffers_ ABSL_GUARDED_BY(ring_buffers_mutex_);
+  size_t first_ring_buffer_to_pop_ ABSL_GUARDED_BY(ring_buffers_mutex_) = 0;
+  uint64_t dropped_event_count_of_exited_threads_ ABSL_GUARDED_BY(ring_buffers_mutex_) = 0;
+};
+
+}  // namespace orbit_capture_event_producer
+
+#endif  // CAPTURE_EVENT_PRODUCER_PER_THREAD_EVENT_BUFFERS_H_
@@ -0,0 +1,158 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "AsyncCaptureEventWriter.h"
+
+#include <absl/time/clock.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+// Large enough for a batch of typical events, most of which are function calls and samples.
+constexpr size_t kArenaInitialBlockSize = 256 * 1024;
+
+}  // namespace
+
+AsyncCaptureEventWriter::AsyncCaptureEventWriter(WriteEventFunction write_event,
+                                                 size_t events_per_batch, size_t batch_count)
+    : write_event_{std::move(write_event)}, events_per_batch_{events_per_batch} {
+  ORBIT_CHECK(write_event_ != nullptr);
+  ORBIT_CHECK(events_per_batch > 0);
+  ORBIT_CHECK(batch_count >= 2);
+  {
+    absl::MutexLock lock{&mutex_};
+    for (size_t i = 0; i < batch_count; ++i) {
+      google::protobuf::ArenaOptions arena_options;
+      arena_options.initial_block =
+          arena_initial_blocks_.emplace_back(std::make_unique<char[]>(kArenaInitialBlockSize))
+              .get();
+      arena_options.initial_block_size = kArenaInitialBlockSize;
+      Batch batch{std::make_unique<google::protobuf::Arena>(arena_options), {}};
+      batch.events.reserve(events_per_batch);
+      free_batches_.push_back(std::move(batch));
+    }
+  }
+  writer_thread_ = std::thread{[this] { WriteBatches(); }};
+}
+
+AsyncCaptureEventWriter::~AsyncCaptureEventWriter() {
+  (void)Flush();
+  {
+    absl::MutexLock lock{&mutex_};
+    stop_requested_ = true;
+  }
+  writer_thread_.join();
+}
+
+ErrorMessageOr<void> AsyncCaptureEventWriter::AddEvent(const ClientCaptureEvent& event) {
+  if (!current_batch_.has_value()) {
+    absl::MutexLock lock{&mutex_};
+    if (last_error_.has_value()) return last_error_.value();
+    if (free_batches_.empty()) {
+      // Events can't be written as fast as they are produced: this is where we apply backpressure.
+      ++statistics_.wait_count;
+      const absl::Time wait_begin = absl::Now();
+      mutex_.Await(absl::Condition(
+          +[](std::vector<Batch>* free_batches) { return !free_batches->empty(); },
+          &free_batches_));
+      statistics_.wait_duration += absl::Now() - wait_begin;
+      if (last_error_.has_value()) return last_error_.value();
+    }
+    current_batch_ = std::move(free_batches_.back());
+    free_batches_.pop_back();
+  }
+
+  ClientCaptureEvent* event_copy =
+      google::protobuf::Arena::CreateMessage<ClientCaptureEvent>(current_batch_->arena.get());
+  event_copy->CopyFrom(event);
+  current_batch_->events.push_back(event_copy);
+  if (current_batch_->events.size() == events_per_batch_) SubmitCurrentBatch();
+  return outcome::success();
+}
+
+void AsyncCaptureEventWriter::SubmitCurrentBatch() {
+  if (!current_batch_.has_value()) return;
+  Batch batch = std::move(current_batch_.value());
+  current_batch_.reset();
+
+  absl::MutexLock lock{&mutex_};
+  full_batches_.push_back(std::move(batch));
+  statistics_.max_queue_depth = std::max(statistics_.max_queue_depth, full_batches_.size());
+}
+
+ErrorMessageOr<void> AsyncCaptureEventWriter::Flush() {
+  SubmitCurrentBatch();
+
+  absl::MutexLock lock{&mutex_};
+  mutex_.Await(absl::Condition(
+      +[](AsyncCaptureEventWriter* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+        return self->full_batches_.empty() && !self->writing_;
+      },
+      this));
+  if (last_error_.has_value()) return last_error_.value();
+  return outcome::success();
+}
+
+AsyncCaptureEventWriterStatistics AsyncCaptureEventWriter::GetStatistics() const {
+  absl::MutexLock lock{&mutex_};
+  return statistics_;
+}
+
+void AsyncCaptureEventWriter::WriteBatches() {
+  orbit_base::SetCurrentThreadName("CaptureWrite");
+
+  while (true) {
+    Batch batch;
+    bool had_error = false;
+    {
+      absl::MutexLock lock{&mutex_};
+      mutex_.Await(absl::Condition(
+          +[](AsyncCaptureEventWriter* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+            return !self->full_batches_.empty() || self->stop_requested_;
+          },
+          this));
+      if (full_batches_.empty()) return;
+      batch = std::move(full_batches_.front());
+      full_batches_.pop_front();
+      writing_ = true;
+      had_error = last_error_.has_value();
+    }
+
+    // After an error, the remaining events are discarded, as the file is unusable anyway.
+    const absl::Time write_begin = absl::Now();
+    ErrorMessageOr<void> write_result = outcome::success();
+    if (!had_error) {
+      for (const ClientCaptureEvent* event : batch.events) {
+        write_result = write_event_(*event);
+        if (write_result.has_error()) break;
+      }
+    }
+    const absl::Duration write_duration = absl::Now() - write_begin;
+    const size_t event_count = batch.events.size();
+    batch.events.clear();
+    batch.arena->Reset();
+
+    absl::MutexLock lock{&mutex_};
+    if (write_result.has_error()) {
+      if (!last_error_.has_value()) last_error_ = write_result.error();
+    } else if (!had_error) {
+      statistics_.events_written += event_count;
+      ++statistics_.batches_written;
+      statistics_.write_duration += write_duration;
+    }
+    free_batches_.push_back(std::move(batch));
+    writing_ = false;
+  }
+}
+
+}  // namespace orbit_capture_file_internal
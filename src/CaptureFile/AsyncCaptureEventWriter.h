@@ -0,0 +1,110 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ASYNC_CAPTURE_EVENT_WRITER_H_
+#define ASYNC_CAPTURE_EVENT_WRITER_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <absl/time/time.h>
+#include <google/protobuf/arena.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_internal {
+
+struct AsyncCaptureEventWriterStatistics {
+  uint64_t events_written = 0;
+  uint64_t batches_written = 0;
+  // The time the background thread spent serializing and writing events.
+  absl::Duration write_duration = absl::ZeroDuration();
+  // The largest number of full batches that were waiting to be written at the same time.
+  size_t max_queue_depth = 0;
+  // How many times, and for how long in total, the caller had to wait for a batch to become free,
+  // because events couldn't be written as fast as they were produced.
+  uint64_t wait_count = 0;
+  absl::Duration wait_duration = absl::ZeroDuration();
+};
+
+// Hands capture events over to a background thread, which serializes and writes them with
+// `write_event`, so that neither serialization nor a slow disk stalls the thread producing them.
+// Events are copied into one of `batch_count` batches of `events_per_batch` events. The copies are
+// allocated on an arena owned by the batch, which is reset once the batch was written, so copying
+// an event costs less than serializing it. When a batch is full, it is handed over to the
+// background thread and the caller continues with the next free batch. The caller only blocks when
+// all batches are waiting to be written.
+// `write_event` is called for all events, in the order in which they were added. Once it returns an
+// error, the remaining events are discarded and the error is returned by the next call to AddEvent
+// or Flush.
+// This only moves the serialization off the caller's thread, it doesn't parallelize it: all events
+// are serialized by the one background thread into a single stream, because the compressed chunks
+// and the capture chunk index depend on the order and the offsets of all the events before.
+class AsyncCaptureEventWriter {
+ public:
+  using WriteEventFunction =
+      std::function<ErrorMessageOr<void>(const orbit_grpc_protos::ClientCaptureEvent&)>;
+
+  explicit AsyncCaptureEventWriter(WriteEventFunction write_event, size_t events_per_batch = 1024,
+                                   size_t batch_count = 8);
+  AsyncCaptureEventWriter(const AsyncCaptureEventWriter&) = delete;
+  AsyncCaptureEventWriter& operator=(const AsyncCaptureEventWriter&) = delete;
+  AsyncCaptureEventWriter(AsyncCaptureEventWriter&&) = delete;
+  AsyncCaptureEventWriter& operator=(AsyncCaptureEventWriter&&) = delete;
+  // Writes all remaining events, ignoring errors, and stops the background thread.
+  ~AsyncCaptureEventWriter();
+
+  // Copies `event` to be written by the background thread. Returns the error that occurred writing
+  // an earlier event, if any.
+  [[nodiscard]] ErrorMessageOr<void> AddEvent(const orbit_grpc_protos::ClientCaptureEvent& event);
+
+  // Hands over the partially filled batch, if any, and waits until all events have been written.
+  // Returns the first error that occurred writing an event, if any.
+  [[nodiscard]] ErrorMessageOr<void> Flush();
+
+  // Only to be called after Flush.
+  [[nodiscard]] AsyncCaptureEventWriterStatistics GetStatistics() const;
+
+ private:
+  struct Batch {
+    std::unique_ptr<google::protobuf::Arena> arena;
+    std::vector<orbit_grpc_protos::ClientCaptureEvent*> events;
+  };
+
+  void SubmitCurrentBatch();
+  void WriteBatches();
+
+  const WriteEventFunction write_event_;
+  const size_t events_per_batch_;
+  // The arena of each batch keeps its first block across resets, so that the memory of a batch is
+  // only allocated once for typical events.
+  std::vector<std::unique_ptr<char[]>> arena_initial_blocks_;
+
+  // Only accessed by the caller's thread.
+  std::optional<Batch> current_batch_;
+
+  mutable absl::Mutex mutex_;
+  std::vector<Batch> free_batches_ ABSL_GUARDED_BY(mutex_);
+  std::deque<Batch> full_batches_ ABSL_GUARDED_BY(mutex_);
+  // Whether the background thread is writing a batch that is no longer in full_batches_.
+  bool writing_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stop_requested_ ABSL_GUARDED_BY(mutex_) = false;
+  std::optional<ErrorMessage> last_error_ ABSL_GUARDED_BY(mutex_);
+  AsyncCaptureEventWriterStatistics statistics_ ABSL_GUARDED_BY(mutex_);
+
+  std::thread writer_thread_;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // ASYNC_CAPTURE_EVENT_WRITER_H_
@@ -0,0 +1,118 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "AsyncCaptureEventWriter.h"
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_internal {
+
+namespace {
+
+[[nodiscard]] orbit_grpc_protos::ClientCaptureEvent CreateInternedStringEvent(uint64_t key) {
+  orbit_grpc_protos::ClientCaptureEvent event;
+  event.mutable_interned_string()->set_key(key);
+  event.mutable_interned_string()->set_intern("string");
+  return event;
+}
+
+}  // namespace
+
+TEST(AsyncCaptureEventWriter, WritesAllEventsInOrderAcrossBatches) {
+  constexpr uint64_t kEventCount = 100;
+  // Only accessed by the background thread until Flush returns.
+  std::vector<uint64_t> written_keys;
+  AsyncCaptureEventWriter writer{
+      [&written_keys](const orbit_grpc_protos::ClientCaptureEvent& event) -> ErrorMessageOr<void> {
+        written_keys.push_back(event.interned_string().key());
+        return outcome::success();
+      },
+      /*events_per_batch=*/3, /*batch_count=*/2};
+
+  for (uint64_t key = 0; key < kEventCount; ++key) {
+    ErrorMessageOr<void> result = writer.AddEvent(CreateInternedStringEvent(key));
+    ASSERT_FALSE(result.has_error()) << result.error().message();
+  }
+  ErrorMessageOr<void> flush_result = writer.Flush();
+  ASSERT_FALSE(flush_result.has_error()) << flush_result.error().message();
+
+  ASSERT_EQ(written_keys.size(), kEventCount);
+  for (uint64_t key = 0; key < kEventCount; ++key) {
+    EXPECT_EQ(written_keys[key], key);
+  }
+  AsyncCaptureEventWriterStatistics statistics = writer.GetStatistics();
+  EXPECT_EQ(statistics.events_written, kEventCount);
+  EXPECT_EQ(statistics.batches_written, (kEventCount + 2) / 3);
+  EXPECT_GE(statistics.max_queue_depth, 1);
+  EXPECT_LE(statistics.max_queue_depth, 2);
+}
+
+TEST(AsyncCaptureEventWriter, WritesCopiesOfEvents) {
+  std::vector<uint64_t> written_keys;
+  AsyncCaptureEventWriter writer{
+      [&written_keys](const orbit_grpc_protos::ClientCaptureEvent& event) -> ErrorMessageOr<void> {
+        written_keys.push_back(event.interned_string().key());
+        return outcome::success();
+      }};
+
+  orbit_grpc_protos::ClientCaptureEvent event = CreateInternedStringEvent(1);
+  ASSERT_FALSE(writer.AddEvent(event).has_error());
+  event.mutable_interned_string()->set_key(2);
+  ASSERT_FALSE(writer.AddEvent(event).has_error());
+  event.Clear();
+  ASSERT_FALSE(writer.Flush().has_error());
+
+  EXPECT_EQ(written_keys, (std::vector<uint64_t>{1, 2}));
+}
+
+TEST(AsyncCaptureEventWriter, DestructorWritesRemainingEvents) {
+  std::vector<uint64_t> written_keys;
+  {
+    AsyncCaptureEventWriter writer{
+        [&written_keys](
+            const orbit_grpc_protos::ClientCaptureEvent& event) -> ErrorMessageOr<void> {
+          written_keys.push_back(event.interned_string().key());
+          return outcome::success();
+        }};
+    ASSERT_FALSE(writer.AddEvent(CreateInternedStringEvent(42)).has_error());
+  }
+  EXPECT_EQ(written_keys, std::vector<uint64_t>{42});
+}
+
+TEST(AsyncCaptureEventWriter, ReportsErrorsAndDiscardsRemainingEvents) {
+  constexpr uint64_t kFailingKey = 5;
+  std::vector<uint64_t> written_keys;
+  AsyncCaptureEventWriter writer{
+      [&written_keys](const orbit_grpc_protos::ClientCaptureEvent& event) -> ErrorMessageOr<void> {
+        if (event.interned_string().key() == kFailingKey) return ErrorMessage{"No space left"};
+        written_keys.push_back(event.interned_string().key());
+        return outcome::success();
+      },
+      /*events_per_batch=*/2, /*batch_count=*/2};
+
+  // The error is only noticed by the background thread, and then reported by a later AddEvent.
+  bool add_event_failed = false;
+  for (uint64_t key = 0; key < 1000 && !add_event_failed; ++key) {
+    ErrorMessageOr<void> result = writer.AddEvent(CreateInternedStringEvent(key));
+    if (result.has_error()) {
+      EXPECT_EQ(result.error().message(), "No space left");
+      add_event_failed = true;
+    }
+  }
+  EXPECT_TRUE(add_event_failed);
+  ErrorMessageOr<void> flush_result = writer.Flush();
+  ASSERT_TRUE(flush_result.has_error());
+  EXPECT_EQ(flush_result.error().message(), "No space left");
+
+  EXPECT_EQ(written_keys, (std::vector<uint64_t>{0, 1, 2, 3, 4}));
+  // Only the batches written without error are counted.
+  EXPECT_EQ(writer.GetStatistics().events_written, 4);
+}
+
+}  // namespace orbit_capture_file_internal
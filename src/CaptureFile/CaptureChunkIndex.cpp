@@ -0,0 +1,66 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureFile/CaptureChunkIndex.h"
+
+#include <absl/strings/str_format.h>
+
+#include "CaptureFile/CaptureFileSection.h"
+#include "CaptureFile/ProtoSectionInputStream.h"
+
+using orbit_client_protos::CaptureChunk;
+using orbit_client_protos::CaptureChunkIndex;
+
+namespace orbit_capture_file {
+
+ErrorMessageOr<std::optional<CaptureChunkIndex>> ReadCaptureChunkIndex(CaptureFile* capture_file) {
+  std::optional<uint64_t> section_index =
+      capture_file->FindSectionByType(kSectionTypeCaptureChunkIndex);
+  if (!section_index.has_value()) return std::nullopt;
+
+  CaptureChunkIndex index;
+  std::unique_ptr<ProtoSectionInputStream> input_stream =
+      capture_file->CreateProtoSectionInputStream(section_index.value());
+  OUTCOME_TRY(input_stream->ReadMessage(&index));
+
+  // The chunks are read with CaptureFile::CreateCaptureChunkInputStream, which requires them to be
+  // inside the capture section.
+  const uint64_t capture_section_size = capture_file->GetCaptureSectionSize();
+  for (int i = 0; i < index.chunks_size(); ++i) {
+    const CaptureChunk& chunk = index.chunks(i);
+    if (chunk.offset() > capture_section_size ||
+        chunk.size() > capture_section_size - chunk.offset()) {
+      return ErrorMessage{absl::StrFormat(
+          "Chunk %d of the capture chunk index is outside of the capture section", i)};
+    }
+  }
+  return index;
+}
+
+std::vector<uint32_t> FindCaptureChunksToLoad(const CaptureChunkIndex& index,
+                                              uint64_t min_timestamp_ns,
+                                              uint64_t max_timestamp_ns) {
+  std::vector<bool> chunks_to_load(index.chunks_size(), false);
+  // Chunks only depend on earlier chunks, so walking backwards visits all dependencies of a chunk,
+  // also indirect ones, after the chunk itself.
+  for (int i = index.chunks_size() - 1; i >= 0; --i) {
+    const CaptureChunk& chunk = index.chunks(i);
+    if (chunk.contains_state_events() || (chunk.min_timestamp_ns() <= max_timestamp_ns &&
+                                          chunk.max_timestamp_ns() >= min_timestamp_ns)) {
+      chunks_to_load[i] = true;
+    }
+    if (!chunks_to_load[i]) continue;
+    for (uint32_t dependency : chunk.interned_data_chunk_indices()) {
+      if (dependency < static_cast<uint32_t>(i)) chunks_to_load[dependency] = true;
+    }
+  }
+
+  std::vector<uint32_t> result;
+  for (size_t i = 0; i < chunks_to_load.size(); ++i) {
+    if (chunks_to_load[i]) result.push_back(i);
+  }
+  return result;
+}
+
+}  // namespace orbit_capture_file
@@ -0,0 +1,223 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureChunkIndexBuilder.h"
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+using orbit_client_protos::CaptureChunkIndex;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace orbit_capture_file_internal {
+
+namespace {
+
+struct TimeRange {
+  uint64_t min_ns;
+  uint64_t max_ns;
+};
+
+[[nodiscard]] TimeRange TimeRangeEndingAt(uint64_t end_ns, uint64_t duration_ns) {
+  // Don't underflow on corrupted events.
+  return {end_ns - std::min(end_ns, duration_ns), end_ns};
+}
+
+// Returns the time range covered by events that happened at some time and are shown on the
+// timeline, and std::nullopt for interned data and for events that describe the state of the
+// capture. Unknown events are considered to be the latter, so that they are always loaded.
+[[nodiscard]] std::optional<TimeRange> GetTimeRange(const ClientCaptureEvent& event) {
+  switch (event.event_case()) {
+    case ClientCaptureEvent::kApiScopeStart:
+      return TimeRange{event.api_scope_start().timestamp_ns(),
+                       event.api_scope_start().timestamp_ns()};
+    case ClientCaptureEvent::kApiScopeStartAsync:
+      return TimeRange{event.api_scope_start_async().timestamp_ns(),
+                       event.api_scope_start_async().timestamp_ns()};
+    case ClientCaptureEvent::kApiScopeStop:
+      return TimeRange{event.api_scope_stop().timestamp_ns(),
+                       event.api_scope_stop().timestamp_ns()};
+    case ClientCaptureEvent::kApiScopeStopAsync:
+      return TimeRange{event.api_scope_stop_async().timestamp_ns(),
+                       event.api_scope_stop_async().timestamp_ns()};
+    case ClientCaptureEvent::kApiStringEvent:
+      return TimeRange{event.api_string_event().timestamp_ns(),
+                       event.api_string_event().timestamp_ns()};
+    case ClientCaptureEvent::kApiTrackDouble:
+      return TimeRange{event.api_track_double().timestamp_ns(),
+                       event.api_track_double().timestamp_ns()};
+    case ClientCaptureEvent::kApiTrackFloat:
+      return TimeRange{event.api_track_float().timestamp_ns(),
+                       event.api_track_float().timestamp_ns()};
+    case ClientCaptureEvent::kApiTrackInt:
+      return TimeRange{event.api_track_int().timestamp_ns(), event.api_track_int().timestamp_ns()};
+    case ClientCaptureEvent::kApiTrackInt64:
+      return TimeRange{event.api_track_int64().timestamp_ns(),
+                       event.api_track_int64().timestamp_ns()};
+    case ClientCaptureEvent::kApiTrackUint:
+      return TimeRange{event.api_track_uint().timestamp_ns(),
+                       event.api_track_uint().timestamp_ns()};
+    case ClientCaptureEvent::kApiTrackUint64:
+      return TimeRange{event.api_track_uint64().timestamp_ns(),
+                       event.api_track_uint64().timestamp_ns()};
+    case ClientCaptureEvent::kCallstackSample:
+      return TimeRange{event.callstack_sample().timestamp_ns(),
+                       event.callstack_sample().timestamp_ns()};
+    case ClientCaptureEvent::kFunctionCall:
+      return TimeRangeEndingAt(event.function_call().end_timestamp_ns(),
+                               event.function_call().duration_ns());
+    case ClientCaptureEvent::kFunctionCallSummary:
+      return TimeRange{event.function_call_summary().start_timestamp_ns(),
+                       event.function_call_summary().end_timestamp_ns()};
+    case ClientCaptureEvent::kGpuJob:
+      return TimeRange{event.gpu_job().amdgpu_cs_ioctl_time_ns(),
+                       event.gpu_job().dma_fence_signaled_time_ns()};
+    case ClientCaptureEvent::kGpuQueueSubmission: {
+      // GPU timestamps are in a different time domain, so use the CPU timestamps of the
+      // submissions, including the ones of the submissions of the begin markers.
+      const orbit_grpc_protos::GpuQueueSubmission& submission = event.gpu_queue_submission();
+      TimeRange time_range{submission.meta_info().pre_submission_cpu_timestamp(),
+                           submission.meta_info().post_submission_cpu_timestamp()};
+      for (const orbit_grpc_protos::GpuDebugMarker& marker : submission.completed_markers()) {
+        if (!marker.has_begin_marker()) continue;
+        time_range.min_ns =
+            std::min(time_range.min_ns,
+                     marker.begin_marker().meta_info().pre_submission_cpu_timestamp());
+      }
+      return time_range;
+    }
+    case ClientCaptureEvent::kLostPerfRecordsEvent:
+      return TimeRangeEndingAt(event.lost_perf_records_event().end_timestamp_ns(),
+                               event.lost_perf_records_event().duration_ns());
+    case ClientCaptureEvent::kMemoryUsageEvent:
+      return TimeRange{event.memory_usage_event().timestamp_ns(),
+                       event.memory_usage_event().timestamp_ns()};
+    case ClientCaptureEvent::kOutOfOrderEventsDiscardedEvent:
+      return TimeRangeEndingAt(event.out_of_order_events_discarded_event().end_timestamp_ns(),
+                               event.out_of_order_events_discarded_event().duration_ns());
+    case ClientCaptureEvent::kPresentEvent:
+      return TimeRange{event.present_event().begin_timestamp_ns(),
+                       event.present_event().begin_timestamp_ns() +
+                           event.present_event().duration_ns()};
+    case ClientCaptureEvent::kSchedulingSlice:
+      return TimeRangeEndingAt(event.scheduling_slice().out_timestamp_ns(),
+                               event.scheduling_slice().duration_ns());
+    case ClientCaptureEvent::kThreadStateSlice:
+      return TimeRangeEndingAt(event.thread_state_slice().end_timestamp_ns(),
+                               event.thread_state_slice().duration_ns());
+    case ClientCaptureEvent::kTracepointEvent:
+      return TimeRange{event.tracepoint_event().timestamp_ns(),
+                       event.tracepoint_event().timestamp_ns()};
+    default:
+      return std::nullopt;
+  }
+}
+
+[[nodiscard]] bool IsInternedData(const ClientCaptureEvent& event) {
+  return event.event_case() == ClientCaptureEvent::kInternedString ||
+         event.event_case() == ClientCaptureEvent::kInternedCallstack ||
+         event.event_case() == ClientCaptureEvent::kInternedTracepointInfo;
+}
+
+}  // namespace
+
+bool CaptureChunkIndexBuilder::AddEvent(const ClientCaptureEvent& event, uint64_t size) {
+  const auto current_chunk_index = static_cast<uint32_t>(index_.chunks_size());
+
+  switch (event.event_case()) {
+    case ClientCaptureEvent::kInternedString:
+      interned_string_chunk_indices_.insert_or_assign(event.interned_string().key(),
+                                                      current_chunk_index);
+      break;
+    case ClientCaptureEvent::kInternedCallstack:
+      interned_callstack_chunk_indices_.insert_or_assign(event.interned_callstack().key(),
+                                                         current_chunk_index);
+      break;
+    case ClientCaptureEvent::kInternedTracepointInfo:
+      interned_tracepoint_info_chunk_indices_.insert_or_assign(
+          event.interned_tracepoint_info().key(), current_chunk_index);
+      break;
+    case ClientCaptureEvent::kAddressInfo:
+      AddDependencyOnInternedData(interned_string_chunk_indices_,
+                                  event.address_info().function_name_key());
+      AddDependencyOnInternedData(interned_string_chunk_indices_,
+                                  event.address_info().module_name_key());
+      break;
+    case ClientCaptureEvent::kCallstackSample:
+      AddDependencyOnInternedData(interned_callstack_chunk_indices_,
+                                  event.callstack_sample().callstack_id());
+      break;
+    case ClientCaptureEvent::kGpuJob:
+      AddDependencyOnInternedData(interned_string_chunk_indices_, event.gpu_job().timeline_key());
+      break;
+    case ClientCaptureEvent::kGpuQueueSubmission:
+      for (const orbit_grpc_protos::GpuDebugMarker& marker :
+           event.gpu_queue_submission().completed_markers()) {
+        AddDependencyOnInternedData(interned_string_chunk_indices_, marker.text_key());
+      }
+      break;
+    case ClientCaptureEvent::kThreadStateSlice:
+      AddDependencyOnInternedData(interned_callstack_chunk_indices_,
+                                  event.thread_state_slice().switch_out_or_wakeup_callstack_id());
+      break;
+    case ClientCaptureEvent::kTracepointEvent:
+      AddDependencyOnInternedData(interned_tracepoint_info_chunk_indices_,
+                                  event.tracepoint_event().tracepoint_info_key());
+      break;
+    default:
+      break;
+  }
+
+  if (std::optional<TimeRange> time_range = GetTimeRange(event); time_range.has_value()) {
+    if (!current_chunk_has_time_range_) {
+      current_chunk_.set_min_timestamp_ns(time_range->min_ns);
+      current_chunk_.set_max_timestamp_ns(time_range->max_ns);
+      current_chunk_has_time_range_ = true;
+    } else {
+      current_chunk_.set_min_timestamp_ns(
+          std::min(current_chunk_.min_timestamp_ns(), time_range->min_ns));
+      current_chunk_.set_max_timestamp_ns(
+          std::max(current_chunk_.max_timestamp_ns(), time_range->max_ns));
+    }
+  } else if (!IsInternedData(event)) {
+    current_chunk_.set_contains_state_events(true);
+  }
+
+  ++(*current_chunk_.mutable_event_counts())[event.event_case()];
+  current_chunk_.set_event_count(current_chunk_.event_count() + 1);
+  current_chunk_.set_size(current_chunk_.size() + size);
+  if (current_chunk_.size() < target_chunk_size_) return false;
+  FinishCurrentChunk();
+  return true;
+}
+
+void CaptureChunkIndexBuilder::AddDependencyOnInternedData(
+    const absl::flat_hash_map<uint64_t, uint32_t>& chunk_index_by_key, uint64_t key) {
+  auto it = chunk_index_by_key.find(key);
+  // Keys that were never defined, e.g., because the callstack is not set, don't add dependencies.
+  if (it == chunk_index_by_key.end()) return;
+  if (it->second == static_cast<uint32_t>(index_.chunks_size())) return;
+  current_chunk_dependencies_.insert(it->second);
+}
+
+void CaptureChunkIndexBuilder::FinishCurrentChunk() {
+  if (current_chunk_.event_count() == 0) return;
+  current_chunk_.set_offset(next_chunk_offset_);
+  current_chunk_.set_uncompressed_size(current_chunk_.size());
+  current_chunk_.mutable_interned_data_chunk_indices()->Add(current_chunk_dependencies_.begin(),
+                                                             current_chunk_dependencies_.end());
+  next_chunk_offset_ += current_chunk_.size();
+  *index_.add_chunks() = std::move(current_chunk_);
+  current_chunk_.Clear();
+  current_chunk_has_time_range_ = false;
+  current_chunk_dependencies_.clear();
+}
+
+CaptureChunkIndex CaptureChunkIndexBuilder::Build() {
+  FinishCurrentChunk();
+  return std::move(index_);
+}
+
+}  // namespace orbit_capture_file_internal
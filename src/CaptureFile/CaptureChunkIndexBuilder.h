@@ -0,0 +1,53 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_CHUNK_INDEX_BUILDER_H_
+#define CAPTURE_CHUNK_INDEX_BUILDER_H_
+
+#include <absl/container/btree_set.h>
+#include <absl/container/flat_hash_map.h>
+#include <stdint.h>
+
+#include "ClientProtos/capture_chunk_index.pb.h"
+#include "GrpcProtos/capture.pb.h"
+
+namespace orbit_capture_file_internal {
+
+// Splits the sequence of events written to the capture section into chunks of about
+// `target_chunk_size` bytes, and collects what CaptureChunk records about each of them.
+class CaptureChunkIndexBuilder {
+ public:
+  explicit CaptureChunkIndexBuilder(uint64_t target_chunk_size)
+      : target_chunk_size_{target_chunk_size} {}
+
+  // To be called for each event, in the order in which they are written. `size` is the number of
+  // bytes the event takes in the capture section, including its size prefix. Returns whether the
+  // event completed a chunk, i.e., whether the next event starts a new one.
+  bool AddEvent(const orbit_grpc_protos::ClientCaptureEvent& event, uint64_t size);
+
+  // Finishes the last chunk and returns the index.
+  [[nodiscard]] orbit_client_protos::CaptureChunkIndex Build();
+
+ private:
+  void AddDependencyOnInternedData(
+      const absl::flat_hash_map<uint64_t, uint32_t>& chunk_index_by_key, uint64_t key);
+  void FinishCurrentChunk();
+
+  const uint64_t target_chunk_size_;
+  orbit_client_protos::CaptureChunkIndex index_;
+  uint64_t next_chunk_offset_ = 0;
+
+  orbit_client_protos::CaptureChunk current_chunk_;
+  bool current_chunk_has_time_range_ = false;
+  absl::btree_set<uint32_t> current_chunk_dependencies_;
+
+  // For each interned key, the index of the chunk that contains its definition.
+  absl::flat_hash_map<uint64_t, uint32_t> interned_string_chunk_indices_;
+  absl::flat_hash_map<uint64_t, uint32_t> interned_callstack_chunk_indices_;
+  absl::flat_hash_map<uint64_t, uint32_t> interned_tracepoint_info_chunk_indices_;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // CAPTURE_CHUNK_INDEX_BUILDER_H_
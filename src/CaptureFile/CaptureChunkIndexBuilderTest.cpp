@@ -0,0 +1,164 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "CaptureChunkIndexBuilder.h"
+#include "ClientProtos/capture_chunk_index.pb.h"
+#include "GrpcProtos/capture.pb.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_client_protos::CaptureChunk;
+using orbit_client_protos::CaptureChunkIndex;
+using orbit_grpc_protos::ClientCaptureEvent;
+using testing::ElementsAre;
+using testing::IsEmpty;
+using testing::Pair;
+using testing::UnorderedElementsAre;
+
+namespace {
+
+ClientCaptureEvent CreateInternedString(uint64_t key) {
+  ClientCaptureEvent event;
+  event.mutable_interned_string()->set_key(key);
+  event.mutable_interned_string()->set_intern("string");
+  return event;
+}
+
+ClientCaptureEvent CreateInternedCallstack(uint64_t key) {
+  ClientCaptureEvent event;
+  event.mutable_interned_callstack()->set_key(key);
+  return event;
+}
+
+ClientCaptureEvent CreateFunctionCall(uint64_t end_timestamp_ns, uint64_t duration_ns) {
+  ClientCaptureEvent event;
+  event.mutable_function_call()->set_end_timestamp_ns(end_timestamp_ns);
+  event.mutable_function_call()->set_duration_ns(duration_ns);
+  return event;
+}
+
+ClientCaptureEvent CreateCallstackSample(uint64_t timestamp_ns, uint64_t callstack_id) {
+  ClientCaptureEvent event;
+  event.mutable_callstack_sample()->set_timestamp_ns(timestamp_ns);
+  event.mutable_callstack_sample()->set_callstack_id(callstack_id);
+  return event;
+}
+
+ClientCaptureEvent CreateGpuJob(uint64_t begin_timestamp_ns, uint64_t end_timestamp_ns,
+                                uint64_t timeline_key) {
+  ClientCaptureEvent event;
+  event.mutable_gpu_job()->set_amdgpu_cs_ioctl_time_ns(begin_timestamp_ns);
+  event.mutable_gpu_job()->set_dma_fence_signaled_time_ns(end_timestamp_ns);
+  event.mutable_gpu_job()->set_timeline_key(timeline_key);
+  return event;
+}
+
+ClientCaptureEvent CreateThreadName() {
+  ClientCaptureEvent event;
+  event.mutable_thread_name()->set_name("thread");
+  return event;
+}
+
+}  // namespace
+
+TEST(CaptureChunkIndexBuilder, SplitsEventsIntoChunksOfTargetSize) {
+  CaptureChunkIndexBuilder builder{/*target_chunk_size=*/100};
+  for (uint64_t i = 0; i < 25; ++i) {
+    const bool chunk_finished = builder.AddEvent(
+        CreateFunctionCall(/*end_timestamp_ns=*/1000 + i * 10, /*duration_ns=*/5), /*size=*/10);
+    EXPECT_EQ(chunk_finished, i % 10 == 9);
+  }
+  CaptureChunkIndex index = builder.Build();
+
+  ASSERT_EQ(index.chunks_size(), 3);
+  EXPECT_EQ(index.chunks(0).offset(), 0);
+  EXPECT_EQ(index.chunks(0).size(), 100);
+  EXPECT_EQ(index.chunks(0).event_count(), 10);
+  EXPECT_EQ(index.chunks(1).offset(), 100);
+  EXPECT_EQ(index.chunks(1).size(), 100);
+  EXPECT_EQ(index.chunks(2).offset(), 200);
+  EXPECT_EQ(index.chunks(2).size(), 50);
+  EXPECT_EQ(index.chunks(2).event_count(), 5);
+
+  EXPECT_EQ(index.chunks(0).min_timestamp_ns(), 995);
+  EXPECT_EQ(index.chunks(0).max_timestamp_ns(), 1090);
+  EXPECT_EQ(index.chunks(2).min_timestamp_ns(), 1195);
+  EXPECT_EQ(index.chunks(2).max_timestamp_ns(), 1240);
+  for (const CaptureChunk& chunk : index.chunks()) {
+    EXPECT_EQ(chunk.uncompressed_size(), chunk.size());
+    EXPECT_FALSE(chunk.contains_state_events());
+    EXPECT_THAT(chunk.event_counts(),
+                UnorderedElementsAre(Pair(ClientCaptureEvent::kFunctionCall, chunk.event_count())));
+    EXPECT_THAT(chunk.interned_data_chunk_indices(), IsEmpty());
+  }
+}
+
+TEST(CaptureChunkIndexBuilder, BuildWithoutEventsReturnsEmptyIndex) {
+  CaptureChunkIndexBuilder builder{/*target_chunk_size=*/100};
+  EXPECT_EQ(builder.Build().chunks_size(), 0);
+}
+
+TEST(CaptureChunkIndexBuilder, RecordsStateEventsAndEventCounts) {
+  CaptureChunkIndexBuilder builder{/*target_chunk_size=*/100};
+  builder.AddEvent(CreateInternedString(1), /*size=*/10);
+  builder.AddEvent(CreateInternedString(2), /*size=*/10);
+  builder.AddEvent(CreateThreadName(), /*size=*/10);
+  builder.AddEvent(CreateFunctionCall(/*end_timestamp_ns=*/50, /*duration_ns=*/100),
+                   /*size=*/70);
+  builder.AddEvent(CreateInternedCallstack(1), /*size=*/10);
+  CaptureChunkIndex index = builder.Build();
+
+  ASSERT_EQ(index.chunks_size(), 2);
+  EXPECT_TRUE(index.chunks(0).contains_state_events());
+  EXPECT_THAT(index.chunks(0).event_counts(),
+              UnorderedElementsAre(Pair(ClientCaptureEvent::kInternedString, 2),
+                                   Pair(ClientCaptureEvent::kThreadName, 1),
+                                   Pair(ClientCaptureEvent::kFunctionCall, 1)));
+  // The start of the function call would be negative.
+  EXPECT_EQ(index.chunks(0).min_timestamp_ns(), 0);
+  EXPECT_EQ(index.chunks(0).max_timestamp_ns(), 50);
+
+  // Interned data is neither state nor bound to a time range.
+  EXPECT_FALSE(index.chunks(1).contains_state_events());
+  EXPECT_EQ(index.chunks(1).min_timestamp_ns(), 0);
+  EXPECT_EQ(index.chunks(1).max_timestamp_ns(), 0);
+}
+
+TEST(CaptureChunkIndexBuilder, RecordsChunksWithReferencedInternedData) {
+  CaptureChunkIndexBuilder builder{/*target_chunk_size=*/20};
+  // Chunk 0.
+  builder.AddEvent(CreateInternedString(1), /*size=*/10);
+  builder.AddEvent(CreateInternedCallstack(1), /*size=*/10);
+  // Chunk 1.
+  builder.AddEvent(CreateInternedString(2), /*size=*/10);
+  builder.AddEvent(CreateInternedCallstack(2), /*size=*/10);
+  // Chunk 2: references data of chunk 0 and of chunk 1, and a key that was never defined.
+  builder.AddEvent(CreateCallstackSample(/*timestamp_ns=*/100, /*callstack_id=*/2), /*size=*/10);
+  builder.AddEvent(CreateGpuJob(/*begin_timestamp_ns=*/90, /*end_timestamp_ns=*/95,
+                                /*timeline_key=*/1),
+                   /*size=*/5);
+  builder.AddEvent(CreateCallstackSample(/*timestamp_ns=*/101, /*callstack_id=*/42), /*size=*/5);
+  // Chunk 3: references data of chunk 0 and of itself.
+  builder.AddEvent(CreateInternedString(3), /*size=*/10);
+  builder.AddEvent(CreateCallstackSample(/*timestamp_ns=*/102, /*callstack_id=*/1), /*size=*/5);
+  builder.AddEvent(CreateGpuJob(/*begin_timestamp_ns=*/103, /*end_timestamp_ns=*/104,
+                                /*timeline_key=*/3),
+                   /*size=*/5);
+  CaptureChunkIndex index = builder.Build();
+
+  ASSERT_EQ(index.chunks_size(), 4);
+  EXPECT_THAT(index.chunks(0).interned_data_chunk_indices(), IsEmpty());
+  EXPECT_THAT(index.chunks(1).interned_data_chunk_indices(), IsEmpty());
+  EXPECT_THAT(index.chunks(2).interned_data_chunk_indices(), ElementsAre(0, 1));
+  EXPECT_EQ(index.chunks(2).min_timestamp_ns(), 90);
+  EXPECT_EQ(index.chunks(2).max_timestamp_ns(), 101);
+  EXPECT_THAT(index.chunks(3).interned_data_chunk_indices(), ElementsAre(0));
+}
+
+}  // namespace orbit_capture_file_internal
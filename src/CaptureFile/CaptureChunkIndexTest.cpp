@@ -0,0 +1,222 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CaptureFile/BufferOutputStream.h"
+#include "CaptureFile/CaptureChunkIndex.h"
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "CaptureFile/ProtoSectionInputStream.h"
+#include "ClientProtos/capture_chunk_index.pb.h"
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+#include "OrbitBase/WriteStringToFile.h"
+#include "TestUtils/TemporaryDirectory.h"
+#include "TestUtils/TestUtils.h"
+
+namespace orbit_capture_file {
+
+using orbit_client_protos::CaptureChunk;
+using orbit_client_protos::CaptureChunkIndex;
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_test_utils::HasNoError;
+using testing::ElementsAre;
+
+namespace {
+
+class CaptureChunkIndexTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    auto temporary_dir_or_error = orbit_test_utils::TemporaryDirectory::Create();
+    ASSERT_THAT(temporary_dir_or_error, HasNoError());
+    temporary_directory_.emplace(std::move(temporary_dir_or_error.value()));
+    file_path_ = temporary_directory_->GetDirectoryPath() / "capture.orbit";
+  }
+
+  void CheckEachChunkCanBeReadOnItsOwn(const std::vector<ClientCaptureEvent>& events,
+                                       CaptureFileCompression compression);
+
+  std::optional<orbit_test_utils::TemporaryDirectory> temporary_directory_;
+  std::filesystem::path file_path_;
+};
+
+// Mostly function calls, with a GPU job every 100 events. All GPU jobs reference the very first
+// interned string, which makes all chunks with GPU jobs depend on the first chunk.
+[[nodiscard]] std::vector<ClientCaptureEvent> CreateEvents(uint64_t count) {
+  std::vector<ClientCaptureEvent> events;
+  ClientCaptureEvent capture_started;
+  capture_started.mutable_capture_started()->set_process_id(42);
+  events.push_back(std::move(capture_started));
+  for (uint64_t i = 0; i < count; ++i) {
+    ClientCaptureEvent event;
+    if (i % 10'000 == 0) {
+      event.mutable_interned_string()->set_key(i);
+      event.mutable_interned_string()->set_intern("timeline " + std::to_string(i));
+    } else if (i % 100 == 0) {
+      event.mutable_gpu_job()->set_amdgpu_cs_ioctl_time_ns(1000 * i);
+      event.mutable_gpu_job()->set_dma_fence_signaled_time_ns(1000 * i + 10);
+      event.mutable_gpu_job()->set_timeline_key(0);
+    } else {
+      event.mutable_function_call()->set_function_id(i % 7);
+      event.mutable_function_call()->set_end_timestamp_ns(1000 * i + 500);
+      event.mutable_function_call()->set_duration_ns(400);
+    }
+    events.push_back(std::move(event));
+  }
+  ClientCaptureEvent capture_finished;
+  capture_finished.mutable_capture_finished();
+  events.push_back(std::move(capture_finished));
+  return events;
+}
+
+[[nodiscard]] CaptureChunk CreateChunk(uint64_t min_timestamp_ns, uint64_t max_timestamp_ns,
+                                       bool contains_state_events,
+                                       std::vector<uint32_t> interned_data_chunk_indices) {
+  CaptureChunk chunk;
+  chunk.set_min_timestamp_ns(min_timestamp_ns);
+  chunk.set_max_timestamp_ns(max_timestamp_ns);
+  chunk.set_contains_state_events(contains_state_events);
+  chunk.mutable_interned_data_chunk_indices()->Add(interned_data_chunk_indices.begin(),
+                                                   interned_data_chunk_indices.end());
+  return chunk;
+}
+
+}  // namespace
+
+TEST_F(CaptureChunkIndexTest, EachChunkCanBeReadOnItsOwn) {
+  const std::vector<ClientCaptureEvent> events = CreateEvents(200'000);
+  for (CaptureFileCompression compression :
+       {CaptureFileCompression::kNone, CaptureFileCompression::kFast}) {
+    SCOPED_TRACE(static_cast<int>(compression));
+    CheckEachChunkCanBeReadOnItsOwn(events, compression);
+    ASSERT_THAT(orbit_base::RemoveFile(file_path_), HasNoError());
+  }
+}
+
+void CaptureChunkIndexTest::CheckEachChunkCanBeReadOnItsOwn(
+    const std::vector<ClientCaptureEvent>& events, CaptureFileCompression compression) {
+  {
+    auto output_stream_or_error = CaptureFileOutputStream::Create(file_path_, compression);
+    ASSERT_THAT(output_stream_or_error, HasNoError());
+    std::unique_ptr<CaptureFileOutputStream> output_stream =
+        std::move(output_stream_or_error.value());
+    for (const ClientCaptureEvent& event : events) {
+      ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+    }
+    ASSERT_THAT(output_stream->Close(), HasNoError());
+  }
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(file_path_);
+  ASSERT_THAT(capture_file_or_error, HasNoError());
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+  ErrorMessageOr<std::optional<CaptureChunkIndex>> index_or_error =
+      ReadCaptureChunkIndex(capture_file.get());
+  ASSERT_THAT(index_or_error, HasNoError());
+  ASSERT_TRUE(index_or_error.value().has_value());
+  const CaptureChunkIndex& index = index_or_error.value().value();
+  ASSERT_GT(index.chunks_size(), 2);
+
+  uint64_t next_chunk_offset = 0;
+  size_t next_event_index = 0;
+  for (int chunk_index = 0; chunk_index < index.chunks_size(); ++chunk_index) {
+    const CaptureChunk& chunk = index.chunks(chunk_index);
+    EXPECT_EQ(chunk.offset(), next_chunk_offset);
+    next_chunk_offset += chunk.size();
+    if (compression == CaptureFileCompression::kNone) {
+      EXPECT_EQ(chunk.uncompressed_size(), chunk.size());
+    } else {
+      EXPECT_LT(chunk.size(), chunk.uncompressed_size());
+    }
+
+    // Only the first and the last chunk contain CaptureStarted and CaptureFinished, respectively.
+    EXPECT_EQ(chunk.contains_state_events(),
+              chunk_index == 0 || chunk_index == index.chunks_size() - 1);
+    if (chunk_index > 0 && chunk.event_counts().count(ClientCaptureEvent::kGpuJob) > 0) {
+      EXPECT_THAT(chunk.interned_data_chunk_indices(), ElementsAre(0));
+    }
+
+    std::unique_ptr<ProtoSectionInputStream> input_stream =
+        capture_file->CreateCaptureChunkInputStream(chunk.offset(), chunk.size());
+    for (uint64_t i = 0; i < chunk.event_count(); ++i) {
+      ASSERT_LT(next_event_index, events.size());
+      ClientCaptureEvent event;
+      ASSERT_THAT(input_stream->ReadMessage(&event), HasNoError());
+      const ClientCaptureEvent& expected_event = events[next_event_index++];
+      ASSERT_EQ(event.SerializeAsString(), expected_event.SerializeAsString());
+      if (event.has_function_call()) {
+        EXPECT_LE(chunk.min_timestamp_ns(), event.function_call().end_timestamp_ns() - 400);
+        EXPECT_GE(chunk.max_timestamp_ns(), event.function_call().end_timestamp_ns());
+      }
+    }
+  }
+  EXPECT_EQ(next_event_index, events.size());
+}
+
+TEST_F(CaptureChunkIndexTest, FilesWithoutIndexCanStillBeRead) {
+  // Files written to a buffer don't get an index, like files written before the index existed.
+  BufferOutputStream output_buffer;
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      CaptureFileOutputStream::Create(&output_buffer);
+  ClientCaptureEvent event;
+  event.mutable_interned_string()->set_key(42);
+  event.mutable_interned_string()->set_intern("the answer");
+  ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+  ASSERT_THAT(output_stream->Close(), HasNoError());
+  std::vector<unsigned char> buffer = output_buffer.TakeBuffer();
+  std::string content{buffer.begin(), buffer.end()};
+
+  for (uint32_t version : {1, 2, 3}) {
+    // The version follows the file signature.
+    content[4] = static_cast<char>(version);
+    ASSERT_THAT(orbit_base::WriteStringToFile(file_path_, content), HasNoError());
+
+    auto capture_file_or_error = CaptureFile::OpenForReadWrite(file_path_);
+    ASSERT_THAT(capture_file_or_error, HasNoError());
+    std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+    ErrorMessageOr<std::optional<CaptureChunkIndex>> index_or_error =
+        ReadCaptureChunkIndex(capture_file.get());
+    ASSERT_THAT(index_or_error, HasNoError());
+    EXPECT_FALSE(index_or_error.value().has_value());
+
+    ClientCaptureEvent event_from_file;
+    ASSERT_THAT(capture_file->CreateCaptureSectionInputStream()->ReadMessage(&event_from_file),
+                HasNoError());
+    EXPECT_EQ(event_from_file.SerializeAsString(), event.SerializeAsString());
+  }
+}
+
+TEST(FindCaptureChunksToLoad, SelectsChunksInTimeRangeWithStateEventsAndTheirDependencies) {
+  CaptureChunkIndex index;
+  // 0: Interned data and state.
+  *index.add_chunks() = CreateChunk(0, 0, /*contains_state_events=*/true, {});
+  // 1: Interned data, only needed through chunk 3.
+  *index.add_chunks() = CreateChunk(0, 0, /*contains_state_events=*/false, {});
+  // 2: Before the time range, with interned data needed by chunk 4.
+  *index.add_chunks() = CreateChunk(100, 200, /*contains_state_events=*/false, {});
+  // 3: Overlaps the beginning of the time range.
+  *index.add_chunks() = CreateChunk(150, 300, /*contains_state_events=*/false, {0, 1});
+  // 4: Inside the time range.
+  *index.add_chunks() = CreateChunk(300, 400, /*contains_state_events=*/false, {2});
+  // 5: After the time range.
+  *index.add_chunks() = CreateChunk(450, 500, /*contains_state_events=*/false, {0});
+  // 6: After the time range, but with state events.
+  *index.add_chunks() = CreateChunk(500, 600, /*contains_state_events=*/true, {});
+
+  EXPECT_THAT(FindCaptureChunksToLoad(index, 250, 400), ElementsAre(0, 1, 2, 3, 4, 6));
+  EXPECT_THAT(FindCaptureChunksToLoad(index, 420, 440), ElementsAre(0, 6));
+  EXPECT_THAT(FindCaptureChunksToLoad(index, 0, 1000), ElementsAre(0, 1, 2, 3, 4, 5, 6));
+}
+
+}  // namespace orbit_capture_file
@@ -49,11 +49,14 @@ struct CaptureFileHeader {
   uint64_t section_list_offset;
   static constexpr uint64_t kSectionListOffsetFieldOffset =
       kSignatureSize + kFileFormatVersionSize + sizeof(capture_section_offset);
+  // Only stored in the file since kFirstFileVersionWithCaptureSectionCompression.
+  CaptureSectionCompression capture_section_compression;
 };
 
 class CaptureFileImpl : public CaptureFile {
  public:
-  explicit CaptureFileImpl(std::filesystem::path file_path) : file_path_{std::move(file_path)} {}
+  explicit CaptureFileImpl(std::filesystem::path file_path, CaptureFileOptions options)
+      : file_path_{std::move(file_path)}, options_{options} {}
   ~CaptureFileImpl() override = default;
 
   ErrorMessageOr<void> Initialize();
@@ -78,6 +81,14 @@ class CaptureFileImpl : public CaptureFile {
 
   std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStream() override;
 
+  std::unique_ptr<ProtoSectionInputStream> CreateCaptureChunkInputStream(
+      uint64_t offset_in_capture_section, uint64_t size) override;
+
+  [[nodiscard]] CaptureSectionCompression GetCaptureSectionCompression() const override {
+    return header_.capture_section_compression;
+  }
+  [[nodiscard]] uint64_t GetCaptureSectionSize() const override { return capture_section_size_; }
+
   [[nodiscard]] const std::filesystem::path& GetFilePath() const override;
 
   std::unique_ptr<ProtoSectionInputStream> CreateProtoSectionInputStream(
@@ -107,6 +118,7 @@ class CaptureFileImpl : public CaptureFile {
   ErrorMessageOr<bool> ContainsValidUserDataSection() const;
 
   std::filesystem::path file_path_;
+  CaptureFileOptions options_;
   UniqueFd fd_;
   CaptureFileHeader header_{};
 
@@ -220,8 +232,8 @@ ErrorMessageOr<void> ValidateSignature(google::protobuf::io::CodedInputStream* c
   return outcome::success();
 }
 
-ErrorMessageOr<void> ValidateFileVersion(google::protobuf::io::CodedInputStream* coded_input,
-                                         google::protobuf::io::FileInputStream* raw_input) {
+ErrorMessageOr<uint32_t> ValidateFileVersion(google::protobuf::io::CodedInputStream* coded_input,
+                                             google::protobuf::io::FileInputStream* raw_input) {
   uint32_t version{};
   if (!coded_input->ReadLittleEndian32(&version)) {
     return ErrorMessage{
@@ -229,12 +241,12 @@ ErrorMessageOr<void> ValidateFileVersion(google::protobuf::io::CodedInputStream*
                         SafeStrerror(raw_input->GetErrno()))};
   }
 
-  if (version != kFileVersion) {
-    return ErrorMessage{
-        absl::StrFormat("Incompatible version %d, expected %d", version, kFileVersion)};
+  if (version < kMinSupportedFileVersion || version > kFileVersion) {
+    return ErrorMessage{absl::StrFormat("Incompatible version %d, expected %d to %d", version,
+                                        kMinSupportedFileVersion, kFileVersion)};
   }
 
-  return outcome::success();
+  return version;
 }
 
 // Calculates how large (bytes) a section list (with `number_of_sections` sections) is when written
@@ -248,7 +260,7 @@ ErrorMessageOr<void> CaptureFileImpl::ReadHeader() {
   google::protobuf::io::CodedInputStream coded_input{&raw_input};
 
   OUTCOME_TRY(ValidateSignature(&coded_input, &raw_input));
-  OUTCOME_TRY(ValidateFileVersion(&coded_input, &raw_input));
+  OUTCOME_TRY(const uint32_t version, ValidateFileVersion(&coded_input, &raw_input));
 
   CaptureFileHeader header{};
 
@@ -260,6 +272,20 @@ ErrorMessageOr<void> CaptureFileImpl::ReadHeader() {
     return ErrorMessage{"Could not read the section list's offset value"};
   }
 
+  header.capture_section_compression = CaptureSectionCompression::kNone;
+  if (version >= kFirstFileVersionWithCaptureSectionCompression) {
+    uint32_t capture_section_compression{};
+    if (!coded_input.ReadLittleEndian32(&capture_section_compression)) {
+      return ErrorMessage{"Could not read the capture section's compression"};
+    }
+    if (capture_section_compression > static_cast<uint32_t>(CaptureSectionCompression::kZlib)) {
+      return ErrorMessage{absl::StrFormat("Unknown capture section compression %d",
+                                          capture_section_compression)};
+    }
+    header.capture_section_compression =
+        static_cast<CaptureSectionCompression>(capture_section_compression);
+  }
+
   header_ = header;
   return outcome::success();
 }
@@ -369,7 +395,16 @@ ErrorMessageOr<void> CaptureFileImpl::ReadFromSection(uint64_t section_number,
 
 std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateCaptureSectionInputStream() {
   return std::make_unique<orbit_capture_file_internal::ProtoSectionInputStreamImpl>(
-      fd_, header_.capture_section_offset, capture_section_size_);
+      fd_, header_.capture_section_offset, capture_section_size_,
+      header_.capture_section_compression, options_.memory_map_sections);
+}
+
+std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateCaptureChunkInputStream(
+    uint64_t offset_in_capture_section, uint64_t size) {
+  ORBIT_CHECK(offset_in_capture_section + size <= capture_section_size_);
+  return std::make_unique<orbit_capture_file_internal::ProtoSectionInputStreamImpl>(
+      fd_, header_.capture_section_offset + offset_in_capture_section, size,
+      header_.capture_section_compression, options_.memory_map_sections);
 }
 
 std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateProtoSectionInputStream(
@@ -378,7 +413,8 @@ std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateProtoSectionInpu
   const auto& section_info = section_list_[section_number];
 
   return std::make_unique<orbit_capture_file_internal::ProtoSectionInputStreamImpl>(
-      fd_, section_info.offset, section_info.size);
+      fd_, section_info.offset, section_info.size, CaptureSectionCompression::kNone,
+      options_.memory_map_sections);
 }
 
 std::optional<uint64_t> CaptureFileImpl::FindSectionByType(uint64_t section_type) const {
@@ -596,8 +632,8 @@ ErrorMessageOr<uint64_t> CaptureFileImpl::AddAdditionalSectionOfType(uint64_t ne
 }  // namespace
 
 ErrorMessageOr<std::unique_ptr<CaptureFile>> CaptureFile::OpenForReadWrite(
-    const std::filesystem::path& file_path) {
-  auto capture_file = std::make_unique<CaptureFileImpl>(file_path);
+    const std::filesystem::path& file_path, CaptureFileOptions options) {
+  auto capture_file = std::make_unique<CaptureFileImpl>(file_path, options);
   OUTCOME_TRY(capture_file->Initialize());
   return capture_file;
 }
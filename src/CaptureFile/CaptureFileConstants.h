@@ -16,6 +16,11 @@
 constexpr std::string_view kFileSignature = "ORBT";
 static_assert(kFileSignature.size() == 4);
 
-constexpr uint32_t kFileVersion = 1;
+// Version 2 added the capture chunk index section. The capture section itself is unchanged, so
+// files of version 1 can still be read.
+// Version 3 added the compression of the capture section to the header.
+constexpr uint32_t kFileVersion = 3;
+constexpr uint32_t kMinSupportedFileVersion = 1;
+constexpr uint32_t kFirstFileVersionWithCaptureSectionCompression = 3;
 
 #endif  // CAPTURE_FILE_CONSTANTS_H_
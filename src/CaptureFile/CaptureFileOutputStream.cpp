@@ -6,33 +6,105 @@
 
 #include <absl/base/casts.h>
 #include <absl/strings/str_format.h>
+#include <absl/time/time.h>
 #include <errno.h>
 #include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/gzip_stream.h>
 #include <google/protobuf/io/zero_copy_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <stdint.h>
 #include <stdio.h>
 
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
+#include <vector>
 
+#include "AsyncCaptureEventWriter.h"
+#include "CaptureChunkIndexBuilder.h"
 #include "CaptureFile/BufferOutputStream.h"
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureFileSection.h"
 #include "CaptureFileConstants.h"
 #include "OrbitBase/File.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/MakeUniqueForOverwrite.h"
 #include "OrbitBase/SafeStrerror.h"
 
 namespace orbit_capture_file {
 
 namespace {
 
+using orbit_capture_file_internal::AsyncCaptureEventWriter;
+using orbit_capture_file_internal::AsyncCaptureEventWriterStatistics;
+using orbit_capture_file_internal::CaptureChunkIndexBuilder;
+
+// Small enough for time range-limited loading to skip most of a capture, and for loading to be
+// spread evenly across threads, while keeping the index in the order of a thousandth of the file.
+constexpr uint64_t kCaptureChunkSize = 1 << 20;
+
+// Large enough to make the cost of the write calls negligible, small enough to stay in the cache
+// between serializing the events into it and copying it to the page cache.
+constexpr int kFileOutputStreamBlockSize = 64 * 1024;
+
+// Serializing events on a background thread takes more CPU time in total than serializing them on
+// the caller's thread, as the events first have to be copied. This only pays off if the background
+// thread can run on a different core than the caller.
+[[nodiscard]] bool ShouldWriteEventsInBackground() {
+  return std::thread::hardware_concurrency() > 1;
+}
+
+[[nodiscard]] CaptureSectionCompression GetCaptureSectionCompression(
+    CaptureFileCompression compression) {
+  switch (compression) {
+    case CaptureFileCompression::kNone:
+      return CaptureSectionCompression::kNone;
+    case CaptureFileCompression::kFast:
+    case CaptureFileCompression::kSmall:
+      return CaptureSectionCompression::kZlib;
+  }
+  ORBIT_UNREACHABLE();
+}
+
+[[nodiscard]] google::protobuf::io::GzipOutputStream::Options CreateCompressionOptions(
+    CaptureFileCompression compression) {
+  google::protobuf::io::GzipOutputStream::Options options;
+  options.format = google::protobuf::io::GzipOutputStream::ZLIB;
+  options.compression_level = compression == CaptureFileCompression::kSmall ? 9 : 1;
+  return options;
+}
+
+// Appends the index of the chunks of the capture section as an additional section.
+[[nodiscard]] ErrorMessageOr<void> WriteCaptureChunkIndex(
+    const std::filesystem::path& path, const orbit_client_protos::CaptureChunkIndex& index) {
+  OUTCOME_TRY(auto&& capture_file, CaptureFile::OpenForReadWrite(path));
+
+  uint32_t message_size = index.ByteSizeLong();
+  const size_t buf_size =
+      message_size + google::protobuf::io::CodedOutputStream::VarintSize32(message_size);
+  auto buf = make_unique_for_overwrite<uint8_t[]>(buf_size);
+  google::protobuf::io::ArrayOutputStream array_output_stream{buf.get(),
+                                                              static_cast<int>(buf_size)};
+  google::protobuf::io::CodedOutputStream coded_output_stream{&array_output_stream};
+  coded_output_stream.WriteVarint32(message_size);
+  // We do not expect any errors from CodedOutputStream backed by ArrayOutputStream of correct size
+  ORBIT_CHECK(index.SerializeToCodedStream(&coded_output_stream));
+
+  OUTCOME_TRY(auto&& section_number,
+              capture_file->AddAdditionalSectionOfType(kSectionTypeCaptureChunkIndex, buf_size));
+  OUTCOME_TRY(capture_file->WriteToSection(section_number, 0, buf.get(), buf_size));
+  return outcome::success();
+}
+
 class CaptureFileOutputStreamImpl final : public CaptureFileOutputStream {
  public:
-  explicit CaptureFileOutputStreamImpl(std::filesystem::path path)
-      : output_type_(OutputType::kFile), path_{std::move(path)} {}
+  explicit CaptureFileOutputStreamImpl(std::filesystem::path path,
+                                       CaptureFileCompression compression)
+      : output_type_(OutputType::kFile), path_{std::move(path)}, compression_{compression} {}
   explicit CaptureFileOutputStreamImpl(BufferOutputStream* output_buffer)
       : output_type_(OutputType::kBuffer), output_buffer_(output_buffer) {}
   ~CaptureFileOutputStreamImpl() override;
@@ -46,7 +118,14 @@ class CaptureFileOutputStreamImpl final : public CaptureFileOutputStream {
  private:
   void Reset();
   [[nodiscard]] ErrorMessageOr<void> WriteHeader();
-  [[nodiscard]] std::string_view GetErrorFromOutputStream() const;
+  // Serializes `event` to the capture section. With an AsyncCaptureEventWriter, this is called on
+  // its background thread, which then is the only thread accessing the streams until Flush.
+  [[nodiscard]] ErrorMessageOr<void> SerializeEvent(
+      const orbit_grpc_protos::ClientCaptureEvent& event);
+  void StartCompressedChunk();
+  // Ends the zlib stream of the current chunk and records where the chunk ended up in the file.
+  [[nodiscard]] ErrorMessageOr<void> FinishCompressedChunk();
+  [[nodiscard]] std::string GetErrorFromOutputStream() const;
   // Handles write error by cleaning up the file and generating error message.
   [[nodiscard]] ErrorMessage HandleWriteError(const char* section_name,
                                               std::string_view original_error);
@@ -61,6 +140,20 @@ class CaptureFileOutputStreamImpl final : public CaptureFileOutputStream {
   BufferOutputStream* output_buffer_ = nullptr;
   std::unique_ptr<google::protobuf::io::ZeroCopyOutputStream> zero_copy_output_stream_;
   std::optional<google::protobuf::io::CodedOutputStream> coded_output_;
+  // Only for OutputType::kFile, as the index is written as an additional section.
+  std::optional<CaptureChunkIndexBuilder> chunk_index_builder_;
+  // Only for OutputType::kFile, and only if the events are serialized on a background thread.
+  std::unique_ptr<AsyncCaptureEventWriter> async_event_writer_;
+
+  CaptureFileCompression compression_ = CaptureFileCompression::kNone;
+  // Only set while the events of a chunk are being written to a compressed capture section.
+  // coded_output_ then writes to this instead of directly to zero_copy_output_stream_.
+  std::optional<google::protobuf::io::GzipOutputStream> compressing_output_stream_;
+  int64_t capture_section_offset_ = 0;
+  int64_t compressed_chunk_offset_ = 0;
+  // The offset in the capture section and the size of each finished compressed chunk. These replace
+  // the uncompressed ones in the index.
+  std::vector<std::pair<uint64_t, uint64_t>> compressed_chunk_offsets_and_sizes_;
 };
 
 CaptureFileOutputStreamImpl::~CaptureFileOutputStreamImpl() {
@@ -85,8 +178,9 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::Initialize() {
       fd_ = std::move(fd_or_error.value());
       ORBIT_CHECK(fd_.valid());
 
-      zero_copy_output_stream_ =
-          std::make_unique<google::protobuf::io::FileOutputStream>(fd_.get());
+      zero_copy_output_stream_ = std::make_unique<google::protobuf::io::FileOutputStream>(
+          fd_.get(), kFileOutputStreamBlockSize);
+      chunk_index_builder_.emplace(kCaptureChunkSize);
       break;
     }
   }
@@ -97,24 +191,114 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::Initialize() {
     return result.error();
   }
 
+  if (compression_ != CaptureFileCompression::kNone) {
+    // Only the capture section is compressed. Its first chunk is started by the first event.
+    coded_output_.reset();
+    capture_section_offset_ = zero_copy_output_stream_->ByteCount();
+  }
+
+  if (output_type_ == OutputType::kFile && ShouldWriteEventsInBackground()) {
+    // Only started now, as from here on the background thread owns the streams.
+    async_event_writer_ = std::make_unique<AsyncCaptureEventWriter>(
+        [this](const orbit_grpc_protos::ClientCaptureEvent& event) {
+          return SerializeEvent(event);
+        });
+  }
+
   return outcome::success();
 }
 
-ErrorMessageOr<void> CaptureFileOutputStreamImpl::Close() {
+void CaptureFileOutputStreamImpl::StartCompressedChunk() {
+  ORBIT_CHECK(!compressing_output_stream_.has_value());
+  compressed_chunk_offset_ = zero_copy_output_stream_->ByteCount();
+  compressing_output_stream_.emplace(zero_copy_output_stream_.get(),
+                                     CreateCompressionOptions(compression_));
+  coded_output_.emplace(&compressing_output_stream_.value());
+}
+
+ErrorMessageOr<void> CaptureFileOutputStreamImpl::FinishCompressedChunk() {
+  ORBIT_CHECK(compressing_output_stream_.has_value());
   coded_output_->Trim();
-  if (coded_output_->HadError()) {
-    return HandleWriteError("Unknown", GetErrorFromOutputStream());
+  if (coded_output_->HadError()) return ErrorMessage{GetErrorFromOutputStream()};
+  coded_output_.reset();
+  if (!compressing_output_stream_->Close()) return ErrorMessage{GetErrorFromOutputStream()};
+  compressing_output_stream_.reset();
+
+  const int64_t compressed_chunk_end = zero_copy_output_stream_->ByteCount();
+  compressed_chunk_offsets_and_sizes_.emplace_back(
+      compressed_chunk_offset_ - capture_section_offset_,
+      compressed_chunk_end - compressed_chunk_offset_);
+  return outcome::success();
+}
+
+ErrorMessageOr<void> CaptureFileOutputStreamImpl::Close() {
+  if (async_event_writer_ != nullptr) {
+    if (auto flush_result = async_event_writer_->Flush(); flush_result.has_error()) {
+      return HandleWriteError("Capture", flush_result.error().message());
+    }
+    AsyncCaptureEventWriterStatistics statistics = async_event_writer_->GetStatistics();
+    ORBIT_LOG(
+        "Wrote %u events to \"%s\" in %u batches in the background, which took %.3f ms; at most "
+        "%u batches were waiting to be written; waited %u times for %.3f ms in total for the "
+        "file to catch up",
+        statistics.events_written, path_.string(), statistics.batches_written,
+        absl::ToDoubleMilliseconds(statistics.write_duration), statistics.max_queue_depth,
+        statistics.wait_count, absl::ToDoubleMilliseconds(statistics.wait_duration));
+    async_event_writer_.reset();
+  }
+  if (compressing_output_stream_.has_value()) {
+    if (auto result = FinishCompressedChunk(); result.has_error()) {
+      return HandleWriteError("Capture", result.error().message());
+    }
+  }
+  if (coded_output_.has_value()) {
+    coded_output_->Trim();
+    if (coded_output_->HadError()) {
+      return HandleWriteError("Unknown", GetErrorFromOutputStream());
+    }
+  }
+  if (output_type_ == OutputType::kFile) {
+    coded_output_.reset();
+    auto* file_output_stream =
+        static_cast<google::protobuf::io::FileOutputStream*>(zero_copy_output_stream_.get());
+    if (!file_output_stream->Flush()) {
+      return HandleWriteError("Capture", GetErrorFromOutputStream());
+    }
   }
   Reset();
 
+  if (chunk_index_builder_.has_value()) {
+    orbit_client_protos::CaptureChunkIndex index = chunk_index_builder_->Build();
+    chunk_index_builder_.reset();
+    if (compression_ != CaptureFileCompression::kNone) {
+      ORBIT_CHECK(static_cast<size_t>(index.chunks_size()) ==
+                  compressed_chunk_offsets_and_sizes_.size());
+      uint64_t compressed_size = 0;
+      for (int i = 0; i < index.chunks_size(); ++i) {
+        const auto& [offset, size] = compressed_chunk_offsets_and_sizes_[i];
+        index.mutable_chunks(i)->set_offset(offset);
+        index.mutable_chunks(i)->set_size(size);
+        compressed_size += size;
+      }
+      ORBIT_LOG("Compressed the capture section of \"%s\" to %u bytes in %u chunks",
+                path_.string(), compressed_size, index.chunks_size());
+    }
+    if (auto result = WriteCaptureChunkIndex(path_, index); result.has_error()) {
+      return HandleWriteError("Capture chunk index", result.error().message());
+    }
+  }
+
   return outcome::success();
 }
 
 void CaptureFileOutputStreamImpl::Reset() {
+  // Stop the background thread before destroying the streams it writes to.
+  async_event_writer_.reset();
   // Destroy coded_output_ before destroying the underlaying ZeroCopyOutputStream to guarantee that
   // coded_output_ flushes all data to the underlaying ZeroCopyOutputStream and trims the unused
   // bytes.
   coded_output_.reset();
+  compressing_output_stream_.reset();
   zero_copy_output_stream_.reset(nullptr);
   fd_.release();
   output_buffer_ = nullptr;
@@ -139,13 +323,21 @@ void CaptureFileOutputStreamImpl::CloseAndTryRemoveFileAfterError() {
   }
 }
 
-std::string_view CaptureFileOutputStreamImpl::GetErrorFromOutputStream() const {
+std::string CaptureFileOutputStreamImpl::GetErrorFromOutputStream() const {
   // There should not be any write error in the case of `OutputType::kBuffer` as we do not limit the
   // buffer size of BufferOutputStream.
   ORBIT_CHECK(output_type_ == OutputType::kFile);
   auto* file_output_stream =
       static_cast<google::protobuf::io::FileOutputStream*>(zero_copy_output_stream_.get());
-  return SafeStrerror(file_output_stream->GetErrno());
+  if (file_output_stream->GetErrno() != 0) return SafeStrerror(file_output_stream->GetErrno());
+  if (compressing_output_stream_.has_value() &&
+      compressing_output_stream_->ZlibErrorMessage() != nullptr) {
+    return absl::StrFormat("Unable to compress: %s",
+                           compressing_output_stream_->ZlibErrorMessage());
+  }
+  // The CodedOutputStream could have failed for reasons other than a write error, e.g., a message
+  // larger than 2 GB.
+  return "Unknown error";
 }
 
 ErrorMessage CaptureFileOutputStreamImpl::HandleWriteError(const char* section_name,
@@ -159,13 +351,32 @@ ErrorMessage CaptureFileOutputStreamImpl::HandleWriteError(const char* section_n
 
 ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteCaptureEvent(
     const orbit_grpc_protos::ClientCaptureEvent& event) {
-  ORBIT_CHECK(coded_output_.has_value());
   ORBIT_CHECK(zero_copy_output_stream_ != nullptr);
+  ErrorMessageOr<void> result = async_event_writer_ != nullptr
+                                    ? async_event_writer_->AddEvent(event)
+                                    : SerializeEvent(event);
+  if (result.has_error()) return HandleWriteError("Capture", result.error().message());
+  return outcome::success();
+}
+
+ErrorMessageOr<void> CaptureFileOutputStreamImpl::SerializeEvent(
+    const orbit_grpc_protos::ClientCaptureEvent& event) {
+  if (compression_ != CaptureFileCompression::kNone && !compressing_output_stream_.has_value()) {
+    StartCompressedChunk();
+  }
+  ORBIT_CHECK(coded_output_.has_value());
 
   uint32_t event_size = event.ByteSizeLong();
   coded_output_->WriteVarint32(event_size);
   if (!event.SerializeToCodedStream(&coded_output_.value()) || coded_output_->HadError()) {
-    return HandleWriteError("Capture", GetErrorFromOutputStream());
+    return ErrorMessage{GetErrorFromOutputStream()};
+  }
+  if (chunk_index_builder_.has_value()) {
+    const bool chunk_finished = chunk_index_builder_->AddEvent(
+        event, google::protobuf::io::CodedOutputStream::VarintSize32(event_size) + event_size);
+    if (chunk_finished && compressing_output_stream_.has_value()) {
+      OUTCOME_TRY(FinishCompressedChunk());
+    }
   }
 
   return outcome::success();
@@ -179,14 +390,22 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteHeader() {
   // signature - 4bytes, version - 4bytes
   // capture section offset - 8 bytes
   // additional section offset - 8 bytes
-  uint64_t capture_section_offset =
-      kFileSignature.size() + sizeof(kFileVersion) + 2 * sizeof(uint64_t);
+  // capture section compression - 4 bytes, reserved - 4 bytes
+  uint64_t capture_section_offset = kFileSignature.size() + sizeof(kFileVersion) +
+                                    2 * sizeof(uint64_t) + 2 * sizeof(uint32_t);
   header.append(std::string_view(absl::bit_cast<char*>(&capture_section_offset),
                                  sizeof(capture_section_offset)));
-  uint64_t additional_section_list_offset =
-      0;  // For the streaming format we have no additional sections
+  // Additional sections, if any, are only added by Close, once all events have been written.
+  uint64_t additional_section_list_offset = 0;
   header.append(std::string_view(absl::bit_cast<char*>(&additional_section_list_offset),
                                  sizeof(additional_section_list_offset)));
+  const auto capture_section_compression =
+      static_cast<uint32_t>(GetCaptureSectionCompression(compression_));
+  header.append(std::string_view(absl::bit_cast<const char*>(&capture_section_compression),
+                                 sizeof(capture_section_compression)));
+  // Keeps the capture section aligned to 8 bytes.
+  constexpr uint32_t kReserved = 0;
+  header.append(std::string_view(absl::bit_cast<const char*>(&kReserved), sizeof(kReserved)));
 
   ORBIT_CHECK(capture_section_offset == header.size());
 
@@ -200,9 +419,17 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteHeader() {
 
 }  // namespace
 
+ErrorMessageOr<CaptureFileCompression> ParseCaptureFileCompression(std::string_view name) {
+  if (name == "none") return CaptureFileCompression::kNone;
+  if (name == "fast") return CaptureFileCompression::kFast;
+  if (name == "small") return CaptureFileCompression::kSmall;
+  return ErrorMessage{absl::StrFormat(
+      R"(Unknown capture file compression "%s", expected "none", "fast" or "small")", name)};
+}
+
 ErrorMessageOr<std::unique_ptr<CaptureFileOutputStream>> CaptureFileOutputStream::Create(
-    std::filesystem::path path) {
-  auto implementation = std::make_unique<CaptureFileOutputStreamImpl>(std::move(path));
+    std::filesystem::path path, CaptureFileCompression compression) {
+  auto implementation = std::make_unique<CaptureFileOutputStreamImpl>(std::move(path), compression);
   auto init_result = implementation->Initialize();
   if (init_result.has_error()) {
     return init_result.error();
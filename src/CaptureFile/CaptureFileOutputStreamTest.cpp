@@ -17,9 +17,12 @@
 #include <vector>
 
 #include "CaptureFile/BufferOutputStream.h"
+#include "CaptureFile/CaptureFile.h"
 #include "CaptureFile/CaptureFileOutputStream.h"
 #include "CaptureFileConstants.h"
 #include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Logging.h"
 #include "OrbitBase/ReadFileToString.h"
 #include "OrbitBase/Result.h"
 #include "TestUtils/TemporaryDirectory.h"
@@ -57,11 +60,11 @@ TEST(CaptureFileOutputStream, Smoke) {
   };
 
   auto check_output_stream_content = [&](std::string_view stream_content) {
-    ASSERT_GT(stream_content.size(), 24);
+    ASSERT_GT(stream_content.size(), 32);
     ASSERT_EQ(stream_content.substr(0, 4), kFileSignature);
     uint64_t capture_section_offset = 0;
     memcpy(&capture_section_offset, stream_content.data() + 8, sizeof(capture_section_offset));
-    ASSERT_EQ(capture_section_offset, 24);
+    ASSERT_EQ(capture_section_offset, 32);
 
     google::protobuf::io::ArrayInputStream input_stream(
         stream_content.data() + capture_section_offset,
@@ -127,6 +130,92 @@ TEST(CaptureFileOutputStream, Smoke) {
   }
 }
 
+static orbit_grpc_protos::ClientCaptureEvent CreateFunctionCallCaptureEvent(uint64_t index) {
+  orbit_grpc_protos::ClientCaptureEvent event;
+  orbit_grpc_protos::FunctionCall* function_call = event.mutable_function_call();
+  function_call->set_pid(42);
+  function_call->set_tid(42 + index % 16);
+  function_call->set_function_id(index % 1000);
+  function_call->set_duration_ns(index % 10'000);
+  function_call->set_end_timestamp_ns(1'000'000'000 + index * 1000);
+  function_call->set_depth(static_cast<int32_t>(index % 8));
+  function_call->set_return_value(index);
+  return event;
+}
+
+// Writes enough events to fill many of the buffers that are written to the file in the background,
+// reads them back, and returns the size of the file.
+static uint64_t WriteManyEventsAndReadThemBack(CaptureFileCompression compression,
+                                               CaptureFileOptions read_options = {}) {
+  auto temporary_dir_or_error = orbit_test_utils::TemporaryDirectory::Create();
+  ORBIT_CHECK(temporary_dir_or_error.has_value());
+  orbit_test_utils::TemporaryDirectory temporary_dir = std::move(temporary_dir_or_error.value());
+  std::filesystem::path file_path = temporary_dir.GetDirectoryPath() / "capture.orbit";
+
+  constexpr uint64_t kEventCount = 1'000'000;
+  {
+    auto output_stream_or_error = CaptureFileOutputStream::Create(file_path, compression);
+    EXPECT_TRUE(output_stream_or_error.has_value()) << output_stream_or_error.error().message();
+    if (output_stream_or_error.has_error()) return 0;
+    std::unique_ptr<CaptureFileOutputStream> output_stream =
+        std::move(output_stream_or_error.value());
+    for (uint64_t i = 0; i < kEventCount; ++i) {
+      auto write_result = output_stream->WriteCaptureEvent(CreateFunctionCallCaptureEvent(i));
+      EXPECT_FALSE(write_result.has_error()) << write_result.error().message();
+      if (write_result.has_error()) return 0;
+    }
+    orbit_grpc_protos::ClientCaptureEvent capture_finished_event;
+    capture_finished_event.mutable_capture_finished();
+    auto write_result = output_stream->WriteCaptureEvent(capture_finished_event);
+    EXPECT_FALSE(write_result.has_error()) << write_result.error().message();
+    auto close_result = output_stream->Close();
+    EXPECT_FALSE(close_result.has_error()) << close_result.error().message();
+  }
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(file_path, read_options);
+  EXPECT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+  if (capture_file_or_error.has_error()) return 0;
+  EXPECT_EQ(capture_file_or_error.value()->GetCaptureSectionCompression(),
+            compression == CaptureFileCompression::kNone ? CaptureSectionCompression::kNone
+                                                         : CaptureSectionCompression::kZlib);
+  std::unique_ptr<ProtoSectionInputStream> input_stream =
+      capture_file_or_error.value()->CreateCaptureSectionInputStream();
+  orbit_grpc_protos::ClientCaptureEvent event;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    auto read_result = input_stream->ReadMessage(&event);
+    EXPECT_FALSE(read_result.has_error()) << read_result.error().message();
+    if (read_result.has_error()) return 0;
+    EXPECT_EQ(event.SerializeAsString(), CreateFunctionCallCaptureEvent(i).SerializeAsString());
+  }
+  auto read_result = input_stream->ReadMessage(&event);
+  EXPECT_FALSE(read_result.has_error()) << read_result.error().message();
+  EXPECT_EQ(event.event_case(), orbit_grpc_protos::ClientCaptureEvent::kCaptureFinished);
+
+  auto file_size_or_error = orbit_base::FileSize(file_path);
+  ORBIT_CHECK(file_size_or_error.has_value());
+  return file_size_or_error.value();
+}
+
+TEST(CaptureFileOutputStream, ManyEventsCanBeReadBackFromFile) {
+  WriteManyEventsAndReadThemBack(CaptureFileCompression::kNone);
+}
+
+TEST(CaptureFileOutputStream, ManyEventsCanBeReadBackFromCompressedFile) {
+  const uint64_t uncompressed_file_size =
+      WriteManyEventsAndReadThemBack(CaptureFileCompression::kNone);
+  const uint64_t fast_file_size = WriteManyEventsAndReadThemBack(CaptureFileCompression::kFast);
+  const uint64_t small_file_size = WriteManyEventsAndReadThemBack(CaptureFileCompression::kSmall);
+  EXPECT_LT(fast_file_size, uncompressed_file_size / 2);
+  EXPECT_LE(small_file_size, fast_file_size);
+}
+
+TEST(CaptureFileOutputStream, ManyEventsCanBeReadBackFromFileWithMemoryMapping) {
+  CaptureFileOptions read_options;
+  read_options.memory_map_sections = true;
+  WriteManyEventsAndReadThemBack(CaptureFileCompression::kNone, read_options);
+  WriteManyEventsAndReadThemBack(CaptureFileCompression::kFast, read_options);
+}
+
 TEST(CaptureFileOutputStream, WriteAfterClose) {
   auto check_write_after_close = [&](CaptureFileOutputStream* output_stream) {
     EXPECT_TRUE(output_stream->IsOpen());
@@ -165,4 +254,19 @@ TEST(CaptureFileOutputStream, WriteAfterClose) {
   }
 }
 
+TEST(CaptureFileOutputStream, ParseCaptureFileCompression) {
+  for (const auto& [name, compression] : {std::pair{"none", CaptureFileCompression::kNone},
+                                          std::pair{"fast", CaptureFileCompression::kFast},
+                                          std::pair{"small", CaptureFileCompression::kSmall}}) {
+    ErrorMessageOr<CaptureFileCompression> compression_or_error = ParseCaptureFileCompression(name);
+    ASSERT_TRUE(compression_or_error.has_value()) << compression_or_error.error().message();
+    EXPECT_EQ(compression_or_error.value(), compression);
+  }
+
+  ErrorMessageOr<CaptureFileCompression> compression_or_error = ParseCaptureFileCompression("zstd");
+  ASSERT_TRUE(compression_or_error.has_error());
+  EXPECT_EQ(compression_or_error.error().message(),
+            R"(Unknown capture file compression "zstd", expected "none", "fast" or "small")");
+}
+
 }  // namespace orbit_capture_file
\ No newline at end of file
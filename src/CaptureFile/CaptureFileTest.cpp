@@ -9,6 +9,7 @@
 #include <gtest/gtest.h>
 #include <stddef.h>
 
+#include <array>
 #include <cstdint>
 #include <filesystem>
 #include <memory>
@@ -19,10 +20,12 @@
 #include <utility>
 #include <vector>
 
+#include "CaptureFile/CaptureChunkIndex.h"
 #include "CaptureFile/CaptureFile.h"
 #include "CaptureFile/CaptureFileOutputStream.h"
 #include "CaptureFile/CaptureFileSection.h"
 #include "CaptureFile/ProtoSectionInputStream.h"
+#include "ClientProtos/capture_chunk_index.pb.h"
 #include "GrpcProtos/capture.pb.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
 #include "OrbitBase/Result.h"
@@ -191,11 +194,29 @@ TEST_F(CaptureFileTest, CreateCaptureFileAndReadMainSection) {
   VerifyCaptureSectionContent(capture_section);
 }
 
+TEST_F(CaptureFileTest, ReadMainSectionAndChunkIndexWithMemoryMapping) {
+  CaptureFileOptions options;
+  options.memory_map_sections = true;
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(GetCaptureFilePath(), options);
+  ASSERT_THAT(capture_file_or_error, HasNoError());
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+
+  VerifyCaptureSectionContent(capture_file->CreateCaptureSectionInputStream());
+
+  ErrorMessageOr<std::optional<orbit_client_protos::CaptureChunkIndex>> index_or_error =
+      ReadCaptureChunkIndex(capture_file.get());
+  ASSERT_THAT(index_or_error, HasNoError());
+  ASSERT_TRUE(index_or_error.value().has_value());
+  ASSERT_EQ(index_or_error.value()->chunks_size(), 1);
+  EXPECT_EQ(index_or_error.value()->chunks(0).event_count(), 2);
+}
+
 TEST_F(CaptureFileTest, CreateCaptureFileWriteAdditionalSectionAndReadMainSection) {
   constexpr size_t kUserDataSectionSize = 333;
   auto section_number_or_error = capture_file_->AddUserDataSection(kUserDataSectionSize);
-  ASSERT_THAT(section_number_or_error, HasValue(0));
-  ASSERT_EQ(capture_file_->GetSectionList().size(), 1);
+  // Section 0 is the capture chunk index written by CaptureFileOutputStream.
+  ASSERT_THAT(section_number_or_error, HasValue(1));
+  ASSERT_EQ(capture_file_->GetSectionList().size(), 2);
 
   VerifySingleUserDataSectionExistsAtEnd(kUserDataSectionSize);
 
@@ -228,7 +249,8 @@ TEST_F(CaptureFileTest, CreateCaptureFileWriteAdditionalSectionAndReadMainSectio
 }
 
 TEST_F(CaptureFileTest, CreateCaptureFileAndAddUserDataSection) {
-  EXPECT_EQ(capture_file_->GetSectionList().size(), 0);
+  // The capture chunk index written by CaptureFileOutputStream.
+  EXPECT_EQ(capture_file_->GetSectionList().size(), 1);
 
   uint64_t buf_size{};
   {
@@ -244,8 +266,8 @@ TEST_F(CaptureFileTest, CreateCaptureFileAndAddUserDataSection) {
     coded_output_stream.WriteVarint32(event.ByteSizeLong());
     ASSERT_TRUE(event.SerializeToCodedStream(&coded_output_stream));
     auto section_number_or_error = capture_file_->AddUserDataSection(buf_size);
-    ASSERT_THAT(section_number_or_error, HasValue(0));
-    ASSERT_EQ(capture_file_->GetSectionList().size(), 1);
+    ASSERT_THAT(section_number_or_error, HasValue(1));
+    ASSERT_EQ(capture_file_->GetSectionList().size(), 2);
 
     VerifySingleUserDataSectionExistsAtEnd(buf_size);
 
@@ -253,14 +275,14 @@ TEST_F(CaptureFileTest, CreateCaptureFileAndAddUserDataSection) {
     const std::string something{"something"};
     constexpr uint64_t kOffsetInSection = 5;
     auto write_to_section_result =
-        capture_file_->WriteToSection(0, kOffsetInSection, something.c_str(), something.size());
+        capture_file_->WriteToSection(1, kOffsetInSection, something.c_str(), something.size());
     ASSERT_THAT(write_to_section_result, HasNoError());
 
     {
       std::string content;
       content.resize(something.size());
       auto read_result =
-          capture_file_->ReadFromSection(0, kOffsetInSection, content.data(), something.size());
+          capture_file_->ReadFromSection(1, kOffsetInSection, content.data(), something.size());
       ASSERT_THAT(read_result, HasNoError());
       EXPECT_EQ(content, something);
     }
@@ -271,7 +293,7 @@ TEST_F(CaptureFileTest, CreateCaptureFileAndAddUserDataSection) {
   }
 
   {
-    const auto& capture_file_section = capture_file_->GetSectionList()[0];
+    const auto& capture_file_section = capture_file_->GetSectionList()[1];
     EXPECT_EQ(capture_file_section.size, buf_size);
     EXPECT_GT(capture_file_section.offset, 0);
     EXPECT_EQ(capture_file_section.type, kSectionTypeUserData);
@@ -282,9 +304,9 @@ TEST_F(CaptureFileTest, CreateCaptureFileAndAddUserDataSection) {
   // Reopen the file to make sure this information was saved
   OpenTemporayFileAsCaptureFile();
 
-  EXPECT_EQ(capture_file_->GetSectionList().size(), 1);
+  EXPECT_EQ(capture_file_->GetSectionList().size(), 2);
   {
-    const auto& capture_file_section = capture_file_->GetSectionList()[0];
+    const auto& capture_file_section = capture_file_->GetSectionList()[1];
     EXPECT_EQ(capture_file_section.type, kSectionTypeUserData);
     EXPECT_GT(capture_file_section.offset, 0);
     EXPECT_EQ(capture_file_section.size, buf_size);
@@ -293,7 +315,7 @@ TEST_F(CaptureFileTest, CreateCaptureFileAndAddUserDataSection) {
   VerifySingleUserDataSectionExistsAtEnd(buf_size);
 
   {
-    auto section_input_stream = capture_file_->CreateProtoSectionInputStream(0);
+    auto section_input_stream = capture_file_->CreateProtoSectionInputStream(1);
     ASSERT_NE(section_input_stream.get(), nullptr);
     ClientCaptureEvent event_from_file;
     ASSERT_THAT(section_input_stream->ReadMessage(&event_from_file), HasNoError());
@@ -303,6 +325,22 @@ TEST_F(CaptureFileTest, CreateCaptureFileAndAddUserDataSection) {
   }
 }
 
+TEST_F(CaptureFileTest, ReadMessageReturnsErrorIfMessageCannotBeParsed) {
+  // A message of size 2 with a length-delimited field 1 whose length goes beyond the message.
+  constexpr std::array<uint8_t, 3> kMessage{2, 0x0a, 0x05};
+  auto section_number_or_error = capture_file_->AddUserDataSection(kMessage.size());
+  ASSERT_THAT(section_number_or_error, HasValue(1));
+  ASSERT_THAT(capture_file_->WriteToSection(section_number_or_error.value(), 0, kMessage.data(),
+                                            kMessage.size()),
+              HasNoError());
+
+  auto section_input_stream = capture_file_->CreateProtoSectionInputStream(1);
+  ASSERT_NE(section_input_stream.get(), nullptr);
+  ClientCaptureEvent event;
+  EXPECT_THAT(section_input_stream->ReadMessage(&event),
+              HasError("Unable to parse the message of size 2"));
+}
+
 TEST_F(CaptureFileHeaderTest, OpenCaptureFileInvalidSignature) {
   EXPECT_THAT(
       orbit_base::WriteStringToFile(GetCaptureFilePath(), "This is not an Orbit Capture File"),
@@ -337,7 +375,20 @@ TEST_F(CaptureFileHeaderTest, OpenCaptureFileInvalidVersion) {
   EXPECT_THAT(orbit_base::WriteStringToFile(GetCaptureFilePath(), header), HasNoError());
 
   auto capture_file_or_error = CaptureFile::OpenForReadWrite(GetCaptureFilePath());
-  EXPECT_THAT(capture_file_or_error, HasError("Incompatible version 0, expected 1"));
+  EXPECT_THAT(capture_file_or_error, HasError("Incompatible version 0, expected 1 to 3"));
+}
+
+TEST_F(CaptureFileHeaderTest, OpenCaptureFileUnknownCaptureSectionCompression) {
+  std::string header = CreateHeader(3, 32, 0);
+  constexpr uint32_t kCaptureSectionCompression = 42;
+  header.append(std::string_view{absl::bit_cast<const char*>(&kCaptureSectionCompression),
+                                 sizeof(kCaptureSectionCompression)});
+  header.append(std::string_view{"\0\0\0\0", 4});
+
+  EXPECT_THAT(orbit_base::WriteStringToFile(GetCaptureFilePath(), header), HasNoError());
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(GetCaptureFilePath());
+  EXPECT_THAT(capture_file_or_error, HasError("Unknown capture section compression 42"));
 }
 
 TEST_F(CaptureFileHeaderTest, OpenCaptureFileInvalidSectionListSize) {
@@ -367,7 +418,8 @@ TEST_F(CaptureFileHeaderTest, OpenCaptureFileInvalidSectionListSizeTooLarge) {
 }
 
 TEST_F(CaptureFileTest, AddSectionOfTypeNoUserDataSection) {
-  EXPECT_EQ(capture_file_->GetSectionList().size(), 0);
+  // The capture chunk index written by CaptureFileOutputStream.
+  EXPECT_EQ(capture_file_->GetSectionList().size(), 1);
 
   AddSectionOfTypeAndCheckInvariants(5, 10);
   AddSectionOfTypeAndCheckInvariants(5, 200);
@@ -375,19 +427,20 @@ TEST_F(CaptureFileTest, AddSectionOfTypeNoUserDataSection) {
   AddSectionOfTypeAndCheckInvariants(200, 10);
   AddSectionOfTypeAndCheckInvariants(200, 100);
 
-  EXPECT_EQ(capture_file_->GetSectionList().size(), 4);
+  EXPECT_EQ(capture_file_->GetSectionList().size(), 5);
 }
 
 TEST_F(CaptureFileTest, AddSectionOfTypeContainsUserDataSection) {
-  EXPECT_EQ(capture_file_->GetSectionList().size(), 0);
+  // The capture chunk index written by CaptureFileOutputStream.
+  EXPECT_EQ(capture_file_->GetSectionList().size(), 1);
 
   std::string something{"something"};
   const size_t something_size = something.size();
 
   const ErrorMessageOr<uint64_t> user_data_index_or_error =
       capture_file_->AddUserDataSection(something_size);
-  ASSERT_THAT(user_data_index_or_error, HasValue(0));
-  EXPECT_EQ(capture_file_->GetSectionList().size(), 1);
+  ASSERT_THAT(user_data_index_or_error, HasValue(1));
+  EXPECT_EQ(capture_file_->GetSectionList().size(), 2);
 
   const ErrorMessageOr<void> write_result = capture_file_->WriteToSection(
       user_data_index_or_error.value(), 0, something.data(), something_size);
@@ -398,13 +451,13 @@ TEST_F(CaptureFileTest, AddSectionOfTypeContainsUserDataSection) {
 
   // open again
   OpenTemporayFileAsCaptureFile();
-  EXPECT_EQ(capture_file_->GetSectionList().size(), 3);
+  EXPECT_EQ(capture_file_->GetSectionList().size(), 4);
 
   VerifySingleUserDataSectionExistsAtEnd(something_size);
 
   std::string read_data(something_size, '0');
   const ErrorMessageOr<void> read_result =
-      capture_file_->ReadFromSection(2, 0, read_data.data(), something_size);
+      capture_file_->ReadFromSection(3, 0, read_data.data(), something_size);
   ASSERT_THAT(read_result, HasNoError());
   EXPECT_EQ(something, read_data);
 }
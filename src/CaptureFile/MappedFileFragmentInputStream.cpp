@@ -0,0 +1,115 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "MappedFileFragmentInputStream.h"
+
+#include <absl/strings/str_format.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+
+#ifdef __linux
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace orbit_capture_file_internal {
+
+namespace {
+
+// Next returns the whole fragment in blocks of at most this size, which keeps the blocks well below
+// the limits of CodedInputStream.
+constexpr uint64_t kMaxBlockSize = 64 << 20;
+
+}  // namespace
+
+ErrorMessageOr<std::unique_ptr<MappedFileFragmentInputStream>>
+MappedFileFragmentInputStream::Create(const orbit_base::UniqueFd& fd, uint64_t file_offset,
+                                      uint64_t size) {
+#ifdef __linux
+  struct stat file_stat {};
+  if (fstat(fd.get(), &file_stat) == -1) {
+    return ErrorMessage{absl::StrFormat("Unable to get the size of the file: %s",
+                                        SafeStrerror(errno))};
+  }
+  // Accessing a mapping past the end of the file raises SIGBUS, so never map past it.
+  const auto file_size = static_cast<uint64_t>(file_stat.st_size);
+  const uint64_t fragment_size =
+      file_offset < file_size ? std::min(size, file_size - file_offset) : 0;
+  if (fragment_size == 0) {
+    return std::unique_ptr<MappedFileFragmentInputStream>(
+        new MappedFileFragmentInputStream(nullptr, 0, nullptr, 0));
+  }
+
+  const auto page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  const uint64_t mapping_offset = file_offset - file_offset % page_size;
+  const uint64_t mapping_size = file_offset - mapping_offset + fragment_size;
+  if (mapping_size > std::numeric_limits<size_t>::max()) {
+    return ErrorMessage{"The file fragment is too large to be mapped"};
+  }
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd.get(),
+                       static_cast<off_t>(mapping_offset));
+  if (mapping == MAP_FAILED) {
+    return ErrorMessage{absl::StrFormat("Unable to map the file: %s", SafeStrerror(errno))};
+  }
+  // This is only a hint, so failure is not an error.
+  if (madvise(mapping, mapping_size, MADV_SEQUENTIAL) == -1) {
+    ORBIT_ERROR("Unable to advise sequential access to the mapped file: %s", SafeStrerror(errno));
+  }
+
+  return std::unique_ptr<MappedFileFragmentInputStream>(new MappedFileFragmentInputStream(
+      mapping, mapping_size, static_cast<const char*>(mapping) + (file_offset - mapping_offset),
+      fragment_size));
+#else
+  (void)fd;
+  (void)file_offset;
+  (void)size;
+  return ErrorMessage{"Memory mapping capture files is only supported on Linux"};
+#endif
+}
+
+MappedFileFragmentInputStream::~MappedFileFragmentInputStream() {
+#ifdef __linux
+  if (mapping_ != nullptr && munmap(mapping_, mapping_size_) == -1) {
+    ORBIT_ERROR("Unable to unmap the file: %s", SafeStrerror(errno));
+  }
+#endif
+}
+
+bool MappedFileFragmentInputStream::Next(const void** data, int* size) {
+  ORBIT_CHECK(data != nullptr);
+  ORBIT_CHECK(size != nullptr);
+
+  if (current_position_ == fragment_size_) return false;
+
+  const uint64_t block_size = std::min(kMaxBlockSize, fragment_size_ - current_position_);
+  (*data) = fragment_ + current_position_;
+  (*size) = static_cast<int>(block_size);
+  current_position_ += block_size;
+  return true;
+}
+
+void MappedFileFragmentInputStream::BackUp(int count) {
+  ORBIT_CHECK(count >= 0);
+  current_position_ -= std::min(current_position_, static_cast<uint64_t>(count));
+}
+
+bool MappedFileFragmentInputStream::Skip(int count) {
+  ORBIT_CHECK(count >= 0);
+  if (static_cast<uint64_t>(count) > fragment_size_ - current_position_) {
+    current_position_ = fragment_size_;
+    return false;
+  }
+  current_position_ += count;
+  return true;
+}
+
+int64_t MappedFileFragmentInputStream::ByteCount() const { return current_position_; }
+
+}  // namespace orbit_capture_file_internal
@@ -0,0 +1,68 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MAPPED_FILE_FRAGMENT_INPUT_STREAM_H_
+#define MAPPED_FILE_FRAGMENT_INPUT_STREAM_H_
+
+#include <google/protobuf/io/zero_copy_stream.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_internal {
+
+// ZeroCopyInputStream implementation for a file fragment with offset and size, like
+// FileFragmentInputStream, but which maps the fragment into memory instead of reading it. Next
+// returns pointers into the mapping, which saves a system call and a copy for each block. The
+// mapping is advised to be read sequentially, so that the kernel reads ahead aggressively.
+// Only supported on Linux. Note that the file must not be truncated while the stream exists.
+// https://developers.google.com/protocol-buffers/docs/reference/cpp/google.protobuf.io.zero_copy_stream
+class MappedFileFragmentInputStream : public google::protobuf::io::ZeroCopyInputStream {
+ public:
+  // Maps the `size` bytes of the file starting at `file_offset`, or only up to the end of the file
+  // if it is shorter.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<MappedFileFragmentInputStream>> Create(
+      const orbit_base::UniqueFd& fd, uint64_t file_offset, uint64_t size);
+
+  MappedFileFragmentInputStream(const MappedFileFragmentInputStream&) = delete;
+  MappedFileFragmentInputStream& operator=(const MappedFileFragmentInputStream&) = delete;
+  MappedFileFragmentInputStream(MappedFileFragmentInputStream&&) = delete;
+  MappedFileFragmentInputStream& operator=(MappedFileFragmentInputStream&&) = delete;
+  ~MappedFileFragmentInputStream() override;
+
+  // Obtains a chunk of data from the stream.
+  // https://developers.google.com/protocol-buffers/docs/reference/cpp/google.protobuf.io.zero_copy_stream#ZeroCopyInputStream.Next.details
+  bool Next(const void** data, int* size) override;
+  // Backs up a number of bytes, so that the next call to Next() returns data again that was already
+  // returned by the last call to Next().
+  // https://developers.google.com/protocol-buffers/docs/reference/cpp/google.protobuf.io.zero_copy_stream#ZeroCopyInputStream.BackUp.details
+  void BackUp(int count) override;
+  // Skips a number of bytes.
+  // https://developers.google.com/protocol-buffers/docs/reference/cpp/google.protobuf.io.zero_copy_stream#ZeroCopyInputStream.Skip.details
+  bool Skip(int count) override;
+  [[nodiscard]] int64_t ByteCount() const override;
+
+ private:
+  MappedFileFragmentInputStream(void* mapping, size_t mapping_size, const char* fragment,
+                                uint64_t fragment_size)
+      : mapping_{mapping},
+        mapping_size_{mapping_size},
+        fragment_{fragment},
+        fragment_size_{fragment_size} {}
+
+  // The mapping starts at the page that contains the beginning of the fragment.
+  void* mapping_;
+  size_t mapping_size_;
+  const char* fragment_;
+  uint64_t fragment_size_;
+  uint64_t current_position_ = 0;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // MAPPED_FILE_FRAGMENT_INPUT_STREAM_H_
@@ -0,0 +1,102 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "MappedFileFragmentInputStream.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+#include "TestUtils/TemporaryFile.h"
+
+namespace orbit_capture_file_internal {
+
+#ifdef __linux
+namespace {
+
+[[nodiscard]] std::string_view ToStringView(const void* bytes, int size) {
+  return std::string_view{static_cast<const char*>(bytes), static_cast<size_t>(size)};
+}
+
+}  // namespace
+
+TEST(MappedFileFragmentInputStream, ReadSkipAndBackUp) {
+  auto temporary_file_or_error = orbit_test_utils::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_test_utils::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  // Make the fragment cross a page boundary, which also makes its offset not page-aligned.
+  std::string content(4090, 'x');
+  content.append("urna molestie euismod. Etiam pellentesque porttitor ligula");
+  auto write_result = orbit_base::WriteFully(temporary_file.fd(), content);
+  ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+
+  // The fragment is "urna molestie euismod. Etiam pellentesque"
+  auto input_stream_or_error = MappedFileFragmentInputStream::Create(temporary_file.fd(), 4090, 41);
+  ASSERT_TRUE(input_stream_or_error.has_value()) << input_stream_or_error.error().message();
+  MappedFileFragmentInputStream& input_stream = *input_stream_or_error.value();
+  EXPECT_EQ(input_stream.ByteCount(), 0);
+
+  const void* bytes = nullptr;
+  int size = 0;
+  ASSERT_TRUE(input_stream.Next(&bytes, &size));
+  EXPECT_EQ(ToStringView(bytes, size), "urna molestie euismod. Etiam pellentesque");
+  EXPECT_EQ(input_stream.ByteCount(), 41);
+  EXPECT_FALSE(input_stream.Next(&bytes, &size));
+
+  // Make sure we do not go out of fragment boundary
+  input_stream.BackUp(100);
+  EXPECT_EQ(input_stream.ByteCount(), 0);
+
+  ASSERT_TRUE(input_stream.Skip(5));
+  EXPECT_EQ(input_stream.ByteCount(), 5);
+  ASSERT_TRUE(input_stream.Next(&bytes, &size));
+  EXPECT_EQ(ToStringView(bytes, size), "molestie euismod. Etiam pellentesque");
+
+  input_stream.BackUp(5);
+  ASSERT_TRUE(input_stream.Next(&bytes, &size));
+  EXPECT_EQ(ToStringView(bytes, size), "esque");
+
+  // Do not skip past end of the fragment
+  input_stream.BackUp(10);
+  EXPECT_FALSE(input_stream.Skip(30));
+  EXPECT_EQ(input_stream.ByteCount(), 41);
+
+  // Skipping exactly to the end of the fragment succeeds
+  input_stream.BackUp(10);
+  EXPECT_TRUE(input_stream.Skip(10));
+  EXPECT_EQ(input_stream.ByteCount(), 41);
+  EXPECT_FALSE(input_stream.Next(&bytes, &size));
+  EXPECT_TRUE(input_stream.Skip(0));
+  EXPECT_FALSE(input_stream.Skip(1));
+}
+
+TEST(MappedFileFragmentInputStream, FragmentEndsAtEndOfFile) {
+  auto temporary_file_or_error = orbit_test_utils::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_test_utils::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  auto write_result = orbit_base::WriteFully(temporary_file.fd(), "Vestibulum euismod");
+  ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+
+  auto input_stream_or_error = MappedFileFragmentInputStream::Create(temporary_file.fd(), 11, 100);
+  ASSERT_TRUE(input_stream_or_error.has_value()) << input_stream_or_error.error().message();
+  const void* bytes = nullptr;
+  int size = 0;
+  ASSERT_TRUE(input_stream_or_error.value()->Next(&bytes, &size));
+  EXPECT_EQ(ToStringView(bytes, size), "euismod");
+  EXPECT_FALSE(input_stream_or_error.value()->Next(&bytes, &size));
+
+  input_stream_or_error = MappedFileFragmentInputStream::Create(temporary_file.fd(), 100, 10);
+  ASSERT_TRUE(input_stream_or_error.has_value()) << input_stream_or_error.error().message();
+  EXPECT_FALSE(input_stream_or_error.value()->Next(&bytes, &size));
+}
+#endif
+
+}  // namespace orbit_capture_file_internal
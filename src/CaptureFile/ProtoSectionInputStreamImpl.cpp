@@ -7,32 +7,92 @@
 #include <absl/strings/str_format.h>
 
 #include <memory>
+#include <utility>
 
+#include "OrbitBase/Logging.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
 
 namespace orbit_capture_file_internal {
 
 constexpr uint64_t kMaximumMessageSize = 1024 * 1024;  // 1Mb
 
-ErrorMessageOr<void> ProtoSectionInputStreamImpl::ReadMessage(google::protobuf::Message* message) {
+ProtoSectionInputStreamImpl::ProtoSectionInputStreamImpl(
+    orbit_base::UniqueFd& fd, uint64_t capture_section_offset, uint64_t capture_section_size,
+    orbit_capture_file::CaptureSectionCompression compression, bool memory_map)
+    : fd_{fd} {
+  if (memory_map) {
+    ErrorMessageOr<std::unique_ptr<MappedFileFragmentInputStream>> mapped_stream_or_error =
+        MappedFileFragmentInputStream::Create(fd_, capture_section_offset, capture_section_size);
+    if (mapped_stream_or_error.has_value()) {
+      mapped_file_fragment_input_stream_ = std::move(mapped_stream_or_error.value());
+    } else {
+      ORBIT_ERROR("Reading the section without memory mapping: %s",
+                  mapped_stream_or_error.error().message());
+    }
+  }
+  if (mapped_file_fragment_input_stream_ == nullptr) {
+    file_fragment_input_stream_.emplace(fd_, capture_section_offset, capture_section_size);
+  }
+
+  switch (compression) {
+    case orbit_capture_file::CaptureSectionCompression::kNone:
+      break;
+    case orbit_capture_file::CaptureSectionCompression::kZlib:
+      decompressing_input_stream_.emplace(GetFileInputStream(),
+                                          google::protobuf::io::GzipInputStream::ZLIB);
+      break;
+  }
+  coded_input_stream_.emplace(GetInputStream());
+  coded_input_stream_->SetTotalBytesLimit(kCodedInputStreamTotalBytesLimit);
+}
+
+google::protobuf::io::ZeroCopyInputStream* ProtoSectionInputStreamImpl::GetFileInputStream() {
+  if (mapped_file_fragment_input_stream_ != nullptr) {
+    return mapped_file_fragment_input_stream_.get();
+  }
+  return &file_fragment_input_stream_.value();
+}
+
+google::protobuf::io::ZeroCopyInputStream* ProtoSectionInputStreamImpl::GetInputStream() {
+  if (decompressing_input_stream_.has_value()) return &decompressing_input_stream_.value();
+  return GetFileInputStream();
+}
+
+ErrorMessage ProtoSectionInputStreamImpl::GetReadError(const char* error_if_unknown) const {
+  if (file_fragment_input_stream_.has_value()) {
+    if (std::optional<ErrorMessage> error = file_fragment_input_stream_->GetLastError();
+        error.has_value()) {
+      return error.value();
+    }
+  }
+  // Note that zlib reports the end of a compressed stream with the positive Z_STREAM_END.
+  if (decompressing_input_stream_.has_value() &&
+      decompressing_input_stream_->ZlibErrorCode() < 0) {
+    const char* zlib_error_message = decompressing_input_stream_->ZlibErrorMessage();
+    return ErrorMessage{absl::StrFormat(
+        "Unable to decompress the section: %s",
+        zlib_error_message != nullptr ? zlib_error_message : "unknown error")};
+  }
+  return ErrorMessage{error_if_unknown};
+}
+
+ErrorMessageOr<uint32_t> ProtoSectionInputStreamImpl::ReadMessageSize() {
   // CodedInputStream imposes a hard limit on the total number of bytes it will read. It's INT_MAX
   // by default and it cannot be increased past that. To work around the limitation, reinitialize
-  // the CodedInputStream, as the actual current position is kept by the FileFragmentInputStream
+  // the CodedInputStream, as the actual current position is kept by the underlying stream
   // instead. Note that this makes CodedInputStream::CurrentPosition not always reflect the actual
   // position in the stream.
   if (coded_input_stream_->CurrentPosition() >= kCodedInputStreamReinitializationThreshold) {
-    coded_input_stream_.emplace(&file_fragment_input_stream_);
+    coded_input_stream_.emplace(GetInputStream());
     coded_input_stream_->SetTotalBytesLimit(kCodedInputStreamTotalBytesLimit);
   }
 
   uint32_t message_size = 0;
 
   // Note that in case there was an error CodedInputStream does not provide error messages/codes.
-  // We need to go to underlying stream (file_fragment_input_stream_ in this case) to get the error
-  // message in case of a failure.
+  // We need to go to the underlying streams to get the error message in case of a failure.
   if (!coded_input_stream_->ReadVarint32(&message_size)) {
-    return file_fragment_input_stream_.GetLastError().value_or(
-        ErrorMessage{"Unexpected end of section while reading message size"});
+    return GetReadError("Unexpected end of section while reading message size");
   }
 
   // Since file input is not trusted, having too big value here may lead to out-of-memory allocation
@@ -43,13 +103,25 @@ ErrorMessageOr<void> ProtoSectionInputStreamImpl::ReadMessage(google::protobuf::
                         message_size, kMaximumMessageSize)};
   }
 
-  auto buf = make_unique_for_overwrite<uint8_t[]>(message_size);
-  if (!coded_input_stream_->ReadRaw(buf.get(), message_size)) {
-    return file_fragment_input_stream_.GetLastError().value_or(
-        ErrorMessage{"Unexpected end of section while reading the message"});
+  return message_size;
+}
+
+ErrorMessageOr<void> ProtoSectionInputStreamImpl::ReadRaw(void* buffer, uint32_t size) {
+  if (!coded_input_stream_->ReadRaw(buffer, size)) {
+    return GetReadError("Unexpected end of section while reading the message");
   }
+  return outcome::success();
+}
 
-  message->ParseFromArray(buf.get(), message_size);
+ErrorMessageOr<void> ProtoSectionInputStreamImpl::ReadMessage(google::protobuf::Message* message) {
+  OUTCOME_TRY(const uint32_t message_size, ReadMessageSize());
+
+  auto buf = make_unique_for_overwrite<uint8_t[]>(message_size);
+  OUTCOME_TRY(ReadRaw(buf.get(), message_size));
+
+  if (!message->ParseFromArray(buf.get(), message_size)) {
+    return ErrorMessage{absl::StrFormat("Unable to parse the message of size %d", message_size)};
+  }
 
   if (message->ByteSizeLong() != message_size) {
     return ErrorMessage{absl::StrFormat(
@@ -60,4 +132,14 @@ ErrorMessageOr<void> ProtoSectionInputStreamImpl::ReadMessage(google::protobuf::
   return outcome::success();
 }
 
+ErrorMessageOr<uint32_t> ProtoSectionInputStreamImpl::ReadMessageBytes(
+    std::string* message_bytes) {
+  OUTCOME_TRY(const uint32_t message_size, ReadMessageSize());
+
+  const size_t previous_size = message_bytes->size();
+  message_bytes->resize(previous_size + message_size);
+  OUTCOME_TRY(ReadRaw(message_bytes->data() + previous_size, message_size));
+  return message_size;
+}
+
 }  // namespace orbit_capture_file_internal
\ No newline at end of file
@@ -6,40 +6,57 @@
 #define PROTO_SECTION_INPUT_STREAM_IMPL_H_
 
 #include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/gzip_stream.h>
+#include <google/protobuf/io/zero_copy_stream.h>
 #include <google/protobuf/message.h>
 #include <stdint.h>
 
 #include <limits>
 #include <optional>
+#include <string>
 #include <utility>
 
+#include "CaptureFile/CaptureFileSection.h"
 #include "CaptureFile/ProtoSectionInputStream.h"
 #include "FileFragmentInputStream.h"
+#include "MappedFileFragmentInputStream.h"
 #include "OrbitBase/File.h"
 #include "OrbitBase/Result.h"
 
 namespace orbit_capture_file_internal {
 
-// This class is used to read proto messages from a section of capture file.
+// This class is used to read proto messages from a section of capture file. Compressed sections are
+// decompressed while reading, a block at a time. If `memory_map` is true, the section is read
+// through a MappedFileFragmentInputStream, or, if the section can't be mapped, through a
+// FileFragmentInputStream like otherwise.
 class ProtoSectionInputStreamImpl : public orbit_capture_file::ProtoSectionInputStream {
  public:
   explicit ProtoSectionInputStreamImpl(orbit_base::UniqueFd& fd, uint64_t capture_section_offset,
-                                       uint64_t capture_section_size)
-      : fd_{fd},
-        file_fragment_input_stream_{fd_, capture_section_offset, capture_section_size},
-        coded_input_stream_{std::in_place, &file_fragment_input_stream_} {
-    coded_input_stream_->SetTotalBytesLimit(kCodedInputStreamTotalBytesLimit);
-  }
+                                       uint64_t capture_section_size,
+                                       orbit_capture_file::CaptureSectionCompression compression =
+                                           orbit_capture_file::CaptureSectionCompression::kNone,
+                                       bool memory_map = false);
 
   ErrorMessageOr<void> ReadMessage(google::protobuf::Message* message) override;
+  ErrorMessageOr<uint32_t> ReadMessageBytes(std::string* message_bytes) override;
 
  private:
+  ErrorMessageOr<uint32_t> ReadMessageSize();
+  ErrorMessageOr<void> ReadRaw(void* buffer, uint32_t size);
+  [[nodiscard]] google::protobuf::io::ZeroCopyInputStream* GetFileInputStream();
+  [[nodiscard]] google::protobuf::io::ZeroCopyInputStream* GetInputStream();
+  [[nodiscard]] ErrorMessage GetReadError(const char* error_if_unknown) const;
+
   static constexpr int kCodedInputStreamTotalBytesLimit = std::numeric_limits<int>::max();
   static constexpr int kCodedInputStreamReinitializationThreshold =
       kCodedInputStreamTotalBytesLimit / 2;
 
   orbit_base::UniqueFd& fd_;
-  FileFragmentInputStream file_fragment_input_stream_;
+  // Exactly one of these reads the section from the file.
+  std::unique_ptr<MappedFileFragmentInputStream> mapped_file_fragment_input_stream_;
+  std::optional<FileFragmentInputStream> file_fragment_input_stream_;
+  // Only set for compressed sections, in which case it decompresses the stream above.
+  std::optional<google::protobuf::io::GzipInputStream> decompressing_input_stream_;
   std::optional<google::protobuf::io::CodedInputStream> coded_input_stream_;
 };
 
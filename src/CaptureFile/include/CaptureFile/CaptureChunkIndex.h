@@ -0,0 +1,36 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_CAPTURE_CHUNK_INDEX_H_
+#define CAPTURE_FILE_CAPTURE_CHUNK_INDEX_H_
+
+#include <stdint.h>
+
+#include <optional>
+#include <vector>
+
+#include "CaptureFile/CaptureFile.h"
+#include "ClientProtos/capture_chunk_index.pb.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file {
+
+// Reads the index of the chunks of the capture section of `capture_file`. Returns std::nullopt if
+// the file doesn't have one, like all files written before version 2 of the format, and an error if
+// a chunk is outside of the capture section.
+// Each chunk can be read on its own with CaptureFile::CreateCaptureChunkInputStream.
+[[nodiscard]] ErrorMessageOr<std::optional<orbit_client_protos::CaptureChunkIndex>>
+ReadCaptureChunkIndex(CaptureFile* capture_file);
+
+// Returns, in increasing order, the indices of the chunks that need to be loaded to get all events
+// that intersect [min_timestamp_ns, max_timestamp_ns]. These are the chunks with such events, the
+// chunks with events that describe the state of the capture, and all chunks with interned data
+// these depend on.
+[[nodiscard]] std::vector<uint32_t> FindCaptureChunksToLoad(
+    const orbit_client_protos::CaptureChunkIndex& index, uint64_t min_timestamp_ns,
+    uint64_t max_timestamp_ns);
+
+}  // namespace orbit_capture_file
+
+#endif  // CAPTURE_FILE_CAPTURE_CHUNK_INDEX_H_
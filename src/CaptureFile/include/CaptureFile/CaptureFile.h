@@ -19,6 +19,13 @@
 
 namespace orbit_capture_file {
 
+struct CaptureFileOptions {
+  // Whether the streams created by CaptureFile read their section through a memory mapping of the
+  // file, which saves a system call and a copy for each block, rather than with read calls. Streams
+  // fall back to read calls if their section can't be mapped.
+  bool memory_map_sections = false;
+};
+
 // The CaptureFile provides functionality to read and write sections to a capture file. The
 // CaptureSection is the main section (not contained in the section list) located directly after the
 // CaptureFileHeader (use CaptureFileOutputStream to generate this main section of the file). The
@@ -66,13 +73,25 @@ class CaptureFile {
 
   [[nodiscard]] virtual const std::filesystem::path& GetFilePath() const = 0;
 
+  [[nodiscard]] virtual CaptureSectionCompression GetCaptureSectionCompression() const = 0;
+  // The size of the capture section in the file, i.e., after compression.
+  [[nodiscard]] virtual uint64_t GetCaptureSectionSize() const = 0;
+
   virtual std::unique_ptr<ProtoSectionInputStream> CreateProtoSectionInputStream(
       uint64_t section_number) = 0;
 
+  // The streams created by this and by CreateCaptureChunkInputStream decompress the capture section
+  // as they read it, if needed.
   virtual std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStream() = 0;
 
+  // Creates a stream reading only the `size` bytes of the capture section starting at
+  // `offset_in_capture_section`, e.g., the events of one orbit_client_protos::CaptureChunk. For a
+  // compressed capture section, these must delimit one whole compressed chunk.
+  virtual std::unique_ptr<ProtoSectionInputStream> CreateCaptureChunkInputStream(
+      uint64_t offset_in_capture_section, uint64_t size) = 0;
+
   static ErrorMessageOr<std::unique_ptr<CaptureFile>> OpenForReadWrite(
-      const std::filesystem::path& file_path);
+      const std::filesystem::path& file_path, CaptureFileOptions options = {});
 
   // Adds an additional section to the capture file and returns the index of the added section. The
   // new section is placed behind existing additional sections. The updated section list is placed
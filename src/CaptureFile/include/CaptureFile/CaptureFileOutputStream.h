@@ -9,6 +9,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <string_view>
 
 #include "CaptureFile/BufferOutputStream.h"
 #include "GrpcProtos/capture.pb.h"
@@ -16,6 +17,19 @@
 
 namespace orbit_capture_file {
 
+// How CaptureFileOutputStream compresses the capture section of a file.
+enum class CaptureFileCompression {
+  kNone,
+  // Compresses quickly enough to keep up with a capture, at a moderate compression ratio.
+  kFast,
+  // Compresses as much as possible, e.g., for files that are archived or copied around.
+  kSmall,
+};
+
+// Parses "none", "fast" or "small", e.g., the value of a command line flag.
+[[nodiscard]] ErrorMessageOr<CaptureFileCompression> ParseCaptureFileCompression(
+    std::string_view name);
+
 // This class in used for creating new capture file from
 // a stream of ClientCaptureEvents. If the file already exists
 // it is going to be overwritten. Appending to the existing file
@@ -52,9 +66,14 @@ class CaptureFileOutputStream {
   [[nodiscard]] virtual bool IsOpen() = 0;
 
   // Create new capture file output stream. If the file exists it is going to be
-  // overwritten.
+  // overwritten. The capture section is compressed one capture chunk at a time, so that each chunk
+  // can still be loaded on its own.
+  // If more than one CPU is available, events are serialized and written on a background thread.
+  // An error writing an event is then only returned by a later call to WriteCaptureEvent or by
+  // Close.
   [[nodiscard]] static ErrorMessageOr<std::unique_ptr<CaptureFileOutputStream>> Create(
-      std::filesystem::path path);
+      std::filesystem::path path,
+      CaptureFileCompression compression = CaptureFileCompression::kNone);
   [[nodiscard]] static std::unique_ptr<CaptureFileOutputStream> Create(
       BufferOutputStream* output_buffer);
 };
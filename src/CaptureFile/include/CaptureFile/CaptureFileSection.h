@@ -10,6 +10,16 @@
 namespace orbit_capture_file {
 
 constexpr uint64_t kSectionTypeUserData = 1;
+// Contains an orbit_client_protos::CaptureChunkIndex, see CaptureChunkIndex.h.
+constexpr uint64_t kSectionTypeCaptureChunkIndex = 2;
+
+// How the capture section is compressed. Stored in the header since version 3 of the format. The
+// additional sections are never compressed.
+enum class CaptureSectionCompression : uint32_t {
+  kNone = 0,
+  // A sequence of independent zlib streams, one for each capture chunk.
+  kZlib = 1,
+};
 
 struct CaptureFileSection {
   uint64_t type;
@@ -6,6 +6,9 @@
 #define CAPTURE_FILE_PROTO_SECTION_INPUT_STREAM_H_
 
 #include <google/protobuf/message.h>
+#include <stdint.h>
+
+#include <string>
 
 #include "OrbitBase/Result.h"
 
@@ -25,6 +28,11 @@ class ProtoSectionInputStream {
   // aligned to 8bytes. Reading beyond the CaptureFinished message will incorrectly
   // read padded zeros as empty messages until finally causing an end of section error.
   virtual ErrorMessageOr<void> ReadMessage(google::protobuf::Message* message) = 0;
+
+  // Like ReadMessage, but appends the serialized message to `message_bytes` instead of parsing it.
+  // This allows to parse messages on other threads than the one reading the stream. Returns the
+  // size of the message. On error, the content of `message_bytes` is unspecified.
+  virtual ErrorMessageOr<uint32_t> ReadMessageBytes(std::string* message_bytes) = 0;
 };
 
 }  // namespace orbit_capture_file
@@ -6,6 +6,7 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/hash/hash.h>
+#include <absl/types/span.h>
 
 #include <algorithm>
 #include <cstdint>
@@ -123,6 +124,24 @@ void CaptureData::UpdateScopeStats(const TimerInfo& timer_info) {
   all_scopes_->UpdateScopeStats(scope_id.value(), timer_info);
 }
 
+void CaptureData::AddFunctionCallSummary(
+    const orbit_grpc_protos::FunctionCallSummary& function_call_summary) {
+  const std::optional<ScopeId> scope_id =
+      FunctionIdToScopeId(function_call_summary.function_id());
+  if (!scope_id.has_value()) return;
+
+  ScopeStats stats;
+  stats.set_count(function_call_summary.call_count());
+  stats.set_total_time_ns(function_call_summary.total_duration_ns());
+  stats.set_min_ns(function_call_summary.min_duration_ns());
+  stats.set_max_ns(function_call_summary.max_duration_ns());
+  stats.set_variance_ns(function_call_summary.duration_variance_ns());
+  all_scopes_->MergeScopeStats(
+      scope_id.value(), stats,
+      absl::MakeConstSpan(function_call_summary.duration_log2_histogram().data(),
+                          function_call_summary.duration_log2_histogram().size()));
+}
+
 void CaptureData::AddScopeStats(ScopeId scope_id, ScopeStats stats) {
   all_scopes_->SetScopeStats(scope_id, stats);
 }
@@ -27,6 +27,35 @@ void ScopeStats::UpdateStats(uint64_t elapsed_nanos) {
   }
 }
 
+void ScopeStats::MergeStats(const ScopeStats& other) {
+  if (other.count_ == 0) return;
+  if (count_ == 0) {
+    *this = other;
+    return;
+  }
+
+  const auto count = static_cast<double>(count_);
+  const auto other_count = static_cast<double>(other.count_);
+  const double combined_count = count + other_count;
+  const double avg = static_cast<double>(total_time_ns_) / count;
+  const double other_avg = static_cast<double>(other.total_time_ns_) / other_count;
+  const double avg_difference = other_avg - avg;
+
+  // N*variance(N) = n1*variance(n1) + n2*variance(n2) + (avg(n2)-avg(n1))^2 * n1*n2/N
+  variance_ns_ = (count * variance_ns_ + other_count * other.variance_ns_ +
+                  avg_difference * avg_difference * count * other_count / combined_count) /
+                 combined_count;
+
+  count_ += other.count_;
+  total_time_ns_ += other.total_time_ns_;
+  if (max_ns_ < other.max_ns_) {
+    max_ns_ = other.max_ns_;
+  }
+  if (other.min_ns_ < min_ns_) {
+    min_ns_ = other.min_ns_;
+  }
+}
+
 uint64_t ScopeStats::ComputeAverageTimeNs() const {
   if (count_ == 0) {
     return 0;
@@ -8,7 +8,9 @@
 #include <absl/algorithm/container.h>
 #include <absl/types/span.h>
 
+#include <algorithm>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <utility>
 
@@ -41,6 +43,31 @@ void ScopeStatsCollection::UpdateScopeStats(ScopeId scope_id, const TimerInfo& t
   timer_durations_are_sorted_ = false;
 }
 
+void ScopeStatsCollection::MergeScopeStats(ScopeId scope_id, const ScopeStats& stats,
+                                           absl::Span<const uint64_t> duration_log2_histogram) {
+  scope_stats_[scope_id].MergeStats(stats);
+
+  constexpr size_t kMaxBucketIndex = std::numeric_limits<uint64_t>::digits - 1;
+  for (size_t i = 0; i < duration_log2_histogram.size(); ++i) {
+    const uint64_t count = duration_log2_histogram[i];
+    if (count == 0) continue;
+    if (i > kMaxBucketIndex) {
+      ORBIT_ERROR("Ignoring bucket %u of the duration histogram, which is out of range", i);
+      continue;
+    }
+    // Bucket i holds the durations in [2^i, 2^(i+1) - 1], and bucket 0 also holds 0.
+    const uint64_t bucket_min_ns = i == 0 ? 0 : uint64_t{1} << i;
+    const uint64_t bucket_max_ns = i == kMaxBucketIndex ? std::numeric_limits<uint64_t>::max()
+                                                        : (uint64_t{1} << (i + 1)) - 1;
+    const uint64_t bucket_middle_ns = bucket_min_ns + (bucket_max_ns - bucket_min_ns) / 2;
+    const uint64_t duration_ns =
+        std::min(std::max(bucket_middle_ns, stats.min_ns()), stats.max_ns());
+    std::vector<uint64_t>& timer_durations = scope_id_to_timer_durations_[scope_id];
+    timer_durations.insert(timer_durations.end(), count, duration_ns);
+    timer_durations_are_sorted_ = false;
+  }
+}
+
 void ScopeStatsCollection::SetScopeStats(ScopeId scope_id, const ScopeStats stats) {
   scope_stats_.insert_or_assign(scope_id, stats);
 }
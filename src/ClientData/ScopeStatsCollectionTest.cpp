@@ -115,4 +115,51 @@ TEST(ScopeStatsCollectionTest, CreateWithTimers) {
   EXPECT_THAT(*timer_durations, ElementsAre(kOrderedDiffs[0], kOrderedDiffs[1], kOrderedDiffs[2]));
 }
 
+TEST(ScopeStatsCollectionTest, MergeScopeStats) {
+  ScopeStatsCollection collection = ScopeStatsCollection();
+  collection.UpdateScopeStats(kScopeId1, kTimersScopeId1[0]);
+
+  // The stats of the other timers, as an instrumented process would have aggregated them.
+  ScopeStats aggregated_stats;
+  for (size_t i = 1; i < kNumTimers; ++i) {
+    aggregated_stats.UpdateStats(kTimersScopeId1[i].end() - kTimersScopeId1[i].start());
+  }
+  collection.MergeScopeStats(kScopeId1, aggregated_stats, {});
+  collection.MergeScopeStats(kScopeId1, ScopeStats{}, {});
+
+  const ScopeStats& stats = collection.GetScopeStatsOrDefault(kScopeId1);
+  EXPECT_EQ(stats.count(), kScope1Stats.count());
+  EXPECT_EQ(stats.max_ns(), kScope1Stats.max_ns());
+  EXPECT_EQ(stats.min_ns(), kScope1Stats.min_ns());
+  EXPECT_EQ(stats.total_time_ns(), kScope1Stats.total_time_ns());
+  // UpdateStats rounds the averages to whole nanoseconds, so the variances differ slightly.
+  EXPECT_NEAR(stats.variance_ns(), kScope1Stats.variance_ns(), kScope1Stats.variance_ns() * 1e-3);
+
+  // Merged stats without a duration histogram don't add any durations.
+  collection.OnCaptureComplete();
+  EXPECT_THAT(*collection.GetSortedTimerDurationsForScopeId(kScopeId1),
+              ElementsAre(kOrderedDiffs[1]));
+
+  collection.MergeScopeStats(kScopeId2, aggregated_stats, {});
+  ExpectStatsAreEqual(collection.GetScopeStatsOrDefault(kScopeId2), aggregated_stats);
+}
+
+TEST(ScopeStatsCollectionTest, MergeScopeStatsAddsDurationsOfHistogram) {
+  ScopeStatsCollection collection = ScopeStatsCollection();
+  collection.UpdateScopeStats(kScopeId1, kTimersScopeId1[0]);
+
+  ScopeStats aggregated_stats;
+  aggregated_stats.set_count(6);
+  aggregated_stats.set_min_ns(5);
+  aggregated_stats.set_max_ns(1000);
+  // One call in [0, 1], two in [4, 7], none in [8, 15], and three in [512, 1023].
+  const std::vector<uint64_t> duration_log2_histogram{1, 0, 2, 0, 0, 0, 0, 0, 0, 3};
+  collection.MergeScopeStats(kScopeId1, aggregated_stats, duration_log2_histogram);
+  collection.OnCaptureComplete();
+
+  // The middle of each bucket, clamped to the min and max of the aggregated stats.
+  EXPECT_THAT(*collection.GetSortedTimerDurationsForScopeId(kScopeId1),
+              ElementsAre(5, 5, 5, kOrderedDiffs[1], 767, 767, 767));
+}
+
 }  // namespace orbit_client_data
\ No newline at end of file
@@ -15,16 +15,24 @@
 
 namespace orbit_client_data {
 
-const orbit_client_protos::TimerInfo& ScopeTreeTimerData::AddTimer(
-    orbit_client_protos::TimerInfo timer_info, uint32_t /*depth*/) {
+namespace {
+
+[[nodiscard]] const orbit_client_protos::TimerInfo* GetTimerInfoOrNull(const TimerView* timer) {
+  return timer != nullptr ? &timer->GetTimerInfo() : nullptr;
+}
+
+}  // namespace
+
+TimerView ScopeTreeTimerData::AddTimer(orbit_client_protos::TimerInfo timer_info,
+                                       uint32_t /*depth*/) {
   // We don't need to have one TimerChain per depth because it's managed by ScopeTree.
-  const auto& timer_info_ref = timer_data_.AddTimer(std::move(timer_info), /*unused_depth=*/0);
+  const TimerView timer = timer_data_.AddTimer(std::move(timer_info), /*unused_depth=*/0);
 
   if (scope_tree_update_type_ == ScopeTreeUpdateType::kAlways) {
     absl::MutexLock lock(&scope_tree_mutex_);
-    scope_tree_.Insert(&timer_info_ref);
+    scope_tree_.Insert(&timer_views_.emplace_back(timer));
   }
-  return timer_info_ref;
+  return timer;
 }
 
 void ScopeTreeTimerData::OnCaptureComplete() {
@@ -37,7 +45,7 @@ void ScopeTreeTimerData::OnCaptureComplete() {
     absl::MutexLock lock(&scope_tree_mutex_);
     for (const auto& block : *timer_chain) {
       for (size_t k = 0; k < block.size(); ++k) {
-        scope_tree_.Insert(&block[k]);
+        scope_tree_.Insert(&timer_views_.emplace_back(block[k]));
       }
     }
   }
@@ -76,7 +84,7 @@ std::vector<const orbit_client_protos::TimerInfo*> ScopeTreeTimerData::GetTimers
   if (node_it->second->GetScope()->start() < start_ns) ++node_it;
 
   for (auto it = node_it; it != ordered_nodes.end() && it->second->End() < end_ns; ++it) {
-    all_timers_at_depth.push_back(it->second->GetScope());
+    all_timers_at_depth.push_back(&it->second->GetScope()->GetTimerInfo());
   }
 
   return all_timers_at_depth;
@@ -97,13 +105,13 @@ std::vector<const orbit_client_protos::TimerInfo*> ScopeTreeTimerData::GetTimers
   if (first_node_to_draw->second->GetScope()->end() < start_ns) ++first_node_to_draw;
 
   for (auto it = first_node_to_draw; it != ordered_nodes.end() && it->first < end_ns; ++it) {
-    all_timers_at_depth.push_back(it->second->GetScope());
+    all_timers_at_depth.push_back(&it->second->GetScope()->GetTimerInfo());
   }
 
   return all_timers_at_depth;
 }
 
-std::vector<const orbit_client_protos::TimerInfo*> ScopeTreeTimerData::GetTimersAtDepthDiscretized(
+std::vector<TimerView> ScopeTreeTimerData::GetTimersAtDepthDiscretized(
     uint32_t depth, uint32_t resolution, uint64_t start_ns, uint64_t end_ns) const {
   ORBIT_SCOPE_WITH_COLOR("GetTimersAtDepthDiscretized", kOrbitColorAmber);
   absl::MutexLock lock(&scope_tree_mutex_);
@@ -111,18 +119,17 @@ std::vector<const orbit_client_protos::TimerInfo*> ScopeTreeTimerData::GetTimers
   // interval [start_ns, end_ns+1). We have to be careful with overflowing.
   end_ns = std::max(end_ns, end_ns + 1);
 
-  std::vector<const orbit_client_protos::TimerInfo*> discretized_timers;
-  const orbit_client_protos::TimerInfo* timer_info =
-      scope_tree_.FindFirstScopeAtOrAfterTime(depth, start_ns);
+  std::vector<TimerView> discretized_timers;
+  const TimerView* timer = scope_tree_.FindFirstScopeAtOrAfterTime(depth, start_ns);
 
-  while (timer_info != nullptr && timer_info->start() < end_ns) {
-    discretized_timers.push_back(timer_info);
+  while (timer != nullptr && timer->start() < end_ns) {
+    discretized_timers.push_back(*timer);
 
     // Use the time of next pixel boundary as a threshold to avoid returning several timers
     // for the same pixel that will overlap after.
     uint64_t next_pixel_start_time_ns =
-        GetNextPixelBoundaryTimeNs(timer_info->end(), resolution, start_ns, end_ns);
-    timer_info = scope_tree_.FindFirstScopeAtOrAfterTime(depth, next_pixel_start_time_ns);
+        GetNextPixelBoundaryTimeNs(timer->end(), resolution, start_ns, end_ns);
+    timer = scope_tree_.FindFirstScopeAtOrAfterTime(depth, next_pixel_start_time_ns);
   }
   return discretized_timers;
 }
@@ -130,25 +137,25 @@ std::vector<const orbit_client_protos::TimerInfo*> ScopeTreeTimerData::GetTimers
 const orbit_client_protos::TimerInfo* ScopeTreeTimerData::GetLeft(
     const orbit_client_protos::TimerInfo& timer) const {
   absl::MutexLock lock(&scope_tree_mutex_);
-  return scope_tree_.FindPreviousScopeAtDepth(timer);
+  return GetTimerInfoOrNull(scope_tree_.FindPreviousScopeAtDepth(timer));
 }
 
 const orbit_client_protos::TimerInfo* ScopeTreeTimerData::GetRight(
     const orbit_client_protos::TimerInfo& timer) const {
   absl::MutexLock lock(&scope_tree_mutex_);
-  return scope_tree_.FindNextScopeAtDepth(timer);
+  return GetTimerInfoOrNull(scope_tree_.FindNextScopeAtDepth(timer));
 }
 
 const orbit_client_protos::TimerInfo* ScopeTreeTimerData::GetUp(
     const orbit_client_protos::TimerInfo& timer) const {
   absl::MutexLock lock(&scope_tree_mutex_);
-  return scope_tree_.FindParent(timer);
+  return GetTimerInfoOrNull(scope_tree_.FindParent(timer));
 }
 
 const orbit_client_protos::TimerInfo* ScopeTreeTimerData::GetDown(
     const orbit_client_protos::TimerInfo& timer) const {
   absl::MutexLock lock(&scope_tree_mutex_);
-  return scope_tree_.FindFirstChild(timer);
+  return GetTimerInfoOrNull(scope_tree_.FindFirstChild(timer));
 }
 
 }  // namespace orbit_client_data
\ No newline at end of file
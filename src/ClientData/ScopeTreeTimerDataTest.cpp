@@ -43,17 +43,17 @@ TimersInTest AddTimersInScopeTreeTimerDataTest(ScopeTreeTimerData& scope_tree_ti
   // left
   timer_info.set_start(kLeftTimerStart);
   timer_info.set_end(kLeftTimerEnd);
-  inserted_timers.left = &scope_tree_timer_data.AddTimer(timer_info);
+  inserted_timers.left = &scope_tree_timer_data.AddTimer(timer_info).GetTimerInfo();
 
   // right
   timer_info.set_start(kRightTimerStart);
   timer_info.set_end(kRightTimerEnd);
-  inserted_timers.right = &scope_tree_timer_data.AddTimer(timer_info);
+  inserted_timers.right = &scope_tree_timer_data.AddTimer(timer_info).GetTimerInfo();
 
   // down
   timer_info.set_start(kDownTimerStart);
   timer_info.set_end(kDownTimerEnd);
-  inserted_timers.down = &scope_tree_timer_data.AddTimer(timer_info);
+  inserted_timers.down = &scope_tree_timer_data.AddTimer(timer_info).GetTimerInfo();
 
   return inserted_timers;
 }
@@ -127,28 +127,29 @@ TimersInTest InsertTimersForTesting(ThreadTrackDataProvider& thread_track_data_p
   timer_info.set_thread_id(kThreadId1);
   timer_info.set_start(kLeftTimerStart);
   timer_info.set_end(kLeftTimerEnd);
-  inserted_timers_ptr.left = &thread_track_data_provider.AddTimer(timer_info);
+  inserted_timers_ptr.left = &thread_track_data_provider.AddTimer(timer_info).GetTimerInfo();
 
   // center
   timer_info.set_start(kCenterTimerStart);
   timer_info.set_end(kCenterTimerEnd);
-  inserted_timers_ptr.center = &thread_track_data_provider.AddTimer(timer_info);
+  inserted_timers_ptr.center = &thread_track_data_provider.AddTimer(timer_info).GetTimerInfo();
 
   // down
   timer_info.set_start(kDownTimerStart);
   timer_info.set_end(kDownTimerEnd);
-  inserted_timers_ptr.down = &thread_track_data_provider.AddTimer(timer_info);
+  inserted_timers_ptr.down = &thread_track_data_provider.AddTimer(timer_info).GetTimerInfo();
 
   // right
   timer_info.set_start(kRightTimerStart);
   timer_info.set_end(kRightTimerEnd);
-  inserted_timers_ptr.right = &thread_track_data_provider.AddTimer(timer_info);
+  inserted_timers_ptr.right = &thread_track_data_provider.AddTimer(timer_info).GetTimerInfo();
 
   // other thread_id
   timer_info.set_thread_id(kThreadId2);
   timer_info.set_start(kOtherThreadIdTimerStart);
   timer_info.set_end(kOtherThreadIdTimerEnd);
-  inserted_timers_ptr.other_thread_id = &thread_track_data_provider.AddTimer(timer_info);
+  inserted_timers_ptr.other_thread_id =
+      &thread_track_data_provider.AddTimer(timer_info).GetTimerInfo();
 
   return inserted_timers_ptr;
 }
@@ -5,6 +5,8 @@
 #include "ClientData/TimerChain.h"
 
 #include <algorithm>
+#include <memory>
+#include <utility>
 
 #include "ClientProtos/capture_data.pb.h"
 
@@ -12,17 +14,175 @@ using orbit_client_protos::TimerInfo;
 
 namespace orbit_client_data {
 
+namespace {
+
+[[nodiscard]] const TimerBlock& GetBlockWithDefaultTimer() {
+  static const TimerBlock* block = [] {
+    auto* block = new TimerBlock(/*prev=*/nullptr);
+    block->emplace_back(TimerInfo{});
+    return block;
+  }();
+  return *block;
+}
+
+}  // namespace
+
+TimerView::TimerView() : TimerView(&GetBlockWithDefaultTimer(), 0) {}
+
+TimerBlock::TimerBlock(TimerBlock* prev)
+    : prev_(prev),
+      next_(nullptr),
+      min_timestamp_(std::numeric_limits<uint64_t>::max()),
+      max_timestamp_(std::numeric_limits<uint64_t>::min()) {
+  starts_.reserve(kBlockSize);
+  ends_.reserve(kBlockSize);
+  function_ids_.reserve(kBlockSize);
+  user_data_keys_.reserve(kBlockSize);
+  process_ids_.reserve(kBlockSize);
+  thread_ids_.reserve(kBlockSize);
+  depths_.reserve(kBlockSize);
+  processors_.reserve(kBlockSize);
+  types_.reserve(kBlockSize);
+  other_fields_.reserve(kBlockSize);
+}
+
+TimerBlock::~TimerBlock() {
+  CreatedTimerInfos* created_timer_infos = created_timer_infos_.load(std::memory_order_acquire);
+  if (created_timer_infos == nullptr) return;
+  for (std::atomic<const TimerInfo*>& timer_info : *created_timer_infos) {
+    delete timer_info.load(std::memory_order_acquire);
+  }
+  delete created_timer_infos;
+}
+
+TimerView TimerBlock::emplace_back(TimerInfo timer_info) {
+  const size_t index = size();
+  ORBIT_CHECK(index < kBlockSize);
+  ORBIT_CHECK(TimerInfo::Type_IsValid(timer_info.type()));
+
+  starts_.push_back(timer_info.start());
+  ends_.push_back(timer_info.end());
+  function_ids_.push_back(timer_info.function_id());
+  user_data_keys_.push_back(timer_info.user_data_key());
+  process_ids_.push_back(timer_info.process_id());
+  thread_ids_.push_back(timer_info.thread_id());
+  depths_.push_back(timer_info.depth());
+  processors_.push_back(timer_info.processor());
+  types_.push_back(static_cast<uint8_t>(timer_info.type()));
+  if (index > 0 && timer_info.start() < starts_[index - 1]) {
+    sorted_by_start_.store(false, std::memory_order_relaxed);
+  }
+  min_timestamp_ = std::min(timer_info.start(), min_timestamp_);
+  max_timestamp_ = std::max(timer_info.end(), max_timestamp_);
+
+  // Whatever is left after clearing the fields stored in the columns needs to be kept separately.
+  timer_info.clear_start();
+  timer_info.clear_end();
+  timer_info.clear_function_id();
+  timer_info.clear_user_data_key();
+  timer_info.clear_process_id();
+  timer_info.clear_thread_id();
+  timer_info.clear_depth();
+  timer_info.clear_processor();
+  timer_info.clear_type();
+  other_fields_.push_back(timer_info.ByteSizeLong() != 0
+                              ? std::make_unique<const TimerInfo>(std::move(timer_info))
+                              : nullptr);
+
+  size_.store(index + 1, std::memory_order_release);
+  return TimerView{this, static_cast<uint32_t>(index)};
+}
+
 bool TimerBlock::Intersects(uint64_t min, uint64_t max) const {
   return (min <= max_timestamp_ && max >= min_timestamp_);
 }
 
-const orbit_client_protos::TimerInfo* TimerBlock::LowerBound(uint64_t min_ns) const {
-  auto it = std::lower_bound(data_.begin(), data_.end(), min_ns,
-                             [](const orbit_client_protos::TimerInfo& timer_info, uint64_t value) {
-                               return timer_info.end() < value;
-                             });
-  if (it == data_.end()) return nullptr;
-  return &*it;
+std::optional<TimerView> TimerBlock::LowerBound(uint64_t min_ns) const {
+  auto ends_end = ends_.begin() + size();
+  auto it = std::lower_bound(ends_.begin(), ends_end, min_ns);
+  if (it == ends_end) return std::nullopt;
+  return TimerView{this, static_cast<uint32_t>(it - ends_.begin())};
+}
+
+size_t TimerBlock::LowerBoundByStart(uint64_t start_ns) const {
+  auto starts_begin = starts_.begin();
+  return std::lower_bound(starts_begin, starts_begin + size(), start_ns) - starts_begin;
+}
+
+size_t TimerBlock::UpperBoundByStart(uint64_t start_ns) const {
+  auto starts_begin = starts_.begin();
+  return std::upper_bound(starts_begin, starts_begin + size(), start_ns) - starts_begin;
+}
+
+std::optional<uint32_t> TimerBlock::FindIndexOfTimerInfo(const TimerInfo& timer_info) const {
+  const auto starts_begin = starts_.begin();
+  const auto starts_end = starts_begin + size();
+  // Read after the size, so that the order is known for at least all of these elements.
+  const bool sorted_by_start = sorted_by_start_.load(std::memory_order_relaxed);
+  auto [candidates_begin, candidates_end] =
+      sorted_by_start ? std::equal_range(starts_begin, starts_end, timer_info.start())
+                      : std::make_pair(starts_begin, starts_end);
+  for (auto it = candidates_begin; it != candidates_end; ++it) {
+    if (*it != timer_info.start()) continue;
+    const auto index = static_cast<uint32_t>(it - starts_begin);
+    if (GetCreatedTimerInfo(index) == &timer_info) return index;
+  }
+  return std::nullopt;
+}
+
+const TimerInfo* TimerBlock::GetCreatedTimerInfo(uint32_t index) const {
+  ORBIT_CHECK(index < size());
+  const CreatedTimerInfos* created_timer_infos =
+      created_timer_infos_.load(std::memory_order_acquire);
+  if (created_timer_infos == nullptr) return nullptr;
+  return (*created_timer_infos)[index].load(std::memory_order_acquire);
+}
+
+const TimerInfo& TimerBlock::GetTimerInfo(uint32_t index) const {
+  ORBIT_CHECK(index < size());
+  CreatedTimerInfos* created_timer_infos = created_timer_infos_.load(std::memory_order_acquire);
+  if (created_timer_infos == nullptr) {
+    // Value-initialization sets all pointers to nullptr.
+    auto new_created_timer_infos = std::make_unique<CreatedTimerInfos>();
+    // Another thread could have allocated the array in the meantime.
+    if (created_timer_infos_.compare_exchange_strong(created_timer_infos,
+                                                     new_created_timer_infos.get(),
+                                                     std::memory_order_acq_rel)) {
+      created_timer_infos = new_created_timer_infos.release();
+    }
+  }
+
+  std::atomic<const TimerInfo*>& created_timer_info = (*created_timer_infos)[index];
+  const TimerInfo* timer_info = created_timer_info.load(std::memory_order_acquire);
+  if (timer_info != nullptr) return *timer_info;
+
+  auto new_timer_info = std::make_unique<TimerInfo>();
+  CopyToTimerInfo(index, new_timer_info.get());
+  // Another thread could have created the TimerInfo in the meantime.
+  if (created_timer_info.compare_exchange_strong(timer_info, new_timer_info.get(),
+                                                 std::memory_order_acq_rel)) {
+    return *new_timer_info.release();
+  }
+  return *timer_info;
+}
+
+void TimerBlock::CopyToTimerInfo(uint32_t index, TimerInfo* timer_info) const {
+  ORBIT_CHECK(index < size());
+  if (other_fields_[index] != nullptr) {
+    *timer_info = *other_fields_[index];
+  } else {
+    timer_info->Clear();
+  }
+
+  timer_info->set_start(starts_[index]);
+  timer_info->set_end(ends_[index]);
+  timer_info->set_function_id(function_ids_[index]);
+  timer_info->set_user_data_key(user_data_keys_[index]);
+  timer_info->set_process_id(process_ids_[index]);
+  timer_info->set_thread_id(thread_ids_[index]);
+  timer_info->set_depth(depths_[index]);
+  timer_info->set_processor(processors_[index]);
+  timer_info->set_type(static_cast<TimerInfo::Type>(types_[index]));
 }
 
 TimerChain::~TimerChain() {
@@ -39,51 +199,39 @@ TimerChain::~TimerChain() {
   }
 }
 
-const TimerBlock* TimerChain::GetBlockContaining(const TimerInfo& element) const {
-  const TimerBlock* block = root_;
-  while (block != nullptr) {
-    uint32_t size = block->size();
-    if (size != 0) {
-      const TimerInfo* begin = &block->data_[0];
-      const TimerInfo* end = &block->data_[size - 1];
-      // TODO (http://b/194268700): Don't compare pointers in TimerChain as it is an undefined
-      // behavior
-      if (begin <= &element && end >= &element) {
-        return block;
-      }
-    }
-    block = block->next_;
+std::optional<TimerView> TimerChain::FindTimerView(const TimerInfo& element) const {
+  for (const TimerBlock* block = root_; block != nullptr; block = block->next_) {
+    if (!block->Intersects(element.start(), element.end())) continue;
+    std::optional<uint32_t> index = block->FindIndexOfTimerInfo(element);
+    if (index.has_value()) return TimerView{block, index.value()};
   }
-
-  return nullptr;
+  return std::nullopt;
 }
 
 const TimerInfo* TimerChain::GetElementAfter(const TimerInfo& element) const {
-  const TimerBlock* block = GetBlockContaining(element);
-  if (block != nullptr) {
-    const TimerInfo* begin = &block->data_[0];
-    uint32_t index = &element - begin;
-    if (index < block->size() - 1) {
-      return &block->data_[++index];
-    }
-    if (block->next_ != nullptr && block->next_->size() != 0) {
-      return &block->next_->data_[0];
-    }
+  std::optional<TimerView> timer_view = FindTimerView(element);
+  if (!timer_view.has_value()) return nullptr;
+
+  const TimerBlock* block = timer_view->block();
+  if (timer_view->index() + 1 < block->size()) {
+    return &block->GetTimerInfo(timer_view->index() + 1);
+  }
+  if (block->next_ != nullptr && block->next_->size() != 0) {
+    return &block->next_->GetTimerInfo(0);
   }
   return nullptr;
 }
 
 const TimerInfo* TimerChain::GetElementBefore(const TimerInfo& element) const {
-  const TimerBlock* block = GetBlockContaining(element);
-  if (block != nullptr) {
-    const TimerInfo* begin = &block->data_[0];
-    uint32_t index = &element - begin;
-    if (index > 0) {
-      return &block->data_[--index];
-    }
-    if (block->prev_ != nullptr) {
-      return &block->prev_->data_[block->prev_->size() - 1];
-    }
+  std::optional<TimerView> timer_view = FindTimerView(element);
+  if (!timer_view.has_value()) return nullptr;
+
+  const TimerBlock* block = timer_view->block();
+  if (timer_view->index() > 0) {
+    return &block->GetTimerInfo(timer_view->index() - 1);
+  }
+  if (block->prev_ != nullptr) {
+    return &block->prev_->GetTimerInfo(block->prev_->size() - 1);
   }
   return nullptr;
 }
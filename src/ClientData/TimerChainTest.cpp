@@ -0,0 +1,208 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <google/protobuf/util/message_differencer.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <thread>
+#include <vector>
+
+#include "ClientData/TimerChain.h"
+#include "ClientProtos/capture_data.pb.h"
+
+namespace orbit_client_data {
+
+using google::protobuf::util::MessageDifferencer;
+using orbit_client_protos::TimerInfo;
+
+namespace {
+
+TimerInfo MakeTimer(uint64_t start, uint64_t end) {
+  TimerInfo timer_info;
+  timer_info.set_start(start);
+  timer_info.set_end(end);
+  timer_info.set_process_id(42);
+  timer_info.set_thread_id(43);
+  timer_info.set_depth(1);
+  timer_info.set_processor(-1);
+  timer_info.set_function_id(start % 7);
+  timer_info.set_type(TimerInfo::kCoreActivity);
+  return timer_info;
+}
+
+TimerInfo MakeTimerWithOtherFields(uint64_t start, uint64_t end) {
+  TimerInfo timer_info = MakeTimer(start, end);
+  timer_info.set_api_scope_name("scope");
+  timer_info.mutable_color()->set_red(1);
+  timer_info.add_registers(start);
+  timer_info.add_registers(end);
+  return timer_info;
+}
+
+}  // namespace
+
+TEST(TimerChain, TimerViewGivesAccessToAllFields) {
+  TimerChain chain;
+  std::vector<TimerInfo> timer_infos;
+  // Enough timers to fill more than one block, only some of which have fields not stored in the
+  // columns.
+  for (uint64_t i = 0; i < 2500; ++i) {
+    timer_infos.push_back(i % 3 == 0 ? MakeTimerWithOtherFields(10 * i, 10 * i + 5)
+                                     : MakeTimer(10 * i, 10 * i + 5));
+  }
+  std::vector<TimerView> timer_views;
+  for (const TimerInfo& timer_info : timer_infos) {
+    timer_views.push_back(chain.emplace_back(timer_info));
+  }
+  ASSERT_EQ(chain.size(), timer_infos.size());
+
+  TimerInfo copied_timer_info;
+  for (size_t i = 0; i < timer_infos.size(); ++i) {
+    const TimerView& timer = timer_views[i];
+    EXPECT_EQ(timer.start(), timer_infos[i].start());
+    EXPECT_EQ(timer.end(), timer_infos[i].end());
+    EXPECT_EQ(timer.process_id(), timer_infos[i].process_id());
+    EXPECT_EQ(timer.thread_id(), timer_infos[i].thread_id());
+    EXPECT_EQ(timer.depth(), timer_infos[i].depth());
+    EXPECT_EQ(timer.processor(), timer_infos[i].processor());
+    EXPECT_EQ(timer.function_id(), timer_infos[i].function_id());
+    EXPECT_EQ(timer.type(), timer_infos[i].type());
+    EXPECT_TRUE(MessageDifferencer::Equals(timer.GetTimerInfo(), timer_infos[i]));
+
+    timer.CopyToTimerInfo(&copied_timer_info);
+    EXPECT_TRUE(MessageDifferencer::Equals(copied_timer_info, timer_infos[i]));
+  }
+
+  size_t index = 0;
+  for (const TimerBlock& block : chain) {
+    for (size_t k = 0; k < block.size(); ++k) {
+      EXPECT_EQ(block[k], timer_views[index]);
+      ++index;
+    }
+  }
+  EXPECT_EQ(index, timer_infos.size());
+}
+
+TEST(TimerChain, GetTimerInfoReturnsSameTimerInfo) {
+  TimerChain chain;
+  const TimerView timer = chain.emplace_back(MakeTimerWithOtherFields(1, 2));
+  const TimerInfo* timer_info = &timer.GetTimerInfo();
+  chain.emplace_back(MakeTimer(3, 4));
+  EXPECT_EQ(&timer.GetTimerInfo(), timer_info);
+  EXPECT_EQ(&chain.begin()->operator[](0).GetTimerInfo(), timer_info);
+}
+
+TEST(TimerChain, GetTimerInfoFromConcurrentThreadsReturnsSameTimerInfo) {
+  TimerChain chain;
+  std::vector<TimerView> timer_views;
+  for (uint64_t i = 0; i < 2500; ++i) {
+    timer_views.push_back(chain.emplace_back(MakeTimer(10 * i, 10 * i + 5)));
+  }
+
+  constexpr size_t kThreadCount = 4;
+  std::vector<std::vector<const TimerInfo*>> timer_infos(kThreadCount);
+  std::vector<std::thread> threads;
+  for (size_t thread_index = 0; thread_index < kThreadCount; ++thread_index) {
+    threads.emplace_back([&timer_views, &timer_infos, thread_index] {
+      for (const TimerView& timer : timer_views) {
+        timer_infos[thread_index].push_back(&timer.GetTimerInfo());
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < timer_views.size(); ++i) {
+    EXPECT_EQ(timer_infos[0][i]->start(), timer_views[i].start());
+    for (size_t thread_index = 1; thread_index < kThreadCount; ++thread_index) {
+      EXPECT_EQ(timer_infos[thread_index][i], timer_infos[0][i]);
+    }
+  }
+}
+
+TEST(TimerChain, HasTimerInfo) {
+  TimerChain chain;
+  const TimerView timer = chain.emplace_back(MakeTimer(1, 2));
+  const TimerView other_timer = chain.emplace_back(MakeTimer(1, 2));
+  EXPECT_FALSE(timer.HasTimerInfo(nullptr));
+
+  const TimerInfo& timer_info = timer.GetTimerInfo();
+  EXPECT_TRUE(timer.HasTimerInfo(&timer_info));
+  EXPECT_FALSE(other_timer.HasTimerInfo(nullptr));
+  EXPECT_FALSE(other_timer.HasTimerInfo(&timer_info));
+  const TimerInfo copy = timer_info;
+  EXPECT_FALSE(timer.HasTimerInfo(&copy));
+}
+
+TEST(TimerChain, DefaultTimerView) {
+  const TimerView timer;
+  EXPECT_TRUE(MessageDifferencer::Equals(timer.GetTimerInfo(), TimerInfo{}));
+}
+
+TEST(TimerChain, LowerBound) {
+  TimerChain chain;
+  chain.emplace_back(MakeTimer(10, 20));
+  chain.emplace_back(MakeTimer(30, 40));
+  const TimerBlock& block = *chain.begin();
+
+  ASSERT_TRUE(block.LowerBound(0).has_value());
+  EXPECT_EQ(block.LowerBound(0)->start(), 10);
+  EXPECT_EQ(block.LowerBound(20)->start(), 10);
+  EXPECT_EQ(block.LowerBound(21)->start(), 30);
+  EXPECT_EQ(block.LowerBound(40)->start(), 30);
+  EXPECT_FALSE(block.LowerBound(41).has_value());
+}
+
+TEST(TimerChain, GetElementAfterAndBeforeAcrossBlocks) {
+  TimerChain chain;
+  std::vector<TimerView> timer_views;
+  for (uint64_t i = 0; i < 1500; ++i) {
+    timer_views.push_back(chain.emplace_back(MakeTimer(10 * i, 10 * i + 5)));
+  }
+
+  for (size_t i : {size_t{0}, size_t{1}, size_t{1022}, size_t{1023}, size_t{1024}, size_t{1499}}) {
+    const TimerInfo& timer_info = timer_views[i].GetTimerInfo();
+    const TimerInfo* after = chain.GetElementAfter(timer_info);
+    const TimerInfo* before = chain.GetElementBefore(timer_info);
+    if (i + 1 < timer_views.size()) {
+      EXPECT_EQ(after, &timer_views[i + 1].GetTimerInfo());
+    } else {
+      EXPECT_EQ(after, nullptr);
+    }
+    if (i > 0) {
+      EXPECT_EQ(before, &timer_views[i - 1].GetTimerInfo());
+    } else {
+      EXPECT_EQ(before, nullptr);
+    }
+  }
+
+  // A TimerInfo that doesn't come from the chain is not found, even if it is equal to one that
+  // does.
+  const TimerInfo copy = timer_views[1].GetTimerInfo();
+  EXPECT_EQ(chain.GetElementAfter(copy), nullptr);
+  EXPECT_EQ(chain.GetElementBefore(copy), nullptr);
+}
+
+TEST(TimerChain, GetElementAfterAndBeforeWithUnsortedAndEqualStarts) {
+  for (const std::vector<uint64_t>& starts :
+       {std::vector<uint64_t>{10, 10, 10, 20}, std::vector<uint64_t>{30, 10, 20, 10}}) {
+    TimerChain chain;
+    std::vector<TimerView> timer_views;
+    for (uint64_t start : starts) {
+      timer_views.push_back(chain.emplace_back(MakeTimer(start, start + 5)));
+    }
+
+    for (size_t i = 0; i + 1 < timer_views.size(); ++i) {
+      EXPECT_EQ(chain.GetElementAfter(timer_views[i].GetTimerInfo()),
+                &timer_views[i + 1].GetTimerInfo());
+      EXPECT_EQ(chain.GetElementBefore(timer_views[i + 1].GetTimerInfo()),
+                &timer_views[i].GetTimerInfo());
+    }
+  }
+}
+
+}  // namespace orbit_client_data
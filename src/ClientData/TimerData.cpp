@@ -4,6 +4,10 @@
 
 #include <ClientData/TimerData.h>
 
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <optional>
 #include <utility>
 
 #include "ApiInterface/Orbit.h"
@@ -16,25 +20,42 @@ using orbit_client_protos::TimerInfo;
 
 namespace orbit_client_data {
 
-const TimerInfo& TimerData::AddTimer(TimerInfo timer_info, uint32_t depth) {
+TimerView TimerData::AddTimer(TimerInfo timer_info, uint32_t depth) {
   if (process_id_ == orbit_base::kInvalidProcessId) {
     process_id_ = timer_info.process_id();
   }
 
-  TimerChain* timer_chain = GetOrCreateTimerChain(depth);
   UpdateMinTime(timer_info.start());
   UpdateMaxTime(timer_info.end());
   ++num_timers_;
   UpdateDepth(timer_info.depth() + 1);
 
-  return timer_chain->emplace_back(std::move(timer_info));
+  absl::MutexLock lock(&mutex_);
+  DepthTimers& depth_timers = GetOrCreateDepthTimers(depth);
+  const uint64_t start = timer_info.start();
+  const uint64_t end = timer_info.end();
+  TimerView timer = depth_timers.chain->emplace_back(std::move(timer_info));
+
+  if (depth_timers.blocks.empty() || depth_timers.blocks.back() != timer.block()) {
+    const uint64_t max_end_up_to_previous_block = depth_timers.max_end_up_to_block.empty()
+                                                      ? std::numeric_limits<uint64_t>::min()
+                                                      : depth_timers.max_end_up_to_block.back();
+    depth_timers.blocks.push_back(timer.block());
+    depth_timers.max_end_up_to_block.push_back(max_end_up_to_previous_block);
+  }
+  depth_timers.max_end_up_to_block.back() =
+      std::max(depth_timers.max_end_up_to_block.back(), end);
+  if (start < depth_timers.last_start) depth_timers.sorted_by_start = false;
+  depth_timers.last_start = start;
+
+  return timer;
 }
 
 std::vector<const TimerChain*> TimerData::GetChains() const {
   std::vector<const TimerChain*> chains;
   absl::MutexLock lock(&mutex_);
   for (const auto& it : timers_) {
-    chains.push_back(it.second.get());
+    chains.push_back(it.second.chain.get());
   }
 
   return chains;
@@ -44,12 +65,23 @@ const TimerChain* TimerData::GetChain(uint64_t depth) const {
   absl::MutexLock lock(&mutex_);
   auto it = timers_.find(depth);
   if (it != timers_.end()) {
-    return it->second.get();
+    return it->second.chain.get();
   }
 
   return nullptr;
 }
 
+namespace {
+
+// Returns the index of the first block that can contain timers ending at or after `min_ns`.
+[[nodiscard]] size_t FindFirstBlockEndingAtOrAfter(const std::vector<uint64_t>& max_end_up_to_block,
+                                                   uint64_t min_ns) {
+  return std::lower_bound(max_end_up_to_block.begin(), max_end_up_to_block.end(), min_ns) -
+         max_end_up_to_block.begin();
+}
+
+}  // namespace
+
 std::vector<const orbit_client_protos::TimerInfo*> TimerData::GetTimers(uint64_t min_tick,
                                                                         uint64_t max_tick,
                                                                         bool exclusive) const {
@@ -57,16 +89,25 @@ std::vector<const orbit_client_protos::TimerInfo*> TimerData::GetTimers(uint64_t
   // TODO(b/204173236): use it in TimerTracks.
   absl::MutexLock lock(&mutex_);
   std::vector<const orbit_client_protos::TimerInfo*> timers;
-  for (const auto& [depth, chain] : timers_) {
-    ORBIT_CHECK(chain != nullptr);
-    for (const auto& block : *chain) {
+  for (const auto& [depth, depth_timers] : timers_) {
+    const std::vector<const TimerBlock*>& blocks = depth_timers.blocks;
+    for (size_t block_index = FindFirstBlockEndingAtOrAfter(depth_timers.max_end_up_to_block,
+                                                            min_tick);
+         block_index < blocks.size(); ++block_index) {
+      const TimerBlock& block = *blocks[block_index];
+      // With timers sorted by start timestamp, all the following blocks start after max_tick.
+      if (depth_timers.sorted_by_start && block.MinTimestamp() > max_tick) break;
       if (!block.Intersects(min_tick, max_tick)) continue;
       for (uint64_t i = 0; i < block.size(); i++) {
-        const orbit_client_protos::TimerInfo* timer = &block[i];
+        const TimerView timer = block[i];
         if (exclusive) {
-          if (timer->end() <= max_tick && timer->start() >= min_tick) timers.push_back(timer);
+          if (timer.end() <= max_tick && timer.start() >= min_tick) {
+            timers.push_back(&timer.GetTimerInfo());
+          }
         } else {
-          if (timer->start() <= max_tick && timer->end() >= min_tick) timers.push_back(timer);
+          if (timer.start() <= max_tick && timer.end() >= min_tick) {
+            timers.push_back(&timer.GetTimerInfo());
+          }
         }
       }
     }
@@ -75,8 +116,9 @@ std::vector<const orbit_client_protos::TimerInfo*> TimerData::GetTimers(uint64_t
   return timers;
 }
 
-std::vector<const orbit_client_protos::TimerInfo*> TimerData::GetTimersAtDepthDiscretized(
-    uint32_t depth, uint32_t resolution, uint64_t start_ns, uint64_t end_ns) const {
+std::vector<TimerView> TimerData::GetTimersAtDepthDiscretized(uint32_t depth, uint32_t resolution,
+                                                              uint64_t start_ns,
+                                                              uint64_t end_ns) const {
   ORBIT_SCOPE_WITH_COLOR("GetTimersAtDepthDiscretized", kOrbitColorBlueGrey);
   absl::MutexLock lock(&mutex_);
   // The query is for the interval [start_ns, end_ns], but it's easier to work with the close-open
@@ -84,21 +126,27 @@ std::vector<const orbit_client_protos::TimerInfo*> TimerData::GetTimersAtDepthDi
   // unsigned value. In that case, we will just ignore this max_timestamp for simplicity.
   end_ns = std::max(end_ns, end_ns + 1);
 
-  if (timers_.find(depth) == timers_.end()) return {};
+  const DepthTimers* depth_timers = GetDepthTimers(depth);
+  if (depth_timers == nullptr) return {};
 
-  std::vector<const orbit_client_protos::TimerInfo*> discretized_timers;
+  std::vector<TimerView> discretized_timers;
   uint64_t next_pixel_start_ns = start_ns;
 
-  // We are iterating through all blocks until we are after end_ns.
-  for (const auto& block : *timers_.at(depth)) {
+  // We are iterating through all blocks, skipping the ones entirely before start_ns, until we are
+  // after end_ns.
+  const std::vector<const TimerBlock*>& blocks = depth_timers->blocks;
+  for (size_t block_index =
+           FindFirstBlockEndingAtOrAfter(depth_timers->max_end_up_to_block, start_ns);
+       block_index < blocks.size(); ++block_index) {
+    const TimerBlock& block = *blocks[block_index];
     if (block.MinTimestamp() >= end_ns) break;
 
     // Several candidate timers might be in the same block.
     while (block.Intersects(next_pixel_start_ns, end_ns) && next_pixel_start_ns < end_ns) {
       // First timer for which the end timestamp isn't smaller than the start of the next pixel.
-      const orbit_client_protos::TimerInfo* timer = block.LowerBound(next_pixel_start_ns);
-      if (timer == nullptr || timer->start() >= end_ns) break;
-      discretized_timers.push_back(timer);
+      std::optional<TimerView> timer = block.LowerBound(next_pixel_start_ns);
+      if (!timer.has_value() || timer->start() >= end_ns) break;
+      discretized_timers.push_back(timer.value());
 
       // Use the time of next pixel boundary as a threshold to avoid returning several timers
       // for the same pixel that will overlap after.
@@ -109,39 +157,63 @@ std::vector<const orbit_client_protos::TimerInfo*> TimerData::GetTimersAtDepthDi
 }
 
 const TimerInfo* TimerData::GetFirstAfterStartTime(uint64_t time, uint32_t depth) const {
-  const orbit_client_data::TimerChain* chain = GetChain(depth);
-  if (chain == nullptr) return nullptr;
-
-  // TODO(b/201044462): do better than linear search...
-  for (const auto& it : *chain) {
-    for (size_t k = 0; k < it.size(); ++k) {
-      const orbit_client_protos::TimerInfo& timer_info = it[k];
-      if (timer_info.start() > time) {
-        return &timer_info;
+  absl::MutexLock lock(&mutex_);
+  const DepthTimers* depth_timers = GetDepthTimers(depth);
+  if (depth_timers == nullptr) return nullptr;
+  const std::vector<const TimerBlock*>& blocks = depth_timers->blocks;
+
+  if (!depth_timers->sorted_by_start) {
+    for (const TimerBlock* block : blocks) {
+      for (size_t k = 0; k < block->size(); ++k) {
+        const TimerView timer = (*block)[k];
+        if (timer.start() > time) {
+          return &timer.GetTimerInfo();
+        }
       }
     }
+    return nullptr;
   }
-  return nullptr;
+
+  // The first block whose last timer starts after `time` contains the timer we are looking for.
+  auto block_it =
+      std::partition_point(blocks.begin(), blocks.end(), [time](const TimerBlock* block) {
+        return (*block)[block->size() - 1].start() <= time;
+      });
+  if (block_it == blocks.end()) return nullptr;
+  const TimerBlock& block = **block_it;
+  return &block[block.UpperBoundByStart(time)].GetTimerInfo();
 }
 
 const TimerInfo* TimerData::GetFirstBeforeStartTime(uint64_t time, uint32_t depth) const {
-  const orbit_client_data::TimerChain* chain = GetChain(depth);
-  if (chain == nullptr) return nullptr;
-
-  const orbit_client_protos::TimerInfo* first_timer_before_time = nullptr;
-
-  // TODO(b/201044462): do better than linear search...
-  for (const auto& it : *chain) {
-    for (size_t k = 0; k < it.size(); ++k) {
-      const orbit_client_protos::TimerInfo* timer_info = &it[k];
-      if (timer_info->start() >= time) {
-        return first_timer_before_time;
+  absl::MutexLock lock(&mutex_);
+  const DepthTimers* depth_timers = GetDepthTimers(depth);
+  if (depth_timers == nullptr) return nullptr;
+  const std::vector<const TimerBlock*>& blocks = depth_timers->blocks;
+
+  if (!depth_timers->sorted_by_start) {
+    std::optional<TimerView> first_timer_before_time;
+    for (const TimerBlock* block : blocks) {
+      for (size_t k = 0; k < block->size(); ++k) {
+        const TimerView timer = (*block)[k];
+        if (timer.start() >= time) {
+          return first_timer_before_time.has_value() ? &first_timer_before_time->GetTimerInfo()
+                                                     : nullptr;
+        }
+        first_timer_before_time = timer;
       }
-      first_timer_before_time = timer_info;
     }
+    return first_timer_before_time.has_value() ? &first_timer_before_time->GetTimerInfo()
+                                               : nullptr;
   }
 
-  return first_timer_before_time;
+  // The block before the first block whose first timer doesn't start before `time` contains the
+  // timer we are looking for.
+  auto block_it = std::partition_point(
+      blocks.begin(), blocks.end(),
+      [time](const TimerBlock* block) { return (*block)[0].start() < time; });
+  if (block_it == blocks.begin()) return nullptr;
+  const TimerBlock& block = **std::prev(block_it);
+  return &block[block.LowerBoundByStart(time) - 1].GetTimerInfo();
 }
 
 void TimerData::UpdateMinTime(uint64_t min_time) {
@@ -156,16 +228,17 @@ void TimerData::UpdateMaxTime(uint64_t max_time) {
   }
 }
 
-TimerChain* TimerData::GetOrCreateTimerChain(uint64_t depth) {
-  absl::MutexLock lock(&mutex_);
+TimerData::DepthTimers& TimerData::GetOrCreateDepthTimers(uint32_t depth) {
+  return timers_[depth];
+}
+
+const TimerData::DepthTimers* TimerData::GetDepthTimers(uint32_t depth) const {
   auto it = timers_.find(depth);
   if (it != timers_.end()) {
-    return it->second.get();
+    return &it->second;
   }
 
-  auto [inserted_it, inserted] = timers_.insert_or_assign(depth, std::make_unique<TimerChain>());
-  ORBIT_CHECK(inserted);
-  return inserted_it->second.get();
+  return nullptr;
 }
 
 }  // namespace orbit_client_data
\ No newline at end of file
@@ -6,8 +6,10 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "ClientData/TimerChain.h"
@@ -286,4 +288,122 @@ TEST(TimerData, GetTimersAtDepthDiscretized) {
   verify_size(2, kNormalResolution, kMinTimestamp, kMaxTimestamp, 0);
 }
 
-}  // namespace orbit_client_data
\ No newline at end of file
+namespace {
+
+// Enough timers to fill several blocks of the TimerChains. Timer i starts at 10 * i, and every
+// hundredth timer lasts longer, so that the end timestamps are not sorted.
+constexpr uint64_t kManyTimersCount = 5000;
+
+TimerInfo GetTimerWithIndex(uint64_t index) {
+  TimerInfo timer_info;
+  timer_info.set_start(10 * index);
+  timer_info.set_end(10 * index + (index % 100 == 0 ? 2500 : 5));
+  return timer_info;
+}
+
+std::vector<uint64_t> GetTimeQueries() {
+  std::vector<uint64_t> times{0, 1, std::numeric_limits<uint64_t>::max()};
+  for (uint64_t time = 10 * 1000 - 25; time < 10 * 1100; ++time) times.push_back(time);
+  for (uint64_t time = 10 * (kManyTimersCount - 3); time < 10 * (kManyTimersCount + 1); ++time) {
+    times.push_back(time);
+  }
+  for (uint64_t time = 7; time < 10 * kManyTimersCount; time += 997) times.push_back(time);
+  return times;
+}
+
+// The linear searches that TimerData used before indexing its TimerChains, as a reference.
+const TimerInfo* GetFirstAfterStartTimeLinear(const TimerChain& chain, uint64_t time) {
+  for (const TimerBlock& block : chain) {
+    for (size_t k = 0; k < block.size(); ++k) {
+      if (block[k].start() > time) return &block[k].GetTimerInfo();
+    }
+  }
+  return nullptr;
+}
+
+const TimerInfo* GetFirstBeforeStartTimeLinear(const TimerChain& chain, uint64_t time) {
+  std::optional<TimerView> first_timer_before_time;
+  for (const TimerBlock& block : chain) {
+    for (size_t k = 0; k < block.size(); ++k) {
+      if (block[k].start() >= time) {
+        return first_timer_before_time.has_value() ? &first_timer_before_time->GetTimerInfo()
+                                                   : nullptr;
+      }
+      first_timer_before_time = block[k];
+    }
+  }
+  return first_timer_before_time.has_value() ? &first_timer_before_time->GetTimerInfo() : nullptr;
+}
+
+std::vector<const TimerInfo*> GetTimersLinear(const std::vector<const TimerChain*>& chains,
+                                              uint64_t min_tick, uint64_t max_tick) {
+  std::vector<const TimerInfo*> timers;
+  for (const TimerChain* chain : chains) {
+    for (const TimerBlock& block : *chain) {
+      if (!block.Intersects(min_tick, max_tick)) continue;
+      for (uint64_t i = 0; i < block.size(); i++) {
+        if (block[i].start() <= max_tick && block[i].end() >= min_tick) {
+          timers.push_back(&block[i].GetTimerInfo());
+        }
+      }
+    }
+  }
+  return timers;
+}
+
+void CheckQueriesMatchLinearSearch(const TimerData& timer_data) {
+  const TimerChain* chain = timer_data.GetChain(0);
+  ASSERT_NE(chain, nullptr);
+  const std::vector<uint64_t> times = GetTimeQueries();
+  for (uint64_t time : times) {
+    EXPECT_EQ(timer_data.GetFirstAfterStartTime(time, 0),
+              GetFirstAfterStartTimeLinear(*chain, time))
+        << time;
+    EXPECT_EQ(timer_data.GetFirstBeforeStartTime(time, 0),
+              GetFirstBeforeStartTimeLinear(*chain, time))
+        << time;
+  }
+
+  for (size_t i = 0; i + 1 < times.size(); i += 7) {
+    const uint64_t min_tick = std::min(times[i], times[i + 1]);
+    const uint64_t max_tick = std::max(times[i], times[i + 1]);
+    EXPECT_EQ(timer_data.GetTimers(min_tick, max_tick),
+              GetTimersLinear(timer_data.GetChains(), min_tick, max_tick))
+        << min_tick << " " << max_tick;
+  }
+}
+
+}  // namespace
+
+TEST(TimerData, QueriesOnSortedTimersInManyBlocks) {
+  TimerData timer_data;
+  for (uint64_t i = 0; i < kManyTimersCount; ++i) {
+    timer_data.AddTimer(GetTimerWithIndex(i));
+  }
+  CheckQueriesMatchLinearSearch(timer_data);
+
+  const TimerInfo* timer_info = timer_data.GetFirstAfterStartTime(10 * 1023, 0);
+  ASSERT_NE(timer_info, nullptr);
+  EXPECT_EQ(timer_info->start(), 10 * 1024);
+  timer_info = timer_data.GetFirstBeforeStartTime(10 * 1024, 0);
+  ASSERT_NE(timer_info, nullptr);
+  EXPECT_EQ(timer_info->start(), 10 * 1023);
+
+  // The long timers starting at 10 * 900 and 10 * 1000, in the first block, still overlap a range
+  // in the second block.
+  std::vector<const TimerInfo*> timers = timer_data.GetTimers(10 * 1050 + 6, 10 * 1050 + 7);
+  ASSERT_EQ(timers.size(), 2);
+  EXPECT_EQ(timers[0]->start(), 10 * 900);
+  EXPECT_EQ(timers[1]->start(), 10 * 1000);
+}
+
+TEST(TimerData, QueriesOnUnsortedTimersInManyBlocks) {
+  TimerData timer_data;
+  for (uint64_t i = 0; i < kManyTimersCount; ++i) {
+    // Swap pairs of consecutive timers.
+    timer_data.AddTimer(GetTimerWithIndex(i ^ 1));
+  }
+  CheckQueriesMatchLinearSearch(timer_data);
+}
+
+}  // namespace orbit_client_data
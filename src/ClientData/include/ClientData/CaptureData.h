@@ -144,6 +144,8 @@ class CaptureData {
   [[nodiscard]] const ScopeStats& GetScopeStatsOrDefault(ScopeId scope_id) const;
 
   void UpdateScopeStats(const TimerInfo& timer_info);
+  // Adds the calls summarized by the instrumented process to the stats of the function's scope.
+  void AddFunctionCallSummary(const orbit_grpc_protos::FunctionCallSummary& function_call_summary);
   void AddScopeStats(ScopeId scope_id, ScopeStats stats);
 
   void OnCaptureComplete();
@@ -5,6 +5,7 @@
 #ifndef ORBIT_CLIENT_DATA_MOCK_SCOPE_STATS_COLLECTION_H_
 #define ORBIT_CLIENT_DATA_MOCK_SCOPE_STATS_COLLECTION_H_
 
+#include <absl/types/span.h>
 #include <gmock/gmock.h>
 #include <stdint.h>
 
@@ -21,6 +22,8 @@ class MockScopeStatsCollection : public ScopeStatsCollectionInterface {
               (const, override));
 
   MOCK_METHOD(void, UpdateScopeStats, (ScopeId, const TimerInfo& timer), (override));
+  MOCK_METHOD(void, MergeScopeStats, (ScopeId, const ScopeStats&, absl::Span<const uint64_t>),
+              (override));
   MOCK_METHOD(void, SetScopeStats, (ScopeId, ScopeStats), (override));
   MOCK_METHOD(void, OnCaptureComplete, (), (override));
 };
@@ -19,6 +19,9 @@ class ScopeStats {
   explicit ScopeStats() = default;
 
   void UpdateStats(uint64_t elapsed_nanos);
+  // Combines these statistics with the ones of other occurrences of the same scope, e.g. those that
+  // an instrumented process has already aggregated.
+  void MergeStats(const ScopeStats& other);
 
   [[nodiscard]] uint64_t ComputeAverageTimeNs() const;
 
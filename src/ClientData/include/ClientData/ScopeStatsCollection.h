@@ -35,6 +35,12 @@ class ScopeStatsCollectionInterface {
   // Calling this function causes the timer durations to no longer be sorted. OnCaptureComplete()
   // *must* be called after UpdateScopeStats and before GetSortedTimerDurationsForScopeId().
   virtual void UpdateScopeStats(ScopeId scope_id, const TimerInfo& timer) = 0;
+  // Adds occurrences of the scope for which only the aggregated statistics are known.
+  // `duration_log2_histogram[i]` is the number of these occurrences with a duration d such that
+  // floor(log2(d)) == i. Each of them is added to the timer durations with the duration in the
+  // middle of its bucket, clamped to the min and max of `stats`.
+  virtual void MergeScopeStats(ScopeId scope_id, const ScopeStats& stats,
+                               absl::Span<const uint64_t> duration_log2_histogram) = 0;
   // TODO(b/249046906): Remove this test-only function.
   virtual void SetScopeStats(ScopeId scope_id, ScopeStats stats) = 0;
   virtual void OnCaptureComplete() = 0;
@@ -52,6 +58,8 @@ class ScopeStatsCollection : public ScopeStatsCollectionInterface {
       ScopeId scope_id) const override;
 
   void UpdateScopeStats(ScopeId scope_id, const TimerInfo& timer) override;
+  void MergeScopeStats(ScopeId scope_id, const ScopeStats& stats,
+                       absl::Span<const uint64_t> duration_log2_histogram) override;
   void SetScopeStats(ScopeId scope_id, ScopeStats stats) override;
   void OnCaptureComplete() override;
 
@@ -15,6 +15,7 @@
 
 #include "ClientData/TimerChain.h"
 #include "ClientProtos/capture_data.pb.h"
+#include "Containers/BlockChain.h"
 #include "Containers/ScopeTree.h"
 #include "TimerData.h"
 #include "TimerDataInterface.h"
@@ -32,8 +33,8 @@ class ScopeTreeTimerData final : public TimerDataInterface {
 
   // We are using a ScopeTree to automatically manage timers and their depth, no need to set it
   // here.
-  const orbit_client_protos::TimerInfo& AddTimer(orbit_client_protos::TimerInfo timer_info,
-                                                 uint32_t /*unused_depth*/ = 0) override;
+  TimerView AddTimer(orbit_client_protos::TimerInfo timer_info,
+                     uint32_t /*unused_depth*/ = 0) override;
   // Timers queries
   [[nodiscard]] std::vector<const TimerChain*> GetChains() const override {
     return timer_data_.GetChains();
@@ -49,7 +50,7 @@ class ScopeTreeTimerData final : public TimerDataInterface {
   [[nodiscard]] std::vector<const orbit_client_protos::TimerInfo*> GetTimersAtDepthExclusive(
       uint32_t depth, uint64_t start_ns = std::numeric_limits<uint64_t>::min(),
       uint64_t end_ns = std::numeric_limits<uint64_t>::max()) const;
-  [[nodiscard]] std::vector<const orbit_client_protos::TimerInfo*> GetTimersAtDepthDiscretized(
+  [[nodiscard]] std::vector<TimerView> GetTimersAtDepthDiscretized(
       uint32_t depth, uint32_t resolution, uint64_t start_ns, uint64_t end_ns) const override;
 
   // Metadata queries
@@ -83,8 +84,10 @@ class ScopeTreeTimerData final : public TimerDataInterface {
  private:
   const int64_t thread_id_;
   mutable absl::Mutex scope_tree_mutex_;
-  orbit_containers::ScopeTree<const orbit_client_protos::TimerInfo> scope_tree_
-      ABSL_GUARDED_BY(scope_tree_mutex_);
+  // The ScopeTree references views of the timers, so that it doesn't require creating a TimerInfo
+  // for each of them.
+  orbit_containers::BlockChain<TimerView, 1024> timer_views_ ABSL_GUARDED_BY(scope_tree_mutex_);
+  orbit_containers::ScopeTree<const TimerView> scope_tree_ ABSL_GUARDED_BY(scope_tree_mutex_);
   ScopeTreeUpdateType scope_tree_update_type_;
 
   TimerData timer_data_;
@@ -30,7 +30,7 @@ class ThreadTrackDataProvider final {
       : thread_track_data_manager_{
             std::make_unique<ThreadTrackDataManager>(is_data_from_saved_capture)} {};
 
-  const orbit_client_protos::TimerInfo& AddTimer(orbit_client_protos::TimerInfo timer_info) {
+  TimerView AddTimer(orbit_client_protos::TimerInfo timer_info) {
     return thread_track_data_manager_->AddTimer(std::move(timer_info));
   }
 
@@ -59,7 +59,7 @@ class ThreadTrackDataProvider final {
   // when many timers map to the same pixel (zooming-out for example). The overall complexity is
   // O(log(num_timers) * resolution). Resolution should be the pixel width of the area where timers
   // will be drawn.
-  [[nodiscard]] std::vector<const orbit_client_protos::TimerInfo*> GetTimersAtDepthDiscretized(
+  [[nodiscard]] std::vector<TimerView> GetTimersAtDepthDiscretized(
       uint32_t thread_id, uint32_t depth, uint32_t resolution, uint64_t start_ns,
       uint64_t end_ns) const {
     return GetScopeTreeTimerData(thread_id)->GetTimersAtDepthDiscretized(depth, resolution,
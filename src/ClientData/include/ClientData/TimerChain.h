@@ -6,11 +6,14 @@
 #define CLIENT_DATA_TIMER_CHAIN_H_
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <iosfwd>
 #include <limits>
+#include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -19,34 +22,81 @@
 
 namespace orbit_client_data {
 
+class TimerBlock;
+
+// TimerView is a lightweight reference to a timer stored in a TimerBlock. It gives access to the
+// fields of the timer that TimerBlock stores in columns, which are the ones needed by most queries,
+// without creating an orbit_client_protos::TimerInfo. The getters have the same names as the ones
+// of TimerInfo. Use GetTimerInfo to access all the other fields.
+class TimerView {
+ public:
+  // Creates a view of a default TimerInfo.
+  TimerView();
+  TimerView(const TimerBlock* block, uint32_t index) : block_(block), index_(index) {}
+
+  [[nodiscard]] inline uint64_t start() const;
+  [[nodiscard]] inline uint64_t end() const;
+  [[nodiscard]] inline uint32_t process_id() const;
+  [[nodiscard]] inline uint32_t thread_id() const;
+  [[nodiscard]] inline uint32_t depth() const;
+  [[nodiscard]] inline orbit_client_protos::TimerInfo::Type type() const;
+  [[nodiscard]] inline int32_t processor() const;
+  [[nodiscard]] inline uint64_t function_id() const;
+  [[nodiscard]] inline uint64_t user_data_key() const;
+
+  // Returns the complete TimerInfo. It is created the first time it is requested, and then kept
+  // for as long as the TimerBlock exists, so the returned reference stays valid and is the same for
+  // all views of the same timer.
+  [[nodiscard]] inline const orbit_client_protos::TimerInfo& GetTimerInfo() const;
+  // Overwrites `timer_info` with the complete timer. Unlike GetTimerInfo, this doesn't keep any
+  // additional memory, which makes it preferable when scanning many timers.
+  inline void CopyToTimerInfo(orbit_client_protos::TimerInfo* timer_info) const;
+  // Returns whether `timer_info` is the TimerInfo returned by GetTimerInfo for this timer, without
+  // creating it if it wasn't requested yet.
+  [[nodiscard]] inline bool HasTimerInfo(const orbit_client_protos::TimerInfo* timer_info) const;
+
+  [[nodiscard]] const TimerBlock* block() const { return block_; }
+  [[nodiscard]] uint32_t index() const { return index_; }
+
+  friend bool operator==(const TimerView& lhs, const TimerView& rhs) {
+    return lhs.block_ == rhs.block_ && lhs.index_ == rhs.index_;
+  }
+  friend bool operator!=(const TimerView& lhs, const TimerView& rhs) { return !(lhs == rhs); }
+
+ private:
+  const TimerBlock* block_;
+  uint32_t index_;
+};
+
 // TimerBlock is a straightforward specialization of Block (see BlockChain.h) with the added bonus
 // that it keeps track of the minimum and maximum timestamps of all timers added to it. This allows
 // trivial rejection of an entire block by using the Intersects(t_min, t_max) method. This
 // effectively tests if any of the timers stored in this block intersects with the [t_min, t_max]
 // interval.
+//
+// Timers are not stored as TimerInfo messages, which take well over a hundred bytes each. Instead,
+// the fields that (almost) all timers set are stored in columns of fixed-width values, and the
+// remaining fields, e.g., registers, colors and names of manual instrumentation scopes, are only
+// kept for the timers that set any of them, in a separately allocated TimerInfo. Complete
+// TimerInfos are only created on request, see TimerView::GetTimerInfo. Storing each field
+// contiguously also makes the queries that only read timestamps, like LowerBound, touch a fraction
+// of the memory.
+//
+// A single thread can add timers while other threads read the ones already added, without locking.
 class TimerBlock {
   friend class TimerChain;
   friend class TimerChainIterator;
+  friend class TimerView;
 
  public:
-  explicit TimerBlock(TimerBlock* prev)
-      : prev_(prev),
-        next_(nullptr),
-        min_timestamp_(std::numeric_limits<uint64_t>::max()),
-        max_timestamp_(std::numeric_limits<uint64_t>::min()) {
-    data_.reserve(kBlockSize);
-  }
+  explicit TimerBlock(TimerBlock* prev);
+  ~TimerBlock();
 
-  // Append a new element to the end of the block using placement-new.
-  template <class... Args>
-  const orbit_client_protos::TimerInfo& emplace_back(Args&&... args) {
-    ORBIT_CHECK(size() < kBlockSize);
-    const orbit_client_protos::TimerInfo& timer_info =
-        data_.emplace_back(std::forward<Args>(args)...);
-    min_timestamp_ = std::min(timer_info.start(), min_timestamp_);
-    max_timestamp_ = std::max(timer_info.end(), max_timestamp_);
-    return timer_info;
-  }
+  TimerBlock(const TimerBlock&) = delete;
+  TimerBlock& operator=(const TimerBlock&) = delete;
+
+  // Append a new timer to the end of the block.
+  TimerView emplace_back(orbit_client_protos::TimerInfo timer_info);
 
   // Tests if [min, max] intersects with [min_timestamp, max_timestamp], where
   // {min, max}_timestamp are the minimum and maximum timestamp of the timers
@@ -54,28 +104,93 @@ class TimerBlock {
   [[nodiscard]] bool Intersects(uint64_t min, uint64_t max) const;
   [[nodiscard]] uint64_t MinTimestamp() const { return min_timestamp_; }
 
-  [[nodiscard]] size_t size() const { return data_.size(); }
+  [[nodiscard]] size_t size() const { return size_.load(std::memory_order_acquire); }
   [[nodiscard]] bool at_capacity() const { return size() == kBlockSize; }
 
-  [[nodiscard]] const orbit_client_protos::TimerInfo& operator[](std::size_t idx) const {
-    return data_[idx];
+  [[nodiscard]] TimerView operator[](std::size_t idx) const {
+    return TimerView{this, static_cast<uint32_t>(idx)};
   }
 
   // Assuming timers are sorted, returns the first one for which the end timestamp isn't smaller
-  // than min_ns. Return nullptr if there is none.
-  [[nodiscard]] const orbit_client_protos::TimerInfo* LowerBound(uint64_t min_ns) const;
+  // than min_ns. Return std::nullopt if there is none.
+  [[nodiscard]] std::optional<TimerView> LowerBound(uint64_t min_ns) const;
+
+  // Assuming timers are sorted by start timestamp, return the index of the first one whose start
+  // timestamp isn't smaller than (LowerBoundByStart) or is greater than (UpperBoundByStart)
+  // `start_ns`. Return size() if there is none.
+  [[nodiscard]] size_t LowerBoundByStart(uint64_t start_ns) const;
+  [[nodiscard]] size_t UpperBoundByStart(uint64_t start_ns) const;
+
+  // Returns the index of the timer whose TimerInfo, as returned by TimerView::GetTimerInfo, is
+  // `timer_info`, or std::nullopt if it is not in this block. Candidates are found by the start
+  // timestamp of `timer_info`, with a binary search if the timers were added in order of start
+  // timestamp.
+  [[nodiscard]] std::optional<uint32_t> FindIndexOfTimerInfo(
+      const orbit_client_protos::TimerInfo& timer_info) const;
 
  private:
   static constexpr size_t kBlockSize = 1024;
 
+  using CreatedTimerInfos =
+      std::array<std::atomic<const orbit_client_protos::TimerInfo*>, kBlockSize>;
+
+  [[nodiscard]] const orbit_client_protos::TimerInfo& GetTimerInfo(uint32_t index) const;
+  // Returns the TimerInfo created by GetTimerInfo, or nullptr if none was requested yet.
+  [[nodiscard]] const orbit_client_protos::TimerInfo* GetCreatedTimerInfo(uint32_t index) const;
+  void CopyToTimerInfo(uint32_t index, orbit_client_protos::TimerInfo* timer_info) const;
+
+  // Kept together, as they are all that is accessed when skipping blocks.
   TimerBlock* prev_;
   TimerBlock* next_;
-  std::vector<orbit_client_protos::TimerInfo> data_;
-
   uint64_t min_timestamp_;
   uint64_t max_timestamp_;
-};  // TimerChainIterator iterates over all *blocks* of the chain, not the
-// individual items (TimerInfo instances) that are stored in the blocks (this is
+
+  // The columns, all with the same number of elements, and reserved to kBlockSize so that they
+  // are never reallocated.
+  std::vector<uint64_t> starts_;
+  std::vector<uint64_t> ends_;
+  std::vector<uint64_t> function_ids_;
+  std::vector<uint64_t> user_data_keys_;
+  std::vector<uint32_t> process_ids_;
+  std::vector<uint32_t> thread_ids_;
+  std::vector<uint32_t> depths_;
+  std::vector<int32_t> processors_;
+  std::vector<uint8_t> types_;
+  // For the timers with fields not stored in the other columns, a TimerInfo with only these fields
+  // set, and nullptr for all other timers.
+  std::vector<std::unique_ptr<const orbit_client_protos::TimerInfo>> other_fields_;
+  std::atomic<size_t> size_{0};
+  std::atomic<bool> sorted_by_start_{true};
+
+  // The TimerInfos created by GetTimerInfo, by index. The array is only allocated on the first
+  // request, and only the requested TimerInfos are created.
+  mutable std::atomic<CreatedTimerInfos*> created_timer_infos_{nullptr};
+};
+
+uint64_t TimerView::start() const { return block_->starts_[index_]; }
+uint64_t TimerView::end() const { return block_->ends_[index_]; }
+uint32_t TimerView::process_id() const { return block_->process_ids_[index_]; }
+uint32_t TimerView::thread_id() const { return block_->thread_ids_[index_]; }
+uint32_t TimerView::depth() const { return block_->depths_[index_]; }
+orbit_client_protos::TimerInfo::Type TimerView::type() const {
+  return static_cast<orbit_client_protos::TimerInfo::Type>(block_->types_[index_]);
+}
+int32_t TimerView::processor() const { return block_->processors_[index_]; }
+uint64_t TimerView::function_id() const { return block_->function_ids_[index_]; }
+uint64_t TimerView::user_data_key() const { return block_->user_data_keys_[index_]; }
+
+const orbit_client_protos::TimerInfo& TimerView::GetTimerInfo() const {
+  return block_->GetTimerInfo(index_);
+}
+void TimerView::CopyToTimerInfo(orbit_client_protos::TimerInfo* timer_info) const {
+  block_->CopyToTimerInfo(index_, timer_info);
+}
+bool TimerView::HasTimerInfo(const orbit_client_protos::TimerInfo* timer_info) const {
+  return timer_info != nullptr && block_->GetCreatedTimerInfo(index_) == timer_info;
+}
+
+// TimerChainIterator iterates over all *blocks* of the chain, not the
+// individual items (timers) that are stored in the blocks (this is
 // different from the BlockIterator in BlockChain.h).
 class TimerChainIterator {
  public:
@@ -112,21 +227,16 @@ class TimerChain {
 
   // Append an item to the end of the current block. If capacity of the current block is reached, a
   // new blocked is allocated and the item is added to the new block.
-  template <class... Args>
-  const orbit_client_protos::TimerInfo& emplace_back(Args&&... args) {
+  TimerView emplace_back(orbit_client_protos::TimerInfo timer_info) {
     if (current_->at_capacity()) AllocateNewBlock();
-    const orbit_client_protos::TimerInfo& timer_info =
-        current_->emplace_back(std::forward<Args>(args)...);
+    TimerView timer_view = current_->emplace_back(std::move(timer_info));
     ++num_items_;
-    return timer_info;
+    return timer_view;
   }
 
   [[nodiscard]] bool empty() const { return num_items_ == 0; }
   [[nodiscard]] uint64_t size() const { return num_items_; }
 
-  [[nodiscard]] const TimerBlock* GetBlockContaining(
-      const orbit_client_protos::TimerInfo& element) const;
-
   [[nodiscard]] const orbit_client_protos::TimerInfo* GetElementAfter(
       const orbit_client_protos::TimerInfo& element) const;
 
@@ -145,6 +255,9 @@ class TimerChain {
     ++num_blocks_;
   }
 
+  [[nodiscard]] std::optional<TimerView> FindTimerView(
+      const orbit_client_protos::TimerInfo& element) const;
+
   TimerBlock* root_ = new TimerBlock(/*prev=*/nullptr);
   TimerBlock* current_ = root_;
   uint64_t num_blocks_ = 1;
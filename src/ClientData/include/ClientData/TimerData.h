@@ -28,15 +28,15 @@ namespace orbit_client_data {
 // certain range as well as metadata from them. Timers might be divided in different depths.
 class TimerData final : public TimerDataInterface {
  public:
-  const orbit_client_protos::TimerInfo& AddTimer(orbit_client_protos::TimerInfo timer_info,
-                                                 uint32_t depth = 0) override;
+  TimerView AddTimer(orbit_client_protos::TimerInfo timer_info, uint32_t depth = 0) override;
 
   // Timers queries
   [[nodiscard]] std::vector<const TimerChain*> GetChains() const override;
   [[nodiscard]] const TimerChain* GetChain(uint64_t depth) const;
 
-  // The method is not optimized. The complexity is linear in the total number of timer_infos,
-  // sortedness is not made use of.
+  // Blocks of timers that are entirely before min_tick are skipped with a binary search. If the
+  // timers of a depth were added in order of start timestamp, the search also stops at the first
+  // block entirely after max_tick.
   [[nodiscard]] std::vector<const orbit_client_protos::TimerInfo*> GetTimers(
       uint64_t min_tick = std::numeric_limits<uint64_t>::min(),
       uint64_t max_tick = std::numeric_limits<uint64_t>::max(),
@@ -45,7 +45,7 @@ class TimerData final : public TimerDataInterface {
   // same pixels in the screen. It assures to return at least one timer in each occupied pixel. The
   // overall complexity is faster than GetTimers since it doesn't require going through all timers.
   // TODO(b/200692451): Provide a better solution for TimerTrack with intersecting timers.
-  [[nodiscard]] std::vector<const orbit_client_protos::TimerInfo*> GetTimersAtDepthDiscretized(
+  [[nodiscard]] std::vector<TimerView> GetTimersAtDepthDiscretized(
       uint32_t depth, uint32_t resolution, uint64_t start_ns, uint64_t end_ns) const override;
 
   // Metadata queries
@@ -58,6 +58,8 @@ class TimerData final : public TimerDataInterface {
   [[nodiscard]] uint32_t GetProcessId() const override { return process_id_; }
 
   // Relative timers queries.
+  // If the timers of `depth` were added in order of start timestamp, these take logarithmic time.
+  // Otherwise, they fall back to a linear search in order of insertion.
   // TODO(b/221024788): These queries assume Timers are inserted in order and don't work for
   // GpuSubmissionTrack.
   [[nodiscard]] const orbit_client_protos::TimerInfo* GetFirstAfterStartTime(uint64_t time,
@@ -93,11 +95,29 @@ class TimerData final : public TimerDataInterface {
   void UpdateMinTime(uint64_t min_time);
   void UpdateMaxTime(uint64_t max_time);
   void UpdateDepth(uint32_t depth) { depth_ = std::max(depth_, depth); }
-  [[nodiscard]] TimerChain* GetOrCreateTimerChain(uint64_t depth);
+
+  // The timers of a depth, with an index of the blocks of the chain, which allows finding the
+  // blocks relevant for a query with a binary search rather than by following the chain.
+  struct DepthTimers {
+    std::unique_ptr<TimerChain> chain = std::make_unique<TimerChain>();
+    std::vector<const TimerBlock*> blocks;
+    // For each block, the maximum end timestamp of the timers in that block and in all the
+    // previous ones. Unlike the maximum end timestamp of each block, this is non-decreasing.
+    std::vector<uint64_t> max_end_up_to_block;
+    // Whether the timers were added in non-decreasing order of start timestamp, which searching by
+    // start timestamp requires.
+    bool sorted_by_start = true;
+    uint64_t last_start = std::numeric_limits<uint64_t>::min();
+  };
+
+  [[nodiscard]] DepthTimers& GetOrCreateDepthTimers(uint32_t depth)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  [[nodiscard]] const DepthTimers* GetDepthTimers(uint32_t depth) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   uint32_t depth_ = 0;
   mutable absl::Mutex mutex_;
-  std::map<uint32_t, std::unique_ptr<TimerChain>> timers_ ABSL_GUARDED_BY(mutex_);
+  std::map<uint32_t, DepthTimers> timers_ ABSL_GUARDED_BY(mutex_);
   std::atomic<size_t> num_timers_{0};
   std::atomic<uint64_t> min_time_{std::numeric_limits<uint64_t>::max()};
   std::atomic<uint64_t> max_time_{std::numeric_limits<uint64_t>::min()};
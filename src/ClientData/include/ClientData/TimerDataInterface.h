@@ -16,22 +16,22 @@ class TimerDataInterface {
  public:
   virtual ~TimerDataInterface() = default;
 
-  virtual const orbit_client_protos::TimerInfo& AddTimer(orbit_client_protos::TimerInfo timer_info,
-                                                         uint32_t depth) = 0;
+  virtual TimerView AddTimer(orbit_client_protos::TimerInfo timer_info, uint32_t depth) = 0;
 
   // Timers queries
   [[nodiscard]] virtual std::vector<const TimerChain*> GetChains() const = 0;
   // Returns all timers contained in [min_tick, max_tick] (always inclusive).
   // if exclusive=true, excludes timers that start or end outside of the time range.
   // if exclusive=false, includes all timers that intersect with the time range.
+  // The TimerInfos are created on the first request and then kept, see TimerView::GetTimerInfo.
   [[nodiscard]] virtual std::vector<const orbit_client_protos::TimerInfo*> GetTimers(
       uint64_t min_tick, uint64_t max_tick, bool exclusive) const = 0;
   // Returns timers in a particular depth avoiding completely overlapped timers that map to the
   // same pixels in the screen. It assures to return at least one timer in each occupied pixel. The
   // overall complexity is faster than GetTimers since it doesn't require going through all timers.
-  [[nodiscard]] virtual std::vector<const orbit_client_protos::TimerInfo*>
-  GetTimersAtDepthDiscretized(uint32_t depth, uint32_t resolution, uint64_t start_ns,
-                              uint64_t end_ns) const = 0;
+  // Views are returned, as this is called for every frame and doesn't need complete TimerInfos.
+  [[nodiscard]] virtual std::vector<TimerView> GetTimersAtDepthDiscretized(
+      uint32_t depth, uint32_t resolution, uint64_t start_ns, uint64_t end_ns) const = 0;
 
   // Metadata queries
   [[nodiscard]] virtual bool IsEmpty() const = 0;
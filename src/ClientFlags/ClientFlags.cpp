@@ -27,6 +27,11 @@ ABSL_FLAG(std::string, process_name, "",
 // TODO: Remove this flag once we have a way to toggle the display return values
 ABSL_FLAG(bool, show_return_values, false, "Show return values on time slices");
 
+ABSL_FLAG(bool, aggregate_instrumented_calls, false,
+          "With the \"Orbit\" dynamic instrumentation method, only collect statistics of the calls "
+          "of instrumented functions for the live functions view, instead of a time slice for "
+          "every call");
+
 ABSL_FLAG(bool, enable_tracepoint_feature, false,
           "Enable the setting of the panel of kernel tracepoints");
 
@@ -69,6 +74,19 @@ ABSL_FLAG(bool, symbol_store_support, false, "Enable experimental symbol store s
 // Disables retrieving symbols from the instance. This is intended for symbol store e2e tests.
 ABSL_FLAG(bool, disable_instance_symbols, false, "Disable retrieving symbols from the instance.");
 
+ABSL_FLAG(bool, save_capture_on_separate_thread, true,
+          "While capturing, save the capture to file on a separate thread, in parallel with "
+          "processing the capture for the UI.");
+
+ABSL_FLAG(bool, memory_map_capture_files, false,
+          "When loading a capture, read the capture file through a memory mapping instead of with "
+          "read calls.");
+
+ABSL_FLAG(std::string, capture_file_compression, "none",
+          "Compression of the capture files that are saved while capturing: \"none\", \"fast\" "
+          "or \"small\". Compressed capture files are about 2.5 times smaller, but take longer to "
+          "save and to load.");
+
 // SSH Flags
 ABSL_FLAG(std::string, ssh_hostname, "", "Hostname (IP address) of machine for an SSH connection.");
 ABSL_FLAG(uint16_t, ssh_port, 22, "Port for SSH connection. Default is 22");
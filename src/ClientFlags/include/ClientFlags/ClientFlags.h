@@ -29,6 +29,8 @@ ABSL_DECLARE_FLAG(bool, frame_pointer_unwinding);
 // TODO: Remove this flag once we have a way to toggle the display return values
 ABSL_DECLARE_FLAG(bool, show_return_values);
 
+ABSL_DECLARE_FLAG(bool, aggregate_instrumented_calls);
+
 ABSL_DECLARE_FLAG(bool, enable_tracepoint_feature);
 
 // TODO(b/185099421): Remove this flag once we have a clear explanation of the memory warning
@@ -65,6 +67,15 @@ ABSL_DECLARE_FLAG(bool, symbol_store_support);
 // Disables retrieving symbols from the instance.
 ABSL_DECLARE_FLAG(bool, disable_instance_symbols);
 
+// Runs the automatic saving of captures on its own thread.
+ABSL_DECLARE_FLAG(bool, save_capture_on_separate_thread);
+
+// Reads loaded capture files through a memory mapping.
+ABSL_DECLARE_FLAG(bool, memory_map_capture_files);
+
+// Compression of automatically saved capture files: "none", "fast" or "small".
+ABSL_DECLARE_FLAG(std::string, capture_file_compression);
+
 // SSH related flags.
 ABSL_DECLARE_FLAG(std::string, ssh_hostname);
 ABSL_DECLARE_FLAG(uint16_t, ssh_port);
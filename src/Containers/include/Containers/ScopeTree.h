@@ -87,13 +87,20 @@ class ScopeTree {
   [[nodiscard]] const absl::btree_map<uint64_t /*start time*/, ScopeNodeT*>& GetOrderedNodesAtDepth(
       uint32_t depth) const;
   [[nodiscard]] const ScopeT* FindFirstScopeAtOrAfterTime(uint32_t depth, uint64_t time) const;
-  [[nodiscard]] const ScopeT* FindNextScopeAtDepth(const ScopeT& scope) const;
-  [[nodiscard]] const ScopeT* FindPreviousScopeAtDepth(const ScopeT& scope) const;
-  [[nodiscard]] const ScopeT* FindParent(const ScopeT& scope) const;
-  [[nodiscard]] const ScopeT* FindFirstChild(const ScopeT& scope) const;
+  // The following methods look up `scope` by its start and end timestamps, hence `scope` can also
+  // be of any other type with the same "start()" and "end()" methods as the ScopeT in the tree.
+  template <typename OtherScopeT>
+  [[nodiscard]] const ScopeT* FindNextScopeAtDepth(const OtherScopeT& scope) const;
+  template <typename OtherScopeT>
+  [[nodiscard]] const ScopeT* FindPreviousScopeAtDepth(const OtherScopeT& scope) const;
+  template <typename OtherScopeT>
+  [[nodiscard]] const ScopeT* FindParent(const OtherScopeT& scope) const;
+  template <typename OtherScopeT>
+  [[nodiscard]] const ScopeT* FindFirstChild(const OtherScopeT& scope) const;
 
  private:
-  [[nodiscard]] const ScopeNodeT* FindScopeNode(const ScopeT& scope) const;
+  template <typename OtherScopeT>
+  [[nodiscard]] const ScopeNodeT* FindScopeNode(const OtherScopeT& scope) const;
   [[nodiscard]] ScopeNodeT* CreateNode(ScopeT* scope);
   void UpdateDepthInSubtree(ScopeNodeT* node, uint32_t depth);
   [[nodiscard]] const absl::btree_map<uint32_t /*depth*/,
@@ -121,7 +128,8 @@ ScopeNode<ScopeT>* ScopeTree<ScopeT>::CreateNode(ScopeT* scope) {
 }
 
 template <typename ScopeT>
-const ScopeNode<ScopeT>* ScopeTree<ScopeT>::FindScopeNode(const ScopeT& scope) const {
+template <typename OtherScopeT>
+const ScopeNode<ScopeT>* ScopeTree<ScopeT>::FindScopeNode(const OtherScopeT& scope) const {
   for (ScopeNode<ScopeT>* node = root_; node != nullptr;
        node = node->GetLastChildBeforeOrAtTime(scope.start())) {
     if (node->Start() == scope.start() && node->End() == scope.end()) {
@@ -132,7 +140,8 @@ const ScopeNode<ScopeT>* ScopeTree<ScopeT>::FindScopeNode(const ScopeT& scope) c
 }
 
 template <typename ScopeT>
-const ScopeT* ScopeTree<ScopeT>::FindParent(const ScopeT& scope) const {
+template <typename OtherScopeT>
+const ScopeT* ScopeTree<ScopeT>::FindParent(const OtherScopeT& scope) const {
   const ScopeNode<ScopeT>* node = FindScopeNode(scope);
   ORBIT_CHECK(node != nullptr);
   if (node->Parent() == root_) return nullptr;
@@ -140,7 +149,8 @@ const ScopeT* ScopeTree<ScopeT>::FindParent(const ScopeT& scope) const {
 }
 
 template <typename ScopeT>
-const ScopeT* ScopeTree<ScopeT>::FindFirstChild(const ScopeT& scope) const {
+template <typename OtherScopeT>
+const ScopeT* ScopeTree<ScopeT>::FindFirstChild(const OtherScopeT& scope) const {
   const ScopeNode<ScopeT>* node = FindScopeNode(scope);
   ORBIT_CHECK(node != nullptr);
   const auto children = node->GetChildrenByStartTime();
@@ -186,7 +196,8 @@ const ScopeT* ScopeTree<ScopeT>::FindFirstScopeAtOrAfterTime(uint32_t depth, uin
 }
 
 template <typename ScopeT>
-const ScopeT* ScopeTree<ScopeT>::FindNextScopeAtDepth(const ScopeT& scope) const {
+template <typename OtherScopeT>
+const ScopeT* ScopeTree<ScopeT>::FindNextScopeAtDepth(const OtherScopeT& scope) const {
   const ScopeNode<ScopeT>* node = FindScopeNode(scope);
   ORBIT_CHECK(node != nullptr);
   auto nodes_at_depth = GetOrderedNodesByDepth().at(node->Depth());
@@ -196,7 +207,8 @@ const ScopeT* ScopeTree<ScopeT>::FindNextScopeAtDepth(const ScopeT& scope) const
 }
 
 template <typename ScopeT>
-const ScopeT* ScopeTree<ScopeT>::FindPreviousScopeAtDepth(const ScopeT& scope) const {
+template <typename OtherScopeT>
+const ScopeT* ScopeTree<ScopeT>::FindPreviousScopeAtDepth(const OtherScopeT& scope) const {
   const ScopeNode<ScopeT>* node = FindScopeNode(scope);
   ORBIT_CHECK(node != nullptr);
   auto nodes_at_depth = GetOrderedNodesByDepth().at(node->Depth());
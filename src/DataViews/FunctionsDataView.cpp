@@ -23,9 +23,10 @@
 #include "DataViews/AppInterface.h"
 #include "DataViews/CompareAscendingOrDescending.h"
 #include "DataViews/DataViewType.h"
-#include "OrbitBase/Chunk.h"
 #include "OrbitBase/Logging.h"
-#include "OrbitBase/TaskGroup.h"
+#include "OrbitBase/ParallelFor.h"
+#include "OrbitBase/Sort.h"
+#include "OrbitBase/ThreadPool.h"
 
 using orbit_client_data::CaptureData;
 using orbit_client_data::FunctionInfo;
@@ -160,8 +161,14 @@ void FunctionsDataView::DoSort() {
       break;
   }
 
-  if (sorter) {
+  if (!sorter) return;
+
+  // Whether a function is selected can only be queried on the main thread.
+  if (sorting_column_ == kColumnSelected) {
     std::stable_sort(indices_.begin(), indices_.end(), sorter);
+  } else {
+    orbit_base::ParallelStableSort(orbit_base::ThreadPool::GetDefaultThreadPool(), indices_.begin(),
+                                   indices_.end(), sorter);
   }
 }
 
@@ -208,16 +215,10 @@ void FunctionsDataView::DoFilter() {
   ORBIT_SCOPE(absl::StrFormat("FunctionsDataView::DoFilter [%u]", functions_.size()).c_str());
   filter_tokens_ = absl::StrSplit(absl::AsciiStrToLower(filter_), ' ');
 
-  constexpr size_t kNumFunctionsPerTask = 1024;
-  std::vector<absl::Span<const FunctionInfo*>> chunks =
-      orbit_base::CreateChunksOfSize(functions_, kNumFunctionsPerTask);
-  std::vector<std::vector<uint64_t>> task_results(chunks.size());
-  orbit_base::TaskGroup task_group;
-
-  for (size_t i = 0; i < chunks.size(); ++i) {
-    task_group.AddTask([&chunk = chunks[i], &result = task_results[i], this]() {
-      ORBIT_SCOPE("FunctionsDataView::DoFilter Task");
-      for (const FunctionInfo*& function : chunk) {
+  std::vector<uint8_t> is_function_visible(functions_.size());
+  (void)orbit_base::ParallelFor(
+      orbit_base::ThreadPool::GetDefaultThreadPool(), functions_.size(), [&](size_t index) {
+        const FunctionInfo* function = functions_[index];
         ORBIT_CHECK(function != nullptr);
         std::string name = absl::AsciiStrToLower(function->pretty_name());
         std::string module = absl::AsciiStrToLower(
@@ -227,19 +228,13 @@ void FunctionsDataView::DoFilter() {
           return name.find(token) != std::string::npos || module.find(token) != std::string::npos;
         };
 
-        if (std::all_of(filter_tokens_.begin(), filter_tokens_.end(), is_token_found)) {
-          size_t function_index = &function - functions_.data();
-          ORBIT_CHECK(function_index < functions_.size());
-          result.push_back(function_index);
-        }
-      }
-    });
-  }
+        is_function_visible[index] =
+            std::all_of(filter_tokens_.begin(), filter_tokens_.end(), is_token_found);
+      });
 
-  task_group.Wait();
   indices_.clear();
-  for (std::vector<uint64_t>& result : task_results) {
-    indices_.insert(indices_.end(), result.begin(), result.end());
+  for (size_t index = 0; index < functions_.size(); ++index) {
+    if (is_function_visible[index] != 0) indices_.push_back(index);
   }
 }
 
@@ -40,7 +40,9 @@
 #include "OrbitBase/File.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/Sort.h"
 #include "OrbitBase/ThreadConstants.h"
+#include "OrbitBase/ThreadPool.h"
 #include "Statistics/BinomialConfidenceInterval.h"
 #include "Statistics/StatisticsUtils.h"
 
@@ -197,7 +199,15 @@ void SamplingReportDataView::DoSort() {
     return fallback_sorter(ind_left, ind_right);
   };
 
-  std::sort(indices_.begin(), indices_.end(), combined_sorter);
+  // Whether a function is selected can only be queried on the main thread. Otherwise the indices
+  // are sorted in parallel. As `combined_sorter` is a total order, a stable sort gives the same
+  // result as std::sort.
+  if (sorting_column_ == kColumnSelected) {
+    std::sort(indices_.begin(), indices_.end(), combined_sorter);
+  } else {
+    orbit_base::ParallelStableSort(orbit_base::ThreadPool::GetDefaultThreadPool(), indices_.begin(),
+                                   indices_.end(), combined_sorter);
+  }
 }
 
 const FunctionInfo* SamplingReportDataView::GetFunctionInfoFromRow(int row) {
@@ -377,6 +377,14 @@ int main(int argc, char* argv[]) {
     options.memory_sampling_period_ms = 1'000 / absl::GetFlag(FLAGS_memory_sampling_rate);
     ORBIT_LOG("memory_sampling_period_ms=%u", options.memory_sampling_period_ms);
   }
+  options.ring_buffer_reader_thread_count = absl::GetFlag(FLAGS_ring_buffer_readers);
+  ORBIT_LOG("ring_buffer_reader_thread_count=%u", options.ring_buffer_reader_thread_count);
+  options.ring_buffer_wait_method = absl::GetFlag(FLAGS_ring_buffer_epoll)
+                                        ? CaptureOptions::kEpoll
+                                        : CaptureOptions::kSleep;
+  ORBIT_LOG("ring_buffer_wait_method=%d", options.ring_buffer_wait_method);
+  options.unwinding_thread_count = absl::GetFlag(FLAGS_unwinding_threads);
+  ORBIT_LOG("unwinding_thread_count=%u", options.unwinding_thread_count);
 
   uint32_t grpc_port = absl::GetFlag(FLAGS_port);
   std::string service_address = absl::StrFormat("127.0.0.1:%d", grpc_port);
@@ -55,6 +55,12 @@ ABSL_FLAG(bool, gpu_jobs, true, "Collect GPU jobs");
 ABSL_FLAG(bool, orbit_api, false, "Enable Orbit API");
 ABSL_FLAG(uint16_t, memory_sampling_rate, 0,
           "Memory usage sampling rate in samples per second (0: no sampling)");
+ABSL_FLAG(uint32_t, ring_buffer_readers, 0,
+          "Number of threads reading perf_event_open ring buffers in OrbitService (0: one)");
+ABSL_FLAG(bool, ring_buffer_epoll, false,
+          "Wait for data in perf_event_open ring buffers with epoll instead of sleeping");
+ABSL_FLAG(uint32_t, unwinding_threads, 0,
+          "Number of threads unwinding stack samples in OrbitService (0: no dedicated threads)");
 ABSL_FLAG(bool, frame_time, true, "Instrument vkQueuePresentKHR to compute avg. frame time");
 ABSL_FLAG(EventProcessorType, event_processor, EventProcessorType::kFake, "");
 ABSL_FLAG(std::string, pid_file_path, "",
@@ -67,6 +67,11 @@ inline int32_t RetrieveThreadId(const orbit_api::ApiTrackUint64& /*track_uint64*
   ORBIT_UNREACHABLE();
 }
 
+// Introspection never interns names.
+inline int32_t RetrieveThreadId(const orbit_api::ApiInternedString& /*interned_string*/) {
+  ORBIT_UNREACHABLE();
+}
+
 // The variant type `ApiEventVariant` requires to contain `std::monostate` in order to be default-
 // constructable. However, that state is never expected to be called in the visitor.
 inline int32_t RetrieveThreadId(const std::monostate& /*unused*/) { ORBIT_UNREACHABLE(); }
@@ -52,6 +52,7 @@ using orbit_grpc_protos::CaptureResponse;
 using orbit_grpc_protos::ProducerCaptureEvent;
 
 using orbit_producer_event_processor::ClientCaptureEventCollector;
+using orbit_producer_event_processor::ProducerCaptureEventBatch;
 using orbit_producer_event_processor::ProducerEventProcessor;
 
 using orbit_capture_service_base::CaptureServiceBase;
@@ -156,6 +157,11 @@ class ProducerEventProcessorHijackingFunctionEntryExitForLinuxTracing
     }
   }
 
+  void ProcessEvents(uint64_t producer_id, ProducerCaptureEventBatch&& batch) override {
+    // Batches only come from TracingHandler, hence never contain FunctionEntry and FunctionExit.
+    producer_event_processor_->ProcessEvents(producer_id, std::move(batch));
+  }
+
  private:
   ProducerEventProcessor* producer_event_processor_;
   TracingHandler* tracing_handler_;
@@ -361,9 +367,12 @@ void LinuxCaptureServiceBase::DoCapture(
       FilterOutInstrumentedFunctionsFromCaptureOptions(
           result_or_error.value().instrumented_function_ids, linux_tracing_capture_options);
 
-      ORBIT_LOG("User space instrumentation enabled for %u out of %u instrumented functions.",
-                result_or_error.value().instrumented_function_ids.size(),
-                capture_options.instrumented_functions_size());
+      ORBIT_LOG(
+          "User space instrumentation enabled for %u out of %u instrumented functions. The target "
+          "process was stopped for %s.",
+          result_or_error.value().instrumented_function_ids.size(),
+          capture_options.instrumented_functions_size(),
+          absl::FormatDuration(result_or_error.value().stop_the_world_duration));
 
       if (!result_or_error.value().function_ids_to_error_messages.empty()) {
         info_from_enabling_user_space_instrumentation =
@@ -4,11 +4,15 @@
 
 #include "TracingHandler.h"
 
+#include <absl/time/time.h>
+
+#include <atomic>
 #include <utility>
 
 #include "GrpcProtos/Constants.h"
 #include "LinuxTracing/UserSpaceInstrumentationAddresses.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
 #include "UserSpaceInstrumentationAddressesImpl.h"
 
 namespace orbit_linux_capture_service {
@@ -26,11 +30,34 @@ using orbit_grpc_protos::ThreadStateSliceCallstack;
 
 using orbit_grpc_protos::kLinuxTracingProducerId;
 
+using orbit_producer_event_processor::ProducerCaptureEventBatch;
+
+namespace {
+// Large batches keep the events in memory for longer and delay the next ones.
+constexpr size_t kSendEventCountInterval = 5000;
+
+std::atomic<uint64_t> next_tracing_handler_id{1};
+}  // namespace
+
+TracingHandler::TracingHandler(
+    orbit_producer_event_processor::ProducerEventProcessor* producer_event_processor)
+    : producer_event_processor_{producer_event_processor},
+      id_{next_tracing_handler_id.fetch_add(1, std::memory_order_relaxed)} {}
+
+TracingHandler::~TracingHandler() {
+  // Stop was not called, e.g., because the capture was aborted after Start. Stop the Tracer, which
+  // still calls this listener, and then the sender thread, which is not allowed to outlive us.
+  if (sender_thread_.joinable()) {
+    Stop();
+  }
+}
+
 void TracingHandler::Start(
     const CaptureOptions& capture_options,
     std::unique_ptr<UserSpaceInstrumentationAddressesImpl> user_space_instrumentation_addresses) {
   ORBIT_CHECK(tracer_ == nullptr);
 
+  sender_thread_ = std::thread{[this] { SenderThread(); }};
   tracer_ = orbit_linux_tracing::Tracer::Create(
       capture_options, std::move(user_space_instrumentation_addresses), this);
   tracer_->Start();
@@ -39,114 +66,210 @@ void TracingHandler::Start(
 void TracingHandler::Stop() {
   ORBIT_CHECK(tracer_ != nullptr);
   tracer_->Stop();
+
+  // The Tracer doesn't produce events after Stop, so that the last iteration of SenderThread
+  // processes all the remaining ones, before the caller continues with CaptureFinished.
+  {
+    absl::MutexLock lock{&thread_batches_mutex_};
+    stop_requested_ = true;
+  }
+  ORBIT_CHECK(sender_thread_.joinable());
+  sender_thread_.join();
+
   // tracer_ is not reset as FunctionEntry and FunctionExit events could still arrive afterwards. In
   // that case the Tracer will simply not process them.
   // Leaving the reset to the destructor means that an object of this class cannot be reused by
   // calling Start again.
 }
 
+TracingHandler::ThreadBatch* TracingHandler::GetThreadBatch() {
+  // Ids are never reused, so a cached batch of a destroyed instance is never returned.
+  thread_local uint64_t cached_tracing_handler_id = 0;
+  thread_local ThreadBatch* cached_thread_batch = nullptr;
+  if (cached_tracing_handler_id == id_) return cached_thread_batch;
+
+  absl::MutexLock lock{&thread_batches_mutex_};
+  cached_thread_batch = thread_batches_.emplace_back(std::make_unique<ThreadBatch>()).get();
+  cached_tracing_handler_id = id_;
+  return cached_thread_batch;
+}
+
+void TracingHandler::AddEvent(absl::FunctionRef<bool(ProducerCaptureEvent*)> fill_event) {
+  ThreadBatch* thread_batch = GetThreadBatch();
+  bool batch_is_full = false;
+  {
+    absl::MutexLock lock{&thread_batch->mutex};
+    if (!fill_event(thread_batch->batch.AddEvent())) {
+      thread_batch->batch.DiscardLastEvent();
+      return;
+    }
+    batch_is_full = thread_batch->batch.size() == kSendEventCountInterval;
+  }
+
+  if (batch_is_full) {
+    absl::MutexLock lock{&thread_batches_mutex_};
+    ++full_thread_batch_count_;
+  }
+}
+
+void TracingHandler::SenderThread() {
+  orbit_base::SetCurrentThreadName("TracingHandler");
+  // Events are passed on at least this often, so that the capture still looks live on the client.
+  constexpr absl::Duration kSendTimeInterval = absl::Milliseconds(10);
+
+  bool stopped = false;
+  while (!stopped) {
+    std::vector<ProducerCaptureEventBatch> batches;
+    thread_batches_mutex_.LockWhenWithTimeout(
+        absl::Condition(
+            +[](TracingHandler* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->thread_batches_mutex_) {
+              return self->full_thread_batch_count_ > 0 || self->stop_requested_;
+            },
+            this),
+        kSendTimeInterval);
+    stopped = stop_requested_;
+    full_thread_batch_count_ = 0;
+    for (const std::unique_ptr<ThreadBatch>& thread_batch : thread_batches_) {
+      absl::MutexLock lock{&thread_batch->mutex};
+      if (thread_batch->batch.empty()) continue;
+      std::swap(batches.emplace_back(), thread_batch->batch);
+    }
+    thread_batches_mutex_.Unlock();
+
+    for (ProducerCaptureEventBatch& batch : batches) {
+      ORBIT_SCOPE("TracingHandler::SenderThread ProcessEvents");
+      ORBIT_UINT64("Size of batch of perf_event_open events", batch.size());
+      producer_event_processor_->ProcessEvents(kLinuxTracingProducerId, std::move(batch));
+    }
+  }
+}
+
 void TracingHandler::OnSchedulingSlice(SchedulingSlice scheduling_slice) {
-  ProducerCaptureEvent event;
-  *event.mutable_scheduling_slice() = std::move(scheduling_slice);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_scheduling_slice() = std::move(scheduling_slice);
+    return true;
+  });
 }
 
 void TracingHandler::OnThreadStateSliceCallstack(ThreadStateSliceCallstack callstack) {
-  ProducerCaptureEvent event;
-  *event.mutable_thread_state_slice_callstack() = std::move(callstack);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_thread_state_slice_callstack() = std::move(callstack);
+    return true;
+  });
 }
 
 void TracingHandler::OnCallstackSample(FullCallstackSample callstack_sample) {
-  ProducerCaptureEvent event;
-  *event.mutable_full_callstack_sample() = std::move(callstack_sample);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_full_callstack_sample() = std::move(callstack_sample);
+    return true;
+  });
+}
+
+void TracingHandler::OnCallstackSampleInPlace(
+    absl::FunctionRef<bool(FullCallstackSample*)> fill_callstack_sample) {
+  AddEvent([&](ProducerCaptureEvent* event) {
+    return fill_callstack_sample(event->mutable_full_callstack_sample());
+  });
 }
 
 void TracingHandler::OnFunctionCall(FunctionCall function_call) {
-  ProducerCaptureEvent event;
-  *event.mutable_function_call() = std::move(function_call);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_function_call() = std::move(function_call);
+    return true;
+  });
 }
 
 void TracingHandler::OnGpuJob(FullGpuJob full_gpu_job) {
-  ProducerCaptureEvent event;
-  *event.mutable_full_gpu_job() = std::move(full_gpu_job);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_full_gpu_job() = std::move(full_gpu_job);
+    return true;
+  });
 }
 
 void TracingHandler::OnThreadName(ThreadName thread_name) {
-  ProducerCaptureEvent event;
-  *event.mutable_thread_name() = std::move(thread_name);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_thread_name() = std::move(thread_name);
+    return true;
+  });
 }
 
 void TracingHandler::OnThreadNamesSnapshot(
     orbit_grpc_protos::ThreadNamesSnapshot thread_names_snapshot) {
-  ProducerCaptureEvent event;
-  *event.mutable_thread_names_snapshot() = std::move(thread_names_snapshot);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_thread_names_snapshot() = std::move(thread_names_snapshot);
+    return true;
+  });
 }
 
 void TracingHandler::OnThreadStateSlice(ThreadStateSlice thread_state_slice) {
-  ProducerCaptureEvent event;
-  *event.mutable_thread_state_slice() = std::move(thread_state_slice);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_thread_state_slice() = std::move(thread_state_slice);
+    return true;
+  });
 }
 
 void TracingHandler::OnAddressInfo(FullAddressInfo full_address_info) {
-  ProducerCaptureEvent event;
-  *event.mutable_full_address_info() = std::move(full_address_info);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_full_address_info() = std::move(full_address_info);
+    return true;
+  });
 }
 
 void TracingHandler::OnTracepointEvent(orbit_grpc_protos::FullTracepointEvent tracepoint_event) {
-  ProducerCaptureEvent event;
-  *event.mutable_full_tracepoint_event() = std::move(tracepoint_event);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_full_tracepoint_event() = std::move(tracepoint_event);
+    return true;
+  });
 }
 
 void TracingHandler::OnModuleUpdate(orbit_grpc_protos::ModuleUpdateEvent module_update_event) {
-  ProducerCaptureEvent event;
-  *event.mutable_module_update_event() = std::move(module_update_event);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_module_update_event() = std::move(module_update_event);
+    return true;
+  });
 }
 
 void TracingHandler::OnModulesSnapshot(orbit_grpc_protos::ModulesSnapshot modules_snapshot) {
-  ProducerCaptureEvent event;
-  *event.mutable_modules_snapshot() = std::move(modules_snapshot);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_modules_snapshot() = std::move(modules_snapshot);
+    return true;
+  });
 }
 
 void TracingHandler::OnErrorsWithPerfEventOpenEvent(
     orbit_grpc_protos::ErrorsWithPerfEventOpenEvent errors_with_perf_event_open_event) {
-  ProducerCaptureEvent event;
-  *event.mutable_errors_with_perf_event_open_event() = std::move(errors_with_perf_event_open_event);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_errors_with_perf_event_open_event() =
+        std::move(errors_with_perf_event_open_event);
+    return true;
+  });
 }
 
 void TracingHandler::OnLostPerfRecordsEvent(
     orbit_grpc_protos::LostPerfRecordsEvent lost_perf_records_event) {
-  orbit_grpc_protos::ProducerCaptureEvent event;
-  *event.mutable_lost_perf_records_event() = std::move(lost_perf_records_event);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_lost_perf_records_event() = std::move(lost_perf_records_event);
+    return true;
+  });
 }
 
 void TracingHandler::OnOutOfOrderEventsDiscardedEvent(
     orbit_grpc_protos::OutOfOrderEventsDiscardedEvent out_of_order_events_discarded_event) {
-  orbit_grpc_protos::ProducerCaptureEvent event;
-  *event.mutable_out_of_order_events_discarded_event() =
-      std::move(out_of_order_events_discarded_event);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_out_of_order_events_discarded_event() =
+        std::move(out_of_order_events_discarded_event);
+    return true;
+  });
 }
 
 void TracingHandler::OnWarningInstrumentingWithUprobesEvent(
     orbit_grpc_protos::WarningInstrumentingWithUprobesEvent
         warning_instrumenting_with_uprobes_event) {
-  orbit_grpc_protos::ProducerCaptureEvent event;
-  *event.mutable_warning_instrumenting_with_uprobes_event() =
-      std::move(warning_instrumenting_with_uprobes_event);
-  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+  AddEvent([&](ProducerCaptureEvent* event) {
+    *event->mutable_warning_instrumenting_with_uprobes_event() =
+        std::move(warning_instrumenting_with_uprobes_event);
+    return true;
+  });
 }
 
 }  // namespace orbit_linux_capture_service
@@ -7,10 +7,14 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
+#include <absl/functional/function_ref.h>
+#include <absl/synchronization/mutex.h>
 #include <stdint.h>
 
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "GrpcProtos/capture.pb.h"
 #include "GrpcProtos/tracepoint.pb.h"
@@ -18,6 +22,7 @@
 #include "LinuxTracing/Tracer.h"
 #include "LinuxTracing/TracerListener.h"
 #include "OrbitBase/Logging.h"
+#include "ProducerEventProcessor/CaptureEventBatch.h"
 #include "ProducerEventProcessor/ProducerEventProcessor.h"
 #include "UserSpaceInstrumentationAddressesImpl.h"
 
@@ -25,15 +30,21 @@ namespace orbit_linux_capture_service {
 
 // Wrapper around LinuxTracing and its orbit_linux_tracing::Tracer that forwards the received events
 // to the ProducerEventProcessor.
+// Each thread that calls this listener adds the events to its own ProducerCaptureEventBatch, and a
+// separate thread periodically passes the batches to the ProducerEventProcessor. This way the
+// tracing threads don't wait for the events to be processed, and they only share a lock with the
+// sender thread. Events from the same thread keep their order.
+// Callstack samples, the most frequent events, are created directly on the Arena of the batch by
+// OnCallstackSampleInPlace. The other messages received from the Tracer are on the heap, so they
+// are copied into the Arena rather than moved.
 // An instance of this class should not be reused for multiple captures, i.e., Start and Stop should
 // only be called once.
 class TracingHandler : public orbit_linux_tracing::TracerListener {
  public:
   explicit TracingHandler(
-      orbit_producer_event_processor::ProducerEventProcessor* producer_event_processor)
-      : producer_event_processor_{producer_event_processor} {}
+      orbit_producer_event_processor::ProducerEventProcessor* producer_event_processor);
 
-  ~TracingHandler() override = default;
+  ~TracingHandler() override;
   TracingHandler(const TracingHandler&) = delete;
   TracingHandler& operator=(const TracingHandler&) = delete;
   TracingHandler(TracingHandler&&) = delete;
@@ -42,10 +53,15 @@ class TracingHandler : public orbit_linux_tracing::TracerListener {
   void Start(
       const orbit_grpc_protos::CaptureOptions& capture_options,
       std::unique_ptr<UserSpaceInstrumentationAddressesImpl> user_space_instrumentation_addresses);
+  // Blocks until all the events produced by the Tracer have been passed to the
+  // ProducerEventProcessor.
   void Stop();
 
   void OnSchedulingSlice(orbit_grpc_protos::SchedulingSlice scheduling_slice) override;
   void OnCallstackSample(orbit_grpc_protos::FullCallstackSample callstack_sample) override;
+  void OnCallstackSampleInPlace(
+      absl::FunctionRef<bool(orbit_grpc_protos::FullCallstackSample*)> fill_callstack_sample)
+      override;
   void OnThreadStateSliceCallstack(orbit_grpc_protos::ThreadStateSliceCallstack callstack) override;
   void OnFunctionCall(orbit_grpc_protos::FunctionCall function_call) override;
   void OnGpuJob(orbit_grpc_protos::FullGpuJob gpu_job) override;
@@ -74,8 +90,30 @@ class TracingHandler : public orbit_linux_tracing::TracerListener {
   }
 
  private:
+  struct ThreadBatch {
+    absl::Mutex mutex;
+    orbit_producer_event_processor::ProducerCaptureEventBatch batch ABSL_GUARDED_BY(mutex);
+  };
+
+  // Returns the batch of the calling thread, creating it on the first call from that thread.
+  [[nodiscard]] ThreadBatch* GetThreadBatch();
+  // `fill_event` fills in a new event at the end of the batch of the calling thread. If it returns
+  // false, the event is discarded.
+  void AddEvent(absl::FunctionRef<bool(orbit_grpc_protos::ProducerCaptureEvent*)> fill_event);
+  void SenderThread();
+
   orbit_producer_event_processor::ProducerEventProcessor* producer_event_processor_;
   std::unique_ptr<orbit_linux_tracing::Tracer> tracer_;
+
+  // Identifies this instance in the thread-local cache used by GetThreadBatch.
+  const uint64_t id_;
+
+  absl::Mutex thread_batches_mutex_;
+  std::vector<std::unique_ptr<ThreadBatch>> thread_batches_ ABSL_GUARDED_BY(thread_batches_mutex_);
+  // The number of batches that reached the size at which the sender thread is woken up.
+  size_t full_thread_batch_count_ ABSL_GUARDED_BY(thread_batches_mutex_) = 0;
+  bool stop_requested_ ABSL_GUARDED_BY(thread_batches_mutex_) = false;
+  std::thread sender_thread_;
 };
 
 }  // namespace orbit_linux_capture_service
@@ -0,0 +1,78 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "LibunwindstackElfCache.h"
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_linux_tracing {
+
+LibunwindstackElfCache& LibunwindstackElfCache::GetInstance() {
+  // Intentionally leaked, like the unwindstack::Elf objects that MapInfos might still reference.
+  static auto* instance = new LibunwindstackElfCache();
+  return *instance;
+}
+
+std::shared_ptr<unwindstack::Object> LibunwindstackElfCache::Find(const std::string& path,
+                                                                  const std::string& build_id) {
+  if (build_id.empty()) return nullptr;
+
+  absl::MutexLock lock{&mutex_};
+  auto it = entries_by_key_.find(Key{path, build_id});
+  if (it == entries_by_key_.end()) {
+    ++miss_count_;
+    return nullptr;
+  }
+  ++hit_count_;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->elf;
+}
+
+void LibunwindstackElfCache::Add(const std::string& path, const std::string& build_id,
+                                 uint64_t file_size, std::shared_ptr<unwindstack::Object> elf) {
+  ORBIT_CHECK(elf != nullptr);
+  if (build_id.empty() || file_size > max_size_bytes_) return;
+
+  absl::MutexLock lock{&mutex_};
+  Key key{path, build_id};
+  if (auto it = entries_by_key_.find(key); it != entries_by_key_.end()) {
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return;
+  }
+
+  EvictUntilFits(file_size);
+  entries_.push_front(Entry{key, file_size, std::move(elf)});
+  entries_by_key_.emplace(std::move(key), entries_.begin());
+  size_bytes_ += file_size;
+}
+
+void LibunwindstackElfCache::EvictUntilFits(uint64_t size_bytes) {
+  while (!entries_.empty() && size_bytes_ + size_bytes > max_size_bytes_) {
+    const Entry& least_recently_used = entries_.back();
+    size_bytes_ -= least_recently_used.size_bytes;
+    entries_by_key_.erase(least_recently_used.key);
+    entries_.pop_back();
+    ++eviction_count_;
+  }
+}
+
+void LibunwindstackElfCache::Clear() {
+  absl::MutexLock lock{&mutex_};
+  entries_by_key_.clear();
+  entries_.clear();
+  size_bytes_ = 0;
+}
+
+LibunwindstackElfCache::Stats LibunwindstackElfCache::GetStats() const {
+  absl::MutexLock lock{&mutex_};
+  return Stats{
+      .entry_count = entries_.size(),
+      .size_bytes = size_bytes_,
+      .hit_count = hit_count_,
+      .miss_count = miss_count_,
+      .eviction_count = eviction_count_,
+  };
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,81 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_LIBUNWINDSTACK_ELF_CACHE_H_
+#define LINUX_TRACING_LIBUNWINDSTACK_ELF_CACHE_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <unwindstack/Object.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace orbit_linux_tracing {
+
+// Keeps the unwindstack::Elf objects created while unwinding during a capture, so that the next
+// captures can reuse them instead of opening the files and building the unwinding information
+// (.eh_frame, .debug_frame, ...) again, which is expensive for large binaries.
+// Entries are identified by file path and build id, so that a file rebuilt at the same path is not
+// mistaken for the one cached. Files without build id are not cached. The size of an entry is the
+// size of its file, which the Elf keeps mapped. When the total exceeds the maximum size, the least
+// recently used entries are evicted.
+// OrbitService uses the single instance returned by GetInstance, so that the cache outlives the
+// individual captures.
+class LibunwindstackElfCache {
+ public:
+  static constexpr uint64_t kDefaultMaxSizeBytes = 4ULL * 1024 * 1024 * 1024;
+
+  explicit LibunwindstackElfCache(uint64_t max_size_bytes = kDefaultMaxSizeBytes)
+      : max_size_bytes_{max_size_bytes} {}
+
+  [[nodiscard]] static LibunwindstackElfCache& GetInstance();
+
+  // Returns the cached Elf of the file at `path` with `build_id`, or nullptr.
+  [[nodiscard]] std::shared_ptr<unwindstack::Object> Find(const std::string& path,
+                                                          const std::string& build_id);
+  // Adds `elf`, which must have been created from the whole file at `path`. If the file is already
+  // cached, the existing entry is only marked as the most recently used.
+  void Add(const std::string& path, const std::string& build_id, uint64_t file_size,
+           std::shared_ptr<unwindstack::Object> elf);
+  void Clear();
+
+  struct Stats {
+    uint64_t entry_count = 0;
+    uint64_t size_bytes = 0;
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    uint64_t eviction_count = 0;
+  };
+  [[nodiscard]] Stats GetStats() const;
+
+ private:
+  using Key = std::pair<std::string, std::string>;
+  struct Entry {
+    Key key;
+    uint64_t size_bytes;
+    std::shared_ptr<unwindstack::Object> elf;
+  };
+
+  void EvictUntilFits(uint64_t size_bytes) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const uint64_t max_size_bytes_;
+
+  mutable absl::Mutex mutex_;
+  // Ordered from the most to the least recently used.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<Key, std::list<Entry>::iterator> entries_by_key_ ABSL_GUARDED_BY(mutex_);
+  uint64_t size_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint64_t hit_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint64_t miss_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint64_t eviction_count_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_LIBUNWINDSTACK_ELF_CACHE_H_
@@ -0,0 +1,164 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <unwindstack/Arch.h>
+#include <unwindstack/Elf.h>
+#include <unwindstack/MapInfo.h>
+#include <unwindstack/Memory.h>
+#include <unwindstack/Object.h>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "LibunwindstackElfCache.h"
+#include "LibunwindstackMaps.h"
+#include "Test/Path.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+[[nodiscard]] std::shared_ptr<unwindstack::Object> CreateUninitializedElf() {
+  return std::make_shared<unwindstack::Elf>(nullptr);
+}
+
+[[nodiscard]] std::string GetTargetFpPath() {
+  return (orbit_test::GetTestdataDir() / "target_fp").string();
+}
+
+[[nodiscard]] std::string GetTargetFpMaps() {
+  return absl::StrFormat(
+      "000000000000-000000001000 r--p 00000000 fe:00 123 %1$s\n"
+      "000000001000-000000003000 r-xp 00001000 fe:00 123 %1$s\n"
+      "000000003000-000000004000 r--p 00003000 fe:00 123 %1$s\n",
+      GetTargetFpPath());
+}
+
+constexpr uint64_t kAddressInTargetFpCode = 0x1500;
+
+}  // namespace
+
+TEST(LibunwindstackElfCache, FindReturnsAddedElf) {
+  LibunwindstackElfCache cache;
+  std::shared_ptr<unwindstack::Object> elf = CreateUninitializedElf();
+  cache.Add("/path/to/file", "build_id", 100, elf);
+
+  EXPECT_EQ(cache.Find("/path/to/file", "build_id"), elf);
+  EXPECT_EQ(cache.Find("/path/to/file", "other_build_id"), nullptr);
+  EXPECT_EQ(cache.Find("/path/to/other_file", "build_id"), nullptr);
+
+  LibunwindstackElfCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.entry_count, 1);
+  EXPECT_EQ(stats.size_bytes, 100);
+  EXPECT_EQ(stats.hit_count, 1);
+  EXPECT_EQ(stats.miss_count, 2);
+  EXPECT_EQ(stats.eviction_count, 0);
+}
+
+TEST(LibunwindstackElfCache, FilesWithoutBuildIdAreNotCached) {
+  LibunwindstackElfCache cache;
+  cache.Add("/path/to/file", "", 100, CreateUninitializedElf());
+  EXPECT_EQ(cache.Find("/path/to/file", ""), nullptr);
+
+  LibunwindstackElfCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.entry_count, 0);
+  EXPECT_EQ(stats.miss_count, 0);
+}
+
+TEST(LibunwindstackElfCache, AddingCachedFileKeepsExistingElf) {
+  LibunwindstackElfCache cache;
+  std::shared_ptr<unwindstack::Object> elf = CreateUninitializedElf();
+  cache.Add("/path/to/file", "build_id", 100, elf);
+  cache.Add("/path/to/file", "build_id", 100, CreateUninitializedElf());
+
+  EXPECT_EQ(cache.Find("/path/to/file", "build_id"), elf);
+  EXPECT_EQ(cache.GetStats().entry_count, 1);
+  EXPECT_EQ(cache.GetStats().size_bytes, 100);
+}
+
+TEST(LibunwindstackElfCache, LeastRecentlyUsedElfIsEvictedWhenFull) {
+  LibunwindstackElfCache cache{100};
+  cache.Add("/path/to/a", "a", 40, CreateUninitializedElf());
+  cache.Add("/path/to/b", "b", 40, CreateUninitializedElf());
+  EXPECT_NE(cache.Find("/path/to/a", "a"), nullptr);
+  cache.Add("/path/to/c", "c", 40, CreateUninitializedElf());
+
+  EXPECT_NE(cache.Find("/path/to/a", "a"), nullptr);
+  EXPECT_EQ(cache.Find("/path/to/b", "b"), nullptr);
+  EXPECT_NE(cache.Find("/path/to/c", "c"), nullptr);
+
+  LibunwindstackElfCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.entry_count, 2);
+  EXPECT_EQ(stats.size_bytes, 80);
+  EXPECT_EQ(stats.eviction_count, 1);
+}
+
+TEST(LibunwindstackElfCache, FilesLargerThanMaxSizeAreNotCached) {
+  LibunwindstackElfCache cache{100};
+  cache.Add("/path/to/a", "a", 40, CreateUninitializedElf());
+  cache.Add("/path/to/b", "b", 101, CreateUninitializedElf());
+
+  EXPECT_NE(cache.Find("/path/to/a", "a"), nullptr);
+  EXPECT_EQ(cache.Find("/path/to/b", "b"), nullptr);
+  EXPECT_EQ(cache.GetStats().eviction_count, 0);
+}
+
+TEST(LibunwindstackElfCache, Clear) {
+  LibunwindstackElfCache cache;
+  cache.Add("/path/to/file", "build_id", 100, CreateUninitializedElf());
+  cache.Clear();
+
+  EXPECT_EQ(cache.Find("/path/to/file", "build_id"), nullptr);
+  LibunwindstackElfCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.entry_count, 0);
+  EXPECT_EQ(stats.size_bytes, 0);
+}
+
+TEST(LibunwindstackElfCache, ElfsAreReusedAcrossLibunwindstackMaps) {
+  LibunwindstackElfCache cache;
+  std::unique_ptr<LibunwindstackMaps> first_maps =
+      LibunwindstackMaps::ParseMaps(GetTargetFpMaps(), &cache);
+  ASSERT_NE(first_maps, nullptr);
+  unwindstack::Object* elf =
+      first_maps->Find(kAddressInTargetFpCode)->GetObject(nullptr, unwindstack::ARCH_X86_64);
+  ASSERT_NE(elf, nullptr);
+  ASSERT_TRUE(elf->valid());
+  EXPECT_EQ(cache.GetStats().entry_count, 0);
+
+  first_maps.reset();
+  LibunwindstackElfCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.entry_count, 1);
+  EXPECT_EQ(stats.size_bytes, std::filesystem::file_size(GetTargetFpPath()));
+
+  std::unique_ptr<LibunwindstackMaps> second_maps =
+      LibunwindstackMaps::ParseMaps(GetTargetFpMaps(), &cache);
+  ASSERT_NE(second_maps, nullptr);
+  std::shared_ptr<unwindstack::MapInfo> map_info = second_maps->Find(kAddressInTargetFpCode);
+  EXPECT_EQ(map_info->object().get(), elf);
+  EXPECT_EQ(map_info->GetObject(nullptr, unwindstack::ARCH_X86_64), elf);
+  EXPECT_EQ(cache.GetStats().hit_count, 1);
+
+  // New maps of the same file also get the cached Elf.
+  second_maps->AddAndSort(0x10000, 0x12000, 0x1000, PROT_READ | PROT_EXEC, GetTargetFpPath());
+  EXPECT_EQ(second_maps->Find(0x10500)->object().get(), elf);
+  EXPECT_EQ(cache.GetStats().hit_count, 1);
+}
+
+TEST(LibunwindstackElfCache, LibunwindstackMapsWithoutCacheDontShareElfs) {
+  std::unique_ptr<LibunwindstackMaps> first_maps =
+      LibunwindstackMaps::ParseMaps(GetTargetFpMaps());
+  unwindstack::Object* elf =
+      first_maps->Find(kAddressInTargetFpCode)->GetObject(nullptr, unwindstack::ARCH_X86_64);
+  ASSERT_NE(elf, nullptr);
+
+  std::unique_ptr<LibunwindstackMaps> second_maps =
+      LibunwindstackMaps::ParseMaps(GetTargetFpMaps());
+  EXPECT_EQ(second_maps->Find(kAddressInTargetFpCode)->object(), nullptr);
+}
+
+}  // namespace orbit_linux_tracing
@@ -4,24 +4,52 @@
 
 #include "LibunwindstackMaps.h"
 
+#include <absl/container/flat_hash_map.h>
+
 #include <algorithm>
+#include <filesystem>
 #include <string>
+#include <system_error>
 #include <utility>
 #include <vector>
 
 #include "OrbitBase/Logging.h"
+#include "unwindstack/Elf.h"
 #include "unwindstack/MapInfo.h"
 #include "unwindstack/Maps.h"
+#include "unwindstack/Memory.h"
+#include "unwindstack/Object.h"
 #include "unwindstack/SharedString.h"
 
 namespace orbit_linux_tracing {
 
 namespace {
 
+[[nodiscard]] bool IsFilePath(const std::string& name) { return !name.empty() && name[0] == '/'; }
+
+// Returns the build id of the ELF file at `path`, or an empty string.
+[[nodiscard]] std::string ReadBuildId(const std::string& path) {
+  std::unique_ptr<unwindstack::Memory> memory = unwindstack::Memory::CreateFileMemory(path, 0);
+  if (memory == nullptr) return "";
+  return unwindstack::Elf::GetBuildID(memory.get());
+}
+
 class LibunwindstackMapsImpl : public LibunwindstackMaps {
  public:
-  explicit LibunwindstackMapsImpl(std::unique_ptr<unwindstack::BufferMaps> maps)
-      : maps_{std::move(maps)} {}
+  LibunwindstackMapsImpl(std::unique_ptr<unwindstack::BufferMaps> maps,
+                         LibunwindstackElfCache* elf_cache)
+      : maps_{std::move(maps)}, elf_cache_{elf_cache} {
+    for (const std::shared_ptr<unwindstack::MapInfo>& map_info : *maps_) {
+      AttachCachedElf(map_info.get());
+    }
+  }
+
+  ~LibunwindstackMapsImpl() override { AddElfsToCache(); }
+
+  LibunwindstackMapsImpl(const LibunwindstackMapsImpl&) = delete;
+  LibunwindstackMapsImpl& operator=(const LibunwindstackMapsImpl&) = delete;
+  LibunwindstackMapsImpl(LibunwindstackMapsImpl&&) = delete;
+  LibunwindstackMapsImpl& operator=(LibunwindstackMapsImpl&&) = delete;
 
   std::shared_ptr<unwindstack::MapInfo> Find(uint64_t pc) override { return maps_->Find(pc); }
 
@@ -31,9 +59,77 @@ class LibunwindstackMapsImpl : public LibunwindstackMaps {
                   std::string_view name) override;
 
  private:
+  struct FileInfo {
+    std::string build_id;
+    // The Elf found in elf_cache_ for this file, if any.
+    std::shared_ptr<unwindstack::Object> cached_elf;
+  };
+
+  unwindstack::Maps::iterator Insert(unwindstack::Maps::iterator pos, uint64_t start, uint64_t end,
+                                     uint64_t offset, uint64_t flags, const std::string& name) {
+    auto map_info_it = maps_->Insert(pos, start, end, offset, flags, name);
+    AttachCachedElf(map_info_it->get());
+    return map_info_it;
+  }
+
+  // The build id is only read, and the cache only queried, once per file.
+  [[nodiscard]] const FileInfo& GetFileInfo(const std::string& path);
+  void AttachCachedElf(unwindstack::MapInfo* map_info);
+  // Adds the Elfs that were created for files that were not in elf_cache_, so that the next
+  // LibunwindstackMaps can reuse them.
+  void AddElfsToCache();
+
   std::unique_ptr<unwindstack::BufferMaps> maps_;
+  LibunwindstackElfCache* elf_cache_;
+  absl::flat_hash_map<std::string, FileInfo> file_infos_;
 };
 
+const LibunwindstackMapsImpl::FileInfo& LibunwindstackMapsImpl::GetFileInfo(
+    const std::string& path) {
+  auto [it, inserted] = file_infos_.try_emplace(path);
+  if (inserted) {
+    it->second.build_id = ReadBuildId(path);
+    it->second.cached_elf = elf_cache_->Find(path, it->second.build_id);
+  }
+  return it->second;
+}
+
+void LibunwindstackMapsImpl::AttachCachedElf(unwindstack::MapInfo* map_info) {
+  if (elf_cache_ == nullptr || !IsFilePath(map_info->name())) return;
+  std::shared_ptr<unwindstack::Object> elf = GetFileInfo(map_info->name()).cached_elf;
+  if (elf == nullptr) return;
+  // This is what unwindstack::Object::CacheGet does for an object that spans the whole file.
+  map_info->set_object(elf);
+  map_info->set_object_start_offset(0);
+  map_info->set_object_offset(map_info->offset());
+}
+
+void LibunwindstackMapsImpl::AddElfsToCache() {
+  if (elf_cache_ == nullptr) return;
+  for (const std::shared_ptr<unwindstack::MapInfo>& map_info : *maps_) {
+    const std::string& path = map_info->name();
+    if (!IsFilePath(path)) continue;
+    auto file_info_it = file_infos_.find(path);
+    if (file_info_it == file_infos_.end()) continue;
+    const FileInfo& file_info = file_info_it->second;
+
+    const std::shared_ptr<unwindstack::Object>& object = map_info->object();
+    if (object == nullptr || object == file_info.cached_elf || !object->valid()) continue;
+    // Only cache Elfs created from the whole file, so that they can be attached to any map of it.
+    if (dynamic_cast<unwindstack::Elf*>(object.get()) == nullptr ||
+        map_info->memory_backed_object() || map_info->object_start_offset() != 0) {
+      continue;
+    }
+    // The file could have changed since we read the build id.
+    if (file_info.build_id.empty() || object->GetBuildID() != file_info.build_id) continue;
+
+    std::error_code error;
+    const uint64_t file_size = std::filesystem::file_size(path, error);
+    if (error) continue;
+    elf_cache_->Add(path, file_info.build_id, file_size, object);
+  }
+}
+
 void LibunwindstackMapsImpl::AddAndSort(uint64_t start, uint64_t end, uint64_t offset,
                                         uint64_t flags, std::string_view name) {
   // First, remove existing maps that are fully contained in the new map, and resize or split
@@ -60,7 +156,7 @@ void LibunwindstackMapsImpl::AddAndSort(uint64_t start, uint64_t end, uint64_t o
     if (end <= map_info->start()) {
       // The new map does not intersect map_info and is before it. Keep map_info untouched but add
       // the new map before it.
-      maps_->Insert(map_info_it, start, end, offset, flags, std::string{name});
+      Insert(map_info_it, start, end, offset, flags, std::string{name});
       // The new map will not intersect any other existing map, so stop.
       return;
     }
@@ -78,18 +174,17 @@ void LibunwindstackMapsImpl::AddAndSort(uint64_t start, uint64_t end, uint64_t o
       // The new map intersects the first part of map_info. Keep the second part of map_info but add
       // the new map before it.
       map_info_it = maps_->erase(map_info_it);
-      map_info_it = maps_->Insert(map_info_it, start, end, offset, flags, std::string{name});
+      map_info_it = Insert(map_info_it, start, end, offset, flags, std::string{name});
       ++map_info_it;
-      maps_->Insert(map_info_it, end, map_info->end(), new_offset, map_info->flags(),
-                    map_info->name());
+      Insert(map_info_it, end, map_info->end(), new_offset, map_info->flags(), map_info->name());
       // The new map will not intersect any other existing map, so stop.
       return;
 
     } else if (end >= map_info->end()) {
       // The new map intersects the second part of map_info. Keep the first part of map_info.
       map_info_it = maps_->erase(map_info_it);
-      map_info_it = maps_->Insert(map_info_it, map_info->start(), start, map_info->offset(),
-                                  map_info->flags(), map_info->name());
+      map_info_it = Insert(map_info_it, map_info->start(), start, map_info->offset(),
+                           map_info->flags(), map_info->name());
       ++map_info_it;
 
     } else {
@@ -99,13 +194,13 @@ void LibunwindstackMapsImpl::AddAndSort(uint64_t start, uint64_t end, uint64_t o
       map_info_it = maps_->erase(map_info_it);
       {
         // Keep the first part of map_info.
-        map_info_it = maps_->Insert(map_info_it, map_info->start(), start, map_info->offset(),
-                                    map_info->flags(), map_info->name());
+        map_info_it = Insert(map_info_it, map_info->start(), start, map_info->offset(),
+                             map_info->flags(), map_info->name());
         ++map_info_it;
       }
       {
         // Add the new map.
-        map_info_it = maps_->Insert(map_info_it, start, end, offset, flags, std::string{name});
+        map_info_it = Insert(map_info_it, start, end, offset, flags, std::string{name});
         ++map_info_it;
       }
       {
@@ -115,8 +210,7 @@ void LibunwindstackMapsImpl::AddAndSort(uint64_t start, uint64_t end, uint64_t o
           // This was a file mapping: update the offset.
           new_offset = map_info->offset() + (end - map_info->start());
         }
-        maps_->Insert(map_info_it, end, map_info->end(), new_offset, map_info->flags(),
-                      map_info->name());
+        Insert(map_info_it, end, map_info->end(), new_offset, map_info->flags(), map_info->name());
       }
       // The new map will not intersect any other existing map, so stop.
       return;
@@ -125,19 +219,20 @@ void LibunwindstackMapsImpl::AddAndSort(uint64_t start, uint64_t end, uint64_t o
 
   // If the new map has not been added yet, it goes at the end.
   ORBIT_CHECK(maps_->Total() == 0 || (*(maps_->end() - 1))->end() <= start);
-  maps_->Insert(maps_->end(), start, end, offset, flags, std::string{name});
+  Insert(maps_->end(), start, end, offset, flags, std::string{name});
 }
 
 }  // namespace
 
-std::unique_ptr<LibunwindstackMaps> LibunwindstackMaps::ParseMaps(std::string_view maps_buffer) {
+std::unique_ptr<LibunwindstackMaps> LibunwindstackMaps::ParseMaps(
+    std::string_view maps_buffer, LibunwindstackElfCache* elf_cache) {
   std::string buffer{maps_buffer};  // Note that BufferMaps implicitly assume this string stays
                                     // alive until Parse was called.
   auto maps = std::make_unique<unwindstack::BufferMaps>(buffer.c_str());
   if (!maps->Parse()) {
     return nullptr;
   }
-  return std::make_unique<LibunwindstackMapsImpl>(std::move(maps));
+  return std::make_unique<LibunwindstackMapsImpl>(std::move(maps), elf_cache);
 }
 
 }  // namespace orbit_linux_tracing
\ No newline at end of file
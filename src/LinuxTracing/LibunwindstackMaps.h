@@ -13,6 +13,8 @@
 #include <string>
 #include <string_view>
 
+#include "LibunwindstackElfCache.h"
+
 namespace orbit_linux_tracing {
 
 // Wrapper around unwindstack::Maps that simplifies keeping the initial snapshot up to date when new
@@ -26,7 +28,10 @@ class LibunwindstackMaps {
   virtual void AddAndSort(uint64_t start, uint64_t end, uint64_t offset, uint64_t flags,
                           std::string_view name) = 0;
 
-  static std::unique_ptr<LibunwindstackMaps> ParseMaps(std::string_view maps_buffer);
+  // If `elf_cache` is not null, the Elfs it contains are reused for the files mapped, and the Elfs
+  // created while this object is alive are added to it on destruction.
+  static std::unique_ptr<LibunwindstackMaps> ParseMaps(std::string_view maps_buffer,
+                                                       LibunwindstackElfCache* elf_cache = nullptr);
 };
 
 }  // namespace orbit_linux_tracing
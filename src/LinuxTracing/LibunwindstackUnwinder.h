@@ -54,6 +54,8 @@ class LibunwindstackUnwinder {
  public:
   virtual ~LibunwindstackUnwinder() = default;
 
+  // Can be called concurrently from multiple threads, even with the same `maps`, as long as `maps`
+  // is not modified in the meantime.
   virtual LibunwindstackResult Unwind(pid_t pid, unwindstack::Maps* maps,
                                       const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs,
                                       absl::Span<const StackSliceView> stack_slices,
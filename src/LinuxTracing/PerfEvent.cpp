@@ -4,10 +4,28 @@
 
 #include "PerfEvent.h"
 
+#include <type_traits>
+
 #include "PerfEventVisitor.h"
 
 namespace orbit_linux_tracing {
 
+namespace {
+
+template <typename T, typename = void>
+struct HasStackCopy : std::false_type {};
+template <typename T>
+struct HasStackCopy<T, std::void_t<decltype(std::declval<const T&>().dyn_size)>>
+    : std::true_type {};
+
+template <typename T, typename = void>
+struct HasCallchain : std::false_type {};
+template <typename T>
+struct HasCallchain<T, std::void_t<decltype(std::declval<const T&>().ips_size)>>
+    : std::true_type {};
+
+}  // namespace
+
 std::array<uint64_t, PERF_REG_X86_64_MAX> perf_event_sample_regs_user_all_to_register_array(
     const RingBufferSampleRegsUserAll& regs) {
   std::array<uint64_t, PERF_REG_X86_64_MAX> registers{};
@@ -42,10 +60,27 @@ std::array<uint64_t, PERF_REG_X86_64_MAX> perf_event_sample_regs_user_all_to_reg
 // This is a non-traditional way of implementing the visitor pattern. The use of `std::variant`
 // instead of a regular class hierarchy is motivated by the fact that this saves us from heap
 // allocating objects, which turns out to be more expensive than copying.
-void PerfEvent::Accept(PerfEventVisitor* visitor) const {
+void PerfEvent::Accept(PerfEventVisitor* visitor) {
   std::visit([event_timestamp = timestamp,
               visitor](auto&& event_data) { visitor->Visit(event_timestamp, event_data); },
              data);
 }
 
+uint64_t PerfEvent::GetSizeBytes() const {
+  const uint64_t payload_size_bytes = std::visit(
+      [](auto&& event_data) -> uint64_t {
+        using EventDataT = std::decay_t<decltype(event_data)>;
+        uint64_t size_bytes = 0;
+        if constexpr (HasStackCopy<EventDataT>::value) {
+          size_bytes += event_data.dyn_size;
+        }
+        if constexpr (HasCallchain<EventDataT>::value) {
+          size_bytes += event_data.ips_size * sizeof(uint64_t);
+        }
+        return size_bytes;
+      },
+      data);
+  return sizeof(PerfEvent) + payload_size_bytes;
+}
+
 }  // namespace orbit_linux_tracing
@@ -16,11 +16,12 @@
 #include <cstring>
 #include <memory>
 #include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
 #include "GrpcProtos/Constants.h"
-#include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "PerfEventBufferPool.h"
 #include "PerfEventOrderedStream.h"
 #include "PerfEventRecords.h"
 
@@ -79,15 +80,18 @@ struct StackSamplePerfEventData {
   // StackSamplePerfEvent is const.  This mutablility is needed in
   // UprobesReturnAddressManager::PatchSample.
   [[nodiscard]] uint8_t* GetMutableStackData() const { return data.get(); }
+  // Transfers the ownership of the stack data, so that it can outlive the StackSamplePerfEvent.
+  // This is needed by UprobesUnwindingVisitor when unwinding in parallel.
+  [[nodiscard]] PooledArray<uint8_t> TakeStackData() { return std::move(data); }
   [[nodiscard]] uint64_t GetStackSize() const { return dyn_size; }
   [[nodiscard]] pid_t GetCallstackPidOrMinusOne() const { return pid; }
   [[nodiscard]] pid_t GetCallstackTid() const { return tid; }
 
   pid_t pid;
   pid_t tid;
-  std::unique_ptr<uint64_t[]> regs;
+  PooledArray<uint64_t> regs;
   uint64_t dyn_size;
-  std::unique_ptr<uint8_t[]> data;
+  PooledArray<uint8_t> data;
 };
 using StackSamplePerfEvent = TypedPerfEvent<StackSamplePerfEventData>;
 
@@ -105,7 +109,7 @@ struct CallchainSamplePerfEventData {
   [[nodiscard]] const uint8_t* GetStackData() const { return data.get(); }
   void SetIps(absl::Span<const uint64_t> new_ips) const {
     ips_size = new_ips.size();
-    ips = make_unique_for_overwrite<uint64_t[]>(ips_size);
+    ips = MakePooledArray<uint64_t>(ips_size);
     std::memcpy(ips.get(), new_ips.data(), ips_size * sizeof(uint64_t));
   }
   [[nodiscard]] std::vector<uint64_t> CopyOfIpsAsVector() const {
@@ -119,9 +123,9 @@ struct CallchainSamplePerfEventData {
   // Mutability is needed in SetIps which in turn is needed by
   // LeafFunctionCallManager::PatchCallerOfLeafFunction.
   mutable uint64_t ips_size;
-  mutable std::unique_ptr<uint64_t[]> ips;
-  std::unique_ptr<uint64_t[]> regs;
-  std::unique_ptr<uint8_t[]> data;
+  mutable PooledArray<uint64_t> ips;
+  PooledArray<uint64_t> regs;
+  PooledArray<uint8_t> data;
 };
 using CallchainSamplePerfEvent = TypedPerfEvent<CallchainSamplePerfEventData>;
 
@@ -155,13 +159,12 @@ struct UprobesWithStackPerfEventData {
   uint64_t stream_id;
   pid_t pid;
   pid_t tid;
-  std::unique_ptr<uint64_t[]> regs;
+  PooledArray<uint64_t> regs;
 
   uint64_t dyn_size;
-  // This mutablility allows moving the data out of this class in the UprobesUnwindingVisitor even
-  // if we only have a const reference there. This requires the explicit knowledge that there is
-  // only one visitor being applied to this event.
-  mutable std::unique_ptr<uint8_t[]> data;
+  // UprobesUnwindingVisitor moves the data out of this class. This requires the explicit knowledge
+  // that there is only one visitor consuming this event.
+  PooledArray<uint8_t> data;
 };
 using UprobesWithStackPerfEvent = TypedPerfEvent<UprobesWithStackPerfEventData>;
 
@@ -285,7 +288,7 @@ struct SchedWakeupWithCallchainPerfEventData {
   [[nodiscard]] const uint8_t* GetStackData() const { return data.get(); }
   void SetIps(absl::Span<const uint64_t> new_ips) const {
     ips_size = new_ips.size();
-    ips = make_unique_for_overwrite<uint64_t[]>(ips_size);
+    ips = MakePooledArray<uint64_t>(ips_size);
     memcpy(ips.get(), new_ips.data(), ips_size * sizeof(uint64_t));
   }
   [[nodiscard]] std::vector<uint64_t> CopyOfIpsAsVector() const {
@@ -300,9 +303,9 @@ struct SchedWakeupWithCallchainPerfEventData {
   // Mutability is needed in SetIps which in turn is needed by
   // LeafFunctionCallManager::PatchCallerOfLeafFunction.
   mutable uint64_t ips_size;
-  mutable std::unique_ptr<uint64_t[]> ips;
-  std::unique_ptr<uint64_t[]> regs;
-  std::unique_ptr<uint8_t[]> data;
+  mutable PooledArray<uint64_t> ips;
+  PooledArray<uint64_t> regs;
+  PooledArray<uint8_t> data;
 };
 using SchedWakeupWithCallchainPerfEvent = TypedPerfEvent<SchedWakeupWithCallchainPerfEventData>;
 
@@ -320,7 +323,7 @@ struct SchedSwitchWithCallchainPerfEventData {
   [[nodiscard]] const uint8_t* GetStackData() const { return data.get(); }
   void SetIps(absl::Span<const uint64_t> new_ips) const {
     ips_size = new_ips.size();
-    ips = make_unique_for_overwrite<uint64_t[]>(ips_size);
+    ips = MakePooledArray<uint64_t>(ips_size);
     memcpy(ips.get(), new_ips.data(), ips_size * sizeof(uint64_t));
   }
   [[nodiscard]] std::vector<uint64_t> CopyOfIpsAsVector() const {
@@ -337,9 +340,9 @@ struct SchedSwitchWithCallchainPerfEventData {
   // Mutability is needed in SetIps which in turn is needed by
   // LeafFunctionCallManager::PatchCallerOfLeafFunction.
   mutable uint64_t ips_size;
-  mutable std::unique_ptr<uint64_t[]> ips;
-  std::unique_ptr<uint64_t[]> regs;
-  std::unique_ptr<uint8_t[]> data;
+  mutable PooledArray<uint64_t> ips;
+  PooledArray<uint64_t> regs;
+  PooledArray<uint8_t> data;
 };
 using SchedSwitchWithCallchainPerfEvent = TypedPerfEvent<SchedSwitchWithCallchainPerfEventData>;
 
@@ -364,9 +367,9 @@ struct SchedWakeupWithStackPerfEventData {
   pid_t woken_tid;
   pid_t was_unblocked_by_tid;
   pid_t was_unblocked_by_pid;
-  std::unique_ptr<uint64_t[]> regs;
+  PooledArray<uint64_t> regs;
   uint64_t dyn_size;
-  std::unique_ptr<uint8_t[]> data;
+  PooledArray<uint8_t> data;
 };
 using SchedWakeupWithStackPerfEvent = TypedPerfEvent<SchedWakeupWithStackPerfEventData>;
 
@@ -393,9 +396,9 @@ struct SchedSwitchWithStackPerfEventData {
   pid_t prev_tid;
   int64_t prev_state;
   int32_t next_tid;
-  std::unique_ptr<uint64_t[]> regs;
+  PooledArray<uint64_t> regs;
   uint64_t dyn_size;
-  std::unique_ptr<uint8_t[]> data;
+  PooledArray<uint8_t> data;
 };
 using SchedSwitchWithStackPerfEvent = TypedPerfEvent<SchedSwitchWithStackPerfEventData>;
 
@@ -437,7 +440,11 @@ struct PerfEvent {
                DmaFenceSignaledPerfEventData>
       data;
 
-  void Accept(PerfEventVisitor* visitor) const;
+  void Accept(PerfEventVisitor* visitor);
+
+  // Returns the approximate number of bytes used by this event, including the copies of the stack
+  // and the callchains it owns.
+  [[nodiscard]] uint64_t GetSizeBytes() const;
 };
 
 }  // namespace orbit_linux_tracing
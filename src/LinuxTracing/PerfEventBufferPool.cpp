@@ -0,0 +1,138 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PerfEventBufferPool.h"
+
+#include <algorithm>
+#include <new>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+// Large buffers are prefixed with their size, as there is no size class to derive it from. The
+// header is as large as the alignment guaranteed by operator new, so that the buffer itself keeps
+// that alignment.
+constexpr size_t kLargeBufferHeaderSize = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+static_assert(kLargeBufferHeaderSize >= sizeof(size_t));
+
+[[nodiscard]] size_t GetSizeClassBytes(uint8_t size_class) {
+  return PerfEventBufferPool::kMinSizeClassBytes << size_class;
+}
+
+[[nodiscard]] uint8_t ComputeSizeClass(size_t size) {
+  uint8_t size_class = 0;
+  while (GetSizeClassBytes(size_class) < size) {
+    ++size_class;
+  }
+  return size_class;
+}
+
+}  // namespace
+
+PerfEventBufferPool& PerfEventBufferPool::GetInstance() {
+  // Intentionally leaked, so that buffers held by static objects can still be released at exit.
+  static auto* instance = new PerfEventBufferPool();
+  return *instance;
+}
+
+PerfEventBufferPool::~PerfEventBufferPool() { Trim(); }
+
+void* PerfEventBufferPool::Allocate(size_t size, uint8_t* size_class) {
+  ORBIT_CHECK(size_class != nullptr);
+
+  if (size > kMaxSizeClassBytes) {
+    *size_class = kLargeSizeClass;
+    {
+      absl::MutexLock lock{&mutex_};
+      ++allocation_count_;
+      ++heap_allocation_count_;
+      in_use_bytes_ += size;
+      high_water_mark_bytes_ = std::max(high_water_mark_bytes_, in_use_bytes_ + cached_bytes_);
+    }
+    auto* buffer = static_cast<uint8_t*>(::operator new(kLargeBufferHeaderSize + size));
+    *reinterpret_cast<size_t*>(buffer) = size;
+    return buffer + kLargeBufferHeaderSize;
+  }
+
+  *size_class = ComputeSizeClass(size);
+  const size_t size_class_bytes = GetSizeClassBytes(*size_class);
+  {
+    absl::MutexLock lock{&mutex_};
+    ++allocation_count_;
+    in_use_bytes_ += size_class_bytes;
+    std::vector<void*>& free_list = free_lists_[*size_class];
+    if (!free_list.empty()) {
+      void* buffer = free_list.back();
+      free_list.pop_back();
+      cached_bytes_ -= size_class_bytes;
+      return buffer;
+    }
+    ++heap_allocation_count_;
+    high_water_mark_bytes_ = std::max(high_water_mark_bytes_, in_use_bytes_ + cached_bytes_);
+  }
+  return ::operator new(size_class_bytes);
+}
+
+void PerfEventBufferPool::Release(void* buffer, uint8_t size_class) {
+  if (buffer == nullptr) return;
+
+  if (size_class == kLargeSizeClass) {
+    uint8_t* allocation = static_cast<uint8_t*>(buffer) - kLargeBufferHeaderSize;
+    const size_t size = *reinterpret_cast<size_t*>(allocation);
+    {
+      absl::MutexLock lock{&mutex_};
+      in_use_bytes_ -= size;
+    }
+    ::operator delete(allocation);
+    return;
+  }
+
+  ORBIT_CHECK(size_class < kSizeClassCount);
+  const size_t size_class_bytes = GetSizeClassBytes(size_class);
+  {
+    absl::MutexLock lock{&mutex_};
+    in_use_bytes_ -= size_class_bytes;
+    if (cached_bytes_ + size_class_bytes <= kMaxCachedBytes) {
+      free_lists_[size_class].push_back(buffer);
+      cached_bytes_ += size_class_bytes;
+      return;
+    }
+  }
+  ::operator delete(buffer);
+}
+
+void PerfEventBufferPool::Trim() {
+  std::array<std::vector<void*>, kSizeClassCount> free_lists;
+  {
+    absl::MutexLock lock{&mutex_};
+    free_lists.swap(free_lists_);
+    cached_bytes_ = 0;
+  }
+  for (std::vector<void*>& free_list : free_lists) {
+    for (void* buffer : free_list) {
+      ::operator delete(buffer);
+    }
+  }
+}
+
+PerfEventBufferPool::Stats PerfEventBufferPool::GetStats() const {
+  absl::MutexLock lock{&mutex_};
+  return Stats{
+      .pool_size_bytes = in_use_bytes_ + cached_bytes_,
+      .in_use_bytes = in_use_bytes_,
+      .high_water_mark_bytes = high_water_mark_bytes_,
+      .allocation_count = allocation_count_,
+      .heap_allocation_count = heap_allocation_count_,
+  };
+}
+
+void PerfEventBufferPool::ResetHighWaterMark() {
+  absl::MutexLock lock{&mutex_};
+  high_water_mark_bytes_ = in_use_bytes_ + cached_bytes_;
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,122 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_PERF_EVENT_BUFFER_POOL_H_
+#define LINUX_TRACING_PERF_EVENT_BUFFER_POOL_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace orbit_linux_tracing {
+
+// This class recycles the variable-size buffers that PerfEvents carry, i.e., the copies of the
+// stack, the registers and the callchains of samples. These are allocated for every sample by the
+// threads reading the perf_event_open ring buffers and freed on the thread processing the events,
+// once the visitors are done with them. With the pool, sampling at a steady rate doesn't allocate
+// from the heap.
+// Buffers are grouped in size classes of powers of two. Released buffers are kept in a free list
+// per size class, up to kMaxCachedBytes overall. Buffers larger than the largest size class are
+// allocated from and freed to the heap directly, but are still accounted for.
+// There is a single instance of this class, so that buffers can be returned to the pool regardless
+// of which Tracer created them and of whether it still exists.
+class PerfEventBufferPool {
+ public:
+  // Identifies arrays that were not allocated by the pool but with new[], e.g., in tests.
+  static constexpr uint8_t kNotPooled = std::numeric_limits<uint8_t>::max();
+
+  [[nodiscard]] static PerfEventBufferPool& GetInstance();
+
+  // Returns a buffer of at least `size` bytes, aligned like operator new, and sets `size_class` to
+  // the value to pass to Release.
+  [[nodiscard]] void* Allocate(size_t size, uint8_t* size_class);
+  void Release(void* buffer, uint8_t size_class);
+
+  // Frees all cached buffers. Buffers in use are not affected.
+  void Trim();
+
+  struct Stats {
+    // Bytes held by the pool, both in use and cached for reuse.
+    uint64_t pool_size_bytes = 0;
+    uint64_t in_use_bytes = 0;
+    // The maximum of pool_size_bytes since the last call to ResetHighWaterMark.
+    uint64_t high_water_mark_bytes = 0;
+    uint64_t allocation_count = 0;
+    // The number of allocations that had to be served by the heap.
+    uint64_t heap_allocation_count = 0;
+  };
+  [[nodiscard]] Stats GetStats() const;
+  void ResetHighWaterMark();
+
+  // Visible for testing.
+  static constexpr size_t kMinSizeClassBytes = 64;
+  static constexpr size_t kSizeClassCount = 12;
+  static constexpr size_t kMaxSizeClassBytes = kMinSizeClassBytes << (kSizeClassCount - 1);
+  // The size class of buffers larger than kMaxSizeClassBytes.
+  static constexpr uint8_t kLargeSizeClass = kSizeClassCount;
+  static constexpr uint64_t kMaxCachedBytes = 256ULL * 1024 * 1024;
+
+  PerfEventBufferPool() = default;
+  ~PerfEventBufferPool();
+  PerfEventBufferPool(const PerfEventBufferPool&) = delete;
+  PerfEventBufferPool& operator=(const PerfEventBufferPool&) = delete;
+  PerfEventBufferPool(PerfEventBufferPool&&) = delete;
+  PerfEventBufferPool& operator=(PerfEventBufferPool&&) = delete;
+
+ private:
+  mutable absl::Mutex mutex_;
+  std::array<std::vector<void*>, kSizeClassCount> free_lists_ ABSL_GUARDED_BY(mutex_);
+  uint64_t cached_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint64_t in_use_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint64_t high_water_mark_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint64_t allocation_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint64_t heap_allocation_count_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+// Deleter for PooledArray. It can be implicitly constructed from std::default_delete<T[]>, so that
+// a std::unique_ptr<T[]> can be moved into a PooledArray<T>, in which case the array is freed with
+// delete[].
+template <typename T>
+class PooledArrayDeleter {
+ public:
+  PooledArrayDeleter() = default;
+  // NOLINTNEXTLINE(google-explicit-constructor): Non-explicit constructor for conversions.
+  PooledArrayDeleter(std::default_delete<T[]> /*default_delete*/) {}
+  explicit PooledArrayDeleter(uint8_t size_class) : size_class_{size_class} {}
+
+  void operator()(T* array) const {
+    if (size_class_ == PerfEventBufferPool::kNotPooled) {
+      delete[] array;
+    } else {
+      PerfEventBufferPool::GetInstance().Release(array, size_class_);
+    }
+  }
+
+ private:
+  uint8_t size_class_ = PerfEventBufferPool::kNotPooled;
+};
+
+template <typename T>
+using PooledArray = std::unique_ptr<T[], PooledArrayDeleter<T>>;
+
+// Like make_unique_for_overwrite<T[]>, but takes the buffer from PerfEventBufferPool. The elements
+// are not initialized.
+template <typename T>
+[[nodiscard]] PooledArray<T> MakePooledArray(size_t size) {
+  static_assert(std::is_trivial_v<T>);
+  uint8_t size_class = PerfEventBufferPool::kNotPooled;
+  void* buffer = PerfEventBufferPool::GetInstance().Allocate(size * sizeof(T), &size_class);
+  return PooledArray<T>{static_cast<T*>(buffer), PooledArrayDeleter<T>{size_class}};
+}
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_PERF_EVENT_BUFFER_POOL_H_
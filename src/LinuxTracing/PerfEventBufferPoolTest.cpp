@@ -0,0 +1,132 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "PerfEventBufferPool.h"
+
+namespace orbit_linux_tracing {
+
+TEST(PerfEventBufferPool, ReleasedBufferIsReused) {
+  PerfEventBufferPool pool;
+  uint8_t size_class = PerfEventBufferPool::kNotPooled;
+  void* buffer = pool.Allocate(1000, &size_class);
+  ASSERT_NE(buffer, nullptr);
+  std::memset(buffer, 0xAB, 1000);
+  EXPECT_EQ(pool.GetStats().in_use_bytes, 1024);
+  pool.Release(buffer, size_class);
+
+  PerfEventBufferPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(stats.pool_size_bytes, 1024);
+  EXPECT_EQ(stats.in_use_bytes, 0);
+
+  uint8_t other_size_class = PerfEventBufferPool::kNotPooled;
+  // Any size in the same size class reuses the buffer.
+  void* other_buffer = pool.Allocate(600, &other_size_class);
+  EXPECT_EQ(other_buffer, buffer);
+  EXPECT_EQ(other_size_class, size_class);
+
+  stats = pool.GetStats();
+  EXPECT_EQ(stats.allocation_count, 2);
+  EXPECT_EQ(stats.heap_allocation_count, 1);
+  pool.Release(other_buffer, other_size_class);
+}
+
+TEST(PerfEventBufferPool, DifferentSizeClassesAreNotShared) {
+  PerfEventBufferPool pool;
+  uint8_t small_size_class = PerfEventBufferPool::kNotPooled;
+  void* small_buffer = pool.Allocate(8, &small_size_class);
+  pool.Release(small_buffer, small_size_class);
+
+  uint8_t large_size_class = PerfEventBufferPool::kNotPooled;
+  void* large_buffer = pool.Allocate(65000, &large_size_class);
+  EXPECT_NE(large_size_class, small_size_class);
+  std::memset(large_buffer, 0xAB, 65000);
+
+  PerfEventBufferPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(stats.heap_allocation_count, 2);
+  EXPECT_EQ(stats.in_use_bytes, 65536);
+  EXPECT_EQ(stats.pool_size_bytes, 65536 + 64);
+  pool.Release(large_buffer, large_size_class);
+}
+
+TEST(PerfEventBufferPool, BuffersLargerThanLargestSizeClassAreNotCached) {
+  PerfEventBufferPool pool;
+  constexpr size_t kSize = PerfEventBufferPool::kMaxSizeClassBytes + 1;
+  uint8_t size_class = PerfEventBufferPool::kNotPooled;
+  void* buffer = pool.Allocate(kSize, &size_class);
+  EXPECT_EQ(size_class, PerfEventBufferPool::kLargeSizeClass);
+  std::memset(buffer, 0xAB, kSize);
+  EXPECT_EQ(pool.GetStats().in_use_bytes, kSize);
+
+  pool.Release(buffer, size_class);
+  PerfEventBufferPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(stats.in_use_bytes, 0);
+  EXPECT_EQ(stats.pool_size_bytes, 0);
+  EXPECT_EQ(stats.high_water_mark_bytes, kSize);
+}
+
+TEST(PerfEventBufferPool, HighWaterMark) {
+  PerfEventBufferPool pool;
+  uint8_t size_class_1 = PerfEventBufferPool::kNotPooled;
+  void* buffer_1 = pool.Allocate(64, &size_class_1);
+  uint8_t size_class_2 = PerfEventBufferPool::kNotPooled;
+  void* buffer_2 = pool.Allocate(64, &size_class_2);
+  pool.Release(buffer_1, size_class_1);
+  pool.Release(buffer_2, size_class_2);
+  EXPECT_EQ(pool.GetStats().high_water_mark_bytes, 128);
+
+  pool.Trim();
+  PerfEventBufferPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(stats.pool_size_bytes, 0);
+  EXPECT_EQ(stats.high_water_mark_bytes, 128);
+
+  pool.ResetHighWaterMark();
+  EXPECT_EQ(pool.GetStats().high_water_mark_bytes, 0);
+}
+
+TEST(PerfEventBufferPool, TrimFreesCachedBuffers) {
+  PerfEventBufferPool pool;
+  uint8_t size_class = PerfEventBufferPool::kNotPooled;
+  void* buffer = pool.Allocate(100, &size_class);
+  pool.Release(buffer, size_class);
+  pool.Trim();
+
+  buffer = pool.Allocate(100, &size_class);
+  EXPECT_EQ(pool.GetStats().heap_allocation_count, 2);
+  pool.Release(buffer, size_class);
+}
+
+TEST(PooledArray, MakePooledArrayUsesGlobalPool) {
+  PerfEventBufferPool::Stats stats_before = PerfEventBufferPool::GetInstance().GetStats();
+  {
+    PooledArray<uint64_t> array = MakePooledArray<uint64_t>(100);
+    array[0] = 1;
+    array[99] = 2;
+    EXPECT_EQ(array[0] + array[99], 3);
+    EXPECT_EQ(PerfEventBufferPool::GetInstance().GetStats().in_use_bytes,
+              stats_before.in_use_bytes + 1024);
+  }
+  PerfEventBufferPool::Stats stats_after = PerfEventBufferPool::GetInstance().GetStats();
+  EXPECT_EQ(stats_after.in_use_bytes, stats_before.in_use_bytes);
+  EXPECT_EQ(stats_after.allocation_count, stats_before.allocation_count + 1);
+}
+
+TEST(PooledArray, CanHoldArrayAllocatedWithNew) {
+  PerfEventBufferPool::Stats stats_before = PerfEventBufferPool::GetInstance().GetStats();
+  {
+    PooledArray<uint8_t> array = std::make_unique<uint8_t[]>(16);
+    array[15] = 1;
+    EXPECT_EQ(array[15], 1);
+  }
+  PerfEventBufferPool::Stats stats_after = PerfEventBufferPool::GetInstance().GetStats();
+  EXPECT_EQ(stats_after.allocation_count, stats_before.allocation_count);
+  EXPECT_EQ(stats_after.in_use_bytes, stats_before.in_use_bytes);
+}
+
+}  // namespace orbit_linux_tracing
@@ -113,33 +113,45 @@ static constexpr uint16_t kSampleStackUserSize8Bytes = 8;
 // See also `ClientFlags.cpp`.
 static constexpr uint16_t kMaxStackSampleUserSize = 65000;
 
+// Number of bytes after which the kernel signals that new data is available in a ring buffer, e.g.,
+// to a thread blocked in epoll_wait on the file descriptor that owns the ring buffer. A watermark
+// in bytes, as opposed to a number of records, keeps the number of wakeups low for ring buffers
+// that receive large records (stack samples), while still waking up well before a ring buffer is
+// full. The kernel caps the watermark to the size of the ring buffer.
+// Only set when the ring buffers are waited on with epoll (`use_wakeup_watermark`): when they are
+// polled after sleeping, wakeups have no reader and the kernel default of half the buffer is kept.
+static constexpr uint32_t kRingBufferWakeupWatermarkBytes = 16 * 1024;
+
 // perf_event_open for context switches.
-int context_switch_event_open(pid_t pid, int32_t cpu);
+int context_switch_event_open(pid_t pid, int32_t cpu, bool use_wakeup_watermark);
 
 // perf_event_open for task (fork and exit) and mmap records in the same buffer.
-int mmap_task_event_open(pid_t pid, int32_t cpu);
+int mmap_task_event_open(pid_t pid, int32_t cpu, bool use_wakeup_watermark);
 
 // perf_event_open for stack sampling.
-int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu, uint16_t stack_dump_size);
+int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu, uint16_t stack_dump_size,
+                            bool use_wakeup_watermark);
 
 // perf_event_open for stack sampling using frame pointers.
 int callchain_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu,
-                                uint16_t stack_dump_size);
+                                uint16_t stack_dump_size, bool use_wakeup_watermark);
 
 // perf_event_open for uprobes and uretprobes.
-int uprobes_retaddr_event_open(const char* module, uint64_t function_offset, pid_t pid,
-                               int32_t cpu);
+int uprobes_retaddr_event_open(const char* module, uint64_t function_offset, pid_t pid, int32_t cpu,
+                               bool use_wakeup_watermark);
 
 int uprobes_with_stack_and_sp_event_open(const char* module, uint64_t function_offset, pid_t pid,
-                                         int32_t cpu, uint16_t stack_dump_size);
+                                         int32_t cpu, uint16_t stack_dump_size,
+                                         bool use_wakeup_watermark);
 
 int uprobes_retaddr_args_event_open(const char* module, uint64_t function_offset, pid_t pid,
-                                    int32_t cpu);
+                                    int32_t cpu, bool use_wakeup_watermark);
 
-int uretprobes_event_open(const char* module, uint64_t function_offset, pid_t pid, int32_t cpu);
+int uretprobes_event_open(const char* module, uint64_t function_offset, pid_t pid, int32_t cpu,
+                          bool use_wakeup_watermark);
 
 int uretprobes_retval_event_open(const char* module, uint64_t function_offset, pid_t pid,
-                                 int32_t cpu);
+                                 int32_t cpu, bool use_wakeup_watermark);
 
 // Create the ring buffer to use perf_event_open in sampled mode.
 void* perf_event_open_mmap_ring_buffer(int fd, uint64_t mmap_length);
@@ -149,14 +161,15 @@ void* perf_event_open_mmap_ring_buffer(int fd, uint64_t mmap_length);
 // (for example, "sched_waking"). Returns the file descriptor for the
 // perf event or -1 in case of any errors.
 int tracepoint_event_open(const char* tracepoint_category, const char* tracepoint_name, pid_t pid,
-                          int32_t cpu);
+                          int32_t cpu, bool use_wakeup_watermark);
 
 int tracepoint_with_stack_event_open(const char* tracepoint_category, const char* tracepoint_name,
-                                     pid_t pid, int32_t cpu, uint16_t stack_dump_size);
+                                     pid_t pid, int32_t cpu, uint16_t stack_dump_size,
+                                     bool use_wakeup_watermark);
 
 int tracepoint_with_callchain_event_open(const char* tracepoint_category,
                                          const char* tracepoint_name, pid_t pid, int32_t cpu,
-                                         uint16_t stack_dump_size);
+                                         uint16_t stack_dump_size, bool use_wakeup_watermark);
 
 }  // namespace orbit_linux_tracing
 
@@ -4,6 +4,7 @@
 
 #include "PerfEventProcessor.h"
 
+#include <algorithm>
 #include <utility>
 
 #include "OrbitBase/Logging.h"
@@ -21,10 +22,13 @@ void PerfEventProcessor::AddEvent(PerfEvent&& event) {
 
     std::optional<DiscardedPerfEvent> discarded_perf_event = HandleOutOfOrderEvent(timestamp);
     if (discarded_perf_event.has_value()) {
-      event_queue_.PushEvent(discarded_perf_event.value());
+      PerfEvent discarded_event{discarded_perf_event.value()};
+      queued_event_bytes_ += discarded_event.GetSizeBytes();
+      event_queue_.PushEvent(std::move(discarded_event));
     }
     return;
   }
+  queued_event_bytes_ += event.GetSizeBytes();
   event_queue_.PushEvent(std::move(event));
 }
 
@@ -83,42 +87,40 @@ std::optional<DiscardedPerfEvent> PerfEventProcessor::HandleOutOfOrderEvent(
   return optional_discarded_event;
 }
 
+void PerfEventProcessor::ProcessTopEvent() {
+  PerfEvent& event = event_queue_.TopEvent();
+  // Events are guaranteed to be processed in order of timestamp
+  // as out-of-order events are discarded in AddEvent.
+  ORBIT_CHECK(event.timestamp >= last_processed_timestamp_ns_);
+  last_processed_timestamp_ns_ = event.timestamp;
+  for (PerfEventVisitor* visitor : visitors_) {
+    event.Accept(visitor);
+  }
+  queued_event_bytes_ -= event.GetSizeBytes();
+  event_queue_.PopEvent();
+}
+
 void PerfEventProcessor::ProcessAllEvents() {
   ORBIT_CHECK(!visitors_.empty());
   while (event_queue_.HasEvent()) {
-    const PerfEvent& event = event_queue_.TopEvent();
-    // Events are guaranteed to be processed in order of timestamp
-    // as out-of-order events are discarded in AddEvent.
-    ORBIT_CHECK(event.timestamp >= last_processed_timestamp_ns_);
-    last_processed_timestamp_ns_ = event.timestamp;
-    for (PerfEventVisitor* visitor : visitors_) {
-      event.Accept(visitor);
-    }
-    event_queue_.PopEvent();
+    ProcessTopEvent();
   }
 }
 
-void PerfEventProcessor::ProcessOldEvents() {
+void PerfEventProcessor::ProcessOldEvents(uint64_t low_watermark_ns) {
   ORBIT_CHECK(!visitors_.empty());
   const uint64_t current_timestamp_ns = orbit_base::CaptureTimestampNs();
-
-  while (event_queue_.HasEvent()) {
-    const PerfEvent& event = event_queue_.TopEvent();
-    const uint64_t timestamp = event.timestamp;
-
-    // Do not read the most recent events as out-of-order events could (and will) arrive.
-    if (timestamp + kProcessingDelayMs * 1'000'000 >= current_timestamp_ns) {
-      break;
-    }
-    // Events are guaranteed to be processed in order of timestamp
-    // as out-of-order events are discarded in AddEvent.
-    ORBIT_CHECK(timestamp >= last_processed_timestamp_ns_);
-    last_processed_timestamp_ns_ = timestamp;
-
-    for (PerfEventVisitor* visitor : visitors_) {
-      event.Accept(visitor);
-    }
-    event_queue_.PopEvent();
+  constexpr uint64_t kProcessingDelayNs = kProcessingDelayMs * 1'000'000;
+  // Do not read the most recent events as out-of-order events could (and will) arrive, unless we
+  // know from the watermark that they won't.
+  const uint64_t delay_threshold_ns =
+      current_timestamp_ns > kProcessingDelayNs ? current_timestamp_ns - kProcessingDelayNs : 0;
+  const uint64_t threshold_ns = std::max(delay_threshold_ns, low_watermark_ns);
+  last_processing_lag_ns_ =
+      current_timestamp_ns > threshold_ns ? current_timestamp_ns - threshold_ns : 0;
+
+  while (event_queue_.HasEvent() && event_queue_.TopEvent().timestamp < threshold_ns) {
+    ProcessTopEvent();
   }
 }
 
@@ -23,6 +23,10 @@ namespace orbit_linux_tracing {
 // Its implementation builds on the assumption that we never expect events with a timestamp older
 // than kProcessingDelayMs to be added. By not processing events that are not older than this delay,
 // we will never process events out of order.
+// The caller can also pass a low watermark to ProcessOldEvents, i.e., a timestamp such that no
+// event older than it will be added anymore, in which case events older than the watermark are
+// processed even if they are more recent than kProcessingDelayMs. The delay then only acts as an
+// upper bound on how long events are held back.
 // If events older than kProcessingDelayMs are encountered anyway, these are discarded, and
 // DiscardedPerfEvents are generated and processed in their place.
 class PerfEventProcessor {
@@ -31,7 +35,9 @@ class PerfEventProcessor {
 
   void ProcessAllEvents();
 
-  void ProcessOldEvents();
+  void ProcessOldEvents() { ProcessOldEvents(0); }
+  // Processes the events older than `low_watermark_ns` or older than kProcessingDelayMs.
+  void ProcessOldEvents(uint64_t low_watermark_ns);
 
   void AddVisitor(PerfEventVisitor* visitor) { visitors_.push_back(visitor); }
 
@@ -47,8 +53,17 @@ class PerfEventProcessor {
   // order.
   static constexpr uint64_t kProcessingDelayMs = 333;
 
+  // The approximate memory used by the events not processed yet, see PerfEvent::GetSizeBytes.
+  [[nodiscard]] uint64_t GetQueuedEventBytes() const { return queued_event_bytes_; }
+  // How far behind the current time the last call to ProcessOldEvents stopped processing events.
+  [[nodiscard]] uint64_t GetLastProcessingLagNs() const { return last_processing_lag_ns_; }
+
  private:
+  void ProcessTopEvent();
+
   uint64_t last_processed_timestamp_ns_ = 0;
+  uint64_t queued_event_bytes_ = 0;
+  uint64_t last_processing_lag_ns_ = 0;
   std::atomic<uint64_t>* discarded_out_of_order_counter_ = nullptr;
 
   PerfEventQueue event_queue_;
@@ -5,11 +5,14 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <memory>
+#include <random>
 #include <thread>
+#include <vector>
 
 #include "OrbitBase/Profiling.h"
 #include "PerfEvent.h"
@@ -102,6 +105,48 @@ TEST_F(PerfEventProcessorTest, ProcessOldEvents) {
   EXPECT_EQ(discarded_out_of_order_counter_, 0);
 }
 
+TEST_F(PerfEventProcessorTest, ProcessOldEventsWithLowWatermark) {
+  const uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  processor_.AddEvent(MakeFakePerfEventOrderedInFd(11, timestamp_ns));
+  processor_.AddEvent(MakeFakePerfEventOrderedInFd(22, timestamp_ns + 1));
+  processor_.AddEvent(MakeFakePerfEventOrderedInFd(11, timestamp_ns + 2));
+
+  // Events older than the watermark are processed without waiting for kProcessingDelayMs.
+  EXPECT_CALL(mock_visitor_, Visit(_, A<const ForkPerfEventData&>())).Times(2);
+  processor_.ProcessOldEvents(timestamp_ns + 2);
+  Mock::VerifyAndClearExpectations(&mock_visitor_);
+  EXPECT_LT(processor_.GetLastProcessingLagNs(), kDelayBeforeProcessOldEventsMs * 1'000'000);
+
+  // A watermark older than the delay has no effect.
+  EXPECT_CALL(mock_visitor_, Visit(_, A<const ForkPerfEventData&>())).Times(0);
+  processor_.ProcessOldEvents(timestamp_ns);
+  Mock::VerifyAndClearExpectations(&mock_visitor_);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(kDelayBeforeProcessOldEventsMs));
+  EXPECT_CALL(mock_visitor_, Visit(_, A<const ForkPerfEventData&>())).Times(1);
+  processor_.ProcessOldEvents(timestamp_ns);
+  EXPECT_GE(processor_.GetLastProcessingLagNs(), kDelayBeforeProcessOldEventsMs * 1'000'000);
+  EXPECT_EQ(discarded_out_of_order_counter_, 0);
+}
+
+TEST_F(PerfEventProcessorTest, QueuedEventBytes) {
+  EXPECT_CALL(mock_visitor_, Visit(_, A<const ForkPerfEventData&>())).Times(2);
+  EXPECT_EQ(processor_.GetQueuedEventBytes(), 0);
+
+  const uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  PerfEvent event = MakeFakePerfEventOrderedInFd(11, timestamp_ns);
+  const uint64_t event_size_bytes = event.GetSizeBytes();
+  EXPECT_GE(event_size_bytes, sizeof(PerfEvent));
+  processor_.AddEvent(std::move(event));
+  processor_.AddEvent(MakeFakePerfEventOrderedInFd(11, timestamp_ns + 2));
+  EXPECT_EQ(processor_.GetQueuedEventBytes(), 2 * event_size_bytes);
+
+  processor_.ProcessOldEvents(timestamp_ns + 1);
+  EXPECT_EQ(processor_.GetQueuedEventBytes(), event_size_bytes);
+  processor_.ProcessAllEvents();
+  EXPECT_EQ(processor_.GetQueuedEventBytes(), 0);
+}
+
 TEST_F(PerfEventProcessorTest, ProcessAllEvents) {
   EXPECT_CALL(mock_visitor_, Visit(_, A<const ForkPerfEventData&>())).Times(4);
   processor_.AddEvent(MakeFakePerfEventOrderedInFd(11, orbit_base::CaptureTimestampNs()));
@@ -223,4 +268,73 @@ TEST_F(PerfEventProcessorTest, ProcessAllEventsNeedsVisitor) {
   EXPECT_DEATH(processor_.ProcessAllEvents(), "!visitors_.empty()");
 }
 
+namespace {
+
+class OrderCheckingVisitor : public PerfEventVisitor {
+ public:
+  void Visit(uint64_t event_timestamp, const ForkPerfEventData& /*event_data*/) override {
+    EXPECT_GE(event_timestamp, last_timestamp_ns_);
+    last_timestamp_ns_ = event_timestamp;
+    ++event_count_;
+  }
+  [[nodiscard]] uint64_t GetEventCount() const { return event_count_; }
+
+ private:
+  uint64_t last_timestamp_ns_ = 0;
+  uint64_t event_count_ = 0;
+};
+
+}  // namespace
+
+// The events are spread over streams like in a capture on a large machine: one ordered stream per
+// ring buffer, a few more per thread, and a small fraction of events not ordered in any stream.
+// They are added in batches per stream, as the ring buffer readers do.
+TEST(PerfEventProcessor, ProcessAllEventsVisitsEventsOfManyStreamsInOrder) {
+  constexpr int kFdStreamCount = 64;
+  constexpr int kTidStreamCount = 192;
+  constexpr int kStreamCount = kFdStreamCount + kTidStreamCount;
+  constexpr double kNotOrderedEventFraction = 0.01;
+  constexpr size_t kBatchSize = 64;
+  constexpr size_t kEventCount = 100'000;
+
+  std::mt19937 random_generator{42};
+  std::uniform_int_distribution<int> stream_distribution{0, kStreamCount - 1};
+  std::bernoulli_distribution not_ordered_distribution{kNotOrderedEventFraction};
+
+  std::vector<std::vector<PerfEvent>> events_by_stream(kStreamCount + 1);
+  for (uint64_t timestamp_ns = 1; timestamp_ns <= kEventCount; ++timestamp_ns) {
+    if (not_ordered_distribution(random_generator)) {
+      events_by_stream[kStreamCount].push_back(MakeFakePerfEventNotOrdered(timestamp_ns));
+      continue;
+    }
+    const int stream = stream_distribution(random_generator);
+    events_by_stream[stream].push_back(ForkPerfEvent{
+        .timestamp = timestamp_ns,
+        .ordered_stream = stream < kFdStreamCount ? PerfEventOrderedStream::FileDescriptor(stream)
+                                                  : PerfEventOrderedStream::ThreadId(stream),
+    });
+  }
+
+  PerfEventProcessor processor;
+  OrderCheckingVisitor visitor;
+  processor.AddVisitor(&visitor);
+
+  std::vector<size_t> next_index_by_stream(events_by_stream.size(), 0);
+  size_t added_event_count = 0;
+  while (added_event_count < kEventCount) {
+    for (size_t stream = 0; stream < events_by_stream.size(); ++stream) {
+      std::vector<PerfEvent>& stream_events = events_by_stream[stream];
+      size_t& next_index = next_index_by_stream[stream];
+      const size_t batch_end = std::min(stream_events.size(), next_index + kBatchSize);
+      for (; next_index < batch_end; ++next_index) {
+        processor.AddEvent(std::move(stream_events[next_index]));
+        ++added_event_count;
+      }
+    }
+  }
+  processor.ProcessAllEvents();
+
+  EXPECT_EQ(visitor.GetEventCount(), kEventCount);
+}
+
 }  // namespace orbit_linux_tracing
@@ -4,7 +4,7 @@
 
 #include "PerfEventQueue.h"
 
-#include <absl/meta/type_traits.h>
+#include <absl/numeric/bits.h>
 #include <stddef.h>
 
 #include <algorithm>
@@ -16,126 +16,209 @@
 
 namespace orbit_linux_tracing {
 
+void PerfEventQueue::EventRingBuffer::push_back(PerfEvent&& event) {
+  if (size_ == events_.size()) {
+    std::vector<std::optional<PerfEvent>> new_events(std::max(kMinCapacity, 2 * events_.size()));
+    for (size_t i = 0; i < size_; ++i) {
+      new_events[i] = std::move(events_[(front_index_ + i) & (events_.size() - 1)]);
+    }
+    events_ = std::move(new_events);
+    front_index_ = 0;
+  }
+  events_[(front_index_ + size_) & (events_.size() - 1)].emplace(std::move(event));
+  ++size_;
+}
+
+void PerfEventQueue::EventRingBuffer::pop_front() {
+  ORBIT_CHECK(!empty());
+  events_[front_index_].reset();
+  front_index_ = (front_index_ + 1) & (events_.size() - 1);
+  --size_;
+  if (size_ == 0 && events_.size() > kMaxRetainedCapacity) {
+    events_.clear();
+    events_.shrink_to_fit();
+    front_index_ = 0;
+  }
+}
+
+size_t PerfEventQueue::EventRadixHeap::ComputeBucketIndex(uint64_t timestamp) const {
+  ORBIT_CHECK(timestamp >= last_timestamp_);
+  if (timestamp == last_timestamp_) return 0;
+  return 64 - absl::countl_zero(timestamp ^ last_timestamp_);
+}
+
+void PerfEventQueue::EventRadixHeap::push(PerfEvent&& event) {
+  const uint64_t timestamp = event.timestamp;
+  if (timestamp < last_timestamp_) {
+    Rebuild(timestamp);
+  }
+
+  uint32_t event_index;
+  if (!free_event_indices_.empty()) {
+    event_index = free_event_indices_.back();
+    free_event_indices_.pop_back();
+    events_[event_index].emplace(std::move(event));
+  } else {
+    event_index = events_.size();
+    events_.emplace_back(std::move(event));
+  }
+  buckets_[ComputeBucketIndex(timestamp)].push_back(Entry{timestamp, event_index});
+  ++size_;
+}
+
+uint64_t PerfEventQueue::EventRadixHeap::top_timestamp() {
+  if (empty()) return std::numeric_limits<uint64_t>::max();
+  FillFirstBucket();
+  return last_timestamp_;
+}
+
+PerfEvent& PerfEventQueue::EventRadixHeap::top() {
+  ORBIT_CHECK(!empty());
+  FillFirstBucket();
+  return *events_[buckets_[0].back().event_index];
+}
+
+void PerfEventQueue::EventRadixHeap::pop() {
+  ORBIT_CHECK(!empty());
+  FillFirstBucket();
+  const uint32_t event_index = buckets_[0].back().event_index;
+  buckets_[0].pop_back();
+  events_[event_index].reset();
+  free_event_indices_.push_back(event_index);
+  --size_;
+}
+
+void PerfEventQueue::EventRadixHeap::FillFirstBucket() {
+  if (!buckets_[0].empty()) return;
+
+  auto bucket_it = std::find_if(buckets_.begin() + 1, buckets_.end(),
+                                [](const std::vector<Entry>& bucket) { return !bucket.empty(); });
+  ORBIT_CHECK(bucket_it != buckets_.end());
+  std::vector<Entry>& bucket = *bucket_it;
+  last_timestamp_ = std::min_element(bucket.begin(), bucket.end(),
+                                     [](const Entry& lhs, const Entry& rhs) {
+                                       return lhs.timestamp < rhs.timestamp;
+                                     })
+                        ->timestamp;
+  // All entries move to buckets with lower indices, so this doesn't modify the bucket iterated.
+  for (const Entry& entry : bucket) {
+    buckets_[ComputeBucketIndex(entry.timestamp)].push_back(entry);
+  }
+  bucket.clear();
+}
+
+void PerfEventQueue::EventRadixHeap::Rebuild(uint64_t new_last_timestamp) {
+  std::vector<Entry> entries;
+  entries.reserve(size_);
+  for (std::vector<Entry>& bucket : buckets_) {
+    entries.insert(entries.end(), bucket.begin(), bucket.end());
+    bucket.clear();
+  }
+  last_timestamp_ = new_last_timestamp;
+  for (const Entry& entry : entries) {
+    buckets_[ComputeBucketIndex(entry.timestamp)].push_back(entry);
+  }
+}
+
 void PerfEventQueue::PushEvent(PerfEvent&& event) {
   const PerfEventOrderedStream order = event.ordered_stream;
   if (order == PerfEventOrderedStream::kNone) {
-    priority_queue_of_events_not_ordered_in_stream_.push(std::move(event));
-  } else if (auto queue_it = queues_of_events_ordered_in_stream_.find(order);
-             queue_it != queues_of_events_ordered_in_stream_.end()) {
-    const std::unique_ptr<std::queue<PerfEvent>>& queue = queue_it->second;
+    events_not_ordered_in_stream_.push(std::move(event));
+    return;
+  }
 
-    ORBIT_CHECK(!queue->empty());
+  auto [slot_it, inserted] = slots_of_ordered_streams_.try_emplace(order, kNoSlot);
+  if (!inserted) {
+    EventRingBuffer& queue = queues_of_events_ordered_in_stream_[slot_it->second];
+    ORBIT_CHECK(!queue.empty());
     // Fundamental assumption: events from the same file descriptor come already in order.
-    ORBIT_CHECK(event.timestamp >= queue->back().timestamp);
-    queue->push(std::move(event));
-  } else {
-    queue_it = queues_of_events_ordered_in_stream_
-                   .emplace(order, std::make_unique<std::queue<PerfEvent>>())
-                   .first;
-    const std::unique_ptr<std::queue<PerfEvent>>& queue = queue_it->second;
-
-    queue->push(std::move(event));
-    heap_of_queues_of_events_ordered_in_stream_.emplace_back(queue.get());
-    MoveUpBackOfHeapOfQueues();
+    ORBIT_CHECK(event.timestamp >= queue.back().timestamp);
+    queue.push_back(std::move(event));
+    return;
   }
+
+  const uint32_t slot = AllocateSlot();
+  slot_it->second = slot;
+  queues_of_events_ordered_in_stream_[slot].push_back(std::move(event));
+  UpdateTournament(slot);
 }
 
 bool PerfEventQueue::HasEvent() const {
-  return !heap_of_queues_of_events_ordered_in_stream_.empty() ||
-         !priority_queue_of_events_not_ordered_in_stream_.empty();
-}
-
-const PerfEvent& PerfEventQueue::TopEvent() {
-  // As we effectively have two priority queues, get the older event between the two events at the
-  // top of the two queues. In case those two events have the exact same timestamp, return the one
-  // at the top of priority_queue_of_events_not_ordered_in_stream_ (and do the same in PopEvent).
-  if (priority_queue_of_events_not_ordered_in_stream_.empty()) {
-    ORBIT_CHECK(!heap_of_queues_of_events_ordered_in_stream_.empty());
-    ORBIT_CHECK(!heap_of_queues_of_events_ordered_in_stream_.front()->empty());
-    return heap_of_queues_of_events_ordered_in_stream_.front()->front();
-  }
-  if (heap_of_queues_of_events_ordered_in_stream_.empty()) {
-    ORBIT_CHECK(!priority_queue_of_events_not_ordered_in_stream_.empty());
-    return priority_queue_of_events_not_ordered_in_stream_.top();
+  return tournament_tree_[1].slot != kNoSlot || !events_not_ordered_in_stream_.empty();
+}
+
+bool PerfEventQueue::IsOldestEventNotOrderedInStream() {
+  // In case the oldest event in a queue and the oldest event not ordered in any stream have the
+  // exact same timestamp, prefer the latter, consistently between TopEvent and PopEvent.
+  return !events_not_ordered_in_stream_.empty() &&
+         (tournament_tree_[1].slot == kNoSlot ||
+          events_not_ordered_in_stream_.top_timestamp() <= tournament_tree_[1].timestamp);
+}
+
+PerfEvent& PerfEventQueue::TopEvent() {
+  if (IsOldestEventNotOrderedInStream()) {
+    return events_not_ordered_in_stream_.top();
   }
-  return (heap_of_queues_of_events_ordered_in_stream_.front()->front().timestamp <
-          priority_queue_of_events_not_ordered_in_stream_.top().timestamp)
-             ? heap_of_queues_of_events_ordered_in_stream_.front()->front()
-             : priority_queue_of_events_not_ordered_in_stream_.top();
+  const uint32_t top_slot = tournament_tree_[1].slot;
+  ORBIT_CHECK(top_slot != kNoSlot);
+  return queues_of_events_ordered_in_stream_[top_slot].front();
 }
 
 void PerfEventQueue::PopEvent() {
-  if (!priority_queue_of_events_not_ordered_in_stream_.empty() &&
-      (heap_of_queues_of_events_ordered_in_stream_.empty() ||
-       priority_queue_of_events_not_ordered_in_stream_.top().timestamp <=
-           heap_of_queues_of_events_ordered_in_stream_.front()->front().timestamp)) {
-    // The oldest event is at the top of the priority queue holding the events that cannot be
-    // assumed sorted in any stream. Note in particular that we pop this event even if the event at
-    // the top of heap_of_queues_of_events_ordered_in_stream_ has the exact same timestamp, as we
-    // need to be consistent with TopEvent.
-    priority_queue_of_events_not_ordered_in_stream_.pop();
+  if (IsOldestEventNotOrderedInStream()) {
+    events_not_ordered_in_stream_.pop();
     return;
   }
 
-  std::queue<PerfEvent>* top_queue = heap_of_queues_of_events_ordered_in_stream_.front();
-  const PerfEventOrderedStream top_order = top_queue->front().ordered_stream;
-  top_queue->pop();
+  const uint32_t top_slot = tournament_tree_[1].slot;
+  ORBIT_CHECK(top_slot != kNoSlot);
+  EventRingBuffer& top_queue = queues_of_events_ordered_in_stream_[top_slot];
+  const PerfEventOrderedStream top_order = top_queue.front().ordered_stream;
+  top_queue.pop_front();
 
-  if (top_queue->empty()) {
-    queues_of_events_ordered_in_stream_.erase(top_order);
-    std::swap(heap_of_queues_of_events_ordered_in_stream_.front(),
-              heap_of_queues_of_events_ordered_in_stream_.back());
-    heap_of_queues_of_events_ordered_in_stream_.pop_back();
+  if (top_queue.empty()) {
+    slots_of_ordered_streams_.erase(top_order);
+    free_slots_.push_back(top_slot);
   }
-
-  MoveDownFrontOfHeapOfQueues();
+  UpdateTournament(top_slot);
 }
 
-void PerfEventQueue::MoveDownFrontOfHeapOfQueues() {
-  if (heap_of_queues_of_events_ordered_in_stream_.empty()) {
-    return;
-  }
-
-  size_t current_index = 0;
-  while (true) {
-    size_t new_index = current_index;
-    size_t left_index = current_index * 2 + 1;
-    size_t right_index = current_index * 2 + 2;
-    if (left_index < heap_of_queues_of_events_ordered_in_stream_.size() &&
-        heap_of_queues_of_events_ordered_in_stream_[left_index]->front().timestamp <
-            heap_of_queues_of_events_ordered_in_stream_[new_index]->front().timestamp) {
-      new_index = left_index;
-    }
-    if (right_index < heap_of_queues_of_events_ordered_in_stream_.size() &&
-        heap_of_queues_of_events_ordered_in_stream_[right_index]->front().timestamp <
-            heap_of_queues_of_events_ordered_in_stream_[new_index]->front().timestamp) {
-      new_index = right_index;
+uint32_t PerfEventQueue::AllocateSlot() {
+  if (free_slots_.empty()) {
+    // Double the number of slots and rebuild the tournament tree, keeping the leaves.
+    const size_t old_slot_count = queues_of_events_ordered_in_stream_.size();
+    const size_t new_slot_count = std::max<size_t>(1, 2 * old_slot_count);
+    ORBIT_CHECK(new_slot_count < kNoSlot);
+    queues_of_events_ordered_in_stream_.resize(new_slot_count);
+
+    std::vector<TournamentNode> new_tournament_tree(2 * new_slot_count, kEmptyTournamentNode);
+    std::copy(tournament_tree_.begin() + old_slot_count,
+              tournament_tree_.begin() + 2 * old_slot_count,
+              new_tournament_tree.begin() + new_slot_count);
+    for (size_t node = new_slot_count - 1; node >= 1; --node) {
+      new_tournament_tree[node] =
+          PlayMatch(new_tournament_tree[2 * node], new_tournament_tree[2 * node + 1]);
     }
-    if (new_index != current_index) {
-      std::swap(heap_of_queues_of_events_ordered_in_stream_[new_index],
-                heap_of_queues_of_events_ordered_in_stream_[current_index]);
-      current_index = new_index;
-    } else {
-      break;
+    tournament_tree_ = std::move(new_tournament_tree);
+
+    for (size_t slot = new_slot_count; slot > old_slot_count; --slot) {
+      free_slots_.push_back(slot - 1);
     }
   }
-}
 
-void PerfEventQueue::MoveUpBackOfHeapOfQueues() {
-  if (heap_of_queues_of_events_ordered_in_stream_.empty()) {
-    return;
-  }
+  const uint32_t slot = free_slots_.back();
+  free_slots_.pop_back();
+  return slot;
+}
 
-  size_t current_index = heap_of_queues_of_events_ordered_in_stream_.size() - 1;
-  while (current_index > 0) {
-    size_t parent_index = (current_index - 1) / 2;
-    if (heap_of_queues_of_events_ordered_in_stream_[parent_index]->front().timestamp <=
-        heap_of_queues_of_events_ordered_in_stream_[current_index]->front().timestamp) {
-      break;
-    }
-    std::swap(heap_of_queues_of_events_ordered_in_stream_[parent_index],
-              heap_of_queues_of_events_ordered_in_stream_[current_index]);
-    current_index = parent_index;
+void PerfEventQueue::UpdateTournament(uint32_t slot) {
+  size_t node = queues_of_events_ordered_in_stream_.size() + slot;
+  EventRingBuffer& queue = queues_of_events_ordered_in_stream_[slot];
+  tournament_tree_[node] =
+      queue.empty() ? kEmptyTournamentNode : TournamentNode{queue.front().timestamp, slot};
+  while (node > 1) {
+    node /= 2;
+    tournament_tree_[node] = PlayMatch(tournament_tree_[2 * node], tournament_tree_[2 * node + 1]);
   }
 }
 
@@ -8,9 +8,11 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/hash/hash.h>
 
-#include <functional>
-#include <memory>
-#include <queue>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
 #include <vector>
 
 #include "PerfEvent.h"
@@ -25,47 +27,121 @@ namespace orbit_linux_tracing {
 // Instead of keeping a single priority queue with all the events to process, on which push/pop
 // operations would be logarithmic in the number of events, we leverage the fact that some streams
 // of events are known to be already sorted; for example, most perf_event_open records coming from
-// the same perf_event_open ring buffer are already sorted. We then keep a priority queue of queues,
-// where the events in each queue come from the same sorted stream, identified by matching instances
-// of PerfEventOrderedStream. Whenever an event is removed from a queue, we need to move such queue
-// down the priority queue.
+// the same perf_event_open ring buffer are already sorted. The events of each sorted stream,
+// identified by matching instances of PerfEventOrderedStream, are kept in a FIFO queue, and the
+// queues are merged with a tournament tree, whose nodes hold the timestamp of the oldest event in
+// their subtree. Whenever an event is removed from a queue, only the path from its leaf to the
+// root needs to be replayed. The queues are circular buffers, and they and the tree are stored
+// contiguously, so that neither pushing nor popping chases pointers.
 //
 // In order to be able to add an event to a queue, we also need to maintain the association between
-// a queue and its sorted stream, which is what the map is for. We use the PerfEventOrderedStream as
-// key.
+// a sorted stream and the slot of its queue, which is what the map is for. A slot is released when
+// its queue becomes empty, and reused, together with the queue's buffer, for the next new stream.
 //
 // Some events, though, are known to come out of order even in relation to other events in the same
-// perf_event_open ring buffer (e.g., dma_fence_signaled). For those cases, use an additional single
-// std::priority_queue.
+// perf_event_open ring buffer (e.g., dma_fence_signaled). For those cases, use an additional radix
+// heap, which exploits the fact that these events are almost never older than the last event
+// removed.
 class PerfEventQueue {
  public:
   void PushEvent(PerfEvent&& event);
   [[nodiscard]] bool HasEvent() const;
-  [[nodiscard]] const PerfEvent& TopEvent();
+  [[nodiscard]] PerfEvent& TopEvent();
   void PopEvent();
 
  private:
-  // Floats down the element at the top of the ordered_queues_heap_ to its correct place. Used when
-  // the key of the top element changes, or as part of the process of removing the top element.
-  void MoveDownFrontOfHeapOfQueues();
-  // Floats up an element that it is know should be further up in the heap. Used on insertion.
-  void MoveUpBackOfHeapOfQueues();
-
-  // This vector holds the heap of the queues each of which holds events coming from the same
-  // stream of events already in order by timestamp.
-  std::vector<std::queue<PerfEvent>*> heap_of_queues_of_events_ordered_in_stream_;
-  // This map keeps the association between an ordered stream of events and the ordered queue of
-  // events coming from that stream.
-  absl::flat_hash_map<PerfEventOrderedStream, std::unique_ptr<std::queue<PerfEvent>>>
-      queues_of_events_ordered_in_stream_;
-
-  static constexpr auto kPerfEventReverseTimestampCompare =
-      [](const PerfEvent& lhs, const PerfEvent& rhs) { return lhs.timestamp > rhs.timestamp; };
-  // This priority queue holds all those events that cannot be assumed already sorted in a specific
-  // stream. All such events are simply sorted by the priority queue by increasing timestamp.
-  std::priority_queue<PerfEvent, std::vector<PerfEvent>,
-                      std::function<bool(const PerfEvent&, const PerfEvent&)>>
-      priority_queue_of_events_not_ordered_in_stream_{kPerfEventReverseTimestampCompare};
+  // A FIFO queue of PerfEvents stored in a circular buffer that grows as needed.
+  class EventRingBuffer {
+   public:
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+    [[nodiscard]] PerfEvent& front() { return *events_[front_index_]; }
+    [[nodiscard]] const PerfEvent& back() const {
+      return *events_[(front_index_ + size_ - 1) & (events_.size() - 1)];
+    }
+    void push_back(PerfEvent&& event);
+    void pop_front();
+
+   private:
+    static constexpr size_t kMinCapacity = 16;
+    // Larger buffers are freed when the queue becomes empty, so that a burst of events in one
+    // stream doesn't keep memory allocated for the rest of the capture.
+    static constexpr size_t kMaxRetainedCapacity = 16384;
+
+    // The size is always zero or a power of two.
+    std::vector<std::optional<PerfEvent>> events_;
+    size_t front_index_ = 0;
+    size_t size_ = 0;
+  };
+
+  // A priority queue of PerfEvents that is efficient as long as events are pushed in approximately
+  // increasing order of timestamp, see https://en.wikipedia.org/wiki/Radix_heap. The entries of
+  // bucket i > 0 are those whose timestamp has its highest bit differing from last_timestamp_ at
+  // position i - 1, while bucket 0 holds the entries with timestamp last_timestamp_, the minimum.
+  // Events older than last_timestamp_ are supported, but require rebuilding the whole heap.
+  class EventRadixHeap {
+   public:
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+    // Returns the timestamp of the oldest event, or the maximum uint64_t if there are no events.
+    [[nodiscard]] uint64_t top_timestamp();
+    [[nodiscard]] PerfEvent& top();
+    void push(PerfEvent&& event);
+    void pop();
+
+   private:
+    struct Entry {
+      uint64_t timestamp;
+      uint32_t event_index;
+    };
+
+    [[nodiscard]] size_t ComputeBucketIndex(uint64_t timestamp) const;
+    // Ensures that bucket 0 is not empty, by redistributing the first non-empty bucket.
+    void FillFirstBucket();
+    void Rebuild(uint64_t new_last_timestamp);
+
+    std::array<std::vector<Entry>, 65> buckets_;
+    uint64_t last_timestamp_ = 0;
+    size_t size_ = 0;
+    // The events are not moved when redistributing buckets, only the entries pointing to them.
+    std::vector<std::optional<PerfEvent>> events_;
+    std::vector<uint32_t> free_event_indices_;
+  };
+
+  // A node of the tournament tree, identifying the queue with the oldest event in its subtree.
+  struct TournamentNode {
+    uint64_t timestamp;
+    uint32_t slot;
+  };
+  static constexpr uint32_t kNoSlot = std::numeric_limits<uint32_t>::max();
+  static constexpr TournamentNode kEmptyTournamentNode{std::numeric_limits<uint64_t>::max(),
+                                                       kNoSlot};
+
+  // Returns the node with the older event. Empty nodes lose against any node.
+  [[nodiscard]] static const TournamentNode& PlayMatch(const TournamentNode& left,
+                                                       const TournamentNode& right) {
+    return (right.timestamp < left.timestamp || left.slot == kNoSlot) ? right : left;
+  }
+  [[nodiscard]] uint32_t AllocateSlot();
+  // Replays the tournament from the leaf of `slot` to the root. Used whenever the oldest event in
+  // the queue in `slot` changes.
+  void UpdateTournament(uint32_t slot);
+  [[nodiscard]] bool IsOldestEventNotOrderedInStream();
+
+  // The queues of events coming from the same stream of events already in order by timestamp,
+  // indexed by slot. The number of slots is always zero or a power of two.
+  std::vector<EventRingBuffer> queues_of_events_ordered_in_stream_;
+  // The tournament tree over the slots, stored like a binary heap: node 1 is the root, the
+  // children of node i are nodes 2 * i and 2 * i + 1, and the leaf of slot s is node
+  // queues_of_events_ordered_in_stream_.size() + s.
+  std::vector<TournamentNode> tournament_tree_ =
+      std::vector<TournamentNode>(2, kEmptyTournamentNode);
+  std::vector<uint32_t> free_slots_;
+  // This map keeps the association between an ordered stream of events and the slot of the queue
+  // of events coming from that stream.
+  absl::flat_hash_map<PerfEventOrderedStream, uint32_t> slots_of_ordered_streams_;
+
+  // This radix heap holds all those events that cannot be assumed already sorted in a specific
+  // stream.
+  EventRadixHeap events_not_ordered_in_stream_;
 };
 
 }  // namespace orbit_linux_tracing
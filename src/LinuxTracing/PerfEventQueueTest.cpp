@@ -6,7 +6,10 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <algorithm>
 #include <memory>
+#include <random>
+#include <vector>
 
 #include "PerfEvent.h"
 #include "PerfEventOrderedStream.h"
@@ -419,4 +422,70 @@ TEST(
   EXPECT_NE(top_order, remaining_order);
 }
 
+TEST(PerfEventQueue, NotOrderedEventOlderThanLastPoppedOne) {
+  PerfEventQueue event_queue;
+
+  event_queue.PushEvent(MakeTestEventNotOrdered(1000));
+  event_queue.PushEvent(MakeTestEventNotOrdered(1001));
+  event_queue.PushEvent(MakeTestEventNotOrdered(3000));
+  EXPECT_EQ(event_queue.TopEvent().timestamp, 1000);
+  event_queue.PopEvent();
+
+  event_queue.PushEvent(MakeTestEventNotOrdered(2));
+  event_queue.PushEvent(MakeTestEventNotOrdered(2000));
+  EXPECT_EQ(event_queue.TopEvent().timestamp, 2);
+  event_queue.PopEvent();
+  EXPECT_EQ(event_queue.TopEvent().timestamp, 1001);
+  event_queue.PopEvent();
+  EXPECT_EQ(event_queue.TopEvent().timestamp, 2000);
+  event_queue.PopEvent();
+  EXPECT_EQ(event_queue.TopEvent().timestamp, 3000);
+  event_queue.PopEvent();
+  EXPECT_FALSE(event_queue.HasEvent());
+}
+
+TEST(PerfEventQueue, ManyStreamsComingAndGoing) {
+  constexpr int kStreamCount = 1000;
+  constexpr int kRoundCount = 100;
+  PerfEventQueue event_queue;
+  std::mt19937 random_generator{42};
+  std::uniform_int_distribution<int> stream_distribution{0, kStreamCount};
+  std::uniform_int_distribution<int> event_count_distribution{0, 2 * kStreamCount};
+
+  uint64_t next_timestamp = 1;
+  uint64_t last_popped_timestamp = 0;
+  size_t queued_event_count = 0;
+  for (int round = 0; round < kRoundCount; ++round) {
+    // Push events with increasing timestamps to random streams, so that they are ordered in each
+    // stream. Not-ordered events get timestamps up to 100 in the past.
+    const int push_count = event_count_distribution(random_generator);
+    for (int i = 0; i < push_count; ++i) {
+      const uint64_t timestamp = next_timestamp++;
+      const int stream = stream_distribution(random_generator);
+      if (stream == kStreamCount) {
+        event_queue.PushEvent(MakeTestEventNotOrdered(
+            std::max(last_popped_timestamp, timestamp > 100 ? timestamp - 100 : 0)));
+      } else if (stream % 2 == 0) {
+        event_queue.PushEvent(MakeTestEventOrderedInFd(stream, timestamp));
+      } else {
+        event_queue.PushEvent(MakeTestEventOrderedInTid(stream, timestamp));
+      }
+      ++queued_event_count;
+    }
+
+    size_t pop_count =
+        std::min<size_t>(queued_event_count, event_count_distribution(random_generator));
+    if (round == kRoundCount - 1) pop_count = queued_event_count;
+    for (size_t i = 0; i < pop_count; ++i) {
+      ASSERT_TRUE(event_queue.HasEvent());
+      const uint64_t timestamp = event_queue.TopEvent().timestamp;
+      EXPECT_GE(timestamp, last_popped_timestamp);
+      last_popped_timestamp = timestamp;
+      event_queue.PopEvent();
+      --queued_event_count;
+    }
+  }
+  EXPECT_FALSE(event_queue.HasEvent());
+}
+
 }  // namespace orbit_linux_tracing
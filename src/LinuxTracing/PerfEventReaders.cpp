@@ -43,21 +43,21 @@ struct PerfRecordSample {
 
   // struct read_format v;                 /* if PERF_SAMPLE_READ */
 
-  uint64_t ips_size;               /* if PERF_SAMPLE_CALLCHAIN */
-  std::unique_ptr<uint64_t[]> ips; /* if PERF_SAMPLE_CALLCHAIN */
+  uint64_t ips_size;         /* if PERF_SAMPLE_CALLCHAIN */
+  PooledArray<uint64_t> ips; /* if PERF_SAMPLE_CALLCHAIN */
 
-  uint32_t raw_size;                   /* if PERF_SAMPLE_RAW */
-  std::unique_ptr<uint8_t[]> raw_data; /* if PERF_SAMPLE_RAW */
+  uint32_t raw_size;             /* if PERF_SAMPLE_RAW */
+  PooledArray<uint8_t> raw_data; /* if PERF_SAMPLE_RAW */
 
   // uint64_t bnr;                        /* if PERF_SAMPLE_BRANCH_STACK */
   // struct perf_branch_entry lbr[bnr];   /* if PERF_SAMPLE_BRANCH_STACK */
 
-  uint64_t abi;                     /* if PERF_SAMPLE_REGS_USER */
-  std::unique_ptr<uint64_t[]> regs; /* if PERF_SAMPLE_REGS_USER */
+  uint64_t abi;               /* if PERF_SAMPLE_REGS_USER */
+  PooledArray<uint64_t> regs; /* if PERF_SAMPLE_REGS_USER */
 
-  uint64_t stack_size;                   /* if PERF_SAMPLE_STACK_USER */
-  std::unique_ptr<uint8_t[]> stack_data; /* if PERF_SAMPLE_STACK_USER */
-  uint64_t dyn_size;                     /* if PERF_SAMPLE_STACK_USER && size != 0 */
+  uint64_t stack_size;             /* if PERF_SAMPLE_STACK_USER */
+  PooledArray<uint8_t> stack_data; /* if PERF_SAMPLE_STACK_USER */
+  uint64_t dyn_size;               /* if PERF_SAMPLE_STACK_USER && size != 0 */
 
   // uint64_t weight;                     /* if PERF_SAMPLE_WEIGHT */
   // uint64_t data_src;                   /* if PERF_SAMPLE_DATA_SRC */
@@ -135,7 +135,7 @@ struct PerfRecordSample {
 
     current_offset += sizeof(uint64_t);
     if (copy_stack_related_data) {
-      event.ips = make_unique_for_overwrite<uint64_t[]>(event.ips_size);
+      event.ips = MakePooledArray<uint64_t>(event.ips_size);
       ring_buffer->ReadRawAtOffset(event.ips.get(), current_offset,
                                    event.ips_size * sizeof(uint64_t));
     }
@@ -145,7 +145,7 @@ struct PerfRecordSample {
   if ((flags.sample_type & PERF_SAMPLE_RAW) != 0u) {
     ring_buffer->ReadRawAtOffset(&event.raw_size, current_offset, sizeof(uint32_t));
     current_offset += sizeof(uint32_t);
-    event.raw_data = make_unique_for_overwrite<uint8_t[]>(event.raw_size);
+    event.raw_data = MakePooledArray<uint8_t>(event.raw_size);
     ring_buffer->ReadRawAtOffset(event.raw_data.get(), current_offset,
                                  event.raw_size * sizeof(uint8_t));
     current_offset += event.raw_size * sizeof(uint8_t);
@@ -158,7 +158,7 @@ struct PerfRecordSample {
     if (event.abi != PERF_SAMPLE_REGS_ABI_NONE) {
       const int num_of_regs = std::bitset<64>(flags.sample_regs_user).count();
       if (copy_stack_related_data) {
-        event.regs = make_unique_for_overwrite<uint64_t[]>(num_of_regs);
+        event.regs = MakePooledArray<uint64_t>(num_of_regs);
         ring_buffer->ReadRawAtOffset(event.regs.get(), current_offset,
                                      num_of_regs * sizeof(uint64_t));
       }
@@ -174,7 +174,7 @@ struct PerfRecordSample {
       // we can use it to not copy unnessary parts of the stack.
       ring_buffer->ReadRawAtOffset(
           &event.dyn_size, current_offset + (event.stack_size * sizeof(uint8_t)), sizeof(uint64_t));
-      event.stack_data = make_unique_for_overwrite<uint8_t[]>(event.dyn_size);
+      event.stack_data = MakePooledArray<uint8_t>(event.dyn_size);
       ring_buffer->ReadRawAtOffset(event.stack_data.get(), current_offset,
                                    event.dyn_size * sizeof(uint8_t));
     }
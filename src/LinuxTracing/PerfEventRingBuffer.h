@@ -16,7 +16,8 @@ namespace orbit_linux_tracing {
 
 class PerfEventRingBuffer {
  public:
-  explicit PerfEventRingBuffer(int perf_event_fd, uint64_t size_kb, std::string name);
+  explicit PerfEventRingBuffer(int perf_event_fd, uint64_t size_kb, std::string name,
+                               int32_t cpu);
   ~PerfEventRingBuffer();
 
   PerfEventRingBuffer(PerfEventRingBuffer&&);
@@ -28,6 +29,8 @@ class PerfEventRingBuffer {
   [[nodiscard]] bool IsOpen() const { return ring_buffer_ != nullptr; }
   [[nodiscard]] int GetFileDescriptor() const { return file_descriptor_; }
   [[nodiscard]] const std::string& GetName() const { return name_; }
+  // The cpu the file descriptor was opened on, or -1 if unknown.
+  [[nodiscard]] int32_t GetCpu() const { return cpu_; }
 
   bool HasNewData();
   void ReadHeader(perf_event_header* header);
@@ -58,6 +61,7 @@ class PerfEventRingBuffer {
   uint32_t ring_buffer_size_log2_ = 0;
   int file_descriptor_ = -1;
   std::string name_;
+  int32_t cpu_ = -1;
 
   // ConsumeRawRecord reads header.size bytes into record buffer and then skips the record.
   void ConsumeRawRecord(const perf_event_header& header, void* record);
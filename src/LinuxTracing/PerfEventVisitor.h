@@ -15,13 +15,14 @@ class PerfEventVisitor {
   virtual ~PerfEventVisitor() = default;
   virtual void Visit(uint64_t /*event_timestamp*/, const ForkPerfEventData& /*event_data*/) {}
   virtual void Visit(uint64_t /*event_timestamp*/, const ExitPerfEventData& /*event_data*/) {}
-  virtual void Visit(uint64_t /*event_timestamp*/, const StackSamplePerfEventData& /*event_data*/) {
-  }
+  // The events that own a copy of the stack are passed as non-const, so that a visitor can take
+  // ownership of the stack. Only one visitor must consume them.
+  virtual void Visit(uint64_t /*event_timestamp*/, StackSamplePerfEventData& /*event_data*/) {}
   virtual void Visit(uint64_t /*event_timestamp*/,
                      const CallchainSamplePerfEventData& /*event_data*/) {}
   virtual void Visit(uint64_t /*event_timestamp*/, const UprobesPerfEventData& /*event_data*/) {}
   virtual void Visit(uint64_t /*event_timestamp*/,
-                     const UprobesWithStackPerfEventData& /*event_data*/) {}
+                     UprobesWithStackPerfEventData& /*event_data*/) {}
   virtual void Visit(uint64_t /*event_timestamp*/,
                      const UprobesWithArgumentsPerfEventData& /*event_data*/) {}
   virtual void Visit(uint64_t /*event_timestamp*/, const UretprobesPerfEventData& /*event_data*/) {}
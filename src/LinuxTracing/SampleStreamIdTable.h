@@ -0,0 +1,78 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_SAMPLE_STREAM_ID_TABLE_H_
+#define LINUX_TRACING_SAMPLE_STREAM_ID_TABLE_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+
+#include <cstdint>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_linux_tracing {
+
+// The kind of event that a PERF_RECORD_SAMPLE carries, as determined by its stream id.
+enum class SampleStreamKind : uint8_t {
+  kUnknown = 0,
+  kUprobe,
+  kUprobeWithArgs,
+  kUprobeWithStack,
+  kUretprobe,
+  kUretprobeWithRetval,
+  kStackSample,
+  kCallchainSample,
+  kTaskNewtask,
+  kTaskRename,
+  kSchedSwitch,
+  kSchedWakeup,
+  kSchedSwitchWithCallchain,
+  kSchedWakeupWithCallchain,
+  kSchedSwitchWithStack,
+  kSchedWakeupWithStack,
+  kAmdgpuCsIoctl,
+  kAmdgpuSchedRunJob,
+  kDmaFenceSignaled,
+  kUserInstrumentedTracepoint,
+};
+
+// Maps the stream ids of all perf_event_open events opened for a capture to the kind of
+// PERF_RECORD_SAMPLE they produce. This allows to classify a sample with a single lookup, instead
+// of checking the sets of stream ids of each kind one after the other. The table is filled once
+// when the capture starts and only read afterwards, so concurrent calls to Find are safe.
+class SampleStreamIdTable {
+ public:
+  void Add(uint64_t stream_id, SampleStreamKind kind) {
+    ORBIT_CHECK(kind != SampleStreamKind::kUnknown);
+    // A stream id belongs to exactly one perf_event_open event, hence it has exactly one kind.
+    bool inserted = stream_ids_to_kind_.emplace(stream_id, kind).second;
+    ORBIT_CHECK(inserted);
+  }
+
+  void Add(const absl::flat_hash_set<uint64_t>& stream_ids, SampleStreamKind kind) {
+    for (uint64_t stream_id : stream_ids) {
+      Add(stream_id, kind);
+    }
+  }
+
+  [[nodiscard]] SampleStreamKind Find(uint64_t stream_id) const {
+    auto it = stream_ids_to_kind_.find(stream_id);
+    if (it == stream_ids_to_kind_.end()) {
+      return SampleStreamKind::kUnknown;
+    }
+    return it->second;
+  }
+
+  [[nodiscard]] size_t size() const { return stream_ids_to_kind_.size(); }
+
+  void Clear() { stream_ids_to_kind_.clear(); }
+
+ private:
+  absl::flat_hash_map<uint64_t, SampleStreamKind> stream_ids_to_kind_;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_SAMPLE_STREAM_ID_TABLE_H_
@@ -0,0 +1,63 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_set.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "SampleStreamIdTable.h"
+
+namespace orbit_linux_tracing {
+
+TEST(SampleStreamIdTable, FindReturnsKindOfAddedStreamIds) {
+  SampleStreamIdTable table;
+  table.Add(absl::flat_hash_set<uint64_t>{1, 2, 3}, SampleStreamKind::kStackSample);
+  table.Add(absl::flat_hash_set<uint64_t>{}, SampleStreamKind::kUprobe);
+  table.Add(4, SampleStreamKind::kSchedSwitch);
+  table.Add(absl::flat_hash_set<uint64_t>{5, 6}, SampleStreamKind::kUserInstrumentedTracepoint);
+  EXPECT_EQ(table.size(), 6);
+
+  EXPECT_EQ(table.Find(1), SampleStreamKind::kStackSample);
+  EXPECT_EQ(table.Find(2), SampleStreamKind::kStackSample);
+  EXPECT_EQ(table.Find(3), SampleStreamKind::kStackSample);
+  EXPECT_EQ(table.Find(4), SampleStreamKind::kSchedSwitch);
+  EXPECT_EQ(table.Find(5), SampleStreamKind::kUserInstrumentedTracepoint);
+  EXPECT_EQ(table.Find(6), SampleStreamKind::kUserInstrumentedTracepoint);
+}
+
+TEST(SampleStreamIdTable, FindReturnsUnknownForMissingStreamIds) {
+  SampleStreamIdTable table;
+  EXPECT_EQ(table.Find(0), SampleStreamKind::kUnknown);
+  EXPECT_EQ(table.Find(1), SampleStreamKind::kUnknown);
+
+  table.Add(1, SampleStreamKind::kUretprobe);
+  EXPECT_EQ(table.Find(0), SampleStreamKind::kUnknown);
+  EXPECT_EQ(table.Find(2), SampleStreamKind::kUnknown);
+}
+
+TEST(SampleStreamIdTable, Clear) {
+  SampleStreamIdTable table;
+  table.Add(1, SampleStreamKind::kUretprobe);
+  table.Clear();
+  EXPECT_EQ(table.size(), 0);
+  EXPECT_EQ(table.Find(1), SampleStreamKind::kUnknown);
+
+  table.Add(1, SampleStreamKind::kUprobe);
+  EXPECT_EQ(table.Find(1), SampleStreamKind::kUprobe);
+}
+
+TEST(SampleStreamIdTableDeathTest, AddingStreamIdTwiceCrashes) {
+  SampleStreamIdTable table;
+  table.Add(1, SampleStreamKind::kUretprobe);
+  EXPECT_DEATH(table.Add(1, SampleStreamKind::kUprobe), "Check failed");
+  EXPECT_DEATH(table.Add(1, SampleStreamKind::kUretprobe), "Check failed");
+}
+
+TEST(SampleStreamIdTableDeathTest, AddingUnknownKindCrashes) {
+  SampleStreamIdTable table;
+  EXPECT_DEATH(table.Add(1, SampleStreamKind::kUnknown), "Check failed");
+}
+
+}  // namespace orbit_linux_tracing
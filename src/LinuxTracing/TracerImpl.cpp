@@ -13,9 +13,11 @@
 #include <absl/synchronization/mutex.h>
 #include <absl/types/span.h>
 #include <string.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <cstdint>
 #include <limits>
 #include <string>
@@ -29,6 +31,7 @@
 #include "GrpcProtos/tracepoint.pb.h"
 #include "Introspection/Introspection.h"
 #include "KernelTracepoints.h"
+#include "LibunwindstackElfCache.h"
 #include "LibunwindstackMaps.h"
 #include "LibunwindstackUnwinder.h"
 #include "LinuxTracing/TracerListener.h"
@@ -38,7 +41,9 @@
 #include "OrbitBase/GetProcessIds.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/SafeStrerror.h"
 #include "OrbitBase/ThreadUtils.h"
+#include "PerfEventBufferPool.h"
 #include "PerfEventOpen.h"
 #include "PerfEventOrderedStream.h"
 #include "PerfEventReaders.h"
@@ -72,6 +77,9 @@ TracerImpl::TracerImpl(
     : trace_context_switches_{capture_options.trace_context_switches()},
       introspection_enabled_{capture_options.enable_introspection()},
       target_pid_{orbit_base::ToNativeProcessId(capture_options.pid())},
+      ring_buffer_reader_thread_count_{capture_options.ring_buffer_reader_thread_count()},
+      ring_buffer_wait_method_{capture_options.ring_buffer_wait_method()},
+      unwinding_thread_count_{capture_options.unwinding_thread_count()},
       unwinding_method_{capture_options.unwinding_method()},
       trace_thread_state_{capture_options.trace_thread_state()},
       trace_gpu_driver_{capture_options.trace_gpu_driver()},
@@ -213,7 +221,7 @@ static void OpenRingBuffersOrRedirectOnExisting(
       // Create a ring buffer for this cpu.
       int ring_buffer_fd = fd;
       std::string buffer_name = absl::StrFormat("%s_%d", buffer_name_prefix, cpu);
-      ring_buffers->emplace_back(ring_buffer_fd, ring_buffer_size_kb, buffer_name);
+      ring_buffers->emplace_back(ring_buffer_fd, ring_buffer_size_kb, buffer_name, cpu);
       ring_buffer_fds_per_cpu->emplace(cpu, ring_buffer_fd);
     }
   }
@@ -225,7 +233,14 @@ void TracerImpl::InitUprobesEventVisitor() {
   if (maps.has_error()) {
     ORBIT_ERROR("%s", maps.error().message());
   }
-  maps_ = LibunwindstackMaps::ParseMaps(maps.has_value() ? maps.value() : "");
+  LibunwindstackElfCache& elf_cache = LibunwindstackElfCache::GetInstance();
+  maps_ = LibunwindstackMaps::ParseMaps(maps.has_value() ? maps.value() : "", &elf_cache);
+  LibunwindstackElfCache::Stats elf_cache_stats = elf_cache.GetStats();
+  ORBIT_LOG(
+      "Elf cache: %lu files (%.1f MB); hits: %lu, misses: %lu, evictions: %lu since OrbitService "
+      "started",
+      elf_cache_stats.entry_count, elf_cache_stats.size_bytes / (1024.0 * 1024.0),
+      elf_cache_stats.hit_count, elf_cache_stats.miss_count, elf_cache_stats.eviction_count);
 
   unwinder_ =
       LibunwindstackUnwinder::Create(&absolute_address_to_size_of_functions_to_stop_unwinding_at_);
@@ -238,21 +253,27 @@ void TracerImpl::InitUprobesEventVisitor() {
       &absolute_address_to_size_of_functions_to_stop_unwinding_at_);
   uprobes_unwinding_visitor_->SetUnwindErrorsAndDiscardedSamplesCounters(
       &stats_.unwind_error_count, &stats_.samples_in_uretprobes_count);
+  if (unwinding_method_ == CaptureOptions::kDwarf) {
+    // More workers than cores would only compete with the threads reading and processing events.
+    uprobes_unwinding_visitor_->SetUnwindingThreadCount(std::min(
+        unwinding_thread_count_, static_cast<uint32_t>(std::thread::hardware_concurrency())));
+  }
   event_processor_.AddVisitor(uprobes_unwinding_visitor_.get());
 }
 
 bool TracerImpl::OpenUprobes(const orbit_grpc_protos::InstrumentedFunction& function,
                              absl::Span<const int32_t> cpus,
-                             absl::flat_hash_map<int32_t, int>* fds_per_cpu) {
+                             absl::flat_hash_map<int32_t, int>* fds_per_cpu) const {
   ORBIT_SCOPE_FUNCTION;
   const char* module = function.file_path().c_str();
   const uint64_t offset = function.file_offset();
   for (int32_t cpu : cpus) {
     int fd{};
     if (function.record_arguments()) {
-      fd = uprobes_retaddr_args_event_open(module, offset, /*pid=*/-1, cpu);
+      fd = uprobes_retaddr_args_event_open(module, offset, /*pid=*/-1, cpu,
+                                           UseWakeupWatermark());
     } else {
-      fd = uprobes_retaddr_event_open(module, offset, /*pid=*/-1, cpu);
+      fd = uprobes_retaddr_event_open(module, offset, /*pid=*/-1, cpu, UseWakeupWatermark());
     }
     if (fd < 0) {
       ORBIT_ERROR("Opening uprobe %s+%#x on cpu %d", function.file_path(), function.file_offset(),
@@ -266,16 +287,16 @@ bool TracerImpl::OpenUprobes(const orbit_grpc_protos::InstrumentedFunction& func
 
 bool TracerImpl::OpenUretprobes(const orbit_grpc_protos::InstrumentedFunction& function,
                                 absl::Span<const int32_t> cpus,
-                                absl::flat_hash_map<int32_t, int>* fds_per_cpu) {
+                                absl::flat_hash_map<int32_t, int>* fds_per_cpu) const {
   ORBIT_SCOPE_FUNCTION;
   const char* module = function.file_path().c_str();
   const uint64_t offset = function.file_offset();
   for (int32_t cpu : cpus) {
     int fd{};
     if (function.record_return_value()) {
-      fd = uretprobes_retval_event_open(module, offset, /*pid=*/-1, cpu);
+      fd = uretprobes_retval_event_open(module, offset, /*pid=*/-1, cpu, UseWakeupWatermark());
     } else {
-      fd = uretprobes_event_open(module, offset, /*pid=*/-1, cpu);
+      fd = uretprobes_event_open(module, offset, /*pid=*/-1, cpu, UseWakeupWatermark());
     }
     if (fd < 0) {
       ORBIT_ERROR("Opening uretprobe %s+%#x on cpu %d", function.file_path(),
@@ -360,8 +381,8 @@ bool TracerImpl::OpenUprobesWithStack(
   const char* module = function.file_path().c_str();
   const uint64_t offset = function.file_offset();
   for (int32_t cpu : cpus) {
-    int fd =
-        uprobes_with_stack_and_sp_event_open(module, offset, /*pid=*/-1, cpu, stack_dump_size_);
+    int fd = uprobes_with_stack_and_sp_event_open(module, offset, /*pid=*/-1, cpu, stack_dump_size_,
+                                                  UseWakeupWatermark());
     if (fd < 0) {
       ORBIT_ERROR("Opening uprobe %s+%#x with stack on cpu %d", function.file_path(),
                   function.file_offset(), cpu);
@@ -404,9 +425,10 @@ bool TracerImpl::OpenMmapTask(absl::Span<const int32_t> cpus) {
   std::vector<int> mmap_task_tracing_fds;
   std::vector<PerfEventRingBuffer> mmap_task_ring_buffers;
   for (int32_t cpu : cpus) {
-    int mmap_task_fd = mmap_task_event_open(-1, cpu);
+    int mmap_task_fd = mmap_task_event_open(-1, cpu, UseWakeupWatermark());
     std::string buffer_name = absl::StrFormat("mmap_task_%d", cpu);
-    PerfEventRingBuffer mmap_task_ring_buffer{mmap_task_fd, kMmapTaskRingBufferSizeKb, buffer_name};
+    PerfEventRingBuffer mmap_task_ring_buffer{mmap_task_fd, kMmapTaskRingBufferSizeKb, buffer_name,
+                                              cpu};
     if (mmap_task_ring_buffer.IsOpen()) {
       mmap_task_tracing_fds.push_back(mmap_task_fd);
       mmap_task_ring_buffers.push_back(std::move(mmap_task_ring_buffer));
@@ -438,12 +460,12 @@ bool TracerImpl::OpenSampling(absl::Span<const int32_t> cpus) {
     int sampling_fd{};
     switch (unwinding_method_) {
       case CaptureOptions::kFramePointers:
-        sampling_fd =
-            callchain_sample_event_open(sampling_period_ns_.value(), -1, cpu, stack_dump_size_);
+        sampling_fd = callchain_sample_event_open(sampling_period_ns_.value(), -1, cpu,
+                                                  stack_dump_size_, UseWakeupWatermark());
         break;
       case CaptureOptions::kDwarf:
-        sampling_fd =
-            stack_sample_event_open(sampling_period_ns_.value(), -1, cpu, stack_dump_size_);
+        sampling_fd = stack_sample_event_open(sampling_period_ns_.value(), -1, cpu,
+                                              stack_dump_size_, UseWakeupWatermark());
         break;
       case CaptureOptions::kUndefined:
       default:
@@ -453,7 +475,8 @@ bool TracerImpl::OpenSampling(absl::Span<const int32_t> cpus) {
     }
 
     std::string buffer_name = absl::StrFormat("sampling_%d", cpu);
-    PerfEventRingBuffer sampling_ring_buffer{sampling_fd, kSamplingRingBufferSizeKb, buffer_name};
+    PerfEventRingBuffer sampling_ring_buffer{sampling_fd, kSamplingRingBufferSizeKb, buffer_name,
+                                             cpu};
     if (sampling_ring_buffer.IsOpen()) {
       sampling_tracing_fds.push_back(sampling_fd);
       sampling_ring_buffers.push_back(std::move(sampling_ring_buffer));
@@ -499,7 +522,8 @@ static bool OpenFileDescriptorsAndRingBuffersForAllTracepoints(
     absl::Span<const TracepointToOpen> tracepoints_to_open, absl::Span<const int32_t> cpus,
     std::vector<int>* tracing_fds, uint64_t ring_buffer_size_kb,
     absl::flat_hash_map<int32_t, int>* tracepoint_ring_buffer_fds_per_cpu_for_redirection,
-    std::vector<PerfEventRingBuffer>* ring_buffers, uint32_t stack_dump_size = 0,
+    std::vector<PerfEventRingBuffer>* ring_buffers, bool use_wakeup_watermark,
+    uint32_t stack_dump_size = 0,
     const CaptureOptions::ThreadStateChangeCallStackCollection
         thread_state_change_callstack_collection =
             CaptureOptions::kNoThreadStateChangeCallStackCollection,
@@ -518,13 +542,16 @@ static bool OpenFileDescriptorsAndRingBuffersForAllTracepoints(
               CaptureOptions::kThreadStateChangeCallStackCollection &&
           unwinding_method == CaptureOptions::kFramePointers) {
         tracepoint_fd = tracepoint_with_callchain_event_open(tracepoint_category, tracepoint_name,
-                                                             -1, cpu, stack_dump_size);
+                                                             -1, cpu, stack_dump_size,
+                                                             use_wakeup_watermark);
       } else if (thread_state_change_callstack_collection ==
                  CaptureOptions::kThreadStateChangeCallStackCollection) {
         tracepoint_fd = tracepoint_with_stack_event_open(tracepoint_category, tracepoint_name, -1,
-                                                         cpu, stack_dump_size);
+                                                         cpu, stack_dump_size,
+                                                         use_wakeup_watermark);
       } else {
-        tracepoint_fd = tracepoint_event_open(tracepoint_category, tracepoint_name, -1, cpu);
+        tracepoint_fd = tracepoint_event_open(tracepoint_category, tracepoint_name, -1, cpu,
+                                              use_wakeup_watermark);
       }
       if (tracepoint_fd == -1) {
         ORBIT_ERROR("Opening %s:%s tracepoint for cpu %d", tracepoint_category, tracepoint_name,
@@ -579,7 +606,7 @@ bool TracerImpl::OpenThreadNameTracepoints(absl::Span<const int32_t> cpus) {
   return OpenFileDescriptorsAndRingBuffersForAllTracepoints(
       {{"task", "task_newtask", &task_newtask_ids_}, {"task", "task_rename", &task_rename_ids_}},
       cpus, &tracing_fds_, kThreadNamesRingBufferSizeKb,
-      &thread_name_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
+      &thread_name_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_, UseWakeupWatermark());
 }
 
 void TracerImpl::InitSwitchesStatesNamesVisitor() {
@@ -636,7 +663,7 @@ bool TracerImpl::OpenContextSwitchAndThreadStateTracepoints(absl::Span<const int
   }
   return OpenFileDescriptorsAndRingBuffersForAllTracepoints(
       tracepoints_to_open, cpus, &tracing_fds_, ring_buffer_size,
-      &thread_state_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_,
+      &thread_state_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_, UseWakeupWatermark(),
       thread_state_change_callstack_stack_dump_size_, thread_state_change_callstack_collection_,
       unwinding_method_);
 }
@@ -667,7 +694,7 @@ bool TracerImpl::OpenGpuTracepoints(absl::Span<const int32_t> cpus) {
        {"amdgpu", "amdgpu_sched_run_job", &amdgpu_sched_run_job_ids_},
        {"dma_fence", "dma_fence_signaled", &dma_fence_signaled_ids_}},
       cpus, &tracing_fds_, kGpuTracingRingBufferSizeKb, &gpu_tracepoint_ring_buffer_fds_per_cpu,
-      &ring_buffers_);
+      &ring_buffers_, UseWakeupWatermark());
 }
 
 bool TracerImpl::OpenInstrumentedTracepoints(absl::Span<const int32_t> cpus) {
@@ -680,7 +707,7 @@ bool TracerImpl::OpenInstrumentedTracepoints(absl::Span<const int32_t> cpus) {
     tracepoint_event_open_errors |= !OpenFileDescriptorsAndRingBuffersForAllTracepoints(
         {{selected_tracepoint.category().c_str(), selected_tracepoint.name().c_str(), &stream_ids}},
         cpus, &tracing_fds_, kInstrumentedTracepointsRingBufferSizeKb,
-        &tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
+        &tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_, UseWakeupWatermark());
 
     for (const auto& stream_id : stream_ids) {
       ids_to_tracepoint_info_.emplace(stream_id, selected_tracepoint);
@@ -840,6 +867,8 @@ void TracerImpl::Startup() {
     listener_->OnErrorsWithPerfEventOpenEvent(std::move(errors_with_perf_event_open_event));
   }
 
+  BuildSampleStreamIdTable();
+
   // Start recording events.
   for (int fd : tracing_fds_) {
     perf_event_enable(fd);
@@ -896,9 +925,98 @@ void TracerImpl::Startup() {
     RetrieveInitialThreadStatesOfTarget();
   }
 
+  CreateRingBufferReaders(number_of_cores);
+
+  PerfEventBufferPool::GetInstance().ResetHighWaterMark();
   stats_.Reset();
 }
 
+void TracerImpl::BuildSampleStreamIdTable() {
+  sample_stream_id_table_.Add(uprobes_ids_, SampleStreamKind::kUprobe);
+  sample_stream_id_table_.Add(uprobes_with_args_ids_, SampleStreamKind::kUprobeWithArgs);
+  sample_stream_id_table_.Add(uprobes_with_stack_ids_, SampleStreamKind::kUprobeWithStack);
+  sample_stream_id_table_.Add(uretprobes_ids_, SampleStreamKind::kUretprobe);
+  sample_stream_id_table_.Add(uretprobes_with_retval_ids_, SampleStreamKind::kUretprobeWithRetval);
+  sample_stream_id_table_.Add(stack_sampling_ids_, SampleStreamKind::kStackSample);
+  sample_stream_id_table_.Add(callchain_sampling_ids_, SampleStreamKind::kCallchainSample);
+  sample_stream_id_table_.Add(task_newtask_ids_, SampleStreamKind::kTaskNewtask);
+  sample_stream_id_table_.Add(task_rename_ids_, SampleStreamKind::kTaskRename);
+  sample_stream_id_table_.Add(sched_switch_ids_, SampleStreamKind::kSchedSwitch);
+  sample_stream_id_table_.Add(sched_wakeup_ids_, SampleStreamKind::kSchedWakeup);
+  sample_stream_id_table_.Add(sched_switch_with_callchain_ids_,
+                              SampleStreamKind::kSchedSwitchWithCallchain);
+  sample_stream_id_table_.Add(sched_wakeup_with_callchain_ids_,
+                              SampleStreamKind::kSchedWakeupWithCallchain);
+  sample_stream_id_table_.Add(sched_switch_with_stack_ids_,
+                              SampleStreamKind::kSchedSwitchWithStack);
+  sample_stream_id_table_.Add(sched_wakeup_with_stack_ids_,
+                              SampleStreamKind::kSchedWakeupWithStack);
+  sample_stream_id_table_.Add(amdgpu_cs_ioctl_ids_, SampleStreamKind::kAmdgpuCsIoctl);
+  sample_stream_id_table_.Add(amdgpu_sched_run_job_ids_, SampleStreamKind::kAmdgpuSchedRunJob);
+  sample_stream_id_table_.Add(dma_fence_signaled_ids_, SampleStreamKind::kDmaFenceSignaled);
+  for (const auto& [stream_id, unused_tracepoint_info] : ids_to_tracepoint_info_) {
+    sample_stream_id_table_.Add(stream_id, SampleStreamKind::kUserInstrumentedTracepoint);
+  }
+}
+
+void TracerImpl::CreateRingBufferReaders(int32_t number_of_cores) {
+  ORBIT_SCOPE_FUNCTION;
+  ORBIT_CHECK(number_of_cores > 0);
+  const uint32_t reader_count = std::clamp<uint32_t>(ring_buffer_reader_thread_count_, 1,
+                                                     static_cast<uint32_t>(number_of_cores));
+  for (uint32_t reader_index = 0; reader_index < reader_count; ++reader_index) {
+    ring_buffer_readers_.push_back(std::make_unique<RingBufferReader>(reader_index));
+  }
+
+  // Assign each reader a group of contiguous cpus. These usually share the same NUMA node and
+  // last-level cache. Ring buffers that are not associated with a cpu all go to the first reader.
+  for (PerfEventRingBuffer& ring_buffer : ring_buffers_) {
+    uint32_t reader_index = 0;
+    if (ring_buffer.GetCpu() >= 0) {
+      reader_index = std::min(static_cast<uint32_t>(static_cast<uint64_t>(ring_buffer.GetCpu()) *
+                                                    reader_count / number_of_cores),
+                              reader_count - 1);
+    }
+    ring_buffer_readers_[reader_index]->ring_buffers.push_back(&ring_buffer);
+  }
+
+  if (reader_count > 1) {
+    ORBIT_LOG("Reading %u ring buffers with %u threads", ring_buffers_.size(), reader_count);
+  }
+
+  if (ring_buffer_wait_method_ != CaptureOptions::kEpoll) {
+    return;
+  }
+  for (std::unique_ptr<RingBufferReader>& reader : ring_buffer_readers_) {
+    reader->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (reader->epoll_fd < 0) {
+      ORBIT_ERROR("epoll_create1: %s", SafeStrerror(errno));
+      continue;
+    }
+    for (PerfEventRingBuffer* ring_buffer : reader->ring_buffers) {
+      epoll_event event{};
+      event.events = EPOLLIN;
+      event.data.ptr = ring_buffer;
+      if (epoll_ctl(reader->epoll_fd, EPOLL_CTL_ADD, ring_buffer->GetFileDescriptor(), &event) !=
+          0) {
+        // Fall back to sleeping for this reader, as otherwise we might not be woken up for this
+        // ring buffer other than on timeout.
+        ORBIT_ERROR("epoll_ctl on ring buffer '%s': %s", ring_buffer->GetName(),
+                    SafeStrerror(errno));
+        close(reader->epoll_fd);
+        reader->epoll_fd = -1;
+        break;
+      }
+    }
+  }
+}
+
+TracerImpl::RingBufferReader::~RingBufferReader() {
+  if (epoll_fd >= 0) {
+    close(epoll_fd);
+  }
+}
+
 void TracerImpl::Shutdown() {
   ORBIT_SCOPE_FUNCTION;
   if (trace_thread_state_) {
@@ -913,6 +1031,7 @@ void TracerImpl::Shutdown() {
   // Close the ring buffers.
   {
     ORBIT_SCOPE("ring_buffers_.clear()");
+    ring_buffer_readers_.clear();
     ring_buffers_.clear();
   }
 
@@ -927,9 +1046,12 @@ void TracerImpl::Shutdown() {
       close(fd);
     }
   }
+
+  // All events have been processed, don't hold on to the memory for their buffers between captures.
+  PerfEventBufferPool::GetInstance().Trim();
 }
 
-void TracerImpl::ProcessOneRecord(PerfEventRingBuffer* ring_buffer) {
+void TracerImpl::ProcessOneRecord(PerfEventRingBuffer* ring_buffer, RingBufferReader* reader) {
   uint64_t event_timestamp_ns = 0;
 
   perf_event_header header;
@@ -947,19 +1069,19 @@ void TracerImpl::ProcessOneRecord(PerfEventRingBuffer* ring_buffer) {
                   ring_buffer->GetName());
       break;
     case PERF_RECORD_FORK:
-      event_timestamp_ns = ProcessForkEventAndReturnTimestamp(header, ring_buffer);
+      event_timestamp_ns = ProcessForkEventAndReturnTimestamp(header, ring_buffer, reader);
       break;
     case PERF_RECORD_EXIT:
-      event_timestamp_ns = ProcessExitEventAndReturnTimestamp(header, ring_buffer);
+      event_timestamp_ns = ProcessExitEventAndReturnTimestamp(header, ring_buffer, reader);
       break;
     case PERF_RECORD_MMAP:
-      event_timestamp_ns = ProcessMmapEventAndReturnTimestamp(header, ring_buffer);
+      event_timestamp_ns = ProcessMmapEventAndReturnTimestamp(header, ring_buffer, reader);
       break;
     case PERF_RECORD_SAMPLE:
-      event_timestamp_ns = ProcessSampleEventAndReturnTimestamp(header, ring_buffer);
+      event_timestamp_ns = ProcessSampleEventAndReturnTimestamp(header, ring_buffer, reader);
       break;
     case PERF_RECORD_LOST:
-      event_timestamp_ns = ProcessLostEventAndReturnTimestamp(header, ring_buffer);
+      event_timestamp_ns = ProcessLostEventAndReturnTimestamp(header, ring_buffer, reader);
       break;
     case PERF_RECORD_THROTTLE:
     case PERF_RECORD_UNTHROTTLE:
@@ -973,8 +1095,8 @@ void TracerImpl::ProcessOneRecord(PerfEventRingBuffer* ring_buffer) {
   }
 
   if (event_timestamp_ns != 0) {
-    fds_to_last_timestamp_ns_.insert_or_assign(ring_buffer->GetFileDescriptor(),
-                                               event_timestamp_ns);
+    reader->fds_to_last_timestamp_ns.insert_or_assign(ring_buffer->GetFileDescriptor(),
+                                                      event_timestamp_ns);
   }
 }
 
@@ -983,63 +1105,154 @@ void TracerImpl::Run() {
 
   Startup();
 
-  bool last_iteration_saw_events = false;
   std::thread deferred_events_thread(&TracerImpl::ProcessDeferredEvents, this);
 
+  if (ring_buffer_readers_.size() == 1) {
+    RunRingBufferReader(ring_buffer_readers_[0].get());
+  } else {
+    std::vector<std::thread> reader_threads;
+    reader_threads.reserve(ring_buffer_readers_.size());
+    for (std::unique_ptr<RingBufferReader>& reader : ring_buffer_readers_) {
+      reader_threads.emplace_back(&TracerImpl::RunRingBufferReader, this, reader.get());
+    }
+
+    while (!stop_run_thread_) {
+      // Periodically print event statistics, including the ones of each reader.
+      PrintStatsIfTimerElapsed();
+      usleep(kIdleTimeOnEmptyRingBuffersUs);
+    }
+
+    for (std::thread& reader_thread : reader_threads) {
+      reader_thread.join();
+    }
+  }
+
+  // Finish processing all deferred events.
+  stop_deferred_thread_ = true;
+  deferred_events_thread.join();
+  event_processor_.ProcessAllEvents();
+  uprobes_unwinding_visitor_->SendAllPendingOutputs();
+
+  Shutdown();
+}
+
+void TracerImpl::RunRingBufferReader(RingBufferReader* reader) {
+  if (ring_buffer_readers_.size() > 1) {
+    orbit_base::SetCurrentThreadName(absl::StrFormat("Tracer::Read%u", reader->index).c_str());
+  }
+
+  bool last_iteration_saw_events = false;
   while (!stop_run_thread_) {
     ORBIT_SCOPE("TracerThread::Run iteration");
 
     if (!last_iteration_saw_events) {
-      // Periodically print event statistics.
-      PrintStatsIfTimerElapsed();
-
-      // Sleep if there was no new event in the last iteration so that we are
-      // not constantly polling. Don't sleep so long that ring buffers overflow.
-      {
-        ORBIT_SCOPE("Sleep");
-        usleep(kIdleTimeOnEmptyRingBuffersUs);
+      // With a single reader, the reader is the Run thread itself, which is also in charge of
+      // periodically printing event statistics.
+      if (ring_buffer_readers_.size() == 1) {
+        PrintStatsIfTimerElapsed();
       }
+
+      WaitForNewDataInRingBuffers(reader);
     }
 
-    last_iteration_saw_events = false;
+    last_iteration_saw_events = ReadRingBuffersOnce(reader);
+  }
+}
+
+void TracerImpl::WaitForNewDataInRingBuffers(RingBufferReader* reader) {
+  ++reader->wait_count;
+
+  if (reader->epoll_fd >= 0) {
+    ORBIT_SCOPE("epoll_wait");
+    // We read all ring buffers of the reader after waking up, so we don't need to know which file
+    // descriptors are ready.
+    epoll_event event{};
+    int ret = epoll_wait(reader->epoll_fd, &event, 1, kMaxWaitForNewDataInRingBuffersMs);
+    if (ret >= 0 || errno == EINTR) {
+      return;
+    }
+    ORBIT_ERROR("epoll_wait: %s", SafeStrerror(errno));
+  }
+
+  // Sleep if there was no new event in the last iteration so that we are
+  // not constantly polling. Don't sleep so long that ring buffers overflow.
+  ORBIT_SCOPE("Sleep");
+  usleep(kIdleTimeOnEmptyRingBuffersUs);
+}
 
-    // Read and process events from all ring buffers. In order to ensure that no
-    // buffer is read constantly while others overflow, we schedule the reading
-    // using round-robin like scheduling.
-    for (PerfEventRingBuffer& ring_buffer : ring_buffers_) {
+bool TracerImpl::ReadRingBuffersOnce(RingBufferReader* reader) {
+  bool saw_events = false;
+  uint64_t record_count = 0;
+  // A ring buffer found empty during this pass won't produce events older than the beginning of the
+  // pass, while for one that still has data, we only know that it has reached its last timestamp.
+  const uint64_t pass_begin_timestamp_ns = orbit_base::CaptureTimestampNs();
+  uint64_t low_watermark_ns = pass_begin_timestamp_ns;
+
+  // Read and process events from all ring buffers of this reader. In order to ensure that no
+  // buffer is read constantly while others overflow, we schedule the reading
+  // using round-robin like scheduling.
+  for (PerfEventRingBuffer* ring_buffer : reader->ring_buffers) {
+    if (stop_run_thread_) {
+      break;
+    }
+
+    // Read up to ROUND_ROBIN_POLLING_BATCH_SIZE (5) new events.
+    // TODO: Some event types (e.g., stack samples) have a much longer
+    //  processing time but are less frequent than others (e.g., context
+    //  switches). Take this into account in our scheduling algorithm.
+    bool has_new_data = true;
+    for (int32_t read_from_this_buffer = 0; read_from_this_buffer < kRoundRobinPollingBatchSize;
+         ++read_from_this_buffer) {
       if (stop_run_thread_) {
         break;
       }
+      if (!ring_buffer->HasNewData()) {
+        has_new_data = false;
+        break;
+      }
+
+      saw_events = true;
+      ProcessOneRecord(ring_buffer, reader);
+      ++record_count;
+    }
 
-      // Read up to ROUND_ROBIN_POLLING_BATCH_SIZE (5) new events.
-      // TODO: Some event types (e.g., stack samples) have a much longer
-      //  processing time but are less frequent than others (e.g., context
-      //  switches). Take this into account in our scheduling algorithm.
-      for (int32_t read_from_this_buffer = 0; read_from_this_buffer < kRoundRobinPollingBatchSize;
-           ++read_from_this_buffer) {
-        if (stop_run_thread_) {
-          break;
-        }
-        if (!ring_buffer.HasNewData()) {
-          break;
-        }
-
-        last_iteration_saw_events = true;
-        ProcessOneRecord(&ring_buffer);
+    if (has_new_data) {
+      uint64_t last_timestamp_ns = 0;
+      if (auto it = reader->fds_to_last_timestamp_ns.find(ring_buffer->GetFileDescriptor());
+          it != reader->fds_to_last_timestamp_ns.end()) {
+        last_timestamp_ns = it->second;
       }
+      low_watermark_ns = std::min(low_watermark_ns, last_timestamp_ns);
     }
   }
 
-  // Finish processing all deferred events.
-  stop_deferred_thread_ = true;
-  deferred_events_thread.join();
-  event_processor_.ProcessAllEvents();
+  reader->record_count += record_count;
+  FlushDeferredEventsBatch(reader);
+  reader->low_watermark_ns = low_watermark_ns;
+  return saw_events;
+}
 
-  Shutdown();
+void TracerImpl::FlushDeferredEventsBatch(RingBufferReader* reader) {
+  if (reader->deferred_events_batch.empty()) {
+    return;
+  }
+
+  reader->deferred_event_count += reader->deferred_events_batch.size();
+  {
+    absl::MutexLock lock{&deferred_events_being_buffered_mutex_};
+    deferred_events_being_buffered_.insert(
+        deferred_events_being_buffered_.end(),
+        std::make_move_iterator(reader->deferred_events_batch.begin()),
+        std::make_move_iterator(reader->deferred_events_batch.end()));
+  }
+  // As for deferred_events_to_process_, clear() leaves the capacity unchanged, so that the batch
+  // doesn't need to be grown again.
+  reader->deferred_events_batch.clear();
 }
 
 uint64_t TracerImpl::ProcessForkEventAndReturnTimestamp(const perf_event_header& header,
-                                                        PerfEventRingBuffer* ring_buffer) {
+                                                        PerfEventRingBuffer* ring_buffer,
+                                                        RingBufferReader* reader) {
   RingBufferForkExit ring_buffer_record;
   ring_buffer->ConsumeRecord(header, &ring_buffer_record);
   ForkPerfEvent event{
@@ -1056,12 +1269,13 @@ uint64_t TracerImpl::ProcessForkEventAndReturnTimestamp(const perf_event_header&
     return event.timestamp;
   }
 
-  DeferEvent(event);
+  reader->DeferEvent(event);
   return event.timestamp;
 }
 
 uint64_t TracerImpl::ProcessExitEventAndReturnTimestamp(const perf_event_header& header,
-                                                        PerfEventRingBuffer* ring_buffer) {
+                                                        PerfEventRingBuffer* ring_buffer,
+                                                        RingBufferReader* reader) {
   RingBufferForkExit ring_buffer_record;
   ring_buffer->ConsumeRecord(header, &ring_buffer_record);
   ExitPerfEvent event{
@@ -1078,12 +1292,13 @@ uint64_t TracerImpl::ProcessExitEventAndReturnTimestamp(const perf_event_header&
     return event.timestamp;
   }
 
-  DeferEvent(event);
+  reader->DeferEvent(event);
   return event.timestamp;
 }
 
 uint64_t TracerImpl::ProcessMmapEventAndReturnTimestamp(const perf_event_header& header,
-                                                        PerfEventRingBuffer* ring_buffer) {
+                                                        PerfEventRingBuffer* ring_buffer,
+                                                        RingBufferReader* reader) {
   MmapPerfEvent event = ConsumeMmapPerfEvent(ring_buffer, header);
   const uint64_t timestamp_ns = event.timestamp;
 
@@ -1095,14 +1310,15 @@ uint64_t TracerImpl::ProcessMmapEventAndReturnTimestamp(const perf_event_header&
     return timestamp_ns;
   }
 
-  DeferEvent(std::move(event));
+  reader->DeferEvent(std::move(event));
   ++stats_.mmap_count;
 
   return timestamp_ns;
 }
 
 uint64_t TracerImpl::ProcessSampleEventAndReturnTimestamp(const perf_event_header& header,
-                                                          PerfEventRingBuffer* ring_buffer) {
+                                                          PerfEventRingBuffer* ring_buffer,
+                                                          RingBufferReader* reader) {
   uint64_t timestamp_ns = ReadSampleRecordTime(ring_buffer);
 
   if (timestamp_ns < effective_capture_start_timestamp_ns_) {
@@ -1112,352 +1328,354 @@ uint64_t TracerImpl::ProcessSampleEventAndReturnTimestamp(const perf_event_heade
   }
 
   uint64_t stream_id = ReadSampleRecordStreamId(ring_buffer);
-  bool is_uprobe = uprobes_ids_.contains(stream_id);
-  bool is_uprobe_with_args = uprobes_with_args_ids_.contains(stream_id);
-  bool is_uprobe_with_stack = uprobes_with_stack_ids_.contains(stream_id);
-  bool is_uretprobe = uretprobes_ids_.contains(stream_id);
-  bool is_uretprobe_with_retval = uretprobes_with_retval_ids_.contains(stream_id);
-  bool is_stack_sample = stack_sampling_ids_.contains(stream_id);
-  bool is_callchain_sample = callchain_sampling_ids_.contains(stream_id);
-  bool is_task_newtask = task_newtask_ids_.contains(stream_id);
-  bool is_task_rename = task_rename_ids_.contains(stream_id);
-  bool is_sched_switch = sched_switch_ids_.contains(stream_id);
-  bool is_sched_wakeup = sched_wakeup_ids_.contains(stream_id);
-  bool is_sched_switch_with_callchain = sched_switch_with_callchain_ids_.contains(stream_id);
-  bool is_sched_wakeup_with_callchain = sched_wakeup_with_callchain_ids_.contains(stream_id);
-  bool is_sched_switch_with_stack = sched_switch_with_stack_ids_.contains(stream_id);
-  bool is_sched_wakeup_with_stack = sched_wakeup_with_stack_ids_.contains(stream_id);
-  bool is_amdgpu_cs_ioctl_event = amdgpu_cs_ioctl_ids_.contains(stream_id);
-  bool is_amdgpu_sched_run_job_event = amdgpu_sched_run_job_ids_.contains(stream_id);
-  bool is_dma_fence_signaled_event = dma_fence_signaled_ids_.contains(stream_id);
-  bool is_user_instrumented_tracepoint = ids_to_tracepoint_info_.contains(stream_id);
-
-  ORBIT_CHECK(is_uprobe + is_uprobe_with_args + is_uprobe_with_stack + is_uretprobe +
-                  is_uretprobe_with_retval + is_stack_sample + is_callchain_sample +
-                  is_task_newtask + is_task_rename + is_sched_switch + is_sched_wakeup +
-                  is_sched_switch_with_callchain + is_sched_wakeup_with_callchain +
-                  is_sched_switch_with_stack + is_sched_wakeup_with_stack +
-                  is_amdgpu_cs_ioctl_event + is_amdgpu_sched_run_job_event +
-                  is_dma_fence_signaled_event + is_user_instrumented_tracepoint <=
-              1);
-
   int fd = ring_buffer->GetFileDescriptor();
 
-  if (is_uprobe) {
-    ORBIT_CHECK(header.size == sizeof(RingBufferSpIp8bytesSample));
-    RingBufferSpIp8bytesSample ring_buffer_record;
-    ring_buffer->ConsumeRecord(header, &ring_buffer_record);
-
-    if (static_cast<pid_t>(ring_buffer_record.sample_id.pid) != target_pid_) {
-      return timestamp_ns;
-    }
-
-    UprobesPerfEvent event{
-        .timestamp = ring_buffer_record.sample_id.time,
-        .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
-        .data =
-            {
-                .pid = static_cast<pid_t>(ring_buffer_record.sample_id.pid),
-                .tid = static_cast<pid_t>(ring_buffer_record.sample_id.tid),
-                .cpu = ring_buffer_record.sample_id.cpu,
-                .function_id = uprobes_uretprobes_ids_to_function_id_.at(
-                    ring_buffer_record.sample_id.stream_id),
-                .sp = ring_buffer_record.regs.sp,
-                .ip = ring_buffer_record.regs.ip,
-                .return_address = ring_buffer_record.stack.top8bytes,
-            },
-    };
-
-    DeferEvent(event);
-    ++stats_.uprobes_count;
-
-  } else if (is_uprobe_with_stack) {
-    pid_t pid = ReadSampleRecordPid(ring_buffer);
-    const size_t size_of_uprobe_sample = sizeof(RingBufferSpStackUserSampleFixed) +
-                                         2 * sizeof(uint64_t) /*size and dyn_size*/ +
-                                         stack_dump_size_ /*data*/;
-    if (header.size != size_of_uprobe_sample) {
-      ring_buffer->SkipRecord(header);
-      return timestamp_ns;
+  switch (sample_stream_id_table_.Find(stream_id)) {
+    case SampleStreamKind::kUprobe: {
+      ORBIT_CHECK(header.size == sizeof(RingBufferSpIp8bytesSample));
+      RingBufferSpIp8bytesSample ring_buffer_record;
+      ring_buffer->ConsumeRecord(header, &ring_buffer_record);
+
+      if (static_cast<pid_t>(ring_buffer_record.sample_id.pid) != target_pid_) {
+        return timestamp_ns;
+      }
+
+      UprobesPerfEvent event{
+          .timestamp = ring_buffer_record.sample_id.time,
+          .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
+          .data =
+              {
+                  .pid = static_cast<pid_t>(ring_buffer_record.sample_id.pid),
+                  .tid = static_cast<pid_t>(ring_buffer_record.sample_id.tid),
+                  .cpu = ring_buffer_record.sample_id.cpu,
+                  .function_id = uprobes_uretprobes_ids_to_function_id_.at(
+                      ring_buffer_record.sample_id.stream_id),
+                  .sp = ring_buffer_record.regs.sp,
+                  .ip = ring_buffer_record.regs.ip,
+                  .return_address = ring_buffer_record.stack.top8bytes,
+              },
+      };
+
+      reader->DeferEvent(event);
+      ++stats_.uprobes_count;
+      break;
     }
-    if (pid != target_pid_) {
-      ring_buffer->SkipRecord(header);
-      return timestamp_ns;
-    }
-
-    UprobesWithStackPerfEvent event = ConsumeUprobeWithStackPerfEvent(ring_buffer, header);
-    DeferEvent(std::move(event));
-    ++stats_.uprobes_with_stack_count;
-  } else if (is_uprobe_with_args) {
-    ORBIT_CHECK(header.size == sizeof(RingBufferSpIpArguments8bytesSample));
-    RingBufferSpIpArguments8bytesSample ring_buffer_record;
-    ring_buffer->ConsumeRecord(header, &ring_buffer_record);
-
-    if (static_cast<pid_t>(ring_buffer_record.sample_id.pid) != target_pid_) {
-      return timestamp_ns;
-    }
-
-    UprobesWithArgumentsPerfEvent event{
-        .timestamp = ring_buffer_record.sample_id.time,
-        .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
-        .data =
-            {
-                .pid = static_cast<pid_t>(ring_buffer_record.sample_id.pid),
-                .tid = static_cast<pid_t>(ring_buffer_record.sample_id.tid),
-                .cpu = ring_buffer_record.sample_id.cpu,
-                .function_id = uprobes_uretprobes_ids_to_function_id_.at(
-                    ring_buffer_record.sample_id.stream_id),
-                .return_address = ring_buffer_record.stack.top8bytes,
-                .regs = ring_buffer_record.regs,
-            },
-    };
-
-    DeferEvent(event);
-    ++stats_.uprobes_count;
-
-  } else if (is_uretprobe) {
-    ORBIT_CHECK(header.size == sizeof(RingBufferEmptySample));
-    RingBufferEmptySample ring_buffer_record;
-    ring_buffer->ConsumeRecord(header, &ring_buffer_record);
-
-    if (static_cast<pid_t>(ring_buffer_record.sample_id.pid) != target_pid_) {
-      return timestamp_ns;
-    }
-
-    UretprobesPerfEvent event{
-        .timestamp = ring_buffer_record.sample_id.time,
-        .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
-        .data =
-            {
-                .pid = static_cast<pid_t>(ring_buffer_record.sample_id.pid),
-                .tid = static_cast<pid_t>(ring_buffer_record.sample_id.tid),
-            },
-    };
-
-    DeferEvent(event);
-    ++stats_.uprobes_count;
-
-  } else if (is_uretprobe_with_retval) {
-    ORBIT_CHECK(header.size == sizeof(RingBufferAxSample));
-    RingBufferAxSample ring_buffer_record;
-    ring_buffer->ConsumeRecord(header, &ring_buffer_record);
-
-    if (static_cast<pid_t>(ring_buffer_record.sample_id.pid) != target_pid_) {
-      return timestamp_ns;
-    }
-
-    UretprobesWithReturnValuePerfEvent event{
-        .timestamp = ring_buffer_record.sample_id.time,
-        .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
-        .data =
-            {
-                .pid = static_cast<pid_t>(ring_buffer_record.sample_id.pid),
-                .tid = static_cast<pid_t>(ring_buffer_record.sample_id.tid),
-                .rax = ring_buffer_record.regs.ax,
-            },
-    };
-    DeferEvent(event);
-    ++stats_.uprobes_count;
-
-  } else if (is_stack_sample) {
-    pid_t pid = ReadSampleRecordPid(ring_buffer);
-
-    const size_t size_of_stack_sample = sizeof(RingBufferStackSampleFixed) +
-                                        2 * sizeof(uint64_t) /*size and dyn_size*/ +
-                                        stack_dump_size_ /*data*/;
-
-    if (header.size != size_of_stack_sample) {
-      // Skip stack samples that have an unexpected size. These normally have
-      // abi == PERF_SAMPLE_REGS_ABI_NONE and no registers, and size == 0 and
-      // no stack. Usually, these samples have pid == tid == 0, but that's not
-      // always the case: for example, when a process exits while tracing, we
-      // might get a stack sample with pid and tid != 0 but still with
-      // abi == PERF_SAMPLE_REGS_ABI_NONE and size == 0.
-      ring_buffer->SkipRecord(header);
-      return timestamp_ns;
+    case SampleStreamKind::kUprobeWithStack: {
+      pid_t pid = ReadSampleRecordPid(ring_buffer);
+      const size_t size_of_uprobe_sample = sizeof(RingBufferSpStackUserSampleFixed) +
+                                           2 * sizeof(uint64_t) /*size and dyn_size*/ +
+                                           stack_dump_size_ /*data*/;
+      if (header.size != size_of_uprobe_sample) {
+        ring_buffer->SkipRecord(header);
+        return timestamp_ns;
+      }
+      if (pid != target_pid_) {
+        ring_buffer->SkipRecord(header);
+        return timestamp_ns;
+      }
+
+      UprobesWithStackPerfEvent event = ConsumeUprobeWithStackPerfEvent(ring_buffer, header);
+      reader->DeferEvent(std::move(event));
+      ++stats_.uprobes_with_stack_count;
+      break;
     }
-    if (pid != target_pid_) {
-      ring_buffer->SkipRecord(header);
-      return timestamp_ns;
+    case SampleStreamKind::kUprobeWithArgs: {
+      ORBIT_CHECK(header.size == sizeof(RingBufferSpIpArguments8bytesSample));
+      RingBufferSpIpArguments8bytesSample ring_buffer_record;
+      ring_buffer->ConsumeRecord(header, &ring_buffer_record);
+
+      if (static_cast<pid_t>(ring_buffer_record.sample_id.pid) != target_pid_) {
+        return timestamp_ns;
+      }
+
+      UprobesWithArgumentsPerfEvent event{
+          .timestamp = ring_buffer_record.sample_id.time,
+          .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
+          .data =
+              {
+                  .pid = static_cast<pid_t>(ring_buffer_record.sample_id.pid),
+                  .tid = static_cast<pid_t>(ring_buffer_record.sample_id.tid),
+                  .cpu = ring_buffer_record.sample_id.cpu,
+                  .function_id = uprobes_uretprobes_ids_to_function_id_.at(
+                      ring_buffer_record.sample_id.stream_id),
+                  .return_address = ring_buffer_record.stack.top8bytes,
+                  .regs = ring_buffer_record.regs,
+              },
+      };
+
+      reader->DeferEvent(event);
+      ++stats_.uprobes_count;
+      break;
+    }
+    case SampleStreamKind::kUretprobe: {
+      ORBIT_CHECK(header.size == sizeof(RingBufferEmptySample));
+      RingBufferEmptySample ring_buffer_record;
+      ring_buffer->ConsumeRecord(header, &ring_buffer_record);
+
+      if (static_cast<pid_t>(ring_buffer_record.sample_id.pid) != target_pid_) {
+        return timestamp_ns;
+      }
+
+      UretprobesPerfEvent event{
+          .timestamp = ring_buffer_record.sample_id.time,
+          .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
+          .data =
+              {
+                  .pid = static_cast<pid_t>(ring_buffer_record.sample_id.pid),
+                  .tid = static_cast<pid_t>(ring_buffer_record.sample_id.tid),
+              },
+      };
+
+      reader->DeferEvent(event);
+      ++stats_.uprobes_count;
+      break;
+    }
+    case SampleStreamKind::kUretprobeWithRetval: {
+      ORBIT_CHECK(header.size == sizeof(RingBufferAxSample));
+      RingBufferAxSample ring_buffer_record;
+      ring_buffer->ConsumeRecord(header, &ring_buffer_record);
+
+      if (static_cast<pid_t>(ring_buffer_record.sample_id.pid) != target_pid_) {
+        return timestamp_ns;
+      }
+
+      UretprobesWithReturnValuePerfEvent event{
+          .timestamp = ring_buffer_record.sample_id.time,
+          .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
+          .data =
+              {
+                  .pid = static_cast<pid_t>(ring_buffer_record.sample_id.pid),
+                  .tid = static_cast<pid_t>(ring_buffer_record.sample_id.tid),
+                  .rax = ring_buffer_record.regs.ax,
+              },
+      };
+      reader->DeferEvent(event);
+      ++stats_.uprobes_count;
+      break;
+    }
+    case SampleStreamKind::kStackSample: {
+      pid_t pid = ReadSampleRecordPid(ring_buffer);
+
+      const size_t size_of_stack_sample = sizeof(RingBufferStackSampleFixed) +
+                                          2 * sizeof(uint64_t) /*size and dyn_size*/ +
+                                          stack_dump_size_ /*data*/;
+
+      if (header.size != size_of_stack_sample) {
+        // Skip stack samples that have an unexpected size. These normally have
+        // abi == PERF_SAMPLE_REGS_ABI_NONE and no registers, and size == 0 and
+        // no stack. Usually, these samples have pid == tid == 0, but that's not
+        // always the case: for example, when a process exits while tracing, we
+        // might get a stack sample with pid and tid != 0 but still with
+        // abi == PERF_SAMPLE_REGS_ABI_NONE and size == 0.
+        ring_buffer->SkipRecord(header);
+        return timestamp_ns;
+      }
+      if (pid != target_pid_) {
+        ring_buffer->SkipRecord(header);
+        return timestamp_ns;
+      }
+      // Do *not* filter out samples based on header.misc,
+      // e.g., with header.misc == PERF_RECORD_MISC_KERNEL,
+      // in general they seem to produce valid callstacks.
+
+      StackSamplePerfEvent event = ConsumeStackSamplePerfEvent(ring_buffer, header);
+      reader->DeferEvent(std::move(event));
+      ++stats_.sample_count;
+      break;
+    }
+    case SampleStreamKind::kCallchainSample: {
+      pid_t pid = ReadSampleRecordPid(ring_buffer);
+
+      if (pid != target_pid_) {
+        ring_buffer->SkipRecord(header);
+        return timestamp_ns;
+      }
+
+      PerfEvent event = ConsumeCallchainSamplePerfEvent(ring_buffer, header);
+      reader->DeferEvent(std::move(event));
+      ++stats_.sample_count;
+      break;
+    }
+    case SampleStreamKind::kTaskNewtask: {
+      ORBIT_CHECK(header.size == sizeof(RingBufferRawSample<TaskNewtaskTracepointData>));
+      RingBufferRawSample<TaskNewtaskTracepointData> ring_buffer_record;
+      ring_buffer->ConsumeRecord(header, &ring_buffer_record);
+      TaskNewtaskPerfEvent event{
+          .timestamp = ring_buffer_record.sample_id.time,
+          .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
+          .data =
+              {
+                  // The tracepoint format calls the new tid "data.pid" but it's effectively the
+                  // thread id.
+                  // Note that ring_buffer_record.sample_id.pid and ring_buffer_record.sample_id.tid
+                  // are NOT the pid and tid of the new process/thread, but the ones of the
+                  // process/thread that created this one.
+                  .new_tid = ring_buffer_record.data.pid,
+                  .was_created_by_tid = static_cast<pid_t>(ring_buffer_record.sample_id.tid),
+                  .was_created_by_pid = static_cast<pid_t>(ring_buffer_record.sample_id.pid),
+              },
+      };
+      memcpy(event.data.comm, ring_buffer_record.data.comm, 16);
+      reader->DeferEvent(event);
+      break;
+    }
+    case SampleStreamKind::kTaskRename: {
+      ORBIT_CHECK(header.size == sizeof(RingBufferRawSample<TaskRenameTracepointData>));
+      RingBufferRawSample<TaskRenameTracepointData> ring_buffer_record;
+      ring_buffer->ConsumeRecord(header, &ring_buffer_record);
+
+      TaskRenamePerfEvent event{
+          .timestamp = ring_buffer_record.sample_id.time,
+          .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
+          .data =
+              {
+                  // The tracepoint format calls the renamed tid "data.pid" but it's effectively the
+                  // thread id. This should match ring_buffer_record.sample_id.tid.
+                  .renamed_tid = ring_buffer_record.data.pid,
+              },
+      };
+
+      memcpy(event.data.newcomm, ring_buffer_record.data.newcomm, 16);
+      reader->DeferEvent(event);
+      break;
+    }
+    case SampleStreamKind::kSchedSwitch: {
+      ORBIT_CHECK(header.size == sizeof(RingBufferRawSample<SchedSwitchTracepointData>));
+      RingBufferRawSample<SchedSwitchTracepointData> ring_buffer_record;
+      ring_buffer->ConsumeRecord(header, &ring_buffer_record);
+
+      SchedSwitchPerfEvent event{
+          .timestamp = ring_buffer_record.sample_id.time,
+          .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
+          .data =
+              {
+                  .cpu = ring_buffer_record.sample_id.cpu,
+                  // As the tracepoint data does not include the pid of the process that the
+                  // thread being switched out belongs to, we use the pid set by perf_event_open
+                  // in the corresponding generic field of the PERF_RECORD_SAMPLE.
+                  // Note, though, that this value is -1 when the switch out is caused by the
+                  // thread exiting. This is not the case for data.prev_pid, whose value is always
+                  // correct as it comes directly from the tracepoint data.
+                  .prev_pid_or_minus_one = static_cast<pid_t>(ring_buffer_record.sample_id.pid),
+                  .prev_tid = ring_buffer_record.data.prev_pid,
+                  .prev_state = ring_buffer_record.data.prev_state,
+                  .next_tid = ring_buffer_record.data.next_pid,
+              },
+      };
+      reader->DeferEvent(event);
+      ++stats_.sched_switch_count;
+      break;
+    }
+    case SampleStreamKind::kSchedWakeup: {
+      SchedWakeupPerfEvent event = ConsumeSchedWakeupPerfEvent(ring_buffer, header);
+      reader->DeferEvent(event);
+      break;
     }
-    // Do *not* filter out samples based on header.misc,
-    // e.g., with header.misc == PERF_RECORD_MISC_KERNEL,
-    // in general they seem to produce valid callstacks.
+    case SampleStreamKind::kSchedSwitchWithCallchain: {
+      // When the switch out is caused by the thread exiting, the sample record's pid is "-1".
+      // For simplicity, we accept that we discard the callstack in this case.
+      pid_t pid_or_minus_one = ReadSampleRecordPid(ring_buffer);
+      bool copy_stack_related_data = pid_or_minus_one == target_pid_;
+      PerfEvent event = ConsumeSchedSwitchWithOrWithoutCallchainPerfEvent(ring_buffer, header,
+                                                                          copy_stack_related_data);
+      reader->DeferEvent(std::move(event));
+      ++stats_.sched_switch_count;
+      break;
+    }
+    case SampleStreamKind::kSchedWakeupWithCallchain: {
+      pid_t pid = ReadSampleRecordPid(ring_buffer);
+      bool copy_stack_related_data = pid == target_pid_;
+      PerfEvent event = ConsumeSchedWakeupWithOrWithoutCallchainPerfEvent(ring_buffer, header,
+                                                                          copy_stack_related_data);
+      reader->DeferEvent(std::move(event));
+      break;
+    }
+    case SampleStreamKind::kSchedSwitchWithStack: {
+      // See comment in kSchedSwitchWithCallchain case above for reasoning about "-1".
+      pid_t pid_or_minus_one = ReadSampleRecordPid(ring_buffer);
+      bool copy_stack_related_data = pid_or_minus_one == target_pid_;
+      PerfEvent event = ConsumeSchedSwitchWithOrWithoutStackPerfEvent(ring_buffer, header,
+                                                                      copy_stack_related_data);
+      reader->DeferEvent(std::move(event));
+      ++stats_.sched_switch_count;
+      break;
+    }
+    case SampleStreamKind::kSchedWakeupWithStack: {
+      pid_t pid = ReadSampleRecordPid(ring_buffer);
+      bool copy_stack_related_data = pid == target_pid_;
+      PerfEvent event = ConsumeSchedWakeupWithOrWithoutStackPerfEvent(ring_buffer, header,
+                                                                      copy_stack_related_data);
+      reader->DeferEvent(std::move(event));
+      break;
+    }
+    case SampleStreamKind::kAmdgpuCsIoctl: {
+      AmdgpuCsIoctlPerfEvent event = ConsumeAmdgpuCsIoctlPerfEvent(ring_buffer, header);
+      reader->DeferEvent(std::move(event));
+      ++stats_.gpu_events_count;
+      break;
+    }
+    case SampleStreamKind::kAmdgpuSchedRunJob: {
+      AmdgpuSchedRunJobPerfEvent event = ConsumeAmdgpuSchedRunJobPerfEvent(ring_buffer, header);
+      reader->DeferEvent(std::move(event));
+      ++stats_.gpu_events_count;
+      break;
+    }
+    case SampleStreamKind::kDmaFenceSignaled: {
+      DmaFenceSignaledPerfEvent event = ConsumeDmaFenceSignaledPerfEvent(ring_buffer, header);
+      reader->DeferEvent(std::move(event));
+      ++stats_.gpu_events_count;
+      break;
+    }
+    case SampleStreamKind::kUserInstrumentedTracepoint: {
+      auto it = ids_to_tracepoint_info_.find(stream_id);
+      if (it == ids_to_tracepoint_info_.end()) {
+        return timestamp_ns;
+      }
 
-    StackSamplePerfEvent event = ConsumeStackSamplePerfEvent(ring_buffer, header);
-    DeferEvent(std::move(event));
-    ++stats_.sample_count;
+      GenericTracepointPerfEvent event = ConsumeGenericTracepointPerfEvent(ring_buffer, header);
 
-  } else if (is_callchain_sample) {
-    pid_t pid = ReadSampleRecordPid(ring_buffer);
+      orbit_grpc_protos::FullTracepointEvent tracepoint_event;
+      tracepoint_event.set_pid(event.data.pid);
+      tracepoint_event.set_tid(event.data.tid);
+      tracepoint_event.set_timestamp_ns(event.timestamp);
+      tracepoint_event.set_cpu(event.data.cpu);
+      orbit_grpc_protos::TracepointInfo* tracepoint_info =
+          tracepoint_event.mutable_tracepoint_info();
+      tracepoint_info->set_name(it->second.name());
+      tracepoint_info->set_category(it->second.category());
 
-    if (pid != target_pid_) {
+      listener_->OnTracepointEvent(std::move(tracepoint_event));
+      break;
+    }
+    case SampleStreamKind::kUnknown: {
+      ORBIT_ERROR("PERF_EVENT_SAMPLE with unexpected stream_id: %lu", stream_id);
       ring_buffer->SkipRecord(header);
-      return timestamp_ns;
-    }
-
-    PerfEvent event = ConsumeCallchainSamplePerfEvent(ring_buffer, header);
-    DeferEvent(std::move(event));
-    ++stats_.sample_count;
-
-  } else if (is_task_newtask) {
-    ORBIT_CHECK(header.size == sizeof(RingBufferRawSample<TaskNewtaskTracepointData>));
-    RingBufferRawSample<TaskNewtaskTracepointData> ring_buffer_record;
-    ring_buffer->ConsumeRecord(header, &ring_buffer_record);
-    TaskNewtaskPerfEvent event{
-        .timestamp = ring_buffer_record.sample_id.time,
-        .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
-        .data =
-            {
-                // The tracepoint format calls the new tid "data.pid" but it's effectively the
-                // thread id.
-                // Note that ring_buffer_record.sample_id.pid and ring_buffer_record.sample_id.tid
-                // are NOT the pid and tid of the new process/thread, but the ones of the
-                // process/thread that created this one.
-                .new_tid = ring_buffer_record.data.pid,
-                .was_created_by_tid = static_cast<pid_t>(ring_buffer_record.sample_id.tid),
-                .was_created_by_pid = static_cast<pid_t>(ring_buffer_record.sample_id.pid),
-            },
-    };
-    memcpy(event.data.comm, ring_buffer_record.data.comm, 16);
-    DeferEvent(event);
-
-  } else if (is_task_rename) {
-    ORBIT_CHECK(header.size == sizeof(RingBufferRawSample<TaskRenameTracepointData>));
-    RingBufferRawSample<TaskRenameTracepointData> ring_buffer_record;
-    ring_buffer->ConsumeRecord(header, &ring_buffer_record);
-
-    TaskRenamePerfEvent event{
-        .timestamp = ring_buffer_record.sample_id.time,
-        .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
-        .data =
-            {
-                // The tracepoint format calls the renamed tid "data.pid" but it's effectively the
-                // thread id. This should match ring_buffer_record.sample_id.tid.
-                .renamed_tid = ring_buffer_record.data.pid,
-            },
-    };
-
-    memcpy(event.data.newcomm, ring_buffer_record.data.newcomm, 16);
-    DeferEvent(event);
-
-  } else if (is_sched_switch) {
-    ORBIT_CHECK(header.size == sizeof(RingBufferRawSample<SchedSwitchTracepointData>));
-    RingBufferRawSample<SchedSwitchTracepointData> ring_buffer_record;
-    ring_buffer->ConsumeRecord(header, &ring_buffer_record);
-
-    SchedSwitchPerfEvent event{
-        .timestamp = ring_buffer_record.sample_id.time,
-        .ordered_stream = PerfEventOrderedStream::FileDescriptor(fd),
-        .data =
-            {
-                .cpu = ring_buffer_record.sample_id.cpu,
-                // As the tracepoint data does not include the pid of the process that the thread
-                // being switched out belongs to, we use the pid set by perf_event_open in the
-                // corresponding generic field of the PERF_RECORD_SAMPLE.
-                // Note, though, that this value is -1 when the switch out is caused by the thread
-                // exiting. This is not the case for data.prev_pid, whose value is always correct as
-                // it comes directly from the tracepoint data.
-                .prev_pid_or_minus_one = static_cast<pid_t>(ring_buffer_record.sample_id.pid),
-                .prev_tid = ring_buffer_record.data.prev_pid,
-                .prev_state = ring_buffer_record.data.prev_state,
-                .next_tid = ring_buffer_record.data.next_pid,
-            },
-    };
-    DeferEvent(event);
-    ++stats_.sched_switch_count;
-
-  } else if (is_sched_wakeup) {
-    SchedWakeupPerfEvent event = ConsumeSchedWakeupPerfEvent(ring_buffer, header);
-    DeferEvent(event);
-
-  } else if (is_sched_switch_with_callchain) {
-    // When the switch out is caused by the thread exiting, the sample record's pid is "-1".
-    // For simplicity, we accept that we discard the callstack in this case.
-    pid_t pid_or_minus_one = ReadSampleRecordPid(ring_buffer);
-    bool copy_stack_related_data = pid_or_minus_one == target_pid_;
-    PerfEvent event = ConsumeSchedSwitchWithOrWithoutCallchainPerfEvent(ring_buffer, header,
-                                                                        copy_stack_related_data);
-    DeferEvent(std::move(event));
-    ++stats_.sched_switch_count;
-
-  } else if (is_sched_wakeup_with_callchain) {
-    pid_t pid = ReadSampleRecordPid(ring_buffer);
-    bool copy_stack_related_data = pid == target_pid_;
-    PerfEvent event = ConsumeSchedWakeupWithOrWithoutCallchainPerfEvent(ring_buffer, header,
-                                                                        copy_stack_related_data);
-    DeferEvent(std::move(event));
-  } else if (is_sched_switch_with_stack) {
-    // See comment in "is_sched_switch_with_stack" case above for reasoning about "-1".
-    pid_t pid_or_minus_one = ReadSampleRecordPid(ring_buffer);
-    bool copy_stack_related_data = pid_or_minus_one == target_pid_;
-    PerfEvent event =
-        ConsumeSchedSwitchWithOrWithoutStackPerfEvent(ring_buffer, header, copy_stack_related_data);
-    DeferEvent(std::move(event));
-    ++stats_.sched_switch_count;
-
-  } else if (is_sched_wakeup_with_stack) {
-    pid_t pid = ReadSampleRecordPid(ring_buffer);
-    bool copy_stack_related_data = pid == target_pid_;
-    PerfEvent event =
-        ConsumeSchedWakeupWithOrWithoutStackPerfEvent(ring_buffer, header, copy_stack_related_data);
-    DeferEvent(std::move(event));
-
-  } else if (is_amdgpu_cs_ioctl_event) {
-    AmdgpuCsIoctlPerfEvent event = ConsumeAmdgpuCsIoctlPerfEvent(ring_buffer, header);
-    DeferEvent(std::move(event));
-    ++stats_.gpu_events_count;
-
-  } else if (is_amdgpu_sched_run_job_event) {
-    AmdgpuSchedRunJobPerfEvent event = ConsumeAmdgpuSchedRunJobPerfEvent(ring_buffer, header);
-    DeferEvent(std::move(event));
-    ++stats_.gpu_events_count;
-
-  } else if (is_dma_fence_signaled_event) {
-    DmaFenceSignaledPerfEvent event = ConsumeDmaFenceSignaledPerfEvent(ring_buffer, header);
-    DeferEvent(std::move(event));
-    ++stats_.gpu_events_count;
-
-  } else if (is_user_instrumented_tracepoint) {
-    auto it = ids_to_tracepoint_info_.find(stream_id);
-    if (it == ids_to_tracepoint_info_.end()) {
-      return timestamp_ns;
-    }
-
-    GenericTracepointPerfEvent event = ConsumeGenericTracepointPerfEvent(ring_buffer, header);
-
-    orbit_grpc_protos::FullTracepointEvent tracepoint_event;
-    tracepoint_event.set_pid(event.data.pid);
-    tracepoint_event.set_tid(event.data.tid);
-    tracepoint_event.set_timestamp_ns(event.timestamp);
-    tracepoint_event.set_cpu(event.data.cpu);
-    orbit_grpc_protos::TracepointInfo* tracepoint_info = tracepoint_event.mutable_tracepoint_info();
-    tracepoint_info->set_name(it->second.name());
-    tracepoint_info->set_category(it->second.category());
-
-    listener_->OnTracepointEvent(std::move(tracepoint_event));
-  } else {
-    ORBIT_ERROR("PERF_EVENT_SAMPLE with unexpected stream_id: %lu", stream_id);
-    ring_buffer->SkipRecord(header);
+      break;
+    }
   }
 
   return timestamp_ns;
 }
 
 uint64_t TracerImpl::ProcessLostEventAndReturnTimestamp(const perf_event_header& header,
-                                                        PerfEventRingBuffer* ring_buffer) {
+                                                        PerfEventRingBuffer* ring_buffer,
+                                                        RingBufferReader* reader) {
   RingBufferLost ring_buffer_record;
   ring_buffer->ConsumeRecord(header, &ring_buffer_record);
   uint64_t timestamp = ring_buffer_record.sample_id.time;
 
   stats_.lost_count += ring_buffer_record.lost;
-  stats_.lost_count_per_buffer[ring_buffer] += ring_buffer_record.lost;
+  {
+    absl::MutexLock lock{&stats_.lost_count_per_buffer_mutex};
+    stats_.lost_count_per_buffer[ring_buffer] += ring_buffer_record.lost;
+  }
+  reader->lost_count += ring_buffer_record.lost;
 
   // Fetch the timestamp of the last event that preceded this PERF_RECORD_LOST in this same ring
   // buffer.
   uint64_t fd_previous_timestamp_ns = 0;
-  if (auto it = fds_to_last_timestamp_ns_.find(ring_buffer->GetFileDescriptor());
-      it != fds_to_last_timestamp_ns_.end()) {
+  if (auto it = reader->fds_to_last_timestamp_ns.find(ring_buffer->GetFileDescriptor());
+      it != reader->fds_to_last_timestamp_ns.end()) {
     fd_previous_timestamp_ns = it->second;
   }
   if (fd_previous_timestamp_ns == 0) {
@@ -1475,7 +1693,7 @@ uint64_t TracerImpl::ProcessLostEventAndReturnTimestamp(const perf_event_header&
               .previous_timestamp = fd_previous_timestamp_ns,
           },
   };
-  DeferEvent(event);
+  reader->DeferEvent(event);
 
   return timestamp;
 }
@@ -1519,6 +1737,9 @@ void TracerImpl::ProcessDeferredEvents() {
     // deferred events. The last iteration will consume all remaining events.
     should_exit = stop_deferred_thread_;
 
+    // The watermark must be computed before taking the deferred events, as it is only guaranteed
+    // to hold for the events that had been added when it was published.
+    const uint64_t low_watermark_ns = ComputeLowWatermarkNs();
     {
       absl::MutexLock lock{&deferred_events_being_buffered_mutex_};
       deferred_events_being_buffered_.swap(deferred_events_to_process_);
@@ -1542,9 +1763,37 @@ void TracerImpl::ProcessDeferredEvents() {
     deferred_events_to_process_.clear();
     {
       ORBIT_SCOPE("ProcessOldEvents");
-      event_processor_.ProcessOldEvents();
+      event_processor_.ProcessOldEvents(low_watermark_ns);
+    }
+
+    const uint64_t processing_lag_ns = event_processor_.GetLastProcessingLagNs();
+    const uint64_t queued_event_bytes = event_processor_.GetQueuedEventBytes();
+    ORBIT_UINT64("Processing lag (ns)", processing_lag_ns);
+    ORBIT_UINT64("Queued perf_event_open events (bytes)", queued_event_bytes);
+    if (processing_lag_ns > stats_.max_processing_lag_ns) {
+      stats_.max_processing_lag_ns = processing_lag_ns;
     }
+    stats_.queued_event_bytes = queued_event_bytes;
+  }
+}
+
+uint64_t TracerImpl::ComputeLowWatermarkNs() const {
+  // Events produced outside of the ring buffers come with no guarantee on their timestamps, and GPU
+  // events can be out of order even within their ring buffer. In these cases, only rely on
+  // PerfEventProcessor::kProcessingDelayMs.
+  if (user_space_instrumentation_addresses_ != nullptr || trace_gpu_driver_) {
+    return 0;
+  }
+
+  uint64_t low_watermark_ns = std::numeric_limits<uint64_t>::max();
+  for (const std::unique_ptr<RingBufferReader>& reader : ring_buffer_readers_) {
+    low_watermark_ns = std::min<uint64_t>(low_watermark_ns, reader->low_watermark_ns);
   }
+  if (low_watermark_ns == std::numeric_limits<uint64_t>::max() ||
+      low_watermark_ns < kLowWatermarkMarginNs) {
+    return 0;
+  }
+  return low_watermark_ns - kLowWatermarkMarginNs;
 }
 
 void TracerImpl::RetrieveInitialTidToPidAssociationSystemWide() {
@@ -1569,8 +1818,8 @@ void TracerImpl::RetrieveInitialThreadStatesOfTarget() {
 void TracerImpl::Reset() {
   ORBIT_SCOPE_FUNCTION;
   tracing_fds_.clear();
+  ring_buffer_readers_.clear();
   ring_buffers_.clear();
-  fds_to_last_timestamp_ns_.clear();
 
   uprobes_uretprobes_ids_to_function_id_.clear();
   uprobes_ids_.clear();
@@ -1591,6 +1840,7 @@ void TracerImpl::Reset() {
   amdgpu_sched_run_job_ids_.clear();
   dma_fence_signaled_ids_.clear();
   ids_to_tracepoint_info_.clear();
+  sample_stream_id_table_.Clear();
 
   effective_capture_start_timestamp_ns_ = 0;
 
@@ -1620,25 +1870,32 @@ void TracerImpl::PrintStatsIfTimerElapsed() {
   ORBIT_CHECK(actual_window_s > 0.0);
 
   ORBIT_LOG("Events per second (and total) last %.3f s:", actual_window_s);
-  ORBIT_LOG("  sched switches: %.0f/s (%lu)", stats_.sched_switch_count / actual_window_s,
-            stats_.sched_switch_count);
-  ORBIT_LOG("  samples: %.0f/s (%lu)", stats_.sample_count / actual_window_s, stats_.sample_count);
-  ORBIT_LOG("  u(ret)probes: %.0f/s (%lu)", stats_.uprobes_count / actual_window_s,
-            stats_.uprobes_count);
-  ORBIT_LOG("  uprobes with stack: %.0f/s (%lu)", stats_.uprobes_with_stack_count / actual_window_s,
-            stats_.uprobes_with_stack_count);
-  ORBIT_LOG("  gpu events: %.0f/s (%lu)", stats_.gpu_events_count / actual_window_s,
-            stats_.gpu_events_count);
-  ORBIT_LOG("  mmap events: %.0f/s (%lu)", stats_.mmap_count / actual_window_s, stats_.mmap_count);
-
-  if (stats_.lost_count_per_buffer.empty()) {
-    ORBIT_LOG("  lost: %.0f/s (%lu)", stats_.lost_count / actual_window_s, stats_.lost_count);
-  } else {
-    ORBIT_LOG("  LOST: %.0f/s (%lu), of which:", stats_.lost_count / actual_window_s,
-              stats_.lost_count);
-    for (const auto& buffer_and_lost_count : stats_.lost_count_per_buffer) {
-      ORBIT_LOG("    from %s: %.0f/s (%lu)", buffer_and_lost_count.first->GetName().c_str(),
-                buffer_and_lost_count.second / actual_window_s, buffer_and_lost_count.second);
+  uint64_t sched_switch_count = stats_.sched_switch_count;
+  ORBIT_LOG("  sched switches: %.0f/s (%lu)", sched_switch_count / actual_window_s,
+            sched_switch_count);
+  uint64_t sample_count = stats_.sample_count;
+  ORBIT_LOG("  samples: %.0f/s (%lu)", sample_count / actual_window_s, sample_count);
+  uint64_t uprobes_count = stats_.uprobes_count;
+  ORBIT_LOG("  u(ret)probes: %.0f/s (%lu)", uprobes_count / actual_window_s, uprobes_count);
+  uint64_t uprobes_with_stack_count = stats_.uprobes_with_stack_count;
+  ORBIT_LOG("  uprobes with stack: %.0f/s (%lu)", uprobes_with_stack_count / actual_window_s,
+            uprobes_with_stack_count);
+  uint64_t gpu_events_count = stats_.gpu_events_count;
+  ORBIT_LOG("  gpu events: %.0f/s (%lu)", gpu_events_count / actual_window_s, gpu_events_count);
+  uint64_t mmap_count = stats_.mmap_count;
+  ORBIT_LOG("  mmap events: %.0f/s (%lu)", mmap_count / actual_window_s, mmap_count);
+
+  uint64_t lost_count = stats_.lost_count;
+  {
+    absl::MutexLock lock{&stats_.lost_count_per_buffer_mutex};
+    if (stats_.lost_count_per_buffer.empty()) {
+      ORBIT_LOG("  lost: %.0f/s (%lu)", lost_count / actual_window_s, lost_count);
+    } else {
+      ORBIT_LOG("  LOST: %.0f/s (%lu), of which:", lost_count / actual_window_s, lost_count);
+      for (const auto& buffer_and_lost_count : stats_.lost_count_per_buffer) {
+        ORBIT_LOG("    from %s: %.0f/s (%lu)", buffer_and_lost_count.first->GetName().c_str(),
+                  buffer_and_lost_count.second / actual_window_s, buffer_and_lost_count.second);
+      }
     }
   }
 
@@ -1653,16 +1910,55 @@ void TracerImpl::PrintStatsIfTimerElapsed() {
 
   uint64_t unwind_error_count = stats_.unwind_error_count;
   ORBIT_LOG("  unwind errors: %.0f/s (%lu) [%.1f%%]", unwind_error_count / actual_window_s,
-            unwind_error_count, 100.0 * unwind_error_count / stats_.sample_count);
+            unwind_error_count, 100.0 * unwind_error_count / sample_count);
   uint64_t discarded_samples_in_uretprobes_count = stats_.samples_in_uretprobes_count;
   ORBIT_LOG("  samples in u(ret)probes: %.0f/s (%lu) [%.1f%%]",
             discarded_samples_in_uretprobes_count / actual_window_s,
             discarded_samples_in_uretprobes_count,
-            100.0 * discarded_samples_in_uretprobes_count / stats_.sample_count);
+            100.0 * discarded_samples_in_uretprobes_count / sample_count);
 
   uint64_t thread_state_count = stats_.thread_state_count;
   ORBIT_LOG("  target's thread states: %.0f/s (%lu)", thread_state_count / actual_window_s,
             thread_state_count);
+
+  uint64_t max_processing_lag_ns = stats_.max_processing_lag_ns;
+  uint64_t queued_event_bytes = stats_.queued_event_bytes;
+  ORBIT_LOG("  processing lag: max %.1f ms; queued events: %.1f MB",
+            max_processing_lag_ns / 1'000'000.0, queued_event_bytes / (1024.0 * 1024.0));
+
+  PerfEventBufferPool::Stats buffer_pool_stats = PerfEventBufferPool::GetInstance().GetStats();
+  uint64_t buffer_pool_allocation_count =
+      buffer_pool_stats.allocation_count - stats_.buffer_pool_allocation_count_begin;
+  uint64_t buffer_pool_heap_allocation_count =
+      buffer_pool_stats.heap_allocation_count - stats_.buffer_pool_heap_allocation_count_begin;
+  constexpr double kBytesPerMb = 1024.0 * 1024.0;
+  ORBIT_LOG(
+      "  event buffer pool: %.1f MB (high-water mark %.1f MB), %.1f MB in use; allocations %.0f/s "
+      "(%lu), of which from the heap %.0f/s (%lu)",
+      buffer_pool_stats.pool_size_bytes / kBytesPerMb,
+      buffer_pool_stats.high_water_mark_bytes / kBytesPerMb,
+      buffer_pool_stats.in_use_bytes / kBytesPerMb, buffer_pool_allocation_count / actual_window_s,
+      buffer_pool_allocation_count, buffer_pool_heap_allocation_count / actual_window_s,
+      buffer_pool_heap_allocation_count);
+
+  if (ring_buffer_readers_.size() > 1) {
+    ORBIT_LOG("  ring buffer readers:");
+    for (const std::unique_ptr<RingBufferReader>& reader : ring_buffer_readers_) {
+      uint64_t reader_record_count = reader->record_count;
+      uint64_t reader_deferred_event_count = reader->deferred_event_count;
+      uint64_t reader_lost_count = reader->lost_count;
+      uint64_t reader_wait_count = reader->wait_count;
+      ORBIT_LOG(
+          "    reader %u (%u ring buffers): records %.0f/s (%lu), deferred events %.0f/s (%lu), "
+          "lost %.0f/s (%lu), waits %.0f/s (%lu)",
+          reader->index, reader->ring_buffers.size(), reader_record_count / actual_window_s,
+          reader_record_count, reader_deferred_event_count / actual_window_s,
+          reader_deferred_event_count, reader_lost_count / actual_window_s, reader_lost_count,
+          reader_wait_count / actual_window_s, reader_wait_count);
+      reader->ResetStats();
+    }
+  }
+
   stats_.Reset();
 }
 
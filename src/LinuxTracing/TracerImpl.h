@@ -21,6 +21,7 @@
 #include <memory>
 #include <optional>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include "GpuTracepointVisitor.h"
@@ -35,8 +36,10 @@
 #include "LostAndDiscardedEventVisitor.h"
 #include "OrbitBase/Profiling.h"
 #include "PerfEvent.h"
+#include "PerfEventBufferPool.h"
 #include "PerfEventProcessor.h"
 #include "PerfEventRingBuffer.h"
+#include "SampleStreamIdTable.h"
 #include "SwitchesStatesNamesVisitor.h"
 #include "UprobesFunctionCallManager.h"
 #include "UprobesReturnAddressManager.h"
@@ -63,22 +66,66 @@ class TracerImpl : public Tracer {
   void ProcessFunctionExit(const orbit_grpc_protos::FunctionExit& function_exit) override;
 
  private:
+  // A RingBufferReader reads a subset of ring_buffers_ round-robin. Records are parsed into a
+  // batch local to the reader, which is handed over to the thread processing the deferred events
+  // once per pass over the reader's ring buffers. As each ring buffer is read by exactly one
+  // reader, the order of each PerfEventOrderedStream::FileDescriptor is preserved.
+  struct RingBufferReader {
+    explicit RingBufferReader(uint32_t index) : index{index} {}
+    ~RingBufferReader();
+
+    void DeferEvent(PerfEvent&& event) { deferred_events_batch.emplace_back(std::move(event)); }
+
+    void ResetStats() {
+      record_count = 0;
+      deferred_event_count = 0;
+      lost_count = 0;
+      wait_count = 0;
+    }
+
+    const uint32_t index;
+    std::vector<PerfEventRingBuffer*> ring_buffers;
+    // Only valid with CaptureOptions::kEpoll. Contains the file descriptors of all ring_buffers.
+    int epoll_fd = -1;
+    absl::flat_hash_map<int, uint64_t> fds_to_last_timestamp_ns;
+    std::vector<PerfEvent> deferred_events_batch;
+    // No event older than this will be read anymore from ring_buffers, except for races with the
+    // kernel writing a record, see kLowWatermarkMarginNs. Published after the events read before it
+    // have been added to deferred_events_being_buffered_.
+    std::atomic<uint64_t> low_watermark_ns = 0;
+
+    std::atomic<uint64_t> record_count = 0;
+    std::atomic<uint64_t> deferred_event_count = 0;
+    std::atomic<uint64_t> lost_count = 0;
+    std::atomic<uint64_t> wait_count = 0;
+  };
+
   void Run();
   void Startup();
   void Shutdown();
-  void ProcessOneRecord(PerfEventRingBuffer* ring_buffer);
+  void BuildSampleStreamIdTable();
+  void CreateRingBufferReaders(int32_t number_of_cores);
+  void RunRingBufferReader(RingBufferReader* reader);
+  void WaitForNewDataInRingBuffers(RingBufferReader* reader);
+  [[nodiscard]] bool ReadRingBuffersOnce(RingBufferReader* reader);
+  void FlushDeferredEventsBatch(RingBufferReader* reader);
+  void ProcessOneRecord(PerfEventRingBuffer* ring_buffer, RingBufferReader* reader);
+  // The wakeup watermark is only useful to a reader that blocks in epoll_wait on the ring buffers.
+  [[nodiscard]] bool UseWakeupWatermark() const {
+    return ring_buffer_wait_method_ == orbit_grpc_protos::CaptureOptions::kEpoll;
+  }
   void InitUprobesEventVisitor();
   [[nodiscard]] bool OpenUserSpaceProbes(absl::Span<const int32_t> cpus);
   [[nodiscard]] bool OpenUprobesToRecordAdditionalStackOn(absl::Span<const int32_t> cpus);
-  [[nodiscard]] static bool OpenUprobes(const orbit_grpc_protos::InstrumentedFunction& function,
-                                        absl::Span<const int32_t> cpus,
-                                        absl::flat_hash_map<int32_t, int>* fds_per_cpu);
+  [[nodiscard]] bool OpenUprobes(const orbit_grpc_protos::InstrumentedFunction& function,
+                                 absl::Span<const int32_t> cpus,
+                                 absl::flat_hash_map<int32_t, int>* fds_per_cpu) const;
   [[nodiscard]] bool OpenUprobesWithStack(
       const orbit_grpc_protos::FunctionToRecordAdditionalStackOn& function,
       absl::Span<const int32_t> cpus, absl::flat_hash_map<int32_t, int>* fds_per_cpu) const;
-  [[nodiscard]] static bool OpenUretprobes(const orbit_grpc_protos::InstrumentedFunction& function,
-                                           absl::Span<const int32_t> cpus,
-                                           absl::flat_hash_map<int32_t, int>* fds_per_cpu);
+  [[nodiscard]] bool OpenUretprobes(const orbit_grpc_protos::InstrumentedFunction& function,
+                                    absl::Span<const int32_t> cpus,
+                                    absl::flat_hash_map<int32_t, int>* fds_per_cpu) const;
   [[nodiscard]] bool OpenMmapTask(absl::Span<const int32_t> cpus);
   [[nodiscard]] bool OpenSampling(absl::Span<const int32_t> cpus);
 
@@ -100,20 +147,26 @@ class TracerImpl : public Tracer {
   void InitLostAndDiscardedEventVisitor();
 
   [[nodiscard]] uint64_t ProcessForkEventAndReturnTimestamp(const perf_event_header& header,
-                                                            PerfEventRingBuffer* ring_buffer);
+                                                            PerfEventRingBuffer* ring_buffer,
+                                                            RingBufferReader* reader);
   [[nodiscard]] uint64_t ProcessExitEventAndReturnTimestamp(const perf_event_header& header,
-                                                            PerfEventRingBuffer* ring_buffer);
+                                                            PerfEventRingBuffer* ring_buffer,
+                                                            RingBufferReader* reader);
   [[nodiscard]] uint64_t ProcessMmapEventAndReturnTimestamp(const perf_event_header& header,
-                                                            PerfEventRingBuffer* ring_buffer);
+                                                            PerfEventRingBuffer* ring_buffer,
+                                                            RingBufferReader* reader);
   [[nodiscard]] uint64_t ProcessSampleEventAndReturnTimestamp(const perf_event_header& header,
-                                                              PerfEventRingBuffer* ring_buffer);
+                                                              PerfEventRingBuffer* ring_buffer,
+                                                              RingBufferReader* reader);
   [[nodiscard]] uint64_t ProcessLostEventAndReturnTimestamp(const perf_event_header& header,
-                                                            PerfEventRingBuffer* ring_buffer);
+                                                            PerfEventRingBuffer* ring_buffer,
+                                                            RingBufferReader* reader);
   [[nodiscard]] static uint64_t ProcessThrottleUnthrottleEventAndReturnTimestamp(
       const perf_event_header& header, PerfEventRingBuffer* ring_buffer);
 
   void DeferEvent(PerfEvent&& event);
   void ProcessDeferredEvents();
+  [[nodiscard]] uint64_t ComputeLowWatermarkNs() const;
 
   void RetrieveInitialTidToPidAssociationSystemWide();
   void RetrieveInitialThreadStatesOfTarget();
@@ -140,12 +193,24 @@ class TracerImpl : public Tracer {
   static constexpr uint64_t kUprobesWithStackRingBufferSizeKb = 64 * 1024;
 
   static constexpr uint32_t kIdleTimeOnEmptyRingBuffersUs = 5000;
+  // With CaptureOptions::kEpoll, the maximum time to block waiting for new data. A ring buffer
+  // whose data stays below kRingBufferWakeupWatermarkBytes never wakes up its reader, so this
+  // bounds the delay with which such events are read. It needs to be well below
+  // PerfEventProcessor::kProcessingDelayMs, otherwise these events would be discarded as out of
+  // order.
+  static constexpr int kMaxWaitForNewDataInRingBuffersMs = 20;
   static constexpr uint32_t kIdleTimeOnEmptyDeferredEventsUs = 5000;
+  // Subtracted from the low watermark of the RingBufferReaders, as a record read after a ring
+  // buffer was found empty can still have a slightly older timestamp, taken before it was written.
+  static constexpr uint64_t kLowWatermarkMarginNs = 10'000'000;
 
   bool trace_context_switches_;
   bool introspection_enabled_;
   pid_t target_pid_;
   std::optional<uint64_t> sampling_period_ns_;
+  uint32_t ring_buffer_reader_thread_count_;
+  orbit_grpc_protos::CaptureOptions::RingBufferWaitMethod ring_buffer_wait_method_;
+  uint32_t unwinding_thread_count_;
   uint16_t stack_dump_size_;
   orbit_grpc_protos::CaptureOptions::UnwindingMethod unwinding_method_;
   orbit_grpc_protos::CaptureOptions::ThreadStateChangeCallStackCollection
@@ -168,7 +233,7 @@ class TracerImpl : public Tracer {
 
   std::vector<int> tracing_fds_;
   std::vector<PerfEventRingBuffer> ring_buffers_;
-  absl::flat_hash_map<int, uint64_t> fds_to_last_timestamp_ns_;
+  std::vector<std::unique_ptr<RingBufferReader>> ring_buffer_readers_;
 
   absl::flat_hash_map<uint64_t, uint64_t> uprobes_uretprobes_ids_to_function_id_;
   absl::flat_hash_set<uint64_t> uprobes_ids_;
@@ -190,6 +255,9 @@ class TracerImpl : public Tracer {
   absl::flat_hash_set<uint64_t> amdgpu_sched_run_job_ids_;
   absl::flat_hash_set<uint64_t> dma_fence_signaled_ids_;
   absl::flat_hash_map<uint64_t, orbit_grpc_protos::TracepointInfo> ids_to_tracepoint_info_;
+  // Built from all the sets of stream ids above once all events have been opened. Used to dispatch
+  // PERF_RECORD_SAMPLEs with a single lookup.
+  SampleStreamIdTable sample_stream_id_table_;
 
   uint64_t effective_capture_start_timestamp_ns_ = 0;
 
@@ -220,26 +288,42 @@ class TracerImpl : public Tracer {
       gpu_events_count = 0;
       mmap_count = 0;
       lost_count = 0;
-      lost_count_per_buffer.clear();
+      {
+        absl::MutexLock lock{&lost_count_per_buffer_mutex};
+        lost_count_per_buffer.clear();
+      }
       discarded_out_of_order_count = 0;
       unwind_error_count = 0;
       samples_in_uretprobes_count = 0;
       thread_state_count = 0;
+      max_processing_lag_ns = 0;
+      PerfEventBufferPool::Stats buffer_pool_stats = PerfEventBufferPool::GetInstance().GetStats();
+      buffer_pool_allocation_count_begin = buffer_pool_stats.allocation_count;
+      buffer_pool_heap_allocation_count_begin = buffer_pool_stats.heap_allocation_count;
     }
 
     uint64_t event_count_begin_ns = 0;
-    uint64_t sched_switch_count = 0;
-    uint64_t sample_count = 0;
-    uint64_t uprobes_count = 0;
-    uint64_t uprobes_with_stack_count = 0;
-    uint64_t gpu_events_count = 0;
-    uint64_t mmap_count = 0;
-    uint64_t lost_count = 0;
-    absl::flat_hash_map<PerfEventRingBuffer*, uint64_t> lost_count_per_buffer{};
+    // These are incremented by all RingBufferReaders.
+    std::atomic<uint64_t> sched_switch_count = 0;
+    std::atomic<uint64_t> sample_count = 0;
+    std::atomic<uint64_t> uprobes_count = 0;
+    std::atomic<uint64_t> uprobes_with_stack_count = 0;
+    std::atomic<uint64_t> gpu_events_count = 0;
+    std::atomic<uint64_t> mmap_count = 0;
+    std::atomic<uint64_t> lost_count = 0;
+    absl::Mutex lost_count_per_buffer_mutex;
+    absl::flat_hash_map<PerfEventRingBuffer*, uint64_t> lost_count_per_buffer
+        ABSL_GUARDED_BY(lost_count_per_buffer_mutex){};
     std::atomic<uint64_t> discarded_out_of_order_count = 0;
     std::atomic<uint64_t> unwind_error_count = 0;
     std::atomic<uint64_t> samples_in_uretprobes_count = 0;
     std::atomic<uint64_t> thread_state_count = 0;
+    // These are set by the thread processing the deferred events.
+    std::atomic<uint64_t> max_processing_lag_ns = 0;
+    std::atomic<uint64_t> queued_event_bytes = 0;
+    // PerfEventBufferPool's counters are cumulative, so keep their values at the window's begin.
+    uint64_t buffer_pool_allocation_count_begin = 0;
+    uint64_t buffer_pool_heap_allocation_count_begin = 0;
   };
 
   static constexpr uint64_t kEventStatsWindowS = 5;
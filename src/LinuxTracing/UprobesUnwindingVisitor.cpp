@@ -4,6 +4,7 @@
 
 #include "UprobesUnwindingVisitor.h"
 
+#include <absl/time/time.h>
 #include <absl/types/span.h>
 #include <sys/mman.h>
 #include <unwindstack/MapInfo.h>
@@ -20,13 +21,16 @@
 #include <string>
 #include <string_view>
 #include <utility>
+#include <variant>
 
 #include "GrpcProtos/capture.pb.h"
 #include "GrpcProtos/module.pb.h"
 #include "LibunwindstackMultipleOfflineAndProcessMemory.h"
 #include "ModuleUtils/ReadLinuxModules.h"
+#include "OrbitBase/Future.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadPool.h"
 #include "PerfEvent.h"
 #include "unwindstack/Arch.h"
 #include "unwindstack/Maps.h"
@@ -221,13 +225,71 @@ UprobesUnwindingVisitor::ComputeCallstackTypeFromStackSample(
   return Callstack::kComplete;
 }
 
+bool UprobesUnwindingVisitor::SendFullAddressInfosToListener(
+    const LibunwindstackResult& libunwindstack_result) {
+  if (libunwindstack_result.frames().empty()) {
+    // Even with unwinding errors this is not expected because we should at least get the program
+    // counter. Do nothing in case this doesn't hold for a reason we don't know.
+    ORBIT_ERROR("Unwound callstack has no frames");
+    return false;
+  }
+
+  for (const unwindstack::FrameData& libunwindstack_frame : libunwindstack_result.frames()) {
+    SendFullAddressInfoToListener(libunwindstack_frame);
+  }
+  return true;
+}
+
+void UprobesUnwindingVisitor::FillCallstack(const LibunwindstackResult& libunwindstack_result,
+                                            Callstack* resulting_callstack) {
+  ORBIT_CHECK(!libunwindstack_result.frames().empty());
+  resulting_callstack->set_type(ComputeCallstackTypeFromStackSample(libunwindstack_result));
+  resulting_callstack->mutable_pcs()->Reserve(
+      static_cast<int>(libunwindstack_result.frames().size()));
+  for (const unwindstack::FrameData& libunwindstack_frame : libunwindstack_result.frames()) {
+    resulting_callstack->add_pcs(libunwindstack_frame.pc);
+  }
+}
+
+bool UprobesUnwindingVisitor::ProcessLibunwindstackResult(
+    const LibunwindstackResult& libunwindstack_result, Callstack* resulting_callstack) {
+  if (!SendFullAddressInfosToListener(libunwindstack_result)) return false;
+  FillCallstack(libunwindstack_result, resulting_callstack);
+  return true;
+}
+
+void UprobesUnwindingVisitor::SendCallstackSample(
+    uint32_t pid, uint32_t tid, uint64_t timestamp_ns,
+    const LibunwindstackResult& libunwindstack_result) {
+  // The FullAddressInfos go to the listener before the sample is created in place, as the listener
+  // can't be called while it is filled in.
+  if (!SendFullAddressInfosToListener(libunwindstack_result)) return;
+  listener_->OnCallstackSampleInPlace([&](FullCallstackSample* sample) {
+    sample->set_pid(pid);
+    sample->set_tid(tid);
+    sample->set_timestamp_ns(timestamp_ns);
+    FillCallstack(libunwindstack_result, sample->mutable_callstack());
+    return true;
+  });
+}
+
 template <typename StackPerfEventDataT>
 bool UprobesUnwindingVisitor::UnwindStack(const StackPerfEventDataT& event_data,
                                           Callstack* resulting_callstack,
                                           bool offline_memory_only) {
+  return ProcessLibunwindstackResult(ComputeLibunwindstackResult(event_data, offline_memory_only),
+                                     resulting_callstack);
+}
+
+template <typename StackPerfEventDataT>
+LibunwindstackResult UprobesUnwindingVisitor::ComputeLibunwindstackResult(
+    const StackPerfEventDataT& event_data, bool offline_memory_only) {
   ORBIT_CHECK(listener_ != nullptr);
   ORBIT_CHECK(current_maps_ != nullptr);
 
+  // The callstack computed here is sent right away, so it must come after all pending outputs.
+  SendAllPendingOutputs();
+
   return_address_manager_->PatchSample(event_data.GetCallstackTid(), event_data.GetRegisters().sp,
                                        event_data.GetMutableStackData(), event_data.GetStackSize());
 
@@ -250,41 +312,106 @@ bool UprobesUnwindingVisitor::UnwindStack(const StackPerfEventDataT& event_data,
   // But this is not likely to happen.
   // TODO(b/246519821) It would be possible to retrieve the information from
   //  SwitchesStatesNamesVisitor::GetPidOfTid, but this requires major refactoring.
-  LibunwindstackResult libunwindstack_result =
-      unwinder_->Unwind(event_data.GetCallstackPidOrMinusOne(), current_maps_->Get(),
-                        event_data.GetRegistersAsArray(), stack_slices, offline_memory_only);
+  return unwinder_->Unwind(event_data.GetCallstackPidOrMinusOne(), current_maps_->Get(),
+                           event_data.GetRegistersAsArray(), stack_slices, offline_memory_only);
+}
 
-  if (libunwindstack_result.frames().empty()) {
-    // Even with unwinding errors this is not expected because we should at least get the program
-    // counter. Do nothing in case this doesn't hold for a reason we don't know.
-    ORBIT_ERROR("Unwound callstack has no frames");
-    return false;
+UprobesUnwindingVisitor::~UprobesUnwindingVisitor() {
+  if (unwinding_thread_pool_ != nullptr) {
+    unwinding_thread_pool_->ShutdownAndWait();
   }
+}
 
-  resulting_callstack->set_type(ComputeCallstackTypeFromStackSample(libunwindstack_result));
-  for (const unwindstack::FrameData& libunwindstack_frame : libunwindstack_result.frames()) {
-    SendFullAddressInfoToListener(libunwindstack_frame);
-    resulting_callstack->add_pcs(libunwindstack_frame.pc);
+void UprobesUnwindingVisitor::SetUnwindingThreadCount(uint32_t thread_count) {
+  ORBIT_CHECK(unwinding_thread_pool_ == nullptr);
+  if (thread_count == 0) return;
+  unwinding_thread_pool_ =
+      orbit_base::ThreadPool::Create(thread_count, thread_count, absl::Seconds(1));
+  max_pending_outputs_ = thread_count * kMaxPendingOutputsPerUnwindingThread;
+}
+
+void UprobesUnwindingVisitor::ScheduleStackSampleUnwinding(uint64_t event_timestamp,
+                                                           StackSamplePerfEventData& event_data) {
+  ORBIT_CHECK(unwinding_thread_pool_ != nullptr);
+
+  // Patching depends on the dynamically instrumented functions the thread is in at the time of the
+  // sample, so it has to happen in order.
+  return_address_manager_->PatchSample(event_data.GetCallstackTid(), event_data.GetRegisters().sp,
+                                       event_data.GetMutableStackData(), event_data.GetStackSize());
+
+  // The maps are not modified while any unwinding is in progress, see Visit(MmapPerfEventData).
+  orbit_base::Future<LibunwindstackResult> libunwindstack_result = unwinding_thread_pool_->Schedule(
+      [unwinder = unwinder_, maps = current_maps_->Get(),
+       pid = event_data.GetCallstackPidOrMinusOne(), regs = event_data.GetRegistersAsArray(),
+       sp = event_data.GetRegisters().sp, stack_size = event_data.GetStackSize(),
+       stack_data = event_data.TakeStackData()] {
+        const StackSliceView stack_slice{sp, stack_size, stack_data.get()};
+        return unwinder->Unwind(pid, maps, regs, absl::MakeConstSpan(&stack_slice, 1));
+      });
+  pending_outputs_.emplace_back(PendingCallstackSample{std::move(libunwindstack_result),
+                                                      static_cast<uint32_t>(event_data.pid),
+                                                      static_cast<uint32_t>(event_data.tid),
+                                                      event_timestamp});
+
+  SendReadyPendingOutputs();
+  while (pending_outputs_.size() > max_pending_outputs_) {
+    SendFirstPendingOutput();
   }
+}
 
-  ORBIT_CHECK(!resulting_callstack->pcs().empty());
-  return true;
+void UprobesUnwindingVisitor::SendFunctionCallInOrder(FunctionCall function_call) {
+  if (pending_outputs_.empty()) {
+    listener_->OnFunctionCall(std::move(function_call));
+    return;
+  }
+  pending_outputs_.emplace_back(std::move(function_call));
 }
 
-void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
-                                    const StackSamplePerfEventData& event_data) {
-  FullCallstackSample sample;
-  sample.set_pid(event_data.pid);
-  sample.set_tid(event_data.tid);
-  sample.set_timestamp_ns(event_timestamp);
+bool UprobesUnwindingVisitor::IsFirstPendingOutputReady() const {
+  ORBIT_CHECK(!pending_outputs_.empty());
+  const auto* pending_callstack_sample =
+      std::get_if<PendingCallstackSample>(&pending_outputs_.front());
+  return pending_callstack_sample == nullptr ||
+         pending_callstack_sample->libunwindstack_result.IsFinished();
+}
 
-  const bool success = UnwindStack(event_data, sample.mutable_callstack());
+void UprobesUnwindingVisitor::SendFirstPendingOutput() {
+  ORBIT_CHECK(!pending_outputs_.empty());
+  PendingOutput& pending_output = pending_outputs_.front();
+  if (auto* pending_callstack_sample = std::get_if<PendingCallstackSample>(&pending_output);
+      pending_callstack_sample != nullptr) {
+    // Get blocks until the unwinding has finished.
+    SendCallstackSample(pending_callstack_sample->pid, pending_callstack_sample->tid,
+                        pending_callstack_sample->timestamp_ns,
+                        pending_callstack_sample->libunwindstack_result.Get());
+  } else {
+    listener_->OnFunctionCall(std::move(std::get<FunctionCall>(pending_output)));
+  }
+  pending_outputs_.pop_front();
+}
 
-  if (!success) {
+void UprobesUnwindingVisitor::SendReadyPendingOutputs() {
+  while (!pending_outputs_.empty() && IsFirstPendingOutputReady()) {
+    SendFirstPendingOutput();
+  }
+}
+
+void UprobesUnwindingVisitor::SendAllPendingOutputs() {
+  while (!pending_outputs_.empty()) {
+    SendFirstPendingOutput();
+  }
+}
+
+void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
+                                    StackSamplePerfEventData& event_data) {
+  if (unwinding_thread_pool_ != nullptr &&
+      !thread_id_stream_id_to_stack_slices_.contains(event_data.GetCallstackTid())) {
+    ScheduleStackSampleUnwinding(event_timestamp, event_data);
     return;
   }
 
-  listener_->OnCallstackSample(std::move(sample));
+  SendCallstackSample(static_cast<uint32_t>(event_data.pid), static_cast<uint32_t>(event_data.tid),
+                      event_timestamp, ComputeLibunwindstackResult(event_data));
 }
 
 void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
@@ -419,6 +546,9 @@ UprobesUnwindingVisitor::ComputeCallstackTypeFromCallchainAndPatch(
 template <typename CallchainPerfEventDataT>
 bool UprobesUnwindingVisitor::VisitCallchainEvent(const CallchainPerfEventDataT& event_data,
                                                   Callstack* resulting_callstack) {
+  // The callstack computed here is sent right away, so it must come after all pending outputs.
+  SendAllPendingOutputs();
+
   // The top of a callchain is always inside the kernel code and we don't expect samples to be only
   // inside the kernel. Do nothing in case this happens anyway for some reason.
   if (event_data.GetCallchainSize() <= 1) {
@@ -448,19 +578,24 @@ void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
   ORBIT_CHECK(listener_ != nullptr);
   ORBIT_CHECK(current_maps_ != nullptr);
 
-  FullCallstackSample sample;
-  sample.set_pid(event_data.pid);
-  sample.set_tid(event_data.tid);
-  sample.set_timestamp_ns(event_timestamp);
-  Callstack* callstack = sample.mutable_callstack();
+  // VisitCallchainEvent only calls the listener to send the pending outputs, which can't happen
+  // while the sample is filled in.
+  SendAllPendingOutputs();
 
-  bool success = VisitCallchainEvent(event_data, callstack);
-  if (!success) {
-    return;
-  }
+  listener_->OnCallstackSampleInPlace([&](FullCallstackSample* sample) {
+    sample->set_pid(event_data.pid);
+    sample->set_tid(event_data.tid);
+    sample->set_timestamp_ns(event_timestamp);
+    Callstack* callstack = sample->mutable_callstack();
 
-  ORBIT_CHECK(!callstack->pcs().empty());
-  listener_->OnCallstackSample(std::move(sample));
+    bool success = VisitCallchainEvent(event_data, callstack);
+    if (!success) {
+      return false;
+    }
+
+    ORBIT_CHECK(!callstack->pcs().empty());
+    return true;
+  });
 }
 
 void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
@@ -561,7 +696,7 @@ void UprobesUnwindingVisitor::OnUretprobes(uint64_t timestamp_ns, pid_t pid, pid
   std::optional<FunctionCall> function_call =
       function_call_manager_->ProcessFunctionExit(pid, tid, timestamp_ns, ax);
   if (function_call.has_value()) {
-    listener_->OnFunctionCall(std::move(function_call.value()));
+    SendFunctionCallInOrder(std::move(function_call.value()));
   }
 
   return_address_manager_->ProcessFunctionExit(tid);
@@ -591,14 +726,14 @@ void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
   std::optional<FunctionCall> function_call = function_call_manager_->ProcessFunctionExit(
       event_data.pid, event_data.tid, event_timestamp, std::nullopt);
   if (function_call.has_value()) {
-    listener_->OnFunctionCall(std::move(function_call.value()));
+    SendFunctionCallInOrder(std::move(function_call.value()));
   }
 
   return_address_manager_->ProcessFunctionExit(event_data.tid);
 }
 
 void UprobesUnwindingVisitor::Visit(uint64_t /*event_timestamp*/,
-                                    const UprobesWithStackPerfEventData& event_data) {
+                                    UprobesWithStackPerfEventData& event_data) {
   StackSlice stack_slice{.start_address = event_data.GetRegisters().sp,
                          .size = event_data.dyn_size,
                          .data = std::move(event_data.data)};
@@ -721,6 +856,9 @@ void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp, const MmapPerfEven
   ORBIT_CHECK(listener_ != nullptr);
   ORBIT_CHECK(current_maps_ != nullptr);
 
+  // Unwinding in progress reads current_maps_, so wait for it to finish before modifying them.
+  SendAllPendingOutputs();
+
   // PERF_RECORD_MMAP events do not contain the flags, but only distinguish between executable and
   // non-executable. This is all we need, so simply assume PROT_READ | PROT_EXEC for executable
   // mappings and PROT_READ for non-executable mappings. If we wanted the exact flags, we could
@@ -11,12 +11,15 @@
 #include <sys/types.h>
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <map>
 #include <memory>
 #include <optional>
 #include <tuple>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include "GrpcProtos/capture.pb.h"
@@ -25,7 +28,9 @@
 #include "LibunwindstackUnwinder.h"
 #include "LinuxTracing/TracerListener.h"
 #include "LinuxTracing/UserSpaceInstrumentationAddresses.h"
+#include "OrbitBase/Future.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadPool.h"
 #include "PerfEvent.h"
 #include "PerfEventRecords.h"
 #include "PerfEventVisitor.h"
@@ -47,6 +52,8 @@ namespace orbit_linux_tracing {
 // addresses before they are hijacked, and patches them into the time-based stack samples. Such
 // return addresses can be retrieved by getting the eight bytes at the top of the stack when
 // entering a dynamically instrumented function (e.g., when hitting uprobes).
+// Optionally, the DWARF-based unwinding of stack samples can be offloaded to a pool of threads, see
+// SetUnwindingThreadCount.
 class UprobesUnwindingVisitor : public PerfEventVisitor {
  public:
   explicit UprobesUnwindingVisitor(
@@ -78,6 +85,8 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
   UprobesUnwindingVisitor(UprobesUnwindingVisitor&&) = default;
   UprobesUnwindingVisitor& operator=(UprobesUnwindingVisitor&&) = default;
 
+  ~UprobesUnwindingVisitor() override;
+
   void SetUnwindErrorsAndDiscardedSamplesCounters(
       std::atomic<uint64_t>* unwind_error_counter,
       std::atomic<uint64_t>* samples_in_uretprobes_counter) {
@@ -85,7 +94,22 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
     samples_in_uretprobes_counter_ = samples_in_uretprobes_counter;
   }
 
-  void Visit(uint64_t event_timestamp, const StackSamplePerfEventData& event_data) override;
+  // With a non-zero `thread_count`, stack samples are unwound on that many worker threads instead
+  // of in Visit. Everything that depends on the order of events, like patching the return addresses
+  // hijacked by uretprobes, still happens in Visit. The resulting callstack samples, and the
+  // function calls that follow them, are buffered and sent to the listener in the original order.
+  // Unwinding reads the maps concurrently, so all unwinding in progress is waited for before
+  // processing a new mapping: each sample is unwound with the maps as they were when it was taken.
+  // Stack samples of threads with stack slices from uprobes, as well as all other callstacks, are
+  // still computed in Visit, after sending all previous outputs.
+  // Can only be called once, before the first event is visited.
+  void SetUnwindingThreadCount(uint32_t thread_count);
+
+  // Waits for all the stack samples still being unwound and sends them, and any output delayed
+  // after them, to the listener. Call this after the last event was visited.
+  void SendAllPendingOutputs();
+
+  void Visit(uint64_t event_timestamp, StackSamplePerfEventData& event_data) override;
   void Visit(uint64_t event_timestamp,
              const SchedWakeupWithCallchainPerfEventData& event_data) override;
   void Visit(uint64_t event_timestamp,
@@ -96,7 +120,7 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
              const SchedSwitchWithStackPerfEventData& event_data) override;
   void Visit(uint64_t event_timestamp, const CallchainSamplePerfEventData& event_data) override;
   void Visit(uint64_t event_timestamp, const UprobesPerfEventData& event_data) override;
-  void Visit(uint64_t event_timestamp, const UprobesWithStackPerfEventData& event_data) override;
+  void Visit(uint64_t event_timestamp, UprobesWithStackPerfEventData& event_data) override;
   void Visit(uint64_t event_timestamp,
              const UprobesWithArgumentsPerfEventData& event_data) override;
   void Visit(uint64_t event_timestamp, const UretprobesPerfEventData& event_data) override;
@@ -113,7 +137,7 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
   struct StackSlice {
     uint64_t start_address;
     uint64_t size;
-    std::unique_ptr<uint8_t[]> data;
+    PooledArray<uint8_t> data;
   };
 
   void OnUprobes(uint64_t timestamp_ns, pid_t tid, uint32_t cpu, uint64_t sp, uint64_t ip,
@@ -131,6 +155,22 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
 
   void SendFullAddressInfoToListener(const unwindstack::FrameData& libunwindstack_frame);
 
+  // Returns false if the result has no frames, and then sends nothing.
+  [[nodiscard]] bool SendFullAddressInfosToListener(
+      const LibunwindstackResult& libunwindstack_result);
+  // Doesn't call the listener, so that it can fill in a sample created in place.
+  void FillCallstack(const LibunwindstackResult& libunwindstack_result,
+                     orbit_grpc_protos::Callstack* resulting_callstack);
+  [[nodiscard]] bool ProcessLibunwindstackResult(const LibunwindstackResult& libunwindstack_result,
+                                                 orbit_grpc_protos::Callstack* resulting_callstack);
+  void SendCallstackSample(uint32_t pid, uint32_t tid, uint64_t timestamp_ns,
+                           const LibunwindstackResult& libunwindstack_result);
+
+  // Sends the pending outputs first, as the result is used right away.
+  template <typename StackPerfEventDataT>
+  [[nodiscard]] LibunwindstackResult ComputeLibunwindstackResult(
+      const StackPerfEventDataT& event_data, bool offline_memory_only = false);
+
   template <typename StackPerfEventDataT>
   [[nodiscard]] bool UnwindStack(const StackPerfEventDataT& event,
                                  orbit_grpc_protos::Callstack* resulting_callstack,
@@ -140,6 +180,12 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
   [[nodiscard]] bool VisitCallchainEvent(const CallchainPerfEventDataT& event_data,
                                          orbit_grpc_protos::Callstack* resulting_callstack);
 
+  void ScheduleStackSampleUnwinding(uint64_t event_timestamp, StackSamplePerfEventData& event_data);
+  void SendFunctionCallInOrder(orbit_grpc_protos::FunctionCall function_call);
+  [[nodiscard]] bool IsFirstPendingOutputReady() const;
+  void SendFirstPendingOutput();
+  void SendReadyPendingOutputs();
+
   TracerListener* listener_;
 
   UprobesFunctionCallManager* function_call_manager_;
@@ -161,6 +207,24 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
 
   absl::flat_hash_map<pid_t, absl::flat_hash_map<uint64_t, StackSlice>>
       thread_id_stream_id_to_stack_slices_{};
+
+  // A stack sample being unwound on unwinding_thread_pool_.
+  struct PendingCallstackSample {
+    orbit_base::Future<LibunwindstackResult> libunwindstack_result;
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t timestamp_ns;
+  };
+  // Outputs for the listener that are delayed to preserve the order of events, because they are
+  // stack samples still being unwound or they follow one.
+  using PendingOutput = std::variant<PendingCallstackSample, orbit_grpc_protos::FunctionCall>;
+
+  // Bounds the memory used by buffered outputs when unwinding can't keep up with the samples.
+  static constexpr size_t kMaxPendingOutputsPerUnwindingThread = 256;
+
+  std::shared_ptr<orbit_base::ThreadPool> unwinding_thread_pool_;
+  size_t max_pending_outputs_ = 0;
+  std::deque<PendingOutput> pending_outputs_;
 };
 
 }  // namespace orbit_linux_tracing
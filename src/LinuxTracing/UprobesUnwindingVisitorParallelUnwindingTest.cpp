@@ -0,0 +1,244 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/notification.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <unwindstack/Error.h>
+#include <unwindstack/MapInfo.h>
+#include <unwindstack/Unwinder.h>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GrpcProtos/capture.pb.h"
+#include "LibunwindstackMultipleOfflineAndProcessMemory.h"
+#include "LibunwindstackUnwinder.h"
+#include "MockTracerListener.h"
+#include "OrbitBase/Logging.h"
+#include "PerfEvent.h"
+#include "PerfEventRecords.h"
+#include "UprobesFunctionCallManager.h"
+#include "UprobesUnwindingVisitor.h"
+#include "UprobesUnwindingVisitorTestCommon.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+class UprobesUnwindingVisitorParallelUnwindingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    EXPECT_CALL(maps_, Find).WillRepeatedly(::testing::Return(kTargetMapInfo));
+    EXPECT_CALL(maps_, Get).WillRepeatedly(::testing::Return(nullptr));
+    EXPECT_CALL(return_address_manager_, PatchSample).WillRepeatedly(::testing::Return());
+    EXPECT_CALL(listener_, OnAddressInfo).Times(::testing::AnyNumber());
+
+    visitor_.SetUnwindingThreadCount(kUnwindingThreadCount);
+  }
+
+  [[nodiscard]] static StackSamplePerfEvent BuildStackSamplePerfEvent(uint64_t timestamp,
+                                                                      pid_t pid) {
+    constexpr uint64_t kTotalNumOfRegisters =
+        sizeof(RingBufferSampleRegsUserAll) / sizeof(uint64_t);
+    constexpr uint64_t kStackSize = 13;
+    return StackSamplePerfEvent{
+        .timestamp = timestamp,
+        .data =
+            {
+                .pid = pid,
+                .tid = pid,
+                .regs = std::make_unique<uint64_t[]>(kTotalNumOfRegisters),
+                .dyn_size = kStackSize,
+                .data = std::make_unique<uint8_t[]>(kStackSize),
+            },
+    };
+  }
+
+  [[nodiscard]] LibunwindstackResult MakeCompleteLibunwindstackResult() const {
+    return LibunwindstackResult{{kFrame1, kFrame2}, {}, unwindstack::ErrorCode::ERROR_NONE};
+  }
+
+  static constexpr uint32_t kUnwindingThreadCount = 4;
+
+  MockTracerListener listener_;
+  UprobesFunctionCallManager function_call_manager_;
+  MockUprobesReturnAddressManager return_address_manager_{nullptr};
+  MockLibunwindstackMaps maps_;
+  MockLibunwindstackUnwinder unwinder_;
+  MockLeafFunctionCallManager leaf_function_call_manager_{128};
+  std::map<uint64_t, uint64_t> absolute_address_to_size_of_functions_to_stop_at_{};
+
+  UprobesUnwindingVisitor visitor_{&listener_,
+                                   &function_call_manager_,
+                                   &return_address_manager_,
+                                   &maps_,
+                                   &unwinder_,
+                                   &leaf_function_call_manager_,
+                                   nullptr,
+                                   &absolute_address_to_size_of_functions_to_stop_at_};
+
+  const std::shared_ptr<unwindstack::MapInfo> kTargetMapInfo =
+      unwindstack::MapInfo::Create(100, 400, 0, PROT_EXEC | PROT_READ, "target");
+  const unwindstack::FrameData kFrame1{
+      .pc = 100,
+      .function_name = "foo",
+      .function_offset = 0,
+      .map_info = kTargetMapInfo,
+  };
+  const unwindstack::FrameData kFrame2{
+      .pc = 200,
+      .function_name = "bar",
+      .function_offset = 0,
+      .map_info = kTargetMapInfo,
+  };
+};
+
+}  // namespace
+
+TEST_F(UprobesUnwindingVisitorParallelUnwindingTest, CallstackSamplesAreSentInOrder) {
+  constexpr int kSampleCount = 100;
+
+  // Samples taken earlier take longer to unwind, so that they finish unwinding out of order.
+  EXPECT_CALL(unwinder_, Unwind)
+      .Times(kSampleCount)
+      .WillRepeatedly([this](pid_t pid, unwindstack::Maps* /*maps*/,
+                             const std::array<uint64_t, PERF_REG_X86_64_MAX>& /*perf_regs*/,
+                             absl::Span<const StackSliceView> stack_slices,
+                             bool /*offline_memory_only*/, size_t /*max_frames*/) {
+        EXPECT_EQ(stack_slices.size(), 1);
+        EXPECT_NE(stack_slices[0].data(), nullptr);
+        absl::SleepFor(absl::Microseconds(10 * (kSampleCount - pid)));
+        return MakeCompleteLibunwindstackResult();
+      });
+
+  std::vector<uint64_t> actual_timestamps;
+  EXPECT_CALL(listener_, OnCallstackSample)
+      .Times(kSampleCount)
+      .WillRepeatedly([&actual_timestamps](orbit_grpc_protos::FullCallstackSample sample) {
+        EXPECT_EQ(sample.callstack().type(), orbit_grpc_protos::Callstack::kComplete);
+        EXPECT_THAT(sample.callstack().pcs(), ::testing::ElementsAre(100, 200));
+        actual_timestamps.push_back(sample.timestamp_ns());
+      });
+
+  std::vector<uint64_t> expected_timestamps;
+  for (int i = 0; i < kSampleCount; ++i) {
+    const uint64_t timestamp = 1000 + i;
+    expected_timestamps.push_back(timestamp);
+    PerfEvent{BuildStackSamplePerfEvent(timestamp, i)}.Accept(&visitor_);
+  }
+  visitor_.SendAllPendingOutputs();
+
+  EXPECT_EQ(actual_timestamps, expected_timestamps);
+}
+
+TEST_F(UprobesUnwindingVisitorParallelUnwindingTest,
+       FunctionCallFollowingPendingCallstackSampleIsSentAfterIt) {
+  constexpr pid_t kPid = 42;
+  absl::Notification unwinding_can_finish;
+  EXPECT_CALL(unwinder_, Unwind).Times(1).WillOnce([&](auto&&... /*args*/) {
+    unwinding_can_finish.WaitForNotification();
+    return MakeCompleteLibunwindstackResult();
+  });
+
+  std::vector<std::string> actual_outputs;
+  EXPECT_CALL(listener_, OnCallstackSample).Times(1).WillOnce([&actual_outputs](auto&& /*arg*/) {
+    actual_outputs.emplace_back("callstack sample");
+  });
+  EXPECT_CALL(listener_, OnFunctionCall).Times(1).WillOnce([&actual_outputs](auto&& /*arg*/) {
+    actual_outputs.emplace_back("function call");
+  });
+  EXPECT_CALL(return_address_manager_, ProcessFunctionEntry).Times(1);
+  EXPECT_CALL(return_address_manager_, ProcessFunctionExit).Times(1);
+
+  UserSpaceFunctionEntryPerfEvent function_entry{
+      .timestamp = 100,
+      .data =
+          {
+              .pid = kPid,
+              .tid = kPid,
+              .function_id = 1,
+              .sp = 0x30,
+              .return_address = 0x02,
+          },
+  };
+  PerfEvent{function_entry}.Accept(&visitor_);
+  PerfEvent{BuildStackSamplePerfEvent(200, kPid)}.Accept(&visitor_);
+  UserSpaceFunctionExitPerfEvent function_exit{
+      .timestamp = 300,
+      .data =
+          {
+              .pid = kPid,
+              .tid = kPid,
+          },
+  };
+  PerfEvent{function_exit}.Accept(&visitor_);
+  EXPECT_TRUE(actual_outputs.empty());
+
+  unwinding_can_finish.Notify();
+  visitor_.SendAllPendingOutputs();
+  EXPECT_THAT(actual_outputs, ::testing::ElementsAre("callstack sample", "function call"));
+}
+
+TEST_F(UprobesUnwindingVisitorParallelUnwindingTest, NewMappingWaitsForPendingUnwinding) {
+  constexpr pid_t kPid = 42;
+  EXPECT_CALL(unwinder_, Unwind).Times(1).WillOnce([this](auto&&... /*args*/) {
+    absl::SleepFor(absl::Milliseconds(50));
+    return MakeCompleteLibunwindstackResult();
+  });
+
+  bool callstack_sample_sent = false;
+  EXPECT_CALL(listener_, OnCallstackSample)
+      .Times(1)
+      .WillOnce([&callstack_sample_sent](auto&& /*arg*/) { callstack_sample_sent = true; });
+  // The maps can only be modified once the unwinding that reads them has finished.
+  EXPECT_CALL(maps_, AddAndSort).Times(1).WillOnce([&callstack_sample_sent](auto&&... /*args*/) {
+    EXPECT_TRUE(callstack_sample_sent);
+  });
+
+  PerfEvent{BuildStackSamplePerfEvent(100, kPid)}.Accept(&visitor_);
+  MmapPerfEvent mmap_event{
+      .timestamp = 200,
+      .data =
+          {
+              .address = 0x1000,
+              .length = 0x1000,
+              .page_offset = 0,
+              .filename = "/path/to/data",
+              .executable = false,
+              .pid = kPid,
+          },
+  };
+  PerfEvent{std::move(mmap_event)}.Accept(&visitor_);
+  EXPECT_TRUE(callstack_sample_sent);
+}
+
+TEST_F(UprobesUnwindingVisitorParallelUnwindingTest, WithoutUnwindingThreadsSamplesAreSentInVisit) {
+  UprobesUnwindingVisitor visitor{&listener_,
+                                  &function_call_manager_,
+                                  &return_address_manager_,
+                                  &maps_,
+                                  &unwinder_,
+                                  &leaf_function_call_manager_,
+                                  nullptr,
+                                  &absolute_address_to_size_of_functions_to_stop_at_};
+  visitor.SetUnwindingThreadCount(0);
+
+  EXPECT_CALL(unwinder_, Unwind).Times(1).WillOnce([this](auto&&... /*args*/) {
+    return MakeCompleteLibunwindstackResult();
+  });
+  EXPECT_CALL(listener_, OnCallstackSample).Times(1);
+  PerfEvent{BuildStackSamplePerfEvent(100, 42)}.Accept(&visitor);
+  ::testing::Mock::VerifyAndClearExpectations(&listener_);
+}
+
+}  // namespace orbit_linux_tracing
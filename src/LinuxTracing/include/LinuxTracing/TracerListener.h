@@ -5,6 +5,10 @@
 #ifndef LINUX_TRACING_TRACER_LISTENER_H_
 #define LINUX_TRACING_TRACER_LISTENER_H_
 
+#include <absl/functional/function_ref.h>
+
+#include <utility>
+
 #include "GrpcProtos/capture.pb.h"
 
 namespace orbit_linux_tracing {
@@ -14,6 +18,17 @@ class TracerListener {
   virtual ~TracerListener() = default;
   virtual void OnSchedulingSlice(orbit_grpc_protos::SchedulingSlice scheduling_slice) = 0;
   virtual void OnCallstackSample(orbit_grpc_protos::FullCallstackSample callstack_sample) = 0;
+  // The Tracer passes callstack samples, by far the most frequent events, through this method. The
+  // listener creates the sample where it stores its events, e.g., on the Arena of a batch, and
+  // `fill_callstack_sample` writes the sample there directly, so that the sample is neither
+  // allocated on the heap nor copied. `fill_callstack_sample` doesn't call the listener. If it
+  // returns false, the sample is discarded. By default, the sample is passed to OnCallstackSample.
+  virtual void OnCallstackSampleInPlace(
+      absl::FunctionRef<bool(orbit_grpc_protos::FullCallstackSample*)> fill_callstack_sample) {
+    orbit_grpc_protos::FullCallstackSample callstack_sample;
+    if (!fill_callstack_sample(&callstack_sample)) return;
+    OnCallstackSample(std::move(callstack_sample));
+  }
   virtual void OnThreadStateSliceCallstack(
       orbit_grpc_protos::ThreadStateSliceCallstack callstack) = 0;
   virtual void OnFunctionCall(orbit_grpc_protos::FunctionCall function_call) = 0;
@@ -803,6 +803,128 @@ TEST(LinuxTracingIntegrationTest, CallstackSamplesAndAddressInfos) {
       inner_function_virtual_address_range, samples_per_second, &address_infos_received);
 }
 
+TEST(LinuxTracingIntegrationTest, CallstackSamplesWithMultipleRingBufferReaders) {
+  if (!CheckIsRunningAsRoot()) {
+    GTEST_SKIP();
+  }
+  LinuxTracingIntegrationTestFixture fixture;
+
+  const auto& [outer_function_virtual_address_range, inner_function_virtual_address_range] =
+      GetOuterAndInnerFunctionVirtualAddressRanges(fixture.GetPuppetPidNative());
+  const std::filesystem::path& executable_path =
+      GetExecutableBinaryPath(fixture.GetPuppetPidNative());
+
+  orbit_grpc_protos::CaptureOptions capture_options = fixture.BuildDefaultCaptureOptions();
+  capture_options.set_ring_buffer_reader_thread_count(4);
+  const double samples_per_second = capture_options.samples_per_second();
+
+  std::vector<orbit_grpc_protos::ProducerCaptureEvent> events =
+      TraceAndGetEvents(&fixture, PuppetConstants::kCallOuterFunctionCommand, capture_options);
+
+  // Events from different ring buffers are read by different threads, but they still need to
+  // reach the listener in order.
+  VerifyOrderOfAllEvents(events);
+
+  VerifyNoLostOrDiscardedEvents(events);
+
+  VerifyErrorsWithPerfEventOpenEvent(events);
+
+  VerifyNoWarningInstrumentingWithUprobesEvents(events);
+
+  absl::flat_hash_set<uint64_t> address_infos_received =
+      VerifyAndGetAddressInfosWithOuterAndInnerFunction(events, executable_path,
+                                                        outer_function_virtual_address_range,
+                                                        inner_function_virtual_address_range);
+
+  VerifyCallstackSamplesWithOuterAndInnerFunctionForDwarfUnwinding(
+      events, fixture.GetPuppetPid(), outer_function_virtual_address_range,
+      inner_function_virtual_address_range, samples_per_second, &address_infos_received);
+
+  bool scheduling_slice_of_puppet_found = false;
+  for (const orbit_grpc_protos::ProducerCaptureEvent& event : events) {
+    if (event.has_scheduling_slice() && event.scheduling_slice().pid() == fixture.GetPuppetPid()) {
+      scheduling_slice_of_puppet_found = true;
+      break;
+    }
+  }
+  EXPECT_TRUE(scheduling_slice_of_puppet_found);
+}
+
+TEST(LinuxTracingIntegrationTest, CallstackSamplesWithEpollRingBufferWaitMethod) {
+  if (!CheckIsRunningAsRoot()) {
+    GTEST_SKIP();
+  }
+  LinuxTracingIntegrationTestFixture fixture;
+
+  const auto& [outer_function_virtual_address_range, inner_function_virtual_address_range] =
+      GetOuterAndInnerFunctionVirtualAddressRanges(fixture.GetPuppetPidNative());
+  const std::filesystem::path& executable_path =
+      GetExecutableBinaryPath(fixture.GetPuppetPidNative());
+
+  orbit_grpc_protos::CaptureOptions capture_options = fixture.BuildDefaultCaptureOptions();
+  capture_options.set_ring_buffer_wait_method(orbit_grpc_protos::CaptureOptions::kEpoll);
+  const double samples_per_second = capture_options.samples_per_second();
+
+  std::vector<orbit_grpc_protos::ProducerCaptureEvent> events =
+      TraceAndGetEvents(&fixture, PuppetConstants::kCallOuterFunctionCommand, capture_options);
+
+  // Ring buffers that don't reach the wakeup watermark are only read on timeout of epoll_wait, but
+  // this must still happen early enough for no event to be discarded as out of order.
+  VerifyOrderOfAllEvents(events);
+
+  VerifyNoLostOrDiscardedEvents(events);
+
+  VerifyErrorsWithPerfEventOpenEvent(events);
+
+  VerifyNoWarningInstrumentingWithUprobesEvents(events);
+
+  absl::flat_hash_set<uint64_t> address_infos_received =
+      VerifyAndGetAddressInfosWithOuterAndInnerFunction(events, executable_path,
+                                                        outer_function_virtual_address_range,
+                                                        inner_function_virtual_address_range);
+
+  VerifyCallstackSamplesWithOuterAndInnerFunctionForDwarfUnwinding(
+      events, fixture.GetPuppetPid(), outer_function_virtual_address_range,
+      inner_function_virtual_address_range, samples_per_second, &address_infos_received);
+}
+
+TEST(LinuxTracingIntegrationTest, CallstackSamplesWithUnwindingThreads) {
+  if (!CheckIsRunningAsRoot()) {
+    GTEST_SKIP();
+  }
+  LinuxTracingIntegrationTestFixture fixture;
+
+  const auto& [outer_function_virtual_address_range, inner_function_virtual_address_range] =
+      GetOuterAndInnerFunctionVirtualAddressRanges(fixture.GetPuppetPidNative());
+  const std::filesystem::path& executable_path =
+      GetExecutableBinaryPath(fixture.GetPuppetPidNative());
+
+  orbit_grpc_protos::CaptureOptions capture_options = fixture.BuildDefaultCaptureOptions();
+  capture_options.set_unwinding_thread_count(4);
+  const double samples_per_second = capture_options.samples_per_second();
+
+  std::vector<orbit_grpc_protos::ProducerCaptureEvent> events =
+      TraceAndGetEvents(&fixture, PuppetConstants::kCallOuterFunctionCommand, capture_options);
+
+  // Samples are unwound by different threads, but they still need to reach the listener in order.
+  VerifyOrderOfAllEvents(events);
+
+  VerifyNoLostOrDiscardedEvents(events);
+
+  VerifyErrorsWithPerfEventOpenEvent(events);
+
+  VerifyNoWarningInstrumentingWithUprobesEvents(events);
+
+  absl::flat_hash_set<uint64_t> address_infos_received =
+      VerifyAndGetAddressInfosWithOuterAndInnerFunction(events, executable_path,
+                                                        outer_function_virtual_address_range,
+                                                        inner_function_virtual_address_range);
+
+  VerifyCallstackSamplesWithOuterAndInnerFunctionForDwarfUnwinding(
+      events, fixture.GetPuppetPid(), outer_function_virtual_address_range,
+      inner_function_virtual_address_range, samples_per_second, &address_infos_received);
+}
+
 TEST(LinuxTracingIntegrationTest, CallstackSamplesTogetherWithFunctionCalls) {
   if (!CheckIsRunningAsRoot()) {
     GTEST_SKIP();
@@ -0,0 +1,116 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/time/time.h>
+#include <gtest/gtest.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "OrbitBase/CanceledOr.h"
+#include "OrbitBase/ParallelFor.h"
+#include "OrbitBase/StopSource.h"
+#include "OrbitBase/ThreadPool.h"
+
+namespace orbit_base {
+
+namespace {
+
+class ParallelForTest : public testing::Test {
+ protected:
+  void TearDown() override { thread_pool_->ShutdownAndWait(); }
+
+  std::shared_ptr<ThreadPool> thread_pool_ = ThreadPool::Create(4, 4, absl::Seconds(1));
+};
+
+}  // namespace
+
+TEST_F(ParallelForTest, CallsFunctionOnceForEveryIndex) {
+  for (size_t grain_size : {0, 1, 7, 1000, 5000}) {
+    constexpr size_t kSize = 1000;
+    std::vector<std::atomic<int>> calls(kSize);
+    CanceledOr<void> result = ParallelFor(
+        thread_pool_.get(), kSize, [&](size_t index) { ++calls[index]; }, {grain_size});
+    EXPECT_FALSE(IsCanceled(result));
+    for (const std::atomic<int>& call_count : calls) {
+      EXPECT_EQ(call_count, 1);
+    }
+  }
+}
+
+TEST_F(ParallelForTest, EmptyRange) {
+  CanceledOr<void> result =
+      ParallelFor(thread_pool_.get(), 0, [](size_t /*index*/) { FAIL(); });
+  EXPECT_FALSE(IsCanceled(result));
+}
+
+TEST_F(ParallelForTest, NestedParallelForCompletes) {
+  constexpr size_t kSize = 64;
+  std::atomic<size_t> calls = 0;
+  (void)ParallelFor(
+      thread_pool_.get(), kSize,
+      [&](size_t /*outer_index*/) {
+        (void)ParallelFor(
+            thread_pool_.get(), kSize, [&](size_t /*inner_index*/) { ++calls; }, {1});
+      },
+      {1});
+  EXPECT_EQ(calls, kSize * kSize);
+}
+
+TEST_F(ParallelForTest, StopsStartingChunksWhenStopIsRequested) {
+  constexpr size_t kSize = 1000;
+  StopSource stop_source;
+  std::atomic<size_t> calls = 0;
+  CanceledOr<void> result = ParallelFor(
+      thread_pool_.get(), kSize,
+      [&](size_t /*index*/) {
+        if (++calls == 10) stop_source.RequestStop();
+      },
+      {/*grain_size=*/1, stop_source.GetStopToken()});
+  EXPECT_TRUE(IsCanceled(result));
+  EXPECT_LT(calls, kSize);
+}
+
+TEST_F(ParallelForTest, TransformReduceComputesSum) {
+  for (size_t grain_size : {0, 1, 13, 100'000}) {
+    constexpr size_t kSize = 10'000;
+    CanceledOr<uint64_t> sum = ParallelTransformReduce(
+        thread_pool_.get(), kSize, uint64_t{0}, std::plus<>{},
+        [](size_t index) { return static_cast<uint64_t>(index); }, {grain_size});
+    EXPECT_EQ(GetNotCanceled(sum), kSize * (kSize - 1) / 2);
+  }
+}
+
+TEST_F(ParallelForTest, TransformReduceKeepsOrderOfNonCommutativeReduce) {
+  constexpr size_t kSize = 500;
+  CanceledOr<std::string> concatenation = ParallelTransformReduce(
+      thread_pool_.get(), kSize, std::string{"#"}, std::plus<>{},
+      [](size_t index) { return std::to_string(index % 10); }, {/*grain_size=*/3});
+
+  std::string expected = "#";
+  for (size_t i = 0; i < kSize; ++i) expected += std::to_string(i % 10);
+  EXPECT_EQ(GetNotCanceled(concatenation), expected);
+}
+
+TEST_F(ParallelForTest, TransformReduceOfEmptyRangeReturnsInit) {
+  CanceledOr<int> result = ParallelTransformReduce(
+      thread_pool_.get(), 0, 42, std::plus<>{}, [](size_t /*index*/) { return 1; });
+  EXPECT_EQ(GetNotCanceled(result), 42);
+}
+
+TEST_F(ParallelForTest, TransformReduceIsCanceledWhenStopWasRequested) {
+  StopSource stop_source;
+  stop_source.RequestStop();
+  CanceledOr<int> result = ParallelTransformReduce(
+      thread_pool_.get(), 100, 0, std::plus<>{}, [](size_t /*index*/) { return 1; },
+      {/*grain_size=*/0, stop_source.GetStopToken()});
+  EXPECT_TRUE(IsCanceled(result));
+}
+
+}  // namespace orbit_base
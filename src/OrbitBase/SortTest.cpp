@@ -2,15 +2,22 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/time/time.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include <algorithm>
 #include <functional>
 #include <iterator>
+#include <memory>
+#include <random>
+#include <string>
 #include <vector>
 
 #include "OrbitBase/Sort.h"
+#include "OrbitBase/ThreadPool.h"
 
 namespace {
 struct Struct {
@@ -80,4 +87,44 @@ TEST(SortTest, SortIsCorrect) {
       });
 }
 
-}  // namespace orbit_base
\ No newline at end of file
+TEST(SortTest, ParallelStableSortIsCorrectAndStable) {
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create(4, 4, absl::Seconds(1));
+  std::mt19937 random_engine{42};
+  for (size_t size : {0, 1, 10, 1000, 10'000, 123'457}) {
+    for (size_t grain_size : {0, 1, 3, 100, 2000}) {
+      std::vector<Struct> values;
+      std::uniform_int_distribution<int> distribution(0, static_cast<int>(size / 10));
+      for (size_t i = 0; i < size; ++i) {
+        values.push_back({distribution(random_engine), static_cast<int>(i)});
+      }
+      const auto comparator = [](const Struct& a, const Struct& b) { return a.value > b.value; };
+
+      std::vector<Struct> expected = values;
+      std::stable_sort(expected.begin(), expected.end(), comparator);
+      ParallelStableSort(thread_pool.get(), values.begin(), values.end(), comparator, grain_size);
+
+      EXPECT_EQ(values, expected) << "size=" << size << ", grain_size=" << grain_size;
+    }
+  }
+  thread_pool->ShutdownAndWait();
+}
+
+TEST(SortTest, ParallelStableSortMovesElements) {
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create(2, 2, absl::Seconds(1));
+  constexpr int kSize = 5000;
+  std::vector<std::unique_ptr<int>> values;
+  for (int i = 0; i < kSize; ++i) values.push_back(std::make_unique<int>((i * 7919) % kSize));
+
+  ParallelStableSort(
+      thread_pool.get(), values.begin(), values.end(),
+      [](const std::unique_ptr<int>& a, const std::unique_ptr<int>& b) { return *a < *b; },
+      /*grain_size=*/64);
+
+  for (int i = 0; i < kSize; ++i) {
+    ASSERT_NE(values[i], nullptr);
+    EXPECT_EQ(*values[i], i);
+  }
+  thread_pool->ShutdownAndWait();
+}
+
+}  // namespace orbit_base
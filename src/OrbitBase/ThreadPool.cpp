@@ -14,7 +14,10 @@
 #include <absl/time/time.h>
 
 #include <algorithm>
-#include <list>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <thread>
 #include <type_traits>
 #include <utility>
@@ -30,6 +33,17 @@ ABSL_CONST_INIT absl::Mutex g_default_thread_pool_mutex(absl::kConstInit);
 ABSL_CONST_INIT std::shared_ptr<ThreadPool> g_default_thread_pool
     ABSL_GUARDED_BY(g_default_thread_pool_mutex);
 
+// Actions are distributed over a global injection queue, which receives the actions scheduled from
+// outside of the thread pool, and one queue per worker slot, which receives the actions that a
+// worker thread schedules itself. A worker first takes the newest action from its own queue, then
+// the oldest from the injection queue, and otherwise steals the oldest from another worker's queue.
+// This way fan-out from inside the pool doesn't contend on a single lock and stays on the worker
+// that produced it while the other workers are busy.
+//
+// The number of queued actions that no worker has claimed yet is tracked in action_counts_. A
+// worker first claims an action by moving it from the pending to the busy count and only then
+// looks for it in the queues, so it will always find one. Idle workers sleep on wake_up_ until an
+// action is scheduled, the thread pool is shut down, or thread_ttl expires.
 class ThreadPoolImpl : public ThreadPool {
  public:
   explicit ThreadPoolImpl(size_t thread_pool_min_size, size_t thread_pool_max_size,
@@ -46,48 +60,88 @@ class ThreadPoolImpl : public ThreadPool {
   void Wait() override { WaitInternal(); };
 
  private:
+  struct ActionQueue {
+    absl::Mutex mutex;
+    std::deque<std::unique_ptr<Action>> actions ABSL_GUARDED_BY(mutex);
+  };
+
   void ScheduleImpl(std::unique_ptr<Action> action) override;
   [[nodiscard]] Handle GetExecutorHandle() const override { return executor_handle_.Get(); }
-  bool ActionsAvailableOrShutdownInitiated();
+  [[nodiscard]] bool ShouldCreateWorker() const;
+  [[nodiscard]] size_t GetPendingActions() const {
+    return action_counts_.load() & kPendingActionsMask;
+  }
+  // Claims a pending action and counts the calling worker as busy, in one step.
+  [[nodiscard]] bool TryClaimAction();
+  // Takes an action claimed with TryClaimAction out of the queues.
+  [[nodiscard]] std::unique_ptr<Action> TakeClaimedAction(size_t worker_slot);
   // Blocking call - returns nullptr if the worker thread needs to exit.
-  std::unique_ptr<Action> TakeAction();
-  void CleanupFinishedThreads();
-  void CreateWorker();
-  void WorkerFunction();
+  [[nodiscard]] std::unique_ptr<Action> TakeAction(size_t worker_slot);
+  // Returns true if the calling worker thread has been removed from the pool and needs to exit.
+  [[nodiscard]] bool TryRemoveIdleWorker(size_t worker_slot, bool thread_ttl_expired);
+  void CleanupFinishedThreads() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void CreateWorker() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void WorkerFunction(size_t worker_slot);
 
   // Non-virtual implementations of Shutdown and Wait that can be called from the destructor.
   void ShutdownInternal();
   void WaitInternal();
 
+  // Protects the set of worker threads.
   absl::Mutex mutex_;
-  std::list<std::unique_ptr<Action>> scheduled_actions_;
-  absl::flat_hash_map<std::thread::id, std::thread> worker_threads_;
-  std::vector<std::thread> finished_threads_;
+  absl::flat_hash_map<std::thread::id, std::thread> worker_threads_ ABSL_GUARDED_BY(mutex_);
+  std::vector<std::thread> finished_threads_ ABSL_GUARDED_BY(mutex_);
+  std::vector<size_t> free_worker_slots_ ABSL_GUARDED_BY(mutex_);
+  // Only modified while holding mutex_, but also read without it when scheduling.
+  std::atomic<size_t> number_of_workers_ = 0;
+
+  ActionQueue injection_queue_;
+  // One queue per worker slot, a worker thread owns a slot until it exits.
+  std::unique_ptr<ActionQueue[]> worker_queues_;
+  // The number of pending actions, i.e., queued but not claimed, in the lower 32 bits, and the
+  // number of busy workers, i.e., that claimed an action and didn't finish executing it, in the
+  // upper 32 bits. Keeping both in one atomic means that a worker that claims an action is never
+  // seen as both idle and not having claimed it, which ShouldCreateWorker relies on.
+  static constexpr uint64_t kPendingActionsMask = 0xFFFF'FFFF;
+  static constexpr uint64_t kOnePendingAction = 1;
+  static constexpr uint64_t kOneBusyThread = uint64_t{1} << 32;
+  std::atomic<uint64_t> action_counts_ = 0;
+
+  absl::Mutex sleep_mutex_;
+  absl::CondVar wake_up_;
+  std::atomic<size_t> sleeping_threads_ = 0;
+
   size_t thread_pool_min_size_;
   size_t thread_pool_max_size_;
   absl::Duration thread_ttl_;
-  size_t idle_threads_;
-  bool shutdown_initiated_;
+  std::atomic<bool> shutdown_initiated_ = false;
   std::function<void(const std::unique_ptr<Action>&)> run_action_ = nullptr;
 
   Executor::ScopedHandle executor_handle_{this};
 };
 
+// The thread pool and the worker slot of the current thread, if it is a worker thread.
+thread_local ThreadPoolImpl* current_thread_pool = nullptr;
+thread_local size_t current_worker_slot = 0;
+
 ThreadPoolImpl::ThreadPoolImpl(size_t thread_pool_min_size, size_t thread_pool_max_size,
                                absl::Duration thread_ttl,
                                std::function<void(const std::unique_ptr<Action>&)> run_action)
     : thread_pool_min_size_(thread_pool_min_size),
       thread_pool_max_size_(thread_pool_max_size),
       thread_ttl_(thread_ttl),
-      idle_threads_(0),
-      shutdown_initiated_(false),
       run_action_(std::move(run_action)) {
   ORBIT_CHECK(thread_pool_min_size > 0);
   ORBIT_CHECK(thread_pool_max_size >= thread_pool_min_size);
   // Ttl should not be too small
   ORBIT_CHECK(thread_ttl / absl::Nanoseconds(1) >= 1000);
 
+  worker_queues_ = std::make_unique<ActionQueue[]>(thread_pool_max_size);
+
   absl::MutexLock lock(&mutex_);
+  for (size_t slot = thread_pool_max_size; slot > 0; --slot) {
+    free_worker_slots_.push_back(slot - 1);
+  }
   for (size_t i = 0; i < thread_pool_min_size; ++i) {
     CreateWorker();
   }
@@ -95,28 +149,56 @@ ThreadPoolImpl::ThreadPoolImpl(size_t thread_pool_min_size, size_t thread_pool_m
 
 void ThreadPoolImpl::CreateWorker() {
   ORBIT_CHECK(!shutdown_initiated_);
-  idle_threads_++;
-  std::thread thread([this] { WorkerFunction(); });
+  ORBIT_CHECK(!free_worker_slots_.empty());
+  size_t worker_slot = free_worker_slots_.back();
+  free_worker_slots_.pop_back();
+  ++number_of_workers_;
+  std::thread thread([this, worker_slot] { WorkerFunction(worker_slot); });
   std::thread::id thread_id = thread.get_id();
   ORBIT_CHECK(!worker_threads_.contains(thread_id));
   worker_threads_.insert_or_assign(thread_id, std::move(thread));
 }
 
+bool ThreadPoolImpl::ShouldCreateWorker() const {
+  const size_t number_of_workers = number_of_workers_;
+  const uint64_t action_counts = action_counts_;
+  const size_t busy_threads = action_counts / kOneBusyThread;
+  const size_t pending_actions = action_counts & kPendingActionsMask;
+  const size_t idle_threads =
+      number_of_workers > busy_threads ? number_of_workers - busy_threads : 0;
+  return idle_threads < pending_actions && number_of_workers < thread_pool_max_size_;
+}
+
 void ThreadPoolImpl::ScheduleImpl(std::unique_ptr<Action> action) {
   std::unique_ptr<Action> wrapped_action =
       run_action_
           ? CreateAction([this, action = std::move(action)]() mutable { run_action_(action); })
           : std::move(action);
 
-  absl::MutexLock lock(&mutex_);
+  // A worker thread keeps the actions it schedules in its own queue. A single worker has nobody to
+  // share them with, and keeping one queue preserves the order of the actions in that case.
+  ActionQueue& queue = current_thread_pool == this && thread_pool_max_size_ > 1
+                           ? worker_queues_[current_worker_slot]
+                           : injection_queue_;
+  {
+    absl::MutexLock lock(&queue.mutex);
+    queue.actions.push_back(std::move(wrapped_action));
+  }
+  action_counts_ += kOnePendingAction;
+  // This is checked only after the action was published. Workers only exit on shutdown once they
+  // see no pending actions, so either they will still execute this action or this check fails.
   ORBIT_CHECK(!shutdown_initiated_);
 
-  scheduled_actions_.push_back(std::move(wrapped_action));
-  if (idle_threads_ < scheduled_actions_.size() && worker_threads_.size() < thread_pool_max_size_) {
-    CreateWorker();
+  if (ShouldCreateWorker()) {
+    absl::MutexLock lock(&mutex_);
+    if (ShouldCreateWorker()) CreateWorker();
+    CleanupFinishedThreads();
   }
 
-  CleanupFinishedThreads();
+  if (sleeping_threads_ > 0) {
+    absl::MutexLock lock(&sleep_mutex_);
+    wake_up_.Signal();
+  }
 }
 
 void ThreadPoolImpl::CleanupFinishedThreads() {
@@ -132,14 +214,12 @@ size_t ThreadPoolImpl::GetPoolSize() {
   return worker_threads_.size();
 }
 
-size_t ThreadPoolImpl::GetNumberOfBusyThreads() {
-  absl::MutexLock lock(&mutex_);
-  return worker_threads_.size() - idle_threads_;
-}
+size_t ThreadPoolImpl::GetNumberOfBusyThreads() { return action_counts_.load() / kOneBusyThread; }
 
 void ThreadPoolImpl::ShutdownInternal() {
-  absl::MutexLock lock(&mutex_);
   shutdown_initiated_ = true;
+  absl::MutexLock lock(&sleep_mutex_);
+  wake_up_.SignalAll();
 }
 
 void ThreadPoolImpl::WaitInternal() {
@@ -153,58 +233,105 @@ void ThreadPoolImpl::WaitInternal() {
   CleanupFinishedThreads();
 }
 
-bool ThreadPoolImpl::ActionsAvailableOrShutdownInitiated() {
-  return !scheduled_actions_.empty() || shutdown_initiated_;
+bool ThreadPoolImpl::TryClaimAction() {
+  uint64_t action_counts = action_counts_;
+  while ((action_counts & kPendingActionsMask) > 0) {
+    if (action_counts_.compare_exchange_weak(action_counts,
+                                             action_counts - kOnePendingAction + kOneBusyThread)) {
+      return true;
+    }
+  }
+  return false;
 }
 
-std::unique_ptr<Action> ThreadPoolImpl::TakeAction() {
-  while (true) {
-    if (mutex_.AwaitWithTimeout(
-            absl::Condition(
-                +[](ThreadPoolImpl* self) { return self->ActionsAvailableOrShutdownInitiated(); },
-                this),
-            thread_ttl_)) {
-      break;
+std::unique_ptr<Action> ThreadPoolImpl::TakeClaimedAction(size_t worker_slot) {
+  auto try_take = [](ActionQueue& queue, bool newest) -> std::unique_ptr<Action> {
+    absl::MutexLock lock(&queue.mutex);
+    if (queue.actions.empty()) return nullptr;
+    std::unique_ptr<Action> action;
+    if (newest) {
+      action = std::move(queue.actions.back());
+      queue.actions.pop_back();
+    } else {
+      action = std::move(queue.actions.front());
+      queue.actions.pop_front();
     }
+    return action;
+  };
 
-    // Timed out - check if we need to reduce thread pool.
-    if (worker_threads_.size() > thread_pool_min_size_) {
-      return nullptr;
+  // Every claim corresponds to an action that was published before, but another worker might be
+  // taking that particular one right now, so we might need more than one pass.
+  while (true) {
+    std::unique_ptr<Action> action = try_take(worker_queues_[worker_slot], /*newest=*/true);
+    if (action != nullptr) return action;
+    action = try_take(injection_queue_, /*newest=*/false);
+    if (action != nullptr) return action;
+    for (size_t i = 1; i < thread_pool_max_size_; ++i) {
+      action = try_take(worker_queues_[(worker_slot + i) % thread_pool_max_size_],
+                        /*newest=*/false);
+      if (action != nullptr) return action;
     }
+    std::this_thread::yield();
   }
+}
 
-  if (scheduled_actions_.empty()) {
-    return nullptr;
+bool ThreadPoolImpl::TryRemoveIdleWorker(size_t worker_slot, bool thread_ttl_expired) {
+  absl::MutexLock lock(&mutex_);
+  if (!shutdown_initiated_ &&
+      (!thread_ttl_expired || number_of_workers_ <= thread_pool_min_size_)) {
+    return false;
   }
 
-  std::unique_ptr<Action> action = std::move(scheduled_actions_.front());
-  scheduled_actions_.pop_front();
+  // Pairs with ScheduleImpl, which first publishes an action and then checks the number of workers:
+  // either it sees that this worker is gone and creates a new one, or we see the action here.
+  --number_of_workers_;
+  if (GetPendingActions() > 0) {
+    ++number_of_workers_;
+    return false;
+  }
 
-  return action;
+  // Move this thread from the worker_threads_ to finished_threads_.
+  std::thread::id thread_id = std::this_thread::get_id();
+  auto it = worker_threads_.find(thread_id);
+  ORBIT_CHECK(it != worker_threads_.end());
+  finished_threads_.push_back(std::move(it->second));
+  worker_threads_.erase(it);
+  free_worker_slots_.push_back(worker_slot);
+  return true;
 }
 
-void ThreadPoolImpl::WorkerFunction() {
+std::unique_ptr<Action> ThreadPoolImpl::TakeAction(size_t worker_slot) {
   while (true) {
-    absl::MutexLock lock(&mutex_);
-    std::unique_ptr<Action> action = TakeAction();
-
-    ORBIT_CHECK(idle_threads_ > 0);  // Sanity check
-    --idle_threads_;
-
-    if (!action) {
-      // Move this thread from the worker_threads_ to finished_threads_.
-      std::thread::id thread_id = std::this_thread::get_id();
-      auto it = worker_threads_.find(thread_id);
-      ORBIT_CHECK(it != worker_threads_.end());
-      finished_threads_.push_back(std::move(it->second));
-      worker_threads_.erase(it);
-      break;
+    if (TryClaimAction()) return TakeClaimedAction(worker_slot);
+
+    bool thread_ttl_expired = false;
+    {
+      absl::MutexLock lock(&sleep_mutex_);
+      // Pairs with ScheduleImpl, which first publishes an action and then checks for sleeping
+      // threads: either it sees this thread and signals under sleep_mutex_, or we see the action.
+      ++sleeping_threads_;
+      while (GetPendingActions() == 0 && !shutdown_initiated_ && !thread_ttl_expired) {
+        thread_ttl_expired = wake_up_.WaitWithTimeout(&sleep_mutex_, thread_ttl_);
+      }
+      --sleeping_threads_;
     }
 
-    mutex_.Unlock();
+    if (GetPendingActions() > 0) continue;
+    if (TryRemoveIdleWorker(worker_slot, thread_ttl_expired)) return nullptr;
+  }
+}
+
+void ThreadPoolImpl::WorkerFunction(size_t worker_slot) {
+  current_thread_pool = this;
+  current_worker_slot = worker_slot;
+
+  while (true) {
+    std::unique_ptr<Action> action = TakeAction(worker_slot);
+    if (action == nullptr) break;
+
     action->Execute();
-    mutex_.Lock();
-    ++idle_threads_;
+    action.reset();
+    action_counts_ -= kOneBusyThread;
   }
 }
 
@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <atomic>
 #include <memory>
+#include <thread>
 #include <vector>
 
 #include "OrbitBase/Action.h"
@@ -578,3 +579,123 @@ TEST(ThreadPool, SetDefaultThreadPoolAfterFirstUse) {
 TEST(ThreadPool, SetNullDefaultThreadPool) {
   EXPECT_DEATH(ThreadPool::SetDefaultThreadPool(nullptr), "");
 }
+
+TEST(ThreadPool, WorkerExecutesActionsItScheduledNewestFirst) {
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create(2, 2, absl::Seconds(1));
+
+  // Keep the other worker busy, so that it can't steal.
+  absl::Mutex mutex;
+  bool blocking_action_started = false;
+  bool blocking_action_released = false;
+  thread_pool->Schedule([&] {
+    absl::MutexLock lock(&mutex);
+    blocking_action_started = true;
+    mutex.Await(absl::Condition(&blocking_action_released));
+  });
+  {
+    absl::MutexLock lock(&mutex);
+    mutex.Await(absl::Condition(&blocking_action_started));
+  }
+
+  constexpr size_t kNumberOfActions = 5;
+  std::vector<size_t> execution_order;
+  thread_pool->Schedule([&] {
+    for (size_t i = 0; i < kNumberOfActions; ++i) {
+      thread_pool->Schedule([&, i] {
+        absl::MutexLock lock(&mutex);
+        execution_order.push_back(i);
+      });
+    }
+  });
+
+  {
+    absl::MutexLock lock(&mutex);
+    EXPECT_TRUE(mutex.AwaitWithTimeout(
+        absl::Condition(
+            +[](std::vector<size_t>* order) { return order->size() == kNumberOfActions; },
+            &execution_order),
+        absl::Seconds(5)));
+    EXPECT_EQ(execution_order, (std::vector<size_t>{4, 3, 2, 1, 0}));
+    blocking_action_released = true;
+  }
+
+  thread_pool->ShutdownAndWait();
+}
+
+TEST(ThreadPool, IdleWorkerStealsActionScheduledByBlockedWorker) {
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create(2, 2, absl::Seconds(1));
+
+  absl::Mutex mutex;
+  bool stolen_action_executed = false;
+  bool scheduling_action_finished = false;
+  bool executed_in_time = false;
+  std::thread::id scheduling_thread_id;
+  std::thread::id executing_thread_id;
+  thread_pool->Schedule([&] {
+    absl::MutexLock lock(&mutex);
+    scheduling_thread_id = std::this_thread::get_id();
+    // The action goes to the queue of this worker, which doesn't take it before this returns.
+    thread_pool->Schedule([&] {
+      absl::MutexLock lock(&mutex);
+      executing_thread_id = std::this_thread::get_id();
+      stolen_action_executed = true;
+    });
+    executed_in_time =
+        mutex.AwaitWithTimeout(absl::Condition(&stolen_action_executed), absl::Seconds(5));
+    scheduling_action_finished = true;
+  });
+
+  {
+    absl::MutexLock lock(&mutex);
+    mutex.Await(absl::Condition(&scheduling_action_finished));
+    EXPECT_TRUE(executed_in_time);
+    EXPECT_NE(executing_thread_id, scheduling_thread_id);
+  }
+
+  thread_pool->ShutdownAndWait();
+}
+
+namespace {
+
+struct FanOutState {
+  absl::Mutex mutex;
+  size_t leaves_executed ABSL_GUARDED_BY(mutex) = 0;
+};
+
+void ScheduleFanOut(ThreadPool* thread_pool, size_t depth, FanOutState* state) {
+  constexpr size_t kFanOut = 4;
+  if (depth == 0) {
+    absl::MutexLock lock(&state->mutex);
+    ++state->leaves_executed;
+    return;
+  }
+  for (size_t i = 0; i < kFanOut; ++i) {
+    thread_pool->Schedule(
+        [thread_pool, depth, state] { ScheduleFanOut(thread_pool, depth - 1, state); });
+  }
+}
+
+}  // namespace
+
+TEST(ThreadPool, NestedFanOutExecutesAllActions) {
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create(1, 4, absl::Milliseconds(10));
+
+  // Every action but the leaves schedules four more, down to 4^6 leaves.
+  constexpr size_t kExpectedLeaves = 4096;
+  FanOutState state;
+  thread_pool->Schedule([&] { ScheduleFanOut(thread_pool.get(), 6, &state); });
+
+  {
+    absl::MutexLock lock(&state.mutex);
+    EXPECT_TRUE(state.mutex.AwaitWithTimeout(
+        absl::Condition(
+            +[](size_t* executed) { return *executed == kExpectedLeaves; },
+            &state.leaves_executed),
+        absl::Seconds(10)))
+        << "leaves_executed=" << state.leaves_executed;
+  }
+  EXPECT_LE(thread_pool->GetPoolSize(), 4);
+
+  thread_pool->ShutdownAndWait();
+  EXPECT_EQ(thread_pool->GetNumberOfBusyThreads(), 0);
+}
@@ -0,0 +1,202 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_BASE_PARALLEL_FOR_H_
+#define ORBIT_BASE_PARALLEL_FOR_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <stddef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/CanceledOr.h"
+#include "OrbitBase/Executor.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/StopToken.h"
+
+namespace orbit_base {
+
+struct ParallelForOptions {
+  // The number of consecutive indices that are processed by one task. If zero, it is chosen such
+  // that every thread gets a few chunks, which balances the load when the work per index varies.
+  size_t grain_size = 0;
+  // If set, no new chunks are started once a stop has been requested.
+  std::optional<StopToken> stop_token;
+};
+
+}  // namespace orbit_base
+
+namespace orbit_base_internal {
+
+// Each thread gets this many chunks with the adaptive grain size.
+constexpr size_t kParallelForChunksPerThread = 4;
+
+[[nodiscard]] inline size_t ComputeParallelForGrainSize(
+    size_t size, const orbit_base::ParallelForOptions& options) {
+  if (options.grain_size > 0) return options.grain_size;
+  const size_t number_of_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  const size_t number_of_chunks = number_of_threads * kParallelForChunksPerThread;
+  return std::max<size_t>(1, (size + number_of_chunks - 1) / number_of_chunks);
+}
+
+// Hands out the chunks of a ParallelFor to the calling thread and to the tasks that help it. Tasks
+// that only start once all chunks have been handed out return immediately, so the calling thread
+// only waits for chunks that are being processed and never for tasks that are still queued. This
+// also makes nested ParallelFors on the same executor safe.
+template <typename ChunkFunction>
+class ParallelForState {
+ public:
+  ParallelForState(size_t size, size_t grain_size, const ChunkFunction* chunk_function,
+                   std::optional<orbit_base::StopToken> stop_token)
+      : size_{size},
+        grain_size_{grain_size},
+        number_of_chunks_{(size + grain_size - 1) / grain_size},
+        chunk_function_{chunk_function},
+        stop_token_{std::move(stop_token)} {}
+
+  [[nodiscard]] size_t GetNumberOfChunks() const { return number_of_chunks_; }
+
+  void ProcessChunks() {
+    while (true) {
+      const size_t chunk_index = next_chunk_index_.fetch_add(1);
+      if (chunk_index >= number_of_chunks_) return;
+
+      if (stop_token_.has_value() && stop_token_->IsStopRequested()) {
+        canceled_ = true;
+      } else {
+        const size_t begin = chunk_index * grain_size_;
+        const size_t end = std::min(size_, begin + grain_size_);
+        (*chunk_function_)(begin, end, chunk_index);
+      }
+
+      absl::MutexLock lock(&mutex_);
+      ++finished_chunks_;
+    }
+  }
+
+  // Returns true if any chunk was skipped because a stop was requested.
+  [[nodiscard]] bool WaitUntilAllChunksFinished() {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(
+        +[](ParallelForState* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+          return self->finished_chunks_ == self->number_of_chunks_;
+        },
+        this));
+    return canceled_;
+  }
+
+ private:
+  const size_t size_;
+  const size_t grain_size_;
+  const size_t number_of_chunks_;
+  // Only dereferenced for chunks that have been handed out, which the calling thread waits for.
+  const ChunkFunction* chunk_function_;
+  const std::optional<orbit_base::StopToken> stop_token_;
+  std::atomic<size_t> next_chunk_index_ = 0;
+  std::atomic<bool> canceled_ = false;
+
+  absl::Mutex mutex_;
+  size_t finished_chunks_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+// Calls `chunk_function(begin, end, chunk_index)` for the chunks of [0, size) in parallel on
+// `executor` and on the calling thread. Returns true if it was canceled.
+template <typename ChunkFunction>
+[[nodiscard]] bool ParallelForChunks(orbit_base::Executor* executor, size_t size, size_t grain_size,
+                                     const ChunkFunction& chunk_function,
+                                     std::optional<orbit_base::StopToken> stop_token) {
+  ORBIT_CHECK(executor != nullptr);
+  ORBIT_CHECK(grain_size > 0);
+  if (size == 0) return false;
+
+  auto state = std::make_shared<ParallelForState<ChunkFunction>>(size, grain_size, &chunk_function,
+                                                                 std::move(stop_token));
+  const size_t number_of_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  const size_t number_of_helpers = std::min(state->GetNumberOfChunks(), number_of_threads) - 1;
+  for (size_t i = 0; i < number_of_helpers; ++i) {
+    (void)executor->Schedule([state] { state->ProcessChunks(); });
+  }
+
+  state->ProcessChunks();
+  return state->WaitUntilAllChunksFinished();
+}
+
+}  // namespace orbit_base_internal
+
+namespace orbit_base {
+
+// Calls `function(index)` for every index in [0, size), in parallel on `executor` and on the
+// calling thread, and returns once all calls have returned. Calls for different indices must be
+// independent of each other. Consecutive indices are grouped into chunks of
+// `options.grain_size`. Returns Canceled if a stop was requested through `options.stop_token`
+// before all chunks were started, in which case some indices have not been processed.
+//
+// Example:
+// ```
+// orbit_base::ParallelFor(executor, values.size(), [&](size_t i) { values[i] = Compute(i); });
+// ```
+template <typename Function>
+CanceledOr<void> ParallelFor(Executor* executor, size_t size, Function&& function,
+                             ParallelForOptions options = {}) {
+  const size_t grain_size = orbit_base_internal::ComputeParallelForGrainSize(size, options);
+  const auto chunk_function = [&function](size_t begin, size_t end, size_t /*chunk_index*/) {
+    for (size_t index = begin; index < end; ++index) {
+      function(index);
+    }
+  };
+  if (orbit_base_internal::ParallelForChunks(executor, size, grain_size, chunk_function,
+                                             std::move(options.stop_token))) {
+    return Canceled{};
+  }
+  return std::monostate{};
+}
+
+// Computes `reduce(...reduce(reduce(init, transform(0)), transform(1))..., transform(size - 1))`,
+// where the calls to `transform` run in parallel like in ParallelFor. `reduce` has to be
+// associative, as the results of each chunk are reduced separately before they are combined in
+// order. It does not need to be commutative. Returns Canceled if a stop was requested through
+// `options.stop_token` before all chunks were started.
+//
+// Example:
+// ```
+// uint64_t total_size = orbit_base::GetNotCanceled(orbit_base::ParallelTransformReduce(
+//     executor, modules.size(), uint64_t{0}, std::plus<>{},
+//     [&](size_t i) { return modules[i].file_size(); }));
+// ```
+template <typename T, typename Reduce, typename Transform>
+[[nodiscard]] CanceledOr<T> ParallelTransformReduce(Executor* executor, size_t size, T init,
+                                                    Reduce&& reduce, Transform&& transform,
+                                                    ParallelForOptions options = {}) {
+  const size_t grain_size = orbit_base_internal::ComputeParallelForGrainSize(size, options);
+  std::vector<std::optional<T>> chunk_results((size + grain_size - 1) / grain_size);
+  const auto chunk_function = [&](size_t begin, size_t end, size_t chunk_index) {
+    T result = transform(begin);
+    for (size_t index = begin + 1; index < end; ++index) {
+      result = reduce(std::move(result), transform(index));
+    }
+    chunk_results[chunk_index].emplace(std::move(result));
+  };
+  if (orbit_base_internal::ParallelForChunks(executor, size, grain_size, chunk_function,
+                                             std::move(options.stop_token))) {
+    return Canceled{};
+  }
+
+  T result = std::move(init);
+  for (std::optional<T>& chunk_result : chunk_results) {
+    ORBIT_CHECK(chunk_result.has_value());
+    result = reduce(std::move(result), std::move(chunk_result.value()));
+  }
+  return result;
+}
+
+}  // namespace orbit_base
+
+#endif  // ORBIT_BASE_PARALLEL_FOR_H_
@@ -5,10 +5,18 @@
 #ifndef ORBIT_BASE_SORT_H_
 #define ORBIT_BASE_SORT_H_
 
+#include <stddef.h>
+
 #include <algorithm>
 #include <functional>
+#include <iterator>
 #include <type_traits>
 #include <utility>
+#include <vector>
+
+#include "OrbitBase/Executor.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ParallelFor.h"
 
 namespace orbit_base_internal {
 
@@ -20,6 +28,69 @@ static auto MakeComparator(Comparator&& comparator, Projection&& projection) {
   };
 }
 
+// Runs below this size are sorted and merged by a single task.
+constexpr size_t kMinParallelSortGrainSize = 1024;
+
+// The part of the merge of two adjacent sorted runs that merges [a_begin, a_end) of the first run
+// with [b_begin, b_end) of the second run into the destination, starting at position `output`.
+struct MergePiece {
+  size_t a_begin;
+  size_t a_end;
+  size_t b_begin;
+  size_t b_end;
+  size_t output;
+};
+
+// Merges each pair of adjacent sorted runs of length `run_size` from `source` into `destination`,
+// stably and in parallel. The merges are split into pieces of about `grain_size` elements of the
+// longer run, with the matching range of the other run found by binary search.
+template <typename SourceIt, typename DestinationIt, typename Comparator>
+void ParallelMergeRuns(orbit_base::Executor* executor, SourceIt source, DestinationIt destination,
+                       size_t size, size_t run_size, size_t grain_size,
+                       const Comparator& comparator) {
+  std::vector<MergePiece> pieces;
+  for (size_t a_begin = 0; a_begin < size; a_begin += 2 * run_size) {
+    const size_t a_end = std::min(size, a_begin + run_size);
+    const size_t b_end = std::min(size, a_end + run_size);
+    size_t piece_a_begin = a_begin;
+    size_t piece_b_begin = a_end;
+    while (piece_a_begin < a_end || piece_b_begin < b_end) {
+      size_t piece_a_end = a_end;
+      size_t piece_b_end = b_end;
+      if (a_end - piece_a_begin >= b_end - piece_b_begin) {
+        if (a_end - piece_a_begin > grain_size) {
+          piece_a_end = piece_a_begin + grain_size;
+          // Elements of b that are equal to the split element go after it to keep the merge stable.
+          piece_b_end = std::lower_bound(source + piece_b_begin, source + b_end,
+                                         *(source + piece_a_end), comparator) -
+                        source;
+        }
+      } else if (b_end - piece_b_begin > grain_size) {
+        piece_b_end = piece_b_begin + grain_size;
+        piece_a_end = std::upper_bound(source + piece_a_begin, source + a_end,
+                                       *(source + piece_b_end), comparator) -
+                      source;
+      }
+      pieces.push_back(MergePiece{piece_a_begin, piece_a_end, piece_b_begin, piece_b_end,
+                                  piece_a_begin + piece_b_begin - a_end});
+      piece_a_begin = piece_a_end;
+      piece_b_begin = piece_b_end;
+    }
+  }
+
+  (void)orbit_base::ParallelFor(
+      executor, pieces.size(),
+      [&](size_t index) {
+        const MergePiece& piece = pieces[index];
+        std::merge(std::make_move_iterator(source + piece.a_begin),
+                   std::make_move_iterator(source + piece.a_end),
+                   std::make_move_iterator(source + piece.b_begin),
+                   std::make_move_iterator(source + piece.b_end), destination + piece.output,
+                   comparator);
+      },
+      {/*grain_size=*/1});
+}
+
 }  // namespace orbit_base_internal
 
 namespace orbit_base {
@@ -54,6 +125,63 @@ void stable_sort(RandomIt first, RandomIt last, Projection projection = {},
       orbit_base_internal::MakeComparator(std::move(comparator), std::move(projection)));
 }
 
+// Parallel counterpart of std::stable_sort, implemented as a merge sort on `executor` and the
+// calling thread. Runs of `grain_size` elements are sorted independently and then merged pairwise,
+// with each merge split into independent pieces. If `grain_size` is zero, it is chosen based on
+// the number of threads. This needs a temporary buffer of the size of the input.
+//
+// ```
+// orbit_base::ParallelStableSort(executor, std::begin(values), std::end(values), std::greater<>{});
+// ```
+template <typename RandomIt, typename Comparator = std::less<>>
+void ParallelStableSort(Executor* executor, RandomIt first, RandomIt last,
+                        Comparator comparator = {}, size_t grain_size = 0) {
+  const auto size = static_cast<size_t>(last - first);
+  if (grain_size == 0) {
+    grain_size = std::max(orbit_base_internal::kMinParallelSortGrainSize,
+                          orbit_base_internal::ComputeParallelForGrainSize(size, {}));
+  }
+  if (size <= grain_size) {
+    std::stable_sort(first, last, comparator);
+    return;
+  }
+
+  const size_t number_of_runs = (size + grain_size - 1) / grain_size;
+  (void)ParallelFor(
+      executor, number_of_runs,
+      [&](size_t run) {
+        std::stable_sort(first + run * grain_size,
+                         first + std::min(size, (run + 1) * grain_size), comparator);
+      },
+      {/*grain_size=*/1});
+
+  using ValueType = typename std::iterator_traits<RandomIt>::value_type;
+  std::vector<ValueType> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+  // The merges alternate between moving from the buffer to the input range and back.
+  bool sorted_runs_in_buffer = true;
+  for (size_t run_size = grain_size; run_size < size; run_size *= 2) {
+    if (sorted_runs_in_buffer) {
+      orbit_base_internal::ParallelMergeRuns(executor, buffer.begin(), first, size, run_size,
+                                             grain_size, comparator);
+    } else {
+      orbit_base_internal::ParallelMergeRuns(executor, first, buffer.begin(), size, run_size,
+                                             grain_size, comparator);
+    }
+    sorted_runs_in_buffer = !sorted_runs_in_buffer;
+  }
+
+  if (sorted_runs_in_buffer) {
+    (void)ParallelFor(
+        executor, number_of_runs,
+        [&](size_t run) {
+          const size_t begin = run * grain_size;
+          const size_t end = std::min(size, begin + grain_size);
+          std::move(buffer.begin() + begin, buffer.begin() + end, first + begin);
+        },
+        {/*grain_size=*/1});
+  }
+}
+
 }  // namespace orbit_base
 
 #endif  // ORBIT_BASE_SORT_H_
@@ -57,6 +57,10 @@ class ThreadPool : public orbit_base::Executor {
   //
   // Whenever an action is Scheduled the thread pool puts it in an internal
   // queue. Worker threads pick actions from the queue and execute them.
+  // Actions scheduled from a worker thread go to that worker's own queue, from
+  // which idle workers steal when the global queue is empty. Hence there is no
+  // guarantee on the order in which actions are executed, unless the thread
+  // pool has a single worker thread.
   // If at the time of scheduling new action there are no idle worker threads,
   // the thread pool creates a new worker thread if current number of worker
   // threads is less than maximum pool size.
@@ -205,7 +205,7 @@ void CaptureWindow::HandlePickedElement(PickingMode picking_mode, PickingId pick
     background_clicked_ = false;
     const orbit_gl::PickingUserData* user_data = batcher.GetUserData(picking_id);
     const orbit_client_protos::TimerInfo* timer_info =
-        (user_data == nullptr ? nullptr : user_data->timer_info_);
+        (user_data == nullptr ? nullptr : user_data->GetTimerInfo());
     if (timer_info != nullptr) {
       SelectTimer(timer_info);
     } else if (type == PickingType::kPickable) {
@@ -118,6 +118,12 @@ void HandleCaptureEvent(const orbit_api::ApiTrackUint64& track_uint64,
   api_event_processor->ProcessApiTrackUint64(api_event);
 }
 
+// Only the producer of the Orbit API interns names, introspection never does.
+void HandleCaptureEvent(const orbit_api::ApiInternedString& /*interned_string*/,
+                        orbit_capture_client::ApiEventProcessor* /*unused*/) {
+  ORBIT_UNREACHABLE();
+}
+
 // The variant type `ApiEventVariant` requires to contain `std::monostate` in order to be default-
 // constructable. However, that state is never expected to be called in the visitor.
 void HandleCaptureEvent(const std::monostate& /*unused*/,
@@ -203,6 +209,10 @@ class IntrospectionCaptureListener : public orbit_capture_client::CaptureListene
   void OnPresentEvent(const orbit_grpc_protos::PresentEvent& /*present_event*/) override {
     ORBIT_UNREACHABLE();
   }
+  void OnFunctionCallSummary(
+      const orbit_grpc_protos::FunctionCallSummary& /*function_call_summary*/) override {
+    ORBIT_UNREACHABLE();
+  }
   void OnWarningEvent(orbit_grpc_protos::WarningEvent /*warning_event*/) override {
     ORBIT_UNREACHABLE();
   }
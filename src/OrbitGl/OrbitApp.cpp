@@ -39,6 +39,7 @@
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "ApiInterface/Orbit.h"
 #include "CaptureClient/CaptureEventProcessor.h"
@@ -47,6 +48,7 @@
 #include "CaptureClient/LoadCapture.h"
 #include "CaptureFile/CaptureFile.h"
 #include "CaptureFile/CaptureFileHelpers.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
 #include "ClientData/CallstackData.h"
 #include "ClientData/CallstackInfo.h"
 #include "ClientData/ModuleData.h"
@@ -127,6 +129,8 @@ using orbit_capture_client::CaptureListener;
 using orbit_capture_client::ClientCaptureOptions;
 
 using orbit_capture_file::CaptureFile;
+using orbit_capture_file::CaptureFileCompression;
+using orbit_capture_file::CaptureFileOptions;
 
 using orbit_client_data::CallstackData;
 using orbit_client_data::CallstackEvent;
@@ -144,6 +148,7 @@ using orbit_client_data::ThreadStateSliceInfo;
 using orbit_client_data::TimeRange;
 using orbit_client_data::TimerBlock;
 using orbit_client_data::TimerChain;
+using orbit_client_data::TimerView;
 using orbit_client_data::TracepointInfoSet;
 using orbit_client_data::UserDefinedCaptureData;
 
@@ -362,6 +367,8 @@ void OrbitApp::OnCaptureStarted(const orbit_grpc_protos::CaptureStarted& capture
 
     ClearCapture();
 
+    if (saving_capture_failed_) file_path.reset();
+
     // It is safe to do this write on the main thread, as the capture thread is suspended until
     // this task is completely executed.
     ConstructCaptureData(capture_started, file_path, std::move(frame_track_function_ids),
@@ -465,6 +472,16 @@ Future<void> OrbitApp::OnCaptureCancelled() {
   });
 }
 
+Future<void> OrbitApp::OnSavingCaptureFailed(ErrorMessage error_message) {
+  return main_thread_executor_->Schedule(
+      [this, error_message = std::move(error_message)]() mutable {
+        saving_capture_failed_ = true;
+        if (HasCaptureData()) GetMutableCaptureData().reset_file_path();
+        SendErrorToUi("Error saving capture", error_message.message());
+        ORBIT_ERROR("%s", error_message.message());
+      });
+}
+
 Future<void> OrbitApp::OnCaptureFailed(ErrorMessage error_message) {
   return main_thread_executor_->Schedule(
       [this, error_message = std::move(error_message)]() mutable {
@@ -1162,12 +1179,15 @@ Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> OrbitApp::LoadCaptureFro
     capture_window_->set_draw_help(false);
   }
   ClearCapture();
+  saving_capture_failed_ = false;
   auto load_future = thread_pool_->Schedule(
       [this, file_path]() -> ErrorMessageOr<CaptureListener::CaptureOutcome> {
         capture_loading_cancellation_requested_ = false;
 
+        CaptureFileOptions capture_file_options;
+        capture_file_options.memory_map_sections = absl::GetFlag(FLAGS_memory_map_capture_files);
         OUTCOME_TRY(const std::unique_ptr<CaptureFile> capture_file,
-                    CaptureFile::OpenForReadWrite(file_path));
+                    CaptureFile::OpenForReadWrite(file_path, capture_file_options));
 
         // Set is_loading_capture_ to true for the duration of this scope.
         data_source_ = CaptureData::DataSource::kLoadedCapture;
@@ -1219,7 +1239,8 @@ void OrbitApp::FireRefreshCallbacks(DataViewType type) {
   main_window_->RefreshDataView(type);
 }
 
-static std::unique_ptr<CaptureEventProcessor> CreateCaptureEventProcessor(
+// Returns the CaptureEventProcessors that CaptureClient runs in parallel, each on its own thread.
+static std::vector<std::unique_ptr<CaptureEventProcessor>> CreateCaptureEventProcessors(
     CaptureListener* listener, std::string_view process_name,
     absl::flat_hash_set<uint64_t> frame_track_function_ids,
     const std::function<void(const ErrorMessage&)>& error_handler) {
@@ -1246,22 +1267,40 @@ static std::unique_ptr<CaptureEventProcessor> CreateCaptureEventProcessor(
                     process_name, absl::Now(), suffix);
   }
 
+  CaptureFileCompression compression = CaptureFileCompression::kNone;
+  ErrorMessageOr<CaptureFileCompression> compression_or_error =
+      orbit_capture_file::ParseCaptureFileCompression(
+          absl::GetFlag(FLAGS_capture_file_compression));
+  if (compression_or_error.has_error()) {
+    error_handler(ErrorMessage{absl::StrFormat("Saving the capture without compression: %s",
+                                               compression_or_error.error().message())});
+  } else {
+    compression = compression_or_error.value();
+  }
+
   auto save_to_file_processor_or_error =
-      CaptureEventProcessor::CreateSaveToFileProcessor(file_path, error_handler);
+      CaptureEventProcessor::CreateSaveToFileProcessor(file_path, error_handler, compression);
 
   if (save_to_file_processor_or_error.has_error()) {
     error_handler(ErrorMessage{
         absl::StrFormat("Unable to set up automatic capture saving to \"%s\": %s",
                         file_path.string(), save_to_file_processor_or_error.error().message())});
-    return CaptureEventProcessor::CreateForCaptureListener(listener, std::nullopt,
-                                                           std::move(frame_track_function_ids));
+    std::vector<std::unique_ptr<CaptureEventProcessor>> event_processors;
+    event_processors.push_back(CaptureEventProcessor::CreateForCaptureListener(
+        listener, std::nullopt, std::move(frame_track_function_ids)));
+    return event_processors;
   }
 
   std::vector<std::unique_ptr<CaptureEventProcessor>> event_processors;
   event_processors.push_back(CaptureEventProcessor::CreateForCaptureListener(
       listener, std::move(file_path), std::move(frame_track_function_ids)));
   event_processors.push_back(std::move(save_to_file_processor_or_error.value()));
-  return CaptureEventProcessor::CreateCompositeProcessor(std::move(event_processors));
+  if (absl::GetFlag(FLAGS_save_capture_on_separate_thread)) return event_processors;
+
+  std::vector<std::unique_ptr<CaptureEventProcessor>> composite_event_processor;
+  composite_event_processor.push_back(
+      CaptureEventProcessor::CreateCompositeProcessor(std::move(event_processors)));
+  return composite_event_processor;
 }
 
 static void FindAndAddFunctionToStopUnwindingAt(
@@ -1392,21 +1431,22 @@ void OrbitApp::StartCapture() {
   options.process_id = process->pid();
   options.record_return_values = absl::GetFlag(FLAGS_show_return_values);
   options.record_arguments = false;
+  options.aggregate_instrumented_calls = absl::GetFlag(FLAGS_aggregate_instrumented_calls);
   options.enable_auto_frame_track = data_manager_->enable_auto_frame_track();
   options.thread_state_change_callstack_collection =
       data_manager_->thread_state_change_callstack_collection();
 
   ORBIT_CHECK(capture_client_ != nullptr);
 
-  std::unique_ptr<CaptureEventProcessor> capture_event_processor = CreateCaptureEventProcessor(
-      this, process->name(), frame_track_function_ids, [this](const ErrorMessage& error) {
-        GetMutableCaptureData().reset_file_path();
-        SendErrorToUi("Error saving capture", error.message());
-        ORBIT_ERROR("%s", error.message());
-      });
+  saving_capture_failed_ = false;
+  std::vector<std::unique_ptr<CaptureEventProcessor>> capture_event_processors =
+      CreateCaptureEventProcessors(
+          this, process->name(), frame_track_function_ids,
+          [this](const ErrorMessage& error) { std::ignore = OnSavingCaptureFailed(error); });
 
-  Future<ErrorMessageOr<CaptureOutcome>> capture_result = capture_client_->Capture(
-      thread_pool_.get(), std::move(capture_event_processor), *module_manager_, *process_, options);
+  Future<ErrorMessageOr<CaptureOutcome>> capture_result =
+      capture_client_->Capture(thread_pool_.get(), std::move(capture_event_processors),
+                               *module_manager_, *process_, options);
 
   // TODO(b/187250643): Refactor this to be more readable and maybe remove parts that are not needed
   // here (capture cancelled)
@@ -2607,9 +2647,9 @@ void OrbitApp::AddFrameTrackTimers(uint64_t instrumented_function_id) {
   for (const TimerChain* chain : chains) {
     for (const TimerBlock& block : *chain) {
       for (uint64_t i = 0; i < block.size(); ++i) {
-        const TimerInfo& timer_info = block[i];
-        if (timer_info.function_id() == instrumented_function_id) {
-          all_start_times.push_back(timer_info.start());
+        const TimerView timer = block[i];
+        if (timer.function_id() == instrumented_function_id) {
+          all_start_times.push_back(timer.start());
         }
       }
     }
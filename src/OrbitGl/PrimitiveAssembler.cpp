@@ -341,12 +341,7 @@ void PrimitiveAssembler::StartNewFrame() { batcher_->ResetElements(); }
 
 const orbit_client_protos::TimerInfo* PrimitiveAssembler::GetTimerInfo(PickingId id) const {
   const PickingUserData* data = GetUserData(id);
-
-  if (data != nullptr && data->timer_info_ != nullptr) {
-    return data->timer_info_;
-  }
-
-  return nullptr;
+  return data != nullptr ? data->GetTimerInfo() : nullptr;
 }
 
 }  // namespace orbit_gl
\ No newline at end of file
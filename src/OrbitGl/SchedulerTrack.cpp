@@ -78,19 +78,23 @@ void SchedulerTrack::DoUpdatePrimitives(PrimitiveAssembler& primitive_assembler,
   const uint32_t resolution_in_pixels = viewport_->WorldToScreen({GetWidth(), 0})[0];
   const float box_height = GetDefaultBoxHeight();
 
+  // The visible timers are copied here one by one, so that drawing doesn't create and keep a
+  // TimerInfo for each of them.
+  TimerInfo timer_info;
   for (uint32_t depth = 0; depth < GetDepth(); depth++) {
     const float world_timer_y = GetYFromDepth(depth);
-    for (const TimerInfo* timer_info : timer_data_->GetTimersAtDepthDiscretized(
+    for (const orbit_client_data::TimerView& timer : timer_data_->GetTimersAtDepthDiscretized(
              depth, resolution_in_pixels, min_tick, max_tick)) {
       ++visible_timer_count_;
-      const bool is_selected = timer_info == draw_data.selected_timer;
+      timer.CopyToTimerInfo(&timer_info);
+      const bool is_selected = timer.HasTimerInfo(draw_data.selected_timer);
 
-      Color color = GetTimerColor(*timer_info, is_selected, /*is_highlighted=*/false, draw_data);
+      Color color = GetTimerColor(timer_info, is_selected, /*is_highlighted=*/false, draw_data);
       std::unique_ptr<PickingUserData> user_data =
-          CreatePickingUserData(primitive_assembler, *timer_info);
+          CreatePickingUserData(primitive_assembler, timer);
 
       auto [box_start_x, box_width] =
-          timeline_info_->GetBoxPosXAndWidthFromTicks(timer_info->start(), timer_info->end());
+          timeline_info_->GetBoxPosXAndWidthFromTicks(timer.start(), timer.end());
       const Vec2 pos = {box_start_x, world_timer_y};
       const Vec2 size = {box_width, box_height};
       primitive_assembler.AddShadedBox(pos, size, draw_data.z, color, std::move(user_data));
@@ -141,9 +145,9 @@ std::vector<const orbit_client_protos::TimerInfo*> SchedulerTrack::GetScopesInRa
     for (const auto& block : *chain) {
       if (!block.Intersects(start_ns, end_ns)) continue;
       for (uint64_t i = 0; i < block.size(); ++i) {
-        const orbit_client_protos::TimerInfo& timer_info = block[i];
-        if (timer_info.start() <= end_ns && timer_info.end() > start_ns) {
-          result.push_back(&timer_info);
+        const orbit_client_data::TimerView timer = block[i];
+        if (timer.start() <= end_ns && timer.end() > start_ns) {
+          result.push_back(&timer.GetTimerInfo());
         }
       }
     }
@@ -19,6 +19,7 @@
 #include "ClientData/FunctionInfo.h"
 #include "ClientData/ModuleAndFunctionLookup.h"
 #include "ClientData/ScopeId.h"
+#include "ClientData/TimerChain.h"
 #include "ClientProtos/capture_data.pb.h"
 #include "DisplayFormats/DisplayFormats.h"
 #include "OrbitBase/Logging.h"
@@ -215,10 +216,11 @@ float ThreadTrack::GetDefaultBoxHeight() const {
   return box_height;
 }
 
-Color ThreadTrack::GetTimerColor(const TimerInfo& timer_info, const internal::DrawData& draw_data) {
+Color ThreadTrack::GetTimerColor(const orbit_client_data::TimerView& timer,
+                                 const TimerInfo& timer_info, const internal::DrawData& draw_data) {
   const std::optional<ScopeId> scope_id = app_->ProvideScopeId(timer_info);
   const uint64_t group_id = timer_info.group_id();
-  const bool is_selected = &timer_info == draw_data.selected_timer;
+  const bool is_selected = timer.HasTimerInfo(draw_data.selected_timer);
   const bool is_scope_id_highlighted =
       scope_id.has_value() && scope_id.value() == draw_data.highlighted_scope_id;
   const bool is_group_id_highlighted =
@@ -394,31 +396,36 @@ void ThreadTrack::DoUpdatePrimitives(PrimitiveAssembler& primitive_assembler,
                   app_->GetGroupIdToHighlight(), app_->GetHistogramSelectionRange());
 
   uint64_t resolution_in_pixels = draw_data.viewport->WorldToScreen({draw_data.track_width, 0})[0];
+  // The visible timers are copied here one by one, so that drawing doesn't create and keep a
+  // TimerInfo for each of them.
+  TimerInfo timer_info;
   for (uint32_t depth = 0; depth < GetDepth(); depth++) {
     float world_timer_y = GetYFromDepth(depth);
 
-    for (const TimerInfo* timer_info : thread_track_data_provider_->GetTimersAtDepthDiscretized(
+    for (const orbit_client_data::TimerView& timer :
+         thread_track_data_provider_->GetTimersAtDepthDiscretized(
              thread_id_, depth, resolution_in_pixels, min_tick, max_tick)) {
       ++visible_timer_count_;
+      timer.CopyToTimerInfo(&timer_info);
 
-      Color color = GetTimerColor(*timer_info, draw_data);
+      Color color = GetTimerColor(timer, timer_info, draw_data);
       std::unique_ptr<PickingUserData> user_data =
-          CreatePickingUserData(primitive_assembler, *timer_info);
+          CreatePickingUserData(primitive_assembler, timer);
 
       auto box_height = GetDefaultBoxHeight();
       const auto [pos_x, size_x] =
-          timeline_info_->GetBoxPosXAndWidthFromTicks(timer_info->start(), timer_info->end());
+          timeline_info_->GetBoxPosXAndWidthFromTicks(timer.start(), timer.end());
       const Vec2 pos = {pos_x, world_timer_y};
       const Vec2 size = {size_x, box_height};
 
       if (!IsCollapsed() && BoxHasRoomForText(text_renderer, size[0])) {
-        DrawTimesliceText(text_renderer, *timer_info, draw_data.track_start_x, pos, size);
+        DrawTimesliceText(text_renderer, timer_info, draw_data.track_start_x, pos, size);
       }
       primitive_assembler.AddShadedBox(pos, size, draw_data.z, color, std::move(user_data));
-      if (ShouldHaveBorder(timer_info, draw_data.histogram_selection_range, size[0])) {
+      if (ShouldHaveBorder(&timer_info, draw_data.histogram_selection_range, size[0])) {
         primitive_assembler.AddQuadBorder(MakeBox(pos, size), GlCanvas::kZValueBoxBorder,
                                           TimerTrack::kBoxBorderColor,
-                                          CreatePickingUserData(primitive_assembler, *timer_info));
+                                          CreatePickingUserData(primitive_assembler, timer));
       }
     }
   }
@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <optional>
 #include <string>
 
 #include "ApiInterface/Orbit.h"
@@ -44,6 +45,7 @@ using orbit_capture_client::CaptureEventProcessor;
 
 using orbit_client_data::CaptureData;
 using orbit_client_data::TimerChain;
+using orbit_client_data::TimerView;
 using orbit_client_protos::TimerInfo;
 
 using orbit_gl::Button;
@@ -494,6 +496,11 @@ static bool ThreadMatches(const std::optional<uint32_t>& target_thread_id, const
   return !target_thread_id || *target_thread_id == timer->thread_id();
 }
 
+static bool ThreadMatches(const std::optional<uint32_t>& target_thread_id,
+                          const TimerView& timer) {
+  return !target_thread_id || *target_thread_id == timer.thread_id();
+}
+
 static void UpdatePreviousTimerAndGoalTime(const TimerInfo** previous_timer, uint64_t* goal_time,
                                            const TimerInfo* current_timer, uint64_t current_time) {
   if ((current_timer->end() < current_time) && (*goal_time < current_timer->end())) {
@@ -562,43 +569,57 @@ const TimerInfo* TimeGraph::FindNextScopeTimer(ScopeId scope_id, uint64_t curren
 
 const TimerInfo* TimeGraph::FindNextThreadTrackTimer(ScopeId scope_id, uint64_t current_time,
                                                      std::optional<uint32_t> thread_id) const {
-  const TimerInfo* next_timer = nullptr;
+  std::optional<TimerView> next_timer;
   uint64_t goal_time = std::numeric_limits<uint64_t>::max();
+  // Reused for all the timers whose scope id needs to be checked, to avoid creating (and keeping) a
+  // TimerInfo for each of them.
+  TimerInfo timer_info;
   std::vector<const TimerChain*> chains = GetAllThreadTrackTimerChains();
   for (const TimerChain* chain : chains) {
     ORBIT_CHECK(chain != nullptr);
     for (const auto& block : *chain) {
       if (!block.Intersects(current_time, goal_time)) continue;
       for (uint64_t i = 0; i < block.size(); i++) {
-        const TimerInfo& timer_info = block[i];
-        if (ThreadMatches(thread_id, &timer_info) &&
-            capture_data_->ProvideScopeId(timer_info) == scope_id) {
-          UpdateNextTimerAndGoalTime(&next_timer, goal_time, &timer_info, current_time);
+        const TimerView timer = block[i];
+        if (timer.end() <= current_time || timer.end() >= goal_time) continue;
+        if (ThreadMatches(thread_id, timer)) {
+          timer.CopyToTimerInfo(&timer_info);
+          if (capture_data_->ProvideScopeId(timer_info) == scope_id) {
+            next_timer = timer;
+            goal_time = timer.end();
+          }
         }
       }
     }
   }
-  return next_timer;
+  return next_timer.has_value() ? &next_timer->GetTimerInfo() : nullptr;
 }
 
 const TimerInfo* TimeGraph::FindPreviousThreadTrackTimer(ScopeId scope_id, uint64_t current_time,
                                                          std::optional<uint32_t> thread_id) const {
-  const TimerInfo* previous_timer = nullptr;
+  std::optional<TimerView> previous_timer;
   uint64_t goal_time = std::numeric_limits<uint64_t>::lowest();
+  // Reused for all the timers whose scope id needs to be checked, to avoid creating (and keeping) a
+  // TimerInfo for each of them.
+  TimerInfo timer_info;
   std::vector<const TimerChain*> chains = GetAllThreadTrackTimerChains();
   for (const TimerChain* chain : chains) {
     for (const auto& block : *chain) {
       if (!block.Intersects(goal_time, current_time)) continue;
       for (uint64_t i = 0; i < block.size(); i++) {
-        const TimerInfo& timer_info = block[i];
-        if (ThreadMatches(thread_id, &timer_info) &&
-            capture_data_->ProvideScopeId(timer_info) == scope_id) {
-          UpdatePreviousTimerAndGoalTime(&previous_timer, &goal_time, &timer_info, current_time);
+        const TimerView timer = block[i];
+        if (timer.end() >= current_time || timer.end() <= goal_time) continue;
+        if (ThreadMatches(thread_id, timer)) {
+          timer.CopyToTimerInfo(&timer_info);
+          if (capture_data_->ProvideScopeId(timer_info) == scope_id) {
+            previous_timer = timer;
+            goal_time = timer.end();
+          }
         }
       }
     }
   }
-  return previous_timer;
+  return previous_timer.has_value() ? &previous_timer->GetTimerInfo() : nullptr;
 }
 
 std::vector<const TimerChain*> TimeGraph::GetAllThreadTrackTimerChains() const {
@@ -619,19 +640,29 @@ static void UpdateMinMaxTimers(const TimerInfo** min_timer, const TimerInfo** ma
 
 std::pair<const TimerInfo*, const TimerInfo*> TimeGraph::GetMinMaxTimerForThreadTrackScope(
     ScopeId scope_id) const {
-  const TimerInfo* min_timer = nullptr;
-  const TimerInfo* max_timer = nullptr;
+  std::optional<TimerView> min_timer;
+  std::optional<TimerView> max_timer;
+  // Reused for all the timers, to avoid creating (and keeping) a TimerInfo for each of them.
+  TimerInfo timer_info;
   std::vector<const TimerChain*> chains = GetAllThreadTrackTimerChains();
   for (const TimerChain* chain : chains) {
     for (const auto& block : *chain) {
       for (size_t i = 0; i < block.size(); i++) {
-        const TimerInfo& timer_info = block[i];
+        const TimerView timer = block[i];
+        timer.CopyToTimerInfo(&timer_info);
         if (capture_data_->ProvideScopeId(timer_info) != scope_id) continue;
-        UpdateMinMaxTimers(&min_timer, &max_timer, &timer_info);
+        const uint64_t elapsed_nanos = timer.end() - timer.start();
+        if (!min_timer.has_value() || elapsed_nanos < min_timer->end() - min_timer->start()) {
+          min_timer = timer;
+        }
+        if (!max_timer.has_value() || elapsed_nanos > max_timer->end() - max_timer->start()) {
+          max_timer = timer;
+        }
       }
     }
   }
-  return std::make_pair(min_timer, max_timer);
+  return std::make_pair(min_timer.has_value() ? &min_timer->GetTimerInfo() : nullptr,
+                        max_timer.has_value() ? &max_timer->GetTimerInfo() : nullptr);
 }
 
 std::pair<const TimerInfo*, const TimerInfo*> TimeGraph::GetMinMaxTimerForScope(
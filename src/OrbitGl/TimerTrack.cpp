@@ -36,6 +36,7 @@
 using orbit_client_data::ScopeId;
 using orbit_client_data::TimerChain;
 using orbit_client_data::TimerData;
+using orbit_client_data::TimerView;
 using orbit_client_protos::TimerInfo;
 
 using orbit_gl::PickingUserData;
@@ -115,60 +116,63 @@ void TimerTrack::DrawTimesliceText(TextRenderer& text_renderer,
       GlCanvas::kZValueBox, formatting, elapsed_time_length);
 }
 
-bool TimerTrack::DrawTimer(TextRenderer& text_renderer, const TimerInfo* prev_timer_info,
-                           const TimerInfo* next_timer_info, const internal::DrawData& draw_data,
-                           const TimerInfo* current_timer_info, uint64_t* min_ignore,
+bool TimerTrack::DrawTimer(TextRenderer& text_renderer, const std::optional<TimerView>& prev_timer,
+                           const std::optional<TimerView>& next_timer,
+                           const internal::DrawData& draw_data,
+                           const std::optional<TimerView>& current_timer, uint64_t* min_ignore,
                            uint64_t* max_ignore) {
   ORBIT_CHECK(min_ignore != nullptr);
   ORBIT_CHECK(max_ignore != nullptr);
-  if (current_timer_info == nullptr) return false;
-  if (draw_data.min_tick > current_timer_info->end() ||
-      draw_data.max_tick < current_timer_info->start()) {
+  if (!current_timer.has_value()) return false;
+  if (draw_data.min_tick > current_timer->end() || draw_data.max_tick < current_timer->start()) {
     return false;
   }
-  if (current_timer_info->start() >= *min_ignore && current_timer_info->end() <= *max_ignore)
-    return false;
-  if (!TimerFilter(*current_timer_info)) return false;
+  if (current_timer->start() >= *min_ignore && current_timer->end() <= *max_ignore) return false;
+
+  // Only the timers that are drawn are copied to a complete TimerInfo, and none is kept.
+  TimerInfo current_timer_info;
+  current_timer->CopyToTimerInfo(&current_timer_info);
+  if (!TimerFilter(current_timer_info)) return false;
 
-  double start_us = timeline_info_->GetUsFromTick(current_timer_info->start());
+  double start_us = timeline_info_->GetUsFromTick(current_timer_info.start());
   double start_or_prev_end_us = start_us;
-  double end_us = timeline_info_->GetUsFromTick(current_timer_info->end());
+  double end_us = timeline_info_->GetUsFromTick(current_timer_info.end());
   double end_or_next_start_us = end_us;
 
-  float world_timer_y = GetYFromTimer(*current_timer_info);
-  float box_height = GetDynamicBoxHeight(*current_timer_info);
+  float world_timer_y = GetYFromTimer(current_timer_info);
+  float box_height = GetDynamicBoxHeight(current_timer_info);
 
   // Check if the previous timer overlaps with the current one, and if so draw the overlap
   // as triangles rather than as overlapping rectangles.
-  if (prev_timer_info != nullptr) {
+  if (prev_timer.has_value()) {
     // TODO(b/179985943): Turn this back into a check.
-    if (prev_timer_info->start() < current_timer_info->start()) {
+    if (prev_timer->start() < current_timer_info.start()) {
       // Note, that for timers that are completely inside the previous one, we will keep drawing
       // them above each other, as a proper solution would require us to keep a list of all
       // prev. intersecting timers. Further, we also compare the type, as for the Gpu timers,
       // timers of different type but same depth are drawn below each other (and thus do not
       // overlap).
-      if (prev_timer_info->end() > current_timer_info->start() &&
-          prev_timer_info->end() <= current_timer_info->end() &&
-          prev_timer_info->type() == current_timer_info->type()) {
-        start_or_prev_end_us = timeline_info_->GetUsFromTick(prev_timer_info->end());
+      if (prev_timer->end() > current_timer_info.start() &&
+          prev_timer->end() <= current_timer_info.end() &&
+          prev_timer->type() == current_timer_info.type()) {
+        start_or_prev_end_us = timeline_info_->GetUsFromTick(prev_timer->end());
       }
     }
   }
 
   // Check if the next timer overlaps with the current one, and if so draw the overlap
   // as triangles rather than as overlapping rectangles.
-  if (next_timer_info != nullptr) {
+  if (next_timer.has_value()) {
     // TODO(b/179985943): Turn this back into a check.
-    if (current_timer_info->start() < next_timer_info->start()) {
+    if (current_timer_info.start() < next_timer->start()) {
       // Note, that for timers that are completely inside the next one, we will keep drawing
       // them above each other, as a proper solution would require us to keep a list of all
       // upcoming intersecting timers. We also compare the type, as for the Gpu timers, timers
       // of different type but same depth are drawn below each other (and thus do not overlap).
-      if (current_timer_info->end() > next_timer_info->start() &&
-          current_timer_info->end() <= next_timer_info->end() &&
-          next_timer_info->type() == current_timer_info->type()) {
-        end_or_next_start_us = timeline_info_->GetUsFromTick(next_timer_info->start());
+      if (current_timer_info.end() > next_timer->start() &&
+          current_timer_info.end() <= next_timer->end() &&
+          next_timer->type() == current_timer_info.type()) {
+        end_or_next_start_us = timeline_info_->GetUsFromTick(next_timer->start());
       }
     }
   }
@@ -187,23 +191,23 @@ bool TimerTrack::DrawTimer(TextRenderer& text_renderer, const TimerInfo* prev_ti
 
     if (BoxHasRoomForText(text_renderer, world_x_info.world_x_width)) {
       Vec2 pos{world_x_info.world_x_start, world_timer_y};
-      Vec2 size{world_x_info.world_x_width, GetDynamicBoxHeight(*current_timer_info)};
+      Vec2 size{world_x_info.world_x_width, GetDynamicBoxHeight(current_timer_info)};
 
-      DrawTimesliceText(text_renderer, *current_timer_info, draw_data.track_start_x, pos, size);
+      DrawTimesliceText(text_renderer, current_timer_info, draw_data.track_start_x, pos, size);
     }
   }
 
-  std::optional<ScopeId> scope_id = app_->ProvideScopeId(*current_timer_info);
-  uint64_t group_id = current_timer_info->group_id();
+  std::optional<ScopeId> scope_id = app_->ProvideScopeId(current_timer_info);
+  uint64_t group_id = current_timer_info.group_id();
 
-  bool is_selected = current_timer_info == draw_data.selected_timer;
+  bool is_selected = current_timer->HasTimerInfo(draw_data.selected_timer);
   bool is_scope_id_highlighted =
       scope_id.has_value() && scope_id.value() == draw_data.highlighted_scope_id;
   bool is_group_id_highlighted =
       group_id != kOrbitDefaultGroupId && group_id == draw_data.highlighted_group_id;
   bool is_highlighted = !is_selected && (is_scope_id_highlighted || is_group_id_highlighted);
 
-  Color color = GetTimerColor(*current_timer_info, is_selected, is_highlighted, draw_data);
+  Color color = GetTimerColor(current_timer_info, is_selected, is_highlighted, draw_data);
 
   bool is_visible_width = elapsed_us * draw_data.inv_time_window *
                               viewport_->WorldToScreen({draw_data.track_width, 0})[0] >
@@ -230,32 +234,30 @@ bool TimerTrack::DrawTimer(TextRenderer& text_renderer, const TimerInfo* prev_ti
     Quad trapezium({top_left, bottom_left, bottom_right, top_right});
     draw_data.primitive_assembler->AddShadedTrapezium(
         trapezium, draw_data.z, color,
-        CreatePickingUserData(*primitive_assembler, *current_timer_info));
+        CreatePickingUserData(*primitive_assembler, *current_timer));
     float width =
         world_x_info_right_overlap.world_x_start - world_x_info_left_overlap.world_x_start;
 
-    if (ShouldHaveBorder(current_timer_info, draw_data.histogram_selection_range, width)) {
+    if (ShouldHaveBorder(&current_timer_info, draw_data.histogram_selection_range, width)) {
       primitive_assembler->AddQuadBorder(
           trapezium, GlCanvas::kZValueBoxBorder, TimerTrack::kBoxBorderColor,
-          CreatePickingUserData(*primitive_assembler, *current_timer_info));
+          CreatePickingUserData(*primitive_assembler, *current_timer));
     }
   } else {
     PrimitiveAssembler* primitive_assembler = draw_data.primitive_assembler;
-    auto user_data = std::make_unique<PickingUserData>(
-        current_timer_info, [&, primitive_assembler](PickingId id) {
-          return this->GetBoxTooltip(*primitive_assembler, id);
-        });
+    std::unique_ptr<PickingUserData> user_data =
+        CreatePickingUserData(*primitive_assembler, *current_timer);
 
     WorldXInfo world_x_info = ToWorldX(start_us, end_us, draw_data.inv_time_window,
                                        draw_data.track_start_x, draw_data.track_width);
 
     Vec2 pos(world_x_info.world_x_start, world_timer_y);
-    draw_data.primitive_assembler->AddVerticalLine(pos, GetDynamicBoxHeight(*current_timer_info),
+    draw_data.primitive_assembler->AddVerticalLine(pos, GetDynamicBoxHeight(current_timer_info),
                                                    draw_data.z, color, std::move(user_data));
     // For lines, we can ignore the entire pixel into which this event
     // falls. We align this precisely on the pixel x-coordinate of the
     // current line being drawn (in ticks).
-    int num_pixel = static_cast<int>((current_timer_info->start() - draw_data.min_timegraph_tick) /
+    int num_pixel = static_cast<int>((current_timer_info.start() - draw_data.min_timegraph_tick) /
                                      draw_data.ns_per_pixel);
     *min_ignore =
         draw_data.min_timegraph_tick + static_cast<uint64_t>(num_pixel * draw_data.ns_per_pixel);
@@ -310,10 +312,11 @@ void TimerTrack::DoUpdatePrimitives(PrimitiveAssembler& primitive_assembler,
     // error-prone), we are doing just one traversal of the text boxes, while keeping track of the
     // previous two timers, thus the currents iteration value being the "next" textbox.
     // Note: This will require us to draw the last timer after the traversal of the text boxes.
-    // Also note: The draw method will take care of nullptr's being passed into (first iteration).
-    const orbit_client_protos::TimerInfo* prev_timer_info = nullptr;
-    const orbit_client_protos::TimerInfo* current_timer_info = nullptr;
-    const orbit_client_protos::TimerInfo* next_timer_info = nullptr;
+    // Also note: The draw method will take care of empty timers being passed into (first
+    // iteration).
+    std::optional<TimerView> prev_timer;
+    std::optional<TimerView> current_timer;
+    std::optional<TimerView> next_timer;
 
     // We have to reset this when we go to the next depth, as otherwise we
     // would miss drawing events that should be drawn.
@@ -325,22 +328,22 @@ void TimerTrack::DoUpdatePrimitives(PrimitiveAssembler& primitive_assembler,
       for (size_t k = 0; k < block.size(); ++k) {
         // The current index (k) points to the "next" text box and we want to draw the text box
         // from the previous iteration ("current").
-        next_timer_info = &block[k];
+        next_timer = block[k];
 
-        if (DrawTimer(text_renderer, prev_timer_info, next_timer_info, draw_data,
-                      current_timer_info, &min_ignore, &max_ignore)) {
+        if (DrawTimer(text_renderer, prev_timer, next_timer, draw_data, current_timer, &min_ignore,
+                      &max_ignore)) {
           ++visible_timer_count_;
         }
 
-        prev_timer_info = current_timer_info;
-        current_timer_info = next_timer_info;
+        prev_timer = current_timer;
+        current_timer = next_timer;
       }
     }
 
     // We still need to draw the last timer.
-    next_timer_info = nullptr;
-    if (DrawTimer(text_renderer, prev_timer_info, next_timer_info, draw_data, current_timer_info,
-                  &min_ignore, &max_ignore)) {
+    next_timer.reset();
+    if (DrawTimer(text_renderer, prev_timer, next_timer, draw_data, current_timer, &min_ignore,
+                  &max_ignore)) {
       ++visible_timer_count_;
     }
   }
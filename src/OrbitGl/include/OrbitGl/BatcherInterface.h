@@ -5,6 +5,11 @@
 #ifndef ORBIT_GL_BATCHER_INTERFACE_H_
 #define ORBIT_GL_BATCHER_INTERFACE_H_
 
+#include <functional>
+#include <optional>
+#include <string>
+
+#include "ClientData/TimerChain.h"
 #include "ClientProtos/capture_data.pb.h"
 #include "OrbitGl/Geometry.h"
 #include "OrbitGl/PickingManager.h"
@@ -14,12 +19,23 @@ namespace orbit_gl {
 struct PickingUserData {
   using TooltipCallback = std::function<std::string(PickingId)>;
   const orbit_client_protos::TimerInfo* timer_info_;
+  // Set instead of timer_info_ for timers stored in a TimerChain, so that their TimerInfo is only
+  // created when they are actually picked.
+  std::optional<orbit_client_data::TimerView> timer_view_;
   TooltipCallback generate_tooltip_;
   const void* custom_data_ = nullptr;
 
   explicit PickingUserData(const orbit_client_protos::TimerInfo* timer_info = nullptr,
                            TooltipCallback generate_tooltip = nullptr)
       : timer_info_(timer_info), generate_tooltip_(std::move(generate_tooltip)) {}
+  PickingUserData(const orbit_client_data::TimerView& timer_view, TooltipCallback generate_tooltip)
+      : timer_info_(nullptr),
+        timer_view_(timer_view),
+        generate_tooltip_(std::move(generate_tooltip)) {}
+
+  [[nodiscard]] const orbit_client_protos::TimerInfo* GetTimerInfo() const {
+    return timer_view_.has_value() ? &timer_view_->GetTimerInfo() : timer_info_;
+  }
 };
 
 // Collects primitives to be rendered at a later point in time.
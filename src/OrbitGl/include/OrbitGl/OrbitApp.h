@@ -530,6 +530,8 @@ class OrbitApp final : public DataViewFactory,
   orbit_base::Future<void> OnCaptureFailed(ErrorMessage error_message);
   orbit_base::Future<void> OnCaptureCancelled();
   orbit_base::Future<void> OnCaptureComplete();
+  // Can be called from any thread, even before OnCaptureStarted.
+  orbit_base::Future<void> OnSavingCaptureFailed(ErrorMessage error_message);
 
   void RequestUpdatePrimitives();
 
@@ -541,6 +543,9 @@ class OrbitApp final : public DataViewFactory,
       absl::Span<const orbit_client_data::CallstackEvent> selected_callstack_events);
 
   std::atomic<bool> capture_loading_cancellation_requested_ = false;
+  // Only accessed on the main thread. Makes sure the CaptureData doesn't get the path of the file
+  // that failed to be saved, when the error is reported before the CaptureData is created.
+  bool saving_capture_failed_ = false;
   std::atomic<orbit_client_data::CaptureData::DataSource> data_source_{
       orbit_client_data::CaptureData::DataSource::kLiveCapture};
 
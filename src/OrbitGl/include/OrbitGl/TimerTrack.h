@@ -18,6 +18,7 @@
 #include "ClientData/CaptureData.h"
 #include "ClientData/ModuleManager.h"
 #include "ClientData/ScopeId.h"
+#include "ClientData/TimerChain.h"
 #include "ClientData/TimerData.h"
 #include "ClientData/TimerTrackDataIdManager.h"
 #include "ClientProtos/capture_data.pb.h"
@@ -129,10 +130,10 @@ class TimerTrack : public Track {
   }
 
   [[nodiscard]] bool DrawTimer(orbit_gl::TextRenderer& text_renderer,
-                               const orbit_client_protos::TimerInfo* prev_timer_info,
-                               const orbit_client_protos::TimerInfo* next_timer_info,
+                               const std::optional<orbit_client_data::TimerView>& prev_timer,
+                               const std::optional<orbit_client_data::TimerView>& next_timer,
                                const internal::DrawData& draw_data,
-                               const orbit_client_protos::TimerInfo* current_timer_info,
+                               const std::optional<orbit_client_data::TimerView>& current_timer,
                                uint64_t* min_ignore, uint64_t* max_ignore);
 
   [[nodiscard]] virtual std::string GetTimesliceText(
@@ -157,9 +158,9 @@ class TimerTrack : public Track {
       const orbit_gl::PrimitiveAssembler& primitive_assembler, PickingId id) const;
   [[nodiscard]] std::unique_ptr<orbit_gl::PickingUserData> CreatePickingUserData(
       const orbit_gl::PrimitiveAssembler& primitive_assembler,
-      const orbit_client_protos::TimerInfo& timer_info) {
+      const orbit_client_data::TimerView& timer) {
     return std::make_unique<orbit_gl::PickingUserData>(
-        &timer_info, [this, &primitive_assembler](PickingId id) {
+        timer, [this, &primitive_assembler](PickingId id) {
           return this->GetBoxTooltip(primitive_assembler, id);
         });
   }
@@ -7,12 +7,19 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
+#include <absl/container/node_hash_set.h>
+#include <absl/hash/hash.h>
 #include <absl/synchronization/mutex.h>
 #include <vulkan/vulkan.h>
 
+#include <array>
+#include <cstddef>
 #include <functional>
 #include <queue>
 #include <stack>
+#include <string>
+#include <string_view>
+#include <utility>
 
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Profiling.h"
@@ -38,7 +45,10 @@ namespace orbit_vulkan_layer {
  *
  * Thread-Safety: This class is internally synchronized (using read/write locks), and can be
  * safely accessed from different threads. This is needed, as in Vulkan submits and command buffer
- * modifications can happen from multiple threads.
+ * modifications can happen from multiple threads. As applications usually record command buffers
+ * from many threads in parallel, the state of command buffers is split into shards by
+ * `VkCommandBuffer`, each with its own lock, so that recording only contends with recording of
+ * command buffers in the same shard. Submits and presents, in turn, are serialized by `mutex_`.
  */
 template <class DispatchTable, class DeviceManager, class TimerQueryPool>
 class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
@@ -103,6 +113,24 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     float alpha;
   };
 
+  // The name of a debug marker. Usually, it refers to a name interned by the `SubmissionTracker`,
+  // such that recording a debug marker doesn't need to allocate and copy the name. Only when too
+  // many different names have been interned, it holds its own copy of the name.
+  class LabelName {
+   public:
+    LabelName() = default;
+    explicit LabelName(const std::string* interned_name) : interned_name_{interned_name} {}
+    explicit LabelName(std::string name) : name_{std::move(name)} {}
+
+    [[nodiscard]] const std::string& Get() const {
+      return interned_name_ != nullptr ? *interned_name_ : name_;
+    }
+
+   private:
+    const std::string* interned_name_ = nullptr;
+    std::string name_;
+  };
+
   // Identifies a particular debug marker region that has been submitted via `vkQueueSubmit`.
   // Note that we only store the state into `QueueSubmission`, if at that time we have a value for
   // the end_info. Beside the information about the begin/end, it also stores the label name, color
@@ -110,7 +138,7 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   struct SubmittedMarkerSlice {
     std::optional<SubmittedMarker> begin_info;
     SubmittedMarker end_info;
-    std::string label_name;
+    LabelName label_name;
     Color color;
     size_t depth = 0;
   };
@@ -167,53 +195,61 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
 
   void TrackCommandBuffers(VkDevice device, VkCommandPool pool,
                            const VkCommandBuffer* command_buffers, uint32_t count) {
-    absl::WriterMutexLock lock(&mutex_);
-    auto associated_cbs_it = pool_to_command_buffers_.find(pool);
-    if (associated_cbs_it == pool_to_command_buffers_.end()) {
-      associated_cbs_it = pool_to_command_buffers_.try_emplace(pool).first;
+    {
+      CommandPoolShard& pool_shard = GetCommandPoolShard(pool);
+      absl::MutexLock lock(&pool_shard.mutex);
+      absl::flat_hash_set<VkCommandBuffer>& associated_command_buffers =
+          pool_shard.pool_to_command_buffers[pool];
+      associated_command_buffers.insert(command_buffers, command_buffers + count);
     }
     for (uint32_t i = 0; i < count; ++i) {
-      VkCommandBuffer cb = command_buffers[i];
-      associated_cbs_it->second.insert(cb);
-      command_buffer_to_device_[cb] = device;
+      VkCommandBuffer command_buffer = command_buffers[i];
+      CommandBufferShard& shard = GetCommandBufferShard(command_buffer);
+      absl::MutexLock lock(&shard.mutex);
+      shard.command_buffer_to_device[command_buffer] = device;
     }
   }
 
   void UntrackCommandBuffers(VkDevice device, VkCommandPool pool,
                              const VkCommandBuffer* command_buffers, uint32_t count) {
-    absl::WriterMutexLock lock(&mutex_);
-    ORBIT_CHECK(pool_to_command_buffers_.contains(pool));
-    absl::flat_hash_set<VkCommandBuffer>& associated_command_buffers =
-        pool_to_command_buffers_.at(pool);
+    {
+      CommandPoolShard& pool_shard = GetCommandPoolShard(pool);
+      absl::MutexLock lock(&pool_shard.mutex);
+      ORBIT_CHECK(pool_shard.pool_to_command_buffers.contains(pool));
+      absl::flat_hash_set<VkCommandBuffer>& associated_command_buffers =
+          pool_shard.pool_to_command_buffers.at(pool);
+      for (uint32_t i = 0; i < count; ++i) {
+        associated_command_buffers.erase(command_buffers[i]);
+      }
+      if (associated_command_buffers.empty()) {
+        pool_shard.pool_to_command_buffers.erase(pool);
+      }
+    }
+
     for (uint32_t i = 0; i < count; ++i) {
       VkCommandBuffer command_buffer = command_buffers[i];
-      associated_command_buffers.erase(command_buffer);
+      CommandBufferShard& shard = GetCommandBufferShard(command_buffer);
+      absl::MutexLock lock(&shard.mutex);
 
       // vkFreeCommandBuffers (and thus this method) can be also called on command bufers in
       // "recording" or executable state and has similar effect as vkResetCommandBuffer has.
-      // In `OnCaptureFinished`, we reset all the timer slots left in `command_buffer_to_state_`.
+      // In `OnCaptureFinished`, we reset all the timer slots left in `command_buffer_to_state`.
       // If we would not reset them here and clear the state, we would try to reset those command
       // buffers there. However, the mapping to the device (which is needed) would be missing.
-      if (command_buffer_to_state_.contains(command_buffer)) {
-        // Note: This will "rollback" the slot indices (rather then actually resetting them on the
-        // Gpu). This is fine, as we remove the command buffer state right after submission. Thus,
-        // There can not be a value in the respective slot.
-        ResetCommandBufferUnsafe(command_buffer);
-
-        command_buffer_to_state_.erase(command_buffer);
-      }
-
-      ORBIT_CHECK(command_buffer_to_device_.contains(command_buffer));
-      ORBIT_CHECK(command_buffer_to_device_.at(command_buffer) == device);
-      command_buffer_to_device_.erase(command_buffer);
-    }
-    if (associated_command_buffers.empty()) {
-      pool_to_command_buffers_.erase(pool);
+      // Note: This will "rollback" the slot indices (rather then actually resetting them on the
+      // Gpu). This is fine, as we remove the command buffer state right after submission. Thus,
+      // There can not be a value in the respective slot.
+      ResetCommandBufferUnsafe(&shard, command_buffer);
+
+      ORBIT_CHECK(shard.command_buffer_to_device.contains(command_buffer));
+      ORBIT_CHECK(shard.command_buffer_to_device.at(command_buffer) == device);
+      shard.command_buffer_to_device.erase(command_buffer);
     }
   }
 
   void MarkCommandBufferBegin(VkCommandBuffer command_buffer) {
-    absl::WriterMutexLock lock(&mutex_);
+    CommandBufferShard& shard = GetCommandBufferShard(command_buffer);
+    absl::MutexLock lock(&shard.mutex);
     // Even when we are not capturing we create state for this command buffer to allow the
     // debug marker tracking. In order to compute the correct depth of a debug marker and being able
     // to match an "end" marker with the corresponding "begin" marker, we maintain a stack of all
@@ -222,34 +258,31 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     // state here that allows us to store the debug markers into it and maintain that stack on
     // submission. We will not write timestamps in this case and thus don't store any information
     // other than the debug markers then.
-    {
-      if (command_buffer_to_state_.contains(command_buffer)) {
-        // We end up in this case, if we have used the command buffer before and want to write new
-        // commands to it without resetting the command buffer. Per specification,
-        // "vkBeginCommandBuffer" does also reset the command buffer, in addition to putting it
-        // into the executable state.
-        ResetCommandBufferUnsafe(command_buffer);
-      }
-      command_buffer_to_state_[command_buffer] = {};
-    }
+    //
+    // If we have used the command buffer before and want to write new commands to it without
+    // resetting the command buffer, we need to reset it here. Per specification,
+    // "vkBeginCommandBuffer" does also reset the command buffer, in addition to putting it into the
+    // executable state.
+    ResetCommandBufferUnsafe(&shard, command_buffer);
+    CommandBufferState& state = shard.command_buffer_to_state[command_buffer];
     if (!is_capturing_) {
       return;
     }
 
     uint32_t slot_index{};
-    if (RecordTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, &slot_index)) {
-      ORBIT_CHECK(command_buffer_to_state_.contains(command_buffer));
-      command_buffer_to_state_.at(command_buffer).command_buffer_begin_slot_index =
-          std::make_optional(slot_index);
+    if (RecordTimestamp(shard, command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, &slot_index)) {
+      state.command_buffer_begin_slot_index = std::make_optional(slot_index);
     }
   }
 
   void MarkCommandBufferEnd(VkCommandBuffer command_buffer) {
-    absl::WriterMutexLock lock(&mutex_);
+    CommandBufferShard& shard = GetCommandBufferShard(command_buffer);
+    absl::MutexLock lock(&shard.mutex);
     if (!is_capturing_) {
       return;
     }
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+    auto state_it = shard.command_buffer_to_state.find(command_buffer);
+    if (state_it == shard.command_buffer_to_state.end()) {
       ORBIT_ERROR_ONCE(
           "Calling vkEndCommandBuffer on a command buffer that is in the initial state "
           "(i.e. either freshly allocated or reset with vkResetCommandBuffer).");
@@ -257,64 +290,57 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     }
 
     uint32_t slot_index{};
-    if (RecordTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, &slot_index)) {
-      // MarkCommandBufferBegin/End are called from within the same submit, and as the
-      // `MarkCommandBufferBegin` will always insert the state, we can assume that it is there.
-      ORBIT_CHECK(command_buffer_to_state_.contains(command_buffer));
-      CommandBufferState& command_buffer_state = command_buffer_to_state_.at(command_buffer);
-      command_buffer_state.command_buffer_end_slot_index = std::make_optional(slot_index);
+    if (RecordTimestamp(shard, command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        &slot_index)) {
+      state_it->second.command_buffer_end_slot_index = std::make_optional(slot_index);
     }
   }
 
   void MarkDebugMarkerBegin(VkCommandBuffer command_buffer, const char* text, Color color) {
-    absl::WriterMutexLock lock(&mutex_);
     // It is ensured by the Vulkan spec. that `text` must not be nullptr.
     ORBIT_CHECK(text != nullptr);
-    bool marker_depth_exceeds_maximum = false;
-    {
-      if (!command_buffer_to_state_.contains(command_buffer)) {
-        ORBIT_ERROR_ONCE(
-            "Calling vkCmdDebugMarkerBeginEXT/vkCmdBeginDebugUtilsLabelEXT on a command buffer "
-            "that is in the initial state (i.e. either freshly allocated or reset with "
-            "vkResetCommandBuffer).");
-        return;
-      }
-      ORBIT_CHECK(command_buffer_to_state_.contains(command_buffer));
-      CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
-      ++state.local_marker_stack_size;
-      marker_depth_exceeds_maximum =
-          state.local_marker_stack_size > max_local_marker_depth_per_command_buffer_;
-      Marker marker{.type = MarkerType::kDebugMarkerBegin,
-                    .label_name = std::string(text),
-                    .color = color,
-                    .cut_off = marker_depth_exceeds_maximum};
-      state.markers.emplace_back(std::move(marker));
+    CommandBufferShard& shard = GetCommandBufferShard(command_buffer);
+    absl::MutexLock lock(&shard.mutex);
+    auto state_it = shard.command_buffer_to_state.find(command_buffer);
+    if (state_it == shard.command_buffer_to_state.end()) {
+      ORBIT_ERROR_ONCE(
+          "Calling vkCmdDebugMarkerBeginEXT/vkCmdBeginDebugUtilsLabelEXT on a command buffer "
+          "that is in the initial state (i.e. either freshly allocated or reset with "
+          "vkResetCommandBuffer).");
+      return;
     }
+    CommandBufferState& state = state_it->second;
+    ++state.local_marker_stack_size;
+    bool marker_depth_exceeds_maximum =
+        state.local_marker_stack_size > max_local_marker_depth_per_command_buffer_;
+    Marker marker{.type = MarkerType::kDebugMarkerBegin,
+                  .label_name = InternLabelName(&shard, text),
+                  .color = color,
+                  .cut_off = marker_depth_exceeds_maximum};
+    state.markers.emplace_back(std::move(marker));
 
     if (!is_capturing_ || marker_depth_exceeds_maximum) {
       return;
     }
 
     uint32_t slot_index{};
-    if (RecordTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, &slot_index)) {
-      ORBIT_CHECK(command_buffer_to_state_.contains(command_buffer));
-      CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
+    if (RecordTimestamp(shard, command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, &slot_index)) {
       state.markers.back().slot_index = std::make_optional(slot_index);
     }
   }
 
   void MarkDebugMarkerEnd(VkCommandBuffer command_buffer) {
-    absl::WriterMutexLock lock(&mutex_);
-
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+    CommandBufferShard& shard = GetCommandBufferShard(command_buffer);
+    absl::MutexLock lock(&shard.mutex);
+    auto state_it = shard.command_buffer_to_state.find(command_buffer);
+    if (state_it == shard.command_buffer_to_state.end()) {
       ORBIT_ERROR_ONCE(
           "Calling vkCmdDebugMarkerEndEXT/vkCmdEndDebugUtilsLabelEXT on a command buffer "
           "that is in the initial state (i.e. either freshly allocated or reset with "
           "vkResetCommandBuffer).");
       return;
     }
-    ORBIT_CHECK(command_buffer_to_state_.contains(command_buffer));
-    CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
+    CommandBufferState& state = state_it->second;
     bool marker_depth_exceeds_maximum =
         state.local_marker_stack_size > max_local_marker_depth_per_command_buffer_;
     Marker marker{.type = MarkerType::kDebugMarkerEnd, .cut_off = marker_depth_exceeds_maximum};
@@ -330,9 +356,8 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     }
 
     uint32_t slot_index = 0;
-    if (RecordTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, &slot_index)) {
-      ORBIT_CHECK(command_buffer_to_state_.contains(command_buffer));
-      CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
+    if (RecordTimestamp(shard, command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        &slot_index)) {
       state.markers.back().slot_index = std::make_optional(slot_index);
     }
   }
@@ -374,7 +399,9 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       for (uint32_t command_buffer_index = 0; command_buffer_index < submit_info.commandBufferCount;
            ++command_buffer_index) {
         VkCommandBuffer command_buffer = submit_info.pCommandBuffers[command_buffer_index];
-        PersistSingleCommandBufferOnSubmit(device, command_buffer, &queue_submission,
+        CommandBufferShard& shard = GetCommandBufferShard(command_buffer);
+        absl::MutexLock shard_lock(&shard.mutex);
+        PersistSingleCommandBufferOnSubmit(&shard, device, command_buffer, &queue_submission,
                                            &submitted_submit_info, &query_slots_not_needed_to_read);
       }
     }
@@ -427,12 +454,15 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       for (uint32_t command_buffer_index = 0; command_buffer_index < submit_info.commandBufferCount;
            ++command_buffer_index) {
         VkCommandBuffer command_buffer = submit_info.pCommandBuffers[command_buffer_index];
+        CommandBufferShard& shard = GetCommandBufferShard(command_buffer);
+        absl::MutexLock shard_lock(&shard.mutex);
         if (device == VK_NULL_HANDLE) {
-          ORBIT_CHECK(command_buffer_to_device_.contains(command_buffer));
-          device = command_buffer_to_device_.at(command_buffer);
+          ORBIT_CHECK(shard.command_buffer_to_device.contains(command_buffer));
+          device = shard.command_buffer_to_device.at(command_buffer);
         }
-        PersistDebugMarkersOfASingleCommandBufferOnSubmit(
-            command_buffer, &queue_submission_optional, &markers, &marker_slots_not_needed_to_read);
+        PersistDebugMarkersOfASingleCommandBufferOnSubmit(&shard, command_buffer,
+                                                          &queue_submission_optional, &markers,
+                                                          &marker_slots_not_needed_to_read);
       }
     }
 
@@ -532,19 +562,21 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   }
 
   void ResetCommandBuffer(VkCommandBuffer command_buffer) {
-    absl::WriterMutexLock lock(&mutex_);
-    ResetCommandBufferUnsafe(command_buffer);
+    CommandBufferShard& shard = GetCommandBufferShard(command_buffer);
+    absl::MutexLock lock(&shard.mutex);
+    ResetCommandBufferUnsafe(&shard, command_buffer);
   }
 
   void ResetCommandPool(VkCommandPool command_pool) {
     absl::flat_hash_set<VkCommandBuffer> command_buffers;
     {
-      absl::ReaderMutexLock lock(&mutex_);
-      if (!pool_to_command_buffers_.contains(command_pool)) {
+      CommandPoolShard& pool_shard = GetCommandPoolShard(command_pool);
+      absl::MutexLock lock(&pool_shard.mutex);
+      auto command_buffers_it = pool_shard.pool_to_command_buffers.find(command_pool);
+      if (command_buffers_it == pool_shard.pool_to_command_buffers.end()) {
         return;
       }
-      ORBIT_CHECK(pool_to_command_buffers_.contains(command_pool));
-      command_buffers = pool_to_command_buffers_.at(command_pool);
+      command_buffers = command_buffers_it->second;
     }
     for (const auto& command_buffer : command_buffers) {
       ResetCommandBuffer(command_buffer);
@@ -553,41 +585,46 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
 
   void OnCaptureStart(orbit_grpc_protos::CaptureOptions capture_options) override {
     absl::WriterMutexLock lock(&mutex_);
+    LockAllCommandBufferShards();
     SetMaxLocalMarkerDepthPerCommandBuffer(
         capture_options.max_local_marker_depth_per_command_buffer());
     is_capturing_ = true;
+    UnlockAllCommandBufferShards();
   }
 
   void OnCaptureStop() override {}
 
   void OnCaptureFinished() override {
     absl::WriterMutexLock lock(&mutex_);
+    LockAllCommandBufferShards();
     std::vector<uint32_t> slots_not_needed_to_read_anymore;
 
     VkDevice device = VK_NULL_HANDLE;
 
-    for (auto& [command_buffer, command_buffer_state] : command_buffer_to_state_) {
-      if (command_buffer_state.pre_submission_cpu_timestamp.has_value()) continue;
-      if (device == VK_NULL_HANDLE) {
-        ORBIT_CHECK(command_buffer_to_device_.contains(command_buffer));
-        device = command_buffer_to_device_.at(command_buffer);
-      }
-      if (command_buffer_state.command_buffer_begin_slot_index.has_value()) {
-        slots_not_needed_to_read_anymore.push_back(
-            command_buffer_state.command_buffer_begin_slot_index.value());
-        command_buffer_state.command_buffer_begin_slot_index.reset();
-      }
+    for (CommandBufferShard& shard : command_buffer_shards_) {
+      for (auto& [command_buffer, command_buffer_state] : shard.command_buffer_to_state) {
+        if (command_buffer_state.pre_submission_cpu_timestamp.has_value()) continue;
+        if (device == VK_NULL_HANDLE) {
+          ORBIT_CHECK(shard.command_buffer_to_device.contains(command_buffer));
+          device = shard.command_buffer_to_device.at(command_buffer);
+        }
+        if (command_buffer_state.command_buffer_begin_slot_index.has_value()) {
+          slots_not_needed_to_read_anymore.push_back(
+              command_buffer_state.command_buffer_begin_slot_index.value());
+          command_buffer_state.command_buffer_begin_slot_index.reset();
+        }
 
-      if (command_buffer_state.command_buffer_end_slot_index.has_value()) {
-        slots_not_needed_to_read_anymore.push_back(
-            command_buffer_state.command_buffer_end_slot_index.value());
-        command_buffer_state.command_buffer_end_slot_index.reset();
-      }
+        if (command_buffer_state.command_buffer_end_slot_index.has_value()) {
+          slots_not_needed_to_read_anymore.push_back(
+              command_buffer_state.command_buffer_end_slot_index.value());
+          command_buffer_state.command_buffer_end_slot_index.reset();
+        }
 
-      for (Marker& marker : command_buffer_state.markers) {
-        if (marker.slot_index.has_value()) {
-          slots_not_needed_to_read_anymore.push_back(marker.slot_index.value());
-          marker.slot_index.reset();
+        for (Marker& marker : command_buffer_state.markers) {
+          if (marker.slot_index.has_value()) {
+            slots_not_needed_to_read_anymore.push_back(marker.slot_index.value());
+            marker.slot_index.reset();
+          }
         }
       }
     }
@@ -596,6 +633,7 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     }
 
     is_capturing_ = false;
+    UnlockAllCommandBufferShards();
   }
 
  private:
@@ -604,7 +642,7 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   struct Marker {
     MarkerType type;
     std::optional<uint32_t> slot_index;
-    std::optional<std::string> label_name;
+    std::optional<LabelName> label_name;
     std::optional<Color> color;
     bool cut_off = false;
   };
@@ -621,7 +659,7 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   // Submission 2: End("Bar"), End("Foo") -- We now know that the first end needs to be thrown away.
   struct MarkerState {
     std::optional<SubmittedMarker> begin_info;
-    std::string label_name;
+    LabelName label_name;
     Color color;
     size_t depth = 0;
     bool depth_exceeds_maximum = false;
@@ -639,12 +677,73 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     uint32_t local_marker_stack_size = 0;
   };
 
-  bool RecordTimestamp(VkCommandBuffer command_buffer, VkPipelineStageFlagBits pipeline_stage_flags,
-                       uint32_t* slot_index) {
-    mutex_.AssertReaderHeld();
+  // The state of all command buffers whose handle hashes to the same shard. Recording a command
+  // buffer only needs the lock of its shard. Each shard is on its own cache line, such that threads
+  // recording command buffers of different shards don't keep invalidating each other's cache line.
+  struct alignas(64) CommandBufferShard {
+    absl::Mutex mutex;
+    absl::flat_hash_map<VkCommandBuffer, VkDevice> command_buffer_to_device;
+    absl::flat_hash_map<VkCommandBuffer, CommandBufferState> command_buffer_to_state;
+    // The debug marker names recorded into command buffers of this shard. Interning them per shard
+    // rather than globally means that recording a debug marker doesn't need another lock.
+    absl::node_hash_set<std::string> label_names;
+  };
+
+  struct alignas(64) CommandPoolShard {
+    absl::Mutex mutex;
+    absl::flat_hash_map<VkCommandPool, absl::flat_hash_set<VkCommandBuffer>>
+        pool_to_command_buffers;
+  };
+
+  static constexpr size_t kShardCount = 32;
+  // Debug marker names are usually a small set of constant strings, but some applications generate
+  // them, e.g., with a frame number. Beyond this number of names, they are no longer interned.
+  static constexpr size_t kMaxInternedLabelNamesPerShard = 1024;
 
-    ORBIT_CHECK(command_buffer_to_device_.contains(command_buffer));
-    VkDevice device = command_buffer_to_device_.at(command_buffer);
+  [[nodiscard]] CommandBufferShard& GetCommandBufferShard(VkCommandBuffer command_buffer) {
+    return command_buffer_shards_[absl::Hash<VkCommandBuffer>{}(command_buffer) % kShardCount];
+  }
+
+  [[nodiscard]] CommandPoolShard& GetCommandPoolShard(VkCommandPool command_pool) {
+    return command_pool_shards_[absl::Hash<VkCommandPool>{}(command_pool) % kShardCount];
+  }
+
+  // `is_capturing_` and `max_local_marker_depth_per_command_buffer_` are read while holding either
+  // `mutex_` or the mutex of any one shard, so they must only be written while holding all of them.
+  // Shards are always locked in the same order, after `mutex_`, which prevents deadlocks.
+  void LockAllCommandBufferShards() {
+    mutex_.AssertHeld();
+    for (CommandBufferShard& shard : command_buffer_shards_) {
+      shard.mutex.Lock();
+    }
+  }
+
+  void UnlockAllCommandBufferShards() {
+    for (auto shard_it = command_buffer_shards_.rbegin(); shard_it != command_buffer_shards_.rend();
+         ++shard_it) {
+      shard_it->mutex.Unlock();
+    }
+  }
+
+  [[nodiscard]] static LabelName InternLabelName(CommandBufferShard* shard, const char* text) {
+    shard->mutex.AssertHeld();
+    std::string_view name{text};
+    auto name_it = shard->label_names.find(name);
+    if (name_it != shard->label_names.end()) {
+      return LabelName{&*name_it};
+    }
+    if (shard->label_names.size() >= kMaxInternedLabelNamesPerShard) {
+      return LabelName{std::string{name}};
+    }
+    return LabelName{&*shard->label_names.emplace(name).first};
+  }
+
+  bool RecordTimestamp(const CommandBufferShard& shard, VkCommandBuffer command_buffer,
+                       VkPipelineStageFlagBits pipeline_stage_flags, uint32_t* slot_index) {
+    shard.mutex.AssertHeld();
+
+    ORBIT_CHECK(shard.command_buffer_to_device.contains(command_buffer));
+    VkDevice device = shard.command_buffer_to_device.at(command_buffer);
 
     VkQueryPool query_pool = timer_query_pool_->GetQueryPool(device);
 
@@ -824,8 +923,8 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
 
       orbit_grpc_protos::GpuDebugMarker* marker_proto = submission_proto->add_completed_markers();
       if (vulkan_layer_producer_ != nullptr) {
-        marker_proto->set_text_key(
-            vulkan_layer_producer_->InternStringIfNecessaryAndGetKey(marker_state.label_name));
+        marker_proto->set_text_key(vulkan_layer_producer_->InternStringIfNecessaryAndGetKey(
+            marker_state.label_name.Get()));
       }
 
       auto quantize = [](float value) { return static_cast<uint8_t>(value * 255.f); };
@@ -861,16 +960,17 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     return has_at_least_one_timestamp;
   }
 
-  // This method does not acquire a lock and MUST NOT be called without holding the `mutex_`.
-  void ResetCommandBufferUnsafe(VkCommandBuffer command_buffer) {
-    mutex_.AssertHeld();
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+  // This method does not acquire a lock and MUST NOT be called without holding the mutex of the
+  // `shard` of `command_buffer`.
+  void ResetCommandBufferUnsafe(CommandBufferShard* shard, VkCommandBuffer command_buffer) {
+    shard->mutex.AssertHeld();
+    auto state_it = shard->command_buffer_to_state.find(command_buffer);
+    if (state_it == shard->command_buffer_to_state.end()) {
       return;
     }
-    ORBIT_CHECK(command_buffer_to_state_.contains(command_buffer));
-    CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
-    ORBIT_CHECK(command_buffer_to_device_.contains(command_buffer));
-    VkDevice device = command_buffer_to_device_.at(command_buffer);
+    CommandBufferState& state = state_it->second;
+    ORBIT_CHECK(shard->command_buffer_to_device.contains(command_buffer));
+    VkDevice device = shard->command_buffer_to_device.at(command_buffer);
     std::vector<uint32_t> query_slots_to_reset{};
     if (state.command_buffer_begin_slot_index.has_value()) {
       query_slots_to_reset.push_back(state.command_buffer_begin_slot_index.value());
@@ -889,26 +989,28 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       timer_query_pool_->RollbackPendingQuerySlots(device, query_slots_to_reset);
     }
 
-    command_buffer_to_state_.erase(command_buffer);
+    shard->command_buffer_to_state.erase(state_it);
   }
 
-  void PersistSingleCommandBufferOnSubmit(VkDevice device, VkCommandBuffer command_buffer,
+  void PersistSingleCommandBufferOnSubmit(CommandBufferShard* shard, VkDevice device,
+                                          VkCommandBuffer command_buffer,
                                           QueueSubmission* queue_submission,
                                           SubmitInfo* submitted_submit_info,
                                           std::vector<uint32_t>* query_slots_not_needed_to_read) {
     mutex_.AssertHeld();
+    shard->mutex.AssertHeld();
     ORBIT_CHECK(queue_submission != nullptr);
     ORBIT_CHECK(submitted_submit_info != nullptr);
     ORBIT_CHECK(query_slots_not_needed_to_read != nullptr);
 
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+    auto state_it = shard->command_buffer_to_state.find(command_buffer);
+    if (state_it == shard->command_buffer_to_state.end()) {
       ORBIT_ERROR_ONCE(
           "Calling vkQueueSubmit on a command buffer that is in the initial state (i.e. "
           "either freshly allocated or reset with vkResetCommandBuffer).");
       return;
     }
-    ORBIT_CHECK(command_buffer_to_state_.contains(command_buffer));
-    CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
+    CommandBufferState& state = state_it->second;
     bool has_been_submitted_before = state.pre_submission_cpu_timestamp.has_value();
 
     // Mark that this command buffer in the current state was already submitted. If the command
@@ -923,7 +1025,7 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
         queue_submission->meta_information.pre_submission_cpu_timestamp;
 
     if (device == VK_NULL_HANDLE) {
-      device = command_buffer_to_device_.at(command_buffer);
+      device = shard->command_buffer_to_device.at(command_buffer);
     }
 
     // If we haven't recorded neither the end nor the begin of a command buffer, we have no
@@ -951,21 +1053,23 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   }
 
   void PersistDebugMarkersOfASingleCommandBufferOnSubmit(
-      VkCommandBuffer command_buffer, std::optional<QueueSubmission>* queue_submission_optional,
-      QueueMarkerState* markers, std::vector<uint32_t>* marker_slots_not_needed_to_read) {
+      const CommandBufferShard* shard, VkCommandBuffer command_buffer,
+      std::optional<QueueSubmission>* queue_submission_optional, QueueMarkerState* markers,
+      std::vector<uint32_t>* marker_slots_not_needed_to_read) {
     mutex_.AssertHeld();
+    shard->mutex.AssertHeld();
     ORBIT_CHECK(queue_submission_optional != nullptr);
     ORBIT_CHECK(markers != nullptr);
     ORBIT_CHECK(marker_slots_not_needed_to_read != nullptr);
 
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+    auto state_it = shard->command_buffer_to_state.find(command_buffer);
+    if (state_it == shard->command_buffer_to_state.end()) {
       ORBIT_ERROR_ONCE(
           "Calling vkQueueSubmit on a command buffer that is in the initial state (i.e. "
           "either freshly allocated or reset with vkResetCommandBuffer).");
       return;
     }
-    ORBIT_CHECK(command_buffer_to_state_.contains(command_buffer));
-    const CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
+    const CommandBufferState& state = state_it->second;
 
     for (const Marker& marker : state.markers) {
       std::optional<SubmittedMarker> submitted_marker = std::nullopt;
@@ -1029,11 +1133,10 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     }
   }
 
+  // Serializes submits, presents and capture starts and stops. Always locked before any shard.
   absl::Mutex mutex_;
-  absl::flat_hash_map<VkCommandPool, absl::flat_hash_set<VkCommandBuffer>> pool_to_command_buffers_;
-  absl::flat_hash_map<VkCommandBuffer, VkDevice> command_buffer_to_device_;
-
-  absl::flat_hash_map<VkCommandBuffer, CommandBufferState> command_buffer_to_state_;
+  std::array<CommandPoolShard, kShardCount> command_pool_shards_;
+  std::array<CommandBufferShard, kShardCount> command_buffer_shards_;
 
   static constexpr auto kPreSubmissionCpuTimestampComparator =
       [](const QueueSubmission& lhs, const QueueSubmission& rhs) -> bool {
@@ -5,6 +5,7 @@
 #include <absl/base/casts.h>
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
+#include <absl/strings/str_format.h>
 #include <gmock/gmock.h>
 #include <grpcpp/channel.h>
 #include <gtest/gtest.h>
@@ -12,11 +13,13 @@
 #include <vulkan/vulkan_core.h>
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <limits>
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -1880,4 +1883,219 @@ TEST_F(SubmissionTrackerTest, WillWriteTimestampEvenWhenCommandBufferIsNotInInit
 
   EXPECT_THAT(actual_slots_to_reset, UnorderedElementsAre(kSlotIndex1, kSlotIndex2));
 }
+
+namespace {
+
+// Fakes rather than mocks for recording command buffers on many threads, as mocks serialize all
+// calls on a global lock.
+class FakeDispatchTable {
+ public:
+  // The timestamp of a slot is the slot index itself.
+  PFN_vkGetQueryPoolResults GetQueryPoolResults(VkDevice /*device*/) {
+    return +[](VkDevice /*device*/, VkQueryPool /*queryPool*/, uint32_t first_query,
+               uint32_t /*query_count*/, size_t /*dataSize*/, void* data, VkDeviceSize /*stride*/,
+               VkQueryResultFlags /*flags*/) -> VkResult {
+      *absl::bit_cast<uint64_t*>(data) = first_query;
+      return VK_SUCCESS;
+    };
+  }
+  PFN_vkCmdWriteTimestamp CmdWriteTimestamp(VkCommandBuffer /*command_buffer*/) {
+    return dummy_write_timestamp_function;
+  }
+};
+
+class FakeTimerQueryPool {
+ public:
+  VkQueryPool GetQueryPool(VkDevice /*device*/) { return VK_NULL_HANDLE; }
+  void MarkQuerySlotsForReset(VkDevice /*device*/, const std::vector<uint32_t>& /*slots*/) {}
+  void MarkQuerySlotsDoneReading(VkDevice /*device*/, const std::vector<uint32_t>& /*slots*/) {}
+  void RollbackPendingQuerySlots(VkDevice /*device*/, const std::vector<uint32_t>& /*slots*/) {}
+  bool NextReadyQuerySlot(VkDevice /*device*/, uint32_t* allocated_slot) {
+    *allocated_slot = next_slot_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+ private:
+  std::atomic<uint32_t> next_slot_ = 0;
+};
+
+class FakeDeviceManager {
+ public:
+  VkPhysicalDevice GetPhysicalDeviceOfLogicalDevice(VkDevice /*device*/) { return {}; }
+  VkPhysicalDeviceProperties GetPhysicalDeviceProperties(VkPhysicalDevice /*physical_device*/) {
+    return {.limits = {.timestampPeriod = 1.f}};
+  }
+};
+
+using FakeSubmissionTracker =
+    SubmissionTracker<FakeDispatchTable, FakeDeviceManager, FakeTimerQueryPool>;
+
+void StartCapture(FakeSubmissionTracker* tracker) {
+  orbit_grpc_protos::CaptureOptions capture_options;
+  capture_options.set_max_local_marker_depth_per_command_buffer(
+      std::numeric_limits<uint64_t>::max());
+  tracker->OnCaptureStart(capture_options);
+}
+
+std::vector<VkCommandBuffer> CreateFakeCommandBuffers(uint32_t thread_index, uint32_t count) {
+  std::vector<VkCommandBuffer> command_buffers;
+  for (uint32_t i = 0; i < count; ++i) {
+    command_buffers.push_back(
+        absl::bit_cast<VkCommandBuffer>(static_cast<uintptr_t>(thread_index * count + i + 1)));
+  }
+  return command_buffers;
+}
+
+void RecordCommandBuffer(FakeSubmissionTracker* tracker, VkCommandBuffer command_buffer) {
+  tracker->MarkCommandBufferBegin(command_buffer);
+  tracker->MarkDebugMarkerBegin(command_buffer, "Draw", {});
+  tracker->MarkDebugMarkerEnd(command_buffer);
+  tracker->MarkCommandBufferEnd(command_buffer);
+}
+
+}  // namespace
+
+TEST(SubmissionTracker, CanRecordCommandBuffersOnManyThreadsInParallel) {
+  constexpr uint32_t kThreadCount = 8;
+  constexpr uint32_t kCommandBuffersPerThread = 100;
+  constexpr uint64_t kExpectedTextKey = 111;
+  FakeDispatchTable dispatch_table;
+  FakeTimerQueryPool timer_query_pool;
+  FakeDeviceManager device_manager;
+  MockVulkanLayerProducer producer;
+  FakeSubmissionTracker tracker{&dispatch_table, &timer_query_pool, &device_manager,
+                                std::numeric_limits<uint32_t>::max()};
+  EXPECT_CALL(producer, SetCaptureStatusListener).Times(1);
+  tracker.SetVulkanLayerProducer(&producer);
+  EXPECT_CALL(producer, InternStringIfNecessaryAndGetKey("Draw"))
+      .WillRepeatedly(Return(kExpectedTextKey));
+  std::vector<orbit_grpc_protos::ProducerCaptureEvent> actual_capture_events;
+  EXPECT_CALL(producer, EnqueueCaptureEvent)
+      .WillRepeatedly(
+          Invoke([&actual_capture_events](orbit_grpc_protos::ProducerCaptureEvent&& capture_event) {
+            actual_capture_events.emplace_back(std::move(capture_event));
+            return true;
+          }));
+  StartCapture(&tracker);
+
+  std::vector<VkCommandBuffer> all_command_buffers;
+  std::vector<std::thread> threads;
+  for (uint32_t thread_index = 0; thread_index < kThreadCount; ++thread_index) {
+    std::vector<VkCommandBuffer> command_buffers =
+        CreateFakeCommandBuffers(thread_index, kCommandBuffersPerThread);
+    all_command_buffers.insert(all_command_buffers.end(), command_buffers.begin(),
+                               command_buffers.end());
+    threads.emplace_back([&tracker, command_buffers = std::move(command_buffers), thread_index] {
+      VkCommandPool command_pool =
+          absl::bit_cast<VkCommandPool>(static_cast<uintptr_t>(thread_index + 1));
+      tracker.TrackCommandBuffers({}, command_pool, command_buffers.data(),
+                                  command_buffers.size());
+      for (VkCommandBuffer command_buffer : command_buffers) {
+        RecordCommandBuffer(&tracker, command_buffer);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  VkQueue queue = {};
+  VkSubmitInfo submit_info = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .pNext = nullptr,
+      .commandBufferCount = static_cast<uint32_t>(all_command_buffers.size()),
+      .pCommandBuffers = all_command_buffers.data()};
+  std::optional<FakeSubmissionTracker::QueueSubmission> queue_submission_optional =
+      tracker.PersistCommandBuffersOnSubmit(queue, 1, &submit_info);
+  tracker.PersistDebugMarkersOnSubmit(queue, 1, &submit_info, queue_submission_optional);
+  tracker.CompleteSubmits({});
+
+  ASSERT_EQ(actual_capture_events.size(), 1);
+  ASSERT_TRUE(actual_capture_events[0].has_gpu_queue_submission());
+  const orbit_grpc_protos::GpuQueueSubmission& actual_queue_submission =
+      actual_capture_events[0].gpu_queue_submission();
+
+  // Every command buffer and every debug marker got its own slots, and the fake returns the slot
+  // index as timestamp.
+  absl::flat_hash_set<uint64_t> timestamps;
+  ASSERT_EQ(actual_queue_submission.submit_infos_size(), 1);
+  const orbit_grpc_protos::GpuSubmitInfo& actual_submit_info =
+      actual_queue_submission.submit_infos(0);
+  EXPECT_EQ(actual_submit_info.command_buffers_size(), kThreadCount * kCommandBuffersPerThread);
+  for (const orbit_grpc_protos::GpuCommandBuffer& command_buffer :
+       actual_submit_info.command_buffers()) {
+    EXPECT_TRUE(timestamps.insert(command_buffer.begin_gpu_timestamp_ns()).second);
+    EXPECT_TRUE(timestamps.insert(command_buffer.end_gpu_timestamp_ns()).second);
+  }
+
+  EXPECT_EQ(actual_queue_submission.num_begin_markers(), kThreadCount * kCommandBuffersPerThread);
+  ASSERT_EQ(actual_queue_submission.completed_markers_size(),
+            kThreadCount * kCommandBuffersPerThread);
+  for (const orbit_grpc_protos::GpuDebugMarker& marker :
+       actual_queue_submission.completed_markers()) {
+    EXPECT_TRUE(timestamps.insert(marker.begin_marker().gpu_timestamp_ns()).second);
+    EXPECT_TRUE(timestamps.insert(marker.end_gpu_timestamp_ns()).second);
+    EXPECT_EQ(marker.text_key(), kExpectedTextKey);
+    EXPECT_EQ(marker.depth(), 0);
+  }
+}
+
+TEST(SubmissionTracker, KeepsDebugMarkerNamesBeyondTheInternedOnes) {
+  // More different names than are interned for the command buffer.
+  constexpr uint32_t kMarkerCount = 2000;
+  FakeDispatchTable dispatch_table;
+  FakeTimerQueryPool timer_query_pool;
+  FakeDeviceManager device_manager;
+  MockVulkanLayerProducer producer;
+  FakeSubmissionTracker tracker{&dispatch_table, &timer_query_pool, &device_manager,
+                                std::numeric_limits<uint32_t>::max()};
+  EXPECT_CALL(producer, SetCaptureStatusListener).Times(1);
+  tracker.SetVulkanLayerProducer(&producer);
+  // The key of a name is its index in `actual_names`.
+  std::vector<std::string> actual_names;
+  EXPECT_CALL(producer, InternStringIfNecessaryAndGetKey)
+      .WillRepeatedly(Invoke([&actual_names](std::string name) {
+        actual_names.emplace_back(std::move(name));
+        return actual_names.size() - 1;
+      }));
+  orbit_grpc_protos::ProducerCaptureEvent actual_capture_event;
+  EXPECT_CALL(producer, EnqueueCaptureEvent)
+      .Times(1)
+      .WillOnce(
+          Invoke([&actual_capture_event](orbit_grpc_protos::ProducerCaptureEvent&& capture_event) {
+            actual_capture_event = std::move(capture_event);
+            return true;
+          }));
+  StartCapture(&tracker);
+
+  VkCommandBuffer command_buffer = CreateFakeCommandBuffers(0, 1)[0];
+  tracker.TrackCommandBuffers({}, {}, &command_buffer, 1);
+  tracker.MarkCommandBufferBegin(command_buffer);
+  for (uint32_t i = 0; i < kMarkerCount; ++i) {
+    tracker.MarkDebugMarkerBegin(command_buffer, absl::StrFormat("Marker %u", i).c_str(), {});
+    tracker.MarkDebugMarkerEnd(command_buffer);
+  }
+  tracker.MarkCommandBufferEnd(command_buffer);
+
+  VkQueue queue = {};
+  VkSubmitInfo submit_info = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                              .pNext = nullptr,
+                              .commandBufferCount = 1,
+                              .pCommandBuffers = &command_buffer};
+  std::optional<FakeSubmissionTracker::QueueSubmission> queue_submission_optional =
+      tracker.PersistCommandBuffersOnSubmit(queue, 1, &submit_info);
+  tracker.PersistDebugMarkersOnSubmit(queue, 1, &submit_info, queue_submission_optional);
+  tracker.CompleteSubmits({});
+
+  ASSERT_TRUE(actual_capture_event.has_gpu_queue_submission());
+  const orbit_grpc_protos::GpuQueueSubmission& actual_queue_submission =
+      actual_capture_event.gpu_queue_submission();
+  ASSERT_EQ(actual_queue_submission.completed_markers_size(), kMarkerCount);
+  for (uint32_t i = 0; i < kMarkerCount; ++i) {
+    const uint64_t text_key = actual_queue_submission.completed_markers(i).text_key();
+    ASSERT_LT(text_key, actual_names.size());
+    EXPECT_EQ(actual_names[text_key], absl::StrFormat("Marker %u", i));
+  }
+}
+
 }  // namespace orbit_vulkan_layer
@@ -9,10 +9,15 @@
 #include <absl/container/flat_hash_set.h>
 #include <absl/synchronization/mutex.h>
 #include <absl/types/span.h>
+#include <stddef.h>
 #include <vulkan/vulkan.h>
 
+#include <array>
+#include <atomic>
 #include <fstream>
+#include <memory>
 #include <numeric>
+#include <utility>
 #include <vector>
 
 #include "OrbitBase/Logging.h"
@@ -52,13 +57,16 @@ namespace orbit_vulkan_layer {
 // MarkQuerySlotDoneReading                   MarkQuerySlotForReset
 //
 //
-// Thread-Safety: This class is internally synchronized (using read/write locks) and can be safely
-// accessed from different threads.
+// Thread-Safety: This class is internally synchronized and can be safely accessed from different
+// threads. The slots of each device are split into shards with a lock each, see
+// `NextReadyQuerySlot`.
 template <class DispatchTable>
 class TimerQueryPool {
  public:
   explicit TimerQueryPool(DispatchTable* dispatch_table, uint32_t num_timer_query_slots)
-      : dispatch_table_(dispatch_table), num_timer_query_slots_(num_timer_query_slots) {}
+      : dispatch_table_(dispatch_table),
+        num_timer_query_slots_(num_timer_query_slots),
+        generation_(NextGeneration()) {}
 
   // Creates and resets a vulkan `VkQueryPool`, ready to use for timestamp queries.
   void InitializeTimerQueryPool(VkDevice device) {
@@ -76,62 +84,71 @@ class TimerQueryPool {
 
     dispatch_table_->ResetQueryPoolEXT(device)(device, query_pool, 0, num_timer_query_slots_);
 
+    auto query_slots = std::make_unique<DeviceQuerySlots>();
+    query_slots->query_pool = query_pool;
+    for (size_t shard_index = 0; shard_index < kShardCount; ++shard_index) {
+      SlotShard& shard = query_slots->shards[shard_index];
+      // At the beginning all slot indices in [0, num_timer_query_slots) are free.
+      for (size_t slot_index = shard_index; slot_index < num_timer_query_slots_;
+           slot_index += kShardCount) {
+        shard.slot_states.push_back(SlotState::kReadyForQueryIssue);
+        shard.free_slots.push_back(static_cast<uint32_t>(slot_index));
+      }
+    }
+
     {
       absl::WriterMutexLock lock(&mutex_);
-      ORBIT_CHECK(!device_to_query_pool_.contains(device));
-      device_to_query_pool_[device] = query_pool;
-      std::vector<SlotState> slots{num_timer_query_slots_};
-      std::fill(slots.begin(), slots.end(), SlotState::kReadyForQueryIssue);
-      device_to_query_slots_[device] = slots;
-      std::vector<uint32_t> free_slots(num_timer_query_slots_);
-      // At the beginning all slot indices in [0, num_timer_query_slots) are free.
-      std::iota(free_slots.begin(), free_slots.end(), 0);
-      device_to_free_slots_[device] = free_slots;
+      ORBIT_CHECK(!device_to_query_slots_.contains(device));
+      device_to_query_slots_[device] = std::move(query_slots);
+      generation_.store(NextGeneration(), std::memory_order_release);
     }
   }
 
   // Destroys the VkQueryPool for the given device
   void DestroyTimerQueryPool(VkDevice device) {
     absl::WriterMutexLock lock(&mutex_);
-    ORBIT_CHECK(device_to_query_pool_.contains(device));
-    VkQueryPool query_pool = device_to_query_pool_.at(device);
+    ORBIT_CHECK(device_to_query_slots_.contains(device));
+    VkQueryPool query_pool = device_to_query_slots_.at(device)->query_pool;
     device_to_query_slots_.erase(device);
-    device_to_free_slots_.erase(device);
+    generation_.store(NextGeneration(), std::memory_order_release);
 
     dispatch_table_->DestroyQueryPool(device)(device, query_pool, nullptr);
-
-    device_to_query_pool_.erase(device);
   }
 
   // Retrieves the query pool for a given device. Note that the pool must be initialized using
   // `InitializeTimerQueryPool` before.
   [[nodiscard]] VkQueryPool GetQueryPool(VkDevice device) {
-    absl::ReaderMutexLock lock(&mutex_);
-    ORBIT_CHECK(device_to_query_pool_.contains(device));
-    return device_to_query_pool_.at(device);
+    return GetDeviceQuerySlots(device).query_pool;
   }
 
   // Returns a free query slot from the device's pool if one still exists. It returns `false` if all
   // slots are occupied and true otherwise. If successful, the index will be written to the given
   // `allocated_index`.
   //
+  // Each thread takes the slots from its own shard of the free slots first, and only looks at the
+  // other shards once its shard is exhausted. Hence, threads allocating slots at the same time
+  // usually don't contend for the same lock.
+  //
   // Note that the pool must be initialized using `InitializeTimerQueryPool` before.
   // See also `ResetQuerySlots` to make occupied slots available again.
   [[nodiscard]] bool NextReadyQuerySlot(VkDevice device, uint32_t* allocated_index) {
-    absl::WriterMutexLock lock(&mutex_);
-    ORBIT_CHECK(device_to_free_slots_.contains(device));
-    ORBIT_CHECK(device_to_query_slots_.contains(device));
-    std::vector<uint32_t>& free_slots = device_to_free_slots_.at(device);
-    if (free_slots.empty()) {
-      return false;
-    }
-    *allocated_index = free_slots.back();
-    free_slots.pop_back();
+    DeviceQuerySlots& query_slots = GetDeviceQuerySlots(device);
+    const size_t home_shard_index = GetHomeShardIndexOfThisThread();
+    for (size_t i = 0; i < kShardCount; ++i) {
+      SlotShard& shard = query_slots.shards[(home_shard_index + i) % kShardCount];
+      absl::MutexLock lock(&shard.mutex);
+      if (shard.free_slots.empty()) {
+        continue;
+      }
+      *allocated_index = shard.free_slots.back();
+      shard.free_slots.pop_back();
 
-    ORBIT_CHECK(device_to_query_slots_.at(device)[*allocated_index] ==
-                SlotState::kReadyForQueryIssue);
-    device_to_query_slots_.at(device)[*allocated_index] = SlotState::kQueryPendingOnGpu;
-    return true;
+      SlotState& slot_state = shard.slot_states[*allocated_index / kShardCount];
+      ORBIT_CHECK(slot_state == SlotState::kReadyForQueryIssue);
+      slot_state = SlotState::kQueryPendingOnGpu;
+      return true;
+    }
+    return false;
   }
 
   // Marks for the given slots that the Vulkan layer will not do any attempts to read the underlying
@@ -149,24 +166,21 @@ class TimerQueryPool {
     if (slot_indices.empty()) {
       return;
     }
-    absl::WriterMutexLock lock(&mutex_);
-    ORBIT_CHECK(device_to_query_slots_.contains(device));
-    std::vector<SlotState>& slot_states = device_to_query_slots_.at(device);
-    ORBIT_CHECK(device_to_free_slots_.contains(device));
-    std::vector<uint32_t>& free_slots = device_to_free_slots_.at(device);
-    for (uint32_t slot_index : slot_indices) {
-      ORBIT_CHECK(slot_index < num_timer_query_slots_);
-      const SlotState& current_state = slot_states[slot_index];
-      if (current_state == SlotState::kQueryPendingOnGpu) {
-        slot_states[slot_index] = SlotState::kDoneReading;
-        continue;
-      }
-      ORBIT_CHECK(current_state == SlotState::kResetRequested);
-      slot_states[slot_index] = SlotState::kReadyForQueryIssue;
-      free_slots.push_back(slot_index);
-      VkQueryPool query_pool = device_to_query_pool_.at(device);
-      dispatch_table_->ResetQueryPoolEXT(device)(device, query_pool, slot_index, 1);
-    }
+    DeviceQuerySlots& query_slots = GetDeviceQuerySlots(device);
+    ForEachSlotStateWithShardLocked(
+        &query_slots, slot_indices,
+        [this, device, &query_slots](SlotShard& shard, uint32_t slot_index,
+                                     SlotState& current_state) {
+          if (current_state == SlotState::kQueryPendingOnGpu) {
+            current_state = SlotState::kDoneReading;
+            return;
+          }
+          ORBIT_CHECK(current_state == SlotState::kResetRequested);
+          current_state = SlotState::kReadyForQueryIssue;
+          shard.free_slots.push_back(slot_index);
+          dispatch_table_->ResetQueryPoolEXT(device)(device, query_slots.query_pool, slot_index,
+                                                     1);
+        });
   }
 
   // Marks that the underlying slots are not used by any command buffer anymore
@@ -184,24 +198,21 @@ class TimerQueryPool {
     if (slot_indices.empty()) {
       return;
     }
-    absl::WriterMutexLock lock(&mutex_);
-    ORBIT_CHECK(device_to_query_slots_.contains(device));
-    std::vector<SlotState>& slot_states = device_to_query_slots_.at(device);
-    ORBIT_CHECK(device_to_free_slots_.contains(device));
-    std::vector<uint32_t>& free_slots = device_to_free_slots_.at(device);
-    for (uint32_t slot_index : slot_indices) {
-      ORBIT_CHECK(slot_index < num_timer_query_slots_);
-      const SlotState& current_state = slot_states[slot_index];
-      if (current_state == SlotState::kQueryPendingOnGpu) {
-        slot_states[slot_index] = SlotState::kResetRequested;
-        continue;
-      }
-      ORBIT_CHECK(current_state == SlotState::kDoneReading);
-      slot_states[slot_index] = SlotState::kReadyForQueryIssue;
-      free_slots.push_back(slot_index);
-      VkQueryPool query_pool = device_to_query_pool_.at(device);
-      dispatch_table_->ResetQueryPoolEXT(device)(device, query_pool, slot_index, 1);
-    }
+    DeviceQuerySlots& query_slots = GetDeviceQuerySlots(device);
+    ForEachSlotStateWithShardLocked(
+        &query_slots, slot_indices,
+        [this, device, &query_slots](SlotShard& shard, uint32_t slot_index,
+                                     SlotState& current_state) {
+          if (current_state == SlotState::kQueryPendingOnGpu) {
+            current_state = SlotState::kResetRequested;
+            return;
+          }
+          ORBIT_CHECK(current_state == SlotState::kDoneReading);
+          current_state = SlotState::kReadyForQueryIssue;
+          shard.free_slots.push_back(slot_index);
+          dispatch_table_->ResetQueryPoolEXT(device)(device, query_slots.query_pool, slot_index,
+                                                     1);
+        });
   }
 
   // Resets an occupied slot to be ready for queries again. It will *not* call to Vulkan to reset
@@ -216,18 +227,14 @@ class TimerQueryPool {
     if (slot_indices.empty()) {
       return;
     }
-    absl::WriterMutexLock lock(&mutex_);
-    ORBIT_CHECK(device_to_query_slots_.contains(device));
-    std::vector<SlotState>& slot_states = device_to_query_slots_.at(device);
-    ORBIT_CHECK(device_to_free_slots_.contains(device));
-    std::vector<uint32_t>& free_slots = device_to_free_slots_.at(device);
-    for (uint32_t slot_index : slot_indices) {
-      ORBIT_CHECK(slot_index < num_timer_query_slots_);
-      const SlotState& current_state = slot_states[slot_index];
-      ORBIT_CHECK(current_state == SlotState::kQueryPendingOnGpu);
-      slot_states[slot_index] = SlotState::kReadyForQueryIssue;
-      free_slots.push_back(slot_index);
-    }
+    DeviceQuerySlots& query_slots = GetDeviceQuerySlots(device);
+    ForEachSlotStateWithShardLocked(
+        &query_slots, slot_indices,
+        [](SlotShard& shard, uint32_t slot_index, SlotState& current_state) {
+          ORBIT_CHECK(current_state == SlotState::kQueryPendingOnGpu);
+          current_state = SlotState::kReadyForQueryIssue;
+          shard.free_slots.push_back(slot_index);
+        });
   }
 
  private:
@@ -238,14 +245,87 @@ class TimerQueryPool {
     kResetRequested = 3
   };
 
+  static constexpr size_t kShardCount = 16;
+
+  // The slots whose index modulo `kShardCount` is the index of the shard. The state of slot i is at
+  // `slot_states[i / kShardCount]`. Each shard is on its own cache line, such that threads
+  // allocating slots from different shards don't keep invalidating each other's cache line.
+  struct alignas(64) SlotShard {
+    absl::Mutex mutex;
+    std::vector<SlotState> slot_states;
+    std::vector<uint32_t> free_slots;
+  };
+
+  struct DeviceQuerySlots {
+    VkQueryPool query_pool{};
+    std::array<SlotShard, kShardCount> shards;
+  };
+
+  // Identifies the state of `device_to_query_slots_`, across all pools, such that a thread can tell
+  // whether the `DeviceQuerySlots` it looked up before are still valid.
+  [[nodiscard]] static uint64_t NextGeneration() {
+    static std::atomic<uint64_t> next_generation = 1;
+    return next_generation.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Threads are assigned to shards round-robin, in the order in which they first allocate a slot.
+  [[nodiscard]] static size_t GetHomeShardIndexOfThisThread() {
+    static std::atomic<size_t> next_home_shard_index = 0;
+    thread_local const size_t home_shard_index =
+        next_home_shard_index.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+    return home_shard_index;
+  }
+
+  // Only takes `mutex_` when this thread hasn't looked up `device` in this pool yet, or a pool
+  // was initialized or destroyed since. As Vulkan requires that a device is no longer used when it
+  // is destroyed, the slots of a device can't be destroyed while a thread still uses them.
+  [[nodiscard]] DeviceQuerySlots& GetDeviceQuerySlots(VkDevice device) {
+    struct CachedDeviceQuerySlots {
+      const TimerQueryPool* pool = nullptr;
+      VkDevice device{};
+      uint64_t generation = 0;
+      DeviceQuerySlots* query_slots = nullptr;
+    };
+    thread_local CachedDeviceQuerySlots cached;
+    if (cached.pool == this && cached.device == device &&
+        cached.generation == generation_.load(std::memory_order_acquire)) {
+      return *cached.query_slots;
+    }
+
+    absl::ReaderMutexLock lock(&mutex_);
+    ORBIT_CHECK(device_to_query_slots_.contains(device));
+    cached = {this, device, generation_.load(std::memory_order_relaxed),
+              device_to_query_slots_.at(device).get()};
+    return *cached.query_slots;
+  }
+
+  // Calls `update_slot_state` for each of the slots, while holding the lock of its shard. The lock
+  // is only released when the next slot belongs to a different shard.
+  template <typename UpdateSlotState>
+  void ForEachSlotStateWithShardLocked(DeviceQuerySlots* query_slots,
+                                       absl::Span<const uint32_t> slot_indices,
+                                       UpdateSlotState&& update_slot_state) {
+    SlotShard* locked_shard = nullptr;
+    for (uint32_t slot_index : slot_indices) {
+      ORBIT_CHECK(slot_index < num_timer_query_slots_);
+      SlotShard* shard = &query_slots->shards[slot_index % kShardCount];
+      if (shard != locked_shard) {
+        if (locked_shard != nullptr) locked_shard->mutex.Unlock();
+        shard->mutex.Lock();
+        locked_shard = shard;
+      }
+      update_slot_state(*shard, slot_index, shard->slot_states[slot_index / kShardCount]);
+    }
+    if (locked_shard != nullptr) locked_shard->mutex.Unlock();
+  }
+
   DispatchTable* dispatch_table_;
   const uint32_t num_timer_query_slots_;
 
   absl::Mutex mutex_;
-
-  absl::flat_hash_map<VkDevice, VkQueryPool> device_to_query_pool_;
-  absl::flat_hash_map<VkDevice, std::vector<SlotState>> device_to_query_slots_;
-  absl::flat_hash_map<VkDevice, std::vector<uint32_t>> device_to_free_slots_;
+  absl::flat_hash_map<VkDevice, std::unique_ptr<DeviceQuerySlots>> device_to_query_slots_;
+  // Changes, under `mutex_`, whenever `device_to_query_slots_` changes.
+  std::atomic<uint64_t> generation_;
 };
 }  // namespace orbit_vulkan_layer
 
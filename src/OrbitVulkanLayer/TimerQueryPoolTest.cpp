@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <thread>
 #include <vector>
 
 #include "TimerQueryPool.h"
@@ -426,4 +427,51 @@ TEST(TimerQueryPool, CanRepeatadlyRetrieveAndResetSlots) {
   }
 }
 
+TEST(TimerQueryPool, CanRetrieveAndResetSlotsFromManyThreads) {
+  MockDispatchTable dispatch_table;
+  static constexpr uint32_t kNumSlots = 64;
+  static constexpr size_t kNumThreads = 8;
+  TimerQueryPool<MockDispatchTable> query_pool(&dispatch_table, kNumSlots);
+  VkDevice device = {};
+  EXPECT_CALL(dispatch_table, CreateQueryPool)
+      .WillRepeatedly(Return(dummy_create_query_pool_function));
+  EXPECT_CALL(dispatch_table, ResetQueryPoolEXT)
+      .WillRepeatedly(Return(dummy_reset_query_pool_function));
+
+  query_pool.InitializeTimerQueryPool(device);
+
+  std::vector<std::thread> threads;
+  for (size_t thread_index = 0; thread_index < kNumThreads; ++thread_index) {
+    threads.emplace_back([&query_pool, device] {
+      for (int i = 0; i < 1000; ++i) {
+        // Each thread holds at most `kNumSlots / kNumThreads` slots at the same time, so it always
+        // finds enough slots, even if they are not in its own shard.
+        std::vector<uint32_t> slots(kNumSlots / kNumThreads);
+        for (uint32_t& slot : slots) {
+          ASSERT_TRUE(query_pool.NextReadyQuerySlot(device, &slot));
+        }
+        if (i % 2 == 0) {
+          query_pool.MarkQuerySlotsDoneReading(device, slots);
+          query_pool.MarkQuerySlotsForReset(device, slots);
+        } else {
+          query_pool.RollbackPendingQuerySlots(device, slots);
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  absl::flat_hash_set<uint32_t> slots;
+  for (uint32_t i = 0; i < kNumSlots; ++i) {
+    uint32_t slot = 0;
+    ASSERT_TRUE(query_pool.NextReadyQuerySlot(device, &slot));
+    slots.insert(slot);
+  }
+  EXPECT_EQ(slots.size(), kNumSlots);
+  uint32_t slot = 0;
+  EXPECT_FALSE(query_pool.NextReadyQuerySlot(device, &slot));
+}
+
 }  // namespace orbit_vulkan_layer
@@ -19,8 +19,9 @@ uint64_t VulkanLayerProducerImpl::InternStringIfNecessaryAndGetKey(std::string s
     event.mutable_interned_string()->set_key(key);
     event.mutable_interned_string()->set_intern(std::move(str));
     if (!EnqueueCaptureEvent(std::move(event))) {
-      // If the interned string wasn't actually sent because we are no longer capturing,
-      // remove it from string_keys_sent_.
+      // If the interned string wasn't actually sent because we are no longer capturing, or because
+      // the buffer of this thread is full, remove it from string_keys_sent_ so that it is sent with
+      // the next event that uses it.
       string_keys_sent_.erase(key);
     }
     return key;
@@ -11,6 +11,7 @@
 #include <google/protobuf/arena.h>
 #include <grpcpp/channel.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -28,6 +29,12 @@ namespace orbit_vulkan_layer {
 // while also handling interning of strings.
 class VulkanLayerProducerImpl : public VulkanLayerProducer {
  public:
+  // `per_thread_buffer_capacity` is the number of events each thread can have in flight.
+  explicit VulkanLayerProducerImpl(
+      size_t per_thread_buffer_capacity =
+          LockFreeBufferVulkanLayerProducer::kDefaultPerThreadBufferCapacity)
+      : lock_free_producer_{this, per_thread_buffer_capacity} {}
+
   void BringUp(const std::shared_ptr<grpc::Channel>& channel) override {
     return lock_free_producer_.BuildAndStart(channel);
   }
@@ -50,7 +57,9 @@ class VulkanLayerProducerImpl : public VulkanLayerProducer {
       : public orbit_capture_event_producer::LockFreeBufferCaptureEventProducer<
             orbit_grpc_protos::ProducerCaptureEvent> {
    public:
-    explicit LockFreeBufferVulkanLayerProducer(VulkanLayerProducerImpl* outer) : outer_{outer} {}
+    LockFreeBufferVulkanLayerProducer(VulkanLayerProducerImpl* outer,
+                                      size_t per_thread_buffer_capacity)
+        : LockFreeBufferCaptureEventProducer{per_thread_buffer_capacity}, outer_{outer} {}
 
    protected:
     void OnCaptureStart(orbit_grpc_protos::CaptureOptions capture_options) override {
@@ -104,7 +113,7 @@ class VulkanLayerProducerImpl : public VulkanLayerProducer {
     string_keys_sent_.clear();
   }
 
-  LockFreeBufferVulkanLayerProducer lock_free_producer_{this};
+  LockFreeBufferVulkanLayerProducer lock_free_producer_;
 
   absl::flat_hash_set<uint64_t> string_keys_sent_;
   absl::Mutex string_keys_sent_mutex_;
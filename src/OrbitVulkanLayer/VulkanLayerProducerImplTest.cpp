@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/container/flat_hash_set.h>
 #include <absl/synchronization/mutex.h>
 #include <absl/types/span.h>
 #include <gmock/gmock.h>
@@ -13,6 +14,7 @@
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <iterator>
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -565,5 +567,66 @@ TEST_F(VulkanLayerProducerImplTest, InternOnlyWhenCapturing) {
   fake_service_->SendCaptureFinishedCommand();
 }
 
+TEST_F(VulkanLayerProducerImplTest, InternedStringsStillResolveWhenBufferIsFull) {
+  // Replace the producer with one whose buffer fills up quickly.
+  producer_->TakeDown();
+  constexpr size_t kSmallPerThreadBufferCapacity = 4;
+  producer_.emplace(kSmallPerThreadBufferCapacity);
+  producer_->SetCaptureStatusListener(&mock_listener_);
+  producer_->BringUp(fake_server_->InProcessChannel(grpc::ChannelArguments{}));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  EXPECT_CALL(mock_listener_, OnCaptureStart).Times(1);
+  fake_service_->SendStartCaptureCommand(kFakeCaptureOptions);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  std::vector<orbit_grpc_protos::ProducerCaptureEvent> events_received;
+  absl::Mutex events_received_mutex;
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived)
+      .WillRepeatedly([&events_received, &events_received_mutex](
+                          absl::Span<const orbit_grpc_protos::ProducerCaptureEvent> events) {
+        absl::MutexLock lock{&events_received_mutex};
+        events_received.insert(events_received.end(), events.begin(), events.end());
+      });
+
+  // The ForwarderThread empties the buffer at most about every millisecond, so most of these
+  // events, including interned strings, are dropped.
+  constexpr size_t kEventCount = 1000;
+  const std::string names[] = {kInternedString1, kInternedString2, kInternedString3};
+  size_t enqueued_event_count = 0;
+  for (size_t i = 0; i < kEventCount; ++i) {
+    orbit_grpc_protos::ProducerCaptureEvent event;
+    event.mutable_api_scope_start()->set_name_key(
+        producer_->InternStringIfNecessaryAndGetKey(names[i % std::size(names)]));
+    if (producer_->EnqueueCaptureEvent(std::move(event))) ++enqueued_event_count;
+  }
+  EXPECT_LT(enqueued_event_count, kEventCount);
+
+  EXPECT_CALL(mock_listener_, OnCaptureStop).Times(1);
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(1);
+  fake_service_->SendStopCaptureCommand();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  // Every key that an event refers to was sent as an interned string before the event.
+  {
+    absl::MutexLock lock{&events_received_mutex};
+    absl::flat_hash_set<uint64_t> keys_received;
+    size_t api_scope_start_count = 0;
+    for (const orbit_grpc_protos::ProducerCaptureEvent& event : events_received) {
+      if (event.event_case() == orbit_grpc_protos::ProducerCaptureEvent::kInternedString) {
+        keys_received.insert(event.interned_string().key());
+      } else {
+        ASSERT_EQ(event.event_case(), orbit_grpc_protos::ProducerCaptureEvent::kApiScopeStart);
+        EXPECT_TRUE(keys_received.contains(event.api_scope_start().name_key()));
+        ++api_scope_start_count;
+      }
+    }
+    EXPECT_GT(api_scope_start_count, 0);
+  }
+
+  EXPECT_CALL(mock_listener_, OnCaptureFinished).Times(1);
+  fake_service_->SendCaptureFinishedCommand();
+}
+
 }  // namespace
 }  // namespace orbit_vulkan_layer
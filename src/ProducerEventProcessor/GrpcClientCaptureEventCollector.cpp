@@ -49,12 +49,7 @@ GrpcClientCaptureEventCollector::GrpcClientCaptureEventCollector(
   sender_thread_ = std::thread{[this] { SenderThread(); }};
 }
 
-void GrpcClientCaptureEventCollector::AddEvent(ClientCaptureEvent&& event) {
-  absl::MutexLock lock{&mutex_};
-  if (stop_requested_) {
-    return;
-  }
-
+CaptureResponse* GrpcClientCaptureEventCollector::GetCaptureResponseToAddEventTo() {
   // We group several ClientCaptureEvents in a single CaptureResponse to avoid sending countless
   // tiny messages. But we also want to avoid huge messages, which:
   // - would cause the capture on the client to jump forward in time in few big steps and not look
@@ -68,7 +63,30 @@ void GrpcClientCaptureEventCollector::AddEvent(ClientCaptureEvent&& event) {
         arena_of_capture_responses_being_built_.get());
     capture_responses_being_built_.push_back(capture_response);
   }
-  capture_responses_being_built_.back()->mutable_capture_events()->Add(std::move(event));
+  return capture_responses_being_built_.back();
+}
+
+void GrpcClientCaptureEventCollector::AddEvent(ClientCaptureEvent&& event) {
+  absl::MutexLock lock{&mutex_};
+  if (stop_requested_) {
+    return;
+  }
+
+  GetCaptureResponseToAddEventTo()->mutable_capture_events()->Add(std::move(event));
+}
+
+void GrpcClientCaptureEventCollector::AddEvents(ClientCaptureEventBatch&& batch) {
+  absl::MutexLock lock{&mutex_};
+  if (stop_requested_) {
+    return;
+  }
+
+  // The events are not copied into the Arena of the CaptureResponses: the CaptureResponses only
+  // reference them, and the Arena of the batch is kept alive until they have been sent.
+  for (ClientCaptureEvent* event : batch.events()) {
+    GetCaptureResponseToAddEventTo()->mutable_capture_events()->UnsafeArenaAddAllocated(event);
+  }
+  arenas_of_batches_being_built_.push_back(batch.ReleaseArena());
 }
 
 void GrpcClientCaptureEventCollector::StopAndWait() {
@@ -106,7 +124,8 @@ void GrpcClientCaptureEventCollector::SenderThread() {
     mutex_.LockWhenWithTimeout(
         absl::Condition(
             +[](GrpcClientCaptureEventCollector* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
-              // This should be lower than (not equal to) kMaxEventsPerCaptureResponse in AddEvent
+              // This should be lower than (not equal to) kMaxEventsPerCaptureResponse in
+              // GetCaptureResponseToAddEventTo
               // as a few more ClientCaptureEvents are likely to arrive after the condition becomes
               // true.
               constexpr int kSendEventCountInterval = 5000;
@@ -130,6 +149,7 @@ void GrpcClientCaptureEventCollector::SenderThread() {
     // `arena_of_capture_response_to_send_` are effectively the two buffers.
     arena_of_capture_responses_being_built_.swap(arena_of_capture_responses_to_send_);
     capture_responses_being_built_.swap(capture_responses_to_send_);
+    arenas_of_batches_being_built_.swap(arenas_of_batches_to_send_);
     mutex_.Unlock();
 
     uint64_t number_of_events_sent = 0;
@@ -173,6 +193,9 @@ void GrpcClientCaptureEventCollector::SenderThread() {
 
     capture_responses_to_send_.clear();
     arena_of_capture_responses_to_send_->Reset();
+    // Only now that the CaptureResponses referencing them are gone can the events from
+    // ClientCaptureEventBatches be freed.
+    arenas_of_batches_to_send_.clear();
   }
 }
 
@@ -11,10 +11,13 @@
 #include <chrono>
 #include <memory>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "GrpcProtos/capture.pb.h"
 #include "GrpcProtos/services.pb.h"
 #include "OrbitBase/Logging.h"
+#include "ProducerEventProcessor/CaptureEventBatch.h"
 #include "ProducerEventProcessor/GrpcClientCaptureEventCollector.h"
 
 using orbit_grpc_protos::CaptureRequest;
@@ -69,6 +72,14 @@ class GrpcClientCaptureEventCollectorTest : public testing::Test {
     }
   }
 
+  void AddFakeEventBatch(uint64_t event_count) {
+    ClientCaptureEventBatch batch;
+    for (uint64_t i = 0; i < event_count; ++i) {
+      batch.AddEvent()->mutable_scheduling_slice()->set_duration_ns(i);
+    }
+    collector_.AddEvents(std::move(batch));
+  }
+
   void CallStopAndWaitEarly() {
     ORBIT_CHECK(!stop_and_wait_called_);
     collector_.StopAndWait();
@@ -110,7 +121,8 @@ TEST_F(GrpcClientCaptureEventCollectorTest, ManyEventsAreSplitAcrossMultipleCapt
   EXPECT_CALL(mock_reader_writer_, OnCaptureResponse)
       // This depends on the values of kSendEventCountInterval (5000) in
       // GrpcClientCaptureEventCollector::SenderThread, and of
-      // kMaxEventsPerCaptureResponse (10000) in GrpcClientCaptureEventCollector::AddEvent.
+      // kMaxEventsPerCaptureResponse (10000) in
+      // GrpcClientCaptureEventCollector::GetCaptureResponseToAddEventTo.
       // So expect seven CaptureResponse, the first six of which with ~5000 events. But there could
       // be fewer CaptureResponses as they can fit up to 10000 events.
       .Times(testing::Between(4, 7))
@@ -157,4 +169,41 @@ TEST_F(GrpcClientCaptureEventCollectorTest, AllCaptureResponsesSentShortlyAfterS
   EXPECT_EQ(actual_event_count, kEventCount);
 }
 
+TEST_F(GrpcClientCaptureEventCollectorTest, EventsOfBatchesAreSentInOrder) {
+  std::vector<uint64_t> actual_durations;
+  EXPECT_CALL(mock_reader_writer_, OnCaptureResponse)
+      .Times(testing::Between(1, 2))
+      .WillRepeatedly([&actual_durations](const CaptureResponse& capture_response) {
+        for (const ClientCaptureEvent& event : capture_response.capture_events()) {
+          actual_durations.push_back(event.scheduling_slice().duration_ns());
+        }
+      });
+
+  AddFakeEventBatch(3);
+  AddFakeEvents(1);
+  AddFakeEventBatch(2);
+
+  CallStopAndWaitEarly();
+  EXPECT_THAT(actual_durations, testing::ElementsAre(0, 1, 2, 0, 0, 1));
+}
+
+TEST_F(GrpcClientCaptureEventCollectorTest, ManyEventsOfBatchesAreSplitAcrossCaptureResponses) {
+  std::atomic<uint64_t> actual_event_count = 0;
+  EXPECT_CALL(mock_reader_writer_, OnCaptureResponse)
+      .Times(testing::Between(4, 7))
+      .WillRepeatedly([&actual_event_count](const CaptureResponse& capture_response) {
+        EXPECT_LE(capture_response.capture_events_size(), 10'000);
+        actual_event_count += capture_response.capture_events_size();
+      });
+
+  static constexpr uint64_t kEventCount = 32000;
+  static constexpr uint64_t kBatchSize = 4000;
+  for (uint64_t i = 0; i < kEventCount / kBatchSize; ++i) {
+    AddFakeEventBatch(kBatchSize);
+  }
+
+  std::this_thread::sleep_for(kWaitAllCaptureResponsesSentDuration);
+  EXPECT_EQ(actual_event_count, kEventCount);
+}
+
 }  // namespace orbit_producer_event_processor
@@ -0,0 +1,86 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_EVENT_PROCESSOR_INTERN_POOL_H_
+#define CAPTURE_EVENT_PROCESSOR_INTERN_POOL_H_
+
+#include <absl/base/optimization.h>
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+namespace orbit_producer_event_processor {
+
+// Assigns unique ids to entries (callstacks, strings, ...), returning the same id every time the
+// same entry is passed. Ids start from 1, as 0 is reserved for invalid_id.
+// The pool is used concurrently by the threads processing the events of all producers. To avoid
+// contention, the entries are distributed by hash over several shards, each with its own map and
+// lock. Lookups of entries already in the pool, by far the most frequent case, only take the lock
+// of their shard in shared mode; ids come from a single atomic counter.
+// Extra template arguments are forwarded to absl::flat_hash_map, to allow passing a transparent
+// hash and equality, and then looking up entries by a type other than T, from which T is
+// constructible.
+template <typename T, typename... MapArgs>
+class InternPool final {
+ public:
+  InternPool() = default;
+
+  // Return pair of <id, assigned>, where assigned is true if the entry was assigned a new id
+  // and false if returning id for already existing entry. For each entry, exactly one call
+  // returns assigned == true, even when called concurrently.
+  template <typename U = T>
+  std::pair<uint64_t, bool> GetOrAssignId(const U& entry) {
+    Shard& shard = shards_[GetShardIndex(entry)];
+    {
+      absl::ReaderMutexLock lock{&shard.mutex};
+      auto it = shard.entry_to_id.find(entry);
+      if (it != shard.entry_to_id.end()) {
+        return std::make_pair(it->second, false);
+      }
+    }
+
+    absl::WriterMutexLock lock{&shard.mutex};
+    // Another thread could have added the entry in the meantime.
+    auto it = shard.entry_to_id.find(entry);
+    if (it != shard.entry_to_id.end()) {
+      return std::make_pair(it->second, false);
+    }
+    uint64_t new_id = id_counter_.fetch_add(1, std::memory_order_relaxed);
+    shard.entry_to_id.emplace(T{entry}, new_id);
+    return std::make_pair(new_id, true);
+  }
+
+ private:
+  using Map = absl::flat_hash_map<T, uint64_t, MapArgs...>;
+
+  static constexpr int kShardCountLog2 = 6;
+  static constexpr size_t kShardCount = size_t{1} << kShardCountLog2;
+
+  template <typename U>
+  [[nodiscard]] static size_t GetShardIndex(const U& entry) {
+    // Use the most significant bits of the hash, as the maps use the least significant ones to
+    // choose the slot: this way the entries of a shard are still spread over all of its slots.
+    return typename Map::hasher{}(entry) >> (std::numeric_limits<size_t>::digits - kShardCountLog2);
+  }
+
+  // Each shard is on its own cache lines, so that threads using different shards don't interfere.
+  struct alignas(ABSL_CACHELINE_SIZE) Shard {
+    absl::Mutex mutex;
+    Map entry_to_id ABSL_GUARDED_BY(mutex);
+  };
+
+  std::atomic<uint64_t> id_counter_{1};  // 0 is reserved for invalid_id
+  std::array<Shard, kShardCount> shards_;
+};
+
+}  // namespace orbit_producer_event_processor
+
+#endif  // CAPTURE_EVENT_PROCESSOR_INTERN_POOL_H_
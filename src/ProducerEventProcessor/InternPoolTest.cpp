@@ -0,0 +1,121 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "InternPool.h"
+
+namespace orbit_producer_event_processor {
+
+TEST(InternPool, AssignsIdsStartingFromOne) {
+  InternPool<std::string> pool;
+  EXPECT_EQ(pool.GetOrAssignId(std::string{"a"}), std::make_pair(uint64_t{1}, true));
+  EXPECT_EQ(pool.GetOrAssignId(std::string{"b"}), std::make_pair(uint64_t{2}, true));
+}
+
+TEST(InternPool, ReturnsSameIdForSameEntry) {
+  InternPool<std::pair<std::string, std::string>> pool;
+  auto [first_id, first_assigned] = pool.GetOrAssignId({"category", "name"});
+  EXPECT_TRUE(first_assigned);
+  auto [other_id, other_assigned] = pool.GetOrAssignId({"category", "other_name"});
+  EXPECT_TRUE(other_assigned);
+  EXPECT_NE(other_id, first_id);
+
+  EXPECT_EQ(pool.GetOrAssignId({"category", "name"}), std::make_pair(first_id, false));
+  EXPECT_EQ(pool.GetOrAssignId({"category", "other_name"}), std::make_pair(other_id, false));
+}
+
+namespace {
+
+struct Point {
+  explicit Point(const std::pair<int, int>& pair) : x{pair.first}, y{pair.second} {}
+  int x;
+  int y;
+};
+
+struct PointHash {
+  using is_transparent = void;
+  size_t operator()(const Point& point) const { return (*this)(std::make_pair(point.x, point.y)); }
+  size_t operator()(const std::pair<int, int>& pair) const {
+    return absl::Hash<std::pair<int, int>>{}(pair);
+  }
+};
+
+struct PointEq {
+  using is_transparent = void;
+  bool operator()(const Point& lhs, const Point& rhs) const {
+    return lhs.x == rhs.x && lhs.y == rhs.y;
+  }
+  bool operator()(const Point& lhs, const std::pair<int, int>& rhs) const {
+    return lhs.x == rhs.first && lhs.y == rhs.second;
+  }
+  bool operator()(const std::pair<int, int>& lhs, const Point& rhs) const {
+    return (*this)(rhs, lhs);
+  }
+};
+
+}  // namespace
+
+TEST(InternPool, SupportsHeterogeneousLookup) {
+  InternPool<Point, PointHash, PointEq> pool;
+  auto [id, assigned] = pool.GetOrAssignId(std::make_pair(1, 2));
+  EXPECT_TRUE(assigned);
+  EXPECT_EQ(pool.GetOrAssignId(std::make_pair(1, 2)), std::make_pair(id, false));
+  EXPECT_EQ(pool.GetOrAssignId(Point{std::make_pair(1, 2)}), std::make_pair(id, false));
+  EXPECT_TRUE(pool.GetOrAssignId(std::make_pair(2, 1)).second);
+}
+
+TEST(InternPool, AssignsUniqueIdsWhenUsedConcurrently) {
+  constexpr int kThreadCount = 8;
+  constexpr int kEntryCount = 10'000;
+  InternPool<std::string> pool;
+
+  // Every thread interns all the entries, in a different order.
+  std::vector<absl::flat_hash_map<std::string, std::pair<uint64_t, bool>>> results_by_thread(
+      kThreadCount);
+  std::vector<std::thread> threads;
+  for (int thread_index = 0; thread_index < kThreadCount; ++thread_index) {
+    threads.emplace_back([&pool, &results = results_by_thread[thread_index], thread_index] {
+      std::vector<int> entries(kEntryCount);
+      for (int i = 0; i < kEntryCount; ++i) entries[i] = i;
+      std::mt19937 random_generator{static_cast<uint32_t>(thread_index)};
+      std::shuffle(entries.begin(), entries.end(), random_generator);
+      for (int entry : entries) {
+        std::string entry_string = std::to_string(entry);
+        results.emplace(entry_string, pool.GetOrAssignId(entry_string));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  absl::flat_hash_set<uint64_t> ids;
+  for (int entry = 0; entry < kEntryCount; ++entry) {
+    const std::string entry_string = std::to_string(entry);
+    const uint64_t id = results_by_thread[0].at(entry_string).first;
+    int assigned_count = 0;
+    for (const auto& results : results_by_thread) {
+      EXPECT_EQ(results.at(entry_string).first, id);
+      if (results.at(entry_string).second) ++assigned_count;
+    }
+    EXPECT_EQ(assigned_count, 1);
+    EXPECT_GE(id, 1);
+    EXPECT_LE(id, static_cast<uint64_t>(kEntryCount));
+    ids.insert(id);
+  }
+  EXPECT_EQ(ids.size(), static_cast<size_t>(kEntryCount));
+}
+
+}  // namespace orbit_producer_event_processor
@@ -7,15 +7,18 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/hash/hash.h>
 #include <absl/meta/type_traits.h>
-#include <absl/synchronization/mutex.h>
+#include <absl/strings/str_format.h>
+#include <absl/types/span.h>
 #include <google/protobuf/stubs/port.h>
 
+#include <cstddef>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "GrpcProtos/capture.pb.h"
 #include "GrpcProtos/tracepoint.pb.h"
+#include "InternPool.h"
 #include "OrbitBase/Logging.h"
 #include "ProducerEventProcessor/ClientCaptureEventCollector.h"
 
@@ -45,6 +48,7 @@ using orbit_grpc_protos::FullCallstackSample;
 using orbit_grpc_protos::FullGpuJob;
 using orbit_grpc_protos::FullTracepointEvent;
 using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::FunctionCallSummary;
 using orbit_grpc_protos::GpuDebugMarker;
 using orbit_grpc_protos::GpuJob;
 using orbit_grpc_protos::GpuQueueSubmission;
@@ -72,30 +76,80 @@ namespace orbit_producer_event_processor {
 
 namespace {
 
-template <typename T>
-class InternPool final {
+// A Callstack as looked up in the callstack InternPool, referencing the program counters in the
+// Callstack message, so that no copy of them is needed unless the callstack is new.
+struct CallstackView {
+  explicit CallstackView(const Callstack& callstack)
+      : pcs{callstack.pcs().data(), static_cast<size_t>(callstack.pcs_size())},
+        type{callstack.type()} {}
+  CallstackView(absl::Span<const uint64_t> pcs, Callstack::CallstackType type)
+      : pcs{pcs}, type{type} {}
+
+  absl::Span<const uint64_t> pcs;
+  Callstack::CallstackType type;
+};
+
+// A Callstack as stored in the callstack InternPool.
+struct CallstackKey {
+  explicit CallstackKey(const CallstackView& view)
+      : pcs{view.pcs.begin(), view.pcs.end()}, type{view.type} {}
+
+  std::vector<uint64_t> pcs;
+  Callstack::CallstackType type;
+};
+
+struct CallstackHash {
+  using is_transparent = void;
+  size_t operator()(const CallstackView& view) const { return absl::HashOf(view.pcs, view.type); }
+  size_t operator()(const CallstackKey& key) const {
+    return (*this)(CallstackView{key.pcs, key.type});
+  }
+};
+
+struct CallstackEq {
+  using is_transparent = void;
+  template <typename L, typename R>
+  bool operator()(const L& lhs, const R& rhs) const {
+    return Equal(CallstackView{lhs.pcs, lhs.type}, CallstackView{rhs.pcs, rhs.type});
+  }
+
+ private:
+  static bool Equal(const CallstackView& lhs, const CallstackView& rhs) {
+    return lhs.type == rhs.type && lhs.pcs == rhs.pcs;
+  }
+};
+
+// Where ProducerEventProcessorImpl puts the ClientCaptureEvents it creates: either directly into
+// the ClientCaptureEventCollector, one at a time, or into a ClientCaptureEventBatch. In the latter
+// case, the events are created on the Arena of the batch, which also owns the ProducerCaptureEvents
+// being processed, so that their sub-messages can be transferred without copies.
+class ClientCaptureEventOutput {
  public:
-  InternPool() = default;
-
-  // Return pair of <id, assigned>, where assigned is true if the entry was assigned a new id
-  // and false if returning id for already existing entry.
-  std::pair<uint64_t, bool> GetOrAssignId(const T& entry) {
-    absl::MutexLock lock(&entry_to_id_mutex_);
-    auto it = entry_to_id_.find(entry);
-    if (it != entry_to_id_.end()) {
-      return std::make_pair(it->second, false);
-    }
+  explicit ClientCaptureEventOutput(ClientCaptureEventCollector* collector)
+      : collector_{collector} {}
+  explicit ClientCaptureEventOutput(ClientCaptureEventBatch* batch) : batch_{batch} {}
+
+  // Returns a new empty event, which is to be passed to AddEvent before creating the next one.
+  [[nodiscard]] ClientCaptureEvent* CreateEvent() {
+    if (batch_ != nullptr) return batch_->AddEvent();
+    ORBIT_CHECK(!event_created_);
+    event_created_ = true;
+    return &event_;
+  }
 
-    uint64_t new_id = id_counter_++;
-    auto [unused_it, inserted] = entry_to_id_.insert_or_assign(entry, new_id);
-    ORBIT_CHECK(inserted);
-    return std::make_pair(new_id, true);
+  void AddEvent(ClientCaptureEvent* event) {
+    if (batch_ != nullptr) return;
+    ORBIT_CHECK(event_created_ && event == &event_);
+    collector_->AddEvent(std::move(event_));
+    event_.Clear();
+    event_created_ = false;
   }
 
  private:
-  uint64_t id_counter_ = 1;  // 0 is reserved for invalid_id
-  absl::flat_hash_map<T, uint64_t> entry_to_id_;
-  absl::Mutex entry_to_id_mutex_;
+  ClientCaptureEventCollector* collector_ = nullptr;
+  ClientCaptureEventBatch* batch_ = nullptr;
+  ClientCaptureEvent event_;
+  bool event_created_ = false;
 };
 
 class ProducerEventProcessorImpl : public ProducerEventProcessor {
@@ -105,70 +159,138 @@ class ProducerEventProcessorImpl : public ProducerEventProcessor {
       : client_capture_event_collector_{client_capture_event_collector} {}
 
   void ProcessEvent(uint64_t producer_id, ProducerCaptureEvent&& event) override;
+  void ProcessEvents(uint64_t producer_id, ProducerCaptureEventBatch&& batch) override;
 
  private:
+  void ProcessEvent(uint64_t producer_id, ProducerCaptureEvent* event,
+                    ClientCaptureEventOutput* output);
+
   // Please keep the declarations here and the definitions below of these Process... methods
   // alphabetically ordered as in the definition of the ProducerCaptureEvent message.
-  void ProcessApiScopeStartAndTransferOwnership(ApiScopeStart* api_scope_start);
-  void ProcessApiScopeStartAsyncAndTransferOwnership(ApiScopeStartAsync* api_scope_start_async);
-  void ProcessApiScopeStopAndTransferOwnership(ApiScopeStop* api_scope_stop);
-  void ProcessApiScopeStopAsyncAndTransferOwnership(ApiScopeStopAsync* api_scope_stop_async);
-  void ProcessApiStringEventAndTransferOwnership(ApiStringEvent* api_string_event);
-  void ProcessApiTrackDoubleAndTransferOwnership(ApiTrackDouble* api_track_double);
-  void ProcessApiTrackFloatAndTransferOwnership(ApiTrackFloat* api_track_float);
-  void ProcessApiTrackIntAndTransferOwnership(ApiTrackInt* api_track_int);
-  void ProcessApiTrackInt64AndTransferOwnership(ApiTrackInt64* api_track_int64);
-  void ProcessApiTrackUintAndTransferOwnership(ApiTrackUint* api_track_uint);
-  void ProcessApiTrackUint64AndTransferOwnership(ApiTrackUint64* api_track_uint64);
-  void ProcessCallstackSampleAndTransferOwnership(uint64_t producer_id,
-                                                  CallstackSample* callstack_sample);
-  void ProcessCaptureFinishedAndTransferOwnership(CaptureFinished* capture_finished);
-  void ProcessCaptureStartedAndTransferOwnership(CaptureStarted* capture_started);
-  void ProcessClockResolutionEventAndTransferOwnership(
-      ClockResolutionEvent* clock_resolution_event);
+  void ProcessApiScopeStartAndTransferOwnership(uint64_t producer_id,
+                                                ApiScopeStart* api_scope_start,
+                                                ClientCaptureEventOutput* output);
+  void ProcessApiScopeStartAsyncAndTransferOwnership(uint64_t producer_id,
+                                                     ApiScopeStartAsync* api_scope_start_async,
+                                                     ClientCaptureEventOutput* output);
+  void ProcessApiScopeStopAndTransferOwnership(ApiScopeStop* api_scope_stop,
+                                               ClientCaptureEventOutput* output);
+  void ProcessApiScopeStopAsyncAndTransferOwnership(ApiScopeStopAsync* api_scope_stop_async,
+                                                    ClientCaptureEventOutput* output);
+  void ProcessApiStringEventAndTransferOwnership(uint64_t producer_id,
+                                                 ApiStringEvent* api_string_event,
+                                                 ClientCaptureEventOutput* output);
+  void ProcessApiTrackDoubleAndTransferOwnership(uint64_t producer_id,
+                                                 ApiTrackDouble* api_track_double,
+                                                 ClientCaptureEventOutput* output);
+  void ProcessApiTrackFloatAndTransferOwnership(uint64_t producer_id,
+                                                ApiTrackFloat* api_track_float,
+                                                ClientCaptureEventOutput* output);
+  void ProcessApiTrackIntAndTransferOwnership(uint64_t producer_id, ApiTrackInt* api_track_int,
+                                              ClientCaptureEventOutput* output);
+  void ProcessApiTrackInt64AndTransferOwnership(uint64_t producer_id,
+                                                ApiTrackInt64* api_track_int64,
+                                                ClientCaptureEventOutput* output);
+  void ProcessApiTrackUintAndTransferOwnership(uint64_t producer_id, ApiTrackUint* api_track_uint,
+                                               ClientCaptureEventOutput* output);
+  void ProcessApiTrackUint64AndTransferOwnership(uint64_t producer_id,
+                                                 ApiTrackUint64* api_track_uint64,
+                                                 ClientCaptureEventOutput* output);
+  void ProcessCallstackSampleAndTransferOwnership(
+      uint64_t producer_id, CallstackSample* callstack_sample, ClientCaptureEventOutput* output);
+  void ProcessCaptureFinishedAndTransferOwnership(CaptureFinished* capture_finished,
+                                                  ClientCaptureEventOutput* output);
+  void ProcessCaptureStartedAndTransferOwnership(CaptureStarted* capture_started,
+                                                 ClientCaptureEventOutput* output);
+  void ProcessClockResolutionEventAndTransferOwnership(ClockResolutionEvent* clock_resolution_event,
+                                                       ClientCaptureEventOutput* output);
   void ProcessErrorEnablingOrbitApiEventAndTransferOwnership(
-      ErrorEnablingOrbitApiEvent* error_enabling_orbit_api_event);
+      ErrorEnablingOrbitApiEvent* error_enabling_orbit_api_event, ClientCaptureEventOutput* output);
   void ProcessErrorEnablingUserSpaceInstrumentationEventAndTransferOwnership(
-      ErrorEnablingUserSpaceInstrumentationEvent* error_event);
+      ErrorEnablingUserSpaceInstrumentationEvent* error_event, ClientCaptureEventOutput* output);
   void ProcessErrorsWithPerfEventOpenEventAndTransferOwnership(
-      ErrorsWithPerfEventOpenEvent* errors_with_perf_event_open_event);
-  void ProcessFullCallstackSample(FullCallstackSample* full_callstack_sample);
-  void ProcessFullAddressInfo(FullAddressInfo* full_address_info);
-  void ProcessFullGpuJob(FullGpuJob* full_gpu_job_event);
-  void ProcessFullTracepointEvent(FullTracepointEvent* full_tracepoint_event);
-  void ProcessFunctionCallAndTransferOwnership(FunctionCall* function_call);
+      ErrorsWithPerfEventOpenEvent* errors_with_perf_event_open_event,
+      ClientCaptureEventOutput* output);
+  void ProcessFullCallstackSample(FullCallstackSample* full_callstack_sample,
+                                  ClientCaptureEventOutput* output);
+  void ProcessFullAddressInfo(FullAddressInfo* full_address_info, ClientCaptureEventOutput* output);
+  void ProcessFullGpuJob(FullGpuJob* full_gpu_job_event, ClientCaptureEventOutput* output);
+  void ProcessFullTracepointEvent(FullTracepointEvent* full_tracepoint_event,
+                                  ClientCaptureEventOutput* output);
+  void ProcessFunctionCallAndTransferOwnership(FunctionCall* function_call,
+                                               ClientCaptureEventOutput* output);
+  void ProcessFunctionCallSummaryAndTransferOwnership(FunctionCallSummary* function_call_summary,
+                                                      ClientCaptureEventOutput* output);
   void ProcessGpuQueueSubmissionAndTransferOwnership(uint64_t producer_id,
-                                                     GpuQueueSubmission* gpu_queue_submission);
+                                                     GpuQueueSubmission* gpu_queue_submission,
+                                                     ClientCaptureEventOutput* output);
+  // Replaces the key of the interned name of a manual instrumentation event, if it has one, with
+  // the key used in the client.
+  template <typename ApiEvent>
+  void TranslateApiNameKey(uint64_t producer_id, ApiEvent* api_event,
+                           ClientCaptureEventOutput* output) {
+    if (api_event->name_key() == 0) return;
+    auto it = producer_interned_string_id_to_client_string_id_.find(
+        {producer_id, api_event->name_key()});
+    if (it == producer_interned_string_id_to_client_string_id_.end()) {
+      // This can only happen for an event that was produced right when a capture started, as the
+      // producer might not have noticed yet that it needs to send its names again. Such events can
+      // come in large numbers, so only log once.
+      ORBIT_ERROR_ONCE("Unknown key %u of the name of a manual instrumentation event",
+                       api_event->name_key());
+      api_event->set_name_key(GetOrSendUnknownNameKey(api_event->name_key(), output));
+      return;
+    }
+    api_event->set_name_key(it->second);
+  }
+  // Returns the client key of a placeholder name that identifies the unknown producer key. This is
+  // not recorded as the mapping of the producer key, as the actual name can still arrive later.
+  uint64_t GetOrSendUnknownNameKey(uint64_t producer_key, ClientCaptureEventOutput* output);
   // ProcessInterned* functions remap producer intern_ids to the id space used in the client.
   // They keep track of these mappings in producer_interned_callstack_id_to_client_callstack_id_
   // and producer_interned_string_id_to_client_string_id_.
-  void ProcessInternedCallstack(uint64_t producer_id, InternedCallstack* interned_callstack);
-  void ProcessInternedString(uint64_t producer_id, InternedString* interned_string);
+  void ProcessInternedCallstack(uint64_t producer_id, InternedCallstack* interned_callstack,
+                                ClientCaptureEventOutput* output);
+  void ProcessInternedString(uint64_t producer_id, InternedString* interned_string,
+                             ClientCaptureEventOutput* output);
   void ProcessLostPerfRecordsEventAndTransferOwnership(
-      LostPerfRecordsEvent* lost_perf_records_event);
-  void ProcessMemoryUsageEventAndTransferOwnership(MemoryUsageEvent* memory_usage_event);
-  void ProcessModulesSnapshotAndTransferOwnership(ModulesSnapshot* modules_snapshot);
-  void ProcessModuleUpdateEventAndTransferOwnership(ModuleUpdateEvent* module_update_event);
+      LostPerfRecordsEvent* lost_perf_records_event, ClientCaptureEventOutput* output);
+  void ProcessMemoryUsageEventAndTransferOwnership(MemoryUsageEvent* memory_usage_event,
+                                                   ClientCaptureEventOutput* output);
+  void ProcessModulesSnapshotAndTransferOwnership(ModulesSnapshot* modules_snapshot,
+                                                  ClientCaptureEventOutput* output);
+  void ProcessModuleUpdateEventAndTransferOwnership(ModuleUpdateEvent* module_update_event,
+                                                    ClientCaptureEventOutput* output);
   void ProcessOutOfOrderEventsDiscardedEventAndTransferOwnership(
-      OutOfOrderEventsDiscardedEvent* out_of_order_events_discarded_event);
-  void ProcessPresentEventAndTransferOwnership(PresentEvent* present_event);
-  void ProcessSchedulingSliceAndTransferOwnership(SchedulingSlice* scheduling_slice);
-  void ProcessThreadNameAndTransferOwnership(ThreadName* thread_name);
-  void ProcessThreadNamesSnapshotAndTransferOwnership(ThreadNamesSnapshot* thread_names_snapshot);
-  void ProcessThreadStateSliceAndTransferOwnership(ThreadStateSlice* thread_state_slice);
-  void ProcessThreadStateSliceCallstack(ThreadStateSliceCallstack* thread_state_slice_callstack);
-  void ProcessWarningEventAndTransferOwnership(WarningEvent* warning_event);
+      OutOfOrderEventsDiscardedEvent* out_of_order_events_discarded_event,
+      ClientCaptureEventOutput* output);
+  void ProcessPresentEventAndTransferOwnership(PresentEvent* present_event,
+                                               ClientCaptureEventOutput* output);
+  void ProcessSchedulingSliceAndTransferOwnership(SchedulingSlice* scheduling_slice,
+                                                  ClientCaptureEventOutput* output);
+  void ProcessThreadNameAndTransferOwnership(ThreadName* thread_name,
+                                             ClientCaptureEventOutput* output);
+  void ProcessThreadNamesSnapshotAndTransferOwnership(ThreadNamesSnapshot* thread_names_snapshot,
+                                                      ClientCaptureEventOutput* output);
+  void ProcessThreadStateSliceAndTransferOwnership(ThreadStateSlice* thread_state_slice,
+                                                   ClientCaptureEventOutput* output);
+  void ProcessThreadStateSliceCallstack(ThreadStateSliceCallstack* thread_state_slice_callstack,
+                                        ClientCaptureEventOutput* output);
+  void ProcessWarningEventAndTransferOwnership(WarningEvent* warning_event,
+                                               ClientCaptureEventOutput* output);
   void ProcessWarningInstrumentingWithUprobesEventAndTransferOwnership(
-      WarningInstrumentingWithUprobesEvent* warning_event);
+      WarningInstrumentingWithUprobesEvent* warning_event, ClientCaptureEventOutput* output);
   void ProcessWarningInstrumentingWithUserSpaceInstrumentationEventAndTransferOwnership(
-      WarningInstrumentingWithUserSpaceInstrumentationEvent* warning_event);
+      WarningInstrumentingWithUserSpaceInstrumentationEvent* warning_event,
+      ClientCaptureEventOutput* output);
 
-  void SendInternedStringEvent(uint64_t key, std::string value);
-  void MergeThreadStateSliceWithCallstackAndTransferOwnership(ThreadStateSlice* thread_state_slice);
+  void SendInternedStringEvent(uint64_t key, std::string value, ClientCaptureEventOutput* output);
+  void MergeThreadStateSliceWithCallstackAndTransferOwnership(ThreadStateSlice* thread_state_slice,
+                                                              ClientCaptureEventOutput* output);
 
   ClientCaptureEventCollector* client_capture_event_collector_;
 
-  InternPool<std::pair<std::vector<uint64_t>, Callstack::CallstackType>> callstack_pool_;
+  InternPool<CallstackKey, CallstackHash, CallstackEq> callstack_pool_;
   InternPool<std::string> string_pool_;
   InternPool<std::pair<std::string, std::string>> tracepoint_pool_;
 
@@ -192,7 +314,7 @@ class ProducerEventProcessorImpl : public ProducerEventProcessor {
 };
 
 void ProducerEventProcessorImpl::MergeThreadStateSliceWithCallstackAndTransferOwnership(
-    ThreadStateSlice* thread_state_slice) {
+    ThreadStateSlice* thread_state_slice, ClientCaptureEventOutput* output) {
   uint64_t begin_timestamp =
       thread_state_slice->end_timestamp_ns() - thread_state_slice->duration_ns();
   // Callstacks on thread state slices always origin from the tracepoint that corresponds to the
@@ -213,9 +335,9 @@ void ProducerEventProcessorImpl::MergeThreadStateSliceWithCallstackAndTransferOw
     ORBIT_ERROR("Missing callstack for thread state slice waiting for it");
     thread_state_slice->set_switch_out_or_wakeup_callstack_status(ThreadStateSlice::kNoCallstack);
     thread_state_slice->set_switch_out_or_wakeup_callstack_id(0);
-    ClientCaptureEvent event;
-    event.set_allocated_thread_state_slice(thread_state_slice);
-    client_capture_event_collector_->AddEvent(std::move(event));
+    ClientCaptureEvent* event = output->CreateEvent();
+    event->set_allocated_thread_state_slice(thread_state_slice);
+    output->AddEvent(event);
     return;
   }
 
@@ -226,90 +348,109 @@ void ProducerEventProcessorImpl::MergeThreadStateSliceWithCallstackAndTransferOw
   thread_state_slice_tid_and_begin_timestamp_to_callstack_id_.erase(
       thread_state_slice_callstack_it);
 
-  ClientCaptureEvent event;
-  event.set_allocated_thread_state_slice(thread_state_slice);
-  client_capture_event_collector_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_thread_state_slice(thread_state_slice);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessApiScopeStartAndTransferOwnership(
-    ApiScopeStart* api_scope_start) {
-  ClientCaptureEvent event;
-  event.set_allocated_api_scope_start(api_scope_start);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    uint64_t producer_id, ApiScopeStart* api_scope_start, ClientCaptureEventOutput* output) {
+  TranslateApiNameKey(producer_id, api_scope_start, output);
+
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_api_scope_start(api_scope_start);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessApiScopeStartAsyncAndTransferOwnership(
-    ApiScopeStartAsync* api_scope_start_async) {
-  ClientCaptureEvent event;
-  event.set_allocated_api_scope_start_async(api_scope_start_async);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    uint64_t producer_id, ApiScopeStartAsync* api_scope_start_async,
+    ClientCaptureEventOutput* output) {
+  TranslateApiNameKey(producer_id, api_scope_start_async, output);
+
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_api_scope_start_async(api_scope_start_async);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessApiScopeStopAndTransferOwnership(
-    ApiScopeStop* api_scope_stop) {
-  ClientCaptureEvent event;
-  event.set_allocated_api_scope_stop(api_scope_stop);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    ApiScopeStop* api_scope_stop, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_api_scope_stop(api_scope_stop);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessApiScopeStopAsyncAndTransferOwnership(
-    ApiScopeStopAsync* api_scope_stop_async) {
-  ClientCaptureEvent event;
-  event.set_allocated_api_scope_stop_async(api_scope_stop_async);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    ApiScopeStopAsync* api_scope_stop_async, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_api_scope_stop_async(api_scope_stop_async);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessApiStringEventAndTransferOwnership(
-    ApiStringEvent* api_string_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_api_string_event(api_string_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    uint64_t producer_id, ApiStringEvent* api_string_event, ClientCaptureEventOutput* output) {
+  TranslateApiNameKey(producer_id, api_string_event, output);
+
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_api_string_event(api_string_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessApiTrackDoubleAndTransferOwnership(
-    ApiTrackDouble* api_track_double) {
-  ClientCaptureEvent event;
-  event.set_allocated_api_track_double(api_track_double);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    uint64_t producer_id, ApiTrackDouble* api_track_double, ClientCaptureEventOutput* output) {
+  TranslateApiNameKey(producer_id, api_track_double, output);
+
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_api_track_double(api_track_double);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessApiTrackFloatAndTransferOwnership(
-    ApiTrackFloat* api_track_float) {
-  ClientCaptureEvent event;
-  event.set_allocated_api_track_float(api_track_float);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    uint64_t producer_id, ApiTrackFloat* api_track_float, ClientCaptureEventOutput* output) {
+  TranslateApiNameKey(producer_id, api_track_float, output);
+
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_api_track_float(api_track_float);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessApiTrackIntAndTransferOwnership(
-    ApiTrackInt* api_track_int) {
-  ClientCaptureEvent event;
-  event.set_allocated_api_track_int(api_track_int);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    uint64_t producer_id, ApiTrackInt* api_track_int, ClientCaptureEventOutput* output) {
+  TranslateApiNameKey(producer_id, api_track_int, output);
+
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_api_track_int(api_track_int);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessApiTrackInt64AndTransferOwnership(
-    ApiTrackInt64* api_track_int64) {
-  ClientCaptureEvent event;
-  event.set_allocated_api_track_int64(api_track_int64);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    uint64_t producer_id, ApiTrackInt64* api_track_int64, ClientCaptureEventOutput* output) {
+  TranslateApiNameKey(producer_id, api_track_int64, output);
+
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_api_track_int64(api_track_int64);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessApiTrackUintAndTransferOwnership(
-    ApiTrackUint* api_track_uint) {
-  ClientCaptureEvent event;
-  event.set_allocated_api_track_uint(api_track_uint);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    uint64_t producer_id, ApiTrackUint* api_track_uint, ClientCaptureEventOutput* output) {
+  TranslateApiNameKey(producer_id, api_track_uint, output);
+
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_api_track_uint(api_track_uint);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessApiTrackUint64AndTransferOwnership(
-    ApiTrackUint64* api_track_uint64) {
-  ClientCaptureEvent event;
-  event.set_allocated_api_track_uint64(api_track_uint64);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    uint64_t producer_id, ApiTrackUint64* api_track_uint64, ClientCaptureEventOutput* output) {
+  TranslateApiNameKey(producer_id, api_track_uint64, output);
+
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_api_track_uint64(api_track_uint64);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessCallstackSampleAndTransferOwnership(
-    uint64_t producer_id, CallstackSample* callstack_sample) {
+    uint64_t producer_id, CallstackSample* callstack_sample, ClientCaptureEventOutput* output) {
   // translate producer id to client id
   auto it = producer_interned_callstack_id_to_client_callstack_id_.find(
       {producer_id, callstack_sample->callstack_id()});
@@ -317,13 +458,13 @@ void ProducerEventProcessorImpl::ProcessCallstackSampleAndTransferOwnership(
   ORBIT_CHECK(it != producer_interned_callstack_id_to_client_callstack_id_.end());
   callstack_sample->set_callstack_id(it->second);
 
-  ClientCaptureEvent event;
-  event.set_allocated_callstack_sample(callstack_sample);
-  client_capture_event_collector_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_callstack_sample(callstack_sample);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessCaptureFinishedAndTransferOwnership(
-    CaptureFinished* capture_finished) {
+    CaptureFinished* capture_finished, ClientCaptureEventOutput* output) {
   if (!thread_state_slice_tid_and_begin_timestamp_to_callstack_id_.empty()) {
     // We don't expect this to happen because SwitchesNamesStateVisitor always produces a slice from
     // the remaining begin tracepoints at the end of the capture.
@@ -331,102 +472,103 @@ void ProducerEventProcessorImpl::ProcessCaptureFinishedAndTransferOwnership(
         "Some saved callstacks for thread state slices are left not merged to any slice after the "
         "capture finished.");
   }
-  ClientCaptureEvent event;
-  event.set_allocated_capture_finished(capture_finished);
-  client_capture_event_collector_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_capture_finished(capture_finished);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessCaptureStartedAndTransferOwnership(
-    CaptureStarted* capture_started) {
-  ClientCaptureEvent event;
-  event.set_allocated_capture_started(capture_started);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    CaptureStarted* capture_started, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_capture_started(capture_started);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessClockResolutionEventAndTransferOwnership(
-    ClockResolutionEvent* clock_resolution_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_clock_resolution_event(clock_resolution_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    ClockResolutionEvent* clock_resolution_event, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_clock_resolution_event(clock_resolution_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessErrorEnablingOrbitApiEventAndTransferOwnership(
-    ErrorEnablingOrbitApiEvent* error_enabling_orbit_api_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_error_enabling_orbit_api_event(error_enabling_orbit_api_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    ErrorEnablingOrbitApiEvent* error_enabling_orbit_api_event, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_error_enabling_orbit_api_event(error_enabling_orbit_api_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::
     ProcessErrorEnablingUserSpaceInstrumentationEventAndTransferOwnership(
-        ErrorEnablingUserSpaceInstrumentationEvent* error_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_error_enabling_user_space_instrumentation_event(error_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+        ErrorEnablingUserSpaceInstrumentationEvent* error_event, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_error_enabling_user_space_instrumentation_event(error_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessErrorsWithPerfEventOpenEventAndTransferOwnership(
-    ErrorsWithPerfEventOpenEvent* errors_with_perf_event_open_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_errors_with_perf_event_open_event(errors_with_perf_event_open_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    ErrorsWithPerfEventOpenEvent* errors_with_perf_event_open_event,
+    ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_errors_with_perf_event_open_event(errors_with_perf_event_open_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessFullCallstackSample(
-    FullCallstackSample* full_callstack_sample) {
+    FullCallstackSample* full_callstack_sample, ClientCaptureEventOutput* output) {
   const Callstack& callstack = full_callstack_sample->callstack();
-  std::pair<std::vector<uint64_t>, Callstack::CallstackType> callstack_data{
-      {callstack.pcs().begin(), callstack.pcs().end()}, callstack.type()};
-  auto [callstack_id, assigned] = callstack_pool_.GetOrAssignId(callstack_data);
+  auto [callstack_id, assigned] = callstack_pool_.GetOrAssignId(CallstackView{callstack});
 
   if (assigned) {
-    ClientCaptureEvent interned_callstack_event;
-    interned_callstack_event.mutable_interned_callstack()->set_key(callstack_id);
-    interned_callstack_event.mutable_interned_callstack()->set_allocated_intern(
-        full_callstack_sample->release_callstack());
-    client_capture_event_collector_->AddEvent(std::move(interned_callstack_event));
+    ClientCaptureEvent* interned_callstack_event = output->CreateEvent();
+    interned_callstack_event->mutable_interned_callstack()->set_key(callstack_id);
+    interned_callstack_event->mutable_interned_callstack()->set_allocated_intern(
+        full_callstack_sample->unsafe_arena_release_callstack());
+    output->AddEvent(interned_callstack_event);
   }
 
-  ClientCaptureEvent callstack_sample_event;
-  CallstackSample* callstack_sample = callstack_sample_event.mutable_callstack_sample();
+  ClientCaptureEvent* callstack_sample_event = output->CreateEvent();
+  CallstackSample* callstack_sample = callstack_sample_event->mutable_callstack_sample();
   callstack_sample->set_pid(full_callstack_sample->pid());
   callstack_sample->set_tid(full_callstack_sample->tid());
   callstack_sample->set_timestamp_ns(full_callstack_sample->timestamp_ns());
   callstack_sample->set_callstack_id(callstack_id);
-  client_capture_event_collector_->AddEvent(std::move(callstack_sample_event));
+  output->AddEvent(callstack_sample_event);
 }
 
-void ProducerEventProcessorImpl::ProcessFullAddressInfo(FullAddressInfo* full_address_info) {
+void ProducerEventProcessorImpl::ProcessFullAddressInfo(FullAddressInfo* full_address_info,
+                                                        ClientCaptureEventOutput* output) {
   auto [function_name_key, function_key_assigned] =
       string_pool_.GetOrAssignId(full_address_info->function_name());
   if (function_key_assigned) {
-    SendInternedStringEvent(function_name_key, full_address_info->function_name());
+    SendInternedStringEvent(function_name_key, full_address_info->function_name(), output);
   }
 
   auto [module_name_key, module_key_assigned] =
       string_pool_.GetOrAssignId(full_address_info->module_name());
   if (module_key_assigned) {
-    SendInternedStringEvent(module_name_key, full_address_info->module_name());
+    SendInternedStringEvent(module_name_key, full_address_info->module_name(), output);
   }
 
-  ClientCaptureEvent event;
-  AddressInfo* interned_address_info = event.mutable_address_info();
+  ClientCaptureEvent* event = output->CreateEvent();
+  AddressInfo* interned_address_info = event->mutable_address_info();
   interned_address_info->set_absolute_address(full_address_info->absolute_address());
   interned_address_info->set_offset_in_function(full_address_info->offset_in_function());
   interned_address_info->set_function_name_key(function_name_key);
   interned_address_info->set_module_name_key(module_name_key);
 
-  client_capture_event_collector_->AddEvent(std::move(event));
+  output->AddEvent(event);
 }
 
-void ProducerEventProcessorImpl::ProcessFullGpuJob(FullGpuJob* full_gpu_job_event) {
+void ProducerEventProcessorImpl::ProcessFullGpuJob(FullGpuJob* full_gpu_job_event,
+                                                   ClientCaptureEventOutput* output) {
   auto [timeline_key, assigned] = string_pool_.GetOrAssignId(full_gpu_job_event->timeline());
   if (assigned) {
-    SendInternedStringEvent(timeline_key, full_gpu_job_event->timeline());
+    SendInternedStringEvent(timeline_key, full_gpu_job_event->timeline(), output);
   }
 
-  ClientCaptureEvent event;
-  GpuJob* gpu_job_event = event.mutable_gpu_job();
+  ClientCaptureEvent* event = output->CreateEvent();
+  GpuJob* gpu_job_event = event->mutable_gpu_job();
   gpu_job_event->set_pid(full_gpu_job_event->pid());
   gpu_job_event->set_tid(full_gpu_job_event->tid());
   gpu_job_event->set_context(full_gpu_job_event->context());
@@ -438,42 +580,50 @@ void ProducerEventProcessorImpl::ProcessFullGpuJob(FullGpuJob* full_gpu_job_even
   gpu_job_event->set_gpu_hardware_start_time_ns(full_gpu_job_event->gpu_hardware_start_time_ns());
   gpu_job_event->set_dma_fence_signaled_time_ns(full_gpu_job_event->dma_fence_signaled_time_ns());
   gpu_job_event->set_timeline_key(timeline_key);
-  client_capture_event_collector_->AddEvent(std::move(event));
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessFullTracepointEvent(
-    FullTracepointEvent* full_tracepoint_event) {
+    FullTracepointEvent* full_tracepoint_event, ClientCaptureEventOutput* output) {
   auto [tracepoint_key, assigned] =
       tracepoint_pool_.GetOrAssignId({full_tracepoint_event->tracepoint_info().category(),
                                       full_tracepoint_event->tracepoint_info().name()});
   if (assigned) {
-    ClientCaptureEvent event;
-    InternedTracepointInfo* interned_tracepoint_info = event.mutable_interned_tracepoint_info();
+    ClientCaptureEvent* event = output->CreateEvent();
+    InternedTracepointInfo* interned_tracepoint_info = event->mutable_interned_tracepoint_info();
     interned_tracepoint_info->set_key(tracepoint_key);
     interned_tracepoint_info->set_allocated_intern(
-        full_tracepoint_event->release_tracepoint_info());
-    client_capture_event_collector_->AddEvent(std::move(event));
+        full_tracepoint_event->unsafe_arena_release_tracepoint_info());
+    output->AddEvent(event);
   }
 
-  ClientCaptureEvent event;
-  TracepointEvent* tracepoint_event = event.mutable_tracepoint_event();
+  ClientCaptureEvent* event = output->CreateEvent();
+  TracepointEvent* tracepoint_event = event->mutable_tracepoint_event();
   tracepoint_event->set_pid(full_tracepoint_event->pid());
   tracepoint_event->set_tid(full_tracepoint_event->tid());
   tracepoint_event->set_timestamp_ns(full_tracepoint_event->timestamp_ns());
   tracepoint_event->set_cpu(full_tracepoint_event->cpu());
   tracepoint_event->set_tracepoint_info_key(tracepoint_key);
-  client_capture_event_collector_->AddEvent(std::move(event));
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessFunctionCallAndTransferOwnership(
-    FunctionCall* function_call) {
-  ClientCaptureEvent event;
-  event.set_allocated_function_call(function_call);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    FunctionCall* function_call, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_function_call(function_call);
+  output->AddEvent(event);
+}
+
+void ProducerEventProcessorImpl::ProcessFunctionCallSummaryAndTransferOwnership(
+    FunctionCallSummary* function_call_summary, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_function_call_summary(function_call_summary);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessGpuQueueSubmissionAndTransferOwnership(
-    uint64_t producer_id, GpuQueueSubmission* gpu_queue_submission) {
+    uint64_t producer_id, GpuQueueSubmission* gpu_queue_submission,
+    ClientCaptureEventOutput* output) {
   // Translate debug marker keys
   for (GpuDebugMarker& mutable_marker : *gpu_queue_submission->mutable_completed_markers()) {
     auto it = producer_interned_string_id_to_client_string_id_.find(
@@ -482,21 +632,19 @@ void ProducerEventProcessorImpl::ProcessGpuQueueSubmissionAndTransferOwnership(
     mutable_marker.set_text_key(it->second);
   }
 
-  ClientCaptureEvent event;
-  event.set_allocated_gpu_queue_submission(gpu_queue_submission);
-  client_capture_event_collector_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_gpu_queue_submission(gpu_queue_submission);
+  output->AddEvent(event);
 }
 
-void ProducerEventProcessorImpl::ProcessInternedCallstack(uint64_t producer_id,
-                                                          InternedCallstack* interned_callstack) {
+void ProducerEventProcessorImpl::ProcessInternedCallstack(
+    uint64_t producer_id, InternedCallstack* interned_callstack, ClientCaptureEventOutput* output) {
   // TODO(b/180235290): replace with error message
   ORBIT_CHECK(!producer_interned_callstack_id_to_client_callstack_id_.contains(
       {producer_id, interned_callstack->key()}));
 
-  std::pair<std::vector<uint64_t>, Callstack::CallstackType> callstack_data{
-      {interned_callstack->intern().pcs().begin(), interned_callstack->intern().pcs().end()},
-      interned_callstack->intern().type()};
-  auto [interned_callstack_id, assigned] = callstack_pool_.GetOrAssignId(callstack_data);
+  auto [interned_callstack_id, assigned] =
+      callstack_pool_.GetOrAssignId(CallstackView{interned_callstack->intern()});
 
   producer_interned_callstack_id_to_client_callstack_id_.insert_or_assign(
       {producer_id, interned_callstack->key()}, interned_callstack_id);
@@ -507,13 +655,13 @@ void ProducerEventProcessorImpl::ProcessInternedCallstack(uint64_t producer_id,
 
   // If this is first time we see it -> send it over with client_id
   interned_callstack->set_key(interned_callstack_id);
-  ClientCaptureEvent event;
-  *event.mutable_interned_callstack() = std::move(*interned_callstack);
-  client_capture_event_collector_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = output->CreateEvent();
+  *event->mutable_interned_callstack() = std::move(*interned_callstack);
+  output->AddEvent(event);
 }
 
-void ProducerEventProcessorImpl::ProcessInternedString(uint64_t producer_id,
-                                                       InternedString* interned_string) {
+void ProducerEventProcessorImpl::ProcessInternedString(
+    uint64_t producer_id, InternedString* interned_string, ClientCaptureEventOutput* output) {
   // TODO(b/180235290): replace with error message
   ORBIT_CHECK(!producer_interned_string_id_to_client_string_id_.contains(
       {producer_id, interned_string->key()}));
@@ -528,115 +676,129 @@ void ProducerEventProcessorImpl::ProcessInternedString(uint64_t producer_id,
 
   interned_string->set_key(client_string_id);
 
-  ClientCaptureEvent event;
-  *event.mutable_interned_string() = std::move(*interned_string);
-  client_capture_event_collector_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = output->CreateEvent();
+  *event->mutable_interned_string() = std::move(*interned_string);
+  output->AddEvent(event);
+}
+
+uint64_t ProducerEventProcessorImpl::GetOrSendUnknownNameKey(uint64_t producer_key,
+                                                             ClientCaptureEventOutput* output) {
+  std::string name = absl::StrFormat("<unknown name %u>", producer_key);
+  auto [client_string_id, assigned] = string_pool_.GetOrAssignId(name);
+  if (assigned) {
+    ClientCaptureEvent* event = output->CreateEvent();
+    InternedString* interned_string = event->mutable_interned_string();
+    interned_string->set_key(client_string_id);
+    interned_string->set_intern(std::move(name));
+    output->AddEvent(event);
+  }
+  return client_string_id;
 }
 
 void ProducerEventProcessorImpl::ProcessLostPerfRecordsEventAndTransferOwnership(
-    LostPerfRecordsEvent* lost_perf_records_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_lost_perf_records_event(lost_perf_records_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    LostPerfRecordsEvent* lost_perf_records_event, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_lost_perf_records_event(lost_perf_records_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessMemoryUsageEventAndTransferOwnership(
-    MemoryUsageEvent* memory_usage_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_memory_usage_event(memory_usage_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    MemoryUsageEvent* memory_usage_event, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_memory_usage_event(memory_usage_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessModulesSnapshotAndTransferOwnership(
-    ModulesSnapshot* modules_snapshot) {
-  ClientCaptureEvent event;
-  event.set_allocated_modules_snapshot(modules_snapshot);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    ModulesSnapshot* modules_snapshot, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_modules_snapshot(modules_snapshot);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessModuleUpdateEventAndTransferOwnership(
-    orbit_grpc_protos::ModuleUpdateEvent* module_update_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_module_update_event(module_update_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    orbit_grpc_protos::ModuleUpdateEvent* module_update_event, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_module_update_event(module_update_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessOutOfOrderEventsDiscardedEventAndTransferOwnership(
-    OutOfOrderEventsDiscardedEvent* out_of_order_events_discarded_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_out_of_order_events_discarded_event(out_of_order_events_discarded_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    OutOfOrderEventsDiscardedEvent* out_of_order_events_discarded_event,
+    ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_out_of_order_events_discarded_event(out_of_order_events_discarded_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessPresentEventAndTransferOwnership(
-    PresentEvent* present_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_present_event(present_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    PresentEvent* present_event, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_present_event(present_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessSchedulingSliceAndTransferOwnership(
-    SchedulingSlice* scheduling_slice) {
-  ClientCaptureEvent event;
-  event.set_allocated_scheduling_slice(scheduling_slice);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    SchedulingSlice* scheduling_slice, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_scheduling_slice(scheduling_slice);
+  output->AddEvent(event);
 }
 
-void ProducerEventProcessorImpl::ProcessThreadNameAndTransferOwnership(ThreadName* thread_name) {
-  ClientCaptureEvent event;
-  event.set_allocated_thread_name(thread_name);
-  client_capture_event_collector_->AddEvent(std::move(event));
+void ProducerEventProcessorImpl::ProcessThreadNameAndTransferOwnership(
+    ThreadName* thread_name, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_thread_name(thread_name);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessThreadNamesSnapshotAndTransferOwnership(
-    ThreadNamesSnapshot* thread_names_snapshot) {
-  ClientCaptureEvent event;
-  event.set_allocated_thread_names_snapshot(thread_names_snapshot);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    ThreadNamesSnapshot* thread_names_snapshot, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_thread_names_snapshot(thread_names_snapshot);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessThreadStateSliceAndTransferOwnership(
-    ThreadStateSlice* thread_state_slice) {
+    ThreadStateSlice* thread_state_slice, ClientCaptureEventOutput* output) {
   ORBIT_CHECK(thread_state_slice->switch_out_or_wakeup_callstack_status() !=
               ThreadStateSlice::kCallstackSet);
   if (thread_state_slice->switch_out_or_wakeup_callstack_status() ==
       ThreadStateSlice::kNoCallstack) {
-    ClientCaptureEvent event;
-    event.set_allocated_thread_state_slice(thread_state_slice);
-    client_capture_event_collector_->AddEvent(std::move(event));
+    ClientCaptureEvent* event = output->CreateEvent();
+    event->set_allocated_thread_state_slice(thread_state_slice);
+    output->AddEvent(event);
     return;
   }
-  MergeThreadStateSliceWithCallstackAndTransferOwnership(thread_state_slice);
+  MergeThreadStateSliceWithCallstackAndTransferOwnership(thread_state_slice, output);
 }
 
 void ProducerEventProcessorImpl::ProcessWarningEventAndTransferOwnership(
-    WarningEvent* warning_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_warning_event(warning_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    WarningEvent* warning_event, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_warning_event(warning_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessWarningInstrumentingWithUprobesEventAndTransferOwnership(
-    WarningInstrumentingWithUprobesEvent* warning_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_warning_instrumenting_with_uprobes_event(warning_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+    WarningInstrumentingWithUprobesEvent* warning_event, ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_warning_instrumenting_with_uprobes_event(warning_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessThreadStateSliceCallstack(
-    ThreadStateSliceCallstack* thread_state_slice_callstack) {
+    ThreadStateSliceCallstack* thread_state_slice_callstack, ClientCaptureEventOutput* output) {
   const Callstack& callstack = thread_state_slice_callstack->callstack();
 
-  std::pair<std::vector<uint64_t>, Callstack::CallstackType> callstack_data{
-      {callstack.pcs().begin(), callstack.pcs().end()}, callstack.type()};
-  auto [callstack_id, assigned] = callstack_pool_.GetOrAssignId(callstack_data);
+  auto [callstack_id, assigned] = callstack_pool_.GetOrAssignId(CallstackView{callstack});
 
   if (assigned) {
-    ClientCaptureEvent interned_callstack_event;
-    interned_callstack_event.mutable_interned_callstack()->set_key(callstack_id);
-    interned_callstack_event.mutable_interned_callstack()->set_allocated_intern(
-        thread_state_slice_callstack->release_callstack());
-    client_capture_event_collector_->AddEvent(std::move(interned_callstack_event));
+    ClientCaptureEvent* interned_callstack_event = output->CreateEvent();
+    interned_callstack_event->mutable_interned_callstack()->set_key(callstack_id);
+    interned_callstack_event->mutable_interned_callstack()->set_allocated_intern(
+        thread_state_slice_callstack->unsafe_arena_release_callstack());
+    output->AddEvent(interned_callstack_event);
   }
 
   // We are sending the callstack right away (if necessary) and only keep the callstack id to attach
@@ -648,158 +810,212 @@ void ProducerEventProcessorImpl::ProcessThreadStateSliceCallstack(
 
 void ProducerEventProcessorImpl::
     ProcessWarningInstrumentingWithUserSpaceInstrumentationEventAndTransferOwnership(
-        WarningInstrumentingWithUserSpaceInstrumentationEvent* warning_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_warning_instrumenting_with_user_space_instrumentation_event(warning_event);
-  client_capture_event_collector_->AddEvent(std::move(event));
+        WarningInstrumentingWithUserSpaceInstrumentationEvent* warning_event,
+        ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  event->set_allocated_warning_instrumenting_with_user_space_instrumentation_event(warning_event);
+  output->AddEvent(event);
 }
 
 void ProducerEventProcessorImpl::ProcessEvent(uint64_t producer_id, ProducerCaptureEvent&& event) {
+  ClientCaptureEventOutput output{client_capture_event_collector_};
+  ProcessEvent(producer_id, &event, &output);
+}
+
+void ProducerEventProcessorImpl::ProcessEvents(uint64_t producer_id,
+                                               ProducerCaptureEventBatch&& batch) {
+  // Create the ClientCaptureEvents on the Arena of the ProducerCaptureEvents, so that the
+  // sub-messages can be moved from the latter to the former without copies.
+  const std::vector<ProducerCaptureEvent*> events = batch.events();
+  ClientCaptureEventBatch client_capture_event_batch{batch.ReleaseArena()};
+  ClientCaptureEventOutput output{&client_capture_event_batch};
+  for (ProducerCaptureEvent* event : events) {
+    ProcessEvent(producer_id, event, &output);
+  }
+  if (!client_capture_event_batch.empty()) {
+    client_capture_event_collector_->AddEvents(std::move(client_capture_event_batch));
+  }
+}
+
+void ProducerEventProcessorImpl::ProcessEvent(uint64_t producer_id, ProducerCaptureEvent* event,
+                                              ClientCaptureEventOutput* output) {
+  // The sub-messages are released with unsafe_arena_release_*, which doesn't copy them if event is
+  // on an Arena. This is safe as the set_allocated_* methods of ClientCaptureEvent used below still
+  // copy a sub-message that is on a different Arena than the ClientCaptureEvent, or on an Arena
+  // while the ClientCaptureEvent is not.
   // Please keep the cases alphabetically ordered, as in the definition of the ProducerCaptureEvent
   // message.
-  switch (event.event_case()) {
+  switch (event->event_case()) {
     case ProducerCaptureEvent::kApiScopeStart:
-      ProcessApiScopeStartAndTransferOwnership(event.release_api_scope_start());
+      ProcessApiScopeStartAndTransferOwnership(
+          producer_id, event->unsafe_arena_release_api_scope_start(), output);
       break;
     case ProducerCaptureEvent::kApiScopeStartAsync:
-      ProcessApiScopeStartAsyncAndTransferOwnership(event.release_api_scope_start_async());
+      ProcessApiScopeStartAsyncAndTransferOwnership(
+          producer_id, event->unsafe_arena_release_api_scope_start_async(), output);
       break;
     case ProducerCaptureEvent::kApiScopeStop:
-      ProcessApiScopeStopAndTransferOwnership(event.release_api_scope_stop());
+      ProcessApiScopeStopAndTransferOwnership(event->unsafe_arena_release_api_scope_stop(), output);
       break;
     case ProducerCaptureEvent::kApiScopeStopAsync:
-      ProcessApiScopeStopAsyncAndTransferOwnership(event.release_api_scope_stop_async());
+      ProcessApiScopeStopAsyncAndTransferOwnership(
+          event->unsafe_arena_release_api_scope_stop_async(), output);
       break;
     case ProducerCaptureEvent::kApiStringEvent:
-      ProcessApiStringEventAndTransferOwnership(event.release_api_string_event());
+      ProcessApiStringEventAndTransferOwnership(
+          producer_id, event->unsafe_arena_release_api_string_event(), output);
       break;
     case ProducerCaptureEvent::kApiTrackDouble:
-      ProcessApiTrackDoubleAndTransferOwnership(event.release_api_track_double());
+      ProcessApiTrackDoubleAndTransferOwnership(
+          producer_id, event->unsafe_arena_release_api_track_double(), output);
       break;
     case ProducerCaptureEvent::kApiTrackFloat:
-      ProcessApiTrackFloatAndTransferOwnership(event.release_api_track_float());
+      ProcessApiTrackFloatAndTransferOwnership(
+          producer_id, event->unsafe_arena_release_api_track_float(), output);
       break;
     case ProducerCaptureEvent::kApiTrackInt:
-      ProcessApiTrackIntAndTransferOwnership(event.release_api_track_int());
+      ProcessApiTrackIntAndTransferOwnership(
+          producer_id, event->unsafe_arena_release_api_track_int(), output);
       break;
     case ProducerCaptureEvent::kApiTrackInt64:
-      ProcessApiTrackInt64AndTransferOwnership(event.release_api_track_int64());
+      ProcessApiTrackInt64AndTransferOwnership(
+          producer_id, event->unsafe_arena_release_api_track_int64(), output);
       break;
     case ProducerCaptureEvent::kApiTrackUint:
-      ProcessApiTrackUintAndTransferOwnership(event.release_api_track_uint());
+      ProcessApiTrackUintAndTransferOwnership(
+          producer_id, event->unsafe_arena_release_api_track_uint(), output);
       break;
     case ProducerCaptureEvent::kApiTrackUint64:
-      ProcessApiTrackUint64AndTransferOwnership(event.release_api_track_uint64());
+      ProcessApiTrackUint64AndTransferOwnership(
+          producer_id, event->unsafe_arena_release_api_track_uint64(), output);
       break;
     case ProducerCaptureEvent::kCallstackSample:
-      ProcessCallstackSampleAndTransferOwnership(producer_id, event.release_callstack_sample());
+      ProcessCallstackSampleAndTransferOwnership(producer_id,
+                                                 event->unsafe_arena_release_callstack_sample(),
+                                                 output);
       break;
     case ProducerCaptureEvent::kCaptureFinished:
-      ProcessCaptureFinishedAndTransferOwnership(event.release_capture_finished());
+      ProcessCaptureFinishedAndTransferOwnership(event->unsafe_arena_release_capture_finished(),
+                                                 output);
       break;
     case ProducerCaptureEvent::kCaptureStarted:
-      ProcessCaptureStartedAndTransferOwnership(event.release_capture_started());
+      ProcessCaptureStartedAndTransferOwnership(event->unsafe_arena_release_capture_started(),
+                                                output);
       break;
     case ProducerCaptureEvent::kClockResolutionEvent:
-      ProcessClockResolutionEventAndTransferOwnership(event.release_clock_resolution_event());
+      ProcessClockResolutionEventAndTransferOwnership(
+          event->unsafe_arena_release_clock_resolution_event(), output);
       break;
     case ProducerCaptureEvent::kErrorEnablingOrbitApiEvent:
       ProcessErrorEnablingOrbitApiEventAndTransferOwnership(
-          event.release_error_enabling_orbit_api_event());
+          event->unsafe_arena_release_error_enabling_orbit_api_event(), output);
       break;
     case ProducerCaptureEvent::kErrorEnablingUserSpaceInstrumentationEvent:
       ProcessErrorEnablingUserSpaceInstrumentationEventAndTransferOwnership(
-          event.release_error_enabling_user_space_instrumentation_event());
+          event->unsafe_arena_release_error_enabling_user_space_instrumentation_event(), output);
       break;
     case ProducerCaptureEvent::kErrorsWithPerfEventOpenEvent:
       ProcessErrorsWithPerfEventOpenEventAndTransferOwnership(
-          event.release_errors_with_perf_event_open_event());
+          event->unsafe_arena_release_errors_with_perf_event_open_event(), output);
       break;
     case ProducerCaptureEvent::kFullCallstackSample:
-      ProcessFullCallstackSample(event.mutable_full_callstack_sample());
+      ProcessFullCallstackSample(event->mutable_full_callstack_sample(), output);
       break;
     case ProducerCaptureEvent::kFullAddressInfo:
-      ProcessFullAddressInfo(event.mutable_full_address_info());
+      ProcessFullAddressInfo(event->mutable_full_address_info(), output);
       break;
     case ProducerCaptureEvent::kFullGpuJob:
-      ProcessFullGpuJob(event.mutable_full_gpu_job());
+      ProcessFullGpuJob(event->mutable_full_gpu_job(), output);
       break;
     case ProducerCaptureEvent::kFullTracepointEvent:
-      ProcessFullTracepointEvent(event.mutable_full_tracepoint_event());
+      ProcessFullTracepointEvent(event->mutable_full_tracepoint_event(), output);
       break;
     case ProducerCaptureEvent::kFunctionCall:
-      ProcessFunctionCallAndTransferOwnership(event.release_function_call());
+      ProcessFunctionCallAndTransferOwnership(event->unsafe_arena_release_function_call(), output);
+      break;
+    case ProducerCaptureEvent::kFunctionCallSummary:
+      ProcessFunctionCallSummaryAndTransferOwnership(
+          event->unsafe_arena_release_function_call_summary(), output);
       break;
     case ProducerCaptureEvent::kFunctionEntry:
       ORBIT_UNREACHABLE();
     case ProducerCaptureEvent::kFunctionExit:
       ORBIT_UNREACHABLE();
     case ProducerCaptureEvent::kGpuQueueSubmission:
-      ProcessGpuQueueSubmissionAndTransferOwnership(producer_id,
-                                                    event.release_gpu_queue_submission());
+      ProcessGpuQueueSubmissionAndTransferOwnership(
+          producer_id, event->unsafe_arena_release_gpu_queue_submission(), output);
       break;
     case ProducerCaptureEvent::kInternedCallstack:
-      ProcessInternedCallstack(producer_id, event.mutable_interned_callstack());
+      ProcessInternedCallstack(producer_id, event->mutable_interned_callstack(), output);
       break;
     case ProducerCaptureEvent::kInternedString:
-      ProcessInternedString(producer_id, event.mutable_interned_string());
+      ProcessInternedString(producer_id, event->mutable_interned_string(), output);
       break;
     case ProducerCaptureEvent::kLostPerfRecordsEvent:
-      ProcessLostPerfRecordsEventAndTransferOwnership(event.release_lost_perf_records_event());
+      ProcessLostPerfRecordsEventAndTransferOwnership(
+          event->unsafe_arena_release_lost_perf_records_event(), output);
       break;
     case ProducerCaptureEvent::kMemoryUsageEvent:
-      ProcessMemoryUsageEventAndTransferOwnership(event.release_memory_usage_event());
+      ProcessMemoryUsageEventAndTransferOwnership(event->unsafe_arena_release_memory_usage_event(),
+                                                  output);
       break;
     case ProducerCaptureEvent::kModulesSnapshot:
-      ProcessModulesSnapshotAndTransferOwnership(event.release_modules_snapshot());
+      ProcessModulesSnapshotAndTransferOwnership(event->unsafe_arena_release_modules_snapshot(),
+                                                 output);
       break;
     case ProducerCaptureEvent::kModuleUpdateEvent:
-      ProcessModuleUpdateEventAndTransferOwnership(event.release_module_update_event());
+      ProcessModuleUpdateEventAndTransferOwnership(
+          event->unsafe_arena_release_module_update_event(), output);
       break;
     case ProducerCaptureEvent::kOutOfOrderEventsDiscardedEvent:
       ProcessOutOfOrderEventsDiscardedEventAndTransferOwnership(
-          event.release_out_of_order_events_discarded_event());
+          event->unsafe_arena_release_out_of_order_events_discarded_event(), output);
       break;
     case ProducerCaptureEvent::kPresentEvent:
-      ProcessPresentEventAndTransferOwnership(event.release_present_event());
+      ProcessPresentEventAndTransferOwnership(event->unsafe_arena_release_present_event(), output);
       break;
     case ProducerCaptureEvent::kSchedulingSlice:
-      ProcessSchedulingSliceAndTransferOwnership(event.release_scheduling_slice());
+      ProcessSchedulingSliceAndTransferOwnership(event->unsafe_arena_release_scheduling_slice(),
+                                                 output);
       break;
     case ProducerCaptureEvent::kThreadName:
-      ProcessThreadNameAndTransferOwnership(event.release_thread_name());
+      ProcessThreadNameAndTransferOwnership(event->unsafe_arena_release_thread_name(), output);
       break;
     case ProducerCaptureEvent::kThreadNamesSnapshot:
-      ProcessThreadNamesSnapshotAndTransferOwnership(event.release_thread_names_snapshot());
+      ProcessThreadNamesSnapshotAndTransferOwnership(
+          event->unsafe_arena_release_thread_names_snapshot(), output);
       break;
     case ProducerCaptureEvent::kThreadStateSlice:
-      ProcessThreadStateSliceAndTransferOwnership(event.release_thread_state_slice());
+      ProcessThreadStateSliceAndTransferOwnership(event->unsafe_arena_release_thread_state_slice(),
+                                                  output);
       break;
     case ProducerCaptureEvent::kThreadStateSliceCallstack:
-      ProcessThreadStateSliceCallstack(event.mutable_thread_state_slice_callstack());
+      ProcessThreadStateSliceCallstack(event->mutable_thread_state_slice_callstack(), output);
       break;
     case ProducerCaptureEvent::kWarningEvent:
-      ProcessWarningEventAndTransferOwnership(event.release_warning_event());
+      ProcessWarningEventAndTransferOwnership(event->unsafe_arena_release_warning_event(), output);
       break;
     case ProducerCaptureEvent::kWarningInstrumentingWithUprobesEvent:
       ProcessWarningInstrumentingWithUprobesEventAndTransferOwnership(
-          event.release_warning_instrumenting_with_uprobes_event());
+          event->unsafe_arena_release_warning_instrumenting_with_uprobes_event(), output);
       break;
     case ProducerCaptureEvent::kWarningInstrumentingWithUserSpaceInstrumentationEvent:
       ProcessWarningInstrumentingWithUserSpaceInstrumentationEventAndTransferOwnership(
-          event.release_warning_instrumenting_with_user_space_instrumentation_event());
+          event->unsafe_arena_release_warning_instrumenting_with_user_space_instrumentation_event(),
+          output);
       break;
     case ProducerCaptureEvent::EVENT_NOT_SET:
       ORBIT_UNREACHABLE();
   }
 }
 
-void ProducerEventProcessorImpl::SendInternedStringEvent(uint64_t key, std::string value) {
-  ClientCaptureEvent event;
-  InternedString* interned_string = event.mutable_interned_string();
+void ProducerEventProcessorImpl::SendInternedStringEvent(uint64_t key, std::string value,
+                                                         ClientCaptureEventOutput* output) {
+  ClientCaptureEvent* event = output->CreateEvent();
+  InternedString* interned_string = event->mutable_interned_string();
   interned_string->set_key(key);
   interned_string->set_intern(std::move(value));
-  client_capture_event_collector_->AddEvent(std::move(event));
+  output->AddEvent(event);
 }
 
 }  // namespace
@@ -19,6 +19,7 @@
 #include "GrpcProtos/capture.pb.h"
 #include "GrpcProtos/module.pb.h"
 #include "GrpcProtos/tracepoint.pb.h"
+#include "ProducerEventProcessor/CaptureEventBatch.h"
 #include "ProducerEventProcessor/ClientCaptureEventCollector.h"
 #include "ProducerEventProcessor/ProducerEventProcessor.h"
 
@@ -50,6 +51,7 @@ using orbit_grpc_protos::FullCallstackSample;
 using orbit_grpc_protos::FullGpuJob;
 using orbit_grpc_protos::FullTracepointEvent;
 using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::FunctionCallSummary;
 using orbit_grpc_protos::GpuCommandBuffer;
 using orbit_grpc_protos::GpuDebugMarker;
 using orbit_grpc_protos::GpuJob;
@@ -91,6 +93,7 @@ namespace {
 class MockClientCaptureEventCollector : public ClientCaptureEventCollector {
  public:
   MOCK_METHOD(void, AddEvent, (orbit_grpc_protos::ClientCaptureEvent && /*event*/), (override));
+  MOCK_METHOD(void, AddEvents, (ClientCaptureEventBatch && /*batch*/), (override));
   MOCK_METHOD(void, StopAndWait, (), (override));
 };
 
@@ -627,6 +630,139 @@ TEST(ProducerEventProcessor, FullCallstackSampleDifferentCallstacks) {
   EXPECT_EQ(callstack_sample2.callstack_id(), interned_callstack2.key());
 }
 
+TEST(ProducerEventProcessor, ProcessEventsMovesEventsToClientCaptureEventBatch) {
+  MockClientCaptureEventCollector collector;
+  auto producer_event_processor = ProducerEventProcessor::Create(&collector);
+
+  ProducerCaptureEventBatch batch;
+  SchedulingSlice* scheduling_slice = batch.AddEvent()->mutable_scheduling_slice();
+  scheduling_slice->set_pid(kPid1);
+  scheduling_slice->set_tid(kTid1);
+  scheduling_slice->set_core(kCore1);
+  scheduling_slice->set_duration_ns(kDurationNs1);
+  scheduling_slice->set_out_timestamp_ns(kTimestampNs1);
+
+  FullCallstackSample* full_callstack_sample1 = batch.AddEvent()->mutable_full_callstack_sample();
+  full_callstack_sample1->set_pid(kPid1);
+  full_callstack_sample1->set_tid(kTid1);
+  full_callstack_sample1->set_timestamp_ns(kTimestampNs1);
+  Callstack* callstack1 = full_callstack_sample1->mutable_callstack();
+  callstack1->add_pcs(1);
+  callstack1->add_pcs(2);
+  callstack1->set_type(Callstack::kComplete);
+
+  FullCallstackSample* full_callstack_sample2 = batch.AddEvent()->mutable_full_callstack_sample();
+  full_callstack_sample2->set_pid(kPid2);
+  full_callstack_sample2->set_tid(kTid2);
+  full_callstack_sample2->set_timestamp_ns(kTimestampNs2);
+  *full_callstack_sample2->mutable_callstack() = *callstack1;
+
+  const google::protobuf::Arena* arena = batch.arena();
+  ClientCaptureEventBatch client_capture_event_batch;
+  EXPECT_CALL(collector, AddEvent).Times(0);
+  EXPECT_CALL(collector, AddEvents)
+      .Times(1)
+      .WillOnce(Invoke([&client_capture_event_batch](ClientCaptureEventBatch&& batch) {
+        client_capture_event_batch = std::move(batch);
+      }));
+
+  producer_event_processor->ProcessEvents(kDefaultProducerId, std::move(batch));
+
+  // The ClientCaptureEvents are on the Arena of the ProducerCaptureEvents and, in particular, the
+  // interned Callstack is the one of the first FullCallstackSample, not a copy.
+  EXPECT_EQ(client_capture_event_batch.arena(), arena);
+  const std::vector<ClientCaptureEvent*>& events = client_capture_event_batch.events();
+  ASSERT_EQ(events.size(), 4);
+  for (const ClientCaptureEvent* event : events) {
+    EXPECT_EQ(event->GetArena(), arena);
+  }
+
+  ASSERT_EQ(events[0]->event_case(), ClientCaptureEvent::kSchedulingSlice);
+  EXPECT_EQ(events[0]->scheduling_slice().pid(), kPid1);
+  EXPECT_EQ(events[0]->scheduling_slice().tid(), kTid1);
+  EXPECT_EQ(events[0]->scheduling_slice().core(), kCore1);
+  EXPECT_EQ(events[0]->scheduling_slice().duration_ns(), kDurationNs1);
+  EXPECT_EQ(events[0]->scheduling_slice().out_timestamp_ns(), kTimestampNs1);
+
+  ASSERT_EQ(events[1]->event_case(), ClientCaptureEvent::kInternedCallstack);
+  const InternedCallstack& interned_callstack = events[1]->interned_callstack();
+  EXPECT_NE(interned_callstack.key(), orbit_grpc_protos::kInvalidInternId);
+  EXPECT_EQ(&interned_callstack.intern(), callstack1);
+  EXPECT_THAT(interned_callstack.intern().pcs(), ElementsAre(1, 2));
+  EXPECT_EQ(interned_callstack.intern().type(), Callstack::kComplete);
+
+  ASSERT_EQ(events[2]->event_case(), ClientCaptureEvent::kCallstackSample);
+  EXPECT_EQ(events[2]->callstack_sample().pid(), kPid1);
+  EXPECT_EQ(events[2]->callstack_sample().tid(), kTid1);
+  EXPECT_EQ(events[2]->callstack_sample().timestamp_ns(), kTimestampNs1);
+  EXPECT_EQ(events[2]->callstack_sample().callstack_id(), interned_callstack.key());
+
+  ASSERT_EQ(events[3]->event_case(), ClientCaptureEvent::kCallstackSample);
+  EXPECT_EQ(events[3]->callstack_sample().pid(), kPid2);
+  EXPECT_EQ(events[3]->callstack_sample().tid(), kTid2);
+  EXPECT_EQ(events[3]->callstack_sample().timestamp_ns(), kTimestampNs2);
+  EXPECT_EQ(events[3]->callstack_sample().callstack_id(), interned_callstack.key());
+}
+
+TEST(ProducerEventProcessor, ProcessEventsAndProcessEventShareInternedCallstacks) {
+  MockClientCaptureEventCollector collector;
+  auto producer_event_processor = ProducerEventProcessor::Create(&collector);
+
+  ProducerCaptureEvent event;
+  FullCallstackSample* full_callstack_sample1 = event.mutable_full_callstack_sample();
+  full_callstack_sample1->set_pid(kPid1);
+  full_callstack_sample1->set_tid(kTid1);
+  full_callstack_sample1->set_timestamp_ns(kTimestampNs1);
+  Callstack* callstack1 = full_callstack_sample1->mutable_callstack();
+  callstack1->add_pcs(1);
+  callstack1->add_pcs(2);
+  callstack1->set_type(Callstack::kComplete);
+
+  ProducerCaptureEventBatch batch;
+  FullCallstackSample* full_callstack_sample2 = batch.AddEvent()->mutable_full_callstack_sample();
+  full_callstack_sample2->set_pid(kPid2);
+  full_callstack_sample2->set_tid(kTid2);
+  full_callstack_sample2->set_timestamp_ns(kTimestampNs2);
+  *full_callstack_sample2->mutable_callstack() = *callstack1;
+
+  ClientCaptureEvent interned_callstack_event;
+  ClientCaptureEvent callstack_sample_event1;
+  EXPECT_CALL(collector, AddEvent)
+      .Times(2)
+      .WillOnce(SaveArg<0>(&interned_callstack_event))
+      .WillOnce(SaveArg<0>(&callstack_sample_event1));
+  ClientCaptureEventBatch client_capture_event_batch;
+  EXPECT_CALL(collector, AddEvents)
+      .Times(1)
+      .WillOnce(Invoke([&client_capture_event_batch](ClientCaptureEventBatch&& batch) {
+        client_capture_event_batch = std::move(batch);
+      }));
+
+  producer_event_processor->ProcessEvent(kDefaultProducerId, std::move(event));
+  producer_event_processor->ProcessEvents(kDefaultProducerId, std::move(batch));
+
+  ASSERT_EQ(interned_callstack_event.event_case(), ClientCaptureEvent::kInternedCallstack);
+  ASSERT_EQ(callstack_sample_event1.event_case(), ClientCaptureEvent::kCallstackSample);
+  EXPECT_EQ(callstack_sample_event1.callstack_sample().callstack_id(),
+            interned_callstack_event.interned_callstack().key());
+
+  ASSERT_EQ(client_capture_event_batch.size(), 1);
+  const ClientCaptureEvent& callstack_sample_event2 = *client_capture_event_batch.events()[0];
+  ASSERT_EQ(callstack_sample_event2.event_case(), ClientCaptureEvent::kCallstackSample);
+  EXPECT_EQ(callstack_sample_event2.callstack_sample().pid(), kPid2);
+  EXPECT_EQ(callstack_sample_event2.callstack_sample().callstack_id(),
+            interned_callstack_event.interned_callstack().key());
+}
+
+TEST(ProducerEventProcessor, ProcessEventsWithEmptyBatch) {
+  MockClientCaptureEventCollector collector;
+  auto producer_event_processor = ProducerEventProcessor::Create(&collector);
+
+  EXPECT_CALL(collector, AddEvent).Times(0);
+  EXPECT_CALL(collector, AddEvents).Times(0);
+  producer_event_processor->ProcessEvents(kDefaultProducerId, ProducerCaptureEventBatch{});
+}
+
 TEST(ProducerEventProcessor, FullCallstackSampleSameFramesDifferentTypes) {
   MockClientCaptureEventCollector collector;
   auto producer_event_processor = ProducerEventProcessor::Create(&collector);
@@ -971,6 +1107,50 @@ TEST(ProducerEventProcessor, FunctionCallSmoke) {
   }
 }
 
+TEST(ProducerEventProcessor, FunctionCallSummarySmoke) {
+  MockClientCaptureEventCollector collector;
+  auto producer_event_processor = ProducerEventProcessor::Create(&collector);
+
+  ProducerCaptureEvent event;
+  {
+    FunctionCallSummary* function_call_summary = event.mutable_function_call_summary();
+    function_call_summary->set_pid(kPid1);
+    function_call_summary->set_tid(kTid1);
+    function_call_summary->set_function_id(kFunctionId1);
+    function_call_summary->set_start_timestamp_ns(kTimestampNs1);
+    function_call_summary->set_end_timestamp_ns(kTimestampNs2);
+    function_call_summary->set_call_count(3);
+    function_call_summary->set_total_duration_ns(60);
+    function_call_summary->set_min_duration_ns(10);
+    function_call_summary->set_max_duration_ns(30);
+    function_call_summary->set_duration_variance_ns(66.5);
+    function_call_summary->add_duration_log2_histogram(0);
+    function_call_summary->add_duration_log2_histogram(3);
+  }
+
+  ClientCaptureEvent function_call_summary_event;
+  EXPECT_CALL(collector, AddEvent).Times(1).WillOnce(SaveArg<0>(&function_call_summary_event));
+
+  producer_event_processor->ProcessEvent(1, std::move(event));
+
+  ASSERT_EQ(function_call_summary_event.event_case(), ClientCaptureEvent::kFunctionCallSummary);
+  const FunctionCallSummary& function_call_summary =
+      function_call_summary_event.function_call_summary();
+  EXPECT_EQ(function_call_summary.pid(), kPid1);
+  EXPECT_EQ(function_call_summary.tid(), kTid1);
+  EXPECT_EQ(function_call_summary.function_id(), kFunctionId1);
+  EXPECT_EQ(function_call_summary.start_timestamp_ns(), kTimestampNs1);
+  EXPECT_EQ(function_call_summary.end_timestamp_ns(), kTimestampNs2);
+  EXPECT_EQ(function_call_summary.call_count(), 3);
+  EXPECT_EQ(function_call_summary.total_duration_ns(), 60);
+  EXPECT_EQ(function_call_summary.min_duration_ns(), 10);
+  EXPECT_EQ(function_call_summary.max_duration_ns(), 30);
+  EXPECT_EQ(function_call_summary.duration_variance_ns(), 66.5);
+  ASSERT_EQ(function_call_summary.duration_log2_histogram_size(), 2);
+  EXPECT_EQ(function_call_summary.duration_log2_histogram(0), 0);
+  EXPECT_EQ(function_call_summary.duration_log2_histogram(1), 3);
+}
+
 TEST(ProducerEventProcessor, FullGpuJobDifferentTimelines) {
   MockClientCaptureEventCollector collector;
   auto producer_event_processor = ProducerEventProcessor::Create(&collector);
@@ -1933,6 +2113,79 @@ TEST(ProducerEventProcessor, ApiScopeStart) {
   EXPECT_TRUE(MessageDifferencer::Equivalent(api_scope_start_copy, actual_event));
 }
 
+TEST(ProducerEventProcessor, ApiScopeStartWithInternedNameFromTwoProducers) {
+  MockClientCaptureEventCollector collector;
+  auto producer_event_processor = ProducerEventProcessor::Create(&collector);
+
+  ClientCaptureEvent interned_string_event;
+  EXPECT_CALL(collector, AddEvent).Times(1).WillOnce(SaveArg<0>(&interned_string_event));
+  producer_event_processor->ProcessEvent(1, CreateInternedStringEvent(kKey1, "name"));
+  producer_event_processor->ProcessEvent(2, CreateInternedStringEvent(kKey2, "name"));
+  testing::Mock::VerifyAndClearExpectations(&collector);
+  ASSERT_EQ(interned_string_event.event_case(), ClientCaptureEvent::kInternedString);
+  const uint64_t client_key = interned_string_event.interned_string().key();
+
+  ProducerCaptureEvent producer_capture_event1;
+  producer_capture_event1.mutable_api_scope_start()->set_name_key(kKey1);
+  ProducerCaptureEvent producer_capture_event2;
+  producer_capture_event2.mutable_api_scope_start()->set_name_key(kKey2);
+
+  ClientCaptureEvent client_capture_event1;
+  ClientCaptureEvent client_capture_event2;
+  EXPECT_CALL(collector, AddEvent)
+      .Times(2)
+      .WillOnce(SaveArg<0>(&client_capture_event1))
+      .WillOnce(SaveArg<0>(&client_capture_event2));
+  producer_event_processor->ProcessEvent(1, std::move(producer_capture_event1));
+  producer_event_processor->ProcessEvent(2, std::move(producer_capture_event2));
+
+  ASSERT_EQ(client_capture_event1.event_case(), ClientCaptureEvent::kApiScopeStart);
+  ASSERT_EQ(client_capture_event2.event_case(), ClientCaptureEvent::kApiScopeStart);
+  EXPECT_EQ(client_capture_event1.api_scope_start().name_key(), client_key);
+  EXPECT_EQ(client_capture_event2.api_scope_start().name_key(), client_key);
+}
+
+TEST(ProducerEventProcessor, ApiTrackIntWithUnknownNameKeyGetsPlaceholderName) {
+  MockClientCaptureEventCollector collector;
+  auto producer_event_processor = ProducerEventProcessor::Create(&collector);
+
+  ClientCaptureEvent interned_string_event;
+  ClientCaptureEvent client_capture_event1;
+  ClientCaptureEvent client_capture_event2;
+  EXPECT_CALL(collector, AddEvent)
+      .Times(3)
+      .WillOnce(SaveArg<0>(&interned_string_event))
+      .WillOnce(SaveArg<0>(&client_capture_event1))
+      .WillOnce(SaveArg<0>(&client_capture_event2));
+
+  for (int i = 0; i < 2; ++i) {
+    ProducerCaptureEvent producer_capture_event;
+    ApiTrackInt* api_track_int = producer_capture_event.mutable_api_track_int();
+    api_track_int->set_data(kInt);
+    api_track_int->set_name_key(kKey1);
+    producer_event_processor->ProcessEvent(kDefaultProducerId, std::move(producer_capture_event));
+  }
+
+  // The placeholder name is only sent once.
+  ASSERT_EQ(interned_string_event.event_case(), ClientCaptureEvent::kInternedString);
+  EXPECT_EQ(interned_string_event.interned_string().intern(), "<unknown name 13>");
+  const uint64_t client_key = interned_string_event.interned_string().key();
+  ASSERT_EQ(client_capture_event1.event_case(), ClientCaptureEvent::kApiTrackInt);
+  EXPECT_EQ(client_capture_event1.api_track_int().name_key(), client_key);
+  EXPECT_EQ(client_capture_event1.api_track_int().data(), kInt);
+  ASSERT_EQ(client_capture_event2.event_case(), ClientCaptureEvent::kApiTrackInt);
+  EXPECT_EQ(client_capture_event2.api_track_int().name_key(), client_key);
+  testing::Mock::VerifyAndClearExpectations(&collector);
+
+  // The actual name can still arrive afterwards.
+  ClientCaptureEvent actual_name_event;
+  EXPECT_CALL(collector, AddEvent).Times(1).WillOnce(SaveArg<0>(&actual_name_event));
+  producer_event_processor->ProcessEvent(kDefaultProducerId,
+                                         CreateInternedStringEvent(kKey1, "name"));
+  ASSERT_EQ(actual_name_event.event_case(), ClientCaptureEvent::kInternedString);
+  EXPECT_EQ(actual_name_event.interned_string().intern(), "name");
+}
+
 TEST(ProducerEventProcessor, ApiScopeStop) {
   ProducerCaptureEvent producer_capture_event;
   ApiScopeStop* api_scope_stop = producer_capture_event.mutable_api_scope_stop();
@@ -0,0 +1,89 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_EVENT_PROCESSOR_CAPTURE_EVENT_BATCH_H_
+#define CAPTURE_EVENT_PROCESSOR_CAPTURE_EVENT_BATCH_H_
+
+#include <google/protobuf/arena.h>
+#include <stddef.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Logging.h"
+
+namespace orbit_producer_event_processor {
+
+// A sequence of capture events (ProducerCaptureEvents or ClientCaptureEvents) created on a protobuf
+// Arena owned by the batch. Compared to creating each event on the heap, this saves the memory
+// allocations for the events and their sub-messages, and allows handing all the events over at
+// once, by moving the batch, without copying them.
+// Note that sub-messages can only be moved without copies between messages on the same Arena.
+template <typename EventT>
+class CaptureEventBatch {
+ public:
+  CaptureEventBatch() : arena_{CreateArena()} {}
+  // Creates an empty batch whose events will be created on `arena`, which can already hold other
+  // messages that the events will take over.
+  explicit CaptureEventBatch(std::unique_ptr<google::protobuf::Arena> arena)
+      : arena_{std::move(arena)} {
+    ORBIT_CHECK(arena_ != nullptr);
+  }
+
+  CaptureEventBatch(const CaptureEventBatch&) = delete;
+  CaptureEventBatch& operator=(const CaptureEventBatch&) = delete;
+  CaptureEventBatch(CaptureEventBatch&&) = default;
+  CaptureEventBatch& operator=(CaptureEventBatch&&) = default;
+  ~CaptureEventBatch() = default;
+
+  // Creates a new empty event at the end of the batch.
+  [[nodiscard]] EventT* AddEvent() {
+    EventT* event = google::protobuf::Arena::CreateMessage<EventT>(arena_.get());
+    events_.push_back(event);
+    return event;
+  }
+
+  // Removes the last event, e.g., when filling it in failed. Its memory is only freed with the
+  // Arena.
+  void DiscardLastEvent() {
+    ORBIT_CHECK(!events_.empty());
+    events_.pop_back();
+  }
+
+  [[nodiscard]] google::protobuf::Arena* arena() const { return arena_.get(); }
+  [[nodiscard]] const std::vector<EventT*>& events() const { return events_; }
+  [[nodiscard]] size_t size() const { return events_.size(); }
+  [[nodiscard]] bool empty() const { return events_.empty(); }
+
+  // Transfers the ownership of the Arena, and hence of the memory of all the events, to the
+  // caller, leaving the batch without events.
+  [[nodiscard]] std::unique_ptr<google::protobuf::Arena> ReleaseArena() {
+    events_.clear();
+    return std::move(arena_);
+  }
+
+ private:
+  [[nodiscard]] static std::unique_ptr<google::protobuf::Arena> CreateArena() {
+    // Batches are short-lived and are created continuously during a capture, so keep the blocks
+    // small enough that the allocator serves them without mmap.
+    constexpr size_t kArenaStartBlockSize = 16 * 1024;
+    constexpr size_t kArenaMaxBlockSize = 64 * 1024;
+    google::protobuf::ArenaOptions arena_options;
+    arena_options.start_block_size = kArenaStartBlockSize;
+    arena_options.max_block_size = kArenaMaxBlockSize;
+    return std::make_unique<google::protobuf::Arena>(arena_options);
+  }
+
+  std::unique_ptr<google::protobuf::Arena> arena_;
+  std::vector<EventT*> events_;
+};
+
+using ProducerCaptureEventBatch = CaptureEventBatch<orbit_grpc_protos::ProducerCaptureEvent>;
+using ClientCaptureEventBatch = CaptureEventBatch<orbit_grpc_protos::ClientCaptureEvent>;
+
+}  // namespace orbit_producer_event_processor
+
+#endif  // CAPTURE_EVENT_PROCESSOR_CAPTURE_EVENT_BATCH_H_
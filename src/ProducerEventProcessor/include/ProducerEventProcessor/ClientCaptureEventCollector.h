@@ -6,15 +6,19 @@
 #define CAPTURE_EVENT_PROCESSOR_CLIENT_CAPTURE_EVENT_COLLECTOR_H_
 
 #include "GrpcProtos/capture.pb.h"
+#include "ProducerEventProcessor/CaptureEventBatch.h"
 
 namespace orbit_producer_event_processor {
 
 // Interface used to receive ClientCaptureEvents from a ProducerEventProcessor.
-// AddEvent is to be assumed thread safe.
+// AddEvent and AddEvents are to be assumed thread safe.
 class ClientCaptureEventCollector {
  public:
   virtual ~ClientCaptureEventCollector() = default;
   virtual void AddEvent(orbit_grpc_protos::ClientCaptureEvent&& event) = 0;
+  // Adds all the events in `batch`, in order. Implementations can keep the batch, i.e., its Arena,
+  // alive for as long as they need the events, instead of copying them.
+  virtual void AddEvents(ClientCaptureEventBatch&& batch) = 0;
   virtual void StopAndWait() = 0;
 };
 
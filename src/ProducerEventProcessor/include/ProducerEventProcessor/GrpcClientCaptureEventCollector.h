@@ -19,6 +19,7 @@
 
 #include "GrpcProtos/capture.pb.h"
 #include "GrpcProtos/services.pb.h"
+#include "ProducerEventProcessor/CaptureEventBatch.h"
 #include "ProducerEventProcessor/ClientCaptureEventCollector.h"
 
 namespace orbit_producer_event_processor {
@@ -32,12 +33,15 @@ class GrpcClientCaptureEventCollector final : public ClientCaptureEventCollector
                                         orbit_grpc_protos::CaptureRequest>* reader_writer);
 
   void AddEvent(orbit_grpc_protos::ClientCaptureEvent&& event) override;
+  void AddEvents(ClientCaptureEventBatch&& batch) override;
 
   void StopAndWait() override;
 
   ~GrpcClientCaptureEventCollector() override;
 
  private:
+  [[nodiscard]] orbit_grpc_protos::CaptureResponse* GetCaptureResponseToAddEventTo()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void SenderThread();
 
   grpc::ServerReaderWriterInterface<orbit_grpc_protos::CaptureResponse,
@@ -54,6 +58,11 @@ class GrpcClientCaptureEventCollector final : public ClientCaptureEventCollector
       ABSL_GUARDED_BY(mutex_);
   std::unique_ptr<google::protobuf::Arena> arena_of_capture_responses_to_send_;
   std::vector<orbit_grpc_protos::CaptureResponse*> capture_responses_to_send_;
+  // The Arenas of the ClientCaptureEventBatches whose events are referenced by the CaptureResponses
+  // being built and to send, respectively.
+  std::vector<std::unique_ptr<google::protobuf::Arena>> arenas_of_batches_being_built_
+      ABSL_GUARDED_BY(mutex_);
+  std::vector<std::unique_ptr<google::protobuf::Arena>> arenas_of_batches_to_send_;
 
   uint64_t total_number_of_events_sent_ = 0;
   uint64_t total_number_of_bytes_sent_ = 0;
@@ -9,6 +9,7 @@
 
 #include <memory>
 
+#include "CaptureEventBatch.h"
 #include "ClientCaptureEventCollector.h"
 #include "GrpcProtos/capture.pb.h"
 
@@ -24,6 +25,11 @@ class ProducerEventProcessor {
 
   virtual void ProcessEvent(uint64_t producer_id,
                             orbit_grpc_protos::ProducerCaptureEvent&& event) = 0;
+  // Processes all the events in `batch`, which all come from `producer_id`, in order. The resulting
+  // ClientCaptureEvents are created on the Arena of the batch, so that the sub-messages of the
+  // ProducerCaptureEvents are moved into them without copies, and are passed to the
+  // ClientCaptureEventCollector all together, with the Arena.
+  virtual void ProcessEvents(uint64_t producer_id, ProducerCaptureEventBatch&& batch) = 0;
 
   static std::unique_ptr<ProducerEventProcessor> Create(
       ClientCaptureEventCollector* client_capture_event_collector);
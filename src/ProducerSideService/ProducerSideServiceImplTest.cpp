@@ -147,6 +147,9 @@ class MockProducerEventProcessor : public orbit_producer_event_processor::Produc
  public:
   MOCK_METHOD(void, ProcessEvent, (uint64_t, orbit_grpc_protos::ProducerCaptureEvent&& event),
               (override));
+  MOCK_METHOD(void, ProcessEvents,
+              (uint64_t, orbit_producer_event_processor::ProducerCaptureEventBatch&& batch),
+              (override));
 };
 
 class ProducerSideServiceImplTest : public ::testing::Test {
@@ -4,12 +4,15 @@
 
 #include "AccessTraceesMemory.h"
 
+#include <absl/base/casts.h>
 #include <absl/strings/numbers.h>
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_split.h>
 #include <absl/types/span.h>
+#include <sys/uio.h>
 
 #include <algorithm>
+#include <climits>
 #include <string>
 
 #include "OrbitBase/File.h"
@@ -20,6 +23,43 @@ namespace orbit_user_space_instrumentation {
 
 using orbit_base::ReadFileToString;
 
+namespace {
+
+// Transfers the `remote` ranges of process `pid` from or to the `local` ones with
+// `process_vm_function`, i.e., `process_vm_readv` or `process_vm_writev`, using as few system calls
+// as possible. Stops at the first range that can't be transferred completely and returns the number
+// of ranges that were.
+template <typename ProcessVmFunction>
+[[nodiscard]] size_t TransferRangesWithProcessVm(ProcessVmFunction process_vm_function, pid_t pid,
+                                                 absl::Span<const iovec> local,
+                                                 absl::Span<const iovec> remote) {
+  ORBIT_CHECK(local.size() == remote.size());
+  size_t transferred_range_count = 0;
+  while (transferred_range_count < remote.size()) {
+    // The system calls take at most IOV_MAX ranges.
+    const size_t batch_size = std::min<size_t>(IOV_MAX, remote.size() - transferred_range_count);
+    const ssize_t result =
+        process_vm_function(pid, local.data() + transferred_range_count, batch_size,
+                            remote.data() + transferred_range_count, batch_size, 0);
+    if (result <= 0) break;
+
+    auto transferred_byte_count = static_cast<size_t>(result);
+    size_t transferred_range_count_in_batch = 0;
+    while (transferred_range_count_in_batch < batch_size &&
+           remote[transferred_range_count + transferred_range_count_in_batch].iov_len <=
+               transferred_byte_count) {
+      transferred_byte_count -=
+          remote[transferred_range_count + transferred_range_count_in_batch].iov_len;
+      ++transferred_range_count_in_batch;
+    }
+    transferred_range_count += transferred_range_count_in_batch;
+    if (transferred_range_count_in_batch < batch_size) break;
+  }
+  return transferred_range_count;
+}
+
+}  // namespace
+
 [[nodiscard]] ErrorMessageOr<std::vector<uint8_t>> ReadTraceesMemory(pid_t pid,
                                                                      uint64_t start_address,
                                                                      uint64_t length) {
@@ -50,6 +90,68 @@ using orbit_base::ReadFileToString;
   return outcome::success();
 }
 
+[[nodiscard]] ErrorMessageOr<std::vector<std::vector<uint8_t>>> ReadTraceesMemoryRanges(
+    pid_t pid, absl::Span<const AddressRange> address_ranges) {
+  std::vector<std::vector<uint8_t>> result(address_ranges.size());
+  std::vector<iovec> local(address_ranges.size());
+  std::vector<iovec> remote(address_ranges.size());
+  for (size_t i = 0; i < address_ranges.size(); ++i) {
+    const AddressRange& address_range = address_ranges[i];
+    ORBIT_CHECK(address_range.end > address_range.start);
+    const uint64_t length = address_range.end - address_range.start;
+    result[i].resize(length);
+    local[i] = {result[i].data(), length};
+    remote[i] = {absl::bit_cast<void*>(address_range.start), length};
+  }
+
+  const size_t read_range_count =
+      TransferRangesWithProcessVm(&process_vm_readv, pid, local, remote);
+  if (read_range_count == address_ranges.size()) return result;
+
+  // Unlike process_vm_readv, /proc/<pid>/mem can also read pages that are not readable in the
+  // tracee.
+  OUTCOME_TRY(auto&& fd, orbit_base::OpenFileForReading(absl::StrFormat("/proc/%d/mem", pid)));
+  for (size_t i = read_range_count; i < address_ranges.size(); ++i) {
+    const uint64_t length = result[i].size();
+    OUTCOME_TRY(auto&& read_length,
+                ReadFullyAtOffset(fd, result[i].data(), length, address_ranges[i].start));
+    if (read_length < length) {
+      return ErrorMessage(absl::StrFormat(
+          "Failed to read %u bytes from memory file of process %d. Only got %d bytes.", length,
+          pid, read_length));
+    }
+  }
+  return result;
+}
+
+[[nodiscard]] ErrorMessageOr<void> WriteTraceesMemoryRanges(
+    pid_t pid, absl::Span<const TraceesMemoryWrite> writes) {
+  std::vector<iovec> local(writes.size());
+  std::vector<iovec> remote(writes.size());
+  for (size_t i = 0; i < writes.size(); ++i) {
+    const TraceesMemoryWrite& write = writes[i];
+    ORBIT_CHECK(!write.bytes.empty());
+    // process_vm_writev doesn't modify the local memory, it just takes the same type as
+    // process_vm_readv.
+    local[i] = {const_cast<uint8_t*>(write.bytes.data()), write.bytes.size()};
+    remote[i] = {absl::bit_cast<void*>(write.start_address), write.bytes.size()};
+  }
+
+  const size_t written_range_count =
+      TransferRangesWithProcessVm(&process_vm_writev, pid, local, remote);
+  if (written_range_count == writes.size()) return outcome::success();
+
+  // Unlike process_vm_writev, /proc/<pid>/mem can also write pages that are not writable in the
+  // tracee.
+  OUTCOME_TRY(auto&& fd, orbit_base::OpenFileForWriting(absl::StrFormat("/proc/%d/mem", pid)));
+  for (size_t i = written_range_count; i < writes.size(); ++i) {
+    const TraceesMemoryWrite& write = writes[i];
+    OUTCOME_TRY(
+        WriteFullyAtOffset(fd, write.bytes.data(), write.bytes.size(), write.start_address));
+  }
+  return outcome::success();
+}
+
 [[nodiscard]] ErrorMessageOr<AddressRange> GetExistingExecutableMemoryRegion(
     pid_t pid, uint64_t exclude_address) {
   OUTCOME_TRY(auto&& maps, ReadFileToString(absl::StrFormat("/proc/%d/maps", pid)));
@@ -27,6 +27,29 @@ namespace orbit_user_space_instrumentation {
 [[nodiscard]] ErrorMessageOr<void> WriteTraceesMemory(pid_t pid, uint64_t start_address,
                                                       absl::Span<const uint8_t> bytes);
 
+// Reads the memory of process `pid` in each of `address_ranges` and returns the bytes, in the order
+// of the ranges. Uses `process_vm_readv` to read many ranges with a single system call. The ranges
+// it can't read are read through a single file descriptor on `/proc/<pid>/mem`, like in
+// `ReadTraceesMemory`. Unlike `ReadTraceesMemory`, this doesn't require the tracee to be stopped,
+// but then it's up to the caller that the memory doesn't change while being read.
+[[nodiscard]] ErrorMessageOr<std::vector<std::vector<uint8_t>>> ReadTraceesMemoryRanges(
+    pid_t pid, absl::Span<const AddressRange> address_ranges);
+
+struct TraceesMemoryWrite {
+  uint64_t start_address = 0;
+  std::vector<uint8_t> bytes;
+};
+
+// Performs all `writes` into the memory of process `pid`, in order. Uses `process_vm_writev` to
+// write many ranges with a single system call. As `process_vm_writev` respects the protection of
+// the tracee's pages, the remaining writes after the first one it can't perform, e.g., into code,
+// go through a single file descriptor on `/proc/<pid>/mem`, like in `WriteTraceesMemory`. Hence
+// writes into code are best batched separately from writes into writable memory.
+// Assumes we are already attached to the tracee `pid` e.g. using `AttachAndStopProcess`, unless no
+// thread of the tracee can execute the memory that is written.
+[[nodiscard]] ErrorMessageOr<void> WriteTraceesMemoryRanges(
+    pid_t pid, absl::Span<const TraceesMemoryWrite> writes);
+
 // Returns the address range of an executable memory region. One options is usually the second line
 // in the `maps` file corresponding to the code of the process we look at. However we don't really
 // care. So keeping it general and just searching for an executable region is probably helping
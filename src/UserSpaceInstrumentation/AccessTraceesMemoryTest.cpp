@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/base/casts.h>
 #include <absl/strings/numbers.h>
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_split.h>
@@ -12,6 +13,7 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <array>
 #include <csignal>
 #include <cstdint>
 #include <iterator>
@@ -33,6 +35,10 @@ namespace orbit_user_space_instrumentation {
 namespace {
 
 using orbit_test_utils::HasError;
+using orbit_test_utils::HasNoError;
+
+// The forked child has this at the same address as the parent, in writable memory.
+std::array<uint8_t, 64> writable_data{};
 
 AddressRange AddressRangeFromString(std::string_view string_address) {
   AddressRange result{};
@@ -233,4 +239,76 @@ TEST(AccessTraceesMemoryTest, ReadWriteRestore) {
   waitpid(pid, nullptr, 0);
 }
 
+TEST(AccessTraceesMemoryTest, ReadWriteRangesRestore) {
+  pid_t pid = fork();
+  ORBIT_CHECK(pid != -1);
+  if (pid == 0) {
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+    // Child just runs an endless loop.
+    volatile uint64_t counter = 0;
+    while (true) {
+      // Endless loops without side effects are UB and recent versions of clang optimize it away.
+      ++counter;
+    }
+  }
+
+  // Stop the child process using our tooling.
+  ORBIT_CHECK(!AttachAndStopProcess(pid).has_error());
+
+  auto memory_region_or_error = GetExistingExecutableMemoryRegion(pid);
+  ORBIT_CHECK(memory_region_or_error.has_value());
+  const uint64_t code_address = memory_region_or_error.value().start;
+  const auto data_address = absl::bit_cast<uint64_t>(writable_data.data());
+
+  // Code is not writable in the tracee, so the writes of the second and the third range can't use
+  // process_vm_writev.
+  const std::vector<AddressRange> ranges = {{data_address, data_address + writable_data.size()},
+                                            {code_address, code_address + 16},
+                                            {code_address + 100, code_address + 132}};
+  auto backup_or_error = ReadTraceesMemoryRanges(pid, ranges);
+  ASSERT_THAT(backup_or_error, HasNoError());
+  const std::vector<std::vector<uint8_t>>& backup = backup_or_error.value();
+  ASSERT_EQ(backup.size(), ranges.size());
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    auto expected_or_error =
+        ReadTraceesMemory(pid, ranges[i].start, ranges[i].end - ranges[i].start);
+    ASSERT_THAT(expected_or_error, HasNoError());
+    EXPECT_EQ(backup[i], expected_or_error.value());
+  }
+
+  std::vector<TraceesMemoryWrite> writes;
+  std::mt19937 engine{std::random_device()()};
+  std::uniform_int_distribution<uint32_t> distribution{0x00, 0xff};
+  for (const AddressRange& range : ranges) {
+    std::vector<uint8_t> new_data(range.end - range.start);
+    std::generate(std::begin(new_data), std::end(new_data), [&distribution, &engine]() {
+      return static_cast<uint8_t>(distribution(engine));
+    });
+    writes.push_back({range.start, std::move(new_data)});
+  }
+  ASSERT_THAT(WriteTraceesMemoryRanges(pid, writes), HasNoError());
+
+  auto read_back_or_error = ReadTraceesMemoryRanges(pid, ranges);
+  ASSERT_THAT(read_back_or_error, HasNoError());
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    EXPECT_EQ(read_back_or_error.value()[i], writes[i].bytes);
+  }
+
+  // Bad address.
+  EXPECT_THAT(ReadTraceesMemoryRanges(pid, {{0, 16}}), HasError("Input/output error"));
+  EXPECT_THAT(WriteTraceesMemoryRanges(pid, {{0, std::vector<uint8_t>(16)}}),
+              HasError("Input/output error"));
+
+  // Restore, detach and end child.
+  std::vector<TraceesMemoryWrite> restore_writes;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    restore_writes.push_back({ranges[i].start, backup[i]});
+  }
+  ORBIT_CHECK(!WriteTraceesMemoryRanges(pid, restore_writes).has_error());
+  ORBIT_CHECK(!DetachAndContinueProcess(pid).has_error());
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+}
+
 }  // namespace orbit_user_space_instrumentation
\ No newline at end of file
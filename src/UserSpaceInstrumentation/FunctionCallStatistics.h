@@ -0,0 +1,91 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef USER_SPACE_INSTRUMENTATION_FUNCTION_CALL_STATISTICS_H_
+#define USER_SPACE_INSTRUMENTATION_FUNCTION_CALL_STATISTICS_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace orbit_user_space_instrumentation {
+
+// Accumulates the statistics of the calls of one function: count, total, min and max duration, the
+// variance of the durations, and a histogram of the durations with logarithmic buckets. This is
+// what liborbituserspaceinstrumentation sends instead of individual calls for the functions that
+// are instrumented with `aggregate_calls`, hence adding a call needs to be cheap.
+class FunctionCallStatistics {
+ public:
+  // Bucket i holds the calls with a duration d such that floor(log2(d)) == i, where calls with
+  // d == 0 are in bucket 0.
+  static constexpr size_t kBucketCount = 64;
+
+  void AddCall(uint64_t entry_timestamp_ns, uint64_t exit_timestamp_ns) {
+    const uint64_t duration_ns = exit_timestamp_ns - entry_timestamp_ns;
+    if (call_count_ == 0) {
+      start_timestamp_ns_ = entry_timestamp_ns;
+      shift_ns_ = duration_ns;
+    }
+    start_timestamp_ns_ = std::min(start_timestamp_ns_, entry_timestamp_ns);
+    end_timestamp_ns_ = std::max(end_timestamp_ns_, exit_timestamp_ns);
+    ++call_count_;
+    total_duration_ns_ += duration_ns;
+    min_duration_ns_ = std::min(min_duration_ns_, duration_ns);
+    max_duration_ns_ = std::max(max_duration_ns_, duration_ns);
+    // Summing the squares of the durations shifted by the first duration, rather than of the
+    // durations themselves, avoids the catastrophic cancellation when computing the variance.
+    const double shifted_duration_ns =
+        static_cast<double>(duration_ns) - static_cast<double>(shift_ns_);
+    sum_of_squared_shifted_durations_ += shifted_duration_ns * shifted_duration_ns;
+    ++duration_log2_histogram_[ComputeBucketIndex(duration_ns)];
+  }
+
+  void Reset() { *this = FunctionCallStatistics{}; }
+
+  [[nodiscard]] bool IsEmpty() const { return call_count_ == 0; }
+
+  [[nodiscard]] uint64_t start_timestamp_ns() const { return start_timestamp_ns_; }
+  [[nodiscard]] uint64_t end_timestamp_ns() const { return end_timestamp_ns_; }
+  [[nodiscard]] uint64_t call_count() const { return call_count_; }
+  [[nodiscard]] uint64_t total_duration_ns() const { return total_duration_ns_; }
+  [[nodiscard]] uint64_t min_duration_ns() const { return IsEmpty() ? 0 : min_duration_ns_; }
+  [[nodiscard]] uint64_t max_duration_ns() const { return max_duration_ns_; }
+  [[nodiscard]] const std::array<uint64_t, kBucketCount>& duration_log2_histogram() const {
+    return duration_log2_histogram_;
+  }
+
+  // The population variance of the durations, like ScopeStats computes it on the client.
+  [[nodiscard]] double ComputeDurationVarianceNs() const {
+    if (call_count_ == 0) return 0.0;
+    const auto count = static_cast<double>(call_count_);
+    const double sum_of_shifted_durations =
+        static_cast<double>(total_duration_ns_) - count * static_cast<double>(shift_ns_);
+    const double mean_of_shifted_durations = sum_of_shifted_durations / count;
+    const double variance = sum_of_squared_shifted_durations_ / count -
+                            mean_of_shifted_durations * mean_of_shifted_durations;
+    return std::max(variance, 0.0);
+  }
+
+  [[nodiscard]] static size_t ComputeBucketIndex(uint64_t duration_ns) {
+    if (duration_ns == 0) return 0;
+    return std::numeric_limits<uint64_t>::digits - 1 - __builtin_clzll(duration_ns);
+  }
+
+ private:
+  uint64_t start_timestamp_ns_ = 0;
+  uint64_t end_timestamp_ns_ = 0;
+  uint64_t call_count_ = 0;
+  uint64_t total_duration_ns_ = 0;
+  uint64_t min_duration_ns_ = std::numeric_limits<uint64_t>::max();
+  uint64_t max_duration_ns_ = 0;
+  uint64_t shift_ns_ = 0;
+  double sum_of_squared_shifted_durations_ = 0.0;
+  std::array<uint64_t, kBucketCount> duration_log2_histogram_{};
+};
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // USER_SPACE_INSTRUMENTATION_FUNCTION_CALL_STATISTICS_H_
@@ -0,0 +1,84 @@
+// Copyright (c) 2022 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "FunctionCallStatistics.h"
+
+namespace orbit_user_space_instrumentation {
+
+TEST(FunctionCallStatistics, IsEmptyInitially) {
+  FunctionCallStatistics statistics;
+  EXPECT_TRUE(statistics.IsEmpty());
+  EXPECT_EQ(statistics.call_count(), 0);
+  EXPECT_EQ(statistics.min_duration_ns(), 0);
+  EXPECT_EQ(statistics.max_duration_ns(), 0);
+  EXPECT_EQ(statistics.ComputeDurationVarianceNs(), 0.0);
+}
+
+TEST(FunctionCallStatistics, ComputesBucketIndex) {
+  EXPECT_EQ(FunctionCallStatistics::ComputeBucketIndex(0), 0);
+  EXPECT_EQ(FunctionCallStatistics::ComputeBucketIndex(1), 0);
+  EXPECT_EQ(FunctionCallStatistics::ComputeBucketIndex(2), 1);
+  EXPECT_EQ(FunctionCallStatistics::ComputeBucketIndex(3), 1);
+  EXPECT_EQ(FunctionCallStatistics::ComputeBucketIndex(4), 2);
+  EXPECT_EQ(FunctionCallStatistics::ComputeBucketIndex(1023), 9);
+  EXPECT_EQ(FunctionCallStatistics::ComputeBucketIndex(1024), 10);
+  EXPECT_EQ(FunctionCallStatistics::ComputeBucketIndex(UINT64_MAX),
+            FunctionCallStatistics::kBucketCount - 1);
+}
+
+TEST(FunctionCallStatistics, AddCall) {
+  FunctionCallStatistics statistics;
+  statistics.AddCall(100, 110);
+  statistics.AddCall(200, 230);
+  statistics.AddCall(50, 70);
+
+  EXPECT_FALSE(statistics.IsEmpty());
+  EXPECT_EQ(statistics.start_timestamp_ns(), 50);
+  EXPECT_EQ(statistics.end_timestamp_ns(), 230);
+  EXPECT_EQ(statistics.call_count(), 3);
+  EXPECT_EQ(statistics.total_duration_ns(), 60);
+  EXPECT_EQ(statistics.min_duration_ns(), 10);
+  EXPECT_EQ(statistics.max_duration_ns(), 30);
+  // The durations are 10, 30 and 20, with mean 20.
+  EXPECT_DOUBLE_EQ(statistics.ComputeDurationVarianceNs(), 200.0 / 3);
+
+  for (size_t i = 0; i < FunctionCallStatistics::kBucketCount; ++i) {
+    if (i == 3) {
+      EXPECT_EQ(statistics.duration_log2_histogram()[i], 1);  // 10
+    } else if (i == 4) {
+      EXPECT_EQ(statistics.duration_log2_histogram()[i], 2);  // 20 and 30
+    } else {
+      EXPECT_EQ(statistics.duration_log2_histogram()[i], 0);
+    }
+  }
+}
+
+TEST(FunctionCallStatistics, VarianceIsAccurateForLongSimilarDurations) {
+  FunctionCallStatistics statistics;
+  constexpr uint64_t kBaseDurationNs = 1'000'000'000'000;
+  statistics.AddCall(0, kBaseDurationNs + 1);
+  statistics.AddCall(0, kBaseDurationNs + 3);
+  EXPECT_DOUBLE_EQ(statistics.ComputeDurationVarianceNs(), 1.0);
+}
+
+TEST(FunctionCallStatistics, Reset) {
+  FunctionCallStatistics statistics;
+  statistics.AddCall(100, 110);
+  statistics.Reset();
+  EXPECT_TRUE(statistics.IsEmpty());
+  EXPECT_EQ(statistics.total_duration_ns(), 0);
+  EXPECT_EQ(statistics.duration_log2_histogram()[3], 0);
+
+  statistics.AddCall(300, 305);
+  EXPECT_EQ(statistics.start_timestamp_ns(), 300);
+  EXPECT_EQ(statistics.min_duration_ns(), 5);
+  EXPECT_EQ(statistics.ComputeDurationVarianceNs(), 0.0);
+}
+
+}  // namespace orbit_user_space_instrumentation
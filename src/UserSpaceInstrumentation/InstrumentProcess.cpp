@@ -8,6 +8,8 @@
 #include <absl/container/flat_hash_set.h>
 #include <absl/meta/type_traits.h>
 #include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
 #include <absl/types/span.h>
 #include <capstone/capstone.h>
 #include <dlfcn.h>
@@ -18,7 +20,9 @@
 #include <chrono>
 #include <cstdint>
 #include <filesystem>
+#include <iterator>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <string>
 #include <string_view>
@@ -38,8 +42,10 @@
 #include "OrbitBase/File.h"
 #include "OrbitBase/GetProcessIds.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/ParallelFor.h"
 #include "OrbitBase/Profiling.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadPool.h"
 #include "OrbitBase/ThreadUtils.h"
 #include "OrbitBase/UniqueResource.h"
 #include "Trampoline.h"
@@ -134,6 +140,22 @@ bool IsBlocklisted(std::string_view function_name) {
   return kBlocklist.contains(function_name);
 }
 
+// Returns a handle to the Capstone disassembler for x86-64, with instruction details. The handle
+// needs to be closed with `cs_close`.
+ErrorMessageOr<csh> OpenCapstoneDisassembler() {
+  csh capstone_handle = 0;
+  cs_err error_code = cs_open(CS_ARCH_X86, CS_MODE_64, &capstone_handle);
+  if (error_code != CS_ERR_OK) {
+    return ErrorMessage("Failed to open Capstone disassembler.");
+  }
+  error_code = cs_option(capstone_handle, CS_OPT_DETAIL, CS_OPT_ON);
+  if (error_code != CS_ERR_OK) {
+    cs_close(&capstone_handle);
+    return ErrorMessage("Failed to configure Capstone disassembler.");
+  }
+  return capstone_handle;
+}
+
 // MachineCodeForCloneCall creates the code to spawn a new thread inside the target process by using
 // the clone syscall. This thread is used to execute the initialization code inside the target.
 // Note that calling the result of the clone call a "thread" is a bit of a misnomer: We
@@ -294,8 +316,8 @@ class InstrumentedProcess {
 
   // Instruments the functions capture_options.instrumented_functions. Returns a set of
   // function_id's of successfully instrumented functions, a map of function_id's to errors for
-  // functions that couldn't be instrumented, the address ranges dedicated to trampolines, and the
-  // map name of the injected library.
+  // functions that couldn't be instrumented, the address ranges dedicated to trampolines, the map
+  // name of the injected library, and the time the process was stopped.
   [[nodiscard]] ErrorMessageOr<InstrumentationManager::InstrumentationResult> InstrumentFunctions(
       const CaptureOptions& capture_options, absl::Span<const ModuleInfo> modules);
 
@@ -309,16 +331,34 @@ class InstrumentedProcess {
  private:
   InstrumentedProcess() = default;
 
+  // A function that needs a trampoline, as it has not been instrumented before.
+  struct NewTrampoline {
+    uint64_t function_address = 0;
+    uint64_t function_size = 0;
+    AddressRange module_address_range;
+  };
+
+  // Creates the trampolines for `new_trampolines` and adds them to `trampoline_map_`. Returns the
+  // error messages for the functions for which that failed, by function address. Only stops the
+  // process if memory for the trampolines needs to be allocated, and adds the time it was stopped
+  // to `stop_the_world_duration`. The trampolines are assembled in parallel, and are written while
+  // the process keeps running since nothing jumps into them yet.
+  [[nodiscard]] ErrorMessageOr<absl::flat_hash_map<uint64_t, std::string>> CreateTrampolines(
+      absl::Span<const NewTrampoline> new_trampolines, absl::Duration& stop_the_world_duration);
+
+  // Returns how many times `GetTrampolineMemory` can be called for the module identified by
+  // `address_range` without allocating memory in the tracee.
+  [[nodiscard]] uint64_t GetNumberOfAvailableTrampolines(AddressRange address_range) const;
+  // Makes sure that `trampoline_count` trampolines are available for the module identified by
+  // `address_range` by allocating new chunks in the tracee. The tracee needs to be stopped.
+  [[nodiscard]] ErrorMessageOr<void> EnsureTrampolinesAvailable(AddressRange address_range,
+                                                                uint64_t trampoline_count);
   // Returns an address where we can construct a new trampoline for some function in the module
-  // identified by `address_range`. Handles the allocation in the tracee and the tracks the
-  // allocated memory in `trampolines_for_modules_` below.
-  [[nodiscard]] ErrorMessageOr<uint64_t> GetTrampolineMemory(AddressRange address_range);
+  // identified by `address_range`. A trampoline needs to be available, see above.
+  [[nodiscard]] uint64_t GetTrampolineMemory(AddressRange address_range);
   // Releases the address previously obtained by `GetTrampolineMemory` such that it can be reused.
-  // Note that this must only be called once for each call to `GetTrampolineMemory`.
-  [[nodiscard]] ErrorMessageOr<void> ReleaseMostRecentlyAllocatedTrampolineMemory(
-      AddressRange address_range);
+  void ReleaseTrampolineMemory(AddressRange address_range, uint64_t trampoline_address);
 
-  [[nodiscard]] ErrorMessageOr<void> EnsureTrampolinesWritable();
   [[nodiscard]] ErrorMessageOr<void> EnsureTrampolinesExecutable();
 
   // Returns a vector of the address ranges dedicated to all entry trampolines for this process. The
@@ -352,16 +392,19 @@ class InstrumentedProcess {
   // (compare `GetMaxTrampolineSize`) and are never freed; we just allocate new chunks when that
   // last one is filled up. Each module (identified by its address range) gets it own sequence of
   // chunks (`trampolines_for_modules_`).
-  static constexpr int kTrampolinesPerChunk = 4096;
+  static constexpr uint64_t kTrampolinesPerChunk = 4096;
   struct TrampolineMemoryChunk {
     TrampolineMemoryChunk() = default;
-    TrampolineMemoryChunk(std::unique_ptr<MemoryInTracee> m, int first_available)
+    TrampolineMemoryChunk(std::unique_ptr<MemoryInTracee> m, uint64_t first_available)
         : memory(std::move(m)), first_available(first_available) {}
     std::unique_ptr<MemoryInTracee> memory;
-    int first_available = 0;
+    uint64_t first_available = 0;
   };
   using TrampolineMemoryChunks = std::vector<TrampolineMemoryChunk>;
   absl::flat_hash_map<AddressRange, TrampolineMemoryChunks> trampolines_for_modules_;
+  // Trampolines that are available before the first unused one of the last chunk of a module:
+  // trampolines that were released, and the ones left in a chunk when a new one was allocated.
+  absl::flat_hash_map<AddressRange, std::vector<uint64_t>> released_trampolines_for_modules_;
 
   // When instrumenting a function we record the address here. This is used when we uninstrument: we
   // look up the original bytes in `trampoline_map_` above.
@@ -495,39 +538,17 @@ ErrorMessageOr<InstrumentationManager::InstrumentationResult>
 InstrumentedProcess::InstrumentFunctions(const CaptureOptions& capture_options,
                                          absl::Span<const ModuleInfo> modules) {
   ORBIT_LOG("Instrumenting functions in process %d", pid_);
-  OUTCOME_TRY(AttachAndStopProcess(pid_));
-  orbit_base::unique_resource detach_on_exit{pid_, [](int32_t pid) {
-                                               if (DetachAndContinueProcess(pid).has_error()) {
-                                                 ORBIT_ERROR("Detaching from %i", pid);
-                                               }
-                                             }};
-
-  if (AnyThreadIsInStrictSeccompMode(pid_)) {
-    return ErrorMessage("At least one thread of the target process is in strict seccomp mode.");
-  }
-
-  // Init Capstone disassembler.
-  csh capstone_handle = 0;
-  cs_err error_code = cs_open(CS_ARCH_X86, CS_MODE_64, &capstone_handle);
-  if (error_code != CS_ERR_OK) {
-    return ErrorMessage("Failed to open Capstone disassembler.");
-  }
-  error_code = cs_option(capstone_handle, CS_OPT_DETAIL, CS_OPT_ON);
-  if (error_code != CS_ERR_OK) {
-    return ErrorMessage("Failed to configure Capstone disassembler.");
-  }
-  orbit_base::unique_resource close_on_exit{
-      &capstone_handle, [](csh* capstone_handle) { cs_close(capstone_handle); }};
-
-  const uint64_t now = orbit_base::CaptureTimestampNs();
-  ORBIT_LOG("Calling StartNewCapture at timestamp %d", now);
-  OUTCOME_TRY(
-      ExecuteInProcess(pid_, absl::bit_cast<void*>(start_new_capture_function_address_), now));
-
-  OUTCOME_TRY(EnsureTrampolinesWritable());
-
   ORBIT_LOG("Trying to instrument %d functions", capture_options.instrumented_functions().size());
   InstrumentationManager::InstrumentationResult result;
+
+  struct FunctionToInstrument {
+    uint64_t function_id = 0;
+    std::string_view function_name;
+    uint64_t function_address = 0;
+  };
+  std::vector<FunctionToInstrument> functions_to_instrument;
+  std::vector<NewTrampoline> new_trampolines;
+  absl::flat_hash_set<uint64_t> addresses_of_new_trampolines;
   absl::flat_hash_map<std::string, std::vector<ModuleInfo>> cache_of_modules_from_path;
   for (const auto& function : capture_options.instrumented_functions()) {
     const uint64_t function_id = function.function_id();
@@ -554,89 +575,274 @@ InstrumentedProcess::InstrumentFunctions(const CaptureOptions& capture_options,
       const uint64_t function_address = orbit_module_utils::SymbolVirtualAddressToAbsoluteAddress(
           function.function_virtual_address(), module.address_start(), module.load_bias(),
           module.executable_segment_offset());
-      if (!trampoline_map_.contains(function_address)) {
-        const AddressRange module_address_range(module.address_start(), module.address_end());
-        auto trampoline_address_or_error = GetTrampolineMemory(module_address_range);
-        if (trampoline_address_or_error.has_error()) {
-          ORBIT_ERROR("Failed to allocate memory for trampoline: %s",
-                      trampoline_address_or_error.error().message());
-          continue;
-        }
-        const uint64_t trampoline_address = trampoline_address_or_error.value();
-        // We need the machine code of the function for two purposes: We need to relocate the
-        // instructions that get overwritten into the trampoline and we also need to check if the
-        // function contains a jump back into the first five bytes (which would prohibit
-        // instrumentation). For the first reason 20 bytes would be enough; the 200 is chosen
-        // somewhat arbitrarily to cover all cases of jumps into the first five bytes we encountered
-        // in the wild. Specifically this covers all relative jumps to a signed 8 bit offset.
-        // Compare the comment of CheckForRelativeJumpIntoFirstFiveBytes in Trampoline.cpp.
-        constexpr uint64_t kMaxFunctionReadSize = 200;
-        const uint64_t function_read_size =
-            std::min(kMaxFunctionReadSize, function.function_size());
-        OUTCOME_TRY(auto&& function_data,
-                    ReadTraceesMemory(pid_, function_address, function_read_size));
-        auto address_after_prologue_or_error =
-            CreateTrampoline(pid_, function_address, function_data, trampoline_address,
-                             entry_payload_function_address_, return_trampoline_address_,
-                             capstone_handle, relocation_map_);
-        if (address_after_prologue_or_error.has_error()) {
+      functions_to_instrument.push_back({function_id, function.function_name(), function_address});
+      if (!trampoline_map_.contains(function_address) &&
+          addresses_of_new_trampolines.insert(function_address).second) {
+        new_trampolines.push_back({function_address, function.function_size(),
+                                   AddressRange(module.address_start(), module.address_end())});
+      }
+    }
+  }
+
+  OUTCOME_TRY(auto&& trampoline_error_messages,
+              CreateTrampolines(new_trampolines, result.stop_the_world_duration));
+
+  // Only patching the functions happens while the process is stopped. The scope makes sure that we
+  // have detached, and counted the time the process was stopped, before returning the result.
+  {
+    const absl::Time stop_time = absl::Now();
+    OUTCOME_TRY(AttachAndStopProcess(pid_));
+    orbit_base::unique_resource detach_on_exit{
+        pid_, [&result, stop_time](int32_t pid) {
+          if (DetachAndContinueProcess(pid).has_error()) {
+            ORBIT_ERROR("Detaching from %i", pid);
+          }
+          result.stop_the_world_duration += absl::Now() - stop_time;
+        }};
+
+    if (AnyThreadIsInStrictSeccompMode(pid_)) {
+      return ErrorMessage("At least one thread of the target process is in strict seccomp mode.");
+    }
+
+    const uint64_t now = orbit_base::CaptureTimestampNs();
+    ORBIT_LOG("Calling StartNewCapture at timestamp %d", now);
+    OUTCOME_TRY(
+        ExecuteInProcess(pid_, absl::bit_cast<void*>(start_new_capture_function_address_), now));
+
+    // The function ids are written into the trampolines and the jumps into the code of the
+    // functions. `WriteTraceesMemoryRanges` can't use the same system calls for both, hence the two
+    // batches.
+    std::vector<const FunctionToInstrument*> functions_with_writes;
+    std::vector<TraceesMemoryWrite> function_id_writes;
+    std::vector<TraceesMemoryWrite> jump_writes;
+    for (const FunctionToInstrument& function : functions_to_instrument) {
+      auto it = trampoline_map_.find(function.function_address);
+      if (it == trampoline_map_.end()) {
+        auto error_message_it = trampoline_error_messages.find(function.function_address);
+        if (error_message_it != trampoline_error_messages.end()) {
           const std::string message = absl::StrFormat(
               "Can't instrument function \"%s\". Failed to create trampoline: %s",
-              function.function_name(), address_after_prologue_or_error.error().message());
+              function.function_name, error_message_it->second);
           ORBIT_ERROR("%s", message);
-          result.function_ids_to_error_messages[function_id] = message;
-          OUTCOME_TRY(ReleaseMostRecentlyAllocatedTrampolineMemory(module_address_range));
-          continue;
+          result.function_ids_to_error_messages[function.function_id] = message;
         }
-        TrampolineData trampoline_data;
-        trampoline_data.trampoline_address = trampoline_address;
-        // We'll overwrite the first five bytes of the function and the rest of the instruction that
-        // we clobbered. Since we'll need to restore that when we remove the instrumentation we need
-        // a backup.
-        constexpr uint64_t kMaxFunctionBackupSize = 20;
-        const uint64_t function_backup_size =
-            std::min(kMaxFunctionBackupSize, function.function_size());
-        OUTCOME_TRY(auto&& function_backup_data,
-                    ReadTraceesMemory(pid_, function_address, function_backup_size));
-        trampoline_data.function_data = function_backup_data;
-        trampoline_data.address_after_prologue = address_after_prologue_or_error.value();
-        trampoline_map_.emplace(function_address, trampoline_data);
-      }
-      auto it = trampoline_map_.find(function_address);
-      if (it == trampoline_map_.end()) {
         continue;
       }
       const TrampolineData& trampoline_data = it->second;
 
-      auto result_or_error = InstrumentFunction(pid_, function_address, function_id,
-                                                trampoline_data.address_after_prologue,
-                                                trampoline_data.trampoline_address);
-      if (result_or_error.has_error()) {
+      auto writes_or_error = GetWritesToInstrumentFunction(
+          function.function_address, function.function_id, trampoline_data.address_after_prologue,
+          trampoline_data.trampoline_address);
+      if (writes_or_error.has_error()) {
         const std::string message =
-            absl::StrFormat("Can't instrument function \"%s\": %s", function.function_name(),
-                            result_or_error.error().message());
+            absl::StrFormat("Can't instrument function \"%s\": %s", function.function_name,
+                            writes_or_error.error().message());
         ORBIT_ERROR("%s", message);
-        result.function_ids_to_error_messages[function_id] = message;
-      } else {
-        addresses_of_instrumented_functions_.insert(function_address);
-        result.instrumented_function_ids.insert(function_id);
+        result.function_ids_to_error_messages[function.function_id] = message;
+        continue;
       }
+      functions_with_writes.push_back(&function);
+      function_id_writes.push_back(std::move(writes_or_error.value()[0]));
+      jump_writes.push_back(std::move(writes_or_error.value()[1]));
     }
-  }
-  ORBIT_LOG("Successfully instrumented %d functions", result.instrumented_function_ids.size());
 
-  result.entry_trampoline_address_ranges = GetEntryTrampolineAddressRanges();
-  result.return_trampoline_address_range = AddressRange{
-      return_trampoline_address_, return_trampoline_address_ + GetReturnTrampolineSize()};
-  result.injected_library_path = injected_library_path_;
+    ErrorMessageOr<void> batched_write_result = WriteTraceesMemoryRanges(pid_, function_id_writes);
+    if (!batched_write_result.has_error()) {
+      batched_write_result = WriteTraceesMemoryRanges(pid_, jump_writes);
+    }
+    if (batched_write_result.has_error()) {
+      ORBIT_ERROR("Instrumenting all functions at once failed, retrying one by one: %s",
+                  batched_write_result.error().message());
+    }
+    for (const FunctionToInstrument* function : functions_with_writes) {
+      if (batched_write_result.has_error()) {
+        // Instrumenting the functions one by one tells us which ones failed.
+        const TrampolineData& trampoline_data = trampoline_map_.at(function->function_address);
+        auto result_or_error = InstrumentFunction(
+            pid_, function->function_address, function->function_id,
+            trampoline_data.address_after_prologue, trampoline_data.trampoline_address);
+        if (result_or_error.has_error()) {
+          const std::string message =
+              absl::StrFormat("Can't instrument function \"%s\": %s", function->function_name,
+                              result_or_error.error().message());
+          ORBIT_ERROR("%s", message);
+          result.function_ids_to_error_messages[function->function_id] = message;
+          continue;
+        }
+      }
+      addresses_of_instrumented_functions_.insert(function->function_address);
+      result.instrumented_function_ids.insert(function->function_id);
+    }
+    ORBIT_LOG("Successfully instrumented %d functions", result.instrumented_function_ids.size());
 
-  MoveInstructionPointersOutOfOverwrittenCode(pid_, relocation_map_);
+    result.entry_trampoline_address_ranges = GetEntryTrampolineAddressRanges();
+    result.return_trampoline_address_range = AddressRange{
+        return_trampoline_address_, return_trampoline_address_ + GetReturnTrampolineSize()};
+    result.injected_library_path = injected_library_path_;
 
-  OUTCOME_TRY(EnsureTrampolinesExecutable());
+    MoveInstructionPointersOutOfOverwrittenCode(pid_, relocation_map_);
+
+    OUTCOME_TRY(EnsureTrampolinesExecutable());
+  }
 
   return result;
 }
 
+ErrorMessageOr<absl::flat_hash_map<uint64_t, std::string>> InstrumentedProcess::CreateTrampolines(
+    absl::Span<const NewTrampoline> new_trampolines, absl::Duration& stop_the_world_duration) {
+  absl::flat_hash_map<uint64_t, std::string> error_messages;
+  if (new_trampolines.empty()) return error_messages;
+
+  // We need the machine code of the function for two purposes: We need to relocate the
+  // instructions that get overwritten into the trampoline and we also need to check if the
+  // function contains a jump back into the first five bytes (which would prohibit
+  // instrumentation). For the first reason 20 bytes would be enough; the 200 is chosen
+  // somewhat arbitrarily to cover all cases of jumps into the first five bytes we encountered
+  // in the wild. Specifically this covers all relative jumps to a signed 8 bit offset.
+  // Compare the comment of CheckForRelativeJumpIntoFirstFiveBytes in Trampoline.cpp.
+  constexpr uint64_t kMaxFunctionReadSize = 200;
+  std::vector<AddressRange> function_address_ranges;
+  function_address_ranges.reserve(new_trampolines.size());
+  for (const NewTrampoline& new_trampoline : new_trampolines) {
+    function_address_ranges.emplace_back(
+        new_trampoline.function_address,
+        new_trampoline.function_address +
+            std::min(kMaxFunctionReadSize, new_trampoline.function_size));
+  }
+  OUTCOME_TRY(auto&& functions_data, ReadTraceesMemoryRanges(pid_, function_address_ranges));
+
+  // Allocating memory in the tracee requires stopping it, hence we allocate the memory for all the
+  // trampolines at once, and only if there is not enough left.
+  absl::flat_hash_map<AddressRange, uint64_t> trampoline_counts_for_modules;
+  for (const NewTrampoline& new_trampoline : new_trampolines) {
+    ++trampoline_counts_for_modules[new_trampoline.module_address_range];
+  }
+  absl::flat_hash_map<AddressRange, std::string> allocation_error_messages_for_modules;
+  if (std::any_of(trampoline_counts_for_modules.begin(), trampoline_counts_for_modules.end(),
+                  [this](const auto& module_address_range_and_trampoline_count) {
+                    const auto& [module_address_range, trampoline_count] =
+                        module_address_range_and_trampoline_count;
+                    return trampoline_count > GetNumberOfAvailableTrampolines(module_address_range);
+                  })) {
+    const absl::Time stop_time = absl::Now();
+    OUTCOME_TRY(AttachAndStopProcess(pid_));
+    orbit_base::unique_resource detach_on_exit{
+        pid_, [&stop_the_world_duration, stop_time](int32_t pid) {
+          if (DetachAndContinueProcess(pid).has_error()) {
+            ORBIT_ERROR("Detaching from %i", pid);
+          }
+          stop_the_world_duration += absl::Now() - stop_time;
+        }};
+
+    if (AnyThreadIsInStrictSeccompMode(pid_)) {
+      return ErrorMessage("At least one thread of the target process is in strict seccomp mode.");
+    }
+
+    for (const auto& [module_address_range, trampoline_count] : trampoline_counts_for_modules) {
+      auto allocation_result = EnsureTrampolinesAvailable(module_address_range, trampoline_count);
+      if (allocation_result.has_error()) {
+        ORBIT_ERROR("Failed to allocate memory for trampoline: %s",
+                    allocation_result.error().message());
+        allocation_error_messages_for_modules.emplace(
+            module_address_range,
+            absl::StrFormat("Failed to allocate memory: %s", allocation_result.error().message()));
+      }
+    }
+  }
+
+  // A trampoline address of zero means that no memory could be allocated.
+  std::vector<uint64_t> trampoline_addresses(new_trampolines.size(), 0);
+  for (size_t i = 0; i < new_trampolines.size(); ++i) {
+    const NewTrampoline& new_trampoline = new_trampolines[i];
+    auto error_message_it =
+        allocation_error_messages_for_modules.find(new_trampoline.module_address_range);
+    if (error_message_it != allocation_error_messages_for_modules.end()) {
+      error_messages.emplace(new_trampoline.function_address, error_message_it->second);
+      continue;
+    }
+    trampoline_addresses[i] = GetTrampolineMemory(new_trampoline.module_address_range);
+  }
+
+  // A Capstone handle must not be used by more than one thread at a time, hence every task gets its
+  // own handle, and its own relocation map.
+  constexpr size_t kTrampolinesPerTask = 256;
+  const size_t task_count =
+      (new_trampolines.size() + kTrampolinesPerTask - 1) / kTrampolinesPerTask;
+  std::vector<csh> capstone_handles;
+  orbit_base::unique_resource close_on_exit{&capstone_handles,
+                                            [](std::vector<csh>* capstone_handles) {
+                                              for (csh& capstone_handle : *capstone_handles) {
+                                                cs_close(&capstone_handle);
+                                              }
+                                            }};
+  for (size_t task_index = 0; task_index < task_count; ++task_index) {
+    OUTCOME_TRY(auto&& capstone_handle, OpenCapstoneDisassembler());
+    capstone_handles.push_back(capstone_handle);
+  }
+  std::vector<absl::flat_hash_map<uint64_t, uint64_t>> relocation_maps(task_count);
+  std::vector<std::optional<ErrorMessageOr<AssembledTrampoline>>> assembled_trampolines(
+      new_trampolines.size());
+  (void)orbit_base::ParallelFor(
+      orbit_base::ThreadPool::GetDefaultThreadPool(), task_count,
+      [&](size_t task_index) {
+        const size_t end =
+            std::min(new_trampolines.size(), (task_index + 1) * kTrampolinesPerTask);
+        for (size_t i = task_index * kTrampolinesPerTask; i < end; ++i) {
+          if (trampoline_addresses[i] == 0) continue;
+          assembled_trampolines[i] = AssembleTrampoline(
+              new_trampolines[i].function_address, functions_data[i], trampoline_addresses[i],
+              entry_payload_function_address_, return_trampoline_address_,
+              capstone_handles[task_index], relocation_maps[task_index]);
+        }
+      },
+      orbit_base::ParallelForOptions{/*grain_size=*/1});
+  for (const absl::flat_hash_map<uint64_t, uint64_t>& relocation_map : relocation_maps) {
+    relocation_map_.insert(relocation_map.begin(), relocation_map.end());
+  }
+
+  std::vector<TraceesMemoryWrite> trampoline_writes;
+  std::vector<std::pair<uint64_t, TrampolineData>> new_trampoline_data;
+  for (size_t i = 0; i < new_trampolines.size(); ++i) {
+    if (trampoline_addresses[i] == 0) continue;
+    const NewTrampoline& new_trampoline = new_trampolines[i];
+    ErrorMessageOr<AssembledTrampoline>& assembled_trampoline = assembled_trampolines[i].value();
+    if (assembled_trampoline.has_error()) {
+      error_messages.emplace(new_trampoline.function_address,
+                             assembled_trampoline.error().message());
+      ReleaseTrampolineMemory(new_trampoline.module_address_range, trampoline_addresses[i]);
+      continue;
+    }
+    TrampolineData trampoline_data;
+    trampoline_data.trampoline_address = trampoline_addresses[i];
+    // We'll overwrite the first five bytes of the function and the rest of the instruction that
+    // we clobbered. Since we'll need to restore that when we remove the instrumentation we need
+    // a backup.
+    constexpr uint64_t kMaxFunctionBackupSize = 20;
+    const std::vector<uint8_t>& function_data = functions_data[i];
+    trampoline_data.function_data.assign(
+        function_data.begin(),
+        function_data.begin() + std::min<uint64_t>(kMaxFunctionBackupSize, function_data.size()));
+    trampoline_data.address_after_prologue = assembled_trampoline.value().address_after_prologue;
+    trampoline_writes.push_back(
+        {trampoline_addresses[i], std::move(assembled_trampoline.value().code)});
+    new_trampoline_data.emplace_back(new_trampoline.function_address, std::move(trampoline_data));
+  }
+
+  // Nothing jumps into the new trampolines yet, so they can be written while the process runs.
+  auto write_result = WriteTraceesMemoryRanges(pid_, trampoline_writes);
+  if (write_result.has_error()) {
+    for (size_t i = 0; i < new_trampolines.size(); ++i) {
+      if (trampoline_addresses[i] == 0 || assembled_trampolines[i].value().has_error()) continue;
+      ReleaseTrampolineMemory(new_trampolines[i].module_address_range, trampoline_addresses[i]);
+    }
+    return ErrorMessage(
+        absl::StrFormat("Failed to write trampolines: %s", write_result.error().message()));
+  }
+  trampoline_map_.insert(std::make_move_iterator(new_trampoline_data.begin()),
+                         std::make_move_iterator(new_trampoline_data.end()));
+  return error_messages;
+}
+
 ErrorMessageOr<void> InstrumentedProcess::UninstrumentFunctions() {
   OUTCOME_TRY(AttachAndStopProcess(pid_));
   orbit_base::unique_resource detach_on_exit{pid_, [](int32_t pid) {
@@ -644,6 +850,7 @@ ErrorMessageOr<void> InstrumentedProcess::UninstrumentFunctions() {
                                                  ORBIT_ERROR("Detaching from %i", pid);
                                                }
                                              }};
+  std::vector<TraceesMemoryWrite> writes;
   for (uint64_t function_address : addresses_of_instrumented_functions_) {
     auto it = trampoline_map_.find(function_address);
     // Skip if this function was not instrumented.
@@ -652,48 +859,72 @@ ErrorMessageOr<void> InstrumentedProcess::UninstrumentFunctions() {
     std::vector<uint8_t> code(trampoline_data.function_data.begin(),
                               trampoline_data.function_data.begin() +
                                   (trampoline_data.address_after_prologue - function_address));
-    auto write_result_or_error = WriteTraceesMemory(pid_, function_address, code);
-    ORBIT_FAIL_IF(write_result_or_error.has_error(), "%s", write_result_or_error.error().message());
+    writes.push_back({function_address, std::move(code)});
   }
+  auto write_result_or_error = WriteTraceesMemoryRanges(pid_, writes);
+  ORBIT_FAIL_IF(write_result_or_error.has_error(), "%s", write_result_or_error.error().message());
   return outcome::success();
 }
 
-ErrorMessageOr<uint64_t> InstrumentedProcess::GetTrampolineMemory(AddressRange address_range) {
-  if (!trampolines_for_modules_.contains(address_range)) {
-    trampolines_for_modules_.emplace(address_range, TrampolineMemoryChunks());
+uint64_t InstrumentedProcess::GetNumberOfAvailableTrampolines(
+    AddressRange address_range) const {
+  uint64_t result = 0;
+  auto released_trampolines_it = released_trampolines_for_modules_.find(address_range);
+  if (released_trampolines_it != released_trampolines_for_modules_.end()) {
+    result += released_trampolines_it->second.size();
   }
-  auto it = trampolines_for_modules_.find(address_range);
-  TrampolineMemoryChunks& trampoline_memory_chunks = it->second;
-  if (trampoline_memory_chunks.empty() ||
-      trampoline_memory_chunks.back().first_available == kTrampolinesPerChunk) {
+  auto trampoline_memory_chunks_it = trampolines_for_modules_.find(address_range);
+  if (trampoline_memory_chunks_it != trampolines_for_modules_.end() &&
+      !trampoline_memory_chunks_it->second.empty()) {
+    result += kTrampolinesPerChunk - trampoline_memory_chunks_it->second.back().first_available;
+  }
+  return result;
+}
+
+ErrorMessageOr<void> InstrumentedProcess::EnsureTrampolinesAvailable(AddressRange address_range,
+                                                                      uint64_t trampoline_count) {
+  while (GetNumberOfAvailableTrampolines(address_range) < trampoline_count) {
     OUTCOME_TRY(auto&& trampoline_memory,
                 AllocateMemoryForTrampolines(pid_, address_range,
                                              kTrampolinesPerChunk * GetMaxTrampolineSize()));
-
+    TrampolineMemoryChunks& trampoline_memory_chunks = trampolines_for_modules_[address_range];
+    // Only the last chunk hands out trampolines, so keep the ones left in the previous chunk.
+    if (!trampoline_memory_chunks.empty()) {
+      std::vector<uint64_t>& released_trampolines =
+          released_trampolines_for_modules_[address_range];
+      TrampolineMemoryChunk& previous_chunk = trampoline_memory_chunks.back();
+      for (; previous_chunk.first_available < kTrampolinesPerChunk;
+           ++previous_chunk.first_available) {
+        released_trampolines.push_back(previous_chunk.memory->GetAddress() +
+                                       previous_chunk.first_available * GetMaxTrampolineSize());
+      }
+    }
     trampoline_memory_chunks.emplace_back(std::move(trampoline_memory), 0);
   }
-  const uint64_t result = trampoline_memory_chunks.back().memory->GetAddress() +
-                          trampoline_memory_chunks.back().first_available * GetMaxTrampolineSize();
-  trampoline_memory_chunks.back().first_available++;
-  return result;
+  return outcome::success();
 }
 
-ErrorMessageOr<void> InstrumentedProcess::ReleaseMostRecentlyAllocatedTrampolineMemory(
-    AddressRange address_range) {
-  if (!trampolines_for_modules_.contains(address_range)) {
-    return ErrorMessage("Tried to release trampoline memory for a non existent address range");
+uint64_t InstrumentedProcess::GetTrampolineMemory(AddressRange address_range) {
+  auto released_trampolines_it = released_trampolines_for_modules_.find(address_range);
+  if (released_trampolines_it != released_trampolines_for_modules_.end() &&
+      !released_trampolines_it->second.empty()) {
+    const uint64_t result = released_trampolines_it->second.back();
+    released_trampolines_it->second.pop_back();
+    return result;
   }
-  trampolines_for_modules_.find(address_range)->second.back().first_available--;
-  return outcome::success();
+  auto it = trampolines_for_modules_.find(address_range);
+  ORBIT_CHECK(it != trampolines_for_modules_.end() && !it->second.empty());
+  TrampolineMemoryChunk& trampoline_memory_chunk = it->second.back();
+  ORBIT_CHECK(trampoline_memory_chunk.first_available < kTrampolinesPerChunk);
+  const uint64_t result = trampoline_memory_chunk.memory->GetAddress() +
+                          trampoline_memory_chunk.first_available * GetMaxTrampolineSize();
+  trampoline_memory_chunk.first_available++;
+  return result;
 }
 
-ErrorMessageOr<void> InstrumentedProcess::EnsureTrampolinesWritable() {
-  for (auto& trampoline_for_module : trampolines_for_modules_) {
-    for (auto& memory_chunk : trampoline_for_module.second) {
-      OUTCOME_TRY(memory_chunk.memory->EnsureMemoryWritable());
-    }
-  }
-  return outcome::success();
+void InstrumentedProcess::ReleaseTrampolineMemory(AddressRange address_range,
+                                                  uint64_t trampoline_address) {
+  released_trampolines_for_modules_[address_range].push_back(trampoline_address);
 }
 
 ErrorMessageOr<void> InstrumentedProcess::EnsureTrampolinesExecutable() {
@@ -4,14 +4,23 @@
 
 #include "OrbitUserSpaceInstrumentation.h"
 
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <absl/synchronization/mutex.h>
 #include <google/protobuf/arena.h>
 
 #include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
 #include <stack>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #include "CaptureEventProducer/LockFreeBufferCaptureEventProducer.h"
+#include "FunctionCallStatistics.h"
 #include "GrpcProtos/capture.pb.h"
 #include "OrbitBase/Overloaded.h"
 #include "OrbitBase/Profiling.h"
@@ -19,19 +28,30 @@
 #include "ProducerSideChannel/ProducerSideChannel.h"
 
 using orbit_base::CaptureTimestampNs;
+using orbit_user_space_instrumentation::FunctionCallStatistics;
 
 namespace {
 
+// Value of OpenFunctionCall::aggregated_function_id for the calls that produce a FunctionEntry and
+// a FunctionExit event.
+constexpr uint64_t kCallIsNotAggregated = std::numeric_limits<uint64_t>::max();
+
 struct OpenFunctionCall {
-  OpenFunctionCall(uint64_t return_address, uint64_t timestamp_on_entry_ns)
-      : return_address(return_address), timestamp_on_entry_ns(timestamp_on_entry_ns) {}
+  OpenFunctionCall(uint64_t return_address, uint64_t timestamp_on_entry_ns,
+                   uint64_t aggregated_function_id)
+      : return_address(return_address),
+        timestamp_on_entry_ns(timestamp_on_entry_ns),
+        aggregated_function_id(aggregated_function_id) {}
   uint64_t return_address;
   uint64_t timestamp_on_entry_ns;
+  // Whether the call is aggregated is decided on entry, so that the exit matches it even if the set
+  // of aggregated functions changes in between.
+  uint64_t aggregated_function_id;
 };
 
 // The amount of data we store for each call is relevant for the overall performance. The assert is
 // here for awareness and to avoid packing issues in the struct.
-static_assert(sizeof(OpenFunctionCall) == 16, "OpenFunctionCall should be 16 bytes.");
+static_assert(sizeof(OpenFunctionCall) == 24, "OpenFunctionCall should be 24 bytes.");
 
 std::stack<OpenFunctionCall>& GetOpenFunctionCallStack() {
   thread_local std::stack<OpenFunctionCall> open_function_calls;
@@ -73,14 +93,41 @@ struct FunctionExit {
   uint64_t timestamp_ns;
 };
 
-using FunctionEntryExitVariant = std::variant<FunctionEntry, FunctionExit>;
+struct FunctionCallSummary {
+  uint32_t pid;
+  uint32_t tid;
+  uint64_t function_id;
+  FunctionCallStatistics statistics;
+};
+
+// FunctionCallSummary is much larger than FunctionEntry and FunctionExit, and much less frequent.
+// Hold it by pointer so that it doesn't increase the size of every slot of the event buffers.
+using UserSpaceInstrumentationEventVariant =
+    std::variant<FunctionEntry, FunctionExit, std::unique_ptr<FunctionCallSummary>>;
+
+// The calls of functions with `aggregate_calls` that ended on one thread and haven't been sent yet.
+// The thread itself adds calls and periodically sends them, while the remaining calls of all
+// threads are sent when the capture is stopped, hence the mutex.
+struct AggregatedFunctionCallsOfThread {
+  explicit AggregatedFunctionCallsOfThread(uint32_t tid) : tid{tid} {}
+
+  const uint32_t tid;
+  absl::Mutex mutex;
+  uint64_t capture_generation ABSL_GUARDED_BY(mutex) = 0;
+  uint64_t last_send_timestamp_ns ABSL_GUARDED_BY(mutex) = 0;
+  absl::flat_hash_map<uint64_t, FunctionCallStatistics> statistics_by_function_id
+      ABSL_GUARDED_BY(mutex);
+};
 
 // This class is used to enqueue FunctionEntry and FunctionExit events from multiple threads,
 // transform them into orbit_grpc_protos::FunctionEntry and orbit_grpc_protos::FunctionExit protos,
 // and relay them to OrbitService.
+//
+// For the functions instrumented with `aggregate_calls`, it instead accumulates the calls in
+// per-thread statistics, and periodically sends them as orbit_grpc_protos::FunctionCallSummary.
 class LockFreeUserSpaceInstrumentationEventProducer
     : public orbit_capture_event_producer::LockFreeBufferCaptureEventProducer<
-          FunctionEntryExitVariant> {
+          UserSpaceInstrumentationEventVariant> {
  public:
   LockFreeUserSpaceInstrumentationEventProducer() {
     BuildAndStart(orbit_producer_side_channel::CreateProducerSideChannel());
@@ -88,9 +135,105 @@ class LockFreeUserSpaceInstrumentationEventProducer
 
   ~LockFreeUserSpaceInstrumentationEventProducer() override { ShutdownAndWait(); }
 
+  // Returns whether the calls of the function are aggregated in the current capture. Wait-free,
+  // except for the first call on each thread after a capture has started.
+  [[nodiscard]] bool IsAggregatedFunction(uint64_t function_id) {
+    struct AggregatedFunctionIdsOfThisThread {
+      uint64_t capture_generation = 0;
+      std::shared_ptr<const absl::flat_hash_set<uint64_t>> function_ids;
+    };
+    thread_local AggregatedFunctionIdsOfThisThread aggregated_function_ids_of_this_thread;
+
+    if (aggregated_function_ids_of_this_thread.capture_generation !=
+        capture_generation_.load(std::memory_order_acquire)) {
+      absl::MutexLock lock{&aggregated_function_ids_mutex_};
+      aggregated_function_ids_of_this_thread.function_ids = aggregated_function_ids_;
+      aggregated_function_ids_of_this_thread.capture_generation =
+          capture_generation_.load(std::memory_order_relaxed);
+    }
+    return aggregated_function_ids_of_this_thread.function_ids != nullptr &&
+           aggregated_function_ids_of_this_thread.function_ids->contains(function_id);
+  }
+
+  // Adds the call to the statistics of the calling thread, and sends them if enough time has
+  // passed since they were last sent, or if the capture was stopped in the meantime.
+  // This runs on every exit of an aggregated function. The mutex of the thread is only contended
+  // while OnCaptureStop collects the remaining statistics, so it costs an uncontended lock and
+  // unlock, i.e., two atomic read-modify-write operations. That is about as much as reading the
+  // clock for the timestamp of the exit. Swapping per-thread buffers instead wouldn't be cheaper,
+  // as OnCaptureStop would still need such an operation to know when a thread is done with a
+  // buffer.
+  void AggregateFunctionCall(uint64_t function_id, uint64_t timestamp_on_entry_ns,
+                             uint64_t timestamp_on_exit_ns) {
+    AggregatedFunctionCallsOfThread& calls = GetAggregatedFunctionCallsOfThisThread();
+    const uint64_t capture_generation = capture_generation_.load(std::memory_order_relaxed);
+
+    absl::MutexLock lock{&calls.mutex};
+    if (calls.capture_generation != capture_generation) {
+      // Whatever is left belongs to a previous capture.
+      for (auto& [unused_function_id, statistics] : calls.statistics_by_function_id) {
+        statistics.Reset();
+      }
+      calls.capture_generation = capture_generation;
+      calls.last_send_timestamp_ns = timestamp_on_exit_ns;
+    }
+
+    calls.statistics_by_function_id[function_id].AddCall(timestamp_on_entry_ns,
+                                                          timestamp_on_exit_ns);
+
+    // This call passed IsCapturing(), but if OnCaptureStop has already sent what this thread had
+    // accumulated, nothing would send this call. As OnCaptureStop sets stopped_capture_generation_
+    // before taking the mutex of any thread, it is visible here in that case.
+    if (stopped_capture_generation_.load(std::memory_order_acquire) == capture_generation ||
+        timestamp_on_exit_ns - calls.last_send_timestamp_ns >= kSendAggregatedCallsIntervalNs) {
+      EnqueueAndResetStatistics(calls);
+      calls.last_send_timestamp_ns = timestamp_on_exit_ns;
+    }
+  }
+
  protected:
+  void OnCaptureStart(orbit_grpc_protos::CaptureOptions capture_options) override {
+    auto aggregated_function_ids = std::make_shared<absl::flat_hash_set<uint64_t>>();
+    for (const orbit_grpc_protos::InstrumentedFunction& function :
+         capture_options.instrumented_functions()) {
+      if (function.aggregate_calls()) aggregated_function_ids->insert(function.function_id());
+    }
+    {
+      absl::MutexLock lock{&aggregated_function_ids_mutex_};
+      aggregated_function_ids_ = std::move(aggregated_function_ids);
+      capture_generation_.fetch_add(1, std::memory_order_release);
+    }
+
+    LockFreeBufferCaptureEventProducer::OnCaptureStart(std::move(capture_options));
+  }
+
+  void OnCaptureStop() override {
+    // IsCapturing() is already false, so no new calls are aggregated. Send what the threads have
+    // accumulated since they last sent their statistics, including threads that have exited. Calls
+    // that are still being aggregated are sent by AggregateFunctionCall itself.
+    {
+      absl::MutexLock lock{&aggregated_calls_of_threads_mutex_};
+      const uint64_t capture_generation = capture_generation_.load(std::memory_order_relaxed);
+      stopped_capture_generation_.store(capture_generation, std::memory_order_release);
+      for (const std::shared_ptr<AggregatedFunctionCallsOfThread>& calls :
+           aggregated_calls_of_threads_) {
+        absl::MutexLock calls_lock{&calls->mutex};
+        if (calls->capture_generation == capture_generation) EnqueueAndResetStatistics(*calls);
+      }
+      // Only this list still refers to the statistics of threads that have exited.
+      aggregated_calls_of_threads_.erase(
+          std::remove_if(aggregated_calls_of_threads_.begin(), aggregated_calls_of_threads_.end(),
+                         [](const std::shared_ptr<AggregatedFunctionCallsOfThread>& calls) {
+                           return calls.use_count() == 1;
+                         }),
+          aggregated_calls_of_threads_.end());
+    }
+
+    LockFreeBufferCaptureEventProducer::OnCaptureStop();
+  }
+
   [[nodiscard]] orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
-      FunctionEntryExitVariant&& raw_event, google::protobuf::Arena* arena) override {
+      UserSpaceInstrumentationEventVariant&& raw_event, google::protobuf::Arena* arena) override {
     auto* capture_event =
         google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
 
@@ -111,6 +254,11 @@ class LockFreeUserSpaceInstrumentationEventProducer
                                  function_exit->set_pid(raw_event.pid);
                                  function_exit->set_tid(raw_event.tid);
                                  function_exit->set_timestamp_ns(raw_event.timestamp_ns);
+                               },
+                               [capture_event](
+                                   const std::unique_ptr<FunctionCallSummary>& raw_event) -> void {
+                                 TranslateFunctionCallSummary(
+                                     *raw_event, capture_event->mutable_function_call_summary());
                                }},
         raw_event);
 
@@ -118,6 +266,67 @@ class LockFreeUserSpaceInstrumentationEventProducer
   }
 
  private:
+  static constexpr uint64_t kSendAggregatedCallsIntervalNs = 100'000'000;
+
+  static void TranslateFunctionCallSummary(const FunctionCallSummary& raw_event,
+                                           orbit_grpc_protos::FunctionCallSummary* summary) {
+    const FunctionCallStatistics& statistics = raw_event.statistics;
+    summary->set_pid(raw_event.pid);
+    summary->set_tid(raw_event.tid);
+    summary->set_function_id(raw_event.function_id);
+    summary->set_start_timestamp_ns(statistics.start_timestamp_ns());
+    summary->set_end_timestamp_ns(statistics.end_timestamp_ns());
+    summary->set_call_count(statistics.call_count());
+    summary->set_total_duration_ns(statistics.total_duration_ns());
+    summary->set_min_duration_ns(statistics.min_duration_ns());
+    summary->set_max_duration_ns(statistics.max_duration_ns());
+    summary->set_duration_variance_ns(statistics.ComputeDurationVarianceNs());
+
+    const auto& buckets = statistics.duration_log2_histogram();
+    size_t bucket_count = buckets.size();
+    while (bucket_count > 0 && buckets[bucket_count - 1] == 0) --bucket_count;
+    summary->mutable_duration_log2_histogram()->Reserve(static_cast<int>(bucket_count));
+    for (size_t i = 0; i < bucket_count; ++i) {
+      summary->add_duration_log2_histogram(buckets[i]);
+    }
+  }
+
+  AggregatedFunctionCallsOfThread& GetAggregatedFunctionCallsOfThisThread() {
+    // The list of all threads keeps the statistics alive after the thread has exited, until the
+    // capture is stopped.
+    thread_local std::shared_ptr<AggregatedFunctionCallsOfThread> calls_of_this_thread;
+    if (calls_of_this_thread == nullptr) {
+      calls_of_this_thread =
+          std::make_shared<AggregatedFunctionCallsOfThread>(orbit_base::GetCurrentThreadId());
+      absl::MutexLock lock{&aggregated_calls_of_threads_mutex_};
+      aggregated_calls_of_threads_.push_back(calls_of_this_thread);
+    }
+    return *calls_of_this_thread;
+  }
+
+  void EnqueueAndResetStatistics(AggregatedFunctionCallsOfThread& calls)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(calls.mutex) {
+    static const uint32_t kPid = orbit_base::GetCurrentProcessId();
+    for (auto& [function_id, statistics] : calls.statistics_by_function_id) {
+      if (statistics.IsEmpty()) continue;
+      EnqueueIntermediateEvent(std::make_unique<FunctionCallSummary>(
+          FunctionCallSummary{kPid, calls.tid, function_id, statistics}));
+      statistics.Reset();
+    }
+  }
+
+  // Incremented every time a capture starts.
+  std::atomic<uint64_t> capture_generation_ = 0;
+  // The value of capture_generation_ when the last capture was stopped.
+  std::atomic<uint64_t> stopped_capture_generation_ = 0;
+  absl::Mutex aggregated_function_ids_mutex_;
+  std::shared_ptr<const absl::flat_hash_set<uint64_t>> aggregated_function_ids_
+      ABSL_GUARDED_BY(aggregated_function_ids_mutex_);
+
+  absl::Mutex aggregated_calls_of_threads_mutex_;
+  std::vector<std::shared_ptr<AggregatedFunctionCallsOfThread>> aggregated_calls_of_threads_
+      ABSL_GUARDED_BY(aggregated_calls_of_threads_mutex_);
+
   template <class>
   [[maybe_unused]] static constexpr bool kAlwaysFalseV = false;
 };
@@ -179,16 +388,21 @@ bool& GetIsInPayload() {
 
   const uint64_t timestamp_on_entry_ns = CaptureTimestampNs();
 
-  std::stack<OpenFunctionCall>& open_function_call_stack = GetOpenFunctionCallStack();
-  open_function_call_stack.emplace(return_address, timestamp_on_entry_ns);
-
+  uint64_t aggregated_function_id = kCallIsNotAggregated;
   if (GetCaptureEventProducer().IsCapturing()) {
-    static const uint32_t kPid = orbit_base::GetCurrentProcessId();
-    GetCaptureEventProducer().EnqueueIntermediateEvent(
-        FunctionEntry{kPid, orbit_base::FromNativeThreadId(kTid), function_id, stack_pointer,
-                      return_address, timestamp_on_entry_ns});
+    if (GetCaptureEventProducer().IsAggregatedFunction(function_id)) {
+      aggregated_function_id = function_id;
+    } else {
+      static const uint32_t kPid = orbit_base::GetCurrentProcessId();
+      GetCaptureEventProducer().EnqueueIntermediateEvent(
+          FunctionEntry{kPid, orbit_base::FromNativeThreadId(kTid), function_id, stack_pointer,
+                        return_address, timestamp_on_entry_ns});
+    }
   }
 
+  std::stack<OpenFunctionCall>& open_function_call_stack = GetOpenFunctionCallStack();
+  open_function_call_stack.emplace(return_address, timestamp_on_entry_ns, aggregated_function_id);
+
   // Overwrite return address so that we end up returning to the exit trampoline.
   *reinterpret_cast<uint64_t*>(stack_pointer) = return_trampoline_address;
 
@@ -208,10 +422,16 @@ bool& GetIsInPayload() {
   // this capture.
   if (GetCaptureEventProducer().IsCapturing() &&
       current_capture_start_timestamp_ns < current_function_call.timestamp_on_entry_ns) {
-    static uint32_t pid = orbit_base::GetCurrentProcessId();
-    thread_local uint32_t tid = orbit_base::GetCurrentThreadId();
-    GetCaptureEventProducer().EnqueueIntermediateEvent(
-        FunctionExit{pid, tid, timestamp_on_exit_ns});
+    if (current_function_call.aggregated_function_id != kCallIsNotAggregated) {
+      GetCaptureEventProducer().AggregateFunctionCall(current_function_call.aggregated_function_id,
+                                                      current_function_call.timestamp_on_entry_ns,
+                                                      timestamp_on_exit_ns);
+    } else {
+      static uint32_t pid = orbit_base::GetCurrentProcessId();
+      thread_local uint32_t tid = orbit_base::GetCurrentThreadId();
+      GetCaptureEventProducer().EnqueueIntermediateEvent(
+          FunctionExit{pid, tid, timestamp_on_exit_ns});
+    }
   }
 
   is_in_payload = false;
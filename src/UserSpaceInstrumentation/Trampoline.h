@@ -16,6 +16,7 @@
 #include <optional>
 #include <vector>
 
+#include "AccessTraceesMemory.h"
 #include "AllocateInTracee.h"
 #include "OrbitBase/Result.h"
 #include "UserSpaceInstrumentation/AddressRange.h"
@@ -137,6 +138,23 @@ struct RelocatedInstruction {
     uint64_t return_trampoline_address, csh capstone_handle,
     absl::flat_hash_map<uint64_t, uint64_t>& relocation_map);
 
+// Merely serves as a return value for the function below.
+struct AssembledTrampoline {
+  // Machine code of the trampoline, to be written at the trampoline address.
+  std::vector<uint8_t> code;
+  // The address of the first instruction not relocated into the trampoline.
+  uint64_t address_after_prologue = 0;
+};
+
+// Does everything `CreateTrampoline` does except for writing the trampoline into the tracee: the
+// machine code is returned instead. Hence this doesn't need to be attached to the tracee, and it
+// can run in parallel for different functions as long as each call uses its own `capstone_handle`
+// and `relocation_map`.
+[[nodiscard]] ErrorMessageOr<AssembledTrampoline> AssembleTrampoline(
+    uint64_t function_address, absl::Span<const uint8_t> function, uint64_t trampoline_address,
+    uint64_t entry_payload_function_address, uint64_t return_trampoline_address,
+    csh capstone_handle, absl::flat_hash_map<uint64_t, uint64_t>& relocation_map);
+
 // As above with `GetMaxTrampolineSize` this is a compile-time constant, but we prefer to compute it
 // here since this captures every change to the code constructing the return trampoline.
 [[nodiscard]] uint64_t GetReturnTrampolineSize();
@@ -163,6 +181,13 @@ struct RelocatedInstruction {
                                                       uint64_t address_after_prologue,
                                                       uint64_t trampoline_address);
 
+// Returns the writes into the tracee's memory that `InstrumentFunction` performs, such that the
+// writes for many functions can be batched: the write of the function id into the trampoline comes
+// first, then the write of the jump over the beginning of the function.
+[[nodiscard]] ErrorMessageOr<std::vector<TraceesMemoryWrite>> GetWritesToInstrumentFunction(
+    uint64_t function_address, uint64_t function_id, uint64_t address_after_prologue,
+    uint64_t trampoline_address);
+
 // Move every instruction pointer that was in the middle of an overwritten function prologue to
 // the corresponding place in the trampoline.
 void MoveInstructionPointersOutOfOverwrittenCode(
@@ -352,6 +352,30 @@ TEST(TrampolineTest, AddressDifferenceAsInt32) {
   EXPECT_THAT(result, HasError("Difference is larger than -2GB"));
 }
 
+TEST(TrampolineTest, GetWritesToInstrumentFunction) {
+  constexpr uint64_t kFunctionAddress = 0x6000'0000;
+  constexpr uint64_t kTrampolineAddress = 0x6000'1000;
+  constexpr uint64_t kFunctionId = 0x0102'0304'0506'0708;
+  auto writes_or_error = GetWritesToInstrumentFunction(kFunctionAddress, kFunctionId,
+                                                       kFunctionAddress + 7, kTrampolineAddress);
+  ASSERT_THAT(writes_or_error, HasNoError());
+  const std::vector<TraceesMemoryWrite>& writes = writes_or_error.value();
+  ASSERT_EQ(writes.size(), 2);
+
+  // The function id goes into the trampoline.
+  EXPECT_GT(writes[0].start_address, kTrampolineAddress);
+  EXPECT_THAT(writes[0].bytes, ElementsAreArray({0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01}));
+
+  // The jump into the trampoline, padded with nops up to the address after the prologue.
+  EXPECT_EQ(writes[1].start_address, kFunctionAddress);
+  EXPECT_THAT(writes[1].bytes, ElementsAreArray({0xe9, 0xfb, 0x0f, 0x00, 0x00, 0x90, 0x90}));
+
+  // The trampoline is too far away from the function.
+  EXPECT_THAT(GetWritesToInstrumentFunction(kFunctionAddress, kFunctionId, kFunctionAddress + 5,
+                                            kFunctionAddress + 0x1'0000'0000),
+              HasError("more then +-2GB apart"));
+}
+
 class RelocateInstructionTest : public testing::Test {
  protected:
   void SetUp() override {
@@ -8,6 +8,7 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
 #include <absl/hash/hash.h>
+#include <absl/time/time.h>
 #include <sys/types.h>
 
 #include <cstdint>
@@ -43,6 +44,10 @@ class InstrumentationManager {
     std::vector<AddressRange> entry_trampoline_address_ranges;
     AddressRange return_trampoline_address_range;
     std::filesystem::path injected_library_path;
+    // How long the target process was stopped in total. Trampolines are created while the process
+    // keeps running; it only needs to be stopped to allocate memory for them and to patch the
+    // functions.
+    absl::Duration stop_the_world_duration;
   };
 
   // On the first call to this function we inject OrbitUserSpaceInstrumentation.so into the target
@@ -52,7 +57,7 @@ class InstrumentationManager {
   // potentially - error messages for functions where the instrumentation failed. Note that there is
   // no guarantee that we can instrument all the functions in a binary. It also returns the address
   // ranges dedicated to trampolines, including the return trampoline, and the map name of the
-  // injected library.
+  // injected library, as well as the time the process was stopped.
   [[nodiscard]] ErrorMessageOr<InstrumentationResult> InstrumentProcess(
       const orbit_grpc_protos::CaptureOptions& capture_options);
 